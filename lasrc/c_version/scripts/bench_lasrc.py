@@ -0,0 +1,254 @@
+#! /usr/bin/env python
+import sys
+import os
+import shutil
+import subprocess
+import tempfile
+import time
+from optparse import OptionParser
+import logging
+
+ERROR = 1
+SUCCESS = 0
+
+
+#############################################################################
+# Script to time the Landsat 8 surface reflectance code (lasrc) on real
+# scenes, comparing the runs with and without one of its options.  Each run
+# is made on fresh copies of the scenes, since lasrc writes its products to
+# the scene directory and adds them to the XML file.
+#
+# The scenes must be ready for lasrc, i.e. the per-pixel angle bands must
+# already have been generated and masked as done by do_lasrc.py, and the
+# auxiliary files must be available to lasrc as usual.
+#
+# Usage: bench_lasrc.py --help prints the help message
+#
+# Examples:
+#   bench_lasrc.py --mode=output_format --xml=LC08_..._T1.xml \
+#       --aux=L8ANC2013181.hdf_fused
+#   bench_lasrc.py --mode=batch --batch=scenes.txt
+#   OMP_NUM_THREADS=32 bench_lasrc.py --mode=numa --xml=LC08_..._T1.xml \
+#       --aux=L8ANC2013181.hdf_fused
+#
+# Notes:
+#   1. --batch lists the scenes in the format of the lasrc batch file, one
+#      scene per line as the XML filename followed by the auxiliary filename.
+#      Each run processes all the scenes, and is timed from the start of the
+#      first scene to the end of the last.
+#   2. lasrc is run with the environment of this script, so OMP_NUM_THREADS
+#      applies to all the runs.
+############################################################################
+
+# Runs compared by each mode, as (label, lasrc options, batched) for each
+# run.  The scenes of a batched run are processed by a single lasrc --batch,
+# the others by one lasrc per scene in turn.
+BENCH_MODES = {
+    'output_format': [('raw', ['--output_format=raw'], False),
+                      ('tiled', ['--output_format=tiled'], False)],
+    'batch': [('sequential', [], False),
+              ('batch', ['--concurrency=1'], True),
+              ('batch_c2', ['--concurrency=2'], True)],
+    'numa': [('default', [], False),
+             ('numa', ['--numa'], False)]
+}
+
+
+#############################################################################
+# Description: copyScene copies the input files of the scene to a new work
+# directory.
+#
+# Inputs:
+#   xml_infile - name of the input XML file
+#   work_dir - directory to copy the scene into
+#
+# Returns:
+#   Name of the copied XML file
+#############################################################################
+def copyScene (xml_infile, work_dir):
+    xmldir = os.path.dirname (os.path.abspath (xml_infile))
+    for name in os.listdir (xmldir):
+        path = os.path.join (xmldir, name)
+        if os.path.isfile (path):
+            shutil.copy2 (path, work_dir)
+    return os.path.join (work_dir, os.path.basename (xml_infile))
+
+
+#############################################################################
+# Description: dirSize returns the total size of the files in a directory.
+#
+# Inputs:
+#   dirname - directory to be summed
+#
+# Returns:
+#   Size of the files in bytes
+#############################################################################
+def dirSize (dirname):
+    size = 0
+    for name in os.listdir (dirname):
+        path = os.path.join (dirname, name)
+        if os.path.isfile (path):
+            size += os.path.getsize (path)
+    return size
+
+
+#############################################################################
+# Description: readScenes reads the list of scenes from a batch file.
+#
+# Inputs:
+#   batch_infile - name of the batch file
+#
+# Returns:
+#   List of (XML filename, auxiliary filename) for each scene
+#############################################################################
+def readScenes (batch_infile):
+    scenes = []
+    for line in open (batch_infile):
+        fields = line.split()
+        if len(fields) == 0 or fields[0].startswith('#'):
+            continue
+        if len(fields) < 2:
+            raise ValueError ('Line of the batch file {} must contain the XML '
+                              'filename and the auxiliary filename: {}'
+                              .format(batch_infile, line.strip()))
+        scenes.append ((fields[0], fields[1]))
+    return scenes
+
+
+#############################################################################
+# Description: runLasrc makes a single run of lasrc on fresh copies of the
+# scenes.
+#
+# Inputs:
+#   lasrc - lasrc executable
+#   scenes - list of (XML filename, auxiliary filename) for each scene
+#   options - list of lasrc options for this run
+#   batched - process the scenes with a single lasrc --batch
+#   tmp_dir - directory for the copies of the scenes, or None for the
+#       system default
+#
+# Returns:
+#   (elapsed seconds, bytes written), or None if lasrc failed
+#
+# Notes:
+#   1. Only the lasrc runs are timed, not the copies of the scenes.  The
+#      bytes written are the growth of the scene directories.
+#   2. The lasrc output is written to a log file next to the work directory,
+#      which is left in place with the log if lasrc fails.
+#############################################################################
+def runLasrc (lasrc, scenes, options, batched, tmp_dir):
+    logger = logging.getLogger(__name__)
+    work_dir = tempfile.mkdtemp (prefix='bench_lasrc_', dir=tmp_dir)
+    work_xmls = []
+    for (i, (xml_infile, aux_infile)) in enumerate(scenes):
+        scene_dir = os.path.join (work_dir, 'scene{}'.format(i))
+        os.mkdir (scene_dir)
+        work_xmls.append (copyScene (xml_infile, scene_dir))
+    in_size = sum([dirSize (os.path.dirname (xml)) for xml in work_xmls])
+
+    # each scene is run from its own directory, as lasrc --batch does
+    if batched:
+        batch_file = os.path.join (work_dir, 'scenes.txt')
+        fp = open (batch_file, 'w')
+        for (xml, (xml_infile, aux_infile)) in zip(work_xmls, scenes):
+            fp.write ('{} {}\n'.format(xml, aux_infile))
+        fp.close()
+        cmds = [(work_dir, [lasrc, '--batch={}'.format(batch_file),
+                            '--process_sr=true'] + options)]
+    else:
+        cmds = [(os.path.dirname (xml),
+                 [lasrc, '--xml={}'.format(os.path.basename (xml)),
+                  '--aux={}'.format(aux_infile), '--process_sr=true'] +
+                 options)
+                for (xml, (xml_infile, aux_infile)) in zip(work_xmls, scenes)]
+
+    log_file = work_dir + '.log'
+    log = open (log_file, 'w')
+    start = time.time()
+    for (cwd, cmd) in cmds:
+        logger.debug ('Executing lasrc command: {}'.format(' '.join(cmd)))
+        log.flush()
+        status = subprocess.call (cmd, cwd=cwd, stdout=log,
+                                  stderr=subprocess.STDOUT)
+        if status != 0:
+            log.close()
+            logger.error ('Error running lasrc; see {}'.format(log_file))
+            return None
+    elapsed = time.time() - start
+    log.close()
+
+    out_size = (sum([dirSize (os.path.dirname (xml)) for xml in work_xmls]) -
+                in_size)
+    shutil.rmtree (work_dir)
+    os.remove (log_file)
+    return (elapsed, out_size)
+
+
+#############################################################################
+# Description: main parses the command line, runs each of the runs of the
+# mode the given number of times on all the scenes, and reports the fastest
+# time and the bytes written by each run.
+#
+# Returns:
+#     ERROR - error running lasrc
+#     SUCCESS - successful processing
+#############################################################################
+def main ():
+    parser = OptionParser()
+    parser.add_option ("--mode", type="choice",
+        choices=sorted(BENCH_MODES.keys()), dest="mode",
+        help="runs to compare: " + ", ".join(sorted(BENCH_MODES.keys())))
+    parser.add_option ("-i", "--xml", type="string", dest="xml",
+        help="name of the XML file of the scene", metavar="FILE")
+    parser.add_option ("--aux", type="string", dest="aux",
+        help="name of the auxiliary file of the scene", metavar="FILE")
+    parser.add_option ("--batch", type="string", dest="batch",
+        help="name of a batch file listing the scenes, in place of --xml "
+             "and --aux", metavar="FILE")
+    parser.add_option ("--lasrc", type="string", dest="lasrc",
+        default="lasrc", help="lasrc executable (default is lasrc)")
+    parser.add_option ("--repeat", type="int", dest="repeat", default=3,
+        help="number of times each run is made (default is 3)")
+    parser.add_option ("--tmp_dir", type="string", dest="tmp_dir",
+        default=None, help="directory for the copies of the scene "
+                           "(default is the system temporary directory)")
+    (options, args) = parser.parse_args()
+    if options.mode == None:
+        parser.error ('--mode is required')
+    if options.batch != None:
+        scenes = readScenes (options.batch)
+    elif options.xml != None and options.aux != None:
+        scenes = [(options.xml, options.aux)]
+    else:
+        parser.error ('either --xml and --aux or --batch is required')
+
+    logger = logging.getLogger(__name__)
+    results = []
+    for (label, lasrc_options, batched) in BENCH_MODES[options.mode]:
+        best = None
+        for i in range(options.repeat):
+            result = runLasrc (options.lasrc, scenes, lasrc_options, batched,
+                               options.tmp_dir)
+            if result == None:
+                return ERROR
+            logger.info ('{} run {}: {:.1f} s, {} bytes written'
+                         .format(label, i + 1, result[0], result[1]))
+            if best == None or result[0] < best[0]:
+                best = result
+        results.append ((label, best))
+
+    print ('{:<12} {:>10} {:>16}'.format('run', 'time (s)', 'bytes written'))
+    for (label, (elapsed, out_size)) in results:
+        print ('{:<12} {:>10.1f} {:>16}'.format(label, elapsed, out_size))
+    return SUCCESS
+
+
+if __name__ == "__main__":
+    # setup the default logger format and level. log to STDOUT.
+    logging.basicConfig(format=('%(asctime)s.%(msecs)03d %(process)d'
+                                ' %(levelname)-8s'
+                                ' %(filename)s:%(lineno)d:'
+                                '%(funcName)s -- %(message)s'),
+                        datefmt='%Y-%m-%d %H:%M:%S',
+                        level=logging.INFO)
+    sys.exit (main())
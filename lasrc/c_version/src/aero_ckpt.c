@@ -0,0 +1,378 @@
+/*****************************************************************************
+FILE: aero_ckpt.c
+
+PURPOSE: Contains functions for checkpointing the aerosol inversion, so a
+rerun of a scene which failed after the inversion (or a rerun with other
+output options) can skip straight to the interpolation and the final
+atmospheric correction.
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+LICENSE TYPE:  NASA Open Source Agreement Version 1.3
+
+NOTES:
+  1. Only the ipflag, taero, and teps values of the aerosol window centers
+     are written.  These are all the median aerosol and the interpolation
+     need, and both are cheap to redo, so the checkpoint is about 1/9th the
+     size of the full resolution arrays.
+  2. The header holds a CRC-32 of each array read by the inversion, the
+     scene center ozone, water vapor, and pressure, and the name, size, and
+     modification time of the look-up table, climate modeling grid, and
+     daily auxiliary files.  So a checkpoint is only used if the TOA
+     reflectance, QA, and auxiliary inputs of the scene are the same as when
+     it was written, along with the scene size, window, quick-look factor,
+     aerosol window size, and version.
+  3. The checkpoint is written to a temporary file which is renamed when
+     complete, so a run which dies while writing it (e.g. on a full disk)
+     never leaves a partial checkpoint behind.
+*****************************************************************************/
+#include <unistd.h>
+#include <sys/stat.h>
+#include "aero_ckpt.h"
+
+/* Size of the pieces each array is hashed in, which must fit in the uInt
+   length taken by crc32 */
+#define CKPT_HASH_CHUNK (1L << 30)
+
+/******************************************************************************
+MODULE:  crc32_array
+
+PURPOSE:  Computes the CRC-32 of an array.
+
+RETURN VALUE:
+Type = uint32_t
+Value           Description
+-----           -----------
+crc             CRC-32 of the array
+
+NOTES:
+  1. Also used for the digest of the TOA reflectance bands (see
+     toa_reuse.c).
+******************************************************************************/
+uint32_t crc32_array
+(
+    void *buf,            /* I: array to be hashed */
+    size_t nbytes         /* I: size of the array (bytes) */
+)
+{
+    uLong crc = crc32 (0L, Z_NULL, 0);  /* CRC of the array */
+    size_t offset;        /* offset of the current piece of the array */
+    size_t len;           /* size of the current piece of the array */
+
+    for (offset = 0; offset < nbytes; offset += len)
+    {
+        len = MIN (nbytes - offset, (size_t) CKPT_HASH_CHUNK);
+        crc = crc32 (crc, (Bytef *) buf + offset, (uInt) len);
+    }
+
+    return ((uint32_t) crc);
+}
+
+
+/******************************************************************************
+MODULE:  get_ckpt_file_id
+
+PURPOSE:  Gets the identity of a file the aerosol inversion depends on.
+
+RETURN VALUE:
+Type = None
+
+NOTES:
+  1. A file which doesn't exist (e.g. the optional packed ratio record file)
+     gets a size and modification time of -1, so a checkpoint written before
+     the file was created isn't used afterwards.
+******************************************************************************/
+static void get_ckpt_file_id
+(
+    char *file_name,      /* I: name of the file */
+    Aero_ckpt_file_id_t *id  /* O: identity of the file */
+)
+{
+    struct stat file_stat;   /* status of the file */
+
+    id->name_hash = crc32_array (file_name, strlen (file_name));
+    id->spare = 0;
+    if (stat (file_name, &file_stat) == 0)
+    {
+        id->size = (int64_t) file_stat.st_size;
+        id->mtime = (int64_t) file_stat.st_mtime;
+    }
+    else
+    {
+        id->size = -1;
+        id->mtime = -1;
+    }
+}
+
+
+/******************************************************************************
+MODULE:  init_aero_ckpt
+
+PURPOSE:  Sets up the checkpoint header for the scene, hashing each of the
+arrays read by the aerosol inversion.
+
+RETURN VALUE:
+Type = None
+
+NOTES:
+  1. This must be called once the inversion inputs are complete, right
+     before the inversion.  The arrays are hashed in parallel.
+  2. The inputs which aren't computed (NULL) are left with a hash of 0.
+  3. The daily auxiliary file is the tiled file when the grid is read by
+     tiles, otherwise the HDF file.
+******************************************************************************/
+void init_aero_ckpt
+(
+    Input_t *input,       /* I: input structure for the scene */
+    Sr_tables_t *tables,  /* I: static look-up tables and climate modeling
+                                grids */
+    Aux_grid_t *aux,      /* I: ozone and water vapor grid for the scene
+                                date */
+    float uoz,            /* I: scene center total column ozone */
+    float uwv,            /* I: scene center total column water vapor */
+    float pres,           /* I: scene center surface pressure */
+    int nlines,           /* I: number of lines in the scene arrays */
+    int nsamps,           /* I: number of samples in the scene arrays */
+    void **inputs,        /* I: inversion input arrays, indexed by
+                                Aero_ckpt_input_t; NULL for the inputs which
+                                aren't computed */
+    size_t *nbytes,       /* I: size (bytes) of each inversion input array */
+    Aero_ckpt_header_t *hdr  /* O: checkpoint header for the scene */
+)
+{
+    int i;                /* looping variable for the inputs */
+
+    memset (hdr, 0, sizeof (Aero_ckpt_header_t));
+    memcpy (hdr->magic, AERO_CKPT_MAGIC, AERO_CKPT_MAGIC_LEN);
+    snprintf (hdr->version, AERO_CKPT_VERSION_LEN, "%s", SR_VERSION);
+    hdr->nlines = nlines;
+    hdr->nsamps = nsamps;
+    hdr->line0 = input->line0;
+    hdr->samp0 = input->samp0;
+    hdr->quicklook = input->quicklook;
+    hdr->aero_window = AERO_WINDOW;
+    hdr->nwin_lines = AERO_NWINDOWS (nlines);
+    hdr->nwin_samps = AERO_NWINDOWS (nsamps);
+    hdr->uoz = uoz;
+    hdr->uwv = uwv;
+    hdr->pres = pres;
+
+#ifdef _OPENMP
+    #pragma omp parallel for schedule (dynamic, 1)
+#endif
+    for (i = 0; i < AERO_CKPT_NINPUTS; i++)
+    {
+        if (inputs[i] != NULL)
+            hdr->hash[i] = crc32_array (inputs[i], nbytes[i]);
+    }
+
+    for (i = 0; i < NSR_TABLE_FILES; i++)
+        get_ckpt_file_id (tables->table_files[i], &hdr->files[i]);
+    get_ckpt_file_id (aux->tiles != NULL ? aux->tiles->file_name :
+        aux->auxnm, &hdr->files[CKPT_AUX_FILE]);
+}
+
+
+/******************************************************************************
+MODULE:  read_aero_ckpt
+
+PURPOSE:  Restores the aerosol inversion from the checkpoint, if the
+checkpoint exists and was written for the same inputs.
+
+RETURN VALUE:
+Type = bool
+Value           Description
+-----           -----------
+true            The window centers were restored from the checkpoint
+false           No checkpoint, or it doesn't match the scene; the inversion
+                needs to be run
+
+NOTES:
+  1. Only the window centers of ipflag, taero, and teps are set.  A
+     checkpoint which can't be used is reported and otherwise ignored.
+******************************************************************************/
+bool read_aero_ckpt
+(
+    char *ckpt_file,      /* I: name of the checkpoint file */
+    Aero_ckpt_header_t *hdr,  /* I: checkpoint header for the scene */
+    uint8 *ipflag,        /* O: QA flag, set for the window centers,
+                                nlines x nsamps */
+    float *taero,         /* O: aerosol values, set for the window centers,
+                                nlines x nsamps */
+    float *teps           /* O: angstrom coefficients, set for the window
+                                centers, nlines x nsamps */
+)
+{
+    char FUNC_NAME[] = "read_aero_ckpt";   /* function name */
+    char errmsg[STR_SIZE];   /* error message */
+    int wline, wsamp;        /* looping variables for the aerosol windows */
+    long curr_pix;           /* current window center in the scene arrays */
+    long nwin = (long) hdr->nwin_lines * hdr->nwin_samps;  /* number of
+                                aerosol windows */
+    Aero_ckpt_header_t file_hdr;  /* header read from the checkpoint */
+    uint8 *win_ipflag = NULL;     /* ipflag of the window centers */
+    float *win_taero = NULL;      /* taero of the window centers */
+    float *win_teps = NULL;       /* teps of the window centers */
+    FILE *fp = NULL;              /* checkpoint file pointer */
+
+    fp = fopen (ckpt_file, "rb");
+    if (fp == NULL)
+        return (false);
+
+    if (fread (&file_hdr, sizeof (file_hdr), 1, fp) != 1 ||
+        memcmp (&file_hdr, hdr, sizeof (file_hdr)))
+    {
+        sprintf (errmsg, "Aerosol checkpoint %s was written for other inputs "
+            "and will be replaced", ckpt_file);
+        error_handler (false, FUNC_NAME, errmsg);
+        fclose (fp);
+        return (false);
+    }
+
+    win_ipflag = malloc (nwin * sizeof (uint8));
+    win_taero = malloc (nwin * sizeof (float));
+    win_teps = malloc (nwin * sizeof (float));
+    if (win_ipflag == NULL || win_taero == NULL || win_teps == NULL)
+    {
+        sprintf (errmsg, "Allocating the aerosol window centers");
+        error_handler (false, FUNC_NAME, errmsg);
+        free (win_ipflag);
+        free (win_taero);
+        free (win_teps);
+        fclose (fp);
+        return (false);
+    }
+
+    if (fread (win_ipflag, sizeof (uint8), nwin, fp) != (size_t) nwin ||
+        fread (win_taero, sizeof (float), nwin, fp) != (size_t) nwin ||
+        fread (win_teps, sizeof (float), nwin, fp) != (size_t) nwin)
+    {
+        sprintf (errmsg, "Reading the aerosol checkpoint %s; it will be "
+            "replaced", ckpt_file);
+        error_handler (false, FUNC_NAME, errmsg);
+        free (win_ipflag);
+        free (win_taero);
+        free (win_teps);
+        fclose (fp);
+        return (false);
+    }
+    fclose (fp);
+
+    /* Scatter the window centers into the scene arrays */
+    for (wline = 0; wline < hdr->nwin_lines; wline++)
+    {
+        for (wsamp = 0; wsamp < hdr->nwin_samps; wsamp++)
+        {
+            curr_pix = (long) (wline * AERO_WINDOW + HALF_AERO_WINDOW) *
+                hdr->nsamps + wsamp * AERO_WINDOW + HALF_AERO_WINDOW;
+            ipflag[curr_pix] = win_ipflag[wline * hdr->nwin_samps + wsamp];
+            taero[curr_pix] = win_taero[wline * hdr->nwin_samps + wsamp];
+            teps[curr_pix] = win_teps[wline * hdr->nwin_samps + wsamp];
+        }
+    }
+
+    free (win_ipflag);
+    free (win_taero);
+    free (win_teps);
+    return (true);
+}
+
+
+/******************************************************************************
+MODULE:  write_aero_ckpt
+
+PURPOSE:  Writes the window centers of the aerosol inversion to the
+checkpoint.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error allocating memory or writing the checkpoint
+SUCCESS         No errors encountered
+
+NOTES:
+  1. The checkpoint is written to ckpt_file.tmp and renamed once complete.
+     On an error the temporary file is removed.
+******************************************************************************/
+int write_aero_ckpt
+(
+    char *ckpt_file,      /* I: name of the checkpoint file */
+    Aero_ckpt_header_t *hdr,  /* I: checkpoint header for the scene */
+    uint8 *ipflag,        /* I: QA flag, nlines x nsamps */
+    float *taero,         /* I: aerosol values, nlines x nsamps */
+    float *teps           /* I: angstrom coefficients, nlines x nsamps */
+)
+{
+    char FUNC_NAME[] = "write_aero_ckpt";   /* function name */
+    char errmsg[STR_SIZE];   /* error message */
+    char tmp_file[STR_SIZE]; /* temporary checkpoint filename */
+    int wline, wsamp;        /* looping variables for the aerosol windows */
+    long curr_pix;           /* current window center in the scene arrays */
+    long nwin = (long) hdr->nwin_lines * hdr->nwin_samps;  /* number of
+                                aerosol windows */
+    bool ok;                 /* were the window centers written? */
+    uint8 *win_ipflag = NULL;     /* ipflag of the window centers */
+    float *win_taero = NULL;      /* taero of the window centers */
+    float *win_teps = NULL;       /* teps of the window centers */
+    FILE *fp = NULL;              /* checkpoint file pointer */
+
+    win_ipflag = malloc (nwin * sizeof (uint8));
+    win_taero = malloc (nwin * sizeof (float));
+    win_teps = malloc (nwin * sizeof (float));
+    if (win_ipflag == NULL || win_taero == NULL || win_teps == NULL)
+    {
+        sprintf (errmsg, "Allocating the aerosol window centers");
+        error_handler (true, FUNC_NAME, errmsg);
+        free (win_ipflag);
+        free (win_taero);
+        free (win_teps);
+        return (ERROR);
+    }
+
+    /* Gather the window centers from the scene arrays */
+    for (wline = 0; wline < hdr->nwin_lines; wline++)
+    {
+        for (wsamp = 0; wsamp < hdr->nwin_samps; wsamp++)
+        {
+            curr_pix = (long) (wline * AERO_WINDOW + HALF_AERO_WINDOW) *
+                hdr->nsamps + wsamp * AERO_WINDOW + HALF_AERO_WINDOW;
+            win_ipflag[wline * hdr->nwin_samps + wsamp] = ipflag[curr_pix];
+            win_taero[wline * hdr->nwin_samps + wsamp] = taero[curr_pix];
+            win_teps[wline * hdr->nwin_samps + wsamp] = teps[curr_pix];
+        }
+    }
+
+    snprintf (tmp_file, sizeof (tmp_file), "%s.tmp", ckpt_file);
+    fp = fopen (tmp_file, "wb");
+    if (fp == NULL)
+    {
+        sprintf (errmsg, "Opening the aerosol checkpoint %s", tmp_file);
+        error_handler (true, FUNC_NAME, errmsg);
+        free (win_ipflag);
+        free (win_taero);
+        free (win_teps);
+        return (ERROR);
+    }
+
+    ok = fwrite (hdr, sizeof (Aero_ckpt_header_t), 1, fp) == 1 &&
+        fwrite (win_ipflag, sizeof (uint8), nwin, fp) == (size_t) nwin &&
+        fwrite (win_taero, sizeof (float), nwin, fp) == (size_t) nwin &&
+        fwrite (win_teps, sizeof (float), nwin, fp) == (size_t) nwin;
+    free (win_ipflag);
+    free (win_taero);
+    free (win_teps);
+    if (fclose (fp) != 0)
+        ok = false;
+
+    if (!ok || rename (tmp_file, ckpt_file) != 0)
+    {
+        sprintf (errmsg, "Writing the aerosol checkpoint %s", ckpt_file);
+        error_handler (true, FUNC_NAME, errmsg);
+        unlink (tmp_file);
+        return (ERROR);
+    }
+
+    return (SUCCESS);
+}
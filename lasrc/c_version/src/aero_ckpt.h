@@ -0,0 +1,124 @@
+#ifndef _AERO_CKPT_H_
+#define _AERO_CKPT_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include "zlib.h"
+#include "common.h"
+#include "input.h"
+#include "sr_tables.h"
+#include "error_handler.h"
+
+/* Defines for the aerosol checkpoint written by --checkpoint after the
+   aerosol inversion.  The file consists of the header, followed by the
+   ipflag (uint8), taero (float), and teps (float) values of the aerosol
+   window centers, each as a nwin_lines x nwin_samps plane.  All values are
+   in the native byte order of the machine writing the file. */
+#define AERO_CKPT_MAGIC "LSRAERO2"  /* 8-character file signature */
+#define AERO_CKPT_MAGIC_LEN 8
+#define AERO_CKPT_EXTENSION "_aero.ckpt"  /* appended to the product ID */
+#define AERO_CKPT_VERSION_LEN 16
+
+/* Define the arrays read by the aerosol inversion, which are hashed to tell
+   whether a checkpoint is still valid for the scene.  The order is the order
+   of the hashes in the header.  The interpolated auxiliary arrays are only
+   hashed when they are computed (INTERP_AUX); otherwise they are NULL and
+   the scene center values are kept in the header instead. */
+typedef enum {
+    CKPT_AEROB1=0, CKPT_AEROB2, CKPT_AEROB4, CKPT_AEROB5, CKPT_AEROB7,
+    CKPT_PCLASS, CKPT_IPFLAG, CKPT_TWVI, CKPT_TOZI, CKPT_TP,
+    AERO_CKPT_NINPUTS
+} Aero_ckpt_input_t;
+
+/* Define the files the inversion inputs depend on, beyond the scene itself:
+   the static tables (indexed as Sr_table_file_t) and the daily auxiliary
+   file.  These are too large to hash for each scene, so the name, size, and
+   modification time of each file are kept instead. */
+#define CKPT_AUX_FILE NSR_TABLE_FILES
+#define AERO_CKPT_NFILES (NSR_TABLE_FILES + 1)
+
+/* Structure for the identity of a file the inversion depends on */
+typedef struct {
+    uint32_t name_hash;       /* CRC-32 of the file name */
+    int32_t spare;            /* unused; keeps the structure 8-byte aligned */
+    int64_t size;             /* size of the file (bytes); -1 if the file
+                                 doesn't exist */
+    int64_t mtime;            /* modification time of the file (seconds since
+                                 the epoch); -1 if the file doesn't exist */
+} Aero_ckpt_file_id_t;
+
+/* Structure for the aerosol checkpoint header */
+typedef struct {
+    char magic[AERO_CKPT_MAGIC_LEN];  /* file signature, AERO_CKPT_MAGIC */
+    char version[AERO_CKPT_VERSION_LEN];  /* SR_VERSION which wrote the
+                                 file */
+    int32_t nlines;           /* number of lines in the scene arrays */
+    int32_t nsamps;           /* number of samples in the scene arrays */
+    int32_t line0;            /* first line of the scene read */
+    int32_t samp0;            /* first sample of the scene read */
+    int32_t quicklook;        /* quick-look reduction factor */
+    int32_t aero_window;      /* size of the aerosol windows, AERO_WINDOW */
+    int32_t nwin_lines;       /* number of aerosol window lines */
+    int32_t nwin_samps;       /* number of aerosol window samples */
+    float uoz;                /* scene center total column ozone */
+    float uwv;                /* scene center total column water vapor */
+    float pres;               /* scene center surface pressure */
+    int32_t spare;            /* unused; keeps the file ids 8-byte aligned */
+    uint32_t hash[AERO_CKPT_NINPUTS];  /* CRC-32 of each inversion input; 0
+                                 for the inputs which aren't computed */
+    Aero_ckpt_file_id_t files[AERO_CKPT_NFILES];  /* identity of the table
+                                 and auxiliary files, indexed by
+                                 Sr_table_file_t and CKPT_AUX_FILE */
+} Aero_ckpt_header_t;
+
+/* Prototypes */
+uint32_t crc32_array
+(
+    void *buf,            /* I: array to be hashed */
+    size_t nbytes         /* I: size of the array (bytes) */
+);
+
+void init_aero_ckpt
+(
+    Input_t *input,       /* I: input structure for the scene */
+    Sr_tables_t *tables,  /* I: static look-up tables and climate modeling
+                                grids */
+    Aux_grid_t *aux,      /* I: ozone and water vapor grid for the scene
+                                date */
+    float uoz,            /* I: scene center total column ozone */
+    float uwv,            /* I: scene center total column water vapor */
+    float pres,           /* I: scene center surface pressure */
+    int nlines,           /* I: number of lines in the scene arrays */
+    int nsamps,           /* I: number of samples in the scene arrays */
+    void **inputs,        /* I: inversion input arrays, indexed by
+                                Aero_ckpt_input_t; NULL for the inputs which
+                                aren't computed */
+    size_t *nbytes,       /* I: size (bytes) of each inversion input array */
+    Aero_ckpt_header_t *hdr  /* O: checkpoint header for the scene */
+);
+
+bool read_aero_ckpt
+(
+    char *ckpt_file,      /* I: name of the checkpoint file */
+    Aero_ckpt_header_t *hdr,  /* I: checkpoint header for the scene */
+    uint8 *ipflag,        /* O: QA flag, set for the window centers,
+                                nlines x nsamps */
+    float *taero,         /* O: aerosol values, set for the window centers,
+                                nlines x nsamps */
+    float *teps           /* O: angstrom coefficients, set for the window
+                                centers, nlines x nsamps */
+);
+
+int write_aero_ckpt
+(
+    char *ckpt_file,      /* I: name of the checkpoint file */
+    Aero_ckpt_header_t *hdr,  /* I: checkpoint header for the scene */
+    uint8 *ipflag,        /* I: QA flag, nlines x nsamps */
+    float *taero,         /* I: aerosol values, nlines x nsamps */
+    float *teps           /* I: angstrom coefficients, nlines x nsamps */
+);
+
+#endif
@@ -2,11 +2,10 @@
 #include "quick_select.h"
 
 /******************************************************************************
-MODULE:  aerosol_interp
+MODULE:  get_window_center
 
-PURPOSE:  Interpolates the aerosol values throughout the image using the
-aerosols that were calculated for each NxN window. Also cleans up the fill
-pixels in the ipflag.
+PURPOSE:  Gets the aerosol value, angstrom coefficient, and water flag of an
+aerosol window center pixel, as used to interpolate the specified pixel.
 
 RETURN VALUE:
 Type = N/A
@@ -15,11 +14,113 @@ PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
 at the USGS EROS
 
 NOTES:
+  1. This reproduces the values the window centers had when the median fill
+     and the aerosol and eps interpolations were separate passes, done one
+     pixel at a time in line/sample order.
+       - The median fill set the aerosol of the window centers flagged as
+         cloud, shadow, or water to the median aerosol.
+       - Each interpolation reset the window centers which are cloud, shadow,
+         or water pixels to the median aerosol (or the default eps), so the
+         pixels after a window center saw its reset value and the pixels
+         before it saw its original value.
+       - The water flags come from the eps interpolation, which saw the
+         window center flags left by the aerosol interpolation.
+     The window centers are now updated after all the other pixels have been
+     interpolated (see aerosol_fill_interp), so the values they had are
+     computed here.
 ******************************************************************************/
-void aerosol_interp
+static void get_window_center
 (
-    Espa_internal_meta_t *xml_metadata, /* I: XML metadata information */
-    int16 **sband,     /* I/O: input TOA reflectance */
+    int16 **sband,     /* I: input TOA reflectance */
+    uint16 *qaband,    /* I: QA band for the input image, nlines x nsamps */
+    uint8 *ipflag,     /* I: QA flag to assist with aerosol interpolation,
+                             nlines x nsamps */
+    float *taero,      /* I: aerosol values for each pixel, nlines x nsamps */
+    float *teps,       /* I: angstrom coeff for each pixel, nlines x nsamps */
+    float median_aero, /* I: median aerosol value of clear pixels */
+    int aero_pix,      /* I: aerosol window center pixel */
+    int curr_pix,      /* I: pixel being interpolated */
+    float *aero,       /* O: aerosol value of the window center */
+    float *eps,        /* O: angstrom coeff of the window center */
+    bool *water        /* O: is the window center flagged as water? */
+)
+{
+    bool reset;        /* is the window center reset by the interpolation? */
+
+    /* Fill is flagged as fill, cloud and shadow are flagged as cloud or
+       shadow, and water is flagged as water.  Only the other window centers
+       keep their water flag from the aerosol inversion. */
+    if (level1_qa_is_fill (qaband[aero_pix]))
+    {
+        reset = false;
+        *water = false;
+    }
+    else if (is_cloud (qaband[aero_pix]) || is_shadow (qaband[aero_pix]))
+    {
+        reset = true;
+        *water = false;
+    }
+    else if (is_water (sband[SR_BAND4][aero_pix], sband[SR_BAND5][aero_pix]))
+    {
+        reset = true;
+        *water = true;
+    }
+    else
+    {
+        reset = false;
+        *water = btest (ipflag[aero_pix], IPFLAG_WATER);
+    }
+
+    /* The window centers were reset in line/sample order */
+    if (reset && aero_pix < curr_pix)
+    {
+        *aero = median_aero;
+        *eps = DEFAULT_EPS;
+        return;
+    }
+
+    /* Otherwise use the window center values after the median fill */
+    if (btest (ipflag[aero_pix], IPFLAG_CLOUD) ||
+        btest (ipflag[aero_pix], IPFLAG_SHADOW) ||
+        btest (ipflag[aero_pix], IPFLAG_WATER))
+        *aero = median_aero;
+    else
+        *aero = taero[aero_pix];
+    *eps = teps[aero_pix];
+}
+
+
+/******************************************************************************
+MODULE:  aerosol_fill_interp
+
+PURPOSE:  Fills the aerosol window centers which are cloud, shadow, or water
+with the median aerosol value, then interpolates the aerosol values and
+angstrom coefficients throughout the image using the values that were
+calculated for each NxN window. Also cleans up the fill pixels in the ipflag.
+
+RETURN VALUE:
+Type = N/A
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+NOTES:
+  1. The aerosol values and angstrom coefficients are interpolated together,
+     sharing the window pixels and bilinear weights for each pixel.  The
+     cloud, shadow, and water pixels get the median aerosol value and the
+     default eps.
+  2. The pixels are processed over the scheduling tiles in two passes.  The
+     first pass interpolates all the pixels except the window centers, which
+     only read the window centers.  The second pass then flags the fill
+     pixels and updates the window centers.  See get_window_center for how
+     the results match the original separate passes.
+  3. The window centers used for the last lines/samples are limited to the
+     last aerosol window, when the scene size leaves a partial window at the
+     end without its center pixel.
+******************************************************************************/
+void aerosol_fill_interp
+(
+    int16 **sband,     /* I: input TOA reflectance */
     uint16 *qaband,    /* I: QA band for the input image, nlines x nsamps */
     uint8 *ipflag,     /* I/O: QA flag to assist with aerosol interpolation,
                                nlines x nsamps.  It is expected that the ipflag
@@ -30,21 +131,32 @@ void aerosol_interp
                           for the center of the aerosol windows.  This routine
                           will fill in the pixels for the remaining, non-center
                           pixels of the window. */
+    float *teps,       /* I/O: angstrom coeff for each pixel, nlines x nsamps
+                          It is expected that the eps values are computed for
+                          the center of the aerosol windows.  This routine
+                          will fill in the pixels for the remaining, non-center
+                          pixels of the window. */
     float median_aero, /* I: median aerosol value of clear pixels */
     int nlines,        /* I: number of lines in qaband & taero bands */
-    int nsamps         /* I: number of samps in qaband & taero bands */
+    int nsamps,        /* I: number of samps in qaband & taero bands */
+    Tile_sched_t *tiles  /* I: scheduling tiles for the scene, with their
+                               costs set */
 )
 {
-    int i;                 /* looping variable for the bands */
+    int t;                 /* looping variable for the scheduling tiles */
     int line, samp;        /* looping variable for lines and samples */
     int curr_pix;          /* current pixel in 1D arrays of nlines * nsamps */
     int center_line;       /* line for the center of the aerosol window */
     int center_line1;      /* line+1 for the center of the aerosol window */
     int center_samp;       /* sample for the center of the aerosol window */
     int center_samp1;      /* sample+1 for the center of the aerosol window */
-    int refl_indx = -99;   /* index of band 1 or first band */
+    int last_center_line;  /* line for the center of the last aerosol window */
+    int last_center_samp;  /* samp for the center of the last aerosol
+                              window */
+#ifndef _OPENMP
     int tmp_percent = 0;  /* current percentage for printing status */
-    int curr_tmp_percent; /* percentage for current line */
+    int curr_tmp_percent; /* percentage for current tile */
+#endif
     int aero_pix11;        /* pixel location for aerosol window values
                               [lcmg][scmg] */
     int aero_pix12;        /* pixel location for aerosol window values
@@ -53,14 +165,18 @@ void aerosol_interp
                               [lcmg2][scmg] */
     int aero_pix22;        /* pixel location for aerosol window values
                               [lcmg2][scmg2] */
+    bool water11, water12, water21, water22;  /* are the aerosol window
+                              pixels flagged as water? */
     float xaero, yaero;    /* x/y location for aerosol pixel within the overall
                               larger aerosol window grid */
-    float pixel_size_x;    /* x pixel size */
-    float pixel_size_y;    /* y pixel size */
     float aero11;          /* aerosol value at window line, samp */
     float aero12;          /* aerosol value at window line, samp+1 */
     float aero21;          /* aerosol value at window line+1, samp */
     float aero22;          /* aerosol value at window line+1, samp+1 */
+    float eps11;           /* eps value at window line, samp */
+    float eps12;           /* eps value at window line, samp+1 */
+    float eps21;           /* eps value at window line+1, samp */
+    float eps22;           /* eps value at window line+1, samp+1 */
     float u, v;            /* line, sample fractional distance from current
                               pixel (weight applied to furthest line, sample) */
     float one_minus_u;     /* 1.0 - u (weight applied to closest line) */
@@ -69,32 +185,24 @@ void aerosol_interp
     float one_minus_u_x_v; /* (1.0 - u) * v */
     float u_x_one_minus_v; /* u * (1.0 - v) */
     float u_x_v;           /* u * v */
-
-    /* Use band 1 band-related metadata for the reflectance information for
-       Landsat (Level 1 products).  If band 1 isn't available then just use the
-       first band in the XML file. */
-    for (i = 0; i < xml_metadata->nbands; i++)
+    Sched_tile_t *tile = NULL;  /* current scheduling tile */
+
+    /* Determine the center of the last aerosol window */
+    last_center_line = (AERO_NWINDOWS (nlines) - 1) * AERO_WINDOW +
+        HALF_AERO_WINDOW;
+    last_center_samp = (AERO_NWINDOWS (nsamps) - 1) * AERO_WINDOW +
+        HALF_AERO_WINDOW;
+
+    /* Interpolate the aerosol and eps data for each pixel location, other
+       than the centers of the aerosol windows */
+#ifdef _OPENMP
+    #pragma omp parallel for schedule (dynamic, 1) private (t, tile, line, samp, curr_pix, center_line, center_line1, center_samp, center_samp1, aero_pix11, aero_pix12, aero_pix21, aero_pix22, water11, water12, water21, water22, xaero, yaero, aero11, aero12, aero21, aero22, eps11, eps12, eps21, eps22, u, v, one_minus_u, one_minus_v, one_minus_u_x_one_minus_v, one_minus_u_x_v, u_x_one_minus_v, u_x_v)
+#endif
+    for (t = 0; t < tiles->ntiles; t++)
     {
-        if (!strcmp (xml_metadata->band[i].name, "b1") &&
-            !strncmp (xml_metadata->band[i].product, "L1", 2))
-        {
-            /* this is the index we'll use for Landsat band info */
-            refl_indx = i;
-        }
-    }
-    if (refl_indx == -99)
-        refl_indx = 0;
-
-    /* Copy the information from the XML file */
-    pixel_size_x = xml_metadata->band[refl_indx].pixel_size[0];
-    pixel_size_y = xml_metadata->band[refl_indx].pixel_size[1];
-
-    /* Interpolate the aerosol data for each pixel location */
-    tmp_percent = 0;
-    for (line = 0; line < nlines; line++)
-    {
-        /* update status */
-        curr_tmp_percent = 100 * line / nlines;
+#ifndef _OPENMP
+        /* update status, but not if multi-threaded */
+        curr_tmp_percent = 100 * t / tiles->ntiles;
         if (curr_tmp_percent > tmp_percent)
         {
             tmp_percent = curr_tmp_percent;
@@ -104,168 +212,248 @@ void aerosol_interp
                 fflush (stdout);
             }
         }
+#endif
 
-        /* Determine the line of the representative center pixel in the
-           aerosol NxN window array */
-        center_line = (int) (line / AERO_WINDOW) * AERO_WINDOW +
-            HALF_AERO_WINDOW;
-
-        /* Determine fractional location of this line in the aerosol window.
-           Negative values are at the top of the window. */
-        yaero = (float) (line - center_line) / AERO_WINDOW;
-        u = yaero - (int) yaero;
-
-        /* Determine if this pixel is closest to the line below or the line
-           above. If the fractional value is in the top part of the aerosol
-           window, then use the line above.  Otherwise use the line below. */
-        if (u < 0.0)
+        tile = &tiles->tile[t];
+        for (line = tile->first_line; line < tile->end_line; line++)
         {
-            center_line1 = center_line - AERO_WINDOW;
-
-            /* If the aerosol window line value is outside the bounds of the
-               scene, then just use the same line in the aerosol window */
-            if (center_line1 < 0)
-                center_line1 = center_line;
-        }
-        else
-        {
-            center_line1 = center_line + AERO_WINDOW;
-
-            /* If the aerosol window line value is outside the bounds of the
-               scene, then just use the same line in the aerosol window */
-            if (center_line1 >= nlines-1)
-                center_line1 = center_line;
-        }
-
-        curr_pix = line * nsamps;
-        for (samp = 0; samp < nsamps; samp++, curr_pix++)
-        {
-            /* If this pixel is fill, then don't process */
-            if (level1_qa_is_fill (qaband[curr_pix]))
-                continue;
-
-            /* If this pixel is cloud or shadow, then don't process. Use
-               median aerosol values.  Flag them separately. */
-            else if (is_cloud (qaband[curr_pix]))
-            {
-                taero[curr_pix] = median_aero;
-                ipflag[curr_pix] = (1 << IPFLAG_CLOUD);
-                continue;
-            }
-            else if (is_shadow (qaband[curr_pix]))
-            {
-                taero[curr_pix] = median_aero;
-                ipflag[curr_pix] = (1 << IPFLAG_SHADOW);
-                continue;
-            }
-
-            /* If this pixel is water, then don't process. Use default aerosol
-               values. */
-            else if (is_water (sband[SR_BAND4][curr_pix],
-                               sband[SR_BAND5][curr_pix]))
-            {
-                taero[curr_pix] = median_aero;
-                ipflag[curr_pix] = (1 << IPFLAG_WATER);
-                continue;
-            }
-
-            /* Determine the sample of the representative center pixel in the
+            /* Determine the line of the representative center pixel in the
                aerosol NxN window array */
-            center_samp = (int) (samp / AERO_WINDOW) * AERO_WINDOW +
-                HALF_AERO_WINDOW;
-
-            /* Determine fractional location of this sample in the aerosol
-               window.  Negative values are at the left of the window. */
-            xaero = (float) (samp - center_samp) / AERO_WINDOW;
-            v = xaero - (int) xaero;
-
-            /* If the current line, sample are the same as the center line,
-               sample, then skip to the next pixel.  We already have the
-               aerosol value. */
-            if (samp == center_samp && line == center_line)
-                continue;
-
-            /* Determine if this pixel is closest to the sample to the left or
-               the sample to the right.  If the fractional value is on the left
-               side of the aerosol window, then use the sample to the left.
-               Otherwise use the sample to the right. */
-            if (v < 0.0)
+            center_line = MIN ((int) (line / AERO_WINDOW) * AERO_WINDOW +
+                HALF_AERO_WINDOW, last_center_line);
+
+            /* Determine fractional location of this line in the aerosol
+               window.  Negative values are at the top of the window. */
+            yaero = (float) (line - center_line) / AERO_WINDOW;
+            u = yaero - (int) yaero;
+
+            /* Determine if this pixel is closest to the line below or the
+               line above. If the fractional value is in the top part of the
+               aerosol window, then use the line above.  Otherwise use the
+               line below. */
+            if (u < 0.0)
             {
-                center_samp1 = center_samp - AERO_WINDOW;
-    
-                /* If the aerosol window sample value is outside the bounds of
-                   the scene, then just use the same sample in the aerosol
+                center_line1 = center_line - AERO_WINDOW;
+
+                /* If the aerosol window line value is outside the bounds of
+                   the scene, then just use the same line in the aerosol
                    window */
-                if (center_samp1 < 0)
-                    center_samp1 = center_samp;
+                if (center_line1 < 0)
+                    center_line1 = center_line;
             }
             else
             {
-                center_samp1 = center_samp + AERO_WINDOW;
-    
-                /* If the aerosol window sample value is outside the bounds of
-                   the scene, then just use the same sample in the aerosol
+                center_line1 = center_line + AERO_WINDOW;
+
+                /* If the aerosol window line value is outside the bounds of
+                   the scene, then just use the same line in the aerosol
                    window */
-                if (center_samp1 >= nsamps-1)
-                    center_samp1 = center_samp;
+                if (center_line1 >= nlines-1)
+                    center_line1 = center_line;
             }
 
-            /* Determine the four aerosol window pixels to be used for
-               interpolating the current pixel */
-            aero_pix11 = center_line * nsamps + center_samp;
-            aero_pix12 = center_line * nsamps + center_samp1;
-            aero_pix21 = center_line1 * nsamps + center_samp;
-            aero_pix22 = center_line1 * nsamps + center_samp1;
-
-            /* Get the aerosol values */
-            aero11 = taero[aero_pix11];
-            aero12 = taero[aero_pix12];
-            aero21 = taero[aero_pix21];
-            aero22 = taero[aero_pix22];
-
-            /* From here make the fractional distance positive, regardless of
-               where it is in the window. */
+            /* From here make the fractional distance positive, regardless
+               of where it is in the window. */
             u = fabs (u);
-            v = fabs (v);
-
-            /* Determine the fractional distance between the integer location
-               and floating point pixel location to be used for interpolation */
-            one_minus_u = 1.0 - u;
-            one_minus_v = 1.0 - v;
-            one_minus_u_x_one_minus_v = one_minus_u * one_minus_v;
-            one_minus_u_x_v = one_minus_u * v;
-            u_x_one_minus_v = u * one_minus_v;
-            u_x_v = u * v;
-
-            /* Interpolate the aerosol */
-            taero[curr_pix] = aero11 * one_minus_u_x_one_minus_v +
-                              aero12 * one_minus_u_x_v +
-                              aero21 * u_x_one_minus_v +
-                              aero22 * u_x_v;
-
-            /* Set the aerosol to window interpolated. Clear anything else. */
-            ipflag[curr_pix] = (1 << IPFLAG_INTERP_WINDOW);
-
-            /* If any of the window pixels used in the interpolation were
-               water pixels, then mask this pixel with water (in addition to
-               the interpolation bit already set) */
-            if (btest (ipflag[aero_pix11], IPFLAG_WATER) ||
-                btest (ipflag[aero_pix12], IPFLAG_WATER) ||
-                btest (ipflag[aero_pix21], IPFLAG_WATER) ||
-                btest (ipflag[aero_pix22], IPFLAG_WATER))
-                ipflag[curr_pix] |= (1 << IPFLAG_WATER);
-        }  /* end for samp */
-    }  /* end for line */
-
-    /* Clean up the ipflag in the center of the NxN windows, for the fill
-       pixels. If an NxN window is a mixture of fill and non-fill, the center
-       of the window can be flagged as fill and some other QA based on the
-       other pixels in that window. At the end, we want fill to be fill. */
-    for (curr_pix = 0; curr_pix < nlines * nsamps; curr_pix++)
+
+            curr_pix = line * nsamps + tile->first_samp;
+            for (samp = tile->first_samp; samp < tile->end_samp;
+                 samp++, curr_pix++)
+            {
+                /* Determine the sample of the representative center pixel in
+                   the aerosol NxN window array */
+                center_samp = MIN ((int) (samp / AERO_WINDOW) * AERO_WINDOW +
+                    HALF_AERO_WINDOW, last_center_samp);
+
+                /* If the current line, sample are the same as the center
+                   line, sample, then skip to the next pixel.  We already have
+                   the aerosol value, and the window centers are cleaned up
+                   once all the other pixels have been interpolated. */
+                if (samp == center_samp && line == center_line)
+                    continue;
+
+                /* If this pixel is fill, then don't process */
+                if (level1_qa_is_fill (qaband[curr_pix]))
+                    continue;
+
+                /* If this pixel is cloud or shadow, then don't process. Use
+                   median aerosol values.  Flag them separately. */
+                else if (is_cloud (qaband[curr_pix]))
+                {
+                    taero[curr_pix] = median_aero;
+                    teps[curr_pix] = DEFAULT_EPS;
+                    ipflag[curr_pix] = (1 << IPFLAG_CLOUD);
+                    continue;
+                }
+                else if (is_shadow (qaband[curr_pix]))
+                {
+                    taero[curr_pix] = median_aero;
+                    teps[curr_pix] = DEFAULT_EPS;
+                    ipflag[curr_pix] = (1 << IPFLAG_SHADOW);
+                    continue;
+                }
+
+                /* If this pixel is water, then don't process. Use default
+                   aerosol values. */
+                else if (is_water (sband[SR_BAND4][curr_pix],
+                                   sband[SR_BAND5][curr_pix]))
+                {
+                    taero[curr_pix] = median_aero;
+                    teps[curr_pix] = DEFAULT_EPS;
+                    ipflag[curr_pix] = (1 << IPFLAG_WATER);
+                    continue;
+                }
+
+                /* Determine fractional location of this sample in the aerosol
+                   window.  Negative values are at the left of the window. */
+                xaero = (float) (samp - center_samp) / AERO_WINDOW;
+                v = xaero - (int) xaero;
+
+                /* Determine if this pixel is closest to the sample to the
+                   left or the sample to the right.  If the fractional value
+                   is on the left side of the aerosol window, then use the
+                   sample to the left.  Otherwise use the sample to the
+                   right. */
+                if (v < 0.0)
+                {
+                    center_samp1 = center_samp - AERO_WINDOW;
+
+                    /* If the aerosol window sample value is outside the
+                       bounds of the scene, then just use the same sample in
+                       the aerosol window */
+                    if (center_samp1 < 0)
+                        center_samp1 = center_samp;
+                }
+                else
+                {
+                    center_samp1 = center_samp + AERO_WINDOW;
+
+                    /* If the aerosol window sample value is outside the
+                       bounds of the scene, then just use the same sample in
+                       the aerosol window */
+                    if (center_samp1 >= nsamps-1)
+                        center_samp1 = center_samp;
+                }
+
+                /* Determine the four aerosol window pixels to be used for
+                   interpolating the current pixel */
+                aero_pix11 = center_line * nsamps + center_samp;
+                aero_pix12 = center_line * nsamps + center_samp1;
+                aero_pix21 = center_line1 * nsamps + center_samp;
+                aero_pix22 = center_line1 * nsamps + center_samp1;
+
+                /* Get the aerosol and eps values */
+                get_window_center (sband, qaband, ipflag, taero, teps,
+                    median_aero, aero_pix11, curr_pix, &aero11, &eps11,
+                    &water11);
+                get_window_center (sband, qaband, ipflag, taero, teps,
+                    median_aero, aero_pix12, curr_pix, &aero12, &eps12,
+                    &water12);
+                get_window_center (sband, qaband, ipflag, taero, teps,
+                    median_aero, aero_pix21, curr_pix, &aero21, &eps21,
+                    &water21);
+                get_window_center (sband, qaband, ipflag, taero, teps,
+                    median_aero, aero_pix22, curr_pix, &aero22, &eps22,
+                    &water22);
+
+                /* From here make the fractional distance positive,
+                   regardless of where it is in the window. */
+                v = fabs (v);
+
+                /* Determine the fractional distance between the integer
+                   location and floating point pixel location to be used for
+                   interpolation */
+                one_minus_u = 1.0 - u;
+                one_minus_v = 1.0 - v;
+                one_minus_u_x_one_minus_v = one_minus_u * one_minus_v;
+                one_minus_u_x_v = one_minus_u * v;
+                u_x_one_minus_v = u * one_minus_v;
+                u_x_v = u * v;
+
+                /* Interpolate the aerosol and eps */
+                taero[curr_pix] = aero11 * one_minus_u_x_one_minus_v +
+                                  aero12 * one_minus_u_x_v +
+                                  aero21 * u_x_one_minus_v +
+                                  aero22 * u_x_v;
+                teps[curr_pix] = eps11 * one_minus_u_x_one_minus_v +
+                                 eps12 * one_minus_u_x_v +
+                                 eps21 * u_x_one_minus_v +
+                                 eps22 * u_x_v;
+
+                /* Set the aerosol to window interpolated. Clear anything
+                   else. */
+                ipflag[curr_pix] = (1 << IPFLAG_INTERP_WINDOW);
+
+                /* If any of the window pixels used in the interpolation were
+                   water pixels, then mask this pixel with water (in addition
+                   to the interpolation bit already set) */
+                if (water11 || water12 || water21 || water22)
+                    ipflag[curr_pix] |= (1 << IPFLAG_WATER);
+            }  /* end for samp */
+        }  /* end for line */
+    }  /* end for t */
+
+    /* Update the centers of the NxN windows.  The windows which failed the
+       aerosol inversion get the median aerosol value, and the centers which
+       are cloud, shadow, or water are flagged and reset, like the other
+       pixels.  Clean up the ipflag for the fill pixels. If an NxN window is a
+       mixture of fill and non-fill, the center of the window can be flagged
+       as fill and some other QA based on the other pixels in that window. At
+       the end, we want fill to be fill. */
+#ifdef _OPENMP
+    #pragma omp parallel for schedule (dynamic, 1) private (t, tile, line, samp, curr_pix)
+#endif
+    for (t = 0; t < tiles->ntiles; t++)
     {
-        if (level1_qa_is_fill (qaband[curr_pix]))
-            ipflag[curr_pix] = (1 << IPFLAG_FILL);
-    }
+        tile = &tiles->tile[t];
+        for (line = tile->first_line; line < tile->end_line; line++)
+        {
+            curr_pix = line * nsamps + tile->first_samp;
+            for (samp = tile->first_samp; samp < tile->end_samp;
+                 samp++, curr_pix++)
+            {
+                /* Fill the window centers which failed the aerosol inversion
+                   with the median aerosol value */
+                if (line % AERO_WINDOW == HALF_AERO_WINDOW &&
+                    samp % AERO_WINDOW == HALF_AERO_WINDOW &&
+                    (btest (ipflag[curr_pix], IPFLAG_CLOUD) ||
+                     btest (ipflag[curr_pix], IPFLAG_SHADOW) ||
+                     btest (ipflag[curr_pix], IPFLAG_WATER)))
+                    taero[curr_pix] = median_aero;
+
+                if (level1_qa_is_fill (qaband[curr_pix]))
+                {
+                    ipflag[curr_pix] = (1 << IPFLAG_FILL);
+                    continue;
+                }
+
+                /* Skip the pixels which aren't window centers */
+                if (line % AERO_WINDOW != HALF_AERO_WINDOW ||
+                    samp % AERO_WINDOW != HALF_AERO_WINDOW)
+                    continue;
+
+                if (is_cloud (qaband[curr_pix]))
+                {
+                    taero[curr_pix] = median_aero;
+                    teps[curr_pix] = DEFAULT_EPS;
+                    ipflag[curr_pix] = (1 << IPFLAG_CLOUD);
+                }
+                else if (is_shadow (qaband[curr_pix]))
+                {
+                    taero[curr_pix] = median_aero;
+                    teps[curr_pix] = DEFAULT_EPS;
+                    ipflag[curr_pix] = (1 << IPFLAG_SHADOW);
+                }
+                else if (is_water (sband[SR_BAND4][curr_pix],
+                                   sband[SR_BAND5][curr_pix]))
+                {
+                    taero[curr_pix] = median_aero;
+                    teps[curr_pix] = DEFAULT_EPS;
+                    ipflag[curr_pix] = (1 << IPFLAG_WATER);
+                }
+            }  /* end for samp */
+        }  /* end for line */
+    }  /* end for t */
 
     /* Update final status */
     printf ("100%%\n");
@@ -273,59 +461,6 @@ void aerosol_interp
 }
 
 
-/******************************************************************************
-MODULE:  aerosol_fill_median
-
-PURPOSE:  Changes the aerosol window values for water, cloud, and shadow to
-be the median aerosol value of the clear pixels.
-
-RETURN VALUE:
-Type = N/A
-
-PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
-at the USGS EROS
-
-NOTES:
-******************************************************************************/
-void aerosol_fill_median
-(
-    uint8 *ipflag,     /* I/O: QA flag to assist with aerosol interpolation,
-                               nlines x nsamps.  It is expected that the ipflag
-                               values are computed for the center of the
-                               aerosol windows. */
-    float *taero,      /* I/O: aerosol values for each pixel, nlines x nsamps
-                          It is expected that the aerosol values are computed
-                          for the center of the aerosol windows.  This routine
-                          will interpolate/average the pixels of the windows
-                          that failed the aerosol inversion (using ipflag) */
-    float median_aero, /* I: median aerosol value of clear pixels */
-    int nlines,        /* I: number of lines in ipflag & taero bands */
-    int nsamps         /* I: number of samps in ipflag & taero bands */
-)
-{
-    int line, samp;       /* looping variable for lines and samples */
-    int curr_pix;         /* current pixel in 1D arrays of nlines * nsamps */
-
-    /* Loop through the center of the NxN window pixels */
-    for (line = HALF_AERO_WINDOW; line < nlines; line += AERO_WINDOW)
-    {
-        curr_pix = line * nsamps + HALF_AERO_WINDOW;
-        for (samp = HALF_AERO_WINDOW; samp < nsamps;
-             samp += AERO_WINDOW, curr_pix += AERO_WINDOW)
-        {
-            /* Find cloud, shadow, and water pixels and reset the default
-               aerosol value to that of the median aerosol value */
-            if (btest (ipflag[curr_pix], IPFLAG_CLOUD) ||
-                btest (ipflag[curr_pix], IPFLAG_SHADOW) ||
-                btest (ipflag[curr_pix], IPFLAG_WATER))
-            {
-                taero[curr_pix] = median_aero;
-            }
-        }
-    }
-}
-
-
 /******************************************************************************
 MODULE:  find_median_aerosol
 
@@ -9,10 +9,9 @@
 #include <stdbool.h>
 #include "lasrc.h"
 
-void aerosol_interp
+void aerosol_fill_interp
 (
-    Espa_internal_meta_t *xml_metadata, /* I: XML metadata information */
-    int16 **sband,     /* I/O: input TOA reflectance */
+    int16 **sband,     /* I: input TOA reflectance */
     uint16 *qaband,    /* I: QA band for the input image, nlines x nsamps */
     uint8 *ipflag,     /* I/O: QA flag to assist with aerosol interpolation,
                                nlines x nsamps.  It is expected that the ipflag
@@ -23,9 +22,16 @@ void aerosol_interp
                           for the center of the aerosol windows.  This routine
                           will fill in the pixels for the remaining, non-center
                           pixels of the window. */
+    float *teps,       /* I/O: angstrom coeff for each pixel, nlines x nsamps
+                          It is expected that the eps values are computed for
+                          the center of the aerosol windows.  This routine
+                          will fill in the pixels for the remaining, non-center
+                          pixels of the window. */
     float median_aero, /* I: median aerosol value of clear pixels */
     int nlines,        /* I: number of lines in qaband & taero bands */
-    int nsamps         /* I: number of samps in qaband & taero bands */
+    int nsamps,        /* I: number of samps in qaband & taero bands */
+    Tile_sched_t *tiles  /* I: scheduling tiles for the scene, with their
+                               costs set */
 );
 
 float find_median_aerosol
@@ -41,20 +47,4 @@ float find_median_aerosol
     int nsamps         /* I: number of samps in taero band */
 );
 
-void aerosol_fill_median
-(
-    uint8 *ipflag,     /* I/O: QA flag to assist with aerosol interpolation,
-                               nlines x nsamps.  It is expected that the ipflag
-                               values are computed for the center of the
-                               aerosol windows. */
-    float *taero,      /* I/O: aerosol values for each pixel, nlines x nsamps
-                          It is expected that the aerosol values are computed
-                          for the center of the aerosol windows.  This routine
-                          will interpolate/average the pixels of the windows
-                          that failed the aerosol inversion (using ipflag) */
-    float median_aero, /* I: median aerosol value of clear pixels */
-    int nlines,        /* I: number of lines in ipflag & taero bands */
-    int nsamps         /* I: number of samps in ipflag & taero bands */
-);
-
 #endif
@@ -0,0 +1,184 @@
+/*****************************************************************************
+FILE: angle_band.c
+
+PURPOSE: Contains functions for reading the per-pixel solar/view angle bands
+on demand.  Each processing stage reads only the angle bands it uses, and
+holds them either at full resolution or as a decimated grid which is
+bilinearly interpolated back to full resolution (see get_angle).
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+LICENSE TYPE:  NASA Open Source Agreement Version 1.3
+
+NOTES:
+  1. The angles vary smoothly across the scene, so a decimated grid
+     reproduces them closely while using 1/decimation^2 of the memory.
+  2. The grid always includes the last line and sample of the band, so the
+     edges of the scene are interpolated rather than extrapolated.
+*****************************************************************************/
+#include "angle_band.h"
+
+/******************************************************************************
+MODULE:  grid_size
+
+PURPOSE:  Returns the number of grid points needed to hold a band dimension at
+the specified decimation, including the last line/sample of the band.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+n               Number of grid points
+
+NOTES:
+******************************************************************************/
+static int grid_size
+(
+    int n,                /* I: number of lines/samples in the band */
+    int decimation        /* I: number of lines/samples between grid points */
+)
+{
+    if (decimation == 1 || n <= 1)
+        return (n);
+    return ((n - 2) / decimation + 2);
+}
+
+
+/******************************************************************************
+MODULE:  angle_band_size
+
+PURPOSE:  Returns the number of bytes of the arena used by an angle band read
+with read_angle_band.
+
+RETURN VALUE:
+Type = size_t
+Value           Description
+-----           -----------
+n               Number of bytes used by the angle band
+
+NOTES:
+******************************************************************************/
+size_t angle_band_size
+(
+    int nlines,           /* I: number of lines in the angle band */
+    int nsamps,           /* I: number of samples in the angle band */
+    int decimation        /* I: number of lines/samples between the grid
+                                points held in memory */
+)
+{
+    return (arena_block_size (sizeof (Angle_band_t)) +
+        arena_block_size ((size_t) grid_size (nlines, decimation) *
+        grid_size (nsamps, decimation) * sizeof (int16)));
+}
+
+
+/******************************************************************************
+MODULE:  read_angle_band
+
+PURPOSE:  Allocates and reads the specified per-pixel angle band, holding
+every Nth line and sample (plus the last line and sample) when decimated.
+
+RETURN VALUE:
+Type = Angle_band_t *
+Value           Description
+-----           -----------
+NULL            Error reading the angle band
+non-NULL        Angle band
+
+NOTES:
+  1. Only the decimated lines are read from the input file.  A single line
+     buffer is used to subsample each of them.
+  2. The angle band is allocated from the arena, and is freed when the arena
+     is released back to a mark taken before reading it.
+******************************************************************************/
+Angle_band_t *read_angle_band
+(
+    Input_t *input,       /* I: input structure for the Landsat product */
+    Arena_t *arena,       /* I/O: arena to allocate the angle band from */
+    Myppa_t ippa,         /* I: angle band to be read */
+    int decimation        /* I: number of lines/samples between the grid
+                                points held in memory; 1 is full
+                                resolution */
+)
+{
+    char FUNC_NAME[] = "read_angle_band";   /* function name */
+    char errmsg[STR_SIZE];    /* error message */
+    int gline, gsamp;         /* looping variables for the grid */
+    int line;                 /* band line for the current grid line */
+    int16 *line_buf = NULL;   /* full resolution line buffer */
+    Angle_band_t *this = NULL;   /* angle band to be returned */
+
+    if (decimation < 1 || decimation > MAX_ANGLE_DECIMATION)
+    {
+        sprintf (errmsg, "Invalid angle decimation: %d.  Must be between 1 "
+            "and %d.", decimation, MAX_ANGLE_DECIMATION);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (NULL);
+    }
+
+    this = arena_alloc (arena, sizeof (Angle_band_t));
+    if (this == NULL)
+    {
+        sprintf (errmsg, "Error allocating memory for the angle band");
+        error_handler (true, FUNC_NAME, errmsg);
+        return (NULL);
+    }
+    this->ippa = ippa;
+    this->nlines = input->size_ppa.nlines;
+    this->nsamps = input->size_ppa.nsamps;
+    this->decimation = decimation;
+    this->grid_nlines = grid_size (this->nlines, decimation);
+    this->grid_nsamps = grid_size (this->nsamps, decimation);
+
+    this->grid = arena_alloc (arena, (size_t) this->grid_nlines *
+        this->grid_nsamps * sizeof (int16));
+    if (this->grid == NULL)
+    {
+        sprintf (errmsg, "Error allocating memory for the angle grid");
+        error_handler (true, FUNC_NAME, errmsg);
+        return (NULL);
+    }
+
+    /* At full resolution, read the whole band directly into the grid */
+    if (decimation == 1)
+    {
+        if (get_input_ppa_lines (input, ippa, 0, this->nlines, this->grid)
+            != SUCCESS)
+        {
+            sprintf (errmsg, "Reading per-pixel angle band %d", ippa);
+            error_handler (true, FUNC_NAME, errmsg);
+            return (NULL);
+        }
+        return (this);
+    }
+
+    /* Otherwise read each of the grid lines and subsample them */
+    line_buf = calloc (this->nsamps, sizeof (int16));
+    if (line_buf == NULL)
+    {
+        sprintf (errmsg, "Error allocating memory for the angle line buffer");
+        error_handler (true, FUNC_NAME, errmsg);
+        return (NULL);
+    }
+
+    for (gline = 0; gline < this->grid_nlines; gline++)
+    {
+        line = MIN (gline * decimation, this->nlines - 1);
+        if (get_input_ppa_lines (input, ippa, line, 1, line_buf) != SUCCESS)
+        {
+            sprintf (errmsg, "Reading line %d of per-pixel angle band %d",
+                line, ippa);
+            error_handler (true, FUNC_NAME, errmsg);
+            free (line_buf);
+            return (NULL);
+        }
+
+        for (gsamp = 0; gsamp < this->grid_nsamps; gsamp++)
+            this->grid[(long) gline * this->grid_nsamps + gsamp] =
+                line_buf[MIN (gsamp * decimation, this->nsamps - 1)];
+    }
+    free (line_buf);
+
+    return (this);
+}
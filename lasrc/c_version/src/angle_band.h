@@ -0,0 +1,104 @@
+#ifndef _ANGLE_BAND_H_
+#define _ANGLE_BAND_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdbool.h>
+#include "common.h"
+#include "input.h"
+#include "arena.h"
+#include "error_handler.h"
+
+/* Define the maximum decimation for the per-pixel angle bands */
+#define MAX_ANGLE_DECIMATION 64
+
+/* Structure for a per-pixel angle band held in memory.  The band is either
+   held at full resolution (decimation of 1) or as a grid of every Nth line
+   and sample, plus the last line and sample, which is bilinearly
+   interpolated to full resolution when it is accessed. */
+typedef struct {
+    Myppa_t ippa;         /* angle band held */
+    int nlines;           /* number of lines in the full resolution band */
+    int nsamps;           /* number of samples in the full resolution band */
+    int decimation;       /* number of lines/samples between grid points */
+    int grid_nlines;      /* number of lines in the grid */
+    int grid_nsamps;      /* number of samples in the grid */
+    int16 *grid;          /* scaled angle values (degrees),
+                             grid_nlines x grid_nsamps */
+} Angle_band_t;
+
+/* Prototypes */
+size_t angle_band_size
+(
+    int nlines,           /* I: number of lines in the angle band */
+    int nsamps,           /* I: number of samples in the angle band */
+    int decimation        /* I: number of lines/samples between the grid
+                                points held in memory */
+);
+
+Angle_band_t *read_angle_band
+(
+    Input_t *input,       /* I: input structure for the Landsat product */
+    Arena_t *arena,       /* I/O: arena to allocate the angle band from */
+    Myppa_t ippa,         /* I: angle band to be read */
+    int decimation        /* I: number of lines/samples between the grid
+                                points held in memory; 1 is full
+                                resolution */
+);
+
+/******************************************************************************
+MODULE:  get_angle
+
+PURPOSE:  Returns the scaled angle value for the specified pixel, bilinearly
+interpolating between the grid points if the band is decimated.
+
+RETURN VALUE:
+Type = int16
+Value           Description
+-----           -----------
+angle           Scaled angle value (degrees) for the pixel
+
+NOTES:
+  1. This is inline since it is called for every pixel.
+******************************************************************************/
+static inline int16 get_angle
+(
+    Angle_band_t *this,   /* I: angle band */
+    int line,             /* I: line of the pixel (0-based) */
+    int samp              /* I: sample of the pixel (0-based) */
+)
+{
+    int gline, gsamp;     /* grid line/sample at or before the pixel */
+    int gline1, gsamp1;   /* grid line/sample after the pixel */
+    float u, v;           /* fractional line/sample distance from the grid
+                             line/sample at or before the pixel */
+    int16 *grid0 = NULL;  /* grid line at or before the pixel */
+    int16 *grid1 = NULL;  /* grid line after the pixel */
+
+    if (this->decimation == 1)
+        return (this->grid[(long) line * this->nsamps + samp]);
+
+    /* Find the surrounding grid points.  The last grid line/sample is the
+       last line/sample of the band, so it may be closer than decimation. */
+    gline = line / this->decimation;
+    gline1 = MIN (gline + 1, this->grid_nlines - 1);
+    u = (float) (line - gline * this->decimation) /
+        MAX (MIN (gline1 * this->decimation, this->nlines - 1) -
+        gline * this->decimation, 1);
+
+    gsamp = samp / this->decimation;
+    gsamp1 = MIN (gsamp + 1, this->grid_nsamps - 1);
+    v = (float) (samp - gsamp * this->decimation) /
+        MAX (MIN (gsamp1 * this->decimation, this->nsamps - 1) -
+        gsamp * this->decimation, 1);
+
+    grid0 = &this->grid[(long) gline * this->grid_nsamps];
+    grid1 = &this->grid[(long) gline1 * this->grid_nsamps];
+    return ((int16) roundf (
+        (1.0 - u) * ((1.0 - v) * grid0[gsamp] + v * grid0[gsamp1]) +
+        u * ((1.0 - v) * grid1[gsamp] + v * grid1[gsamp1])));
+}
+
+#endif
@@ -0,0 +1,297 @@
+/*****************************************************************************
+FILE: arena.c
+
+PURPOSE: Contains functions for the memory arena which holds the per-scene
+arrays.  The footprint of the scene is planned up front (see
+scene_arena_size), a single mapping of that size is made, and the arrays are
+carved out of it as each processing stage starts.  When a stage ends its
+blocks are released back to the mark taken when it started.
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+LICENSE TYPE:  NASA Open Source Agreement Version 1.3
+
+NOTES:
+  1. Each block is rounded up to a whole number of pages, so the pages of a
+     released stage can be returned to the system.
+  2. The mapping is advised to use transparent huge pages where supported,
+     since the arrays are large and accessed sequentially.
+  3. Blocks are always returned zeroed, like calloc.  New pages of the mapping
+     are zero, and released pages read back as zero when they are reused.
+  4. On NUMA machines a page is placed on the node of the thread which first
+     touches it.  When requested, large blocks are first touched as they are
+     allocated by the OpenMP threads, split into rows with the same static
+     partitioning the line loops use, so each thread's lines are held in its
+     local memory (see numa.c).
+*****************************************************************************/
+#include <unistd.h>
+#include <sys/mman.h>
+#include "arena.h"
+
+/******************************************************************************
+MODULE:  first_touch
+
+PURPOSE:  Touches the pages of a block in parallel, each thread touching the
+rows it will process.
+
+RETURN VALUE:
+Type = None
+
+NOTES:
+  1. The block is zeroed, which it already is, so this only places its pages.
+******************************************************************************/
+static void first_touch
+(
+    char *block,          /* I/O: block to be touched */
+    size_t nbytes,        /* I: number of bytes in the block */
+    int nrows             /* I: number of rows to split the block into */
+)
+{
+    int row;              /* looping variable for rows */
+    size_t start, end;    /* start and end of the current row (bytes) */
+
+#ifdef _OPENMP
+    #pragma omp parallel for schedule (static) private (row, start, end)
+#endif
+    for (row = 0; row < nrows; row++)
+    {
+        start = nbytes * row / nrows;
+        end = nbytes * (row + 1) / nrows;
+        memset (block + start, 0, end - start);
+    }
+}
+
+
+/******************************************************************************
+MODULE:  page_size
+
+PURPOSE:  Returns the system page size.
+
+RETURN VALUE:
+Type = size_t
+Value           Description
+-----           -----------
+n               Page size (bytes)
+
+NOTES:
+******************************************************************************/
+static size_t page_size ()
+{
+    static size_t psize = 0;   /* system page size */
+
+    if (psize == 0)
+    {
+        long sys_psize = sysconf (_SC_PAGESIZE);
+        psize = (sys_psize > 0) ? (size_t) sys_psize : 4096;
+    }
+    return (psize);
+}
+
+
+/******************************************************************************
+MODULE:  arena_block_size
+
+PURPOSE:  Returns the number of bytes of the arena used by a block of the
+requested size.
+
+RETURN VALUE:
+Type = size_t
+Value           Description
+-----           -----------
+n               Number of bytes used by the block
+
+NOTES:
+  1. This is used to plan the size of the arena, so it needs to match
+     arena_alloc exactly.
+******************************************************************************/
+size_t arena_block_size
+(
+    size_t nbytes         /* I: number of bytes requested */
+)
+{
+    size_t psize = page_size ();   /* system page size */
+
+    return ((MAX (nbytes, 1) + psize - 1) / psize * psize);
+}
+
+
+/******************************************************************************
+MODULE:  open_arena
+
+PURPOSE:  Maps the memory for an arena of the planned size.
+
+RETURN VALUE:
+Type = Arena_t *
+Value           Description
+-----           -----------
+NULL            Error mapping the arena
+non-NULL        Arena; close it with close_arena
+
+NOTES:
+  1. The pages of the mapping are not committed until they are first used.
+******************************************************************************/
+Arena_t *open_arena
+(
+    size_t size,          /* I: planned size of the arena (bytes) */
+    int touch_rows        /* I: number of rows to first touch the blocks as
+                                in parallel (the lines of the scene); 0 does
+                                not touch the blocks when they are
+                                allocated */
+)
+{
+    char FUNC_NAME[] = "open_arena";   /* function name */
+    char errmsg[STR_SIZE];    /* error message */
+    Arena_t *this = NULL;     /* arena to be returned */
+
+    this = calloc (1, sizeof (Arena_t));
+    if (this == NULL)
+    {
+        sprintf (errmsg, "Error allocating memory for the arena");
+        error_handler (true, FUNC_NAME, errmsg);
+        return (NULL);
+    }
+    this->size = arena_block_size (size);
+    this->touch_rows = touch_rows;
+
+    this->base = mmap (NULL, this->size, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (this->base == MAP_FAILED)
+    {
+        sprintf (errmsg, "Error mapping %.1f MB for the arena",
+            this->size / (1024.0 * 1024.0));
+        error_handler (true, FUNC_NAME, errmsg);
+        free (this);
+        return (NULL);
+    }
+
+#ifdef MADV_HUGEPAGE
+    /* This is only advice, so it isn't an error if it is not supported */
+    madvise (this->base, this->size, MADV_HUGEPAGE);
+#endif
+
+    return (this);
+}
+
+
+/******************************************************************************
+MODULE:  arena_alloc
+
+PURPOSE:  Allocates a zeroed block from the arena.
+
+RETURN VALUE:
+Type = void *
+Value           Description
+-----           -----------
+NULL            The block does not fit in the planned size of the arena
+non-NULL        Block of at least nbytes
+
+NOTES:
+  1. A block which doesn't fit means the plan for the arena doesn't match the
+     allocations made from it, which is reported as an error.
+******************************************************************************/
+void *arena_alloc
+(
+    Arena_t *this,        /* I/O: arena to allocate from */
+    size_t nbytes         /* I: number of bytes to allocate */
+)
+{
+    char FUNC_NAME[] = "arena_alloc";   /* function name */
+    char errmsg[STR_SIZE];    /* error message */
+    size_t block_size = arena_block_size (nbytes);  /* size of the block */
+    void *block = NULL;       /* block to be returned */
+
+    if (block_size > this->size - this->offset)
+    {
+        sprintf (errmsg, "Allocating %zu bytes exceeds the planned arena "
+            "size of %zu bytes (%zu bytes in use)", nbytes, this->size,
+            this->offset);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (NULL);
+    }
+
+    block = this->base + this->offset;
+    this->offset += block_size;
+    if (this->offset > this->peak)
+        this->peak = this->offset;
+
+    if (this->touch_rows > 0 && nbytes >= FIRST_TOUCH_MIN_BYTES)
+        first_touch (block, nbytes, this->touch_rows);
+
+    return (block);
+}
+
+
+/******************************************************************************
+MODULE:  arena_mark
+
+PURPOSE:  Returns a mark for the blocks currently allocated from the arena,
+for releasing the blocks allocated after it with arena_release.
+
+RETURN VALUE:
+Type = size_t
+Value           Description
+-----           -----------
+mark            Current offset of the arena
+
+NOTES:
+******************************************************************************/
+size_t arena_mark
+(
+    Arena_t *this         /* I: arena */
+)
+{
+    return (this->offset);
+}
+
+
+/******************************************************************************
+MODULE:  arena_release
+
+PURPOSE:  Releases the blocks allocated from the arena after the mark, and
+returns their pages to the system.
+
+RETURN VALUE:
+Type = None
+
+NOTES:
+  1. If the pages can't be returned to the system, they are zeroed instead so
+     the blocks allocated from them later are still zeroed.
+******************************************************************************/
+void arena_release
+(
+    Arena_t *this,        /* I/O: arena to release the blocks from */
+    size_t mark           /* I: mark returned by arena_mark before the blocks
+                                were allocated */
+)
+{
+    if (mark >= this->offset)
+        return;
+
+    if (madvise (this->base + mark, this->offset - mark, MADV_DONTNEED) != 0)
+        memset (this->base + mark, 0, this->offset - mark);
+    this->offset = mark;
+}
+
+
+/******************************************************************************
+MODULE:  close_arena
+
+PURPOSE:  Unmaps the arena and frees the arena structure.
+
+RETURN VALUE:
+Type = None
+
+NOTES:
+******************************************************************************/
+void close_arena
+(
+    Arena_t *this         /* I: arena to be closed */
+)
+{
+    if (this == NULL)
+        return;
+
+    munmap (this->base, this->size);
+    free (this);
+}
@@ -0,0 +1,66 @@
+#ifndef _ARENA_H_
+#define _ARENA_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "common.h"
+#include "error_handler.h"
+
+/* Define the minimum size of a block which is first touched in parallel */
+#define FIRST_TOUCH_MIN_BYTES (1024 * 1024)
+
+/* Structure for the memory arena holding the per-scene arrays.  The arena is
+   a single mapping sized from the planned footprint of the scene.  Blocks are
+   allocated from it in order and released in stages back to a mark, which
+   returns their pages to the system so the next stage can reuse them. */
+typedef struct {
+    char *base;           /* start of the mapping */
+    size_t size;          /* planned size of the mapping (bytes) */
+    size_t offset;        /* offset of the next block to be allocated */
+    size_t peak;          /* largest offset reached (bytes) */
+    int touch_rows;       /* number of rows to first touch the blocks as in
+                             parallel; 0 leaves the pages to be placed when
+                             they are first used */
+} Arena_t;
+
+/* Prototypes */
+size_t arena_block_size
+(
+    size_t nbytes         /* I: number of bytes requested */
+);
+
+Arena_t *open_arena
+(
+    size_t size,          /* I: planned size of the arena (bytes) */
+    int touch_rows        /* I: number of rows to first touch the blocks as
+                                in parallel (the lines of the scene); 0 does
+                                not touch the blocks when they are
+                                allocated */
+);
+
+void *arena_alloc
+(
+    Arena_t *this,        /* I/O: arena to allocate from */
+    size_t nbytes         /* I: number of bytes to allocate */
+);
+
+size_t arena_mark
+(
+    Arena_t *this         /* I: arena */
+);
+
+void arena_release
+(
+    Arena_t *this,        /* I/O: arena to release the blocks from */
+    size_t mark           /* I: mark returned by arena_mark before the blocks
+                                were allocated */
+);
+
+void close_arena
+(
+    Arena_t *this         /* I: arena to be closed */
+);
+
+#endif
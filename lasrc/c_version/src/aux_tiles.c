@@ -0,0 +1,280 @@
+/*****************************************************************************
+FILE: aux_tiles.c
+
+PURPOSE: Contains functions for reading the daily ozone and water vapor from
+the tiled auxiliary file, reading only the tiles covering the scenes being
+processed.
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+LICENSE TYPE:  NASA Open Source Agreement Version 1.3
+
+NOTES:
+  1. The tiled auxiliary file is written by combine_l8_aux_data --tiled, with
+     the same name as the HDF fused file other than the extension (see
+     AUX_TILES_EXTENSION).  The grid is split into 10x10 degree tiles, which
+     are compressed independently.  A scene covers at most a few tiles, so
+     only a small fraction of the daily grid is read and decompressed for it,
+     rather than the full global wv and oz SDSs.
+  2. The tiles are read into the full CMG_NBLAT x CMG_NBLON grids, so the
+     CMG cells are indexed the same way as for the grids read from the HDF
+     file.  The cells of the tiles which haven't been read are not set, and
+     the pages of the grids they fall in are never touched.
+  3. The tiles are read with pread, so a file opened by the batch or spool
+     parent can be read by the scene processes it forks.
+*****************************************************************************/
+#include <unistd.h>
+#include <fcntl.h>
+#include "aux_tiles.h"
+
+/******************************************************************************
+MODULE:  open_aux_tiles
+
+PURPOSE:  Opens a tiled auxiliary file for reading and reads the header and
+tile index.  No tiles are read.
+
+RETURN VALUE:
+Type = Aux_tiles_t *
+Value           Description
+-----           -----------
+NULL            Error opening or reading the tiled auxiliary file
+non-NULL        Pointer to the tiled auxiliary file structure
+
+NOTES:
+  1. The grid must be the size of the CMG grid.
+******************************************************************************/
+Aux_tiles_t *open_aux_tiles
+(
+    char *file_name     /* I: name of the tiled auxiliary file to be read */
+)
+{
+    char FUNC_NAME[] = "open_aux_tiles";   /* function name */
+    char errmsg[STR_SIZE];    /* error message */
+    int ntiles;               /* total number of tiles */
+    size_t index_size;        /* size of the tile index (bytes) */
+    Aux_tiles_t *this = NULL; /* tiled auxiliary file to be returned */
+
+    this = calloc (1, sizeof (Aux_tiles_t));
+    if (this == NULL)
+    {
+        sprintf (errmsg, "Error allocating memory for the tiled auxiliary "
+            "file");
+        error_handler (true, FUNC_NAME, errmsg);
+        return (NULL);
+    }
+    strncpy (this->file_name, file_name, STR_SIZE - 1);
+
+    this->fd = open (file_name, O_RDONLY);
+    if (this->fd == -1)
+    {
+        sprintf (errmsg, "Unable to open the tiled auxiliary file: %s",
+            file_name);
+        error_handler (true, FUNC_NAME, errmsg);
+        free (this);
+        return (NULL);
+    }
+
+    /* Read and validate the header */
+    if (pread (this->fd, &this->hdr, sizeof (Aux_tiles_header_t), 0) !=
+        sizeof (Aux_tiles_header_t) ||
+        memcmp (this->hdr.magic, AUX_TILES_MAGIC, AUX_TILES_MAGIC_LEN) ||
+        this->hdr.nlines != CMG_NBLAT || this->hdr.nsamps != CMG_NBLON ||
+        this->hdr.cell_size != AUX_CELL_SIZE || this->hdr.tile_size < 1 ||
+        this->hdr.ntile_lines != (CMG_NBLAT + this->hdr.tile_size - 1) /
+            this->hdr.tile_size ||
+        this->hdr.ntile_samps != (CMG_NBLON + this->hdr.tile_size - 1) /
+            this->hdr.tile_size)
+    {
+        sprintf (errmsg, "Invalid tiled auxiliary file header: %s",
+            file_name);
+        error_handler (true, FUNC_NAME, errmsg);
+        close_aux_tiles (this);
+        return (NULL);
+    }
+
+    /* Read the tile index */
+    ntiles = this->hdr.ntile_lines * this->hdr.ntile_samps;
+    index_size = ntiles * sizeof (Aux_tiles_index_t);
+    this->index = malloc (index_size);
+    this->loaded = calloc (ntiles, sizeof (bool));
+    if (this->index == NULL || this->loaded == NULL)
+    {
+        sprintf (errmsg, "Error allocating memory for the auxiliary tile "
+            "index");
+        error_handler (true, FUNC_NAME, errmsg);
+        close_aux_tiles (this);
+        return (NULL);
+    }
+
+    if (pread (this->fd, this->index, index_size,
+        sizeof (Aux_tiles_header_t)) != (ssize_t) index_size)
+    {
+        sprintf (errmsg, "Error reading the auxiliary tile index: %s",
+            file_name);
+        error_handler (true, FUNC_NAME, errmsg);
+        close_aux_tiles (this);
+        return (NULL);
+    }
+
+    return (this);
+}
+
+
+/******************************************************************************
+MODULE:  read_aux_tiles
+
+PURPOSE:  Reads the tiles covering the specified window of the CMG grid into
+the water vapor and ozone grids.  Tiles which have already been read are
+skipped.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error reading or decompressing a tile
+SUCCESS         Successful completion
+
+NOTES:
+  1. The window is clipped to the grid.  The caller handles the wrap around
+     the dateline and the poles.
+******************************************************************************/
+int read_aux_tiles
+(
+    Aux_tiles_t *this,  /* I/O: tiled auxiliary file */
+    int first_line,     /* I: first CMG line needed */
+    int end_line,       /* I: CMG line after the last line needed */
+    int first_samp,     /* I: first CMG sample needed */
+    int end_samp,       /* I: CMG sample after the last sample needed */
+    uint16 *wv,         /* I/O: water vapor values [CMG_NBLAT x CMG_NBLON] */
+    uint8 *oz           /* I/O: ozone values [CMG_NBLAT x CMG_NBLON] */
+)
+{
+    char FUNC_NAME[] = "read_aux_tiles";   /* function name */
+    char errmsg[STR_SIZE];    /* error message */
+    int tile_size = this->hdr.tile_size;   /* lines/samples in a full tile */
+    int tline, tsamp;         /* looping variables for the tiles */
+    int itile;                /* current tile in the index */
+    int line, samp;           /* looping variables in the grid */
+    int tile_first_line, tile_end_line;    /* lines covered by the tile */
+    int tile_first_samp, tile_end_samp;    /* samples covered by the tile */
+    long pix;                 /* current cell in the grid */
+    uLongf usize;             /* uncompressed size of the tile */
+    unsigned char *cbuf = NULL;    /* compressed tile */
+    unsigned char *ubuf = NULL;    /* uncompressed tile */
+    unsigned char *cell = NULL;    /* current cell in the tile */
+
+    first_line = MAX (first_line, 0);
+    end_line = MIN (end_line, CMG_NBLAT);
+    first_samp = MAX (first_samp, 0);
+    end_samp = MIN (end_samp, CMG_NBLON);
+    if (first_line >= end_line || first_samp >= end_samp)
+        return (SUCCESS);
+
+    for (tline = first_line / tile_size; tline * tile_size < end_line;
+         tline++)
+    {
+        tile_first_line = tline * tile_size;
+        tile_end_line = MIN (tile_first_line + tile_size, CMG_NBLAT);
+        for (tsamp = first_samp / tile_size; tsamp * tile_size < end_samp;
+             tsamp++)
+        {
+            itile = tline * this->hdr.ntile_samps + tsamp;
+            if (this->loaded[itile])
+                continue;
+            tile_first_samp = tsamp * tile_size;
+            tile_end_samp = MIN (tile_first_samp + tile_size, CMG_NBLON);
+
+            /* Allocate the tile buffers the first time a tile is read */
+            if (ubuf == NULL)
+            {
+                ubuf = malloc ((size_t) tile_size * tile_size *
+                    AUX_CELL_SIZE);
+                if (ubuf == NULL)
+                {
+                    sprintf (errmsg, "Error allocating memory for the "
+                        "auxiliary tile");
+                    error_handler (true, FUNC_NAME, errmsg);
+                    return (ERROR);
+                }
+            }
+
+            usize = (uLongf) (tile_end_line - tile_first_line) *
+                (tile_end_samp - tile_first_samp) * AUX_CELL_SIZE;
+            if (this->index[itile].usize != usize ||
+                this->index[itile].csize < 1)
+            {
+                sprintf (errmsg, "Invalid index entry for tile %d of %s",
+                    itile, this->file_name);
+                error_handler (true, FUNC_NAME, errmsg);
+                free (cbuf);
+                free (ubuf);
+                return (ERROR);
+            }
+
+            /* Read and decompress the tile */
+            free (cbuf);
+            cbuf = malloc (this->index[itile].csize);
+            if (cbuf == NULL ||
+                pread (this->fd, cbuf, this->index[itile].csize,
+                this->index[itile].offset) != this->index[itile].csize ||
+                uncompress (ubuf, &usize, cbuf, this->index[itile].csize) !=
+                Z_OK || usize != this->index[itile].usize)
+            {
+                sprintf (errmsg, "Error reading tile %d of %s", itile,
+                    this->file_name);
+                error_handler (true, FUNC_NAME, errmsg);
+                free (cbuf);
+                free (ubuf);
+                return (ERROR);
+            }
+
+            /* Copy the cells of the tile into the grids */
+            cell = ubuf;
+            for (line = tile_first_line; line < tile_end_line; line++)
+            {
+                pix = (long) line * CMG_NBLON + tile_first_samp;
+                for (samp = tile_first_samp; samp < tile_end_samp;
+                     samp++, pix++)
+                {
+                    memcpy (&wv[pix], cell, sizeof (uint16));
+                    oz[pix] = cell[sizeof (uint16)];
+                    cell += AUX_CELL_SIZE;
+                }
+            }
+
+            this->loaded[itile] = true;
+            this->nloaded++;
+        }
+    }
+
+    free (cbuf);
+    free (ubuf);
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  close_aux_tiles
+
+PURPOSE:  Closes the tiled auxiliary file and frees the structure.
+
+RETURN VALUE:
+Type = None
+
+NOTES:
+******************************************************************************/
+void close_aux_tiles
+(
+    Aux_tiles_t *this   /* I: tiled auxiliary file to close and free */
+)
+{
+    if (this == NULL)
+        return;
+
+    if (this->fd != -1)
+        close (this->fd);
+    free (this->index);
+    free (this->loaded);
+    free (this);
+}
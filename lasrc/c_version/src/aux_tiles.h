@@ -0,0 +1,57 @@
+#ifndef _AUX_TILES_H_
+#define _AUX_TILES_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include "zlib.h"
+#include "common.h"
+#include "error_handler.h"
+#include "aux_tiles_format.h"
+
+/* Define the number of CMG cells added around the CMG cells covered by the
+   scene edges when reading the tiles for a scene.  This covers the cells
+   used for the bilinear interpolation and the rounding at the scene
+   center. */
+#define AUX_WINDOW_MARGIN 2
+
+/* Define the number of points mapped along each edge of the scene to find
+   the CMG cells covered by the scene */
+#define AUX_EDGE_NPOINTS 32
+
+/* Structure for reading a tiled auxiliary file */
+typedef struct {
+    char file_name[STR_SIZE]; /* name of the tiled auxiliary file */
+    int fd;                   /* file descriptor of the tiled file */
+    Aux_tiles_header_t hdr;   /* file header */
+    Aux_tiles_index_t *index; /* tile index, ntile_lines x ntile_samps */
+    bool *loaded;             /* has each tile been read into the grid?
+                                 ntile_lines x ntile_samps */
+    int nloaded;              /* number of tiles read into the grid */
+} Aux_tiles_t;
+
+/* Prototypes */
+Aux_tiles_t *open_aux_tiles
+(
+    char *file_name     /* I: name of the tiled auxiliary file to be read */
+);
+
+int read_aux_tiles
+(
+    Aux_tiles_t *this,  /* I/O: tiled auxiliary file */
+    int first_line,     /* I: first CMG line needed */
+    int end_line,       /* I: CMG line after the last line needed */
+    int first_samp,     /* I: first CMG sample needed */
+    int end_samp,       /* I: CMG sample after the last sample needed */
+    uint16 *wv,         /* I/O: water vapor values [CMG_NBLAT x CMG_NBLON] */
+    uint8 *oz           /* I/O: ozone values [CMG_NBLAT x CMG_NBLON] */
+);
+
+void close_aux_tiles
+(
+    Aux_tiles_t *this   /* I: tiled auxiliary file to close and free */
+);
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef _AUX_TILES_FORMAT_H_
+#define _AUX_TILES_FORMAT_H_
+
+#include <stdint.h>
+
+/* Defines for the tiled auxiliary file written by combine_l8_aux_data
+   --tiled (lasrc/landsat_aux/src) and read by lasrc.  The file consists of
+   the header, followed by the tile index (one entry per tile, in row-major
+   tile order), followed by the compressed tiles.  Each tile holds the cells
+   of the tile in line order, with the water vapor (uint16) and ozone (uint8)
+   of each cell stored together.  All values are in the native byte order of
+   the machine writing the file.
+
+   NOTE: This is the only definition of the file format.  The writer and the
+   reader both include it, so it must not be copied. */
+#define AUX_TILES_MAGIC "LSRAUXT1"  /* 8-character file signature */
+#define AUX_TILES_MAGIC_LEN 8
+#define AUX_TILES_EXTENSION ".aux_tiles"  /* replaces .hdf_fused */
+#define AUX_CELL_SIZE 3             /* bytes per cell, wv and oz */
+
+/* Structure for the tiled auxiliary file header */
+typedef struct {
+    char magic[AUX_TILES_MAGIC_LEN];  /* file signature, AUX_TILES_MAGIC */
+    int32_t nlines;           /* number of lines in the grid */
+    int32_t nsamps;           /* number of samples in the grid */
+    int32_t tile_size;        /* number of lines and samples in a full tile */
+    int32_t ntile_lines;      /* number of tiles in the line direction */
+    int32_t ntile_samps;      /* number of tiles in the sample direction */
+    int32_t cell_size;        /* number of bytes per cell, AUX_CELL_SIZE */
+    int32_t level;            /* zlib compression level used */
+    int32_t spare;            /* unused; keeps the header 8-byte aligned */
+} Aux_tiles_header_t;
+
+/* Structure for a single tile index entry */
+typedef struct {
+    int64_t offset;           /* byte offset of the compressed tile */
+    int32_t csize;            /* compressed size of the tile in bytes */
+    int32_t usize;            /* uncompressed size of the tile in bytes */
+} Aux_tiles_index_t;
+
+#endif
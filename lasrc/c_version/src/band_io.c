@@ -0,0 +1,764 @@
+/*****************************************************************************
+FILE: band_io.c
+
+PURPOSE: Contains functions for overlapping the band I/O with the processing.
+The prefetcher reads the upcoming input bands on a background thread while the
+current band is being calibrated, and the write-behind engine writes completed
+output bands (and their ENVI headers) on a background thread while the
+remaining processing continues.  The band metadata is gathered by the
+write-behind engine and appended to the XML file in a single update.
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+LICENSE TYPE:  NASA Open Source Agreement Version 1.3
+
+NOTES:
+  1. The input and output bands each have their own file pointer, therefore
+     reading/writing one band in the background while the main thread works
+     with another band does not require any locking of the file pointers.
+*****************************************************************************/
+#include "band_io.h"
+
+/******************************************************************************
+MODULE:  prefetch_thread
+
+PURPOSE:  Reader thread for the prefetcher.  Reads the requested bands in
+order, waiting for a buffer slot to be released before reading into it.
+
+RETURN VALUE:
+Type = void *
+Value           Description
+-----           -----------
+NULL            Always; the status is returned in the prefetch structure
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+NOTES:
+******************************************************************************/
+static void *prefetch_thread
+(
+    void *arg             /* I: prefetch structure */
+)
+{
+    Prefetch_t *this = (Prefetch_t *) arg;  /* prefetch structure */
+    int ireq;             /* current read request */
+    int retval;           /* return status of the band read */
+    uint16 *buf;          /* buffer slot for the current request */
+
+    for (ireq = 0; ireq < this->nreads; ireq++)
+    {
+        /* Wait for the buffer slot to be released by the consumer */
+        pthread_mutex_lock (&this->mutex);
+        while (!this->abort && ireq - this->nreleased >= this->depth)
+            pthread_cond_wait (&this->cond, &this->mutex);
+        if (this->abort)
+        {
+            pthread_mutex_unlock (&this->mutex);
+            break;
+        }
+        pthread_mutex_unlock (&this->mutex);
+
+        /* Read the band into its buffer slot */
+        buf = this->buf[ireq % this->depth];
+        if (this->reads[ireq].thermal)
+            retval = get_input_th_lines (this->input, this->reads[ireq].iband,
+                0, this->nlines, buf);
+        else
+            retval = get_input_refl_lines (this->input,
+                this->reads[ireq].iband, 0, this->nlines, buf);
+
+        /* Let the consumer know the band is available */
+        pthread_mutex_lock (&this->mutex);
+        if (retval != SUCCESS)
+        {
+            this->status = ERROR;
+            pthread_cond_broadcast (&this->cond);
+            pthread_mutex_unlock (&this->mutex);
+            break;
+        }
+        this->nloaded = ireq + 1;
+        pthread_cond_broadcast (&this->cond);
+        pthread_mutex_unlock (&this->mutex);
+    }
+
+    return (NULL);
+}
+
+
+/******************************************************************************
+MODULE:  open_prefetch
+
+PURPOSE:  Allocates the band buffers and starts the reader thread for the
+specified list of band read requests.
+
+RETURN VALUE:
+Type = Prefetch_t *
+Value           Description
+-----           -----------
+NULL            Error allocating memory or starting the reader thread
+non-NULL        Pointer to the prefetch structure
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+NOTES:
+  1. The depth is clamped to the range 1 .. nreads.  A depth of 1 still reads
+     in the background, but the next band isn't read until the current band
+     has been released.
+  2. The band buffers are allocated from the arena for the scene, so they
+     are placed like the other scene arrays.  They are freed when the arena
+     is released back to a mark taken before calling this routine.
+******************************************************************************/
+Prefetch_t *open_prefetch
+(
+    Input_t *input,       /* I: input structure for the Landsat product */
+    int nreads,           /* I: number of band read requests */
+    Band_read_t *reads,   /* I: band read requests, in consumption order */
+    int depth,            /* I: number of band buffers to keep in flight */
+    int nlines,           /* I: number of lines in each band */
+    int nsamps,           /* I: number of samples in each band */
+    Arena_t *arena        /* I/O: arena to allocate the band buffers from */
+)
+{
+    char FUNC_NAME[] = "open_prefetch";   /* function name */
+    char errmsg[STR_SIZE];    /* error message */
+    int i;                    /* looping variable for the buffers */
+    Prefetch_t *this = NULL;  /* prefetch structure to be returned */
+
+    if (nreads < 1 || nreads > NBAND_TTL_MAX)
+    {
+        sprintf (errmsg, "Invalid number of band read requests: %d", nreads);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (NULL);
+    }
+
+    /* Clamp the depth to the number of requests */
+    if (depth < 1)
+        depth = 1;
+    if (depth > nreads)
+        depth = nreads;
+
+    /* Allocate the prefetch structure and the band buffers */
+    this = calloc (1, sizeof (Prefetch_t));
+    if (this == NULL)
+    {
+        sprintf (errmsg, "Error allocating memory for the prefetch structure");
+        error_handler (true, FUNC_NAME, errmsg);
+        return (NULL);
+    }
+
+    this->buf = calloc (depth, sizeof (uint16 *));
+    if (this->buf == NULL)
+    {
+        sprintf (errmsg, "Error allocating memory for the prefetch buffers");
+        error_handler (true, FUNC_NAME, errmsg);
+        free (this);
+        return (NULL);
+    }
+
+    for (i = 0; i < depth; i++)
+    {
+        this->buf[i] = arena_alloc (arena, (size_t) nlines * nsamps *
+            sizeof (uint16));
+        if (this->buf[i] == NULL)
+        {
+            sprintf (errmsg, "Error allocating memory for prefetch buffer %d",
+                i);
+            error_handler (true, FUNC_NAME, errmsg);
+            free (this->buf);
+            free (this);
+            return (NULL);
+        }
+    }
+
+    this->input = input;
+    this->nlines = nlines;
+    this->nsamps = nsamps;
+    this->nreads = nreads;
+    memcpy (this->reads, reads, nreads * sizeof (Band_read_t));
+    this->depth = depth;
+    this->nloaded = 0;
+    this->nreleased = 0;
+    this->abort = false;
+    this->status = SUCCESS;
+    pthread_mutex_init (&this->mutex, NULL);
+    pthread_cond_init (&this->cond, NULL);
+
+    /* Start the reader thread */
+    if (pthread_create (&this->thread, NULL, prefetch_thread, this) != 0)
+    {
+        sprintf (errmsg, "Error starting the prefetch reader thread");
+        error_handler (true, FUNC_NAME, errmsg);
+        pthread_mutex_destroy (&this->mutex);
+        pthread_cond_destroy (&this->cond);
+        free (this->buf);
+        free (this);
+        return (NULL);
+    }
+
+    return (this);
+}
+
+
+/******************************************************************************
+MODULE:  get_prefetch_band
+
+PURPOSE:  Waits for the specified read request to be completed and returns the
+buffer holding the band data.
+
+RETURN VALUE:
+Type = uint16 *
+Value           Description
+-----           -----------
+NULL            Error reading the band or invalid request
+non-NULL        Buffer containing the band, nlines x nsamps
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+NOTES:
+  1. The requests must be obtained in order, and each request must be released
+     via release_prefetch_band before request + depth can be obtained.
+******************************************************************************/
+uint16 *get_prefetch_band
+(
+    Prefetch_t *this,     /* I: prefetch structure */
+    int ireq              /* I: read request to obtain (0-based) */
+)
+{
+    char FUNC_NAME[] = "get_prefetch_band";   /* function name */
+    char errmsg[STR_SIZE];    /* error message */
+    int status;               /* status of the reader thread */
+
+    if (ireq < 0 || ireq >= this->nreads)
+    {
+        sprintf (errmsg, "Invalid band read request: %d", ireq);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (NULL);
+    }
+
+    pthread_mutex_lock (&this->mutex);
+    while (this->status == SUCCESS && this->nloaded <= ireq)
+        pthread_cond_wait (&this->cond, &this->mutex);
+    status = this->status;
+    pthread_mutex_unlock (&this->mutex);
+
+    if (status != SUCCESS)
+    {
+        sprintf (errmsg, "Error reading band for request %d", ireq);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (NULL);
+    }
+
+    return (this->buf[ireq % this->depth]);
+}
+
+
+/******************************************************************************
+MODULE:  release_prefetch_band
+
+PURPOSE:  Releases the buffer slot of the specified read request so the reader
+thread can reuse it for a later request.
+
+RETURN VALUE:
+Type = N/A
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+NOTES:
+******************************************************************************/
+void release_prefetch_band
+(
+    Prefetch_t *this,     /* I: prefetch structure */
+    int ireq              /* I: read request that is no longer needed */
+)
+{
+    pthread_mutex_lock (&this->mutex);
+    if (ireq + 1 > this->nreleased)
+        this->nreleased = ireq + 1;
+    pthread_cond_broadcast (&this->cond);
+    pthread_mutex_unlock (&this->mutex);
+}
+
+
+/******************************************************************************
+MODULE:  close_prefetch
+
+PURPOSE:  Stops the reader thread and frees the prefetch structure.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           The reader thread encountered an error
+SUCCESS         No errors encountered
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+NOTES:
+  1. The band buffers belong to the arena they were allocated from.
+******************************************************************************/
+int close_prefetch
+(
+    Prefetch_t *this      /* I: prefetch structure to stop and free */
+)
+{
+    int status;           /* status of the reader thread */
+
+    if (this == NULL)
+        return (SUCCESS);
+
+    /* Stop the reader thread if it is still waiting on a buffer slot */
+    pthread_mutex_lock (&this->mutex);
+    this->abort = true;
+    pthread_cond_broadcast (&this->cond);
+    pthread_mutex_unlock (&this->mutex);
+    pthread_join (this->thread, NULL);
+
+    status = this->status;
+    pthread_mutex_destroy (&this->mutex);
+    pthread_cond_destroy (&this->cond);
+    free (this->buf);
+    free (this);
+
+    return (status);
+}
+
+
+/******************************************************************************
+MODULE:  copy_band_metadata
+
+PURPOSE:  Copies the band metadata, including the bitmap descriptions, so the
+copy remains valid after the output structure has been freed.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error allocating the bitmap descriptions
+SUCCESS         No errors encountered
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+NOTES:
+******************************************************************************/
+static int copy_band_metadata
+(
+    Espa_band_meta_t *in_meta,   /* I: band metadata to be copied */
+    Espa_band_meta_t *out_meta   /* O: copy of the band metadata */
+)
+{
+    char FUNC_NAME[] = "copy_band_metadata";   /* function name */
+    char errmsg[STR_SIZE];    /* error message */
+    int b;                    /* looping variable for the bits */
+
+    memcpy (out_meta, in_meta, sizeof (Espa_band_meta_t));
+    out_meta->bitmap_description = NULL;
+    if (in_meta->nbits > 0 && in_meta->bitmap_description != NULL)
+    {
+        if (allocate_bitmap_metadata (out_meta, in_meta->nbits) != SUCCESS)
+        {
+            sprintf (errmsg, "Allocating bitmap for band %s", in_meta->name);
+            error_handler (true, FUNC_NAME, errmsg);
+            return (ERROR);
+        }
+        for (b = 0; b < in_meta->nbits; b++)
+            strcpy (out_meta->bitmap_description[b],
+                in_meta->bitmap_description[b]);
+    }
+
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  write_band_and_header
+
+PURPOSE:  Writes a whole band to the output file along with its ENVI header.
+The ENVI header is only written for the raw binary output format.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error writing the band or the ENVI header
+SUCCESS         No errors encountered
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+NOTES:
+******************************************************************************/
+static int write_band_and_header
+(
+    Band_write_t *job,            /* I: band write request */
+    Espa_global_meta_t *global    /* I: global metadata for the ENVI header */
+)
+{
+    char FUNC_NAME[] = "write_band_and_header";   /* function name */
+    char errmsg[STR_SIZE];        /* error message */
+    char envi_file[STR_SIZE];     /* ENVI filename */
+    char *cptr = NULL;            /* pointer to the file extension */
+    Envi_header_t envi_hdr;       /* output ENVI header information */
+    Espa_band_meta_t *bmeta = &job->output->metadata.band[job->iband];
+                                  /* metadata for the band being written */
+
+    if (put_output_lines (job->output, job->buf, job->iband, 0,
+        job->output->nlines, job->nbytes) != SUCCESS)
+    {
+        sprintf (errmsg, "Writing output data for %s", bmeta->file_name);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    /* Tiled bands can't be described by an ENVI header */
+    if (job->output->format == FORMAT_TILED)
+        return (SUCCESS);
+
+    /* Create the ENVI header file this band */
+    if (create_envi_struct (bmeta, global, &envi_hdr) != SUCCESS)
+    {
+        sprintf (errmsg, "Creating ENVI header structure.");
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    /* Write the ENVI header */
+    strcpy (envi_file, bmeta->file_name);
+    cptr = strchr (envi_file, '.');
+    strcpy (cptr, ".hdr");
+    if (write_envi_hdr (envi_file, &envi_hdr) != SUCCESS)
+    {
+        sprintf (errmsg, "Writing ENVI header file.");
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  write_behind_thread
+
+PURPOSE:  Writer thread for the write-behind engine.  Writes the queued bands
+and their ENVI headers in order, and gathers a copy of the band metadata for
+the XML update, until the engine is closed and the queue is empty.
+
+RETURN VALUE:
+Type = void *
+Value           Description
+-----           -----------
+NULL            Always; the status is returned in the write-behind structure
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+NOTES:
+******************************************************************************/
+static void *write_behind_thread
+(
+    void *arg             /* I: write-behind structure */
+)
+{
+    Write_behind_t *this = (Write_behind_t *) arg;  /* write-behind struct */
+    Band_write_t job;     /* current write request */
+    int ijob;             /* index of the current write request */
+    int retval;           /* return status of the band write */
+
+    while (1)
+    {
+        /* Wait for a write request or for the queue to be closed */
+        pthread_mutex_lock (&this->mutex);
+        while (!this->closing && this->ndone >= this->njobs)
+            pthread_cond_wait (&this->cond, &this->mutex);
+        if (this->ndone >= this->njobs)
+        {   /* closing and nothing left to write */
+            pthread_mutex_unlock (&this->mutex);
+            break;
+        }
+        ijob = this->ndone;
+        job = this->jobs[ijob];
+        pthread_mutex_unlock (&this->mutex);
+
+        /* Write the band and its header, then keep a copy of the band
+           metadata for the XML update.  Only this thread touches the gathered
+           metadata until it has been joined. */
+        retval = write_band_and_header (&job, this->global);
+        if (retval == SUCCESS)
+        {
+            retval = copy_band_metadata (&job.output->metadata.band[job.iband],
+                &this->meta[this->nmeta]);
+            if (retval == SUCCESS)
+                this->meta_job[this->nmeta++] = ijob;
+        }
+
+        pthread_mutex_lock (&this->mutex);
+        if (retval != SUCCESS)
+            this->status = ERROR;
+        this->ndone++;
+        pthread_cond_broadcast (&this->cond);
+        pthread_mutex_unlock (&this->mutex);
+    }
+
+    return (NULL);
+}
+
+
+/******************************************************************************
+MODULE:  open_write_behind
+
+PURPOSE:  Allocates the write-behind structure and starts the writer thread.
+
+RETURN VALUE:
+Type = Write_behind_t *
+Value           Description
+-----           -----------
+NULL            Error allocating memory or starting the writer thread
+non-NULL        Pointer to the write-behind structure
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+NOTES:
+  1. A single write-behind engine is shared by all the output products (TOA,
+     RADSAT, and SR) so the XML file only needs to be updated once.
+******************************************************************************/
+Write_behind_t *open_write_behind
+(
+    Espa_global_meta_t *global  /* I: global metadata for the ENVI headers */
+)
+{
+    char FUNC_NAME[] = "open_write_behind";   /* function name */
+    char errmsg[STR_SIZE];        /* error message */
+    Write_behind_t *this = NULL;  /* write-behind structure to be returned */
+
+    this = calloc (1, sizeof (Write_behind_t));
+    if (this == NULL)
+    {
+        sprintf (errmsg, "Error allocating memory for the write-behind "
+            "structure");
+        error_handler (true, FUNC_NAME, errmsg);
+        return (NULL);
+    }
+
+    this->global = global;
+    this->njobs = 0;
+    this->ndone = 0;
+    this->nmeta = 0;
+    this->closing = false;
+    this->status = SUCCESS;
+    pthread_mutex_init (&this->mutex, NULL);
+    pthread_cond_init (&this->cond, NULL);
+
+    /* Start the writer thread */
+    if (pthread_create (&this->thread, NULL, write_behind_thread, this) != 0)
+    {
+        sprintf (errmsg, "Error starting the write-behind thread");
+        error_handler (true, FUNC_NAME, errmsg);
+        pthread_mutex_destroy (&this->mutex);
+        pthread_cond_destroy (&this->cond);
+        free (this);
+        return (NULL);
+    }
+
+    return (this);
+}
+
+
+/******************************************************************************
+MODULE:  queue_band_write
+
+PURPOSE:  Queues a band to be written, along with its ENVI header, by the
+writer thread.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           The queue is full or a previous write failed
+SUCCESS         No errors encountered
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+NOTES:
+  1. The buffer is not copied.  It must not be modified or freed, and the
+     output must not be closed, until wait_band_writes or close_write_behind
+     has been called.
+******************************************************************************/
+int queue_band_write
+(
+    Write_behind_t *this, /* I: write-behind structure */
+    Output_t *output,     /* I: output structure for the band */
+    void *buf,            /* I: band buffer to be written */
+    int iband,            /* I: output band (0-based) */
+    int nbytes            /* I: number of bytes per pixel in this band */
+)
+{
+    char FUNC_NAME[] = "queue_band_write";   /* function name */
+    char errmsg[STR_SIZE];    /* error message */
+
+    pthread_mutex_lock (&this->mutex);
+    if (this->status != SUCCESS)
+    {
+        pthread_mutex_unlock (&this->mutex);
+        sprintf (errmsg, "A previous band write failed");
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+    if (this->njobs >= MAX_BAND_WRITES)
+    {
+        pthread_mutex_unlock (&this->mutex);
+        sprintf (errmsg, "Write-behind queue is full");
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    this->jobs[this->njobs].output = output;
+    this->jobs[this->njobs].buf = buf;
+    this->jobs[this->njobs].iband = iband;
+    this->jobs[this->njobs].nbytes = nbytes;
+    this->njobs++;
+    pthread_cond_broadcast (&this->cond);
+    pthread_mutex_unlock (&this->mutex);
+
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  wait_band_writes
+
+PURPOSE:  Waits for all the bands queued so far to be written.  The writer
+thread keeps running so more bands can be queued afterwards.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           One or more of the band writes failed
+SUCCESS         No errors encountered
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+NOTES:
+  1. Used before a queued buffer is modified or a queued output is closed.
+******************************************************************************/
+int wait_band_writes
+(
+    Write_behind_t *this  /* I: write-behind structure */
+)
+{
+    int status;           /* status of the writer thread */
+
+    pthread_mutex_lock (&this->mutex);
+    while (this->ndone < this->njobs)
+        pthread_cond_wait (&this->cond, &this->mutex);
+    status = this->status;
+    pthread_mutex_unlock (&this->mutex);
+
+    return (status);
+}
+
+
+/******************************************************************************
+MODULE:  close_write_behind
+
+PURPOSE:  Waits for all the queued bands to be written, stops the writer
+thread, appends the gathered band metadata of the first nappend bands queued
+to the XML file in a single update, and frees the write-behind structure.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           One or more of the band writes or the XML update failed
+SUCCESS         No errors encountered
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+NOTES:
+  1. append_metadata parses and rewrites the entire XML file, therefore the
+     bands are gathered and appended once instead of once per product.
+  2. The first nappend bands are appended only if all of them were written,
+     even if a band queued after them failed.  This lets the caller keep the
+     products queued before a failure (e.g. the TOA and RADSAT products when
+     the surface reflectance fails) listed in the XML file.
+******************************************************************************/
+int close_write_behind
+(
+    Write_behind_t *this, /* I: write-behind structure to flush and free */
+    char *xml_infile,     /* I: XML file to append the gathered band metadata
+                                to; NULL to discard the metadata */
+    int nappend           /* I: number of the first write requests queued
+                                whose bands are appended to the XML file */
+)
+{
+    char FUNC_NAME[] = "close_write_behind";   /* function name */
+    char errmsg[STR_SIZE];    /* error message */
+    int i, b;             /* looping variables for the bands and bits */
+    int nwritten = 0;     /* number of the first nappend bands written */
+    int status;           /* status of the writer thread */
+
+    if (this == NULL)
+        return (SUCCESS);
+
+    pthread_mutex_lock (&this->mutex);
+    this->closing = true;
+    pthread_cond_broadcast (&this->cond);
+    pthread_mutex_unlock (&this->mutex);
+    pthread_join (this->thread, NULL);
+    status = this->status;
+
+    /* Append the first nappend bands to the XML file, if they were all
+       written.  The metadata is in the order the bands were queued. */
+    nappend = MIN (nappend, this->njobs);
+    for (i = 0; i < this->nmeta; i++)
+    {
+        if (this->meta_job[i] < nappend)
+            nwritten++;
+    }
+    if (xml_infile != NULL && nappend > 0)
+    {
+        if (nwritten != nappend)
+        {
+            sprintf (errmsg, "%d of %d output bands were not written, so they "
+                "are not appended to the XML file.", nappend - nwritten,
+                nappend);
+            error_handler (true, FUNC_NAME, errmsg);
+            status = ERROR;
+        }
+        else if (append_metadata (nappend, this->meta, xml_infile) != SUCCESS)
+        {
+            sprintf (errmsg, "Appending %d output bands to the XML file.",
+                nappend);
+            error_handler (true, FUNC_NAME, errmsg);
+            status = ERROR;
+        }
+    }
+
+    /* Free the gathered metadata */
+    for (i = 0; i < this->nmeta; i++)
+    {
+        if (this->meta[i].bitmap_description != NULL)
+        {
+            for (b = 0; b < this->meta[i].nbits; b++)
+                free (this->meta[i].bitmap_description[b]);
+            free (this->meta[i].bitmap_description);
+        }
+    }
+
+    pthread_mutex_destroy (&this->mutex);
+    pthread_cond_destroy (&this->cond);
+    free (this);
+
+    return (status);
+}
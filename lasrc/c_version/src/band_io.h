@@ -0,0 +1,144 @@
+#ifndef _BAND_IO_H_
+#define _BAND_IO_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "common.h"
+#include "input.h"
+#include "arena.h"
+#include "output.h"
+#include "espa_metadata.h"
+#include "write_metadata.h"
+#include "envi_header.h"
+#include "error_handler.h"
+
+/* Define the default and maximum number of band buffers the prefetcher
+   keeps in flight.  A depth of 2 is a double-buffered read (band N+1 is read
+   while band N is processed). */
+#define DEFAULT_PREFETCH_DEPTH 2
+#define MAX_PREFETCH_DEPTH NBAND_TTL_MAX
+
+/* Structure for a single band read request */
+typedef struct {
+    bool thermal;         /* is this a thermal band (true) or reflectance
+                             band (false)? */
+    int iband;            /* band to read (0-based) within the refl or thermal
+                             bands */
+} Band_read_t;
+
+/* Structure for the band prefetcher.  The reader thread services the read
+   requests in order, filling buffer slot (request % depth). */
+typedef struct {
+    Input_t *input;       /* input structure the bands are read from */
+    int nlines;           /* number of lines in each band */
+    int nsamps;           /* number of samples in each band */
+    int nreads;           /* number of read requests */
+    Band_read_t reads[NBAND_TTL_MAX];  /* list of read requests, in the order
+                             they will be consumed */
+    int depth;            /* number of band buffers */
+    uint16 **buf;         /* band buffers, depth x (nlines * nsamps) */
+    int nloaded;          /* number of requests which have been read */
+    int nreleased;        /* number of requests released by the consumer */
+    bool abort;           /* flag to stop the reader thread early */
+    int status;           /* SUCCESS or ERROR from the reader thread */
+    pthread_t thread;     /* reader thread */
+    pthread_mutex_t mutex;   /* mutex for the counters and status */
+    pthread_cond_t cond;     /* signaled when a counter changes */
+} Prefetch_t;
+
+/* Define the maximum number of band writes which can be queued over the life
+   of the write-behind engine (TOA, RADSAT, and SR products) */
+#define MAX_BAND_WRITES (3 * NBAND_TTL_OUT)
+
+/* Structure for a single band write request */
+typedef struct {
+    Output_t *output;     /* output structure the band is written to; must
+                             remain open until the writes have been drained */
+    void *buf;            /* buffer to be written; must remain valid until the
+                             writes have been drained */
+    int iband;            /* output band to write (0-based) */
+    int nbytes;           /* number of bytes per pixel in this band */
+} Band_write_t;
+
+/* Structure for the write-behind engine.  Whole bands are written in the
+   order they are queued by a background writer thread, along with their
+   ENVI headers.  The band metadata is gathered as the bands are written and
+   appended to the XML file in a single update when the engine is closed. */
+typedef struct {
+    Espa_global_meta_t *global;  /* global metadata for the ENVI headers */
+    int njobs;            /* number of write requests queued */
+    Band_write_t jobs[MAX_BAND_WRITES];  /* list of write requests */
+    int ndone;            /* number of write requests completed */
+    int nmeta;            /* number of bands in the gathered metadata */
+    Espa_band_meta_t meta[MAX_BAND_WRITES];  /* copy of the band metadata for
+                             each band written, in the order written */
+    int meta_job[MAX_BAND_WRITES];  /* write request of each band in the
+                             gathered metadata */
+    bool closing;         /* no more writes will be queued */
+    int status;           /* SUCCESS or ERROR from the writer thread */
+    pthread_t thread;     /* writer thread */
+    pthread_mutex_t mutex;   /* mutex for the queue and status */
+    pthread_cond_t cond;     /* signaled when the queue changes */
+} Write_behind_t;
+
+/* Prototypes */
+Prefetch_t *open_prefetch
+(
+    Input_t *input,       /* I: input structure for the Landsat product */
+    int nreads,           /* I: number of band read requests */
+    Band_read_t *reads,   /* I: band read requests, in consumption order */
+    int depth,            /* I: number of band buffers to keep in flight */
+    int nlines,           /* I: number of lines in each band */
+    int nsamps,           /* I: number of samples in each band */
+    Arena_t *arena        /* I/O: arena to allocate the band buffers from */
+);
+
+uint16 *get_prefetch_band
+(
+    Prefetch_t *this,     /* I: prefetch structure */
+    int ireq              /* I: read request to obtain (0-based) */
+);
+
+void release_prefetch_band
+(
+    Prefetch_t *this,     /* I: prefetch structure */
+    int ireq              /* I: read request that is no longer needed */
+);
+
+int close_prefetch
+(
+    Prefetch_t *this      /* I: prefetch structure to stop and free */
+);
+
+Write_behind_t *open_write_behind
+(
+    Espa_global_meta_t *global  /* I: global metadata for the ENVI headers */
+);
+
+int queue_band_write
+(
+    Write_behind_t *this, /* I: write-behind structure */
+    Output_t *output,     /* I: output structure for the band */
+    void *buf,            /* I: band buffer to be written */
+    int iband,            /* I: output band (0-based) */
+    int nbytes            /* I: number of bytes per pixel in this band */
+);
+
+int wait_band_writes
+(
+    Write_behind_t *this  /* I: write-behind structure */
+);
+
+int close_write_behind
+(
+    Write_behind_t *this, /* I: write-behind structure to flush and free */
+    char *xml_infile,     /* I: XML file to append the gathered band metadata
+                                to; NULL to discard the metadata */
+    int nappend           /* I: number of the first write requests queued
+                                whose bands are appended to the XML file */
+);
+
+#endif
@@ -0,0 +1,663 @@
+/*****************************************************************************
+FILE: batch.c
+
+PURPOSE: Contains functions for processing a batch of scenes with a single
+invocation of LaSRC.  The look-up tables and static climate modeling grids are
+read once for the whole batch, and the daily ozone/water vapor grids are
+cached by filename so scenes from the same day share a single read.  Scenes
+are processed one or more at a time, within an optional memory budget, and
+the per-scene and amortized throughput is reported at the end.
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+LICENSE TYPE:  NASA Open Source Agreement Version 1.3
+
+NOTES:
+  1. The batch file contains one scene per line: the XML filename followed by
+     the auxiliary filename (L8ANCyyyyddd.hdf_fused), separated by white
+     space.  The auxiliary filename may be left off if surface reflectance is
+     not being processed.  Blank lines and lines starting with '#' are
+     ignored.
+  2. Each scene is processed in a child process forked from the batch
+     process.  The tables are shared with the children copy-on-write, so they
+     are neither copied nor re-read, and a failure in one scene does not
+     affect the tables or the other scenes.  Separate processes are used
+     instead of threads since the HDF library is not thread-safe.
+  3. The XML file for each scene is validated and parsed by the batch process
+     before the scene is started, so the scene size is known for the memory
+     budget.
+  4. Each scene is processed in the directory containing its XML file, as if
+     LaSRC had been run on that scene by itself from that directory.
+*****************************************************************************/
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#ifdef _OPENMP
+    #include <omp.h>
+#endif
+#include "lasrc.h"
+
+/******************************************************************************
+MODULE:  get_time
+
+PURPOSE:  Returns the current wall clock time in seconds.
+
+RETURN VALUE:
+Type = double
+Value           Description
+-----           -----------
+time            Seconds since the epoch, to the microsecond
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+NOTES:
+******************************************************************************/
+double get_time ()
+{
+    struct timeval tv;    /* current time */
+
+    gettimeofday (&tv, NULL);
+    return (tv.tv_sec + tv.tv_usec * 1.0e-6);
+}
+
+
+/******************************************************************************
+MODULE:  enter_scene_dir
+
+PURPOSE:  Changes the current directory to the directory containing the XML
+file, so the band files listed in the XML file are found and the output bands
+are written alongside them.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error changing to the scene directory
+SUCCESS         Successful completion
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+NOTES:
+  1. This is only called from the process for a single scene, since the
+     current directory is shared by the whole process.
+******************************************************************************/
+int enter_scene_dir
+(
+    char *xml_infile,     /* I: input XML filename, with or without a path */
+    char *xml_basename    /* O: input XML filename without the path
+                                [STR_SIZE] */
+)
+{
+    char FUNC_NAME[] = "enter_scene_dir";   /* function name */
+    char errmsg[STR_SIZE];       /* error message */
+    char scene_dir[STR_SIZE];    /* directory containing the XML file */
+    char *cptr = NULL;           /* pointer to the last '/' in the filename */
+
+    cptr = strrchr (xml_infile, '/');
+    if (cptr == NULL)
+    {
+        strcpy (xml_basename, xml_infile);
+        return (SUCCESS);
+    }
+    strcpy (xml_basename, cptr + 1);
+
+    if (cptr == xml_infile)
+        strcpy (scene_dir, "/");
+    else
+    {
+        strncpy (scene_dir, xml_infile, cptr - xml_infile);
+        scene_dir[cptr - xml_infile] = '\0';
+    }
+
+    if (chdir (scene_dir) != 0)
+    {
+        sprintf (errmsg, "Changing to the scene directory: %s", scene_dir);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  read_batch_file
+
+PURPOSE:  Reads the list of XML and auxiliary files from the batch file.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error reading the batch file
+SUCCESS         Successful completion
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+NOTES:
+  1. Memory is allocated for the scenes, so it is up to the calling routine to
+     free this memory.
+******************************************************************************/
+static int read_batch_file
+(
+    char *batch_infile,   /* I: batch file listing the XML and auxiliary file
+                                for each scene */
+    bool process_sr,      /* I: process the surface reflectance products */
+    Batch_scene_t **scenes,  /* O: list of scenes */
+    int *nscenes          /* O: number of scenes in the list */
+)
+{
+    char FUNC_NAME[] = "read_batch_file";   /* function name */
+    char errmsg[STR_SIZE];       /* error message */
+    char line[3 * STR_SIZE];     /* current line in the batch file */
+    char format[STR_SIZE];       /* sscanf format for the XML and aux names */
+    char *cptr = NULL;           /* pointer to the first non-space character */
+    int nfields;                 /* number of fields read from the line */
+    int nalloc = 0;              /* number of scenes allocated */
+    int iline = 0;               /* current line number */
+    Batch_scene_t *scene = NULL; /* current scene */
+    Batch_scene_t *tmp = NULL;   /* reallocated list of scenes */
+    FILE *fp = NULL;             /* file pointer for the batch file */
+
+    *scenes = NULL;
+    *nscenes = 0;
+
+    fp = fopen (batch_infile, "r");
+    if (fp == NULL)
+    {
+        sprintf (errmsg, "Opening the batch file: %s", batch_infile);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    sprintf (format, "%%%ds %%%ds", STR_SIZE-1, STR_SIZE-1);
+    while (fgets (line, sizeof (line), fp) != NULL)
+    {
+        iline++;
+
+        /* Skip blank lines and comments */
+        cptr = line;
+        while (*cptr == ' ' || *cptr == '\t')
+            cptr++;
+        if (*cptr == '\0' || *cptr == '\n' || *cptr == '#')
+            continue;
+
+        /* Make room for the scene */
+        if (*nscenes == nalloc)
+        {
+            nalloc = (nalloc == 0) ? 64 : nalloc * 2;
+            tmp = realloc (*scenes, nalloc * sizeof (Batch_scene_t));
+            if (tmp == NULL)
+            {
+                sprintf (errmsg, "Error allocating memory for the scenes");
+                error_handler (true, FUNC_NAME, errmsg);
+                fclose (fp);
+                return (ERROR);
+            }
+            *scenes = tmp;
+        }
+
+        scene = &(*scenes)[*nscenes];
+        memset (scene, 0, sizeof (Batch_scene_t));
+        nfields = sscanf (cptr, format, scene->xml_infile, scene->aux_infile);
+        if (nfields < 1 || (process_sr && nfields < 2))
+        {
+            sprintf (errmsg, "Line %d of the batch file %s must contain the "
+                "XML filename and the auxiliary filename", iline,
+                batch_infile);
+            error_handler (true, FUNC_NAME, errmsg);
+            fclose (fp);
+            return (ERROR);
+        }
+        scene->status = ERROR;
+        (*nscenes)++;
+    }
+    fclose (fp);
+
+    if (*nscenes == 0)
+    {
+        sprintf (errmsg, "No scenes were found in the batch file: %s",
+            batch_infile);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  scene_arena_size
+
+PURPOSE:  Plans the size of the memory arena needed to process a scene of the
+specified size.
+
+RETURN VALUE:
+Type = size_t
+Value           Description
+-----           -----------
+nbytes          Number of bytes needed for the arena
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+NOTES:
+  1. The arrays allocated by the main application are held for the whole
+     scene.  The solar zenith band and the prefetch buffers are only held for
+     the TOA corrections, and are released before the surface reflectance
+     corrections reuse the same part of the arena, so only the larger of the
+     two stages is counted.
+  2. This must match the allocations made from the arena by process_scene.
+     An allocation which does not fit in the planned arena is an error.  The
+     prefetch depth is counted as requested, so the plan is larger than
+     needed if the prefetcher clamps it to fewer bands.
+******************************************************************************/
+size_t scene_arena_size
+(
+    int nlines,           /* I: number of lines in the reflectance bands */
+    int nsamps,           /* I: number of samples in the reflectance bands */
+    bool process_sr,      /* I: process the surface reflectance products */
+    int prefetch_depth,   /* I: number of input bands to read ahead */
+    int angle_decimation  /* I: number of lines/samples between the per-pixel
+                                angles held in memory */
+)
+{
+    size_t toa_size;      /* arena size for the TOA stage */
+    size_t sr_size = 0;   /* arena size for the surface reflectance stage */
+
+    toa_size = angle_band_size (nlines, nsamps, angle_decimation) +
+        prefetch_depth * arena_block_size ((size_t) nlines * nsamps *
+        sizeof (uint16));
+    if (process_sr)
+        sr_size = memory_size_sr (nlines, nsamps);
+
+    return (memory_size_main (nlines, nsamps) + MAX (toa_size, sr_size));
+}
+
+
+/******************************************************************************
+MODULE:  scene_memory_size
+
+PURPOSE:  Estimates the memory needed to process a scene of the specified
+size.
+
+RETURN VALUE:
+Type = long
+Value           Description
+-----           -----------
+nbytes          Estimated number of bytes needed for the scene
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+NOTES:
+  1. This is the arena for the scene (see scene_arena_size), which includes
+     the bands buffered by the prefetcher.  The look-up tables and auxiliary
+     grids are shared between the scenes and are not included.
+******************************************************************************/
+long scene_memory_size
+(
+    int nlines,           /* I: number of lines in the reflectance bands */
+    int nsamps,           /* I: number of samples in the reflectance bands */
+    bool process_sr,      /* I: process the surface reflectance products */
+    int prefetch_depth,   /* I: number of input bands to read ahead */
+    int angle_decimation  /* I: number of lines/samples between the per-pixel
+                                angles held in memory */
+)
+{
+    return ((long) scene_arena_size (nlines, nsamps, process_sr,
+        prefetch_depth, angle_decimation));
+}
+
+
+/******************************************************************************
+MODULE:  wait_batch_scene
+
+PURPOSE:  Waits for one of the running scenes to complete and records its
+status and completion time.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+-1              No scene processes were running
+iscene          Index of the scene which completed
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+NOTES:
+******************************************************************************/
+static int wait_batch_scene
+(
+    Batch_scene_t *scenes,   /* I/O: list of scenes */
+    int nscenes,          /* I: number of scenes in the list */
+    Sr_tables_t *tables   /* I: static tables and auxiliary cache */
+)
+{
+    char FUNC_NAME[] = "wait_batch_scene";   /* function name */
+    char errmsg[STR_SIZE];       /* error message */
+    int i;                       /* looping variable for scenes */
+    int status;                  /* exit status of the scene process */
+    pid_t pid;                   /* process ID which completed */
+    Batch_scene_t *scene = NULL; /* scene which completed */
+
+    while (1)
+    {
+        pid = waitpid (-1, &status, 0);
+        if (pid < 0)
+            return (-1);
+
+        for (i = 0; i < nscenes; i++)
+        {
+            if (scenes[i].pid == pid)
+                break;
+        }
+        if (i < nscenes)
+            break;
+    }
+
+    scene = &scenes[i];
+    scene->end_time = get_time ();
+    scene->pid = 0;
+    if (WIFEXITED (status) && WEXITSTATUS (status) == EXIT_SUCCESS)
+        scene->status = SUCCESS;
+    else
+    {
+        scene->status = ERROR;
+        if (WIFSIGNALED (status))
+            sprintf (errmsg, "Scene %s was terminated by signal %d",
+                scene->xml_infile, WTERMSIG (status));
+        else
+            sprintf (errmsg, "Scene %s failed", scene->xml_infile);
+        error_handler (true, FUNC_NAME, errmsg);
+    }
+
+    /* The auxiliary grid can now be replaced in the cache */
+    release_aux_grid (tables, scene->aux);
+    scene->aux = NULL;
+
+    return (i);
+}
+
+
+/******************************************************************************
+MODULE:  run_batch
+
+PURPOSE:  Processes all the scenes in the batch file, sharing the look-up
+tables and auxiliary data between them, and reports the throughput.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error setting up the batch or processing one of the scenes
+SUCCESS         All the scenes were processed successfully
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+NOTES:
+  1. A scene which fails does not stop the batch.  The status of each scene
+     is reported at the end.
+  2. A scene whose estimated memory exceeds the memory budget by itself is
+     processed when no other scenes are running.
+  3. When processing more than one scene at a time, the OpenMP threads are
+     divided between the scenes.  The threads are only pinned for numa when
+     one scene is processed at a time, since the scene processes don't
+     coordinate which CPUs they use.
+******************************************************************************/
+int run_batch
+(
+    char *batch_infile,   /* I: batch file listing the XML and auxiliary file
+                                for each scene */
+    bool process_sr,      /* I: process the surface reflectance products */
+    bool write_toa,       /* I: write intermediate TOA products flag */
+    int prefetch_depth,   /* I: number of input bands to read ahead */
+    int angle_decimation, /* I: number of lines/samples between the per-pixel
+                                angles held in memory */
+    Myformat_t output_format,  /* I: file format for the output bands */
+    int concurrency,      /* I: number of scenes to process at once */
+    int max_memory,       /* I: memory budget (MB) for the scenes being
+                                processed at once; 0 is no limit */
+    bool numa,            /* I: place the threads and scene arrays on the
+                                NUMA nodes */
+    bool verbose          /* I: verbose flag for printing messages */
+)
+{
+    char FUNC_NAME[] = "run_batch";   /* function name */
+    char errmsg[STR_SIZE];       /* error message */
+    char xml_basename[STR_SIZE]; /* XML filename without the path */
+    int i;                       /* looping variable for scenes */
+    int ib;                      /* looping variable for bands */
+    int retval;                  /* return status */
+    int nscenes = 0;             /* number of scenes in the batch */
+    int nrunning = 0;            /* number of scenes being processed */
+    int nsuccess = 0;            /* number of scenes processed successfully */
+    long mem_budget;             /* memory budget (bytes) */
+    long mem_used = 0;           /* estimated memory used by the running
+                                    scenes (bytes) */
+    double npixels = 0.0;        /* number of pixels processed successfully */
+    double start_time;           /* start time for the batch (seconds) */
+    double load_time;            /* time to read the tables (seconds) */
+    double elapsed;              /* elapsed time (seconds) */
+    Batch_scene_t *scenes = NULL;    /* list of scenes */
+    Batch_scene_t *scene = NULL;     /* current scene */
+    Sr_tables_t *tables = NULL;      /* static look-up tables and climate
+                                        modeling grids */
+    Espa_internal_meta_t xml_metadata;  /* XML metadata structure */
+
+    start_time = get_time ();
+    mem_budget = (long) max_memory * 1024 * 1024;
+
+    /* Read the list of scenes */
+    if (read_batch_file (batch_infile, process_sr, &scenes, &nscenes) !=
+        SUCCESS)
+    {
+        sprintf (errmsg, "Reading the batch file: %s", batch_infile);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+    printf ("Starting batch processing of %d scenes, %d at a time ...\n",
+        nscenes, concurrency);
+
+    /* Read the look-up tables and static auxiliary data once for all the
+       scenes.  Each running scene holds one daily auxiliary grid, and one
+       more can be read for the next scene while they run. */
+    if (process_sr)
+    {
+        tables = load_sr_tables (concurrency + 1);
+        if (tables == NULL)
+        {
+            sprintf (errmsg, "Reading the look-up tables and auxiliary data");
+            error_handler (true, FUNC_NAME, errmsg);
+            free (scenes);
+            return (ERROR);
+        }
+    }
+    load_time = get_time () - start_time;
+
+    for (i = 0; i < nscenes; i++)
+    {
+        scene = &scenes[i];
+
+        /* Validate and parse the input metadata file */
+        if (validate_xml_file (scene->xml_infile) != SUCCESS)
+        {  /* Error messages already written */
+            continue;
+        }
+
+        init_metadata_struct (&xml_metadata);
+        if (parse_metadata (scene->xml_infile, &xml_metadata) != SUCCESS)
+        {  /* Error messages already written */
+            continue;
+        }
+
+        /* Use band 1 for the size of the scene */
+        for (ib = 0; ib < xml_metadata.nbands; ib++)
+        {
+            if (!strcmp (xml_metadata.band[ib].name, "b1"))
+            {
+                scene->nlines = xml_metadata.band[ib].nlines;
+                scene->nsamps = xml_metadata.band[ib].nsamps;
+                break;
+            }
+        }
+        if (ib == xml_metadata.nbands)
+        {
+            sprintf (errmsg, "Band 1 (b1) was not found in the XML file: %s",
+                scene->xml_infile);
+            error_handler (true, FUNC_NAME, errmsg);
+            free_metadata (&xml_metadata);
+            continue;
+        }
+        scene->mem_size = scene_memory_size (scene->nlines, scene->nsamps,
+            process_sr, prefetch_depth, angle_decimation);
+
+        /* Get the daily auxiliary grid, from the cache if possible */
+        if (process_sr)
+        {
+            scene->aux = get_aux_grid (tables, scene->aux_infile);
+            if (scene->aux == NULL)
+            {
+                sprintf (errmsg, "Reading the ozone and water vapor auxiliary "
+                    "data for %s", scene->xml_infile);
+                error_handler (true, FUNC_NAME, errmsg);
+                free_metadata (&xml_metadata);
+                continue;
+            }
+        }
+
+        /* Wait for room to run the scene */
+        while (nrunning > 0 && (nrunning >= concurrency ||
+            (mem_budget > 0 && mem_used + scene->mem_size > mem_budget)))
+        {
+            retval = wait_batch_scene (scenes, nscenes, tables);
+            if (retval < 0)
+                break;
+            nrunning--;
+            mem_used -= scenes[retval].mem_size;
+        }
+
+        if (mem_budget > 0 && scene->mem_size > mem_budget)
+        {
+            sprintf (errmsg, "Scene %s needs an estimated %ld MB, which "
+                "exceeds the memory budget of %d MB.  It will be processed "
+                "by itself.", scene->xml_infile,
+                scene->mem_size / (1024 * 1024), max_memory);
+            error_handler (false, FUNC_NAME, errmsg);
+        }
+
+        /* Start the scene in its own process */
+        printf ("Processing scene %d of %d: %s\n", i+1, nscenes,
+            scene->xml_infile);
+        if (verbose)
+        {
+            printf ("  AUX input file: %s\n", scene->aux_infile);
+            printf ("  Estimated memory: %ld MB\n",
+                scene->mem_size / (1024 * 1024));
+        }
+        fflush (stdout);
+        fflush (stderr);
+
+        scene->start_time = get_time ();
+        scene->pid = fork ();
+        if (scene->pid < 0)
+        {
+            sprintf (errmsg, "Starting the process for scene %s",
+                scene->xml_infile);
+            error_handler (true, FUNC_NAME, errmsg);
+            scene->pid = 0;
+            release_aux_grid (tables, scene->aux);
+            scene->aux = NULL;
+            free_metadata (&xml_metadata);
+            continue;
+        }
+
+        if (scene->pid == 0)
+        {
+            /* Child process.  Share the OpenMP threads between the scenes
+               running at the same time. */
+#ifdef _OPENMP
+            omp_set_num_threads (MAX (1, omp_get_num_procs () / concurrency));
+#endif
+            if (numa && concurrency == 1)
+                pin_threads ();
+            retval = enter_scene_dir (scene->xml_infile, xml_basename);
+            if (retval == SUCCESS)
+                retval = process_scene (xml_basename, &xml_metadata, tables,
+                    scene->aux, process_sr, write_toa, prefetch_depth,
+                    angle_decimation, output_format, 0, NULL, 1, false, numa,
+                    verbose);
+            fflush (stdout);
+            fflush (stderr);
+            _exit (retval == SUCCESS ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+
+        /* The child has its own copy of the metadata */
+        free_metadata (&xml_metadata);
+        nrunning++;
+        mem_used += scene->mem_size;
+    }
+
+    /* Wait for the remaining scenes to complete */
+    while (nrunning > 0)
+    {
+        if (wait_batch_scene (scenes, nscenes, tables) < 0)
+            break;
+        nrunning--;
+    }
+    elapsed = get_time () - start_time;
+
+    /* Report the per-scene and amortized throughput */
+    printf ("\nBatch processing summary:\n");
+    printf ("  %-7s %10s %12s  %s\n", "Status", "Seconds", "Mpixels/sec",
+        "XML file");
+    for (i = 0; i < nscenes; i++)
+    {
+        scene = &scenes[i];
+        if (scene->status == SUCCESS)
+        {
+            nsuccess++;
+            npixels += (double) scene->nlines * scene->nsamps;
+            printf ("  %-7s %10.2f %12.3f  %s\n", "OK",
+                scene->end_time - scene->start_time,
+                (double) scene->nlines * scene->nsamps * 1.0e-6 /
+                MAX (scene->end_time - scene->start_time, 1.0e-6),
+                scene->xml_infile);
+        }
+        else
+        {
+            printf ("  %-7s %10s %12s  %s\n", "FAILED", "-", "-",
+                scene->xml_infile);
+        }
+    }
+
+    printf ("  Scenes: %d succeeded, %d failed\n", nsuccess,
+        nscenes - nsuccess);
+    if (process_sr)
+    {
+        printf ("  Look-up tables and static auxiliary data read once in "
+            "%.2f seconds\n", load_time);
+        printf ("  Daily auxiliary files read: %d for %ld scenes\n",
+            tables->nloads, tables->nrequests);
+    }
+    printf ("  Total elapsed time: %.2f seconds\n", elapsed);
+    if (nsuccess > 0)
+    {
+        printf ("  Amortized: %.2f seconds per scene, %.3f Mpixels/sec\n",
+            elapsed / nsuccess, npixels * 1.0e-6 / elapsed);
+    }
+
+    /* Free the tables and the scenes */
+    free_sr_tables (tables);
+    free (scenes);
+
+    if (nsuccess != nscenes)
+        return (ERROR);
+    return (SUCCESS);
+}
@@ -0,0 +1,77 @@
+#ifndef _BATCH_H_
+#define _BATCH_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <sys/types.h>
+#include "common.h"
+#include "output.h"
+#include "sr_tables.h"
+#include "error_handler.h"
+
+/* Structure for a single scene in the batch */
+typedef struct {
+    char xml_infile[STR_SIZE];  /* input XML filename */
+    char aux_infile[STR_SIZE];  /* input auxiliary filename for water vapor
+                                   and ozone */
+    int nlines;           /* number of lines in the reflectance bands */
+    int nsamps;           /* number of samples in the reflectance bands */
+    long mem_size;        /* estimated memory needed by the scene (bytes) */
+    Aux_grid_t *aux;      /* ozone and water vapor grid for the scene */
+    pid_t pid;            /* process ID for the scene; 0 if not running */
+    double start_time;    /* time the scene was started (seconds) */
+    double end_time;      /* time the scene completed (seconds) */
+    int status;           /* SUCCESS or ERROR for the scene */
+} Batch_scene_t;
+
+/* Prototypes */
+double get_time ();
+
+int enter_scene_dir
+(
+    char *xml_infile,     /* I: input XML filename, with or without a path */
+    char *xml_basename    /* O: input XML filename without the path
+                                [STR_SIZE] */
+);
+
+size_t scene_arena_size
+(
+    int nlines,           /* I: number of lines in the reflectance bands */
+    int nsamps,           /* I: number of samples in the reflectance bands */
+    bool process_sr,      /* I: process the surface reflectance products */
+    int prefetch_depth,   /* I: number of input bands to read ahead */
+    int angle_decimation  /* I: number of lines/samples between the per-pixel
+                                angles held in memory */
+);
+
+long scene_memory_size
+(
+    int nlines,           /* I: number of lines in the reflectance bands */
+    int nsamps,           /* I: number of samples in the reflectance bands */
+    bool process_sr,      /* I: process the surface reflectance products */
+    int prefetch_depth,   /* I: number of input bands to read ahead */
+    int angle_decimation  /* I: number of lines/samples between the per-pixel
+                                angles held in memory */
+);
+
+int run_batch
+(
+    char *batch_infile,   /* I: batch file listing the XML and auxiliary file
+                                for each scene */
+    bool process_sr,      /* I: process the surface reflectance products */
+    bool write_toa,       /* I: write intermediate TOA products flag */
+    int prefetch_depth,   /* I: number of input bands to read ahead */
+    int angle_decimation, /* I: number of lines/samples between the per-pixel
+                                angles held in memory */
+    Myformat_t output_format,  /* I: file format for the output bands */
+    int concurrency,      /* I: number of scenes to process at once */
+    int max_memory,       /* I: memory budget (MB) for the scenes being
+                                processed at once; 0 is no limit */
+    bool numa,            /* I: place the threads and scene arrays on the
+                                NUMA nodes */
+    bool verbose          /* I: verbose flag for printing messages */
+);
+
+#endif
@@ -0,0 +1,265 @@
+/*****************************************************************************
+FILE: bench_numa.c
+
+PURPOSE: Measures the gain of the --numa placement (numa.c and the first
+touch of arena.c) on the memory-bound line loops, and on the same loop
+scheduled over the tiles of tile_sched.c.  Built by 'make bench'.
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+LICENSE TYPE:  NASA Open Source Agreement Version 1.3
+
+NOTES:
+  1. Usage: bench_numa default|numa [nlines nsamps]
+     Pinning the threads can't be undone, so each placement is run in its
+     own process.  Run both with the same OMP_NUM_THREADS and compare the
+     times of each loop.
+  2. Float planes of the scene size are allocated from an arena and filled
+     one line at a time by the main thread, as the bands are read.  Then
+     BENCH_NITER passes of a streaming loop over the lines are timed, with
+     the default static schedule of the line loops.  With default, the pages
+     are placed on the node of the main thread by the fill.  With numa, the
+     threads are pinned and the pages are first touched by the threads which
+     process their lines, as lasrc --numa does.
+  3. The same streaming loop is then timed over the scheduling tiles, as the
+     surface reflectance loops take them: schedule (dynamic, 1) over the
+     tiles in decreasing order of cost.  The costs are set from a class plane
+     with fill outside a rotated rectangle, like a Landsat scene, so the
+     tiles are taken in about the order of the real loops.  Every pixel is
+     still streamed, so both loops move the same bytes.  A thread takes tiles
+     anywhere in the scene, so with numa most of its tiles are held on the
+     other nodes; the tile loop shows how much of the placement gain the
+     dynamic schedule keeps.
+  4. On a single-node machine both placements are the same, so the
+     numbers only show the cost of the placement.  The gain is measured on
+     a multi-socket machine, with the threads on all the sockets.
+*****************************************************************************/
+#include <sys/time.h>
+#ifdef _OPENMP
+    #include <omp.h>
+#endif
+#include "arena.h"
+#include "numa.h"
+#include "tile_sched.h"
+
+/* Size of the planes, that of a Landsat 8 OLI scene */
+#define BENCH_NLINES 7801
+#define BENCH_NSAMPS 7701
+
+/* Number of float planes streamed by the loop, and number of passes */
+#define BENCH_NPLANES 3
+#define BENCH_NITER 10
+
+
+/******************************************************************************
+MODULE:  bench_time
+
+PURPOSE:  Returns the current wall clock time in seconds.
+
+RETURN VALUE:
+Type = double
+Value           Description
+-----           -----------
+time            Seconds since the epoch, to the microsecond
+******************************************************************************/
+static double bench_time ()
+{
+    struct timeval tv;    /* current time */
+
+    gettimeofday (&tv, NULL);
+    return (tv.tv_sec + tv.tv_usec * 1.0e-6);
+}
+
+
+/******************************************************************************
+MODULE:  bench_stream_line
+
+PURPOSE:  Streams over part of a line of the planes, reading two planes and
+writing the third.
+
+RETURN VALUE:
+Type = None
+******************************************************************************/
+static void bench_stream_line
+(
+    float **plane,        /* I/O: planes, nlines x nsamps */
+    int nsamps,           /* I: number of samples in the planes */
+    int line,             /* I: line to stream */
+    int first_samp,       /* I: first sample to stream */
+    int end_samp          /* I: sample after the last sample to stream */
+)
+{
+    int samp;             /* looping variable for the samples */
+    float *a = &plane[0][(long) line * nsamps];   /* lines of the planes */
+    float *b = &plane[1][(long) line * nsamps];
+    float *c = &plane[2][(long) line * nsamps];
+
+    for (samp = first_samp; samp < end_samp; samp++)
+        c[samp] = a[samp] + 0.5f * b[samp];
+}
+
+
+/******************************************************************************
+MODULE:  set_scene_fill
+
+PURPOSE:  Marks the pixels outside a rotated rectangle as fill in the class
+plane, as in the Level-1 QA of a Landsat scene.
+
+RETURN VALUE:
+Type = None
+
+NOTES:
+  1. The rectangle has its corners on the edges of the planes, a fifth of the
+     way along each edge, which is about the fill of a WRS-2 scene.
+******************************************************************************/
+static void set_scene_fill
+(
+    uint8 *pclass,        /* O: class plane, nlines x nsamps */
+    int nlines,           /* I: number of lines in the planes */
+    int nsamps            /* I: number of samples in the planes */
+)
+{
+    int line, samp;       /* looping variables for the planes */
+    double y, x;          /* line and sample, 0.0 to 1.0 */
+
+    for (line = 0; line < nlines; line++)
+    {
+        y = (double) line / nlines;
+        for (samp = 0; samp < nsamps; samp++)
+        {
+            x = (double) samp / nsamps;
+            /* Outside one of the edges, as (sample, line), from (0, 0.2)
+               to (0.8, 0), (0.8, 0) to (1, 0.8), (1, 0.8) to (0.2, 1), and
+               (0.2, 1) to (0, 0.2) */
+            if (x + 4.0 * y < 0.8 || 4.0 * x - y > 3.2 ||
+                x + 4.0 * y > 4.2 || 4.0 * x - y < -0.2)
+                pclass[(long) line * nsamps + samp] = 1 << PCLASS_FILL;
+            else
+                pclass[(long) line * nsamps + samp] = 0;
+        }
+    }
+}
+
+
+int main (int argc, char *argv[])
+{
+    bool numa;            /* place the threads and planes for NUMA? */
+    int nlines = BENCH_NLINES;   /* number of lines in the planes */
+    int nsamps = BENCH_NSAMPS;   /* number of samples in the planes */
+    int nthreads = 1;     /* number of OpenMP threads */
+    int ip;               /* looping variable for the planes */
+    int iter;             /* looping variable for the passes */
+    int line, samp;       /* looping variables for the planes */
+    int t;                /* looping variable for the tiles */
+    long plane_size;      /* size of a plane in bytes */
+    double start;         /* start time of the passes */
+    double line_elapsed;  /* time of the passes over the lines */
+    double tile_elapsed;  /* time of the passes over the tiles */
+    float *plane[BENCH_NPLANES];   /* planes, nlines x nsamps */
+    float *a = NULL;      /* line of a plane */
+    uint8 *pclass = NULL; /* class plane, nlines x nsamps */
+    Sched_tile_t *tile = NULL;     /* current tile */
+    Tile_sched_t *sched = NULL;    /* tiles of the planes */
+    Arena_t *arena = NULL;   /* arena holding the planes */
+
+    if ((argc != 2 && argc != 4) ||
+        (strcmp (argv[1], "default") && strcmp (argv[1], "numa")))
+    {
+        printf ("Usage: bench_numa default|numa [nlines nsamps]\n");
+        return (EXIT_FAILURE);
+    }
+    numa = !strcmp (argv[1], "numa");
+    if (argc == 4)
+    {
+        nlines = atoi (argv[2]);
+        nsamps = atoi (argv[3]);
+    }
+    plane_size = (long) nlines * nsamps * sizeof (float);
+#ifdef _OPENMP
+    nthreads = omp_get_max_threads ();
+#endif
+
+    if (numa)
+        pin_threads ();
+    arena = open_arena (BENCH_NPLANES * arena_block_size (plane_size) +
+        arena_block_size ((long) nlines * nsamps), numa ? nlines : 0);
+    if (arena == NULL)
+    {
+        printf ("bench_numa: opening the arena\n");
+        return (EXIT_FAILURE);
+    }
+    for (ip = 0; ip < BENCH_NPLANES; ip++)
+    {
+        plane[ip] = arena_alloc (arena, plane_size);
+        if (plane[ip] == NULL)
+        {
+            printf ("bench_numa: allocating the planes\n");
+            return (EXIT_FAILURE);
+        }
+    }
+    pclass = arena_alloc (arena, (long) nlines * nsamps);
+    sched = open_tile_sched (nlines, nsamps);
+    if (pclass == NULL || sched == NULL)
+    {
+        printf ("bench_numa: allocating the tiles\n");
+        return (EXIT_FAILURE);
+    }
+    set_scene_fill (pclass, nlines, nsamps);
+    set_pixel_tile_costs (sched, pclass, nsamps);
+
+    /* Fill the planes a line at a time from the main thread */
+    for (line = 0; line < nlines; line++)
+    {
+        for (ip = 0; ip < BENCH_NPLANES; ip++)
+        {
+            a = &plane[ip][(long) line * nsamps];
+            for (samp = 0; samp < nsamps; samp++)
+                a[samp] = (float) (ip + line + samp);
+        }
+    }
+    if (numa)
+        report_numa_placement ("the planes", arena->base,
+            BENCH_NPLANES * plane_size);
+
+    /* Stream over the planes with the static schedule of the line loops */
+    start = bench_time ();
+    for (iter = 0; iter < BENCH_NITER; iter++)
+    {
+#ifdef _OPENMP
+        #pragma omp parallel for schedule (static) private (line)
+#endif
+        for (line = 0; line < nlines; line++)
+            bench_stream_line (plane, nsamps, line, 0, nsamps);
+    }
+    line_elapsed = bench_time () - start;
+
+    /* The same loop over the tiles, most expensive first */
+    start = bench_time ();
+    for (iter = 0; iter < BENCH_NITER; iter++)
+    {
+#ifdef _OPENMP
+        #pragma omp parallel for schedule (dynamic, 1) private (t, tile, line)
+#endif
+        for (t = 0; t < sched->ntiles; t++)
+        {
+            tile = &sched->tile[t];
+            for (line = tile->first_line; line < tile->end_line; line++)
+                bench_stream_line (plane, nsamps, line, tile->first_samp,
+                    tile->end_samp);
+        }
+    }
+    tile_elapsed = bench_time () - start;
+
+    /* Each pass reads two planes and writes one */
+    printf ("bench_numa: %s, %d threads, %d x %d planes, %d passes: "
+        "lines %.3f s, %.2f GB/s; tiles %.3f s, %.2f GB/s\n", argv[1],
+        nthreads, nlines, nsamps, BENCH_NITER, line_elapsed,
+        BENCH_NITER * BENCH_NPLANES * plane_size / line_elapsed / 1.0e9,
+        tile_elapsed,
+        BENCH_NITER * BENCH_NPLANES * plane_size / tile_elapsed / 1.0e9);
+
+    close_tile_sched (sched);
+    close_arena (arena);
+    return (EXIT_SUCCESS);
+}
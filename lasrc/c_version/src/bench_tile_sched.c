@@ -0,0 +1,339 @@
+/*****************************************************************************
+FILE: bench_tile_sched.c
+
+PURPOSE: Measures the load balance and tail latency of the aerosol inversion
+loop under the tile scheduler (tile_sched.c) against the schedules it
+replaced.  Built by 'make bench'.
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+LICENSE TYPE:  NASA Open Source Agreement Version 1.3
+
+NOTES:
+  1. Usage: bench_tile_sched
+  2. The loop is simulated rather than timed, so the numbers for any number
+     of threads can be had from a single core, and they are the same on
+     every run.  Each aerosol window of a synthetic scene is given a cost of
+     SCHED_COST_SKIP, or for a clear window SCHED_COST_INVERSION times a
+     random factor of 0.5 to 1.5, since the inversion takes a varying number
+     of iterations.  The scheduler orders the tiles by its estimate, which
+     doesn't know the factor.
+  3. Three schedules are simulated:
+       lines    the lines split into equal blocks per thread, the default
+                static schedule of the line loop used before the tiles
+       tiles    tiles in scene order with schedule (dynamic, 1)
+       sorted   tiles sorted most expensive first with schedule (dynamic, 1),
+                as done by set_aero_tile_costs
+     With the dynamic schedule, the next tile goes to the first thread to
+     finish its current tile.
+  4. For each schedule, the loop time is reported relative to a perfect split
+     of the total cost (1.00 is perfect), and the tail is the time between
+     the first and the last thread finishing, as a percentage of the loop
+     time.  During the tail some of the cores are idle.
+*****************************************************************************/
+#include <math.h>
+#include "tile_sched.h"
+
+/* Size of the synthetic scenes, that of a Landsat 8 OLI scene */
+#define BENCH_NLINES 7801
+#define BENCH_NSAMPS 7701
+
+/* Numbers of threads simulated */
+static int bench_nthreads[] = {4, 8, 16, 32, 64};
+#define BENCH_NNTHREADS \
+    ((int) (sizeof (bench_nthreads) / sizeof (bench_nthreads[0])))
+
+/* Synthetic scenes: all clear land, a coast with the ocean over the east
+   side, and scattered cloud over about half of the land */
+typedef enum {
+    SCENE_CLEAR=0, SCENE_COAST, SCENE_CLOUD, NSCENES
+} Bench_scene_t;
+static char *scene_names[NSCENES] = {"clear", "coast", "cloud"};
+
+/* Random numbers from a fixed generator, so the scenes are the same on every
+   run */
+static unsigned long seed = 7;
+
+static double next_random ()
+{
+    seed = seed * 1103515245UL + 12345UL;
+    return ((double) ((seed >> 16) & 0x7fff) / 32768.0);
+}
+
+
+/******************************************************************************
+MODULE:  make_scene
+
+PURPOSE:  Fills the aerosol window summary of a synthetic scene, and the
+simulated cost of each window.
+
+RETURN VALUE:
+Type = None
+******************************************************************************/
+static void make_scene
+(
+    Bench_scene_t scene,  /* I: synthetic scene */
+    int nwin_lines,       /* I: number of aerosol window lines */
+    int nwin_samps,       /* I: number of aerosol window samples */
+    uint8 *awin,          /* O: aerosol window summary,
+                                nwin_lines x nwin_samps */
+    double *wcost         /* O: simulated cost of each window,
+                                nwin_lines x nwin_samps */
+)
+{
+    int wline, wsamp;     /* looping variables for the windows */
+    int icloud;           /* looping variable for the clouds */
+    int dl, ds;           /* distance from the cloud center (windows) */
+    int cloud_line[400], cloud_samp[400], cloud_radius[400];  /* clouds */
+    int nclouds = 0;      /* number of clouds */
+    long win;             /* index of the current window */
+    double lfrac, sfrac;  /* line and sample as a fraction of the scene */
+    bool clear;           /* is the current window clear? */
+
+    if (scene == SCENE_CLOUD)
+    {
+        nclouds = 400;
+        for (icloud = 0; icloud < nclouds; icloud++)
+        {
+            cloud_line[icloud] = (int) (next_random () * nwin_lines);
+            cloud_samp[icloud] = (int) (next_random () * nwin_samps);
+            cloud_radius[icloud] = 10 + (int) (next_random () * 60);
+        }
+    }
+
+    for (wline = 0; wline < nwin_lines; wline++)
+    {
+        lfrac = (double) wline / nwin_lines;
+        for (wsamp = 0; wsamp < nwin_samps; wsamp++)
+        {
+            sfrac = (double) wsamp / nwin_samps;
+            win = (long) wline * nwin_samps + wsamp;
+
+            /* Fill outside the footprint of a descending scene */
+            if (sfrac < 0.12 * (1.0 - lfrac) || sfrac > 1.0 - 0.12 * lfrac)
+            {
+                awin[win] = 0;
+                wcost[win] = SCHED_COST_SKIP;
+                continue;
+            }
+
+            clear = true;
+            if (scene == SCENE_COAST &&
+                sfrac > 0.55 + 0.15 * sin (lfrac * 6.0))
+                clear = false;
+            for (icloud = 0; icloud < nclouds && clear; icloud++)
+            {
+                dl = wline - cloud_line[icloud];
+                ds = wsamp - cloud_samp[icloud];
+                if (dl * dl + ds * ds <
+                    cloud_radius[icloud] * cloud_radius[icloud])
+                    clear = false;
+            }
+
+            awin[win] = 1 << AWIN_NON_FILL;
+            if (clear)
+            {
+                awin[win] |= (1 << AWIN_NON_WATER) | (1 << AWIN_CLEAR);
+                wcost[win] = SCHED_COST_INVERSION * (0.5 + next_random ());
+            }
+            else
+                wcost[win] = SCHED_COST_SKIP;
+        }
+    }
+}
+
+
+/******************************************************************************
+MODULE:  tile_cost
+
+PURPOSE:  Returns the simulated cost of a tile, from the windows of the tile
+as counted by set_aero_tile_costs.
+
+RETURN VALUE:
+Type = double
+Value           Description
+-----           -----------
+cost            Simulated cost of the tile
+******************************************************************************/
+static double tile_cost
+(
+    Sched_tile_t *tile,   /* I: tile */
+    double *wcost,        /* I: simulated cost of each window */
+    int nwin_samps        /* I: number of aerosol window samples */
+)
+{
+    int wline, wsamp;     /* looping variables for the windows */
+    double cost = 0.0;    /* cost of the tile */
+
+    for (wline = AERO_NWINDOWS (tile->first_line);
+         wline < AERO_NWINDOWS (tile->end_line); wline++)
+    {
+        for (wsamp = AERO_NWINDOWS (tile->first_samp);
+             wsamp < AERO_NWINDOWS (tile->end_samp); wsamp++)
+            cost += wcost[(long) wline * nwin_samps + wsamp];
+    }
+    return (cost);
+}
+
+
+/******************************************************************************
+MODULE:  run_dynamic
+
+PURPOSE:  Simulates the tiles taken in list order with schedule (dynamic, 1),
+returning the time each thread finishes.
+
+RETURN VALUE:
+Type = None
+******************************************************************************/
+static void run_dynamic
+(
+    Tile_sched_t *sched,  /* I: tile list, in the order the tiles are taken */
+    double *wcost,        /* I: simulated cost of each window */
+    int nwin_samps,       /* I: number of aerosol window samples */
+    int nthreads,         /* I: number of threads */
+    double *finish        /* O: finish time of each thread [nthreads] */
+)
+{
+    int t;                /* looping variable for the tiles */
+    int thread;           /* looping variable for the threads */
+    int next;             /* thread which takes the next tile */
+
+    for (thread = 0; thread < nthreads; thread++)
+        finish[thread] = 0.0;
+    for (t = 0; t < sched->ntiles; t++)
+    {
+        next = 0;
+        for (thread = 1; thread < nthreads; thread++)
+        {
+            if (finish[thread] < finish[next])
+                next = thread;
+        }
+        finish[next] += tile_cost (&sched->tile[t], wcost, nwin_samps);
+    }
+}
+
+
+/******************************************************************************
+MODULE:  run_lines
+
+PURPOSE:  Simulates the window lines split into equal blocks per thread with
+the static schedule, returning the time each thread finishes.
+
+RETURN VALUE:
+Type = None
+******************************************************************************/
+static void run_lines
+(
+    double *wcost,        /* I: simulated cost of each window */
+    int nwin_lines,       /* I: number of aerosol window lines */
+    int nwin_samps,       /* I: number of aerosol window samples */
+    int nthreads,         /* I: number of threads */
+    double *finish        /* O: finish time of each thread [nthreads] */
+)
+{
+    int wline, wsamp;     /* looping variables for the windows */
+    int thread;           /* looping variable for the threads */
+
+    for (thread = 0; thread < nthreads; thread++)
+    {
+        finish[thread] = 0.0;
+        for (wline = (long) thread * nwin_lines / nthreads;
+             wline < (long) (thread + 1) * nwin_lines / nthreads; wline++)
+        {
+            for (wsamp = 0; wsamp < nwin_samps; wsamp++)
+                finish[thread] += wcost[(long) wline * nwin_samps + wsamp];
+        }
+    }
+}
+
+
+/******************************************************************************
+MODULE:  report
+
+PURPOSE:  Prints the loop time and the tail of a schedule.
+
+RETURN VALUE:
+Type = None
+******************************************************************************/
+static void report
+(
+    char *name,           /* I: name of the schedule */
+    double *finish,       /* I: finish time of each thread [nthreads] */
+    int nthreads          /* I: number of threads */
+)
+{
+    int thread;           /* looping variable for the threads */
+    double total = 0.0;   /* total cost */
+    double first = finish[0];   /* first thread to finish */
+    double last = finish[0];    /* last thread to finish */
+
+    for (thread = 0; thread < nthreads; thread++)
+    {
+        total += finish[thread];
+        first = MIN (first, finish[thread]);
+        last = MAX (last, finish[thread]);
+    }
+    printf ("  %-7s %5.2f %5.1f%%", name, last / (total / nthreads),
+        100.0 * (last - first) / last);
+}
+
+
+int main (void)
+{
+    int scene;            /* looping variable for the scenes */
+    int it;               /* looping variable for the numbers of threads */
+    int nwin_lines = AERO_NWINDOWS (BENCH_NLINES);  /* window lines */
+    int nwin_samps = AERO_NWINDOWS (BENCH_NSAMPS);  /* window samples */
+    double finish[64];    /* finish time of each thread */
+    double *wcost = NULL; /* simulated cost of each window */
+    uint8 *awin = NULL;   /* aerosol window summary */
+    Tile_sched_t *scene_order = NULL;   /* tiles in scene order */
+    Tile_sched_t *sorted = NULL;        /* tiles sorted by estimated cost */
+
+    awin = malloc ((long) nwin_lines * nwin_samps * sizeof (uint8));
+    wcost = malloc ((long) nwin_lines * nwin_samps * sizeof (double));
+    if (awin == NULL || wcost == NULL)
+    {
+        printf ("bench_tile_sched: allocating the windows\n");
+        return (EXIT_FAILURE);
+    }
+
+    printf ("bench_tile_sched: %d x %d scene, %d x %d windows, tiles of %d "
+        "windows\n", BENCH_NLINES, BENCH_NSAMPS, nwin_lines, nwin_samps,
+        SCHED_TILE_NWINDOWS);
+    printf ("  loop time relative to a perfect split, and tail as a "
+        "percentage of the loop time\n");
+    for (scene = 0; scene < NSCENES; scene++)
+    {
+        make_scene (scene, nwin_lines, nwin_samps, awin, wcost);
+        scene_order = open_tile_sched (BENCH_NLINES, BENCH_NSAMPS);
+        sorted = open_tile_sched (BENCH_NLINES, BENCH_NSAMPS);
+        if (scene_order == NULL || sorted == NULL)
+            return (EXIT_FAILURE);
+        set_aero_tile_costs (sorted, awin, nwin_samps);
+
+        for (it = 0; it < BENCH_NNTHREADS; it++)
+        {
+            printf ("  %-5s %2d threads:", scene_names[scene],
+                bench_nthreads[it]);
+            run_lines (wcost, nwin_lines, nwin_samps, bench_nthreads[it],
+                finish);
+            report ("lines", finish, bench_nthreads[it]);
+            run_dynamic (scene_order, wcost, nwin_samps, bench_nthreads[it],
+                finish);
+            report ("tiles", finish, bench_nthreads[it]);
+            run_dynamic (sorted, wcost, nwin_samps, bench_nthreads[it],
+                finish);
+            report ("sorted", finish, bench_nthreads[it]);
+            printf ("\n");
+        }
+
+        close_tile_sched (scene_order);
+        close_tile_sched (sorted);
+    }
+
+    free (awin);
+    free (wcost);
+    return (EXIT_SUCCESS);
+}
@@ -0,0 +1,282 @@
+/*****************************************************************************
+FILE: bench_tiled_io.c
+
+PURPOSE: Measures the size and throughput of the tiled output format
+(tiled_io.c) against the raw binary format for a single band.  Built by
+'make bench'.
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+LICENSE TYPE:  NASA Open Source Agreement Version 1.3
+
+NOTES:
+  1. Usage: bench_tiled_io [band.img nlines nsamps]
+     With no arguments, a synthetic 16-bit band the size of a Landsat 8 scene
+     is used.  Otherwise the band is read from the given raw binary file of
+     16-bit pixels (e.g. a surface reflectance band written with
+     --output_format=raw), which gives the numbers for real data.
+  2. The synthetic band has the fill border of a rotated scene footprint,
+     a smoothly varying surface reflectance with pixel noise, and a water body
+     and a cloud, so its compression is only indicative.  The band is the
+     same on every run.
+  3. Each format is written and read back BENCH_NREPEAT times to a temporary
+     file, and the fastest time is reported, so the numbers are mostly those
+     of the page cache rather than the disk.  The tiled band read back is
+     checked to match the band written.
+*****************************************************************************/
+#include <math.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include "tiled_io.h"
+
+/* Size of the synthetic band, that of a Landsat 8 OLI scene */
+#define BENCH_NLINES 7801
+#define BENCH_NSAMPS 7701
+
+/* Number of times each format is written and read */
+#define BENCH_NREPEAT 3
+
+/* Fill value of the surface reflectance bands (FILL_VALUE in output.h) */
+#define BENCH_FILL (-9999)
+
+
+/******************************************************************************
+MODULE:  bench_time
+
+PURPOSE:  Returns the current wall clock time in seconds.
+
+RETURN VALUE:
+Type = double
+Value           Description
+-----           -----------
+time            Seconds since the epoch, to the microsecond
+******************************************************************************/
+static double bench_time ()
+{
+    struct timeval tv;    /* current time */
+
+    gettimeofday (&tv, NULL);
+    return (tv.tv_sec + tv.tv_usec * 1.0e-6);
+}
+
+
+/******************************************************************************
+MODULE:  make_band
+
+PURPOSE:  Fills the synthetic band.
+
+RETURN VALUE:
+Type = None
+******************************************************************************/
+static void make_band
+(
+    int16 *band,          /* O: band data, nlines x nsamps */
+    int nlines,           /* I: number of lines in the band */
+    int nsamps            /* I: number of samples in the band */
+)
+{
+    int line, samp;       /* looping variables for the band */
+    int dl, ds;           /* distance from the water body or cloud center */
+    unsigned long seed = 7;   /* state of the pixel noise generator */
+    double lfrac, sfrac;  /* line and sample as a fraction of the band */
+    double value;         /* reflectance of the current pixel */
+
+    for (line = 0; line < nlines; line++)
+    {
+        lfrac = (double) line / nlines;
+        for (samp = 0; samp < nsamps; samp++)
+        {
+            sfrac = (double) samp / nsamps;
+            seed = seed * 1103515245UL + 12345UL;
+
+            /* Fill outside the footprint, a parallelogram leaning to the
+               right as for a descending scene */
+            if (sfrac < 0.12 * (1.0 - lfrac) || sfrac > 1.0 - 0.12 * lfrac)
+            {
+                band[line * nsamps + samp] = BENCH_FILL;
+                continue;
+            }
+
+            value = 1500.0 + 800.0 * sin (lfrac * 9.0) * cos (sfrac * 7.0) +
+                (double) ((seed >> 16) & 0xff) - 128.0;
+            dl = line - nlines / 3;
+            ds = samp - nsamps / 2;
+            if (dl * dl + ds * ds < 900 * 900)
+                value = 300.0 + (double) ((seed >> 16) & 0x1f);
+            dl = line - 2 * nlines / 3;
+            ds = samp - nsamps / 3;
+            if (dl * dl / 4 + ds * ds < 600 * 600)
+                value = 8000.0 + (double) ((seed >> 16) & 0x1ff);
+            band[line * nsamps + samp] = (int16) value;
+        }
+    }
+}
+
+
+/******************************************************************************
+MODULE:  file_size
+
+PURPOSE:  Returns the size of a file.
+
+RETURN VALUE:
+Type = long
+Value           Description
+-----           -----------
+-1              Error getting the size
+>= 0            Size of the file in bytes
+******************************************************************************/
+static long file_size
+(
+    char *file_name       /* I: name of the file */
+)
+{
+    FILE *fp = NULL;      /* file pointer */
+    long size;            /* size of the file */
+
+    fp = fopen (file_name, "r");
+    if (fp == NULL)
+        return (-1);
+    fseek (fp, 0, SEEK_END);
+    size = ftell (fp);
+    fclose (fp);
+    return (size);
+}
+
+
+int main (int argc, char *argv[])
+{
+    char raw_file[] = "/tmp/bench_tiled_io_XXXXXX";   /* raw binary band */
+    char tiled_file[STR_SIZE];   /* tiled band */
+    int fd;               /* file descriptor of the temporary file */
+    int i;                /* looping variable for the repeats */
+    int nlines = BENCH_NLINES;   /* number of lines in the band */
+    int nsamps = BENCH_NSAMPS;   /* number of samples in the band */
+    long band_size;       /* size of the band in bytes */
+    long out_size;        /* size of the tiled band in bytes */
+    double start;         /* start time of the current repeat */
+    double raw_write = 1e30, raw_read = 1e30;       /* fastest raw times */
+    double tiled_write = 1e30, tiled_read = 1e30;   /* fastest tiled times */
+    double mbytes;        /* size of the band in MB */
+    int16 *band = NULL;   /* band data */
+    int16 *check = NULL;  /* band data read back */
+    FILE *fp = NULL;      /* file pointer */
+    Tiled_band_t *tiled = NULL;  /* tiled band read back */
+
+    if (argc != 1 && argc != 4)
+    {
+        printf ("Usage: bench_tiled_io [band.img nlines nsamps]\n");
+        return (EXIT_FAILURE);
+    }
+    if (argc == 4)
+    {
+        nlines = atoi (argv[2]);
+        nsamps = atoi (argv[3]);
+    }
+    band_size = (long) nlines * nsamps * sizeof (int16);
+    mbytes = band_size / (1024.0 * 1024.0);
+
+    band = malloc (band_size);
+    check = malloc (band_size);
+    if (band == NULL || check == NULL)
+    {
+        printf ("bench_tiled_io: allocating %d x %d band\n", nlines, nsamps);
+        return (EXIT_FAILURE);
+    }
+    if (argc == 4)
+    {
+        fp = fopen (argv[1], "r");
+        if (fp == NULL || fread (band, band_size, 1, fp) != 1)
+        {
+            printf ("bench_tiled_io: reading %d x %d band from %s\n", nlines,
+                nsamps, argv[1]);
+            return (EXIT_FAILURE);
+        }
+        fclose (fp);
+    }
+    else
+        make_band (band, nlines, nsamps);
+
+    fd = mkstemp (raw_file);
+    if (fd < 0)
+    {
+        printf ("bench_tiled_io: creating the temporary file\n");
+        return (EXIT_FAILURE);
+    }
+    close (fd);
+    snprintf (tiled_file, sizeof (tiled_file), "%s.%s", raw_file,
+        TILED_EXTENSION);
+
+    for (i = 0; i < BENCH_NREPEAT; i++)
+    {
+        /* Raw binary band */
+        start = bench_time ();
+        fp = fopen (raw_file, "w");
+        if (fp == NULL || fwrite (band, band_size, 1, fp) != 1 ||
+            fclose (fp) != 0)
+        {
+            printf ("bench_tiled_io: writing %s\n", raw_file);
+            return (EXIT_FAILURE);
+        }
+        raw_write = MIN (raw_write, bench_time () - start);
+
+        start = bench_time ();
+        fp = fopen (raw_file, "r");
+        if (fp == NULL || fread (check, band_size, 1, fp) != 1)
+        {
+            printf ("bench_tiled_io: reading %s\n", raw_file);
+            return (EXIT_FAILURE);
+        }
+        fclose (fp);
+        raw_read = MIN (raw_read, bench_time () - start);
+
+        /* Tiled band */
+        start = bench_time ();
+        fp = fopen (tiled_file, "w");
+        if (fp == NULL || write_tiled_band (fp, band, nsamps, nlines, nsamps,
+            sizeof (int16), DEFAULT_TILE_SIZE, DEFAULT_TILE_LEVEL, &out_size)
+            != SUCCESS || fclose (fp) != 0)
+        {
+            printf ("bench_tiled_io: writing %s\n", tiled_file);
+            return (EXIT_FAILURE);
+        }
+        tiled_write = MIN (tiled_write, bench_time () - start);
+
+        memset (check, 0, band_size);
+        start = bench_time ();
+        tiled = open_tiled_band (tiled_file);
+        if (tiled == NULL ||
+            read_tiled_lines (tiled, 0, nlines, check) != SUCCESS)
+        {
+            printf ("bench_tiled_io: reading %s\n", tiled_file);
+            return (EXIT_FAILURE);
+        }
+        close_tiled_band (tiled);
+        tiled_read = MIN (tiled_read, bench_time () - start);
+
+        if (memcmp (band, check, band_size))
+        {
+            printf ("bench_tiled_io: the tiled band read back differs from "
+                "the band written\n");
+            return (EXIT_FAILURE);
+        }
+    }
+
+    printf ("bench_tiled_io: %d x %d 16-bit band (%s), %d repeats, "
+        "tile %d, level %d\n", nlines, nsamps, argc == 4 ? argv[1] :
+        "synthetic", BENCH_NREPEAT, DEFAULT_TILE_SIZE, DEFAULT_TILE_LEVEL);
+    printf ("  format  size (bytes)  ratio  write (s)  MB/s  read (s)  "
+        "MB/s\n");
+    printf ("  raw    %13ld  %5.2f  %9.3f  %4.0f  %8.3f  %4.0f\n",
+        file_size (raw_file), (double) band_size / file_size (raw_file),
+        raw_write, mbytes / raw_write, raw_read, mbytes / raw_read);
+    printf ("  tiled  %13ld  %5.2f  %9.3f  %4.0f  %8.3f  %4.0f\n",
+        out_size, (double) band_size / out_size, tiled_write,
+        mbytes / tiled_write, tiled_read, mbytes / tiled_read);
+
+    unlink (raw_file);
+    unlink (tiled_file);
+    free (band);
+    free (check);
+    return (EXIT_SUCCESS);
+}
@@ -0,0 +1,60 @@
+/*****************************************************************************
+FILE: check_stubs.c
+
+PURPOSE: Stands in for the routines of the main program (lasrc.c) used by the
+other LaSRC objects, so the checks and benchmarks built by 'make check' and
+'make bench' can be linked without it.
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+LICENSE TYPE:  NASA Open Source Agreement Version 1.3
+
+NOTES:
+  1. process_scene is only reached by the batch and spool workers, and none
+     of the checks get that far, so it just fails.  btest is used by the
+     corrections, so it's the same as in lasrc.c.
+*****************************************************************************/
+#include "lasrc.h"
+
+/* Stub for process_scene, which none of the checks reach */
+int process_scene
+(
+    char *xml_infile,
+    Espa_internal_meta_t *xml_metadata,
+    Sr_tables_t *tables,
+    Aux_grid_t *aux,
+    bool process_sr,
+    bool write_toa,
+    int prefetch_depth,
+    int angle_decimation,
+    Myformat_t output_format,
+    int max_memory,
+    Window_t *window,
+    int quicklook,
+    bool checkpoint,
+    bool numa,
+    bool verbose
+)
+{
+    return (ERROR);
+}
+
+
+/* Stub for usage, which is printed by get_args for a bad argument */
+void usage ()
+{
+    printf ("usage: see lasrc --help\n");
+}
+
+
+/* Same as btest in lasrc.c */
+bool btest
+(
+    uint8 byte_val,   /* I: byte value to be tested with the bit n */
+    byte n            /* I: bit number to be tested (0 is rightmost bit) */
+)
+{
+    /* Take 2 ** n, then AND that result with the byte value */
+    return (byte_val & (1 << n));
+}
@@ -34,6 +34,12 @@ typedef char byte;
 #define AERO_WINDOW 3
 #define HALF_AERO_WINDOW 1
 
+/* Number of aerosol windows needed to cover n lines or samples.  Each window
+   is represented by its center pixel, so a partial window at the end of the
+   lines/samples is only counted if it contains its center pixel. */
+#define AERO_NWINDOWS(n) (((n) + AERO_WINDOW - 1 - HALF_AERO_WINDOW) / \
+    AERO_WINDOW)
+
 /* How many lines of data should be processed at one time */
 #define PROC_NLINES 10
 
@@ -129,6 +135,25 @@ typedef enum {
   AERO2_QA=7     /* reflect the level of atmospheric correction made    = 128 */
 } Ipflag_t;
 
+/* Bit values of the per-pixel class plane, which holds the Level-1 QA and
+   water tests used to select the pixel for each aerosol window */
+typedef enum {
+  PCLASS_FILL=0,            /* fill pixel in the Level-1 QA */
+  PCLASS_CLOUD=1,           /* high confidence cloud or cirrus in the
+                               Level-1 QA */
+  PCLASS_SHADOW=2,          /* high confidence cloud shadow in the Level-1 QA */
+  PCLASS_WATER=3            /* water pixel, based on the band 4/5 NDVI */
+} Pclass_t;
+
+/* Bit values of the aerosol window summary, which flags whether any pixel in
+   the window can be used by each of the aerosol window pixel searches */
+typedef enum {
+  AWIN_NON_FILL=0,          /* window has a non-fill pixel */
+  AWIN_NON_WATER=1,         /* window has a non-fill, non-water pixel */
+  AWIN_CLEAR=2              /* window has a non-fill, non-water, non-cloud,
+                               non-shadow pixel */
+} Awin_t;
+
 /* Satellite type definitions, mainly to allow future satellites to be
    supported if needed */
 typedef enum {
@@ -24,6 +24,9 @@ at the USGS EROS
 NOTES:
   1. These TOA and BT algorithms match those as published by the USGS Landsat
      team in http://landsat.usgs.gov/Landsat8_Using_Product.php
+  2. The solar zenith is the only per-pixel angle used by the TOA
+     corrections.  If the angle band is decimated, the angle is bilinearly
+     interpolated for each pixel.
 ******************************************************************************/
 int compute_toa_refl
 (
@@ -34,18 +37,23 @@ int compute_toa_refl
     int nlines,         /* I: number of lines in reflectance, thermal bands */
     int nsamps,         /* I: number of samps in reflectance, thermal bands */
     char *instrument,   /* I: instrument to be processed (OLI, TIRS) */
-    int16 *sza,         /* I: scaled per-pixel solar zenith angles (degrees),
-                              nlines x nsamps */
+    Angle_band_t *sza,  /* I: scaled per-pixel solar zenith angles (degrees),
+                              full resolution or decimated */
     int16 **sband,      /* O: output TOA reflectance and brightness temp
                               values (scaled) */
-    uint16 *radsat      /* O: radiometric saturation QA band, nlines x nsamps;
+    uint16 *radsat,     /* O: radiometric saturation QA band, nlines x nsamps;
                               array should be all zeros on input to this
                               routine*/
+    int prefetch_depth, /* I: number of input bands to read ahead of the
+                              band being calibrated */
+    Arena_t *arena      /* I/O: arena for the scene */
 )
 {
     char errmsg[STR_SIZE];                   /* error message */
     char FUNC_NAME[] = "compute_toa_refl";   /* function name */
     int i;               /* looping variable for pixels */
+    int ireq;            /* current band read request */
+    int nreads;          /* number of band read requests */
     int line, samp;      /* looping variables for lines and samples */
     int ib;              /* looping variable for input bands */
     int sband_ib;        /* looping variable for output bands */
@@ -62,21 +70,48 @@ int compute_toa_refl
     float k2b11;         /* K2 temperature constant for band 11 */
     float xmus;          /* cosine of solar zenith angle (per-pixel) */
     uint16 *uband = NULL;  /* array for input image data for a single band,
-                              nlines x nsamps */
+                              nlines x nsamps; owned by the prefetcher */
+    Band_read_t reads[NBAND_TTL_MAX];  /* list of bands to be read */
+    Prefetch_t *prefetch = NULL;       /* band prefetcher */
     time_t mytime;       /* time variable */
 
     /* Start the processing */
     mytime = time(NULL);
     printf ("Start TOA reflectance corrections: %s", ctime(&mytime));
 
-    /* Allocate memory for band data */
-    uband = calloc (nlines*nsamps, sizeof (uint16));
-    if (uband == NULL)
+    /* Set up the list of bands to be read, in the order they are calibrated
+       below.  Reflectance bands 1-7 and 9 (the pan band is skipped), followed
+       by the thermal bands if this isn't an OLI-only scene. */
+    nreads = 0;
+    for (ib = DN_BAND1; ib <= DN_BAND9; ib++)
     {
-        sprintf (errmsg, "Error allocating memory for uband");
+        if (ib == DN_BAND8)
+            continue;
+        reads[nreads].thermal = false;
+        reads[nreads].iband = (ib <= DN_BAND7) ? ib : ib - 1;
+        nreads++;
+    }
+    if (strcmp (instrument, "OLI"))
+    {
+        for (i = 0; i < NBAND_THM_MAX; i++)
+        {
+            reads[nreads].thermal = true;
+            reads[nreads].iband = i;
+            nreads++;
+        }
+    }
+
+    /* Start reading the bands in the background so the next band is read
+       while the current band is calibrated */
+    prefetch = open_prefetch (input, nreads, reads, prefetch_depth, nlines,
+        nsamps, arena);
+    if (prefetch == NULL)
+    {
+        sprintf (errmsg, "Error starting the band prefetcher");
         error_handler (true, FUNC_NAME, errmsg);
         return (ERROR);
     }
+    ireq = 0;
 
     /* Loop through all the bands (except the pan band) and compute the TOA
        reflectance and TOA brightness temp */
@@ -103,11 +138,12 @@ int compute_toa_refl
                 sband_ib = ib - 1;
             }
 
-            if (get_input_refl_lines (input, iband, 0, nlines, uband) !=
-                SUCCESS)
+            uband = get_prefetch_band (prefetch, ireq);
+            if (uband == NULL)
             {
                 sprintf (errmsg, "Reading band %d", ib+1);
                 error_handler (true, FUNC_NAME, errmsg);
+                close_prefetch (prefetch);
                 return (ERROR);
             }
 
@@ -130,7 +166,8 @@ int compute_toa_refl
                         /* Compute the TOA reflectance based on the per-pixel
                            sun angle (need to unscale). Scale the TOA value for
                            output. */
-                        xmus = cos(sza[i] * 0.01 * DEG2RAD);
+                        xmus = cos(get_angle (sza, line, samp) * 0.01 *
+                            DEG2RAD);
                         rotoa = (uband[i] * refl_mult) + refl_add;
                         rotoa = rotoa * MULT_FACTOR / xmus;
     
@@ -155,16 +192,21 @@ int compute_toa_refl
                     }
                 }  /* for samp */
             }  /* for line */
+
+            /* Done with this band; let the prefetcher reuse the buffer */
+            release_prefetch_band (prefetch, ireq++);
         }  /* end if band <= band 9 */
 
         /* Read the current band and calibrate thermal bands.  Not available
            for OLI-only scenes. */
         else if (ib == DN_BAND10 && strcmp (instrument, "OLI"))
         {
-            if (get_input_th_lines (input, 0, 0, nlines, uband) != SUCCESS)
+            uband = get_prefetch_band (prefetch, ireq);
+            if (uband == NULL)
             {
                 sprintf (errmsg, "Reading band %d", ib+1);
                 error_handler (true, FUNC_NAME, errmsg);
+                close_prefetch (prefetch);
                 return (ERROR);
             }
 
@@ -210,14 +252,19 @@ int compute_toa_refl
                     radsat[i] = RADSAT_FILL_VALUE;
                 }
             }
+
+            /* Done with this band; let the prefetcher reuse the buffer */
+            release_prefetch_band (prefetch, ireq++);
         }  /* end if band 10 */
 
         else if (ib == DN_BAND11 && strcmp (instrument, "OLI"))
         {
-            if (get_input_th_lines (input, 1, 0, nlines, uband) != SUCCESS)
+            uband = get_prefetch_band (prefetch, ireq);
+            if (uband == NULL)
             {
                 sprintf (errmsg, "Reading band %d", ib+1);
                 error_handler (true, FUNC_NAME, errmsg);
+                close_prefetch (prefetch);
                 return (ERROR);
             }
 
@@ -263,12 +310,21 @@ int compute_toa_refl
                     radsat[i] = RADSAT_FILL_VALUE;
                 }
             }
+
+            /* Done with this band; let the prefetcher reuse the buffer */
+            release_prefetch_band (prefetch, ireq++);
         }  /* end if band 11 */
     }  /* end for ib */
     printf ("\n");
 
-    /* The input data has been read and calibrated. The memory can be freed. */
-    free (uband);
+    /* The input data has been read and calibrated. Stop the prefetcher and
+       free the band buffers. */
+    if (close_prefetch (prefetch) != SUCCESS)
+    {
+        sprintf (errmsg, "Error reading the input bands");
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
 
     /* Successful completion */
     mytime = time(NULL);
@@ -307,40 +363,56 @@ NOTES:
    clear (valid land pixel aerosols) and water (valid water pixel aerosols).
    Those final aerosol values are used for the surface reflectance corrections.
 5. Cloud-based QA information is not processed in this algorithm.
+6. The aerosol inversion, aerosol interpolation, and atmospheric correction
+   loops are scheduled over tiles of the scene, most expensive first, rather
+   than over lines (see tile_sched.c).
+7. When only a window of the scene was read (see set_input_window), the
+   pixels are located in the full scene using the line/sample offsets of
+   the window, and the scene center and auxiliary tiles come from the full
+   scene.  The median aerosol used for the cloud, shadow, and water pixels
+   and the failed windows is that of the full scene when it's carried in
+   with the window (printed by a full scene run); otherwise it's found over
+   the pixels read, and these pixels don't match a full scene run.
+8. For a quick look (see set_input_quicklook) the same corrections are run
+   on the reduced grid, with the aerosol windows made of reduced pixels.
+9. With a checkpoint file, the aerosol window centers are written to it after
+   the inversion.  If it already holds the window centers for the same
+   inversion inputs, they are restored and the inversion is skipped; the
+   median aerosol and the interpolation are always redone from the window
+   centers (see aero_ckpt.c).
 ******************************************************************************/
 int compute_sr_refl
 (
     Input_t *input,     /* I: input structure for the Landsat product */
     Espa_internal_meta_t *xml_metadata,
                         /* I: XML metadata structure */
-    char *xml_infile,   /* I: input XML filename */
+    Espa_internal_meta_t *out_metadata,
+                        /* I: XML metadata structure for the output
+                              products; differs from xml_metadata when only
+                              a window of the scene is output */
+    Write_behind_t *writer,  /* I: write-behind engine for the output
+                              bands */
+    Myformat_t output_format,  /* I: file format for the SR output bands */
     uint16 *qaband,     /* I: QA band for the input image, nlines x nsamps */
     int nlines,         /* I: number of lines in reflectance, thermal bands */
     int nsamps,         /* I: number of samps in reflectance, thermal bands */
     float pixsize,      /* I: pixel size for the reflectance bands */
     int16 **sband,      /* I/O: input TOA and output surface reflectance */
-    int16 *sza,         /* I: scaled per-pixel solar zenith angles (degrees),
-                              nlines x nsamps */
-    int16 *saa,         /* I: scaled per-pixel solar azimuth angles (degrees),
-                              nlines x nsamps */
-    int16 *vza,         /* I: scaled per-pixel view zenith angles (degrees),
-                              nlines x nsamps */
-    int16 *vaa,         /* I: scaled per-pixel view azimuth angles (degrees),
-                              nlines x nsamps */
     float xts,          /* I: scene center solar zenith angle (deg) */
     float xmus,         /* I: cosine of solar zenith angle */
-    char *anglehdf,     /* I: angle HDF filename */
-    char *intrefnm,     /* I: intrinsic reflectance filename */
-    char *transmnm,     /* I: transmission filename */
-    char *spheranm,     /* I: spherical albedo filename */
-    char *cmgdemnm,     /* I: climate modeling grid DEM filename */
-    char *rationm,      /* I: ratio averages filename */
-    char *auxnm         /* I: auxiliary filename for ozone and water vapor */
+    Sr_tables_t *tables,  /* I: static look-up tables and climate modeling
+                                grids */
+    Aux_grid_t *aux,    /* I: ozone and water vapor grid for the scene date */
+    char *ckpt_file,    /* I: aerosol checkpoint file for the scene; NULL
+                              if the aerosol inversion isn't checkpointed */
+    Arena_t *arena      /* I/O: arena for the scene */
 )
 {
     char errmsg[STR_SIZE];                   /* error message */
     char FUNC_NAME[] = "compute_sr_refl";   /* function name */
     int retval;          /* return status */
+    size_t sr_mark;      /* arena mark for the surface reflectance arrays */
+    size_t aero_mark;    /* arena mark for the aerosol inversion arrays */
     int i, j;            /* looping variable for pixels */
     int ib;              /* looping variable for input bands */
     int iband;           /* current band */
@@ -372,10 +444,10 @@ int compute_sr_refl
 
     int iband1, iband3; /* band indices (zero-based) */
     float raot;         /* AOT reflectance */
-    float sraot1, sraot2, sraot3;
+    float sraot[NAERO_EPS];
                         /* raot values for three different eps values */
     float residual;     /* model residual */
-    float residual1, residual2, residual3;
+    float sresidual[NAERO_EPS];
                         /* residuals for 3 different eps values */
     float rsurf;        /* surface reflectance */
     float corf;         /* aerosol impact (higher values represent high
@@ -383,8 +455,21 @@ int compute_sr_refl
     float ros4,ros5;    /* surface reflectance for bands 4 and 5 */
     int tmp_percent;      /* current percentage for printing status */
 #ifndef _OPENMP
-    int curr_tmp_percent; /* percentage for current line */
+    int curr_tmp_percent; /* percentage for current tile */
 #endif
+    int t;                /* looping variable for the scheduling tiles */
+    int iwin;             /* looping variable for the aerosol windows in the
+                             current tile */
+    int tile_wline;       /* first aerosol window line of the current tile */
+    int tile_wsamp;       /* first aerosol window samp of the current tile */
+    int tile_nwin_samps;  /* number of aerosol window samps in the current
+                             tile */
+    int ninv_tiles;       /* number of tiles for the aerosol inversion to
+                             process; 0 if restored from the checkpoint */
+    Sched_tile_t *tile = NULL;   /* current scheduling tile */
+    Tile_sched_t *aero_tiles = NULL;  /* tiles for the aerosol inversion */
+    Tile_sched_t *pixel_tiles = NULL; /* tiles for the aerosol interpolation
+                                         and atmospheric correction */
 
     float lat, lon;       /* pixel lat, long location */
     int lcmg, scmg;       /* line/sample index for the CMG */
@@ -408,6 +493,22 @@ int compute_sr_refl
                              line, samp+1; line+1, samp; and line+1, samp+1 */
 #endif
     float median_aerosol; /* median aerosol value for clear pixels */
+    bool restored = false;  /* were the aerosol window centers restored from
+                               the checkpoint? */
+    Aero_ckpt_header_t ckpt_hdr;  /* aerosol checkpoint header for the
+                                     inversion inputs */
+    void *ckpt_inputs[AERO_CKPT_NINPUTS];  /* inversion inputs hashed for the
+                                              checkpoint */
+    size_t ckpt_nbytes[AERO_CKPT_NINPUTS]; /* size (bytes) of each inversion
+                                              input */
+    size_t npix;          /* number of pixels in the scene arrays */
+    int nwin_lines;       /* number of aerosol window lines */
+    int nwin_samps;       /* number of aerosol window samps */
+    uint8 summary;        /* summary bits for the current aerosol window */
+    uint8 *pclass = NULL; /* class plane for selecting the aerosol window
+                             pixel, nlines x nsamps */
+    uint8 *awin = NULL;   /* aerosol window summary,
+                             nwin_lines x nwin_samps */
     uint8 *ipflag = NULL; /* QA flag to assist with aerosol interpolation,
                              nlines x nsamps */
     float *twvi = NULL;   /* interpolated water vapor value,
@@ -435,7 +536,10 @@ int compute_sr_refl
 
     /* Lookup table variables */
     float eps;           /* angstrom coefficient */
-    float eps1, eps2, eps3;  /* eps values for three runs */
+    float aero_eps[NAERO_EPS] = {1.0, 1.75, 2.5};
+                         /* eps values for three runs */
+    double aero_fact[NSR_BANDS][NAERO_EPS];
+                         /* angstrom factors for the three eps values */
     float xtv;           /* observation zenith angle (deg) */
     float xmuv;          /* cosine of observation zenith angle */
     float xfi;           /* azimuthal difference between the sun and
@@ -464,8 +568,8 @@ int compute_sr_refl
                               [NVIEW_ZEN_VALS x NSOLAR_ZEN_VALS] */
     float *ttv = NULL;     /* view angle table
                               [NVIEW_ZEN_VALS x NSOLAR_ZEN_VALS] */
-    float tts[22];         /* sun angle table */
-    int32 indts[22];       /* index for sun angle table */
+    float *tts = NULL;     /* sun angle table [22] */
+    int32 *indts = NULL;   /* index for sun angle table [22] */
     int iaots;             /* index for AOTs */
 
     /* Atmospheric correction coefficient variables */
@@ -486,31 +590,17 @@ int compute_sr_refl
 
     /* Auxiliary file variables */
     int16 *dem = NULL;        /* CMG DEM data array [DEM_NBLAT x DEM_NBLON] */
-    int16 *andwi = NULL;      /* avg NDWI [RATIO_NBLAT x RATIO_NBLON] */
-    int16 *sndwi = NULL;      /* standard NDWI [RATIO_NBLAT x RATIO_NBLON] */
-    int16 *ratiob1 = NULL;    /* mean band1 ratio [RATIO_NBLAT x RATIO_NBLON] */
-    int16 *ratiob2 = NULL;    /* mean band2 ratio [RATIO_NBLAT x RATIO_NBLON] */
-    int16 *ratiob7 = NULL;    /* mean band7 ratio [RATIO_NBLAT x RATIO_NBLON] */
-    int16 *intratiob1 = NULL;   /* intercept band1 ratio,
-                                   RATIO_NBLAT x RATIO_NBLON */
-    int16 *intratiob2 = NULL;   /* intercept band2 ratio
-                                   RATIO_NBLAT x RATIO_NBLON */
-    int16 *intratiob7 = NULL;   /* intercept band7 ratio
-                                   RATIO_NBLAT x RATIO_NBLON */
-    int16 *slpratiob1 = NULL;   /* slope band1 ratio
-                                   RATIO_NBLAT x RATIO_NBLON */
-    int16 *slpratiob2 = NULL;   /* slope band2 ratio
-                                   RATIO_NBLAT x RATIO_NBLON */
-    int16 *slpratiob7 = NULL;   /* slope band7 ratio
-                                   RATIO_NBLAT x RATIO_NBLON */
+    Ratio_rec_t *ratio = NULL;  /* packed band ratio records
+                                   [RATIO_NBLAT x RATIO_NBLON] */
+    Ratio_rec_t *rec11, *rec12, *rec21, *rec22;  /* band ratio records at
+                           line,samp; line, samp+1; line+1, samp; and line+1,
+                           samp+1 */
     uint16 *wv = NULL;       /* water vapor values [CMG_NBLAT x CMG_NBLON] */
     uint8 *oz = NULL;        /* ozone values [CMG_NBLAT x CMG_NBLON] */
     float raot550nm;    /* nearest input value of AOT */
     float uoz;          /* total column ozone */
     float uwv;          /* total column water vapor (precipital water vapor) */
     float pres;         /* surface pressure */
-    float rb1;          /* band ratio 1 (unscaled) */
-    float rb2;          /* band ratio 2 (unscaled) */
     float slpr11, slpr12, slpr21, slpr22;  /* band ratio slope at line,samp;
                            line, samp+1; line+1, samp; and line+1, samp+1 */
     float intr11, intr12, intr21, intr22;  /* band ratio intercept at line,samp;
@@ -539,9 +629,6 @@ int compute_sr_refl
     time_t mytime;               /* timing variable */
     Output_t *sr_output = NULL;  /* output structure and metadata for the SR
                                     product */
-    Envi_header_t envi_hdr;      /* output ENVI header information */
-    char envi_file[STR_SIZE];    /* ENVI filename */
-    char *cptr = NULL;           /* pointer to the file extension */
 
     /* Table constants */
     float aot550nm[NAOT_VALS] =  /* AOT look-up table */
@@ -584,12 +671,11 @@ int compute_sr_refl
     printf ("Start surface reflectance corrections: %s", ctime(&mytime));
 
     /* Allocate memory for the many arrays needed to do the surface reflectance
-       computations */
-    retval = memory_allocation_sr (nlines, nsamps, &aerob1, &aerob2, &aerob4,
-        &aerob5, &aerob7, &ipflag, &twvi, &tozi, &tp, &taero, &teps, &dem,
-        &andwi, &sndwi, &ratiob1, &ratiob2, &ratiob7, &intratiob1, &intratiob2,
-        &intratiob7, &slpratiob1, &slpratiob2, &slpratiob7, &wv, &oz, &rolutt,
-        &transt, &sphalbt, &normext, &tsmax, &tsmin, &nbfic, &nbfi, &ttv);
+       computations.  The aerosol inversion arrays are allocated last so they
+       can be released as soon as the inversion is done. */
+    sr_mark = arena_mark (arena);
+    retval = memory_allocation_sr (arena, nlines, nsamps, &ipflag, &twvi,
+        &tozi, &tp, &taero, &teps);
     if (retval != SUCCESS)
     {
         sprintf (errmsg, "Error allocating memory for the data arrays needed "
@@ -598,6 +684,37 @@ int compute_sr_refl
         return (ERROR);
     }
 
+    aero_mark = arena_mark (arena);
+    retval = memory_allocation_aero (arena, nlines, nsamps, &aerob1, &aerob2,
+        &aerob4, &aerob5, &aerob7, &pclass, &awin);
+    if (retval != SUCCESS)
+    {
+        sprintf (errmsg, "Error allocating memory for the data arrays needed "
+            "for the aerosol inversion.");
+        error_handler (false, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    /* The look-up tables and climate modeling grids have already been read,
+       and may be shared with other scenes */
+    xtsstep = tables->xtsstep;
+    xtsmin = tables->xtsmin;
+    rolutt = tables->rolutt;
+    transt = tables->transt;
+    sphalbt = tables->sphalbt;
+    normext = tables->normext;
+    tsmax = tables->tsmax;
+    tsmin = tables->tsmin;
+    nbfic = tables->nbfic;
+    nbfi = tables->nbfi;
+    ttv = tables->ttv;
+    tts = tables->tts;
+    indts = tables->indts;
+    dem = tables->dem;
+    ratio = tables->ratio;
+    wv = aux->wv;
+    oz = aux->oz;
+
     /* Initialize the geolocation space applications */
     if (!get_geoloc_info (xml_metadata, &space_def))
     {
@@ -606,6 +723,17 @@ int compute_sr_refl
         return (ERROR);
     }
 
+    /* The pixels of a quick look cover blocks of full resolution pixels
+       starting at the same corner, so locate them with the larger pixel
+       size */
+    if (input->quicklook > 1)
+    {
+        space_def.pixel_size[0] *= input->quicklook;
+        space_def.pixel_size[1] *= input->quicklook;
+        space_def.img_size.l = input->scene_nlines;
+        space_def.img_size.s = input->scene_nsamps;
+    }
+
     space = setup_mapping (&space_def);
     if (space == NULL)
     {
@@ -614,28 +742,47 @@ int compute_sr_refl
         return (ERROR);
     }
 
-    /* Initialize the look up tables and atmospheric correction variables
+    /* Read the ozone and water vapor covering the scene, if the auxiliary
+       grid is being read by tiles */
+    retval = load_scene_aux (input->scene_nlines, input->scene_nsamps,
+        space, aux);
+    if (retval != SUCCESS)
+    {
+        sprintf (errmsg, "Reading the ozone and water vapor for the scene");
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    /* Initialize the atmospheric correction variables
        view zenith initialized to 0.0 (xtv)
        azimuthal difference between sun and obs angle initialize to 0.0 (xfi)
        surface pressure is initialized to the pressure at the center of the
            scene (using the DEM) (pres)
        water vapor is initialized to the value at the center of the scene (uwv)
-       ozone is initialized to the value at the center of the scene (uoz) */
-    retval = init_sr_refl (nlines, nsamps, input, space, anglehdf, intrefnm,
-        transmnm, spheranm, cmgdemnm, rationm, auxnm, &eps, &iaots, &xtv,
-        &xmuv, &xfi, &cosxfi, &raot550nm, &pres, &uoz, &uwv, &xtsstep,
-        &xtsmin, &xtvstep, &xtvmin, tsmax, tsmin, tts, ttv, indts, rolutt,
-        transt, sphalbt, normext, nbfic, nbfi, dem, andwi, sndwi, ratiob1,
-        ratiob2, ratiob7, intratiob1, intratiob2, intratiob7, slpratiob1,
-        slpratiob2, slpratiob7, wv, oz);
+       ozone is initialized to the value at the center of the scene (uoz)
+       The whole scene is used even if only a window of it was read, so the
+       window matches the same pixels of the full scene. */
+    retval = init_sr_refl (input->scene_nlines, input->scene_nsamps, input,
+        space, dem, wv, oz, &eps, &iaots, &xtv, &xmuv, &xfi, &cosxfi,
+        &raot550nm, &pres, &uoz, &uwv, &xtvstep, &xtvmin);
     if (retval != SUCCESS)
     {
-        sprintf (errmsg, "Error initializing the lookup tables and "
-            "atmospheric correction variables.");
+        sprintf (errmsg, "Error initializing the atmospheric correction "
+            "variables.");
         error_handler (false, FUNC_NAME, errmsg);
         return (ERROR);
     }
 
+    /* The TOA bands may still be being written in the background from the
+       same sband arrays.  Make sure they are done before the arrays are
+       overwritten with the corrected values. */
+    if (wait_band_writes (writer) != SUCCESS)
+    {
+        sprintf (errmsg, "Writing the TOA output data");
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
     /* Loop through all the reflectance bands and perform atmospheric
        corrections based on climatology */
     mytime = time(NULL);
@@ -801,9 +948,6 @@ int compute_sr_refl
     }
 
 #ifdef INTERP_AUX
-/* TODO -- if the auxiliary data interpolation is taken out, then these
-   variables can be removed from the memory initialization as well - tozi,
-   twvi, tp */
     /* Interpolate the auxiliary data for each pixel location */
     mytime = time(NULL);
     printf ("Interpolating the auxiliary data ... %s", ctime(&mytime));
@@ -839,8 +983,8 @@ int compute_sr_refl
             }
 
             /* Get the lat/long for the current pixel */
-            img.l = i - 0.5;
-            img.s = j + 0.5;
+            img.l = input->line0 + i - 0.5;
+            img.s = input->samp0 + j + 0.5;
             img.is_fill = false;
             if (!from_space (space, &img, &geo))
             {
@@ -999,19 +1143,80 @@ int compute_sr_refl
 #endif
 #endif
 
+    /* Decode the QA and water tests for each pixel, and summarize them for
+       each aerosol window, so the window pixel searches only read one byte
+       per pixel and are skipped when they can't succeed */
+    nwin_lines = AERO_NWINDOWS (nlines);
+    nwin_samps = AERO_NWINDOWS (nsamps);
+    compute_pixel_class (qaband, sband, nlines, nsamps, pclass);
+    summarize_aero_windows (pclass, nlines, nsamps, nwin_lines, nwin_samps,
+        awin);
+
+    /* Split the scene into tiles for the aerosol inversion, interpolation,
+       and atmospheric correction loops, and estimate the cost of each tile
+       while the class plane is available.  The threads take the tiles most
+       expensive first, so the cheap fill, cloud, and water tiles are left to
+       balance the end of each loop. */
+    aero_tiles = open_tile_sched (nlines, nsamps);
+    pixel_tiles = open_tile_sched (nlines, nsamps);
+    if (aero_tiles == NULL || pixel_tiles == NULL)
+    {
+        sprintf (errmsg, "Error setting up the scheduling tiles");
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+    set_aero_tile_costs (aero_tiles, awin, nwin_samps);
+    set_pixel_tile_costs (pixel_tiles, pclass, nsamps);
+
+    /* Restore the aerosol window centers from the checkpoint if it was
+       written for the same inversion inputs */
+    ninv_tiles = aero_tiles->ntiles;
+    if (ckpt_file != NULL)
+    {
+        npix = (size_t) nlines * nsamps;
+        ckpt_inputs[CKPT_AEROB1] = aerob1;
+        ckpt_inputs[CKPT_AEROB2] = aerob2;
+        ckpt_inputs[CKPT_AEROB4] = aerob4;
+        ckpt_inputs[CKPT_AEROB5] = aerob5;
+        ckpt_inputs[CKPT_AEROB7] = aerob7;
+        ckpt_inputs[CKPT_PCLASS] = pclass;
+        ckpt_inputs[CKPT_IPFLAG] = ipflag;
+        ckpt_inputs[CKPT_TWVI] = twvi;   /* NULL unless INTERP_AUX */
+        ckpt_inputs[CKPT_TOZI] = tozi;
+        ckpt_inputs[CKPT_TP] = tp;
+        for (ib = CKPT_AEROB1; ib <= CKPT_AEROB7; ib++)
+            ckpt_nbytes[ib] = npix * sizeof (int16);
+        ckpt_nbytes[CKPT_PCLASS] = npix * sizeof (uint8);
+        ckpt_nbytes[CKPT_IPFLAG] = npix * sizeof (uint8);
+        ckpt_nbytes[CKPT_TWVI] = npix * sizeof (float);
+        ckpt_nbytes[CKPT_TOZI] = npix * sizeof (float);
+        ckpt_nbytes[CKPT_TP] = npix * sizeof (float);
+        init_aero_ckpt (input, tables, aux, uoz, uwv, pres, nlines, nsamps,
+            ckpt_inputs, ckpt_nbytes, &ckpt_hdr);
+
+        restored = read_aero_ckpt (ckpt_file, &ckpt_hdr, ipflag, taero, teps);
+        if (restored)
+            ninv_tiles = 0;
+    }
+
     /* Start the aerosol inversion */
     mytime = time(NULL);
-    printf ("Aerosol Inversion using %d x %d aerosol window ... %s",
-        AERO_WINDOW, AERO_WINDOW, ctime(&mytime));
+    if (restored)
+        printf ("Aerosol Inversion restored from %s ... %s", ckpt_file,
+            ctime(&mytime));
+    else
+        printf ("Aerosol Inversion using %d x %d aerosol window ... %s",
+            AERO_WINDOW, AERO_WINDOW, ctime(&mytime));
     tmp_percent = 0;
+    angstrom_factors (aero_eps, aero_fact);
 #ifdef _OPENMP
-    #pragma omp parallel for private (i, j, center_line, center_samp, nearest_line, nearest_samp, curr_pix, center_pix, img, geo, lat, lon, xcmg, ycmg, lcmg, scmg, lcmg1, scmg1, u, v, one_minus_u, one_minus_v, one_minus_u_x_one_minus_v, one_minus_u_x_v, u_x_one_minus_v, u_x_v, ratio_pix11, ratio_pix12, ratio_pix21, ratio_pix22, rb1, rb2, slpr11, slpr12, slpr21, slpr22, intr11, intr12, intr21, intr22, slprb1, slprb2, slprb7, intrb1, intrb2, intrb7, xndwi, ndwi_th1, ndwi_th2, iband, iband1, iband3, iaots, retval, eps, eps1, eps2, eps3, residual, residual1, residual2, residual3, raot, sraot1, sraot2, sraot3, xa, xb, xc, xd, xe, xf, coefa, coefb, epsmin, corf, next, rotoa, raot550nm, roslamb, tgo, roatm, ttatmg, satm, xrorayp, ros5, ros4, erelc, troatm)
+    #pragma omp parallel for schedule (dynamic, 1) private (t, tile, tile_wline, tile_wsamp, tile_nwin_samps, iwin, ib, i, j, center_line, center_samp, nearest_line, nearest_samp, curr_pix, center_pix, summary, img, geo, lat, lon, xcmg, ycmg, lcmg, scmg, lcmg1, scmg1, u, v, one_minus_u, one_minus_v, one_minus_u_x_one_minus_v, one_minus_u_x_v, u_x_one_minus_v, u_x_v, ratio_pix11, ratio_pix12, ratio_pix21, ratio_pix22, rec11, rec12, rec21, rec22, slpr11, slpr12, slpr21, slpr22, intr11, intr12, intr21, intr22, slprb1, slprb2, slprb7, intrb1, intrb2, intrb7, xndwi, ndwi_th1, ndwi_th2, iband, iband1, iband3, iaots, retval, eps, residual, sresidual, raot, sraot, xa, xb, xc, xd, xe, xf, coefa, coefb, epsmin, corf, next, rotoa, raot550nm, roslamb, tgo, roatm, ttatmg, satm, xrorayp, ros5, ros4, erelc, troatm)
 #endif
-    for (i = HALF_AERO_WINDOW; i < nlines; i += AERO_WINDOW)
+    for (t = 0; t < ninv_tiles; t++)
     {
 #ifndef _OPENMP
         /* update status, but not if multi-threaded */
-        curr_tmp_percent = 100 * i / nlines;
+        curr_tmp_percent = 100 * t / ninv_tiles;
         if (curr_tmp_percent > tmp_percent)
         {
             tmp_percent = curr_tmp_percent;
@@ -1023,22 +1228,34 @@ int compute_sr_refl
         }
 #endif
 
-        curr_pix = i * nsamps + HALF_AERO_WINDOW;
-        for (j = HALF_AERO_WINDOW; j < nsamps;
-             j += AERO_WINDOW, curr_pix += AERO_WINDOW)
+        /* Process each of the aerosol windows in the tile */
+        tile = &aero_tiles->tile[t];
+        tile_wline = AERO_NWINDOWS (tile->first_line);
+        tile_wsamp = AERO_NWINDOWS (tile->first_samp);
+        tile_nwin_samps = AERO_NWINDOWS (tile->end_samp) - tile_wsamp;
+        for (iwin = 0; iwin < (AERO_NWINDOWS (tile->end_line) - tile_wline) *
+             tile_nwin_samps; iwin++)
         {
             /* Keep track of the center pixel for the current aerosol window;
                may need to return here if this is fill, cloudy or water */
+            i = (tile_wline + iwin / tile_nwin_samps) * AERO_WINDOW +
+                HALF_AERO_WINDOW;
+            j = (tile_wsamp + iwin % tile_nwin_samps) * AERO_WINDOW +
+                HALF_AERO_WINDOW;
+            curr_pix = i * nsamps + j;
             center_line = i;
             center_samp = j;
             center_pix = curr_pix;
+            summary = awin[(i / AERO_WINDOW) * nwin_samps + j / AERO_WINDOW];
 
             /* If this pixel is fill */
-            if (level1_qa_is_fill (qaband[curr_pix]))
+            if (btest (pclass[curr_pix], PCLASS_FILL))
             {
                 /* Look for other non-fill pixels in the window */
-                if (find_closest_non_fill (qaband, nlines, nsamps, center_line,
-                    center_samp, &nearest_line, &nearest_samp))
+                if (btest (summary, AWIN_NON_FILL) &&
+                    find_closest_pixel_class (pclass, nlines, nsamps,
+                    center_line, center_samp, (1 << PCLASS_FILL),
+                    &nearest_line, &nearest_samp))
                 {
                     /* Use the line/sample location of the non-fill pixel for
                        further processing of aerosols. However we will still
@@ -1059,13 +1276,15 @@ int compute_sr_refl
             /* If this non-fill pixel is water, then look for a pixel which is
                not water.  If none are found then the whole window is fill or
                water.  Flag this pixel as water. */
-            if (is_water (sband[SR_BAND4][curr_pix],
-                          sband[SR_BAND5][curr_pix]))
+            if (btest (pclass[curr_pix], PCLASS_WATER))
             {
                 /* Look for other non-fill/non-water pixels in the window.
                    Start with the center of the window and search outward. */
-                if (find_closest_non_water (qaband, sband, nlines, nsamps,
-                    center_line, center_samp, &nearest_line, &nearest_samp))
+                if (btest (summary, AWIN_NON_WATER) &&
+                    find_closest_pixel_class (pclass, nlines, nsamps,
+                    center_line, center_samp,
+                    (1 << PCLASS_FILL) | (1 << PCLASS_WATER), &nearest_line,
+                    &nearest_samp))
                 {
                     /* Use the line/sample location of the non-fill/non-water
                        pixel for further processing */
@@ -1080,14 +1299,6 @@ int compute_sr_refl
                     taero[center_pix] = DEFAULT_AERO;
                     teps[center_pix] = DEFAULT_EPS;
 
-                    /* Reset the looping variables to the center of the aerosol
-                       window versus the actual non-fill pixel that was
-                       processed so that we get the correct center for the next
-                       aerosol window */
-                    i = center_line;
-                    j = center_samp;
-                    curr_pix = center_pix;
-
                     /* Next window */
                     continue;
                 }
@@ -1096,13 +1307,17 @@ int compute_sr_refl
             /* If this non-fill/non-water pixel is cloud or shadow, then look
                for a pixel which is not cloudy, shadow, water, or fill.  If
                none are found, then just use this pixel. */
-            if (is_cloud_or_shadow (qaband[curr_pix]))
+            if (btest (pclass[curr_pix], PCLASS_CLOUD) ||
+                btest (pclass[curr_pix], PCLASS_SHADOW))
             {
                 /* Look for other non-fill/non-water/non-cloud/non-shadow
                    pixels in the window.  Start with the center of the window
                    and search outward. */
-                if (find_closest_non_cloud_shadow_water (qaband, sband, nlines,
-                    nsamps, center_line, center_samp, &nearest_line,
+                if (btest (summary, AWIN_CLEAR) &&
+                    find_closest_pixel_class (pclass, nlines, nsamps,
+                    center_line, center_samp,
+                    (1 << PCLASS_FILL) | (1 << PCLASS_WATER) |
+                    (1 << PCLASS_CLOUD) | (1 << PCLASS_SHADOW), &nearest_line,
                     &nearest_samp))
                 {
                     /* Use the line/sample location of the non-fill/non-cloud
@@ -1116,32 +1331,25 @@ int compute_sr_refl
             /* If the pixel selected is a cloud or shadow, then don't mess
                with aerosol interpolation.  Just assign generic aerosol
                values. */
-            if (is_cloud_or_shadow (qaband[curr_pix]))
+            if (btest (pclass[curr_pix], PCLASS_CLOUD) ||
+                btest (pclass[curr_pix], PCLASS_SHADOW))
             {
                 /* Assign generic values for the cloud pixel */
-                if (is_cloud (qaband[curr_pix]))
+                if (btest (pclass[curr_pix], PCLASS_CLOUD))
                     ipflag[center_pix] = (1 << IPFLAG_CLOUD);
-                else if (is_shadow (qaband[curr_pix]))
+                else if (btest (pclass[curr_pix], PCLASS_SHADOW))
                     ipflag[center_pix] = (1 << IPFLAG_SHADOW);
                 taero[center_pix] = DEFAULT_AERO;
                 teps[center_pix] = DEFAULT_EPS;
 
-                /* Reset the looping variables to the center of the aerosol
-                   window versus the actual non-fill/non-cloud pixel that
-                   was processed so that we get the correct center for the
-                   next aerosol window */
-                i = center_line;
-                j = center_samp;
-                curr_pix = center_pix;
-
                 /* Next window */
                 continue;
             }
 
             /* Get the lat/long for the current pixel (which may not be the
                center of the aerosol window), for the center of that pixel */
-            img.l = i - 0.5;
-            img.s = j + 0.5;
+            img.l = input->line0 + i - 0.5;
+            img.s = input->samp0 + j + 0.5;
             img.is_fill = false;
             if (!from_space (space, &img, &geo))
             {
@@ -1216,105 +1424,25 @@ int compute_sr_refl
             ratio_pix21 = lcmg1 * RATIO_NBLON + scmg;
             ratio_pix22 = ratio_pix21 + 1;
 
-            rb1 = ratiob1[ratio_pix11] * 0.001;  /* vs. / 1000. */
-            rb2 = ratiob2[ratio_pix11] * 0.001;  /* vs. / 1000. */
-            if (rb2 > 1.0 || rb1 > 1.0 || rb2 < 0.1 || rb1 < 0.1)
-            {
-                slpratiob1[ratio_pix11] = 0;
-                slpratiob2[ratio_pix11] = 0;
-                slpratiob7[ratio_pix11] = 0;
-                intratiob1[ratio_pix11] = 550;
-                intratiob2[ratio_pix11] = 600;
-                intratiob7[ratio_pix11] = 2000;
-            }
-            else if (sndwi[ratio_pix11] < 200)
-            {
-                slpratiob1[ratio_pix11] = 0;
-                slpratiob2[ratio_pix11] = 0;
-                slpratiob7[ratio_pix11] = 0;
-                intratiob1[ratio_pix11] = ratiob1[ratio_pix11];
-                intratiob2[ratio_pix11] = ratiob2[ratio_pix11];
-                intratiob7[ratio_pix11] = ratiob7[ratio_pix11];
-            }
-
-            rb1 = ratiob1[ratio_pix12] * 0.001;  /* vs. / 1000. */
-            rb2 = ratiob2[ratio_pix12] * 0.001;  /* vs. / 1000. */
-            if (rb2 > 1.0 || rb1 > 1.0 || rb2 < 0.1 || rb1 < 0.1)
-            {
-                slpratiob1[ratio_pix12] = 0;
-                slpratiob2[ratio_pix12] = 0;
-                slpratiob7[ratio_pix12] = 0;
-                intratiob1[ratio_pix12] = 550;
-                intratiob2[ratio_pix12] = 600;
-                intratiob7[ratio_pix12] = 2000;
-            }
-            else if (sndwi[ratio_pix12] < 200)
-            {
-                slpratiob1[ratio_pix12] = 0;
-                slpratiob2[ratio_pix12] = 0;
-                slpratiob7[ratio_pix12] = 0;
-                intratiob1[ratio_pix12] = ratiob1[ratio_pix12];
-                intratiob2[ratio_pix12] = ratiob2[ratio_pix12];
-                intratiob7[ratio_pix12] = ratiob7[ratio_pix12];
-            }
-
-            rb1 = ratiob1[ratio_pix21] * 0.001;  /* vs. / 1000. */
-            rb2 = ratiob2[ratio_pix21] * 0.001;  /* vs. / 1000. */
-            if (rb2 > 1.0 || rb1 > 1.0 || rb2 < 0.1 || rb1 < 0.1)
-            {
-                slpratiob1[ratio_pix21] = 0;
-                slpratiob2[ratio_pix21] = 0;
-                slpratiob7[ratio_pix21] = 0;
-                intratiob1[ratio_pix21] = 550;
-                intratiob2[ratio_pix21] = 600;
-                intratiob7[ratio_pix21] = 2000;
-            }
-            else if (sndwi[ratio_pix21] < 200)
-            {
-                slpratiob1[ratio_pix21] = 0;
-                slpratiob2[ratio_pix21] = 0;
-                slpratiob7[ratio_pix21] = 0;
-                intratiob1[ratio_pix21] = ratiob1[ratio_pix21];
-                intratiob2[ratio_pix21] = ratiob2[ratio_pix21];
-                intratiob7[ratio_pix21] = ratiob7[ratio_pix21];
-            }
-
-            rb1 = ratiob1[ratio_pix22] * 0.001;  /* vs. / 1000. */
-            rb2 = ratiob2[ratio_pix22] * 0.001;  /* vs. / 1000. */
-            if (rb2 > 1.0 || rb1 > 1.0 || rb2 < 0.1 || rb1 < 0.1)
-            {
-                slpratiob1[ratio_pix22] = 0;
-                slpratiob2[ratio_pix22] = 0;
-                slpratiob7[ratio_pix22] = 0;
-                intratiob1[ratio_pix22] = 550;
-                intratiob2[ratio_pix22] = 600;
-                intratiob7[ratio_pix22] = 2000;
-            }
-            else if (sndwi[ratio_pix22] < 200)
-            {
-                slpratiob1[ratio_pix22] = 0;
-                slpratiob2[ratio_pix22] = 0;
-                slpratiob7[ratio_pix22] = 0;
-                intratiob1[ratio_pix22] = ratiob1[ratio_pix22];
-                intratiob2[ratio_pix22] = ratiob2[ratio_pix22];
-                intratiob7[ratio_pix22] = ratiob7[ratio_pix22];
-            }
-
-            /* Compute the NDWI variables */
-            ndwi_th1 = (andwi[ratio_pix11] + 2.0 *
-                        sndwi[ratio_pix11]) * 0.001;
-            ndwi_th2 = (andwi[ratio_pix11] - 2.0 *
-                        sndwi[ratio_pix11]) * 0.001;
-
-            /* Interpolate the slope/intercept for each band, and unscale */
-            slpr11 = slpratiob1[ratio_pix11] * 0.001;  /* vs / 1000 */
-            intr11 = intratiob1[ratio_pix11] * 0.001;  /* vs / 1000 */
-            slpr12 = slpratiob1[ratio_pix12] * 0.001;  /* vs / 1000 */
-            intr12 = intratiob1[ratio_pix12] * 0.001;  /* vs / 1000 */
-            slpr21 = slpratiob1[ratio_pix21] * 0.001;  /* vs / 1000 */
-            intr21 = intratiob1[ratio_pix21] * 0.001;  /* vs / 1000 */
-            slpr22 = slpratiob1[ratio_pix22] * 0.001;  /* vs / 1000 */
-            intr22 = intratiob1[ratio_pix22] * 0.001;  /* vs / 1000 */
+            rec11 = &ratio[ratio_pix11];
+            rec12 = &ratio[ratio_pix12];
+            rec21 = &ratio[ratio_pix21];
+            rec22 = &ratio[ratio_pix22];
+
+            /* Get the NDWI variables */
+            ndwi_th1 = rec11->ndwi_th1;
+            ndwi_th2 = rec11->ndwi_th2;
+
+            /* Interpolate the slope/intercept for each band.  The records
+               are already unscaled, with the invalid ratios reset. */
+            slpr11 = rec11->slpratiob1;
+            intr11 = rec11->intratiob1;
+            slpr12 = rec12->slpratiob1;
+            intr12 = rec12->intratiob1;
+            slpr21 = rec21->slpratiob1;
+            intr21 = rec21->intratiob1;
+            slpr22 = rec22->slpratiob1;
+            intr22 = rec22->intratiob1;
             slprb1 = slpr11 * one_minus_u_x_one_minus_v +
                      slpr12 * one_minus_u_x_v +
                      slpr21 * u_x_one_minus_v +
@@ -1324,14 +1452,14 @@ int compute_sr_refl
                      intr21 * u_x_one_minus_v +
                      intr22 * u_x_v;
 
-            slpr11 = slpratiob2[ratio_pix11] * 0.001;  /* vs / 1000 */
-            intr11 = intratiob2[ratio_pix11] * 0.001;  /* vs / 1000 */
-            slpr12 = slpratiob2[ratio_pix12] * 0.001;  /* vs / 1000 */
-            intr12 = intratiob2[ratio_pix12] * 0.001;  /* vs / 1000 */
-            slpr21 = slpratiob2[ratio_pix21] * 0.001;  /* vs / 1000 */
-            intr21 = intratiob2[ratio_pix21] * 0.001;  /* vs / 1000 */
-            slpr22 = slpratiob2[ratio_pix22] * 0.001;  /* vs / 1000 */
-            intr22 = intratiob2[ratio_pix22] * 0.001;  /* vs / 1000 */
+            slpr11 = rec11->slpratiob2;
+            intr11 = rec11->intratiob2;
+            slpr12 = rec12->slpratiob2;
+            intr12 = rec12->intratiob2;
+            slpr21 = rec21->slpratiob2;
+            intr21 = rec21->intratiob2;
+            slpr22 = rec22->slpratiob2;
+            intr22 = rec22->intratiob2;
             slprb2 = slpr11 * one_minus_u_x_one_minus_v +
                      slpr12 * one_minus_u_x_v +
                      slpr21 * u_x_one_minus_v +
@@ -1341,14 +1469,14 @@ int compute_sr_refl
                      intr21 * u_x_one_minus_v +
                      intr22 * u_x_v;
 
-            slpr11 = slpratiob7[ratio_pix11] * 0.001;  /* vs / 1000 */
-            intr11 = intratiob7[ratio_pix11] * 0.001;  /* vs / 1000 */
-            slpr12 = slpratiob7[ratio_pix12] * 0.001;  /* vs / 1000 */
-            intr12 = intratiob7[ratio_pix12] * 0.001;  /* vs / 1000 */
-            slpr21 = slpratiob7[ratio_pix21] * 0.001;  /* vs / 1000 */
-            intr21 = intratiob7[ratio_pix21] * 0.001;  /* vs / 1000 */
-            slpr22 = slpratiob7[ratio_pix22] * 0.001;  /* vs / 1000 */
-            intr22 = intratiob7[ratio_pix22] * 0.001;  /* vs / 1000 */
+            slpr11 = rec11->slpratiob7;
+            intr11 = rec11->intratiob7;
+            slpr12 = rec12->slpratiob7;
+            intr12 = rec12->intratiob7;
+            slpr21 = rec21->slpratiob7;
+            intr21 = rec21->intratiob7;
+            slpr22 = rec22->slpratiob7;
+            intr22 = rec22->intratiob7;
             slprb7 = slpr11 * one_minus_u_x_one_minus_v +
                      slpr12 * one_minus_u_x_v +
                      slpr21 * u_x_one_minus_v +
@@ -1388,49 +1516,22 @@ int compute_sr_refl
             troatm[DN_BAND4] = aerob4[curr_pix] * SCALE_FACTOR;
             troatm[DN_BAND7] = aerob7[curr_pix] * SCALE_FACTOR;
 
-            /* Retrieve the aerosol information for eps 1.0 */
+            /* Retrieve the aerosol information for eps 1.0, 1.75, and 2.5
+               in one pass up the AOT table */
             iband1 = DN_BAND4;
             iband3 = DN_BAND1;
-            eps = 1.0;
-            iaots = 0;
-            subaeroret_new (iband1, iband3, erelc, troatm, tgo_arr,
-                xrorayp_arr, roatm_iaMax, roatm_coef, ttatmg_coef, satm_coef,
-                normext_p0a3_arr, &raot, &residual, &iaots, eps);
-
-            /* Save the data */
-            eps1 = eps;
-            residual1 = residual;
-            sraot1 = raot;
-
-            /* Retrieve the aerosol information for eps 1.75 */
-            eps = 1.75;
-            subaeroret_new (iband1, iband3, erelc, troatm, tgo_arr,
-                xrorayp_arr, roatm_iaMax, roatm_coef, ttatmg_coef, satm_coef,
-                normext_p0a3_arr, &raot, &residual, &iaots, eps);
-
-            /* Save the data */
-            eps2 = eps;
-            residual2 = residual;
-            sraot2 = raot;
-
-            /* Retrieve the aerosol information for eps 2.5 */
-            eps = 2.5;
-            subaeroret_new (iband1, iband3, erelc, troatm, tgo_arr,
-                xrorayp_arr, roatm_iaMax, roatm_coef, ttatmg_coef, satm_coef,
-                normext_p0a3_arr, &raot, &residual, &iaots, eps);
-
-            /* Save the data */
-            eps3 = eps;
-            residual3 = residual;
-            sraot3 = raot;
+            subaeroret_eps (iband1, iband3, erelc, troatm, tgo_arr,
+                roatm_iaMax, roatm_coef, ttatmg_coef, satm_coef,
+                normext_p0a3_arr, aero_eps, aero_fact, sraot, sresidual,
+                &iaots);
 
             /* Find the eps that minimizes the residual */
-            xa = (eps1 * eps1) - (eps3 * eps3);
-            xd = (eps2 * eps2) - (eps3 * eps3);
-            xb = eps1 - eps3;
-            xe = eps2 - eps3;
-            xc = residual1 - residual3;
-            xf = residual2 - residual3;
+            xa = (aero_eps[0] * aero_eps[0]) - (aero_eps[2] * aero_eps[2]);
+            xd = (aero_eps[1] * aero_eps[1]) - (aero_eps[2] * aero_eps[2]);
+            xb = aero_eps[0] - aero_eps[2];
+            xe = aero_eps[1] - aero_eps[2];
+            xc = sresidual[0] - sresidual[2];
+            xf = sresidual[1] - sresidual[2];
             coefa = (xc*xe - xb*xf) / (xa*xe - xb*xd);
             coefb = (xa*xf - xc*xd) / (xa*xe - xb*xd);
             epsmin = -coefb / (2.0 * coefa);
@@ -1439,22 +1540,22 @@ int compute_sr_refl
             if (epsmin >= 1.0 && epsmin <= 2.5)
             {
                 subaeroret_new (iband1, iband3, erelc, troatm, tgo_arr,
-                    xrorayp_arr, roatm_iaMax, roatm_coef, ttatmg_coef,
-                    satm_coef, normext_p0a3_arr, &raot, &residual, &iaots, eps);
+                    roatm_iaMax, roatm_coef, ttatmg_coef, satm_coef,
+                    normext_p0a3_arr, &raot, &residual, &iaots, eps);
             }
             else
             {
                 if (epsmin <= 1.0)
                 {
-                    eps = eps1;
-                    residual = residual1;
-                    raot = sraot1;
+                    eps = aero_eps[0];
+                    residual = sresidual[0];
+                    raot = sraot[0];
                 }
                 else if (epsmin >= 2.5)
                 {
-                    eps = eps3;
-                    residual = residual3;
-                    raot = sraot3;
+                    eps = aero_eps[2];
+                    residual = sresidual[2];
+                    raot = sraot[2];
                 }
             }
 
@@ -1508,46 +1609,45 @@ int compute_sr_refl
                 taero[center_pix] = DEFAULT_AERO;
                 teps[center_pix] = DEFAULT_EPS;
             }
-
-            /* Reset the looping variables to the center of the aerosol window
-               versus the actual non-fill/non-cloud pixel that was processed
-               so that we get the correct center for the next aerosol window */
-            i = center_line;
-            j = center_samp;
-            curr_pix = center_pix;
-        }  /* end for j */
-    }  /* end for i */
+        }  /* end for iwin */
+    }  /* end for t */
 
 #ifndef _OPENMP
     /* update status */
-    printf ("100%%\n");
-    fflush (stdout);
+    if (!restored)
+    {
+        printf ("100%%\n");
+        fflush (stdout);
+    }
 #endif
 
-    /* Done with the aerob* arrays */
-    free (aerob1);  aerob1 = NULL;
-    free (aerob2);  aerob2 = NULL;
-    free (aerob4);  aerob4 = NULL;
-    free (aerob5);  aerob5 = NULL;
-    free (aerob7);  aerob7 = NULL;
-
-    /* Done with the ratiob* arrays */
-    free (andwi);  andwi = NULL;
-    free (sndwi);  sndwi = NULL;
-    free (ratiob1);  ratiob1 = NULL;
-    free (ratiob2);  ratiob2 = NULL;
-    free (ratiob7);  ratiob7 = NULL;
-    free (intratiob1);  intratiob1 = NULL;
-    free (intratiob2);  intratiob2 = NULL;
-    free (intratiob7);  intratiob7 = NULL;
-    free (slpratiob1);  slpratiob1 = NULL;
-    free (slpratiob2);  slpratiob2 = NULL;
-    free (slpratiob7);  slpratiob7 = NULL;
-
-    /* Done with the DEM, water vapor, and ozone arrays */
-    free (dem);  dem = NULL;
-    free (wv);  wv = NULL;
-    free (oz);  oz = NULL;
+    /* Checkpoint the aerosol window centers.  The scene can still be
+       corrected without the checkpoint, so a failure is only a warning. */
+    if (ckpt_file != NULL && !restored)
+    {
+        if (write_aero_ckpt (ckpt_file, &ckpt_hdr, ipflag, taero, teps)
+            != SUCCESS)
+        {
+            sprintf (errmsg, "Unable to checkpoint the aerosol inversion; "
+                "continuing without it");
+            error_handler (false, FUNC_NAME, errmsg);
+        }
+    }
+
+    /* Done with the class plane and the aerob* arrays */
+    arena_release (arena, aero_mark);
+    close_tile_sched (aero_tiles);
+    aero_tiles = NULL;
+    pclass = NULL;
+    awin = NULL;
+    aerob1 = NULL;
+    aerob2 = NULL;
+    aerob4 = NULL;
+    aerob5 = NULL;
+    aerob7 = NULL;
+
+    /* The ratio records, DEM, water vapor, and ozone arrays belong to the
+       shared tables and are freed by the caller */
 
 #ifdef WRITE_TAERO
     /* Write the ipflag values for comparison with other algorithms */
@@ -1561,24 +1661,46 @@ int compute_sr_refl
     fclose (aero_fptr);
 #endif
 
-    /* Find the median of the clear aerosols */
-    mytime = time(NULL);
-    printf ("Computing median of clear pixels in NxN windows %s",
-        ctime(&mytime));
-    median_aerosol = find_median_aerosol (ipflag, taero, nlines, nsamps);
-    if (median_aerosol == 0.0)
-    {   /* error message already printed */
-        error_handler (true, FUNC_NAME, errmsg);
-        return (ERROR);
+    /* Find the median of the clear aerosols, unless the median of the full
+       scene was carried in for the window.  It's printed in full so it can
+       be carried into a window of the scene. */
+    if (input->out_window.median_aerosol > 0.0)
+    {
+        median_aerosol = input->out_window.median_aerosol;
+        printf ("Using the median aerosol value of the full scene %.9g\n",
+            median_aerosol);
+    }
+    else
+    {
+        mytime = time(NULL);
+        printf ("Computing median of clear pixels in NxN windows %s",
+            ctime(&mytime));
+        median_aerosol = find_median_aerosol (ipflag, taero, nlines, nsamps);
+        if (median_aerosol == 0.0)
+        {   /* error message already printed */
+            error_handler (true, FUNC_NAME, errmsg);
+            return (ERROR);
+        }
+        printf ("Median aerosol value for clear aerosols is %.9g\n",
+            median_aerosol);
+        if (uses_window_median (input))
+            printf ("Warning: the median aerosol is that of the window, so "
+                "the cloud, shadow, water, and failed aerosol retrieval "
+                "pixels won't match a full scene run.  Use --median_aerosol "
+                "with the value printed by a full scene run.\n");
     }
-    printf ("Median aerosol value for clear aerosols is %f\n", median_aerosol);
 
-    /* Fill the cloud, shadow, and water pixels with the median aerosol
-       value instead of the default aerosol value */
+    /* Fill the cloud, shadow, and water window centers with the median
+       aerosol value instead of the default aerosol value, then use the
+       centers of the aerosol windows to interpolate the aerosol and teps
+       values (angstrom coefficient) of the remaining pixels in the window.
+       The median value used for filling in the teps of clouds and water will
+       be the default eps value. */
     mytime = time(NULL);
-    printf ("Fill non-clear aerosol values in NxN windows with the median %s",
+    printf ("Interpolating the aerosol and teps values in the NxN windows %s",
         ctime(&mytime));
-    aerosol_fill_median (ipflag, taero, median_aerosol, nlines, nsamps);
+    aerosol_fill_interp (sband, qaband, ipflag, taero, teps, median_aerosol,
+        nlines, nsamps, pixel_tiles);
 
 #ifdef WRITE_TAERO
     /* Write the ipflag values for comparison with other algorithms */
@@ -1592,34 +1714,16 @@ int compute_sr_refl
     fclose (aero_fptr);
 #endif
 
-    /* Use the center of the aerosol windows to interpolate the remaining
-       pixels in the window */
-    mytime = time(NULL);
-    printf ("Interpolating the aerosol values in the NxN windows %s",
-        ctime(&mytime));
-    aerosol_interp (xml_metadata, sband, qaband, ipflag, taero, median_aerosol,
-        nlines, nsamps);
-
-#ifdef WRITE_TAERO
-    /* Write the ipflag values for comparison with other algorithms */
-    aero_fptr = fopen ("ipflag3.img", "w");
-    fwrite (ipflag, nlines*nsamps, sizeof (uint8), aero_fptr);
-    fclose (aero_fptr);
-
-    /* Write the aerosol values for comparison with other algorithms */
-    aero_fptr = fopen ("aerosols3.img", "w");
-    fwrite (taero, nlines*nsamps, sizeof (float), aero_fptr);
-    fclose (aero_fptr);
-#endif
-
-    /* Use the center of the aerosol windows to interpolate the teps values
-       (angstrom coefficient).  The median value used for filling in clouds and
-       water will be the default eps value. */
-    mytime = time(NULL);
-    printf ("Interpolating the teps values in the NxN windows %s",
-        ctime(&mytime));
-    aerosol_interp (xml_metadata, sband, qaband, ipflag, teps, DEFAULT_EPS,
-        nlines, nsamps);
+    /* Open the output file, so each band can be written in the background
+       while the remaining bands are being corrected */
+    sr_output = open_output (out_metadata, input, OUTPUT_SR, output_format);
+    if (sr_output == NULL)
+    {   /* error message already printed */
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+    printf ("Writing surface reflectance corrected data to the output "
+        "files in the background ...\n");
 
     /* Perform the second level of atmospheric correction using the aerosols */
     mytime = time(NULL);
@@ -1631,139 +1735,93 @@ int compute_sr_refl
     {
         printf ("  Band %d\n", ib+1);
 #ifdef _OPENMP
-        #pragma omp parallel for private (i, j, curr_pix, rsurf, rotoa, raot550nm, eps, retval, tmpf, roslamb, tgo, roatm, ttatmg, satm, xrorayp, next)
+        #pragma omp parallel for schedule (dynamic, 1) private (t, tile, i, j, curr_pix, rsurf, rotoa, raot550nm, eps, retval, tmpf, roslamb, tgo, roatm, ttatmg, satm, xrorayp, next)
 #endif
-        for (i = 0; i < nlines; i++)
+        for (t = 0; t < pixel_tiles->ntiles; t++)
         {
-            curr_pix = i * nsamps;
-            for (j = 0; j < nsamps; j++, curr_pix++)
+            tile = &pixel_tiles->tile[t];
+            for (i = tile->first_line; i < tile->end_line; i++)
             {
-                /* If this pixel is fill, then don't process */
-                if (level1_qa_is_fill (qaband[curr_pix]))
-                    continue;
-
-                /* If this pixel is cloud, then don't process. taero values
-                   are generic values anyhow, but TOA values will be returned
-                   for clouds (not shadows). */
-                if (is_cloud (qaband[curr_pix]))
-                    continue;
-
-                /* Correct all pixels */
-                rsurf = sband[ib][curr_pix] * SCALE_FACTOR;
-                rotoa = (rsurf * bttatmg[ib] / (1.0 - bsatm[ib] * rsurf) +
-                    broatm[ib]) * btgo[ib];
-                raot550nm = taero[curr_pix];
-                eps = teps[curr_pix];
-                atmcorlamb2_new (tgo_arr[ib], xrorayp_arr[ib],
-                    aot550nm[roatm_iaMax[ib]], &roatm_coef[ib][0],
-                    &ttatmg_coef[ib][0], &satm_coef[ib][0], raot550nm, ib,
-                    normext_p0a3_arr[ib], rotoa, &roslamb, eps);
-
-                /* If this is the coastal aerosol band then set the aerosol
-                   bits in the QA band */
-                if (ib == DN_BAND1)
+                curr_pix = i * nsamps + tile->first_samp;
+                for (j = tile->first_samp; j < tile->end_samp; j++, curr_pix++)
                 {
-                    /* Set up aerosol QA bits */
-                    tmpf = fabs (rsurf - roslamb);
-                    if (tmpf <= 0.015)
-                    {  /* Set the first aerosol bit (low aerosols) */
-                        ipflag[curr_pix] |= (1 << AERO1_QA);
-                    }
-                    else
+                    /* If this pixel is fill, then don't process */
+                    if (level1_qa_is_fill (qaband[curr_pix]))
+                        continue;
+
+                    /* If this pixel is cloud, then don't process. taero
+                       values are generic values anyhow, but TOA values will
+                       be returned for clouds (not shadows). */
+                    if (is_cloud (qaband[curr_pix]))
+                        continue;
+
+                    /* Correct all pixels */
+                    rsurf = sband[ib][curr_pix] * SCALE_FACTOR;
+                    rotoa = (rsurf * bttatmg[ib] / (1.0 - bsatm[ib] * rsurf) +
+                        broatm[ib]) * btgo[ib];
+                    raot550nm = taero[curr_pix];
+                    eps = teps[curr_pix];
+                    atmcorlamb2_new (tgo_arr[ib], xrorayp_arr[ib],
+                        aot550nm[roatm_iaMax[ib]], &roatm_coef[ib][0],
+                        &ttatmg_coef[ib][0], &satm_coef[ib][0], raot550nm, ib,
+                        normext_p0a3_arr[ib], rotoa, &roslamb, eps);
+
+                    /* If this is the coastal aerosol band then set the aerosol
+                       bits in the QA band */
+                    if (ib == DN_BAND1)
                     {
-                        if (tmpf < 0.03)
-                        {  /* Set the second aerosol bit (average aerosols) */
-                            ipflag[curr_pix] |= (1 << AERO2_QA);
+                        /* Set up aerosol QA bits */
+                        tmpf = fabs (rsurf - roslamb);
+                        if (tmpf <= 0.015)
+                        {  /* Set the first aerosol bit (low aerosols) */
+                            ipflag[curr_pix] |= (1 << AERO1_QA);
                         }
                         else
-                        {  /* Set both aerosol bits (high aerosols) */
-                            ipflag[curr_pix] |= (1 << AERO1_QA);
-                            ipflag[curr_pix] |= (1 << AERO2_QA);
+                        {
+                            if (tmpf < 0.03)
+                            {  /* Set the second aerosol bit (average
+                                  aerosols) */
+                                ipflag[curr_pix] |= (1 << AERO2_QA);
+                            }
+                            else
+                            {  /* Set both aerosol bits (high aerosols) */
+                                ipflag[curr_pix] |= (1 << AERO1_QA);
+                                ipflag[curr_pix] |= (1 << AERO2_QA);
+                            }
                         }
-                    }
-                }  /* end if this is the coastal aerosol band */
-
-                /* Save the scaled surface reflectance value, but make sure it
-                   falls within the defined valid range. */
-                roslamb = roslamb * MULT_FACTOR;  /* scale the value */
-                if (roslamb < MIN_VALID)
-                    sband[ib][curr_pix] = MIN_VALID;
-                else if (roslamb > MAX_VALID)
-                    sband[ib][curr_pix] = MAX_VALID;
-                else
-                    sband[ib][curr_pix] = (int) (roundf (roslamb));
-            }  /* end for j */
-        }  /* end for i */
-    }  /* end for ib */
-
-    /* Free memory for arrays no longer needed */
-    free (twvi);
-    free (tozi);
-    free (tp);
-    free (taero);
-    free (teps);
- 
-    /* Write the data to the output file */
-    mytime = time(NULL);
-    printf ("Writing surface reflectance corrected data to the output "
-        "files ... %s", ctime(&mytime));
-
-    /* Open the output file */
-    sr_output = open_output (xml_metadata, input, OUTPUT_SR);
-    if (sr_output == NULL)
-    {   /* error message already printed */
-        error_handler (true, FUNC_NAME, errmsg);
-        return (ERROR);
-    }
+                    }  /* end if this is the coastal aerosol band */
+
+                    /* Save the scaled surface reflectance value, but make
+                       sure it falls within the defined valid range. */
+                    roslamb = roslamb * MULT_FACTOR;  /* scale the value */
+                    if (roslamb < MIN_VALID)
+                        sband[ib][curr_pix] = MIN_VALID;
+                    else if (roslamb > MAX_VALID)
+                        sband[ib][curr_pix] = MAX_VALID;
+                    else
+                        sband[ib][curr_pix] = (int) (roundf (roslamb));
+                }  /* end for j */
+            }  /* end for i */
+        }  /* end for t */
 
-    /* Loop through the reflectance bands and write the data */
-    for (ib = 0; ib <= DN_BAND7; ib++)
-    {
+        /* This band is complete. Queue it to be written in the background
+           while the next band is corrected. */
         printf ("  Band %d: %s\n", ib+1,
             sr_output->metadata.band[ib].file_name);
-        if (put_output_lines (sr_output, sband[ib], ib, 0, nlines,
+        if (queue_band_write (writer, sr_output, sband[ib], ib,
             sizeof (int16)) != SUCCESS)
         {
             sprintf (errmsg, "Writing output data for band %d", ib);
             error_handler (true, FUNC_NAME, errmsg);
             return (ERROR);
         }
+    }  /* end for ib */
 
-        /* Create the ENVI header file this band */
-        if (create_envi_struct (&sr_output->metadata.band[ib],
-            &xml_metadata->global, &envi_hdr) != SUCCESS)
-        {
-            sprintf (errmsg, "Creating ENVI header structure.");
-            error_handler (true, FUNC_NAME, errmsg);
-            return (ERROR);
-        }
-
-        /* Write the ENVI header */
-        strcpy (envi_file, sr_output->metadata.band[ib].file_name);
-        cptr = strchr (envi_file, '.');
-        strcpy (cptr, ".hdr");
-        if (write_envi_hdr (envi_file, &envi_hdr) != SUCCESS)
-        {
-            sprintf (errmsg, "Writing ENVI header file.");
-            error_handler (true, FUNC_NAME, errmsg);
-            return (ERROR);
-        }
-    }
-
-    /* Append the surface reflectance bands (1-7) to the XML file */
-    if (append_metadata (7, sr_output->metadata.band, xml_infile) !=
-        SUCCESS)
-    {
-        sprintf (errmsg, "Appending surface reflectance bands to the "
-            "XML file.");
-        error_handler (true, FUNC_NAME, errmsg);
-        return (ERROR);
-    }
-
-    /* Write the aerosol QA band */
+    /* The aerosol QA bits were set during the band 1 correction, so the
+       aerosol QA band is also ready to be written */
     printf ("  Band %d: %s\n", SR_AEROSOL+1,
             sr_output->metadata.band[SR_AEROSOL].file_name);
-    if (put_output_lines (sr_output, ipflag, SR_AEROSOL, 0, nlines,
+    if (queue_band_write (writer, sr_output, ipflag, SR_AEROSOL,
         sizeof (uint8)) != SUCCESS)
     {
         sprintf (errmsg, "Writing aerosol QA output data");
@@ -1771,37 +1829,23 @@ int compute_sr_refl
         return (ERROR);
     }
 
-    /* Free memory for ipflag data */
-    free (ipflag);
-
-    /* Create the ENVI header for the aerosol QA band */
-    if (create_envi_struct (&sr_output->metadata.band[SR_AEROSOL],
-        &xml_metadata->global, &envi_hdr) != SUCCESS)
-    {
-        sprintf (errmsg, "Creating ENVI header structure.");
-        error_handler (true, FUNC_NAME, errmsg);
-        return (ERROR);
-    }
-
-    /* Write the ENVI header */
-    strcpy (envi_file, sr_output->metadata.band[SR_AEROSOL].file_name);
-    cptr = strchr (envi_file, '.');
-    strcpy (cptr, ".hdr");
-    if (write_envi_hdr (envi_file, &envi_hdr) != SUCCESS)
+    /* Wait for the data to be written to the output file.  The band metadata
+       is appended to the XML file by the caller once all the products have
+       been written. */
+    mytime = time(NULL);
+    printf ("Waiting for the surface reflectance output to be written ... %s",
+        ctime(&mytime));
+    if (wait_band_writes (writer) != SUCCESS)
     {
-        sprintf (errmsg, "Writing ENVI header file.");
+        sprintf (errmsg, "Writing surface reflectance output data");
         error_handler (true, FUNC_NAME, errmsg);
         return (ERROR);
     }
 
-    /* Append the aerosol QA band to the XML file */
-    if (append_metadata (1, &sr_output->metadata.band[SR_AEROSOL],
-        xml_infile) != SUCCESS)
-    {
-        sprintf (errmsg, "Appending aerosol QA band to XML file.");
-        error_handler (true, FUNC_NAME, errmsg);
-        return (ERROR);
-    }
+    /* Free memory for the surface reflectance arrays, including the aerosol
+       QA which has now been written */
+    arena_release (arena, sr_mark);
+    close_tile_sched (pixel_tiles);
 
     /* Close the output surface reflectance products */
     close_output (sr_output, OUTPUT_SR);
@@ -1810,17 +1854,6 @@ int compute_sr_refl
     /* Free the spatial mapping pointer */
     free (space);
 
-    /* Free the data arrays */
-    free (rolutt);
-    free (transt);
-    free (sphalbt);
-    free (normext);
-    free (tsmax);
-    free (tsmin);
-    free (nbfic);
-    free (nbfi);
-    free (ttv);
-
     /* Successful completion */
     mytime = time(NULL);
     printf ("Surface reflectance correction complete ... %s\n", ctime(&mytime));
@@ -1832,8 +1865,9 @@ int compute_sr_refl
 MODULE:  init_sr_refl
 
 PURPOSE:  Initialization for the atmospheric corrections.  Initialization for
-look up tables, auxiliary data, mapping, and geolocation information is used
-for the surface reflectance correction.
+the atmospheric parameters at the scene center, using the auxiliary data,
+mapping, and geolocation information, is used for the surface reflectance
+correction.
 
 RETURN VALUE:
 Type = int
@@ -1848,6 +1882,8 @@ at the USGS EROS
 NOTES:
 1. The view angle is set to 0.0 and this never changes.
 2. The DEM is used to calculate the surface pressure.
+3. The look up tables and auxiliary data are read ahead of time by
+   load_sr_tables and get_aux_grid.
 ******************************************************************************/
 int init_sr_refl
 (
@@ -1855,13 +1891,9 @@ int init_sr_refl
     int nsamps,         /* I: number of samps in reflectance, thermal bands */
     Input_t *input,     /* I: input structure for the Landsat product */
     Geoloc_t *space,    /* I: structure for geolocation information */
-    char *anglehdf,     /* I: angle HDF filename */
-    char *intrefnm,     /* I: intrinsic reflectance filename */
-    char *transmnm,     /* I: transmission filename */
-    char *spheranm,     /* I: spherical albedo filename */
-    char *cmgdemnm,     /* I: climate modeling grid DEM filename */
-    char *rationm,      /* I: ratio averages filename */
-    char *auxnm,        /* I: auxiliary filename for ozone and water vapor */
+    int16 *dem,         /* I: CMG DEM data array [DEM_NBLAT x DEM_NBLON] */
+    uint16 *wv,         /* I: water vapor values [CMG_NBLAT x CMG_NBLON] */
+    uint8 *oz,          /* I: ozone values [CMG_NBLAT x CMG_NBLON] */
     float *eps,         /* O: angstrom coefficient */
     int *iaots,         /* O: index for AOTs */ 
     float *xtv,         /* O: observation zenith angle (deg) */
@@ -1874,50 +1906,12 @@ int init_sr_refl
     float *uoz,         /* O: total column ozone */
     float *uwv,         /* O: total column water vapor (precipital water
                               vapor) */
-    float *xtsstep,     /* O: solar zenith step value */
-    float *xtsmin,      /* O: minimum solar zenith value */
     float *xtvstep,     /* O: observation step value */
-    float *xtvmin,      /* O: minimum observation value */
-    float *tsmax,       /* O: maximum scattering angle table
-                              [NVIEW_ZEN_VALS x NSOLAR_ZEN_VALS] */
-    float *tsmin,       /* O: minimum scattering angle table
-                              [NVIEW_ZEN_VALS x NSOLAR_ZEN_VALS] */
-    float tts[22],      /* O: sun angle table */
-    float *ttv,         /* O: view angle table
-                              [NVIEW_ZEN_VALS x NSOLAR_ZEN_VALS] */
-    int32 indts[22],    /* O: index for the sun angle table */
-    float *rolutt,      /* O: intrinsic reflectance table
-                          [NSR_BANDS x NPRES_VALS x NAOT_VALS x NSOLAR_VALS] */
-    float *transt,      /* O: transmission table 
-                      [NSR_BANDS x NPRES_VALS x NAOT_VALS x NSUN_ANGLE_VALS] */
-    float *sphalbt,     /* O: spherical albedo table 
-                              [NSR_BANDS x NPRES_VALS x NAOT_VALS] */
-    float *normext,     /* O: aerosol extinction coefficient at the current
-                              wavelength (normalized at 550nm)
-                              [NSR_BANDS x NPRES_VALS x NAOT_VALS] */
-    float *nbfic,       /* O: communitive number of azimuth angles
-                              [NVIEW_ZEN_VALS x NSOLAR_ZEN_VALS] */
-    float *nbfi,        /* O: number of azimuth angles
-                              [NVIEW_ZEN_VALS x NSOLAR_ZEN_VALS] */
-    int16 *dem,         /* O: CMG DEM data array [DEM_NBLAT x DEM_NBLON] */
-    int16 *andwi,       /* O: avg NDWI [RATIO_NBLAT x RATIO_NBLON] */
-    int16 *sndwi,       /* O: standard NDWI [RATIO_NBLAT x RATIO_NBLON] */
-    int16 *ratiob1,     /* O: mean band1 ratio [RATIO_NBLAT x RATIO_NBLON] */
-    int16 *ratiob2,     /* O: mean band2 ratio [RATIO_NBLAT x RATIO_NBLON] */
-    int16 *ratiob7,     /* O: mean band7 ratio [RATIO_NBLAT x RATIO_NBLON] */
-    int16 *intratiob1,  /* O: integer band1 ratio [RATIO_NBLAT x RATIO_NBLON] */
-    int16 *intratiob2,  /* O: integer band2 ratio [RATIO_NBLAT x RATIO_NBLON] */
-    int16 *intratiob7,  /* O: integer band7 ratio [RATIO_NBLAT x RATIO_NBLON] */
-    int16 *slpratiob1,  /* O: slope band1 ratio [RATIO_NBLAT x RATIO_NBLON] */
-    int16 *slpratiob2,  /* O: slope band2 ratio [RATIO_NBLAT x RATIO_NBLON] */
-    int16 *slpratiob7,  /* O: slope band7 ratio [RATIO_NBLAT x RATIO_NBLON] */
-    uint16 *wv,         /* O: water vapor values [CMG_NBLAT x CMG_NBLON] */
-    uint8 *oz           /* O: ozone values [CMG_NBLAT x CMG_NBLON] */
+    float *xtvmin       /* O: minimum observation value */
 )
 {
     char errmsg[STR_SIZE];                   /* error message */
     char FUNC_NAME[] = "init_sr_refl";       /* function name */
-    int retval;          /* return status */
     int lcmg, scmg;      /* line/sample index for the CMG */
     int cmg_pix;         /* pixel location in the CMG array for [lcmg][scmg] */
     int dem_pix;         /* pixel location in the DEM array for [lcmg][scmg] */
@@ -1928,40 +1922,15 @@ int init_sr_refl
     Geo_coord_t geo;              /* coordinate in lat/long space */
     float center_lat, center_lon; /* lat/long for scene center */
 
-    /* Initialize the look up tables */
+    /* Initialize the atmospheric correction variables */
     *eps = 1.0;
     *iaots = 0;
     *xtv = 0.0;
     *xmuv = cos (*xtv * DEG2RAD);
     *xfi = 0.0;
     *cosxfi = cos (*xfi * DEG2RAD);
-    *xtsmin = 0;
-    *xtsstep = 4.0;
     *xtvmin = 2.84090;
     *xtvstep = 6.52107 - *xtvmin;
-    retval = readluts (tsmax, tsmin, ttv, tts, nbfic, nbfi, indts, rolutt,
-        transt, sphalbt, normext, *xtsstep, *xtsmin, anglehdf,
-        intrefnm, transmnm, spheranm);
-    if (retval != SUCCESS)
-    {
-        sprintf (errmsg, "Reading the LUTs");
-        error_handler (true, FUNC_NAME, errmsg);
-        return (ERROR);
-    }
-    printf ("The LUTs for urban clean case v2.0 have been read.  We can "
-        "now perform atmospheric correction.\n");
-
-    /* Read the auxiliary data files used as input to the reflectance
-       calculations */
-    retval = read_auxiliary_files (cmgdemnm, rationm, auxnm, dem, andwi, sndwi,
-        ratiob1, ratiob2, ratiob7, intratiob1, intratiob2, intratiob7,
-        slpratiob1, slpratiob2, slpratiob7, wv, oz);
-    if (retval != SUCCESS)
-    {
-        sprintf (errmsg, "Reading the auxiliary files");
-        error_handler (true, FUNC_NAME, errmsg);
-        return (ERROR);
-    }
 
     /* Getting parameters for atmospheric correction */
     /* Update to get the parameter of the scene center */
@@ -2030,6 +1999,137 @@ int init_sr_refl
 }
 
 
+/******************************************************************************
+MODULE:  load_scene_aux
+
+PURPOSE:  Reads the ozone and water vapor for the CMG cells covered by the
+scene from the tiled auxiliary file.  Nothing is done if the whole auxiliary
+grid was read from the HDF file.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error mapping the scene or reading the auxiliary tiles
+SUCCESS         No errors encountered
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+NOTES:
+1. The CMG cells covered by the scene are found by mapping points along the
+   edges of the scene, which bound the lat/long of every pixel in it.  The
+   window is widened by AUX_WINDOW_MARGIN cells for the bilinear
+   interpolation.
+2. The interpolation wraps the last CMG line and sample around to the first
+   (see compute_sr_refl), so the first line/sample of the window's tiles is
+   read as well when the window reaches the edge of the grid.  A scene
+   crossing the dateline covers the full range of samples.
+******************************************************************************/
+int load_scene_aux
+(
+    int nlines,         /* I: number of lines in reflectance, thermal bands */
+    int nsamps,         /* I: number of samps in reflectance, thermal bands */
+    Geoloc_t *space,    /* I: structure for geolocation information */
+    Aux_grid_t *aux     /* I/O: ozone and water vapor grid for the scene
+                                date */
+)
+{
+    char errmsg[STR_SIZE];                   /* error message */
+    char FUNC_NAME[] = "load_scene_aux";     /* function name */
+    int edge;            /* looping variable for the scene edges */
+    int i;               /* looping variable for the points on an edge */
+    int lcmg, scmg;      /* line/sample index for the CMG */
+    int first_line = CMG_NBLAT;  /* first CMG line covered by the scene */
+    int end_line = 0;            /* CMG line after the last line covered */
+    int first_samp = CMG_NBLON;  /* first CMG sample covered by the scene */
+    int end_samp = 0;            /* CMG sample after the last sample
+                                    covered */
+    int nloaded;         /* number of tiles read before this scene */
+    int retval;          /* return status */
+    float lat, lon;      /* lat/long of the current point */
+
+    /* Vars for forward/inverse mapping space */
+    Img_coord_float_t img;        /* coordinate in line/sample space */
+    Geo_coord_t geo;              /* coordinate in lat/long space */
+
+    if (aux->tiles == NULL)
+        return (SUCCESS);
+
+    /* Map points along the top, bottom, left, and right edges of the scene
+       and find the range of CMG cells they fall in, the same way the pixels
+       are located in the CMG */
+    for (edge = 0; edge < 4; edge++)
+    {
+        for (i = 0; i <= AUX_EDGE_NPOINTS; i++)
+        {
+            if (edge < 2)
+            {
+                img.l = (edge == 0) ? -0.5 : nlines - 0.5;
+                img.s = (float) i * nsamps / AUX_EDGE_NPOINTS;
+            }
+            else
+            {
+                img.l = (float) i * nlines / AUX_EDGE_NPOINTS - 0.5;
+                img.s = (edge == 2) ? 0.0 : nsamps;
+            }
+            img.is_fill = false;
+            if (!from_space (space, &img, &geo))
+            {
+                sprintf (errmsg, "Mapping line/sample (%f, %f) to "
+                    "geolocation coords", img.l, img.s);
+                error_handler (true, FUNC_NAME, errmsg);
+                return (ERROR);
+            }
+            lat = geo.lat * RAD2DEG;
+            lon = geo.lon * RAD2DEG;
+
+            lcmg = (int) ((89.975 - lat) * 20.0);   /* vs / 0.05 */
+            scmg = (int) ((179.975 + lon) * 20.0);  /* vs / 0.05 */
+            lcmg = MIN (MAX (lcmg, 0), CMG_NBLAT - 1);
+            scmg = MIN (MAX (scmg, 0), CMG_NBLON - 1);
+            first_line = MIN (first_line, lcmg);
+            end_line = MAX (end_line, lcmg + 1);
+            first_samp = MIN (first_samp, scmg);
+            end_samp = MAX (end_samp, scmg + 1);
+        }
+    }
+
+    /* Widen the window for the interpolation and read its tiles, along with
+       the first line/sample for the wrap around the edges of the grid */
+    first_line -= AUX_WINDOW_MARGIN;
+    end_line += AUX_WINDOW_MARGIN;
+    first_samp -= AUX_WINDOW_MARGIN;
+    end_samp += AUX_WINDOW_MARGIN;
+    nloaded = aux->tiles->nloaded;
+    retval = read_aux_tiles (aux->tiles, first_line, end_line, first_samp,
+        end_samp, aux->wv, aux->oz);
+    if (retval == SUCCESS && end_line >= CMG_NBLAT)
+        retval = read_aux_tiles (aux->tiles, 0, 1, first_samp, end_samp,
+            aux->wv, aux->oz);
+    if (retval == SUCCESS && end_samp >= CMG_NBLON)
+        retval = read_aux_tiles (aux->tiles, first_line, end_line, 0, 1,
+            aux->wv, aux->oz);
+    if (retval != SUCCESS)
+    {
+        sprintf (errmsg, "Reading the auxiliary tiles for CMG lines %d-%d, "
+            "samples %d-%d", first_line, end_line - 1, first_samp,
+            end_samp - 1);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    printf ("Read %d of %d auxiliary tiles for CMG lines %d-%d, samples "
+        "%d-%d\n", aux->tiles->nloaded - nloaded,
+        aux->tiles->hdr.ntile_lines * aux->tiles->hdr.ntile_samps,
+        MAX (first_line, 0), MIN (end_line, CMG_NBLAT) - 1,
+        MAX (first_samp, 0), MIN (end_samp, CMG_NBLON) - 1);
+
+    /* Successful completion */
+    return (SUCCESS);
+}
+
+
 /******************************************************************************
 MODULE:  is_cloud
 
@@ -2174,151 +2274,143 @@ bool is_water
 
 
 /******************************************************************************
-MODULE:  find_closest_non_fill
+MODULE:  compute_pixel_class
 
-PURPOSE:  Finds the closest non-fill pixel in the aerosol window
+PURPOSE:  Computes the class plane for the scene, decoding the fill, cloud,
+and shadow bits of the Level-1 QA and the band 4/5 water test into one byte
+per pixel.
 
-RETURN VALUE:
-Type = boolean
-Value           Description
------           -----------
-false           No pixel found
-true            Pixel found
+RETURN VALUE: N/A
 
 PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
 at the USGS EROS
 
 NOTES:
+  1. The class bits are defined by Pclass_t.  These are the same tests made by
+     level1_qa_is_fill, is_cloud, is_shadow, and is_water, made once per pixel
+     instead of each time a pixel is visited by the aerosol window searches.
+  2. sband is expected to hold the TOA reflectance for bands 4 and 5.
 ******************************************************************************/
-bool find_closest_non_fill
+void compute_pixel_class
 (
     uint16 *qaband,    /* I: QA band for the input image, nlines x nsamps */
+    int16 **sband,     /* I: input TOA reflectance */
     int nlines,        /* I: number of lines in QA band */
     int nsamps,        /* I: number of samps in QA band */
-    int center_line,   /* I: line for the center of the aerosol window */
-    int center_samp,   /* I: sample for the center of the aerosol window */
-    int *nearest_line, /* O: line for nearest non-fill pix in aerosol window */
-    int *nearest_samp  /* O: samp for nearest non-fill pix in aerosol window */
+    uint8 *pclass      /* O: class plane, nlines x nsamps */
 )
 {
-    int curr_pix;            /* looping variable for pixels */
-    int line, samp;          /* looping variables for lines and samples */
-    int aero_window;         /* looping variabel for the aerosol window */
+    int line;                /* looping variable for lines */
+    long curr_pix;           /* looping variable for pixels */
+    long last_pix;           /* pixel after the end of the current line */
+    uint8 class;             /* class bits for the current pixel */
 
-    /* Loop around the center pixel, moving outward with each loop, searching
-       for a pixel that is not of the QA type specified and is not fill */
-    for (aero_window = 1; aero_window <= HALF_AERO_WINDOW; aero_window++)
+#ifdef _OPENMP
+    #pragma omp parallel for private (line, curr_pix, last_pix, class)
+#endif
+    for (line = 0; line < nlines; line++)
     {
-        for (line = center_line - aero_window;
-             line <= center_line + aero_window; line++)
+        curr_pix = (long) line * nsamps;
+        last_pix = curr_pix + nsamps;
+        for ( ; curr_pix < last_pix; curr_pix++)
         {
-            /* Make sure the line is valid */
-            if (line < 0 || line >= nlines)
-                continue;
-
-            curr_pix = line * nsamps + center_samp - aero_window;
-            for (samp = center_samp - aero_window;
-                 samp <= center_samp + aero_window; samp++, curr_pix++)
-            {
-                /* Make sure the sample is valid */
-                if (samp < 0 || samp >= nsamps)
-                    continue;
-
-                /* If this pixel is not fill, then mark it as the closest
-                   non-fill pixel and return */
-                if (!level1_qa_is_fill (qaband[curr_pix]))
-                {
-                    *nearest_line = line;
-                    *nearest_samp = samp;
-                    return (true);
-                }
-            }
+            class = 0;
+            if (level1_qa_is_fill (qaband[curr_pix]))
+                class |= (1 << PCLASS_FILL);
+            if (is_cloud (qaband[curr_pix]))
+                class |= (1 << PCLASS_CLOUD);
+            if (is_shadow (qaband[curr_pix]))
+                class |= (1 << PCLASS_SHADOW);
+            if (is_water (sband[SR_BAND4][curr_pix],
+                          sband[SR_BAND5][curr_pix]))
+                class |= (1 << PCLASS_WATER);
+            pclass[curr_pix] = class;
         }
     }
-
-    /* No pixel was found that met the criteria */
-    return (false);
 }
 
 
 /******************************************************************************
-MODULE:  find_closest_non_cloud_shadow_water
+MODULE:  summarize_aero_windows
 
-PURPOSE:  Finds the closest non-cloud, non-shadow, non-water pixel in the
-aerosol window
+PURPOSE:  Summarizes the class plane for each aerosol window, flagging whether
+the window contains a pixel which can be used by each of the aerosol window
+pixel searches.
 
-RETURN VALUE:
-Type = boolean
-Value           Description
------           -----------
-false           No pixel found
-true            Pixel found
+RETURN VALUE: N/A
 
 PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
 at the USGS EROS
 
 NOTES:
+  1. The summary bits are defined by Awin_t.  The summary covers the same
+     pixels as find_closest_pixel_class, so if the bit for a search is not set
+     then the search will not find a pixel and doesn't need to be made.
+  2. The summary is stored for each aerosol window center processed by the
+     aerosol inversion, indexed by (center_line / AERO_WINDOW) * nwin_samps +
+     (center_samp / AERO_WINDOW).
 ******************************************************************************/
-bool find_closest_non_cloud_shadow_water
+void summarize_aero_windows
 (
-    uint16 *qaband,    /* I: QA band for the input image, nlines x nsamps */
-    int16 **sband,     /* I: input surface reflectance, nlines x nsamps */
-    int nlines,        /* I: number of lines in QA band */
-    int nsamps,        /* I: number of samps in QA band */
-    int center_line,   /* I: line for the center of the aerosol window */
-    int center_samp,   /* I: sample for the center of the aerosol window */
-    int *nearest_line, /* O: line for nearest non-cloud pix in aerosol window */
-    int *nearest_samp  /* O: samp for nearest non-cloud pix in aerosol window */
+    uint8 *pclass,     /* I: class plane, nlines x nsamps */
+    int nlines,        /* I: number of lines in the class plane */
+    int nsamps,        /* I: number of samps in the class plane */
+    int nwin_lines,    /* I: number of aerosol window lines */
+    int nwin_samps,    /* I: number of aerosol window samps */
+    uint8 *awin        /* O: aerosol window summary,
+                             nwin_lines x nwin_samps */
 )
 {
-    int curr_pix;            /* looping variable for pixels */
+    int wline, wsamp;        /* looping variables for the aerosol windows */
     int line, samp;          /* looping variables for lines and samples */
-    int aero_window;         /* looping variabel for the aerosol window */
+    int center_line;         /* line for the center of the aerosol window */
+    int center_samp;         /* sample for the center of the aerosol window */
+    int first_samp;          /* first valid sample in the aerosol window */
+    int last_samp;           /* last valid sample in the aerosol window */
+    long curr_pix;           /* looping variable for pixels */
+    uint8 class;             /* class bits for the current pixel */
+    uint8 summary;           /* summary bits for the current window */
 
-    /* Loop around the center pixel, moving outward with each loop, searching
-       for a pixel that is not of the QA type specified and is not fill */
-    for (aero_window = 1; aero_window <= HALF_AERO_WINDOW; aero_window++)
+#ifdef _OPENMP
+    #pragma omp parallel for private (wline, wsamp, line, samp, center_line, center_samp, first_samp, last_samp, curr_pix, class, summary)
+#endif
+    for (wline = 0; wline < nwin_lines; wline++)
     {
-        for (line = center_line - aero_window;
-             line <= center_line + aero_window; line++)
+        center_line = wline * AERO_WINDOW + HALF_AERO_WINDOW;
+        for (wsamp = 0; wsamp < nwin_samps; wsamp++)
         {
-            /* Make sure the line is valid */
-            if (line < 0 || line >= nlines)
-                continue;
-
-            curr_pix = line * nsamps + center_samp - aero_window;
-            for (samp = center_samp - aero_window;
-                 samp <= center_samp + aero_window; samp++, curr_pix++)
+            center_samp = wsamp * AERO_WINDOW + HALF_AERO_WINDOW;
+            first_samp = MAX (center_samp - HALF_AERO_WINDOW, 0);
+            last_samp = MIN (center_samp + HALF_AERO_WINDOW, nsamps - 1);
+
+            summary = 0;
+            for (line = MAX (center_line - HALF_AERO_WINDOW, 0);
+                 line <= MIN (center_line + HALF_AERO_WINDOW, nlines - 1);
+                 line++)
             {
-                /* Make sure the sample is valid */
-                if (samp < 0 || samp >= nsamps)
-                    continue;
-
-                /* If this pixel is not fill, not water, and is not cloud or
-                   shadow, then mark it as the closest non-cloud pixel and
-                   return. */
-                if (!level1_qa_is_fill (qaband[curr_pix]) &&
-                    !is_cloud_or_shadow (qaband[curr_pix]) &&
-                    !is_water (sband[SR_BAND4][curr_pix],
-                               sband[SR_BAND5][curr_pix]))
+                curr_pix = (long) line * nsamps + first_samp;
+                for (samp = first_samp; samp <= last_samp; samp++, curr_pix++)
                 {
-                    *nearest_line = line;
-                    *nearest_samp = samp;
-                    return (true);
+                    class = pclass[curr_pix];
+                    if (!(class & (1 << PCLASS_FILL)))
+                        summary |= (1 << AWIN_NON_FILL);
+                    if (!(class & ((1 << PCLASS_FILL) | (1 << PCLASS_WATER))))
+                        summary |= (1 << AWIN_NON_WATER);
+                    if (!class)
+                        summary |= (1 << AWIN_CLEAR);
                 }
             }
+            awin[wline * nwin_samps + wsamp] = summary;
         }
     }
-
-    /* No pixel was found that met the criteria */
-    return (false);
 }
 
 
 /******************************************************************************
-MODULE:  find_closest_non_water
+MODULE:  find_closest_pixel_class
 
-PURPOSE:  Finds the closest non-water pixel in the aerosol window
+PURPOSE:  Finds the closest pixel in the aerosol window which doesn't have any
+of the specified class bits set.
 
 RETURN VALUE:
 Type = boolean
@@ -2331,25 +2423,30 @@ PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
 at the USGS EROS
 
 NOTES:
+  1. Squares of increasing size around the center are searched in line and
+     sample order, so the first pixel found is one of the closest.
+  2. Use (1 << PCLASS_FILL) for the closest non-fill pixel, add
+     (1 << PCLASS_WATER) for the closest non-water pixel, and add the cloud
+     and shadow bits for the closest clear pixel.
 ******************************************************************************/
-bool find_closest_non_water
+bool find_closest_pixel_class
 (
-    uint16 *qaband,    /* I: QA band for the input image, nlines x nsamps */
-    int16 **sband,     /* I: input surface reflectance, nlines x nsamps */
-    int nlines,        /* I: number of lines in QA band */
-    int nsamps,        /* I: number of samps in QA band */
+    uint8 *pclass,     /* I: class plane, nlines x nsamps */
+    int nlines,        /* I: number of lines in the class plane */
+    int nsamps,        /* I: number of samps in the class plane */
     int center_line,   /* I: line for the center of the aerosol window */
     int center_samp,   /* I: sample for the center of the aerosol window */
-    int *nearest_line, /* O: line for nearest non-cloud pix in aerosol window */
-    int *nearest_samp  /* O: samp for nearest non-cloud pix in aerosol window */
+    uint8 reject,      /* I: class bits which rule out a pixel */
+    int *nearest_line, /* O: line for nearest pix in aerosol window */
+    int *nearest_samp  /* O: samp for nearest pix in aerosol window */
 )
 {
-    int curr_pix;            /* looping variable for pixels */
+    long curr_pix;           /* looping variable for pixels */
     int line, samp;          /* looping variables for lines and samples */
-    int aero_window;         /* looping variabel for the aerosol window */
+    int aero_window;         /* looping variable for the aerosol window */
 
     /* Loop around the center pixel, moving outward with each loop, searching
-       for a pixel that is not of the QA type specified and is not fill */
+       for a pixel that doesn't have any of the rejected class bits */
     for (aero_window = 1; aero_window <= HALF_AERO_WINDOW; aero_window++)
     {
         for (line = center_line - aero_window;
@@ -2359,7 +2456,7 @@ bool find_closest_non_water
             if (line < 0 || line >= nlines)
                 continue;
 
-            curr_pix = line * nsamps + center_samp - aero_window;
+            curr_pix = (long) line * nsamps + center_samp - aero_window;
             for (samp = center_samp - aero_window;
                  samp <= center_samp + aero_window; samp++, curr_pix++)
             {
@@ -2367,11 +2464,7 @@ bool find_closest_non_water
                 if (samp < 0 || samp >= nsamps)
                     continue;
 
-                /* If this pixel is not fill and is not water, then mark it as
-                   the closest non-water pixel and return. */
-                if (!level1_qa_is_fill (qaband[curr_pix]) &&
-                    !is_water (sband[SR_BAND4][curr_pix],
-                               sband[SR_BAND5][curr_pix]))
+                if (!(pclass[curr_pix] & reject))
                 {
                     *nearest_line = line;
                     *nearest_samp = samp;
@@ -22,6 +22,14 @@ NOTES:
   1. The input files should be character a pointer set to NULL on input. Memory
      for these pointers is allocated by this routine. The caller is responsible
      for freeing the allocated memory upon successful return.
+  2. Either the XML and auxiliary files, the batch file, or the spool
+     directory must be specified, unless the ratio averages are being
+     packed.
+  3. A window or a lat/long bounding box of the scene may be specified,
+     but only for a single scene, along with the median aerosol of the full
+     scene to be used for it.
+  4. A quick look may be made of a single scene, but not of a window.
+  5. The aerosol inversion may only be checkpointed for a single scene.
 ******************************************************************************/
 int get_args
 (
@@ -32,6 +40,31 @@ int get_args
                                 water vapor and ozone */
     bool *process_sr,     /* O: process the surface reflectance products */
     bool *write_toa,      /* O: write intermediate TOA products flag */
+    int *prefetch_depth,  /* O: number of input bands to read ahead */
+    int *angle_decimation,  /* O: number of lines/samples between the
+                                  per-pixel angles held in memory */
+    Myformat_t *output_format,  /* O: file format for the output bands */
+    char **batch_infile,  /* O: address of input batch file listing the XML
+                                and auxiliary files for multiple scenes */
+    char **spool_dir,     /* O: address of spool directory for the worker
+                                to take jobs from */
+    int *concurrency,     /* O: number of batch scenes to process at once */
+    int *max_memory,      /* O: memory budget (MB) for the batch scenes
+                                being processed at once; 0 is no limit */
+    bool *pack_ratios,    /* O: pack the ratio averages instead of
+                                processing scenes */
+    bool *use_window,     /* O: process only the window of the scene */
+    Window_t *window,     /* O: window of the scene to be processed, and the
+                                median aerosol of the full scene */
+    bool *use_bbox,       /* O: process only the bounding box of the
+                                scene */
+    double *bbox,         /* O: lat/long bounding box of the scene to be
+                                processed, NBBOX_COORDS values indexed by
+                                ESPA_WEST, etc. (degrees) */
+    int *quicklook,       /* O: reduction factor for a quick look of the
+                                scene; 1 is full resolution */
+    bool *checkpoint,     /* O: checkpoint the aerosol inversion flag */
+    bool *numa,           /* O: NUMA placement flag */
     bool *verbose         /* O: verbose flag */
 )
 {
@@ -39,17 +72,37 @@ int get_args
     int option_index;                /* index for the command-line option */
     static int verbose_flag=0;       /* verbose flag */
     static int write_toa_flag=0;     /* write TOA flag */
+    static int numa_flag=0;          /* NUMA placement flag */
+    static int checkpoint_flag=0;    /* checkpoint the aerosol inversion
+                                        flag */
+    static int pack_ratios_flag=0;   /* pack the ratio averages flag */
     char errmsg[STR_SIZE];           /* error message */
     char FUNC_NAME[] = "get_args";   /* function name */
+    char extra;                      /* extra character after a list of
+                                        values */
     static int version_flag=0;       /* flag to print version number instead
                                         of processing */
     static struct option long_options[] =
     {
         {"verbose", no_argument, &verbose_flag, 1},
         {"write_toa", no_argument, &write_toa_flag, 1},
+        {"numa", no_argument, &numa_flag, 1},
+        {"checkpoint", no_argument, &checkpoint_flag, 1},
+        {"pack_ratios", no_argument, &pack_ratios_flag, 1},
         {"xml", required_argument, 0, 'i'},
         {"aux", required_argument, 0, 'a'},
         {"process_sr", required_argument, 0, 'p'},
+        {"prefetch_depth", required_argument, 0, 'd'},
+        {"angle_decimation", required_argument, 0, 'n'},
+        {"output_format", required_argument, 0, 'f'},
+        {"batch", required_argument, 0, 'b'},
+        {"spool", required_argument, 0, 's'},
+        {"concurrency", required_argument, 0, 'c'},
+        {"max_memory", required_argument, 0, 'm'},
+        {"window", required_argument, 0, 'w'},
+        {"bbox", required_argument, 0, 'x'},
+        {"quicklook", required_argument, 0, 'q'},
+        {"median_aerosol", required_argument, 0, 'e'},
         {"help", no_argument, 0, 'h'},
         {"version", no_argument, &version_flag, 1},
         {0, 0, 0, 0}
@@ -58,7 +111,19 @@ int get_args
     /* Initialize the flags to false */
     *verbose = false;
     *write_toa = false;
+    *numa = false;
+    *checkpoint = false;
+    *pack_ratios = false;
     *process_sr = true;    /* default is to process SR products */
+    *prefetch_depth = DEFAULT_PREFETCH_DEPTH;
+    *angle_decimation = 1;  /* default is full resolution angles */
+    *output_format = FORMAT_RAW;
+    *concurrency = 1;
+    *max_memory = 0;
+    *use_window = false;
+    *use_bbox = false;
+    window->median_aerosol = 0.0;
+    *quicklook = 1;
 
     /* Loop through all the cmd-line options */
     opterr = 0;   /* turn off getopt_long error msgs as we'll print our own */
@@ -107,6 +172,144 @@ int get_args
                 }
                 break;
      
+            case 'd':  /* number of bands to read ahead */
+                *prefetch_depth = atoi (optarg);
+                if (*prefetch_depth < 1 ||
+                    *prefetch_depth > MAX_PREFETCH_DEPTH)
+                {
+                    sprintf (errmsg, "Invalid value for prefetch_depth: %s.  "
+                        "Must be between 1 and %d.", optarg,
+                        MAX_PREFETCH_DEPTH);
+                    error_handler (true, FUNC_NAME, errmsg);
+                    usage ();
+                    return (ERROR);
+                }
+                break;
+     
+            case 'n':  /* decimation of the per-pixel angles */
+                *angle_decimation = atoi (optarg);
+                if (*angle_decimation < 1 ||
+                    *angle_decimation > MAX_ANGLE_DECIMATION)
+                {
+                    sprintf (errmsg, "Invalid value for angle_decimation: "
+                        "%s.  Must be between 1 and %d.", optarg,
+                        MAX_ANGLE_DECIMATION);
+                    error_handler (true, FUNC_NAME, errmsg);
+                    usage ();
+                    return (ERROR);
+                }
+                break;
+     
+            case 'f':  /* output file format */
+                if (!strcmp (optarg, "raw"))
+                    *output_format = FORMAT_RAW;
+                else if (!strcmp (optarg, "tiled"))
+                    *output_format = FORMAT_TILED;
+                else
+                {
+                    sprintf (errmsg, "Unknown value for output_format: %s",
+                        optarg);
+                    error_handler (true, FUNC_NAME, errmsg);
+                    usage ();
+                    return (ERROR);
+                }
+                break;
+     
+            case 'b':  /* batch input file */
+                *batch_infile = strdup (optarg);
+                break;
+     
+            case 's':  /* spool directory for the worker */
+                *spool_dir = strdup (optarg);
+                break;
+     
+            case 'c':  /* number of batch scenes to process at once */
+                *concurrency = atoi (optarg);
+                if (*concurrency < 1)
+                {
+                    sprintf (errmsg, "Invalid value for concurrency: %s.  "
+                        "Must be at least 1.", optarg);
+                    error_handler (true, FUNC_NAME, errmsg);
+                    usage ();
+                    return (ERROR);
+                }
+                break;
+     
+            case 'm':  /* memory budget for the batch scenes (MB) */
+                *max_memory = atoi (optarg);
+                if (*max_memory < 0)
+                {
+                    sprintf (errmsg, "Invalid value for max_memory: %s.  "
+                        "Must be 0 (no limit) or a number of megabytes.",
+                        optarg);
+                    error_handler (true, FUNC_NAME, errmsg);
+                    usage ();
+                    return (ERROR);
+                }
+                break;
+     
+            case 'w':  /* window of the scene */
+                if (sscanf (optarg, "%d,%d,%d,%d%c", &window->line0,
+                    &window->samp0, &window->nlines, &window->nsamps,
+                    &extra) != 4 || window->line0 < 0 ||
+                    window->samp0 < 0 || window->nlines < 1 ||
+                    window->nsamps < 1)
+                {
+                    sprintf (errmsg, "Invalid value for window: %s.  Must be "
+                        "line0,samp0,nlines,nsamps with a non-negative start "
+                        "and a positive size.", optarg);
+                    error_handler (true, FUNC_NAME, errmsg);
+                    usage ();
+                    return (ERROR);
+                }
+                *use_window = true;
+                break;
+     
+            case 'x':  /* lat/long bounding box of the scene */
+                if (sscanf (optarg, "%lf,%lf,%lf,%lf%c", &bbox[ESPA_WEST],
+                    &bbox[ESPA_SOUTH], &bbox[ESPA_EAST], &bbox[ESPA_NORTH],
+                    &extra) != 4 ||
+                    bbox[ESPA_WEST] >= bbox[ESPA_EAST] ||
+                    bbox[ESPA_SOUTH] >= bbox[ESPA_NORTH] ||
+                    bbox[ESPA_WEST] < -180.0 || bbox[ESPA_EAST] > 180.0 ||
+                    bbox[ESPA_SOUTH] < -90.0 || bbox[ESPA_NORTH] > 90.0)
+                {
+                    sprintf (errmsg, "Invalid value for bbox: %s.  Must be "
+                        "west,south,east,north in degrees, with west < east "
+                        "and south < north.", optarg);
+                    error_handler (true, FUNC_NAME, errmsg);
+                    usage ();
+                    return (ERROR);
+                }
+                *use_bbox = true;
+                break;
+     
+            case 'e':  /* median aerosol of the full scene */
+                if (sscanf (optarg, "%f%c", &window->median_aerosol,
+                    &extra) != 1 || window->median_aerosol <= 0.0)
+                {
+                    sprintf (errmsg, "Invalid value for median_aerosol: %s.  "
+                        "Must be the positive median aerosol value printed "
+                        "by a full scene run.", optarg);
+                    error_handler (true, FUNC_NAME, errmsg);
+                    usage ();
+                    return (ERROR);
+                }
+                break;
+     
+            case 'q':  /* quick-look reduction factor */
+                if (sscanf (optarg, "%d%c", quicklook, &extra) != 1 ||
+                    *quicklook < 1 || *quicklook > MAX_QUICKLOOK)
+                {
+                    sprintf (errmsg, "Invalid value for quicklook: %s.  Must "
+                        "be a reduction factor from 1 to %d.", optarg,
+                        MAX_QUICKLOOK);
+                    error_handler (true, FUNC_NAME, errmsg);
+                    usage ();
+                    return (ERROR);
+                }
+                break;
+     
             case '?':
             default:
                 sprintf (errmsg, "Unknown option %s", argv[optind-1]);
@@ -124,6 +327,127 @@ int get_args
         exit(EXIT_SUCCESS);
     }
 
+    /* Check the flags */
+    if (verbose_flag)
+        *verbose = true;
+    if (write_toa_flag)
+        *write_toa = true;
+    if (numa_flag)
+        *numa = true;
+    if (checkpoint_flag)
+        *checkpoint = true;
+    if (pack_ratios_flag)
+        *pack_ratios = true;
+
+    /* Packing the ratio averages doesn't process any scenes */
+    if (*pack_ratios)
+    {
+        if (*xml_infile != NULL || *aux_infile != NULL ||
+            *batch_infile != NULL || *spool_dir != NULL)
+        {
+            sprintf (errmsg, "--pack_ratios doesn't process any scenes, so "
+                "the scenes should not be specified with it");
+            error_handler (true, FUNC_NAME, errmsg);
+            usage ();
+            return (ERROR);
+        }
+        return (SUCCESS);
+    }
+
+    /* A window of the scene is only processed for a single scene */
+    if (*use_window && *use_bbox)
+    {
+        sprintf (errmsg, "Only one of --window and --bbox may be specified");
+        error_handler (true, FUNC_NAME, errmsg);
+        usage ();
+        return (ERROR);
+    }
+    if ((*use_window || *use_bbox) &&
+        (*batch_infile != NULL || *spool_dir != NULL))
+    {
+        sprintf (errmsg, "--window and --bbox are only supported for a "
+            "single scene, not with --batch or --spool");
+        error_handler (true, FUNC_NAME, errmsg);
+        usage ();
+        return (ERROR);
+    }
+
+    /* The median aerosol of the full scene is only carried into a window */
+    if (window->median_aerosol > 0.0 && !*use_window && !*use_bbox)
+    {
+        sprintf (errmsg, "--median_aerosol is only used with --window or "
+            "--bbox");
+        error_handler (true, FUNC_NAME, errmsg);
+        usage ();
+        return (ERROR);
+    }
+
+    /* A quick look is of a whole, single scene */
+    if (*quicklook > 1 && (*use_window || *use_bbox))
+    {
+        sprintf (errmsg, "--quicklook is not supported with --window or "
+            "--bbox");
+        error_handler (true, FUNC_NAME, errmsg);
+        usage ();
+        return (ERROR);
+    }
+    if (*quicklook > 1 && (*batch_infile != NULL || *spool_dir != NULL))
+    {
+        sprintf (errmsg, "--quicklook is only supported for a single scene, "
+            "not with --batch or --spool");
+        error_handler (true, FUNC_NAME, errmsg);
+        usage ();
+        return (ERROR);
+    }
+
+    /* The aerosol checkpoint is named for the scene's product ID, and is
+       only written for a single scene */
+    if (*checkpoint && (*batch_infile != NULL || *spool_dir != NULL))
+    {
+        sprintf (errmsg, "--checkpoint is only supported for a single scene, "
+            "not with --batch or --spool");
+        error_handler (true, FUNC_NAME, errmsg);
+        usage ();
+        return (ERROR);
+    }
+
+    /* The batch file provides the XML and auxiliary files for each scene */
+    if (*batch_infile != NULL)
+    {
+        if (*xml_infile != NULL || *aux_infile != NULL)
+        {
+            sprintf (errmsg, "The XML and auxiliary files come from the batch "
+                "file and should not be specified with --batch");
+            error_handler (true, FUNC_NAME, errmsg);
+            usage ();
+            return (ERROR);
+        }
+        if (*spool_dir != NULL)
+        {
+            sprintf (errmsg, "Only one of --batch and --spool may be "
+                "specified");
+            error_handler (true, FUNC_NAME, errmsg);
+            usage ();
+            return (ERROR);
+        }
+        return (SUCCESS);
+    }
+
+    /* The jobs in the spool directory provide the XML and auxiliary files */
+    if (*spool_dir != NULL)
+    {
+        if (*xml_infile != NULL || *aux_infile != NULL)
+        {
+            sprintf (errmsg, "The XML and auxiliary files come from the jobs "
+                "in the spool directory and should not be specified with "
+                "--spool");
+            error_handler (true, FUNC_NAME, errmsg);
+            usage ();
+            return (ERROR);
+        }
+        return (SUCCESS);
+    }
+
     /* Make sure the XML file was specified */
     if (*xml_infile == NULL)
     {
@@ -143,11 +467,5 @@ int get_args
         return (ERROR);
     }
 
-    /* Check the flags */
-    if (verbose_flag)
-        *verbose = true;
-    if (write_toa_flag)
-        *write_toa = true;
-
     return (SUCCESS);
 }
@@ -197,6 +197,21 @@ Input_t *open_input
         return (NULL);
     }
 
+    /* The whole scene is read and written at full resolution unless a window
+       or quick look is set */
+    this->quicklook = 1;
+    this->full_nlines = this->size.nlines;
+    this->full_nsamps = this->size.nsamps;
+    this->scene_nlines = this->size.nlines;
+    this->scene_nsamps = this->size.nsamps;
+    this->line0 = 0;
+    this->samp0 = 0;
+    this->out_window.line0 = 0;
+    this->out_window.samp0 = 0;
+    this->out_window.nlines = this->size.nlines;
+    this->out_window.nsamps = this->size.nsamps;
+    this->out_window.median_aerosol = 0.0;
+
     return this;
 }
 
@@ -315,6 +330,464 @@ void free_input
 }
 
 
+/******************************************************************************
+MODULE:  bands_same_size
+
+PURPOSE:  Checks that the reflectance, thermal, QA, and per-pixel angle bands
+are all the same size.
+
+RETURN VALUE:
+Type = bool
+Value      Description
+-----      -----------
+true       The bands are the same size
+false      The bands are not the same size
+
+NOTES:
+******************************************************************************/
+static bool bands_same_size
+(
+    Input_t *this    /* I: pointer to input data structure */
+)
+{
+    if (this->nband_th != 0 &&
+        (this->size_th.nlines != this->size.nlines ||
+         this->size_th.nsamps != this->size.nsamps))
+        return (false);
+
+    return (this->size_qa.nlines == this->size.nlines &&
+        this->size_qa.nsamps == this->size.nsamps &&
+        this->size_ppa.nlines == this->size.nlines &&
+        this->size_ppa.nsamps == this->size.nsamps);
+}
+
+
+/******************************************************************************
+MODULE:  set_input_window
+
+PURPOSE:  Limits the reading of the reflectance, thermal, QA, and per-pixel
+angle bands to a window of the scene, and sets the window of the scene to be
+written to the output products.
+
+RETURN VALUE:
+Type = int
+Value      Description
+-----      -----------
+ERROR      The windows don't fit in the scene, or the bands aren't all the
+           same size
+SUCCESS    Successful completion
+
+NOTES:
+  1. The sizes of the bands in the input structure become the size of the
+     window read, and the lines and samples passed to the get_input_*_lines
+     routines are relative to the window.  The pan band is not windowed.
+  2. Call this once, right after open_input.
+******************************************************************************/
+int set_input_window
+(
+    Input_t *this,   /* I/O: pointer to input data structure */
+    Window_t *read_window,  /* I: window of the scene to be read */
+    Window_t *out_window    /* I: window of the scene to be written, within
+                                  read_window */
+)
+{
+    char FUNC_NAME[] = "set_input_window";   /* function name */
+    char errmsg[STR_SIZE];    /* error message */
+
+    /* The windows are applied to all the bands read for the corrections, so
+       they must all be on the same grid */
+    if (!bands_same_size (this))
+    {
+        sprintf (errmsg, "The reflectance, thermal, QA, and angle bands must "
+            "be the same size to process a window of the scene");
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    if (read_window->line0 < 0 || read_window->samp0 < 0 ||
+        read_window->nlines < 1 || read_window->nsamps < 1 ||
+        read_window->line0 + read_window->nlines > this->scene_nlines ||
+        read_window->samp0 + read_window->nsamps > this->scene_nsamps)
+    {
+        sprintf (errmsg, "Window of lines %d-%d, samples %d-%d is not within "
+            "the %d x %d scene", read_window->line0,
+            read_window->line0 + read_window->nlines - 1, read_window->samp0,
+            read_window->samp0 + read_window->nsamps - 1, this->scene_nlines,
+            this->scene_nsamps);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    if (out_window->line0 < read_window->line0 ||
+        out_window->samp0 < read_window->samp0 ||
+        out_window->nlines < 1 || out_window->nsamps < 1 ||
+        out_window->line0 + out_window->nlines >
+            read_window->line0 + read_window->nlines ||
+        out_window->samp0 + out_window->nsamps >
+            read_window->samp0 + read_window->nsamps)
+    {
+        sprintf (errmsg, "The output window is not within the window read");
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    this->line0 = read_window->line0;
+    this->samp0 = read_window->samp0;
+    this->size.nlines = this->size_qa.nlines = this->size_ppa.nlines =
+        read_window->nlines;
+    this->size.nsamps = this->size_qa.nsamps = this->size_ppa.nsamps =
+        read_window->nsamps;
+    if (this->nband_th != 0)
+    {
+        this->size_th.nlines = read_window->nlines;
+        this->size_th.nsamps = read_window->nsamps;
+    }
+    this->out_window = *out_window;
+
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  uses_window_median
+
+PURPOSE:  Determines if the median aerosol of the surface reflectance
+corrections is found over a window of the scene rather than the full scene.
+
+RETURN VALUE:
+Type = bool
+Value      Description
+-----      -----------
+true       Only a window of the scene is read, and the median aerosol of the
+           full scene wasn't carried in for it
+false      The full scene is read, or its median aerosol was carried in
+
+NOTES:
+  1. The cloud, shadow, water, and failed aerosol retrieval pixels use the
+     median aerosol, so they only match a full scene run when it's that of
+     the full scene.
+******************************************************************************/
+bool uses_window_median
+(
+    Input_t *this    /* I: pointer to input data structure */
+)
+{
+    if (this->size.nlines == this->scene_nlines &&
+        this->size.nsamps == this->scene_nsamps)
+        return (false);
+    return (this->out_window.median_aerosol <= 0.0);
+}
+
+
+/******************************************************************************
+MODULE:  set_input_quicklook
+
+PURPOSE:  Reduces the reflectance, thermal, QA, and per-pixel angle bands to a
+grid with 1/factor of the lines and samples, for a quick look at the scene.
+
+RETURN VALUE:
+Type = int
+Value      Description
+-----      -----------
+ERROR      Invalid factor, or the bands aren't all the same size
+SUCCESS    Successful completion
+
+NOTES:
+  1. Each pixel of the reduced grid covers a block of factor x factor full
+     resolution pixels; the blocks on the last line and sample of the grid
+     may be partial.  The reflectance and thermal bands are box filtered as
+     they are read (see read_reduced_lines), and the QA and angle bands take
+     the center pixel of each block.
+  2. The sizes in the input structure, including the scene size, become the
+     size of the reduced grid, and the pixel sizes are scaled by the factor.
+     Only a few full resolution lines are held while reading, never a full
+     resolution band.
+  3. Call this once, right after open_input.  It can't be combined with a
+     window of the scene.
+******************************************************************************/
+int set_input_quicklook
+(
+    Input_t *this,   /* I/O: pointer to input data structure */
+    int factor       /* I: reduction factor for the lines and samples */
+)
+{
+    char FUNC_NAME[] = "set_input_quicklook";   /* function name */
+    char errmsg[STR_SIZE];    /* error message */
+    int nlines, nsamps;       /* size of the reduced grid */
+
+    if (factor < 1 || factor > MAX_QUICKLOOK)
+    {
+        sprintf (errmsg, "Invalid quick-look factor %d.  Must be between 1 "
+            "and %d.", factor, MAX_QUICKLOOK);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    if (!bands_same_size (this))
+    {
+        sprintf (errmsg, "The reflectance, thermal, QA, and angle bands must "
+            "be the same size for a quick look");
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    if (this->line0 != 0 || this->samp0 != 0 ||
+        this->size.nlines != this->scene_nlines ||
+        this->size.nsamps != this->scene_nsamps)
+    {
+        sprintf (errmsg, "A quick look can't be combined with a window of "
+            "the scene");
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    this->quicklook = factor;
+    this->full_nlines = this->size.nlines;
+    this->full_nsamps = this->size.nsamps;
+    nlines = (this->full_nlines + factor - 1) / factor;
+    nsamps = (this->full_nsamps + factor - 1) / factor;
+
+    this->scene_nlines = this->size.nlines = this->size_qa.nlines =
+        this->size_ppa.nlines = nlines;
+    this->scene_nsamps = this->size.nsamps = this->size_qa.nsamps =
+        this->size_ppa.nsamps = nsamps;
+    this->size.pixsize[0] *= factor;
+    this->size.pixsize[1] *= factor;
+    this->size_qa.pixsize[0] *= factor;
+    this->size_qa.pixsize[1] *= factor;
+    this->size_ppa.pixsize[0] *= factor;
+    this->size_ppa.pixsize[1] *= factor;
+    if (this->nband_th != 0)
+    {
+        this->size_th.nlines = nlines;
+        this->size_th.nsamps = nsamps;
+        this->size_th.pixsize[0] *= factor;
+        this->size_th.pixsize[1] *= factor;
+    }
+    this->out_window.nlines = nlines;
+    this->out_window.nsamps = nsamps;
+
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  read_reduced_lines
+
+PURPOSE:  Reads lines of the quick-look grid from one of the input band files,
+reducing each block of full resolution pixels to a single pixel.
+
+RETURN VALUE:
+Type = int
+Value      Description
+-----      -----------
+ERROR      Error occurred allocating memory, seeking, or reading the lines
+SUCCESS    Successful completion
+
+NOTES:
+  1. With average, the band must be uint16 Level-1 data.  Each pixel is the
+     rounded mean of the valid (non-fill, unsaturated) pixels of its block.
+     A block with no valid pixels is saturated if any of its pixels are
+     saturated, and fill otherwise.
+  2. Without average, each pixel is the center pixel of its block, and only
+     the center line of each block is read.
+******************************************************************************/
+static int read_reduced_lines
+(
+    Input_t *this,   /* I: pointer to input data structure */
+    FILE *fp_bin,    /* I: pointer for the band file to read */
+    int iline,       /* I: current line of the reduced grid to read
+                           (0-based) */
+    int nlines,      /* I: number of lines to read */
+    int nbytes,      /* I: number of bytes per pixel in the band */
+    bool average,    /* I: average the pixels of each block, rather than
+                           taking the center pixel */
+    void *out_arr    /* O: output array to populate, nlines x reduced
+                           samples */
+)
+{
+    char FUNC_NAME[] = "read_reduced_lines";   /* function name */
+    char errmsg[STR_SIZE];    /* error message */
+    int factor = this->quicklook;  /* reduction factor */
+    int line;                 /* looping variable for the reduced lines */
+    int samp;                 /* looping variable for the reduced samples */
+    int bline, bsamp;         /* looping variables for the block pixels */
+    int first_line;           /* first full resolution line of the block */
+    int first_samp;           /* first full resolution sample of the block */
+    int block_nlines;         /* number of full resolution lines in the
+                                 block */
+    int end_samp;             /* full resolution sample after the block */
+    int count;                /* number of valid pixels in the block */
+    int nsatu;                /* number of saturated pixels in the block */
+    long sum;                 /* sum of the valid pixels in the block */
+    uint16 pix;               /* current full resolution pixel */
+    uint16 *ustrip = NULL;    /* full resolution lines of the block, as
+                                 uint16 */
+    uint16 *uout = NULL;      /* current output line, as uint16 */
+    unsigned char *strip = NULL;  /* full resolution lines of the block */
+    unsigned char *out_line = (unsigned char *) out_arr;  /* current output
+                                 line */
+
+    strip = malloc ((size_t) factor * this->full_nsamps * nbytes);
+    if (strip == NULL)
+    {
+        sprintf (errmsg, "Allocating the quick-look line buffer");
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+    ustrip = (uint16 *) strip;
+
+    for (line = 0; line < nlines; line++)
+    {
+        first_line = (iline + line) * factor;
+        block_nlines = MIN (factor, this->full_nlines - first_line);
+        if (!average)
+            first_line += MIN (factor / 2, block_nlines - 1);
+
+        /* Read the lines of the block, or just its center line */
+        if (fseek (fp_bin, (long) first_line * this->full_nsamps * nbytes,
+            SEEK_SET) ||
+            read_raw_binary (fp_bin, average ? block_nlines : 1,
+            this->full_nsamps, nbytes, strip) != SUCCESS)
+        {
+            sprintf (errmsg, "Reading full resolution line %d", first_line);
+            error_handler (true, FUNC_NAME, errmsg);
+            free (strip);
+            return (ERROR);
+        }
+
+        if (!average)
+        {
+            for (samp = 0; samp < this->size.nsamps; samp++)
+            {
+                first_samp = MIN (samp * factor + factor / 2,
+                    this->full_nsamps - 1);
+                memcpy (&out_line[(long) samp * nbytes],
+                    &strip[(long) first_samp * nbytes], nbytes);
+            }
+            out_line += (long) this->size.nsamps * nbytes;
+            continue;
+        }
+
+        uout = (uint16 *) out_line;
+        for (samp = 0; samp < this->size.nsamps; samp++)
+        {
+            first_samp = samp * factor;
+            end_samp = MIN (first_samp + factor, this->full_nsamps);
+            sum = 0;
+            count = 0;
+            nsatu = 0;
+            for (bline = 0; bline < block_nlines; bline++)
+            {
+                for (bsamp = first_samp; bsamp < end_samp; bsamp++)
+                {
+                    pix = ustrip[(long) bline * this->full_nsamps + bsamp];
+                    if (pix == L1_SATURATED)
+                        nsatu++;
+                    else if (pix != this->meta.fill)
+                    {
+                        sum += pix;
+                        count++;
+                    }
+                }
+            }
+
+            if (count > 0)
+                uout[samp] = (uint16) ((sum + count / 2) / count);
+            else if (nsatu > 0)
+                uout[samp] = L1_SATURATED;
+            else
+                uout[samp] = this->meta.fill;
+        }
+        out_line += (long) this->size.nsamps * nbytes;
+    }
+
+    free (strip);
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  read_window_lines
+
+PURPOSE:  Reads lines of the window of the scene from one of the input band
+files.
+
+RETURN VALUE:
+Type = int
+Value      Description
+-----      -----------
+ERROR      Error occurred seeking or reading the lines
+SUCCESS    Successful completion
+
+NOTES:
+  1. When the window spans the full width of the scene (or no window is set)
+     the lines are read with a single read, otherwise each line of the window
+     is read separately.  All the bands are the same size when a window is
+     set (see set_input_window).
+  2. For a quick look the lines of the reduced grid are read instead (see
+     read_reduced_lines).
+******************************************************************************/
+static int read_window_lines
+(
+    Input_t *this,   /* I: pointer to input data structure */
+    FILE *fp_bin,    /* I: pointer for the band file to read */
+    int iline,       /* I: current line of the window to read (0-based) */
+    int nlines,      /* I: number of lines to read */
+    int nsamps,      /* I: number of samples in the band (or the window) */
+    int nbytes,      /* I: number of bytes per pixel in the band */
+    bool average,    /* I: for a quick look, average the pixels of each
+                           block rather than taking the center pixel */
+    void *out_arr    /* O: output array to populate, nlines x window
+                           samples */
+)
+{
+    char FUNC_NAME[] = "read_window_lines";   /* function name */
+    char errmsg[STR_SIZE];    /* error message */
+    int line;                 /* looping variable for the lines */
+    long loc;                 /* current location in the input file */
+    long line_bytes;          /* number of bytes in a line of the scene */
+    unsigned char *out_line = (unsigned char *) out_arr;  /* current line of
+                                 the output array */
+
+    if (this->quicklook > 1)
+        return (read_reduced_lines (this, fp_bin, iline, nlines, nbytes,
+            average, out_arr));
+
+    if (this->size.nsamps == this->scene_nsamps)
+    {
+        loc = (long) (this->line0 + iline) * nsamps * nbytes;
+        if (fseek (fp_bin, loc, SEEK_SET))
+        {
+            sprintf (errmsg, "Seeking to line %d in the input file", iline);
+            error_handler (true, FUNC_NAME, errmsg);
+            return (ERROR);
+        }
+        return (read_raw_binary (fp_bin, nlines, nsamps, nbytes, out_arr));
+    }
+
+    line_bytes = (long) this->scene_nsamps * nbytes;
+    loc = (long) (this->line0 + iline) * line_bytes +
+        (long) this->samp0 * nbytes;
+
+    for (line = 0; line < nlines; line++, loc += line_bytes)
+    {
+        if (fseek (fp_bin, loc, SEEK_SET))
+        {
+            sprintf (errmsg, "Seeking to line %d in the input file",
+                iline + line);
+            error_handler (true, FUNC_NAME, errmsg);
+            return (ERROR);
+        }
+        if (read_raw_binary (fp_bin, 1, nsamps, nbytes, out_line) != SUCCESS)
+            return (ERROR);
+        out_line += (long) nsamps * nbytes;
+    }
+
+    return (SUCCESS);
+}
+
+
 /******************************************************************************
 MODULE:  get_input_refl_lines
 
@@ -343,7 +816,6 @@ int get_input_refl_lines
 {
     char FUNC_NAME[] = "get_input_refl_line";   /* function name */
     char errmsg[STR_SIZE];    /* error message */
-    long loc;                 /* current location in the input file */
   
     /* Check the parameters */
     if (this == NULL) 
@@ -371,17 +843,9 @@ int get_input_refl_lines
         return (ERROR);
     }
   
-    /* Read the data, but first seek to the correct line */
-    loc = (long) iline * this->size.nsamps * sizeof (uint16);
-    if (fseek (this->fp_bin[iband], loc, SEEK_SET))
-    {
-        strcpy (errmsg, "Seeking to the current line in the input file");
-        error_handler (true, FUNC_NAME, errmsg);
-        return (ERROR);
-    }
-
-    if (read_raw_binary (this->fp_bin[iband], nlines, this->size.nsamps,
-        sizeof (uint16), out_arr) != SUCCESS)
+    /* Read the lines of the window */
+    if (read_window_lines (this, this->fp_bin[iband], iline, nlines,
+        this->size.nsamps, sizeof (uint16), true, out_arr) != SUCCESS)
     {
         sprintf (errmsg, "Reading %d lines from reflectance band %d starting "
             "at line %d", nlines, iband, iline);
@@ -421,7 +885,6 @@ int get_input_th_lines
 {
     char FUNC_NAME[] = "get_input_th_line";   /* function name */
     char errmsg[STR_SIZE];    /* error message */
-    long loc;                 /* current location in the input file */
   
     /* Check the parameters */
     if (this == NULL) 
@@ -449,17 +912,9 @@ int get_input_th_lines
         return (ERROR);
     }
   
-    /* Read the data, but first seek to the correct line */
-    loc = (long) iline * this->size_th.nsamps * sizeof (uint16);
-    if (fseek (this->fp_bin_th[iband], loc, SEEK_SET))
-    {
-        strcpy (errmsg, "Seeking to the current line in the input file");
-        error_handler (true, FUNC_NAME, errmsg);
-        return (ERROR);
-    }
-
-    if (read_raw_binary (this->fp_bin_th[iband], nlines, this->size_th.nsamps,
-        sizeof (uint16), out_arr) != SUCCESS)
+    /* Read the lines of the window */
+    if (read_window_lines (this, this->fp_bin_th[iband], iline, nlines,
+        this->size_th.nsamps, sizeof (uint16), true, out_arr) != SUCCESS)
     {
         sprintf (errmsg, "Reading %d lines from thermal band %d starting at "
             "line %d", nlines, iband, iline);
@@ -577,7 +1032,6 @@ int get_input_qa_lines
 {
     char FUNC_NAME[] = "get_input_qa_line";   /* function name */
     char errmsg[STR_SIZE];    /* error message */
-    long loc;                 /* current location in the input file */
   
     /* Check the parameters */
     if (this == NULL) 
@@ -605,17 +1059,9 @@ int get_input_qa_lines
         return (ERROR);
     }
   
-    /* Read the data, but first seek to the correct line */
-    loc = (long) iline * this->size_qa.nsamps * sizeof (uint16);
-    if (fseek (this->fp_bin_qa[iband], loc, SEEK_SET))
-    {
-        strcpy (errmsg, "Seeking to the current line in the input file");
-        error_handler (true, FUNC_NAME, errmsg);
-        return (ERROR);
-    }
-
-    if (read_raw_binary (this->fp_bin_qa[iband], nlines, this->size_qa.nsamps,
-        sizeof (uint16), out_arr) != SUCCESS)
+    /* Read the lines of the window */
+    if (read_window_lines (this, this->fp_bin_qa[iband], iline, nlines,
+        this->size_qa.nsamps, sizeof (uint16), false, out_arr) != SUCCESS)
     {
         sprintf (errmsg, "Reading %d lines from QA band %d starting at "
             "line %d", nlines, iband, iline);
@@ -630,34 +1076,36 @@ int get_input_qa_lines
 /******************************************************************************
 MODULE:  get_input_ppa_lines
 
-PURPOSE:  Reads the per-pixel angle data for the current solar/view angle bands
-and populates the output buffer.
+PURPOSE:  Reads the per-pixel angle data for the specified solar/view angle
+band and populates the output buffer.
 
 RETURN VALUE:
 Type = int
 Value      Description
 -----      -----------
-ERROR      Error occurred reading data for these bands
+ERROR      Error occurred reading data for this band
 SUCCESS    Successful completion
 
 NOTES:
   1. The Input_t data structure needs to be populated and memory allocated
      before calling this routine.  Use open_input to do that.
+  2. Only the angle band requested is read, so the callers only need to read
+     (and hold in memory) the angles they actually use.
 ******************************************************************************/
 int get_input_ppa_lines
 (
     Input_t *this,   /* I: pointer to input data structure */
+    Myppa_t ippa,    /* I: angle band to read */
     int iline,       /* I: current line to read (0-based) */
     int nlines,      /* I: number of lines to read */
-    int16 *sza_arr, /* O: output solar zenith array to populate */
-    int16 *saa_arr, /* O: output solar azimuth array to populate */
-    int16 *vza_arr, /* O: output view zenith array to populate */
-    int16 *vaa_arr  /* O: output view azimuth array to populate */
+    int16 *out_arr   /* O: output array to populate */
 )
 {
     char FUNC_NAME[] = "get_input_ppa_lines";   /* function name */
     char errmsg[STR_SIZE];    /* error message */
-    long loc;                 /* current location in the input file */
+    FILE *fp_bin = NULL;      /* pointer for the angle binary file */
+    char *ppa_name[PPA_TTL] = {"solar zenith", "solar azimuth",
+        "view zenith", "view azimuth"};  /* angle band names */
   
     /* Check the parameters */
     if (this == NULL) 
@@ -678,72 +1126,25 @@ int get_input_ppa_lines
         error_handler (true, FUNC_NAME, errmsg);
         return (ERROR);
     }
-  
-    /* Read the solar zenith data, but first seek to the correct line */
-    loc = (long) iline * this->size_ppa.nsamps * sizeof (int16);
-    if (fseek (this->fp_bin_sza, loc, SEEK_SET))
-    {
-        strcpy (errmsg, "Seeking to the current line in the sza input file");
-        error_handler (true, FUNC_NAME, errmsg);
-        return (ERROR);
-    }
-
-    if (read_raw_binary (this->fp_bin_sza, nlines, this->size_ppa.nsamps,
-        sizeof (int16), sza_arr) != SUCCESS)
-    {
-        sprintf (errmsg, "Reading %d lines from solar zenith band starting "
-            "at line %d", nlines, iline);
-        error_handler (true, FUNC_NAME, errmsg);
-        return (ERROR);
-    }
-  
-    /* Read the solar azimuth data, but first seek to the correct line */
-    if (fseek (this->fp_bin_saa, loc, SEEK_SET))
-    {
-        strcpy (errmsg, "Seeking to the current line in the saa input file");
-        error_handler (true, FUNC_NAME, errmsg);
-        return (ERROR);
-    }
 
-    if (read_raw_binary (this->fp_bin_saa, nlines, this->size_ppa.nsamps,
-        sizeof (int16), saa_arr) != SUCCESS)
+    switch (ippa)
     {
-        sprintf (errmsg, "Reading %d lines from solar azimuth band starting "
-            "at line %d", nlines, iline);
-        error_handler (true, FUNC_NAME, errmsg);
-        return (ERROR);
+        case PPA_SZA: fp_bin = this->fp_bin_sza; break;
+        case PPA_SAA: fp_bin = this->fp_bin_saa; break;
+        case PPA_VZA: fp_bin = this->fp_bin_vza; break;
+        case PPA_VAA: fp_bin = this->fp_bin_vaa; break;
+        default:
+            sprintf (errmsg, "Invalid per-pixel angle band: %d", ippa);
+            error_handler (true, FUNC_NAME, errmsg);
+            return (ERROR);
     }
   
-    /* Read the view zenith data, but first seek to the correct line */
-    if (fseek (this->fp_bin_vza, loc, SEEK_SET))
-    {
-        strcpy (errmsg, "Seeking to the current line in the vza input file");
-        error_handler (true, FUNC_NAME, errmsg);
-        return (ERROR);
-    }
-
-    if (read_raw_binary (this->fp_bin_vza, nlines, this->size_ppa.nsamps,
-        sizeof (int16), vza_arr) != SUCCESS)
-    {
-        sprintf (errmsg, "Reading %d lines from view zenith band starting "
-            "at line %d", nlines, iline);
-        error_handler (true, FUNC_NAME, errmsg);
-        return (ERROR);
-    }
-
-    /* Read the view azimuth data, but first seek to the correct line */
-    if (fseek (this->fp_bin_vaa, loc, SEEK_SET))
-    {
-        strcpy (errmsg, "Seeking to the current line in the vaa input file");
-        error_handler (true, FUNC_NAME, errmsg);
-        return (ERROR);
-    }
-
-    if (read_raw_binary (this->fp_bin_vaa, nlines, this->size_ppa.nsamps,
-        sizeof (int16), vaa_arr) != SUCCESS)
+    /* Read the lines of the window of the angle band */
+    if (read_window_lines (this, fp_bin, iline, nlines,
+        this->size_ppa.nsamps, sizeof (int16), false, out_arr) != SUCCESS)
     {
-        sprintf (errmsg, "Reading %d lines from view azimuth band starting "
-            "at line %d", nlines, iline);
+        sprintf (errmsg, "Reading %d lines from %s band starting at line %d",
+            nlines, ppa_name[ippa], iline);
         error_handler (true, FUNC_NAME, errmsg);
         return (ERROR);
     }
@@ -14,6 +14,13 @@
 #define ANGLE_FILL (-999.0)
 #define WRS_FILL (-1)
 #define GAIN_BIAS_FILL (-999.0)
+#define L1_SATURATED 65535       /* saturation value of the Level-1 pixel */
+
+/* Define the maximum quick-look reduction factor (see set_input_quicklook) */
+#define MAX_QUICKLOOK 32
+
+/* Per-pixel angle bands */
+typedef enum {PPA_SZA=0, PPA_SAA, PPA_VZA, PPA_VAA, PPA_TTL} Myppa_t;
 
 /* Structure for the input metadata */
 typedef struct {
@@ -43,6 +50,17 @@ typedef struct {
     float k2_const[NBAND_THM_MAX]; /* K2 constant for thermal bands */
 } Input_meta_t;
 
+/* Structure for a window of the scene, in scene lines/samples */
+typedef struct {
+    int line0;                 /* first line of the window (0-based) */
+    int samp0;                 /* first sample of the window (0-based) */
+    int nlines;                /* number of lines in the window */
+    int nsamps;                /* number of samples in the window */
+    float median_aerosol;      /* median aerosol of the full scene, carried
+                                  in from a full scene run; 0 if it's found
+                                  over the pixels read */
+} Window_t;
+
 /* Structure for the input data */
 typedef struct {
     Input_meta_t meta;         /* input metadata */
@@ -57,6 +75,23 @@ typedef struct {
     Img_coord_info_t size_qa;  /* input QA file size */
     Img_coord_info_t size_ppa; /* input per-pixel angle file size */
 
+    int scene_nlines;          /* number of lines in the scene */
+    int scene_nsamps;          /* number of samples in the scene */
+    int line0;                 /* first scene line read; the reflectance,
+                                  thermal, QA, and angle sizes above are the
+                                  size of the window of the scene read */
+    int samp0;                 /* first scene sample read */
+    Window_t out_window;       /* window of the scene written to the output
+                                  products, within the window read */
+    int quicklook;             /* quick-look reduction factor; 1 is full
+                                  resolution.  When reduced, the sizes above
+                                  (including the scene size) are the size of
+                                  the reduced grid. */
+    int full_nlines;           /* number of full resolution lines in the
+                                  bands, when reduced for a quick look */
+    int full_nsamps;           /* number of full resolution samples in the
+                                  bands, when reduced for a quick look */
+
     float scale_factor;       /* scale factor for reflectance bands */
     float scale_factor_th;    /* scale factor for thermal bands */
     float scale_factor_pan;   /* scale factor for pan bands */
@@ -105,6 +140,25 @@ void free_input
     Input_t *this    /* I: pointer to input data structure */
 );
 
+int set_input_window
+(
+    Input_t *this,   /* I/O: pointer to input data structure */
+    Window_t *read_window,  /* I: window of the scene to be read */
+    Window_t *out_window    /* I: window of the scene to be written, within
+                                  read_window */
+);
+
+bool uses_window_median
+(
+    Input_t *this    /* I: pointer to input data structure */
+);
+
+int set_input_quicklook
+(
+    Input_t *this,   /* I/O: pointer to input data structure */
+    int factor       /* I: reduction factor for the lines and samples */
+);
+
 int get_input_refl_lines
 (
     Input_t *this,   /* I: pointer to input data structure */
@@ -144,12 +198,10 @@ int get_input_qa_lines
 int get_input_ppa_lines
 (
     Input_t *this,   /* I: pointer to input data structure */
+    Myppa_t ippa,    /* I: angle band to read */
     int iline,       /* I: current line to read (0-based) */
     int nlines,      /* I: number of lines to read */
-    int16 *sza_arr, /* O: output solar zenith array to populate */
-    int16 *saa_arr, /* O: output solar azimuth array to populate */
-    int16 *vza_arr, /* O: output view zenith array to populate */
-    int16 *vaa_arr  /* O: output view azimuth array to populate */
+    int16 *out_arr   /* O: output array to populate */
 );
 
 int get_xml_input
@@ -1,4 +1,3 @@
-#include <sys/stat.h>
 #include <unistd.h>
 #include "lasrc.h"
 
@@ -48,39 +47,19 @@ int main (int argc, char *argv[])
     bool verbose;            /* verbose flag for printing messages */
     char FUNC_NAME[] = "main"; /* function name */
     char errmsg[STR_SIZE];   /* error message */
-    char envi_file[STR_SIZE];/* ENVI filename */
-    char *aux_path = NULL;   /* path for Landsat auxiliary data */
     char *xml_infile = NULL; /* input XML filename */
     char *aux_infile = NULL; /* input auxiliary filename for water vapor
                                 and ozone*/
-    char *cptr = NULL;       /* pointer to the file extension */
-    char aux_year[5];        /* string to contain the year of auxiliary file */
-
+    char *batch_infile = NULL; /* input batch filename listing the XML and
+                                  auxiliary files for multiple scenes */
+    char *spool_dir = NULL;  /* spool directory for the worker to take jobs
+                                from */
     int retval;              /* return status */
-    int ib;                  /* looping variable for input bands */
-    int i;                   /* looping variables */
-    Input_t *input = NULL;       /* input structure for the Landsat product */
-    Output_t *toa_output = NULL; /* output structure and metadata for the TOA
-                                    product */
-    Output_t *radsat_output = NULL; /* output structure and metadata for the
-                                       RADSAT product */
     Espa_internal_meta_t xml_metadata;  /* XML metadata structure */
-    Espa_global_meta_t *gmeta = NULL;   /* pointer to global meta */
-    Envi_header_t envi_hdr;      /* output ENVI header information */
-    struct stat statbuf;      /* buffer for the file stat function */
+    Sr_tables_t *tables = NULL;  /* static look-up tables and climate
+                                    modeling grids */
+    Aux_grid_t *aux = NULL;  /* ozone and water vapor grid for the scene */
 
-    int16 *sza = NULL;  /* per-pixel solar zenith angles, nlines x nsamps */
-    int16 *saa = NULL;  /* per-pixel solar azimuth angles, nlines x nsamps */
-    int16 *vza = NULL;  /* per-pixel view zenith angles, nlines x nsamps */
-    int16 *vaa = NULL;  /* per-pixel view azimuth angles, nlines x nsamps */
-    int16 **sband = NULL;     /* output surface reflectance and brightness
-                                 temp bands, qa band is separate as a uint16 */
-    uint16 *qaband = NULL;    /* QA band for the input image, nlines x nsamps */
-    uint16 *radsat = NULL;    /* QA band for radiometric saturation of the
-                                 Level-1 product, nlines x nsamps */
-
-    float xts;           /* scene center solar zenith angle (deg) */
-    float xmus;          /* cosine of solar zenith angle */
     bool process_sr = true;  /* this is set to false if the solar zenith
                                 is too large and the surface reflectance
                                 cannot be calculated or if the user specifies
@@ -89,30 +68,68 @@ int main (int argc, char *argv[])
                                 done */
     bool write_toa = false;  /* this is set to true if the user specifies
                                 TOA products should be output for delivery */
-    float pixsize;      /* pixel size for the reflectance bands */
-    int nlines, nsamps; /* number of lines and samples in the reflectance and
-                           thermal bands */
-
-    /* The following arguments are all names of the LUTs. The first five are
-       all tables of coefficients generated by the 6S software and provided
-       as input to this application. */
-    char anglehdf[STR_SIZE];  /* angle HDF filename */
-    char intrefnm[STR_SIZE];  /* intrinsic reflectance filename */
-    char transmnm[STR_SIZE];  /* transmission filename */
-    char spheranm[STR_SIZE];  /* spherical albedo filename */
-    char cmgdemnm[STR_SIZE];  /* climate modeling grid DEM filename */
-    char rationm[STR_SIZE];   /* ratio averages filename ("ratio map" used by
-                                 the aerosol retrieval algorithm) */
-    char auxnm[STR_SIZE];     /* auxiliary filename for ozone and water vapor*/
+    int prefetch_depth;      /* number of input bands to read ahead of the
+                                band being calibrated */
+    int angle_decimation;    /* number of lines/samples between the per-pixel
+                                angles held in memory */
+    Myformat_t output_format;  /* file format for the output bands */
+    int concurrency;         /* number of batch scenes to process at once */
+    int max_memory;          /* memory budget (MB) for the batch scenes being
+                                processed at once; 0 is no limit */
+    bool numa = false;       /* place the threads and scene arrays on the
+                                NUMA nodes */
+    bool pack_ratios = false;  /* pack the ratio averages instead of
+                                  processing scenes */
+    bool use_window = false; /* process only a window of the scene */
+    bool use_bbox = false;   /* process only a lat/long bounding box of the
+                                scene */
+    Window_t window;         /* window of the scene to be processed */
+    int quicklook;           /* reduction factor for a quick look */
+    bool checkpoint = false; /* checkpoint the aerosol inversion */
+    double bbox[NBBOX_COORDS];  /* lat/long bounding box of the scene to be
+                                   processed (degrees) */
 
     /* Read the command-line arguments */
     retval = get_args (argc, argv, &xml_infile, &aux_infile, &process_sr,
-        &write_toa, &verbose);
+        &write_toa, &prefetch_depth, &angle_decimation, &output_format,
+        &batch_infile, &spool_dir, &concurrency, &max_memory, &pack_ratios,
+        &use_window, &window, &use_bbox, bbox, &quicklook, &checkpoint, &numa,
+        &verbose);
     if (retval != SUCCESS)
     {   /* get_args already printed the error message */
         exit (ERROR);
     }
 
+    /* Pack the ratio averages for the aerosol inversion, which only needs to
+       be done once for each version of the ratio averages file */
+    if (pack_ratios)
+    {
+        retval = pack_sr_ratios ();
+        exit (retval);
+    }
+
+    /* Process all the scenes in the batch file, sharing the look-up tables
+       and auxiliary data between them */
+    if (batch_infile != NULL)
+    {
+        retval = run_batch (batch_infile, process_sr, write_toa,
+            prefetch_depth, angle_decimation, output_format, concurrency,
+            max_memory, numa, verbose);
+        free (batch_infile);
+        exit (retval);
+    }
+
+    /* Run as a worker, processing the jobs submitted to the spool directory
+       until told to stop */
+    if (spool_dir != NULL)
+    {
+        retval = run_spool_worker (spool_dir, process_sr, write_toa,
+            prefetch_depth, angle_decimation, output_format, concurrency,
+            numa, verbose);
+        free (spool_dir);
+        exit (retval);
+    }
+
     printf ("Starting TOA and surface reflectance processing ...\n");
 
     /* Provide user information if verbose is turned on */
@@ -128,6 +145,28 @@ int main (int argc, char *argv[])
         }
     }
 
+    /* Read the look-up tables and auxiliary data if processing surface
+       reflectance */
+    if (process_sr)
+    {
+        tables = load_sr_tables (1);
+        if (tables == NULL)
+        {
+            sprintf (errmsg, "Reading the look-up tables and auxiliary data");
+            error_handler (true, FUNC_NAME, errmsg);
+            exit (ERROR);
+        }
+
+        aux = get_aux_grid (tables, aux_infile);
+        if (aux == NULL)
+        {
+            sprintf (errmsg, "Reading the ozone and water vapor auxiliary "
+                "data");
+            error_handler (true, FUNC_NAME, errmsg);
+            exit (ERROR);
+        }
+    }
+
     /* Validate the input metadata file */
     if (validate_xml_file (xml_infile) != SUCCESS)
     {  /* Error messages already written */
@@ -145,17 +184,320 @@ int main (int argc, char *argv[])
         exit (ERROR);
     }
 
+    /* Find the window of the scene covering the bounding box */
+    if (use_bbox)
+    {
+        if (bbox_to_window (&xml_metadata, bbox, &window) != SUCCESS)
+        {
+            sprintf (errmsg, "Finding the window of the scene for the "
+                "bounding box");
+            error_handler (true, FUNC_NAME, errmsg);
+            exit (ERROR);
+        }
+        printf ("Bounding box covers lines %d-%d, samples %d-%d of the "
+            "scene\n", window.line0, window.line0 + window.nlines - 1,
+            window.samp0, window.samp0 + window.nsamps - 1);
+        use_window = true;
+    }
+
+    /* Spread the threads over the NUMA nodes before the scene arrays are
+       first touched */
+    if (numa)
+        pin_threads ();
+
+    /* Process the scene */
+    retval = process_scene (xml_infile, &xml_metadata, tables, aux,
+        process_sr, write_toa, prefetch_depth, angle_decimation,
+        output_format, max_memory, use_window ? &window : NULL, quicklook,
+        checkpoint, numa, verbose);
+    if (retval != SUCCESS)
+    {
+        sprintf (errmsg, "Processing the scene: %s", xml_infile);
+        error_handler (true, FUNC_NAME, errmsg);
+        exit (ERROR);
+    }
+
+    /* Free the metadata structure */
+    free_metadata (&xml_metadata);
+
+    /* Free the look-up tables and auxiliary data */
+    release_aux_grid (tables, aux);
+    free_sr_tables (tables);
+
+    /* Free the filename pointers */
+    free (xml_infile);
+    free (aux_infile);
+
+    /* Indicate successful completion of processing */
+    printf ("Surface reflectance processing complete!\n");
+    exit (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  list_output_bands
+
+PURPOSE:  Stops the write-behind engine and lists the first nlist bands it
+wrote in the XML file of the output products.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error writing the bands or the XML file
+SUCCESS         No errors encountered
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+NOTES:
+1. The output products of a window or quick look are listed in their own
+   XML file, which is written here with its global metadata and no bands
+   before the bands are appended.
+2. The bands are only listed if all of them were written (see
+   close_write_behind).
+******************************************************************************/
+static int list_output_bands
+(
+    Write_behind_t *writer,   /* I: write-behind engine to stop and free */
+    int nlist,                /* I: number of the first band writes queued
+                                    to list in the XML file */
+    Espa_internal_meta_t *win_metadata,  /* I: XML metadata for the output
+                                    products of a window or quick look; NULL
+                                    for those of the scene */
+    char *out_xml             /* I: XML filename listing the output
+                                    products */
+)
+{
+    char FUNC_NAME[] = "list_output_bands"; /* function name */
+    char errmsg[STR_SIZE];   /* error message */
+
+    if (win_metadata != NULL)
+    {
+        win_metadata->nbands = 0;
+        if (write_metadata (win_metadata, out_xml) != SUCCESS)
+        {
+            sprintf (errmsg, "Writing the XML file for the window or quick "
+                "look: %s", out_xml);
+            error_handler (true, FUNC_NAME, errmsg);
+            close_write_behind (writer, NULL, 0);
+            return (ERROR);
+        }
+    }
+
+    /* Append the bands to the XML file in a single update */
+    if (close_write_behind (writer, out_xml, nlist) != SUCCESS)
+    {
+        sprintf (errmsg, "Appending the output bands to the XML file.");
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  process_scene
+
+PURPOSE:  Computes the TOA and surface reflectance values for a single Landsat
+8 scene and writes the output products.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           An error occurred during processing of the surface reflectance
+SUCCESS         Processing was successful
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+NOTES:
+1. The look-up tables and auxiliary data are not modified, so they can be
+   shared by multiple scenes.  See sr_tables.c.
+2. Memory allocated for the scene is not freed when an error occurs.  The
+   caller is expected to exit, and in batch mode each scene is processed in
+   its own process.
+3. The per-scene arrays are allocated from a single arena, planned from the
+   scene size and options before anything is read (see scene_arena_size).
+   The arrays for each stage are released as soon as the stage is done.
+4. With numa, the large arrays are first touched by the threads which
+   process their lines as they are allocated, so they are placed on the
+   NUMA nodes of those threads.  The threads should already be pinned (see
+   pin_threads).  Only the line loops keep this locality; the loops over the
+   scheduling tiles don't (see numa.c).
+5. With a window, only the window padded with the margin needed by the
+   aerosol interpolation is read and corrected (see pad_window), and only
+   the window is written.  The output products are named for the window and
+   listed in their own XML file (see set_window_metadata), so the XML file
+   of the scene is not modified.
+6. With a quick look, the bands are reduced as they are read (see
+   set_input_quicklook) and every stage runs on the reduced grid, so no full
+   resolution band is held in memory.  The output products are named for the
+   reduction factor and listed in their own XML file, the same as a window,
+   and an RGB thumbnail is written with them.
+7. For an SR run of the whole scene, TOA bands 1-7 written by an earlier run
+   (e.g. with process_sr false) are mapped instead of recalibrated if they
+   are registered in the XML file and match their digest (see toa_reuse.c).
+   The TOA and RADSAT products of that run are then left as they are.
+8. With checkpoint, the aerosol inversion is saved as PRODUCT_ID_aero.ckpt
+   (named for the output products) and restored on a rerun of the same
+   inputs (see aero_ckpt.c).  The checkpoint is left in place.
+9. If the surface reflectance fails, the TOA and RADSAT bands already queued
+   are still written and listed in the XML file before the error is
+   returned, as they are when process_sr is false.
+******************************************************************************/
+int process_scene
+(
+    char *xml_infile,     /* I: input XML filename */
+    Espa_internal_meta_t *xml_metadata,
+                          /* I: XML metadata structure for xml_infile */
+    Sr_tables_t *tables,  /* I: static look-up tables and climate modeling
+                                grids; not used if !process_sr */
+    Aux_grid_t *aux,      /* I: ozone and water vapor grid for the scene
+                                date; not used if !process_sr */
+    bool process_sr,      /* I: process the surface reflectance products */
+    bool write_toa,       /* I: write intermediate TOA products flag */
+    int prefetch_depth,   /* I: number of input bands to read ahead of the
+                                band being calibrated */
+    int angle_decimation, /* I: number of lines/samples between the per-pixel
+                                angles held in memory; 1 is full
+                                resolution */
+    Myformat_t output_format,  /* I: file format for the output bands */
+    int max_memory,       /* I: memory budget (MB) for the scene; 0 is no
+                                limit */
+    Window_t *window,     /* I: window of the scene to be processed; NULL
+                                processes the whole scene */
+    int quicklook,        /* I: reduction factor for a quick look of the
+                                scene; 1 is full resolution */
+    bool checkpoint,      /* I: checkpoint the aerosol inversion, and restore
+                                it if the checkpoint matches the scene */
+    bool numa,            /* I: first touch the scene arrays from the threads
+                                which process them */
+    bool verbose          /* I: verbose flag for printing messages */
+)
+{
+    char FUNC_NAME[] = "process_scene"; /* function name */
+    char errmsg[STR_SIZE];   /* error message */
+    int retval;              /* return status */
+    int ib;                  /* looping variable for input bands */
+    Input_t *input = NULL;       /* input structure for the Landsat product */
+    Output_t *toa_output = NULL; /* output structure and metadata for the TOA
+                                    product */
+    Output_t *radsat_output = NULL; /* output structure and metadata for the
+                                       RADSAT product */
+    Write_behind_t *writer = NULL;  /* write-behind engine for the output
+                                       bands and XML metadata */
+    int ntoa_writes;         /* number of band writes queued for the TOA and
+                                RADSAT products */
+    Espa_global_meta_t *gmeta = NULL;   /* pointer to global meta */
+    Espa_internal_meta_t win_metadata;  /* XML metadata for the output
+                                           products of the window or quick
+                                           look */
+    Espa_internal_meta_t *out_metadata = xml_metadata;  /* XML metadata for
+                                           the output products */
+    Window_t read_window;    /* window of the scene read for the window */
+    char win_xml[STR_SIZE];  /* XML filename for the window or quick look
+                                products */
+    char *out_xml = xml_infile;  /* XML filename listing the output
+                                    products */
+    char ckpt_file[STR_SIZE];    /* aerosol checkpoint filename */
+    char toa_digest_file[STR_SIZE];  /* TOA digest filename */
+    bool toa_digest_set = false; /* was the TOA digest set up for the
+                                    scene? */
+    bool reuse_toa = false;      /* were the TOA bands of an earlier run
+                                    reused? */
+    Toa_digest_t toa_digest;     /* TOA digest for the scene */
+    Toa_map_t toa_map = {0};     /* TOA bands mapped from an earlier run */
+
+    Angle_band_t *sza = NULL;  /* per-pixel solar zenith angles, only held
+                                  for the TOA corrections */
+    Arena_t *arena = NULL;    /* arena for the per-scene arrays */
+    size_t toa_mark;          /* arena mark for the TOA arrays */
+    long mem_size;            /* memory needed for the scene (bytes) */
+    int16 **sband = NULL;     /* output surface reflectance and brightness
+                                 temp bands, qa band is separate as a uint16 */
+    uint16 *qaband = NULL;    /* QA band for the input image, nlines x nsamps */
+    uint16 *radsat = NULL;    /* QA band for radiometric saturation of the
+                                 Level-1 product, nlines x nsamps */
+
+    float xts;           /* scene center solar zenith angle (deg) */
+    float xmus;          /* cosine of solar zenith angle */
+    float pixsize;      /* pixel size for the reflectance bands */
+    int nlines, nsamps; /* number of lines and samples in the reflectance and
+                           thermal bands */
+
     /* Open the reflectance product, set up the input data structure, and
        allocate memory for the data buffers */
-    input = open_input (&xml_metadata, process_sr);
+    input = open_input (xml_metadata, process_sr);
     if (input == (Input_t *) NULL)
     {
         sprintf (errmsg, "Error opening/reading the input DN data: %s",
             xml_infile);
         error_handler (true, FUNC_NAME, errmsg);
-        exit (ERROR);
+        return (ERROR);
+    }
+    gmeta = &xml_metadata->global;
+
+    /* Limit the processing to the window, padded so the window is corrected
+       the same as in the full scene */
+    if (window != NULL)
+    {
+        if (window->line0 + window->nlines > input->scene_nlines ||
+            window->samp0 + window->nsamps > input->scene_nsamps)
+        {
+            sprintf (errmsg, "Window of lines %d-%d, samples %d-%d is not "
+                "within the %d x %d scene", window->line0,
+                window->line0 + window->nlines - 1, window->samp0,
+                window->samp0 + window->nsamps - 1, input->scene_nlines,
+                input->scene_nsamps);
+            error_handler (true, FUNC_NAME, errmsg);
+            return (ERROR);
+        }
+
+        pad_window (window, input->scene_nlines, input->scene_nsamps,
+            angle_decimation, &read_window);
+        if (set_input_window (input, &read_window, window) != SUCCESS ||
+            set_window_metadata (xml_metadata, window, &win_metadata)
+            != SUCCESS)
+        {
+            sprintf (errmsg, "Setting up the window of lines %d-%d, samples "
+                "%d-%d", window->line0, window->line0 + window->nlines - 1,
+                window->samp0, window->samp0 + window->nsamps - 1);
+            error_handler (true, FUNC_NAME, errmsg);
+            return (ERROR);
+        }
+        out_metadata = &win_metadata;
+        snprintf (win_xml, sizeof (win_xml), "%s.xml",
+            win_metadata.global.product_id);
+        out_xml = win_xml;
+        printf ("Processing lines %d-%d, samples %d-%d of the scene for the "
+            "window written to %s\n", read_window.line0,
+            read_window.line0 + read_window.nlines - 1, read_window.samp0,
+            read_window.samp0 + read_window.nsamps - 1, out_xml);
+    }
+
+    /* Reduce the scene for a quick look */
+    if (quicklook > 1)
+    {
+        if (set_input_quicklook (input, quicklook) != SUCCESS ||
+            set_quicklook_metadata (xml_metadata, input, &win_metadata)
+            != SUCCESS)
+        {
+            sprintf (errmsg, "Setting up the quick look reduced by %d",
+                quicklook);
+            error_handler (true, FUNC_NAME, errmsg);
+            return (ERROR);
+        }
+        out_metadata = &win_metadata;
+        snprintf (win_xml, sizeof (win_xml), "%s.xml",
+            win_metadata.global.product_id);
+        out_xml = win_xml;
+        printf ("Processing a %d x %d quick look of the %d x %d scene, "
+            "written to %s\n", input->size.nlines, input->size.nsamps,
+            input->full_nlines, input->full_nsamps, out_xml);
     }
-    gmeta = &xml_metadata.global;
 
     /* Output some information from the input files if verbose */
     if (verbose)
@@ -179,8 +521,8 @@ int main (int argc, char *argv[])
             input->size_qa.pixsize[1]);
 
         printf ("  Fill value: %d\n", input->meta.fill);
-        printf ("  Solar zenith: %f\n", xml_metadata.global.solar_zenith);
-        printf ("  Solar azimuth: %f\n", xml_metadata.global.solar_azimuth);
+        printf ("  Solar zenith: %f\n", xml_metadata->global.solar_zenith);
+        printf ("  Solar azimuth: %f\n", xml_metadata->global.solar_azimuth);
     }
 
     /* Pull the needed metadata from the XML file and input structure */
@@ -200,7 +542,7 @@ int main (int argc, char *argv[])
             "command-line argument to process. (oli-only cannot be corrected "
             "to surface reflectance)");
         error_handler (true, FUNC_NAME, errmsg);
-        exit (ERROR);
+        return (ERROR);
     }
 
     /* The surface reflectance algorithm cannot be implemented for solar
@@ -214,20 +556,41 @@ int main (int argc, char *argv[])
             "Use the --process_sr=false command-line argument. "
             "(solar zenith angle out of range)");
         error_handler (true, FUNC_NAME, errmsg);
-        exit (ERROR);
+        return (ERROR);
+    }
+
+    /* Plan the memory needed for the scene, and make sure it fits in the
+       memory budget before anything is read */
+    mem_size = scene_memory_size (nlines, nsamps, process_sr, prefetch_depth,
+        angle_decimation);
+    if (max_memory > 0 && mem_size > (long) max_memory * 1024 * 1024)
+    {
+        sprintf (errmsg, "The scene needs %.1f MB, which exceeds the memory "
+            "budget of %d MB", mem_size / (1024.0 * 1024.0), max_memory);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    arena = open_arena (scene_arena_size (nlines, nsamps, process_sr,
+        prefetch_depth, angle_decimation), numa ? nlines : 0);
+    if (arena == NULL)
+    {
+        sprintf (errmsg, "Error allocating the memory arena for the scene");
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
     }
 
     /* Allocate memory for all the data arrays */
     if (verbose)
         printf ("Allocating memory for the data arrays ...\n");
-    retval = memory_allocation_main (nlines, nsamps, &sza, &saa, &vza, &vaa,
-        &qaband, &radsat, &sband);
+    retval = memory_allocation_main (arena, nlines, nsamps, &qaband, &radsat,
+        &sband);
     if (retval != SUCCESS)
     {   /* get_args already printed the error message */
         sprintf (errmsg, "Error allocating memory for the data arrays from "
             "the main application.");
         error_handler (false, FUNC_NAME, errmsg);
-        exit (ERROR);
+        return (ERROR);
     }
 
     /* Read the QA band */
@@ -235,335 +598,268 @@ int main (int argc, char *argv[])
     {
         sprintf (errmsg, "Reading QA band");
         error_handler (true, FUNC_NAME, errmsg);
-        exit (ERROR);
+        return (ERROR);
     }
 
-    /* Read the scaled solar and view azimuth/zenith per pixel angle bands
-       which are in degrees */
-    if (get_input_ppa_lines (input, 0, nlines, sza, saa, vza, vaa) != SUCCESS)
+    /* The TOA digest is only kept for the TOA bands of the whole scene */
+    if (window == NULL && quicklook == 1)
     {
-        sprintf (errmsg, "Reading per-pixel solar and view angle bands");
-        error_handler (true, FUNC_NAME, errmsg);
-        exit (ERROR);
+        snprintf (toa_digest_file, sizeof (toa_digest_file), "%s"
+            TOA_DIGEST_EXTENSION, gmeta->product_id);
+        toa_digest_set = init_toa_digest (input, nlines, nsamps,
+            angle_decimation, &toa_digest) == SUCCESS;
     }
 
-    /* Get the L8 auxiliary directory and the full pathname of the auxiliary
-       files to be read if processing surface reflectance */
-    if (process_sr)
+    /* Reuse TOA bands 1-7 of an earlier run of the scene (e.g. a TOA-only
+       run) if they are registered in the XML file and match the digest.
+       They are mapped in place of the TOA corrections, and since the TOA
+       and RADSAT products of that run are already on disk and registered,
+       they aren't written again. */
+    if (process_sr && toa_digest_set)
     {
-        /* Get the path for the auxiliary products from the L8_AUX_DIR
-           environment variable.  If it isn't defined, then assume the products
-           are in the local directory. */
-        aux_path = getenv ("L8_AUX_DIR");
-        if (aux_path == NULL)
-        {
-            aux_path = ".";
-            sprintf (errmsg, "L8_AUX_DIR environment variable isn't defined. "
-                "It is assumed the auxiliary products will be available from "
-                "the local directory.");
-            error_handler (false, FUNC_NAME, errmsg);
-        }
-
-        /* Grab the year of the auxiliary input file to be used for the correct
-           location of the auxiliary file in the auxiliary directory */
-        strncpy (aux_year, &aux_infile[5], 4);
-        aux_year[4] = '\0';
-
-        /* Set up the look-up table files and make sure they exist */
-        sprintf (anglehdf, "%s/LDCMLUT/ANGLE_NEW.hdf", aux_path);
-        sprintf (intrefnm, "%s/LDCMLUT/RES_LUT_V3.0-URBANCLEAN-V2.0.hdf",
-            aux_path);
-        sprintf (transmnm, "%s/LDCMLUT/TRANS_LUT_V3.0-URBANCLEAN-V2.0.ASCII",
-            aux_path);
-        sprintf (spheranm, "%s/LDCMLUT/AERO_LUT_V3.0-URBANCLEAN-V2.0.ASCII",
-            aux_path);
-        sprintf (cmgdemnm, "%s/CMGDEM.hdf", aux_path);
-        sprintf (rationm, "%s/ratiomapndwiexp.hdf", aux_path);
-        sprintf (auxnm, "%s/LADS/%s/%s", aux_path, aux_year, aux_infile);
-
-        if (stat (anglehdf, &statbuf) == -1)
-        {
-            sprintf (errmsg, "Could not find anglehdf data file: %s\n  Check "
-                "L8_AUX_DIR environment variable.", anglehdf);
-            error_handler (false, FUNC_NAME, errmsg);
-            exit (ERROR);
-        }
-
-        if (stat (intrefnm, &statbuf) == -1)
-        {
-            sprintf (errmsg, "Could not find intrefnm data file: %s\n  Check "
-                "L8_AUX_DIR environment variable.", intrefnm);
-            error_handler (false, FUNC_NAME, errmsg);
-            exit (ERROR);
-        }
-
-        if (stat (transmnm, &statbuf) == -1)
-        {
-            sprintf (errmsg, "Could not find transmnm data file: %s\n  Check "
-                "L8_AUX_DIR environment variable.", transmnm);
-            error_handler (false, FUNC_NAME, errmsg);
-            exit (ERROR);
-        }
-
-        if (stat (spheranm, &statbuf) == -1)
-        {
-            sprintf (errmsg, "Could not find spheranm data file: %s\n  Check "
-                "L8_AUX_DIR environment variable.", spheranm);
-            error_handler (false, FUNC_NAME, errmsg);
-            exit (ERROR);
-        }
-
-        if (stat (cmgdemnm, &statbuf) == -1)
+        reuse_toa = map_toa_bands (xml_metadata, toa_digest_file,
+            &toa_digest, &toa_map);
+        if (reuse_toa)
         {
-            sprintf (errmsg, "Could not find cmgdemnm data file: %s\n  Check "
-                "L8_AUX_DIR environment variable.", cmgdemnm);
-            error_handler (false, FUNC_NAME, errmsg);
-            exit (ERROR);
+            printf ("Reusing the TOA reflectance bands registered in %s\n",
+                xml_infile);
+            for (ib = SR_BAND1; ib <= SR_BAND7; ib++)
+                sband[ib] = toa_map.band[ib];
         }
+    }
 
-        if (stat (rationm, &statbuf) == -1)
+    if (!reuse_toa)
+    {
+        /* Read the scaled per-pixel solar zenith angle band, which is in
+           degrees.  This is the only angle band used, and only by the TOA
+           corrections, so the solar azimuth and view angle bands are not
+           read. */
+        toa_mark = arena_mark (arena);
+        sza = read_angle_band (input, arena, PPA_SZA, angle_decimation);
+        if (sza == NULL)
         {
-            sprintf (errmsg, "Could not find rationm data file: %s\n  Check "
-                "L8_AUX_DIR environment variable.", rationm);
-            error_handler (false, FUNC_NAME, errmsg);
-            exit (ERROR);
+            sprintf (errmsg, "Reading per-pixel solar zenith angle band");
+            error_handler (true, FUNC_NAME, errmsg);
+            return (ERROR);
         }
 
-        if (stat (auxnm, &statbuf) == -1)
+        /* Compute the TOA reflectance and TOA brightness temp */
+        printf ("Calculating TOA reflectance and TOA brightness temps...");
+        retval = compute_toa_refl (input, xml_metadata, qaband, nlines,
+            nsamps, gmeta->instrument, sza, sband, radsat, prefetch_depth,
+            arena);
+        if (retval != SUCCESS)
         {
-            sprintf (errmsg, "Could not find auxnm data file: %s\n  Check "
-                "L8_AUX_DIR environment variable.", auxnm);
-            error_handler (false, FUNC_NAME, errmsg);
-            exit (ERROR);
+            sprintf (errmsg, "Error computing TOA reflectance and TOA "
+                "brightness temperatures.");
+            error_handler (true, FUNC_NAME, errmsg);
+            return (ERROR);
         }
+        if (numa)
+            report_numa_placement ("the scene arrays", arena->base,
+                arena->peak);
+        arena_release (arena, toa_mark);
+        sza = NULL;
     }
 
-    /* Compute the TOA reflectance and TOA brightness temp */
-    printf ("Calculating TOA reflectance and TOA brightness temps...");
-    retval = compute_toa_refl (input, &xml_metadata, qaband, nlines, nsamps,
-        gmeta->instrument, sza, sband, radsat);
-    if (retval != SUCCESS)
+    /* Start the write-behind engine.  The output bands and their ENVI
+       headers are written in the background while processing continues, and
+       the band metadata for all the output products is appended to the XML
+       file in a single update at the end. */
+    writer = open_write_behind (&out_metadata->global);
+    if (writer == NULL)
     {
-        sprintf (errmsg, "Error computing TOA reflectance and TOA brightness "
-            "temperatures.");
+        sprintf (errmsg, "Starting the write-behind output engine.");
         error_handler (true, FUNC_NAME, errmsg);
-        exit (ERROR);
-    }
-
-    /* Open the TOA output file, and set up the bands according to whether
-       the TOA reflectance bands will be written. */
-    toa_output = open_output (&xml_metadata, input, OUTPUT_TOA);
-    if (toa_output == NULL)
-    {   /* error message already printed */
-        error_handler (true, FUNC_NAME, errmsg);
-        exit (ERROR);
+        return (ERROR);
     }
-    printf ("Writing TOA reflectance corrected data to the output files ...\n");
 
-    /* If we are writing the TOA data, do so now for bands 1-7.  This will
-       occur if the user specified TOA to be written or if the surface
-       reflectance processing will not be completed. */
-    if (write_toa || !process_sr)
+    /* Write the TOA and RADSAT products, unless they were reused */
+    if (!reuse_toa)
     {
-        for (ib = SR_BAND1; ib <= SR_BAND7; ib++)
+        /* Open the TOA output file, and set up the bands according to whether
+           the TOA reflectance bands will be written. */
+        toa_output = open_output (out_metadata, input, OUTPUT_TOA,
+            output_format);
+        if (toa_output == NULL)
+        {   /* error message already printed */
+            error_handler (true, FUNC_NAME, errmsg);
+            return (ERROR);
+        }
+        printf ("Writing TOA reflectance corrected data to the output "
+            "files ...\n");
+
+        /* If we are writing the TOA data, do so now for bands 1-7.  This will
+           occur if the user specified TOA to be written or if the surface
+           reflectance processing will not be completed. */
+        if (write_toa || !process_sr)
         {
-            printf ("  Band %d: %s\n", ib+1,
-                toa_output->metadata.band[ib].file_name);
-            if (put_output_lines (toa_output, sband[ib], ib, 0, nlines,
-                sizeof (int16)) != SUCCESS)
+            for (ib = SR_BAND1; ib <= SR_BAND7; ib++)
             {
-                sprintf (errmsg, "Writing output TOA data for band %d", ib+1);
-                error_handler (true, FUNC_NAME, errmsg);
-                exit (ERROR);
+                printf ("  Band %d: %s\n", ib+1,
+                    toa_output->metadata.band[ib].file_name);
+                if (queue_band_write (writer, toa_output, sband[ib], ib,
+                    sizeof (int16)) != SUCCESS)
+                {
+                    sprintf (errmsg, "Writing output TOA data for band %d",
+                        ib+1);
+                    error_handler (true, FUNC_NAME, errmsg);
+                    return (ERROR);
+                }
             }
 
-            /* Create the ENVI header file this band */
-            if (create_envi_struct (&toa_output->metadata.band[ib],
-                &xml_metadata.global, &envi_hdr) != SUCCESS)
+            /* Write the digest of the TOA bands, so a later SR run of the
+               scene can reuse them.  The scene can still be processed
+               without it, so a failure is only a warning. */
+            if (toa_digest_set && output_format == FORMAT_RAW &&
+                write_toa_digest (toa_digest_file, &toa_digest, sband)
+                != SUCCESS)
             {
-                sprintf (errmsg, "Creating ENVI header structure.");
-                error_handler (true, FUNC_NAME, errmsg);
-                exit (ERROR);
+                sprintf (errmsg, "Unable to write the TOA digest; the TOA "
+                    "bands won't be reused by later runs");
+                error_handler (false, FUNC_NAME, errmsg);
             }
-      
-            /* Write the ENVI header */
-            strcpy (envi_file, toa_output->metadata.band[ib].file_name);
-            cptr = strchr (envi_file, '.');
-            strcpy (cptr, ".hdr");
-            if (write_envi_hdr (envi_file, &envi_hdr) != SUCCESS)
+        }
+
+        /* Write bands 9-11 (cirrus and thermals), which don't get any further
+           processing. */
+        for (ib = SR_BAND9; ib <= SR_BAND11; ib++)
+        {
+            /* If processing OLI-only, then bands 10 and 11 don't exist */
+            if (!strcmp (gmeta->instrument, "OLI") &&
+                (ib == SR_BAND10 || ib == SR_BAND11))
+                continue;
+        
+            printf ("  Band %d: %s\n", ib+2,
+                toa_output->metadata.band[ib].file_name);
+            if (queue_band_write (writer, toa_output, sband[ib], ib,
+                sizeof (int16)) != SUCCESS)
             {
-                sprintf (errmsg, "Writing ENVI header file.");
+                sprintf (errmsg, "Writing output TOA data for band %d", ib+2);
                 error_handler (true, FUNC_NAME, errmsg);
-                exit (ERROR);
+                return (ERROR);
             }
         }
 
-        /* Append the TOA reflectance bands, bands 1-7, to the XML file */
-        if (append_metadata (7, toa_output->metadata.band, xml_infile) !=
-            SUCCESS)
-        {
-            sprintf (errmsg, "Appending TOA reflectance bands to XML file.");
+        /* Open the RADSAT output file */
+        radsat_output = open_output (out_metadata, input, OUTPUT_RADSAT,
+            output_format);
+        if (radsat_output == NULL)
+        {   /* error message already printed */
             error_handler (true, FUNC_NAME, errmsg);
-            exit (ERROR);
+            return (ERROR);
         }
-    }
+        printf ("Writing RADSAT data to the output files ...\n");
 
-    /* Write bands 9-11 (cirrus and thermals), which don't get any further
-       processing. */
-    for (ib = SR_BAND9; ib <= SR_BAND11; ib++)
-    {
-        /* If processing OLI-only, then bands 10 and 11 don't exist */
-        if (!strcmp (gmeta->instrument, "OLI") &&
-            (ib == SR_BAND10 || ib == SR_BAND11))
-            continue;
-        
-        printf ("  Band %d: %s\n", ib+2,
-            toa_output->metadata.band[ib].file_name);
-        if (put_output_lines (toa_output, sband[ib], ib, 0, nlines,
-            sizeof (int16)) != SUCCESS)
+        /* Write the RADSAT band */
+        if (queue_band_write (writer, radsat_output, radsat, SR_RADSAT,
+            sizeof (uint16)) != SUCCESS)
         {
-            sprintf (errmsg, "Writing output TOA data for band %d", ib+2);
+            sprintf (errmsg, "Writing output RADSAT data");
             error_handler (true, FUNC_NAME, errmsg);
-            exit (ERROR);
+            return (ERROR);
         }
+    }
+    ntoa_writes = writer->njobs;
 
-        /* Create the ENVI header file this band */
-        if (create_envi_struct (&toa_output->metadata.band[ib],
-            &xml_metadata.global, &envi_hdr) != SUCCESS)
-        {
-            sprintf (errmsg, "Creating ENVI header structure.");
-            error_handler (true, FUNC_NAME, errmsg);
-            exit (ERROR);
-        }
-  
-        /* Write the ENVI header */
-        strcpy (envi_file, toa_output->metadata.band[ib].file_name);
-        cptr = strchr (envi_file, '.');
-        strcpy (cptr, ".hdr");
-        if (write_envi_hdr (envi_file, &envi_hdr) != SUCCESS)
+    /* Only continue with the surface reflectance corrections if SR processing
+       has been requested and is possible due to the solar zenith angle.  The
+       TOA and RADSAT bands continue to be written in the background while the
+       surface reflectance corrections are set up. */
+    if (process_sr)
+    {
+        /* Perform atmospheric correction for the reflectance bands and write
+           the data to the SR output file */
+        printf ("Performing atmospheric corrections for each reflectance "
+            "band ...\n");
+        if (checkpoint)
+            snprintf (ckpt_file, sizeof (ckpt_file), "%s" AERO_CKPT_EXTENSION,
+                out_metadata->global.product_id);
+        retval = compute_sr_refl (input, xml_metadata, out_metadata, writer,
+            output_format, qaband,
+            nlines, nsamps, pixsize, sband, xts, xmus, tables, aux,
+            checkpoint ? ckpt_file : NULL, arena);
+        if (retval != SUCCESS)
         {
-            sprintf (errmsg, "Writing ENVI header file.");
+            sprintf (errmsg, "Error computing surface reflectance");
             error_handler (true, FUNC_NAME, errmsg);
-            exit (ERROR);
-        }
 
-        /* Append the TOA cirrus/thermal band to the XML file */
-        if (append_metadata (1, &toa_output->metadata.band[ib], xml_infile) !=
-            SUCCESS)
-        {
-            sprintf (errmsg, "Appending TOA cirrus/thermal band to XML file.");
-            error_handler (true, FUNC_NAME, errmsg);
-            exit (ERROR);
+            /* The TOA and RADSAT products don't depend on the surface
+               reflectance, so keep the bands queued for them listed in the
+               XML file */
+            list_output_bands (writer, ntoa_writes, (window != NULL ||
+                quicklook > 1) ? &win_metadata : NULL, out_xml);
+            return (ERROR);
         }
-    }
+    }  /* end if process_sr */
 
-    /* Close the output TOA products, cleanup bands, and free the memory */
-    close_output (toa_output, OUTPUT_TOA);
-    if (process_sr && !write_toa)
+    /* Make sure the TOA and RADSAT bands have been written */
+    if (wait_band_writes (writer) != SUCCESS)
     {
-        /* Remove the TOA bands 1-7 that were created by the open routine,
-           since they aren't actually used */
-        for (ib = SR_BAND1; ib <= SR_BAND7; ib++)
-            unlink (toa_output->metadata.band[ib].file_name);
-    }
-    free_output (toa_output, OUTPUT_TOA);
-
-    /* Open the RADSAT output file */
-    radsat_output = open_output (&xml_metadata, input, OUTPUT_RADSAT);
-    if (radsat_output == NULL)
-    {   /* error message already printed */
+        sprintf (errmsg, "Writing the TOA and RADSAT output data");
         error_handler (true, FUNC_NAME, errmsg);
-        exit (ERROR);
+        return (ERROR);
     }
-    printf ("Writing RADSAT data to the output files ...\n");
 
-    /* Write the RADSAT band */
-    if (put_output_lines (radsat_output, radsat, 0, 0, nlines,
-        sizeof (uint16)) != SUCCESS)
+    /* Write the thumbnail of the quick look */
+    if (quicklook > 1)
     {
-        sprintf (errmsg, "Writing output RADSAT data");
-        error_handler (true, FUNC_NAME, errmsg);
-        exit (ERROR);
+        if (write_quicklook_thumbnail (win_metadata.global.product_id, sband,
+            nlines, nsamps) != SUCCESS)
+        {
+            sprintf (errmsg, "Writing the thumbnail of the quick look");
+            error_handler (true, FUNC_NAME, errmsg);
+            return (ERROR);
+        }
     }
 
-    /* Create the ENVI header file this band */
-    if (create_envi_struct (&radsat_output->metadata.band[SR_RADSAT],
-        &xml_metadata.global, &envi_hdr) != SUCCESS)
-    {
-        sprintf (errmsg, "Creating ENVI header structure.");
-        error_handler (true, FUNC_NAME, errmsg);
-        exit (ERROR);
-    }
-      
-    /* Write the ENVI header */
-    strcpy (envi_file, radsat_output->metadata.band[SR_RADSAT].file_name);
-    cptr = strchr (envi_file, '.');
-    strcpy (cptr, ".hdr");
-    if (write_envi_hdr (envi_file, &envi_hdr) != SUCCESS)
+    /* Done with the reused TOA bands */
+    unmap_toa_bands (&toa_map);
+
+    /* Close the output TOA and radsat products, cleanup bands, and free the
+       memory.  They aren't open if the TOA bands were reused. */
+    if (!reuse_toa)
     {
-        sprintf (errmsg, "Writing ENVI header file.");
-        error_handler (true, FUNC_NAME, errmsg);
-        exit (ERROR);
+        close_output (toa_output, OUTPUT_TOA);
+        if (process_sr && !write_toa)
+        {
+            /* Remove the TOA bands 1-7 that were created by the open routine,
+               since they aren't actually used.  Any TOA digest left from an
+               earlier run no longer applies. */
+            for (ib = SR_BAND1; ib <= SR_BAND7; ib++)
+                unlink (toa_output->metadata.band[ib].file_name);
+            if (toa_digest_set)
+                unlink (toa_digest_file);
+        }
+        free_output (toa_output, OUTPUT_TOA);
+
+        close_output (radsat_output, OUTPUT_RADSAT);
+        free_output (radsat_output, OUTPUT_RADSAT);
     }
 
-    /* Append the RADSAT band to the XML file */
-    if (append_metadata (1, &radsat_output->metadata.band[SR_RADSAT],
-        xml_infile) != SUCCESS)
+    /* List the TOA, RADSAT, and SR bands in the XML file, and stop the
+       write-behind engine.  The output products of a window or quick look
+       are listed in their own XML file. */
+    if (list_output_bands (writer, writer->njobs, (window != NULL ||
+        quicklook > 1) ? &win_metadata : NULL, out_xml) != SUCCESS)
     {
-        sprintf (errmsg, "Appending the RADSAT band to XML file.");
+        sprintf (errmsg, "Listing the output bands in the XML file.");
         error_handler (true, FUNC_NAME, errmsg);
-        exit (ERROR);
+        return (ERROR);
     }
-
-    /* Close the output radsat product, cleanup bands, and free the memory */
-    close_output (radsat_output, OUTPUT_RADSAT);
-    free_output (radsat_output, OUTPUT_RADSAT);
-    free (radsat);
-
-    /* Only continue with the surface reflectance corrections if SR processing
-       has been requested and is possible due to the solar zenith angle */
-    if (process_sr)
-    {
-        /* Perform atmospheric correction for the reflectance bands and write
-           the data to the SR output file */
-        printf ("Performing atmospheric corrections for each reflectance "
-            "band ...\n");
-        retval = compute_sr_refl (input, &xml_metadata, xml_infile, qaband,
-            nlines, nsamps, pixsize, sband, sza, saa, vza, vaa, xts, xmus,
-            anglehdf, intrefnm, transmnm, spheranm, cmgdemnm, rationm, auxnm);
-        if (retval != SUCCESS)
-        {
-            sprintf (errmsg, "Error computing surface reflectance");
-            error_handler (true, FUNC_NAME, errmsg);
-            exit (ERROR);
-        }
-    }  /* end if process_sr */
   
-    /* Free the metadata structure */
-    free_metadata (&xml_metadata);
-
     /* Close the input product */
     printf ("Closing input/output and freeing pointers ...\n");
     close_input (input);
     free_input (input);
 
-    /* Free the filename pointers */
-    free (xml_infile);
-    free (aux_infile);
-
     /* Free memory for band data */
-    free (sza);
-    free (saa);
-    free (vza);
-    free (vaa);
-    free (qaband);
-    for (i = 0; i < NBAND_TTL_OUT-1; i++)
-        free (sband[i]);
-    free (sband);
+    printf ("Scene memory: planned %.1f MB, peak %.1f MB\n",
+        arena->size / (1024.0 * 1024.0), arena->peak / (1024.0 * 1024.0));
+    close_arena (arena);
 
-    /* Indicate successful completion of processing */
-    printf ("Surface reflectance processing complete!\n");
-    exit (SUCCESS);
+    /* Successful completion */
+    return (SUCCESS);
 }
 
 
@@ -590,7 +886,23 @@ void usage ()
     printf ("usage: lasrc "
             "--xml=input_xml_filename "
             "--aux=input_auxiliary_filename "
-            "--process_sr=true:false --write_toa [--verbose] [--version]\n");
+            "--process_sr=true:false --write_toa [--prefetch_depth=N] "
+            "[--angle_decimation=N] [--output_format=raw:tiled] "
+            "[--max_memory=MB] [--window=line0,samp0,nlines,nsamps | "
+            "--bbox=west,south,east,north [--median_aerosol=value] | "
+            "--quicklook=N] [--checkpoint] "
+            "[--numa] [--verbose] [--version]\n");
+    printf ("   or: lasrc "
+            "--batch=input_batch_filename "
+            "--process_sr=true:false --write_toa [--concurrency=N] "
+            "[--max_memory=MB] [--prefetch_depth=N] [--angle_decimation=N] "
+            "[--output_format=raw:tiled] [--numa] [--verbose]\n");
+    printf ("   or: lasrc "
+            "--spool=spool_directory "
+            "--process_sr=true:false --write_toa [--concurrency=N] "
+            "[--prefetch_depth=N] [--angle_decimation=N] "
+            "[--output_format=raw:tiled] [--numa] [--verbose]\n");
+    printf ("   or: lasrc --pack_ratios\n");
 
     printf ("\nwhere the following parameters are required:\n");
     printf ("    -xml: name of the input XML file to be processed\n");
@@ -606,6 +918,83 @@ void usage ()
             "done.\n");
     printf ("    -write_toa: the intermediate TOA reflectance products "
             "for bands 1-7 are written to the output file\n");
+    printf ("    -prefetch_depth: number of input bands to read in the "
+            "background ahead of the band being calibrated (default is %d, "
+            "maximum is %d)\n", DEFAULT_PREFETCH_DEPTH, MAX_PREFETCH_DEPTH);
+    printf ("    -angle_decimation: hold only every Nth line and sample of "
+            "the per-pixel angle bands in memory and bilinearly interpolate "
+            "the angles in between.  1 holds the angles at full resolution "
+            "(default is 1, maximum is %d)\n", MAX_ANGLE_DECIMATION);
+    printf ("    -output_format: raw writes each band as raw binary with an "
+            "ENVI header (ESPA internal format).  tiled writes each band as "
+            "%dx%d tiles compressed with zlib deflate and a tile index, using "
+            "the .%s extension; no ENVI headers are written.  (default is "
+            "raw)\n", DEFAULT_TILE_SIZE, DEFAULT_TILE_SIZE, TILED_EXTENSION);
+    printf ("    -window: process and write only this window of the "
+            "scene, given as the first line, first sample, number of lines, "
+            "and number of samples in the reflectance bands.  Only the window "
+            "plus the margin needed by the aerosol interpolation is read and "
+            "corrected.  The output products are named for the window and "
+            "listed in their own XML file, PRODUCT_ID_wL_S_NxM.xml.  The "
+            "pixels match a full scene run, other than the cloud, shadow, "
+            "water, and failed aerosol retrieval pixels, which use the median "
+            "aerosol of the window unless -median_aerosol is given.  Not "
+            "supported with -batch or -spool.\n");
+    printf ("    -bbox: same as -window, for the window of the scene covering "
+            "this lat/long bounding box (degrees)\n");
+    printf ("    -median_aerosol: median aerosol value of the full scene, as "
+            "printed by a full scene run, to be used for the -window or "
+            "-bbox so all its pixels match the full scene run.  Without it "
+            "the median aerosol is found over the window, and the surface "
+            "reflectance bands are flagged as such in the window's XML "
+            "file.\n");
+    printf ("    -quicklook: process a preview of the scene reduced by this "
+            "factor in the lines and samples (up to %d).  The reflectance "
+            "bands are averaged over each NxN block as they are read and the "
+            "other bands are sampled at the block centers, so no full "
+            "resolution band is held in memory.  The output products are "
+            "listed in PRODUCT_ID_qlN.xml, along with an 8-bit RGB thumbnail "
+            "of bands 4, 3, and 2 (PRODUCT_ID_qlN_%s, with an ENVI header).  "
+            "Not supported with -window, -bbox, -batch, or -spool.\n",
+            MAX_QUICKLOOK, THUMB_EXTENSION);
+    printf ("    -checkpoint: save the aerosol inversion of the scene to "
+            "PRODUCT_ID%s after it's run, and skip the inversion on a rerun "
+            "whose inputs match the checkpoint.  The checkpoint is named for "
+            "the output products and is left in place.  Not supported with "
+            "-batch or -spool.  (default is false)\n", AERO_CKPT_EXTENSION);
+    printf ("    -batch: name of a file listing the scenes to be "
+            "processed, one per line, as the XML filename followed by the "
+            "auxiliary filename.  The look-up tables and auxiliary data are "
+            "read once and shared by all the scenes.  Replaces -xml and "
+            "-aux.\n");
+    printf ("    -spool: run as a worker which keeps the look-up tables and "
+            "auxiliary data in memory and processes the jobs submitted to "
+            "this directory as NAME.job files, writing a NAME.done "
+            "completion record for each.  Each job file lists xml=, aux=, "
+            "and optionally the other options as keyword=value lines.  The "
+            "worker stops on SIGINT, SIGTERM, or when a file named stop is "
+            "created in the directory.  Replaces -xml and -aux.\n");
+    printf ("    -concurrency: number of batch scenes or spool jobs to "
+            "process at the same time (default is 1)\n");
+    printf ("    -max_memory: memory budget in MB for the batch scenes being "
+            "processed at the same time, or for a single scene.  A single "
+            "scene whose planned memory exceeds the budget fails before any "
+            "data is read.  0 is no limit (default is 0)\n");
+    printf ("    -numa: on multi-socket machines, pin the OpenMP threads "
+            "spread over the NUMA nodes and first touch the large scene "
+            "arrays from the threads which process them, so each thread's "
+            "lines are held in its local memory.  This helps the loops over "
+            "the lines (TOA reflectance, auxiliary data, class plane) but "
+            "not the loops over the scheduling tiles.  The placement of the "
+            "scene arrays is reported.  The threads are only pinned when one "
+            "scene or job is processed at a time.  It gives no gain on "
+            "single-node machines.  (default is false)\n");
+    printf ("    -pack_ratios: pack the ratio averages in $L8_AUX_DIR into "
+            "the %s record file used by the aerosol inversion, then exit.  "
+            "This only needs to be run once for each version of the ratio "
+            "averages file.  Without the packed file, the ratio averages "
+            "are packed each time the look-up tables are read.\n",
+            RATIO_REC_FILE);
     printf ("    -verbose: should intermediate messages be printed? (default "
             "is false)\n");
     printf ("    -version: print the LaSRC version. When this parameter is "
@@ -629,6 +1018,27 @@ void usage ()
             "--aux=L8ANC2013181.hdf_fused --process_sr=false --verbose\n");
     printf ("   ==> Writes bands 1-11 as TOA reflectance and brightness "
             "temperature.  Surface reflectance corrections are not applied.\n");
+
+    printf ("\nExample: lasrc "
+            "--xml=LC08_L1TP_041027_20130630_20140312_01_T1.xml "
+            "--aux=L8ANC2013181.hdf_fused --window=3000,4000,1000,1000\n");
+    printf ("   ==> Writes the products for the 1000 x 1000 pixel window "
+            "starting at line 3000, sample 4000, as in the first example.\n");
+
+    printf ("\nExample: lasrc "
+            "--xml=LC08_L1TP_041027_20130630_20140312_01_T1.xml "
+            "--aux=L8ANC2013181.hdf_fused --quicklook=16\n");
+    printf ("   ==> Writes the products and an RGB thumbnail for a preview "
+            "of the scene at 1/16 resolution, as in the first example.\n");
+
+    printf ("\nExample: lasrc --batch=scenes.txt --concurrency=2 "
+            "--max_memory=16000\n");
+    printf ("   ==> Processes each scene listed in scenes.txt, two at a "
+            "time, as in the first example.\n");
+
+    printf ("\nExample: lasrc --spool=/var/spool/lasrc --concurrency=2\n");
+    printf ("   ==> Processes the jobs submitted to /var/spool/lasrc, two at "
+            "a time, until told to stop.\n");
 }
 
 
@@ -11,6 +11,17 @@
 #include "input.h"
 #include "output.h"
 #include "lut_subr.h"
+#include "band_io.h"
+#include "angle_band.h"
+#include "numa.h"
+#include "tile_sched.h"
+#include "sr_tables.h"
+#include "batch.h"
+#include "spool.h"
+#include "window.h"
+#include "quicklook.h"
+#include "aero_ckpt.h"
+#include "toa_reuse.h"
 #include "espa_metadata.h"
 #include "espa_geoloc.h"
 #include "parse_metadata.h"
@@ -33,9 +44,63 @@ int get_args
                                 water vapor and ozone */
     bool *process_sr,     /* O: process the surface reflectance products */
     bool *write_toa,      /* O: write intermediate TOA products flag */
+    int *prefetch_depth,  /* O: number of input bands to read ahead */
+    int *angle_decimation,  /* O: number of lines/samples between the
+                                  per-pixel angles held in memory */
+    Myformat_t *output_format,  /* O: file format for the output bands */
+    char **batch_infile,  /* O: address of input batch file listing the XML
+                                and auxiliary files for multiple scenes */
+    char **spool_dir,     /* O: address of spool directory for the worker
+                                to take jobs from */
+    int *concurrency,     /* O: number of batch scenes to process at once */
+    int *max_memory,      /* O: memory budget (MB) for the batch scenes
+                                being processed at once; 0 is no limit */
+    bool *pack_ratios,    /* O: pack the ratio averages instead of
+                                processing scenes */
+    bool *use_window,     /* O: process only the window of the scene */
+    Window_t *window,     /* O: window of the scene to be processed */
+    bool *use_bbox,       /* O: process only the bounding box of the
+                                scene */
+    double *bbox,         /* O: lat/long bounding box of the scene to be
+                                processed, NBBOX_COORDS values indexed by
+                                ESPA_WEST, etc. (degrees) */
+    int *quicklook,       /* O: reduction factor for a quick look of the
+                                scene; 1 is full resolution */
+    bool *checkpoint,     /* O: checkpoint the aerosol inversion flag */
+    bool *numa,           /* O: NUMA placement flag */
     bool *verbose         /* O: verbose flag */
 );
 
+int process_scene
+(
+    char *xml_infile,     /* I: input XML filename */
+    Espa_internal_meta_t *xml_metadata,
+                          /* I: XML metadata structure for xml_infile */
+    Sr_tables_t *tables,  /* I: static look-up tables and climate modeling
+                                grids; not used if !process_sr */
+    Aux_grid_t *aux,      /* I: ozone and water vapor grid for the scene
+                                date; not used if !process_sr */
+    bool process_sr,      /* I: process the surface reflectance products */
+    bool write_toa,       /* I: write intermediate TOA products flag */
+    int prefetch_depth,   /* I: number of input bands to read ahead of the
+                                band being calibrated */
+    int angle_decimation, /* I: number of lines/samples between the per-pixel
+                                angles held in memory; 1 is full
+                                resolution */
+    Myformat_t output_format,  /* I: file format for the output bands */
+    int max_memory,       /* I: memory budget (MB) for the scene; 0 is no
+                                limit */
+    Window_t *window,     /* I: window of the scene to be processed; NULL
+                                processes the whole scene */
+    int quicklook,        /* I: reduction factor for a quick look of the
+                                scene; 1 is full resolution */
+    bool checkpoint,      /* I: checkpoint the aerosol inversion, and restore
+                                it if the checkpoint matches the scene */
+    bool numa,            /* I: first touch the scene arrays from the threads
+                                which process them */
+    bool verbose          /* I: verbose flag for printing messages */
+);
+
 void usage ();
 
 bool btest
@@ -53,13 +118,16 @@ int compute_toa_refl
     int nlines,         /* I: number of lines in reflectance, thermal bands */
     int nsamps,         /* I: number of samps in reflectance, thermal bands */
     char *instrument,   /* I: instrument to be processed (OLI, TIRS) */
-    int16 *sza,         /* I: scaled per-pixel solar zenith angles (degrees),
-                              nlines x nsamps */
+    Angle_band_t *sza,  /* I: scaled per-pixel solar zenith angles (degrees),
+                              full resolution or decimated */
     int16 **sband,      /* O: output TOA reflectance and brightness temp
                               values (scaled) */
-    uint16 *radsat      /* O: radiometric saturation QA band, nlines x nsamps;
+    uint16 *radsat,     /* O: radiometric saturation QA band, nlines x nsamps;
                               array should be all zeros on input to this
                               routine*/
+    int prefetch_depth, /* I: number of input bands to read ahead of the
+                              band being calibrated */
+    Arena_t *arena      /* I/O: arena for the scene */
 );
 
 int compute_sr_refl
@@ -67,25 +135,26 @@ int compute_sr_refl
     Input_t *input,     /* I: input structure for the Landsat product */
     Espa_internal_meta_t *xml_metadata,
                         /* I: XML metadata structure */
-    char *xml_infile,   /* I: input XML filename */
+    Espa_internal_meta_t *out_metadata,
+                        /* I: XML metadata structure for the output
+                              products; differs from xml_metadata when only
+                              a window of the scene is output */
+    Write_behind_t *writer,  /* I: write-behind engine for the output
+                              bands */
+    Myformat_t output_format,  /* I: file format for the SR output bands */
     uint16 *qaband,     /* I: QA band for the input image, nlines x nsamps */
     int nlines,         /* I: number of lines in reflectance, thermal bands */
     int nsamps,         /* I: number of samps in reflectance, thermal bands */
     float pixsize,      /* I: pixel size for the reflectance bands */
     int16 **sband,      /* I/O: input TOA and output surface reflectance */
-    int16 *sza,         /* I: per-pixel solar zenith angles, nlines x nsamps */
-    int16 *saa,         /* I: per-pixel solar azimuth angles, nlines x nsamps */
-    int16 *vza,         /* I: per-pixel view zenith angles, nlines x nsamps */
-    int16 *vaa,         /* I: per-pixel view azimuth angles, nlines x nsamps */
     float xts,          /* I: solar zenith angle (deg) */
     float xmus,         /* I: cosine of solar zenith angle */
-    char *anglehdf,     /* I: angle HDF filename */
-    char *intrefnm,     /* I: intrinsic reflectance filename */
-    char *transmnm,     /* I: transmission filename */
-    char *spheranm,     /* I: spherical albedo filename */
-    char *cmgdemnm,     /* I: climate modeling grid DEM filename */
-    char *rationm,      /* I: ratio averages filename */
-    char *auxnm         /* I: auxiliary filename for ozone and water vapor */
+    Sr_tables_t *tables,  /* I: static look-up tables and climate modeling
+                                grids */
+    Aux_grid_t *aux,    /* I: ozone and water vapor grid for the scene date */
+    char *ckpt_file,    /* I: aerosol checkpoint file for the scene; NULL
+                              if the aerosol inversion isn't checkpointed */
+    Arena_t *arena      /* I/O: arena for the scene */
 );
 
 int init_sr_refl
@@ -94,13 +163,9 @@ int init_sr_refl
     int nsamps,         /* I: number of samps in reflectance, thermal bands */
     Input_t *input,     /* I: input structure for the Landsat product */
     Geoloc_t *space,    /* I: structure for geolocation information */
-    char *anglehdf,     /* I: angle HDF filename */
-    char *intrefnm,     /* I: intrinsic reflectance filename */
-    char *transmnm,     /* I: transmission filename */
-    char *spheranm,     /* I: spherical albedo filename */
-    char *cmgdemnm,     /* I: climate modeling grid DEM filename */
-    char *rationm,      /* I: ratio averages filename */
-    char *auxnm,        /* I: auxiliary filename for ozone and water vapor */
+    int16 *dem,         /* I: CMG DEM data array [DEM_NBLAT x DEM_NBLON] */
+    uint16 *wv,         /* I: water vapor values [CMG_NBLAT x CMG_NBLON] */
+    uint8 *oz,          /* I: ozone values [CMG_NBLAT x CMG_NBLON] */
     float *eps,         /* O: angstrom coefficient */
     int *iaots,         /* O: index for AOTs */
     float *xtv,         /* O: observation zenith angle (deg) */
@@ -113,45 +178,17 @@ int init_sr_refl
     float *uoz,         /* O: total column ozone */
     float *uwv,         /* O: total column water vapor (precipital water
                               vapor) */
-    float *xtsstep,     /* O: solar zenith step value */
-    float *xtsmin,      /* O: minimum solar zenith value */
     float *xtvstep,     /* O: observation step value */
-    float *xtvmin,      /* O: minimum observation value */
-    float *tsmax,       /* O: maximum scattering angle table
-                              [NVIEW_ZEN_VALS x NSOLAR_ZEN_VALS] */
-    float *tsmin,       /* O: minimum scattering angle table
-                              [NVIEW_ZEN_VALS x NSOLAR_ZEN_VALS] */
-    float tts[22],      /* O: sun angle table */
-    float *ttv,         /* O: view angle table
-                              [NVIEW_ZEN_VALS x NSOLAR_ZEN_VALS] */
-    int32 indts[22],    /* O: index for the sun angle table */
-    float *rolutt,      /* O: intrinsic reflectance table
-                          [NSR_BANDS x NPRES_VALS x NAOT_VALS x NSOLAR_VALS] */
-    float *transt,      /* O: transmission table
-                      [NSR_BANDS x NPRES_VALS x NAOT_VALS x NSUN_ANGLE_VALS] */
-    float *sphalbt,     /* O: spherical albedo table
-                              [NSR_BANDS x NPRES_VALS x NAOT_VALS] */
-    float *normext,     /* O: aerosol extinction coefficient at the current
-                              wavelength (normalized at 550nm)
-                              [NSR_BANDS x NPRES_VALS x NAOT_VALS] */
-    float *nbfic,       /* O: communitive number of azimuth angles
-                              [NVIEW_ZEN_VALS x NSOLAR_ZEN_VALS] */
-    float *nbfi,        /* O: number of azimuth angles
-                              [NVIEW_ZEN_VALS x NSOLAR_ZEN_VALS] */
-    int16 *dem,         /* O: CMG DEM data array [DEM_NBLAT x DEM_NBLON] */
-    int16 *andwi,       /* O: avg NDWI [RATIO_NBLAT x RATIO_NBLON] */
-    int16 *sndwi,       /* O: standard NDWI [RATIO_NBLAT x RATIO_NBLON] */
-    int16 *ratiob1,     /* O: mean band1 ratio [RATIO_NBLAT x RATIO_NBLON] */
-    int16 *ratiob2,     /* O: mean band2 ratio [RATIO_NBLAT x RATIO_NBLON] */
-    int16 *ratiob7,     /* O: mean band7 ratio [RATIO_NBLAT x RATIO_NBLON] */
-    int16 *intratiob1,  /* O: integer band1 ratio [RATIO_NBLAT x RATIO_NBLON] */
-    int16 *intratiob2,  /* O: integer band2 ratio [RATIO_NBLAT x RATIO_NBLON] */
-    int16 *intratiob7,  /* O: integer band7 ratio [RATIO_NBLAT x RATIO_NBLON] */
-    int16 *slpratiob1,  /* O: slope band1 ratio [RATIO_NBLAT x RATIO_NBLON] */
-    int16 *slpratiob2,  /* O: slope band2 ratio [RATIO_NBLAT x RATIO_NBLON] */
-    int16 *slpratiob7,  /* O: slope band7 ratio [RATIO_NBLAT x RATIO_NBLON] */
-    uint16 *wv,         /* O: water vapor values [CMG_NBLAT x CMG_NBLON] */
-    uint8 *oz           /* O: ozone values [CMG_NBLAT x CMG_NBLON] */
+    float *xtvmin       /* O: minimum observation value */
+);
+
+int load_scene_aux
+(
+    int nlines,         /* I: number of lines in reflectance, thermal bands */
+    int nsamps,         /* I: number of samps in reflectance, thermal bands */
+    Geoloc_t *space,    /* I: structure for geolocation information */
+    Aux_grid_t *aux     /* I/O: ozone and water vapor grid for the scene
+                                date */
 );
 
 bool is_cloud
@@ -175,39 +212,36 @@ bool is_water
     int16 band5_pix      /* I: Band 5 reflectance for current pixel */
 );
 
-bool find_closest_non_fill
+void compute_pixel_class
 (
     uint16 *qaband,    /* I: QA band for the input image, nlines x nsamps */
+    int16 **sband,     /* I: input TOA reflectance */
     int nlines,        /* I: number of lines in QA band */
     int nsamps,        /* I: number of samps in QA band */
-    int center_line,   /* I: line for the center of the aerosol window */
-    int center_samp,   /* I: sample for the center of the aerosol window */
-    int *nearest_line, /* O: line for nearest non-fill pix in aerosol window */
-    int *nearest_samp  /* O: samp for nearest non-fill pix in aerosol window */
+    uint8 *pclass      /* O: class plane, nlines x nsamps */
 );
 
-bool find_closest_non_cloud_shadow_water
+void summarize_aero_windows
 (
-    uint16 *qaband,    /* I: QA band for the input image, nlines x nsamps */
-    int16 **sband,     /* I: input surface reflectance, nlines x nsamps */
-    int nlines,        /* I: number of lines in QA band */
-    int nsamps,        /* I: number of samps in QA band */
-    int center_line,   /* I: line for the center of the aerosol window */
-    int center_samp,   /* I: sample for the center of the aerosol window */
-    int *nearest_line, /* O: line for nearest non-cloud pix in aerosol window */
-    int *nearest_samp  /* O: samp for nearest non-cloud pix in aerosol window */
+    uint8 *pclass,     /* I: class plane, nlines x nsamps */
+    int nlines,        /* I: number of lines in the class plane */
+    int nsamps,        /* I: number of samps in the class plane */
+    int nwin_lines,    /* I: number of aerosol window lines */
+    int nwin_samps,    /* I: number of aerosol window samps */
+    uint8 *awin        /* O: aerosol window summary,
+                             nwin_lines x nwin_samps */
 );
 
-bool find_closest_non_water
+bool find_closest_pixel_class
 (
-    uint16 *qaband,    /* I: QA band for the input image, nlines x nsamps */
-    int16 **sband,     /* I: input surface reflectance */
-    int nlines,        /* I: number of lines in QA band */
-    int nsamps,        /* I: number of samps in QA band */
+    uint8 *pclass,     /* I: class plane, nlines x nsamps */
+    int nlines,        /* I: number of lines in the class plane */
+    int nsamps,        /* I: number of samps in the class plane */
     int center_line,   /* I: line for the center of the aerosol window */
     int center_samp,   /* I: sample for the center of the aerosol window */
-    int *nearest_line, /* O: line for nearest non-cloud pix in aerosol window */
-    int *nearest_samp  /* O: samp for nearest non-cloud pix in aerosol window */
+    uint8 reject,      /* I: class bits which rule out a pixel */
+    int *nearest_line, /* O: line for nearest pix in aerosol window */
+    int *nearest_samp  /* O: samp for nearest pix in aerosol window */
 );
 
 void mask_aero_window
@@ -12,9 +12,77 @@ LICENSE TYPE:  NASA Open Source Agreement Version 1.3
 NOTES:
 *****************************************************************************/
 #include "lut_subr.h"
+#include "rayleigh.h"
 #include "hdf.h"
 #include "mfhdf.h"
 
+/******************************************************************************
+MODULE:  angstrom_factor
+
+PURPOSE:  Computes the spectral dependency of the AOT for the band, given the
+angstroem coefficient.  The modified AOT for the band is
+(raot550nm / normext[iband][0][3]) * angstrom_factor.
+
+RETURN VALUE:
+Type = double
+Value          Description
+-----          -----------
+factor         (lambda / 0.55) ^ -eps for the band
+
+NOTES:
+  1. Only valid for bands 1-7 (DN_BAND1 - DN_BAND7).
+  2. This is the pow call made by atmcorlamb2_new.  Routines which correct
+     the same band many times with the same eps can compute it once and use
+     atmcorlamb2_aot.
+******************************************************************************/
+double angstrom_factor
+(
+    int iband,                /* I: band index (0-based) */
+    float eps                 /* I: angstroem coefficient; spectral dependency
+                                    of the AOT */
+)
+{
+    float lambda[] = {0.443, 0.480, 0.585, 0.655, 0.865, 1.61, 2.2};
+
+    return (pow ((lambda[iband] / 0.55), -eps));
+}
+
+
+/******************************************************************************
+MODULE:  angstrom_factors
+
+PURPOSE:  Computes the angstrom_factor of bands 1-7 for each of the NAERO_EPS
+angstroem coefficients retrieved by subaeroret_eps.
+
+RETURN VALUE:
+Type = N/A
+
+NOTES:
+  1. The coefficients are the same for every aerosol window, so this is
+     called once before the aerosol inversion rather than for every window.
+     The factor is not set for an eps < 0, which turns it off.
+******************************************************************************/
+void angstrom_factors
+(
+    float eps[NAERO_EPS],     /* I: angstroem coefficients */
+    double aot_fact[NSR_BANDS][NAERO_EPS]  /* O: angstrom factor for each of
+                                    bands 1-7 and eps */
+)
+{
+    int ib;                   /* band index */
+    int ie;                   /* eps index */
+
+    for (ib = DN_BAND1; ib <= DN_BAND7; ib++)
+    {
+        for (ie = 0; ie < NAERO_EPS; ie++)
+        {
+            if (eps[ie] >= 0.0)
+                aot_fact[ib][ie] = angstrom_factor (ib, eps[ie]);
+        }
+    }
+}
+
+
 /******************************************************************************
 MODULE:  atmcorlamb2_new
 
@@ -45,12 +113,6 @@ void atmcorlamb2_new
 )
 {
     float mraot550nm;      /* nearest value of AOT -- modified local variable */
-    float mraot550nm_sq;   /* mraot550nm squared */
-    float mraot550nm_cube; /* mraot550nm cubed */
-    float lambda[] = {0.443, 0.480, 0.585, 0.655, 0.865, 1.61, 2.2};
-    float roatm;           /* intrinsic atmospheric reflectance */
-    float ttatmg;          /* total atmospheric transmission */
-    float satm;            /* spherical albedo */
 
     /* Modifiy the AOT value based on the angstroem coefficient and lambda
        values */
@@ -61,43 +123,14 @@ void atmcorlamb2_new
         if (iband <= DN_BAND7)
         {
             mraot550nm = (raot550nm / normext_ib_0_3) *
-                (pow ((lambda[iband] / 0.55), -eps));
+                angstrom_factor (iband, eps);
         }
         else
             mraot550nm = raot550nm;
     }
 
-    /* Check the upper limit of the modified AOT value */
-    if (mraot550nm >= roatm_upper)
-        mraot550nm = roatm_upper;
-
-    /* Store the square and cube of the modified AOT value for multiple use */
-    mraot550nm_sq = mraot550nm * mraot550nm;
-    mraot550nm_cube = mraot550nm * mraot550nm *mraot550nm;
-
-    /* Compute the intrinsic atmospheric reflectance from the coefficients */
-    roatm = roatm_coef[3] +
-            roatm_coef[2] * mraot550nm +
-            roatm_coef[1] * mraot550nm_sq +
-            roatm_coef[0] * mraot550nm_cube;
-
-    /* Compute the total atmospheric transmission from the coefficients */
-    ttatmg = ttatmg_coef[3] +
-             ttatmg_coef[2] * mraot550nm +
-             ttatmg_coef[1] * mraot550nm_sq +
-             ttatmg_coef[0] * mraot550nm_cube;
-
-    /* Compute the spherical albedo from the coefficients */
-    satm = satm_coef[3] +
-           satm_coef[2] * mraot550nm +
-           satm_coef[1] * mraot550nm_sq +
-           satm_coef[0] * mraot550nm_cube;
-
-    /* Perform atmospheric correction */
-    *roslamb = (double) rotoa / tgo;
-    *roslamb = *roslamb - roatm;
-    *roslamb = *roslamb / ttatmg;
-    *roslamb = *roslamb / (1.0 + satm * (*roslamb));
+    atmcorlamb2_aot (tgo, roatm_upper, roatm_coef, ttatmg_coef, satm_coef,
+        mraot550nm, rotoa, roslamb);
 }
 
 
@@ -318,14 +351,10 @@ RETURN VALUE:
 Type = None
 
 NOTES:
- 1. Here's how the xfd value was originally calculated. Given that these
-    are static values, the xfd itself can really be static.
-    xdep = 0.0279  // depolarization factor
-    xfd = xdep / (2.0 - xdep)
-        = 0.014147355
-    xfd = (1.0 - xfd) / (1.0 + 2.0 * xfd)
-        = .985852645 / 1.02829471
-        = .958725777
+ 1. This is chand_batch (rayleigh.c) for a single point.  rayleigh.c is a
+    copy of the LEDAPS port of the 6S chand routine (6sV-1.0B CHAND.f), which
+    is checked against the Fortran by 'make check' in lndsr.  'make check'
+    here fails if the copy differs from the LEDAPS one.
 ******************************************************************************/
 void local_chand
 (
@@ -337,78 +366,7 @@ void local_chand
     float *xrray   /* O: molecular reflectance, 0.0 to 1.0 */
 )
 {
-    int i;                             /* looping variable */
-    float pl[10];
-    float fs0, fs1, fs2;
-    float phios;
-    float xcosf2, xcosf3;
-    float xph1, xph2, xph3;
-    float xitm;
-    float xp1, xp2, xp3;
-    float cfonc1, cfonc2, cfonc3;
-    float xlntau;                      /* log molecular optical depth */
-    float xitot1, xitot2, xitot3;
-    float xmus2, xmuv2;                /* square of xmus and xmuv */
-
-    /* constant vars */
-    const float xfd = 0.958725777;
-    const float as0[10] = {
-         0.33243832, -6.777104e-02, 0.16285370, 1.577425e-03,
-        -0.30924818, -1.240906e-02, -0.10324388, 3.241678e-02, 0.11493334,
-        -3.503695e-02};
-    const float as1[2] = {0.19666292, -5.439061e-02};
-    const float as2[2] = {0.14545937, -2.910845e-02};
-
-    phios = (180.0 - xphi) * DEG2RAD;
-    xcosf2 = cos (phios);
-    xcosf3 = cos (2.0 * phios);
-
-    /* xmus and xmuv squared is used frequently */
-    xmus2 = xmus * xmus;
-    xmuv2 = xmuv * xmuv;
-
-    xph1 = 1.0 + (3.0 * xmus2 - 1.0) * (3.0 * xmuv2 - 1.0) * xfd * 0.125;
-    xph2 = -xmus * xmuv * sqrt(1.0 - xmus2) * sqrt(1.0 - xmuv2);
-    xph2 = xph2 * xfd * 0.5 * 1.5;
-    xph3 = (1.0 - xmus2) * (1.0 - xmuv2);
-    xph3 = xph3 * xfd * 0.5 * 0.375;
-
-    xitm = (1.0 - exp(-xtau * (1.0 / xmus + 1.0 / xmuv))) *
-        xmus / (4.0 * (xmus + xmuv));
-    xp1 = xph1 * xitm;
-    xp2 = xph2 * xitm;
-    xp3 = xph3 * xitm;
-
-    xitm = (1.0 - exp(-xtau / xmus)) * (1.0 - exp(-xtau / xmuv));
-    cfonc1 = xph1 * xitm;
-    cfonc2 = xph2 * xitm;
-    cfonc3 = xph3 * xitm;
-
-    xlntau = log (xtau);
-    pl[0] = 1.0;
-    pl[1] = xlntau;
-    pl[2] = xmus + xmuv;
-    pl[3] = xlntau * pl[2];
-    pl[4] = xmus * xmuv;
-    pl[5] = xlntau * pl[4];
-    pl[6] = xmus2 + xmuv2;
-    pl[7] = xlntau * pl[6];
-    pl[8] = xmus2 * xmuv2;
-    pl[9] = xlntau * pl[8];
-
-    fs0 = 0.0;
-    for (i = 0; i < 10; i++)
-        fs0 += pl[i] * as0[i];
-    fs1 = pl[0] * as1[0] + pl[1] * as1[1];
-    fs2 = pl[0] * as2[0] + pl[1] * as2[1];
-    xitot1 = xp1 + cfonc1 * fs0 * xmus;
-    xitot2 = xp2 + cfonc2 * fs1 * xmus;
-    xitot3 = xp3 + cfonc3 * fs2 * xmus;
-
-    *xrray = xitot1;
-    *xrray += xitot2 * xcosf2 * 2.0;
-    *xrray += xitot3 * xcosf3 * 2.0;
-    *xrray /= xmus;
+    chand_batch (1, &xphi, &xmuv, &xmus, &xtau, xrray);
 }
 
 
@@ -1999,6 +1957,36 @@ int readluts
 }
 
 
+/******************************************************************************
+MODULE:  memory_size_main
+
+PURPOSE:  Returns the number of bytes of the arena used by the arrays
+allocated with memory_allocation_main.
+
+RETURN VALUE:
+Type = size_t
+Value          Description
+-----          -----------
+n              Number of bytes used by the arrays
+
+NOTES:
+  1. This is used to plan the size of the arena for the scene, so it needs to
+     match memory_allocation_main exactly.
+******************************************************************************/
+size_t memory_size_main
+(
+    int nlines,          /* I: number of lines in the scene */
+    int nsamps           /* I: number of samples in the scene */
+)
+{
+    size_t npix = (size_t) nlines * nsamps;   /* number of pixels */
+
+    return (2 * arena_block_size (npix * sizeof (uint16)) +
+        arena_block_size ((NBAND_TTL_OUT-1) * sizeof (int16*)) +
+        (NBAND_TTL_OUT-1) * arena_block_size (npix * sizeof (int16)));
+}
+
+
 /******************************************************************************
 MODULE:  memory_allocation_main
 
@@ -2013,19 +2001,18 @@ ERROR          Error occurred allocating memory
 SUCCESS        Successful completion
 
 NOTES:
-  1. Memory is allocated for each of the input variables, so it is up to the
-     calling routine to free this memory.
+  1. Memory is allocated from the arena for the scene, and is freed when the
+     arena is closed.  The arena needs to be planned with memory_size_main.
   2. Each array passed into this function is passed in as the address to that
      1D, 2D, nD array.
+  3. The per-pixel angle bands are not allocated here.  Each stage reads only
+     the angle bands it uses via read_angle_band.
 ******************************************************************************/
 int memory_allocation_main
 (
+    Arena_t *arena,      /* I/O: arena for the scene */
     int nlines,          /* I: number of lines in the scene */
     int nsamps,          /* I: number of samples in the scene */
-    int16 **sza,         /* O: solar zenith angle, nlines x nsamps  */
-    int16 **saa,         /* O: solar azimuth angle table, nlines x nsamps */
-    int16 **vza,         /* O: view zenith angle, nlines x nsamps  */
-    int16 **vaa,         /* O: view azimuth angle table, nlines x nsamps */
     uint16 **qaband,     /* O: QA band for the input image, nlines x nsamps */
     uint16 **radsat,     /* O: radiometric saturation band for the input image,
                                nlines x nsamps */
@@ -2036,40 +2023,9 @@ int memory_allocation_main
     char FUNC_NAME[] = "memory_allocation_main"; /* function name */
     char errmsg[STR_SIZE];   /* error message */
     int i;                   /* looping variables */
+    size_t npix = (size_t) nlines * nsamps;   /* number of pixels */
 
-    *sza = calloc (nlines*nsamps, sizeof (int16));
-    if (*sza == NULL)
-    {
-        sprintf (errmsg, "Error allocating memory for sza");
-        error_handler (true, FUNC_NAME, errmsg);
-        return (ERROR);
-    }
-
-    *saa = calloc (nlines*nsamps, sizeof (int16));
-    if (*saa == NULL)
-    {
-        sprintf (errmsg, "Error allocating memory for saa");
-        error_handler (true, FUNC_NAME, errmsg);
-        return (ERROR);
-    }
-
-    *vza = calloc (nlines*nsamps, sizeof (int16));
-    if (*vza == NULL)
-    {
-        sprintf (errmsg, "Error allocating memory for vza");
-        error_handler (true, FUNC_NAME, errmsg);
-        return (ERROR);
-    }
-
-    *vaa = calloc (nlines*nsamps, sizeof (int16));
-    if (*vaa == NULL)
-    {
-        sprintf (errmsg, "Error allocating memory for vaa");
-        error_handler (true, FUNC_NAME, errmsg);
-        return (ERROR);
-    }
-
-    *qaband = calloc (nlines*nsamps, sizeof (uint16));
+    *qaband = arena_alloc (arena, npix * sizeof (uint16));
     if (*qaband == NULL)
     {
         sprintf (errmsg, "Error allocating memory for qaband");
@@ -2077,7 +2033,7 @@ int memory_allocation_main
         return (ERROR);
     }
 
-    *radsat = calloc (nlines*nsamps, sizeof (uint16));
+    *radsat = arena_alloc (arena, npix * sizeof (uint16));
     if (*radsat == NULL)
     {
         sprintf (errmsg, "Error allocating memory for radsat");
@@ -2087,7 +2043,7 @@ int memory_allocation_main
 
     /* Given that the QA band is its own separate array of uint16s, we need
        one less band for the signed image data */
-    *sband = calloc (NBAND_TTL_OUT-1, sizeof (int16*));
+    *sband = arena_alloc (arena, (NBAND_TTL_OUT-1) * sizeof (int16*));
     if (*sband == NULL)
     {
         sprintf (errmsg, "Error allocating memory for sband");
@@ -2096,7 +2052,7 @@ int memory_allocation_main
     }
     for (i = 0; i < NBAND_TTL_OUT-1; i++)
     {
-        (*sband)[i] = calloc (nlines*nsamps, sizeof (int16));
+        (*sband)[i] = arena_alloc (arena, npix * sizeof (int16));
         if ((*sband)[i] == NULL)
         {
             sprintf (errmsg, "Error allocating memory for sband");
@@ -2110,11 +2066,53 @@ int memory_allocation_main
 }
 
 
+/******************************************************************************
+MODULE:  memory_size_sr
+
+PURPOSE:  Returns the number of bytes of the arena used by the arrays
+allocated with memory_allocation_sr and memory_allocation_aero.
+
+RETURN VALUE:
+Type = size_t
+Value          Description
+-----          -----------
+n              Number of bytes used by the arrays
+
+NOTES:
+  1. This is used to plan the size of the arena for the scene, so it needs to
+     match memory_allocation_sr and memory_allocation_aero exactly.
+******************************************************************************/
+size_t memory_size_sr
+(
+    int nlines,          /* I: number of lines in the scene */
+    int nsamps           /* I: number of samples in the scene */
+)
+{
+    size_t npix = (size_t) nlines * nsamps;   /* number of pixels */
+    size_t nbytes;       /* number of bytes used */
+
+    /* memory_allocation_sr */
+    nbytes = arena_block_size (npix * sizeof (uint8)) +
+        2 * arena_block_size (npix * sizeof (float));
+#ifdef INTERP_AUX
+    nbytes += 3 * arena_block_size (npix * sizeof (float));
+#endif
+
+    /* memory_allocation_aero */
+    nbytes += 5 * arena_block_size (npix * sizeof (int16)) +
+        arena_block_size (npix * sizeof (uint8)) +
+        arena_block_size ((size_t) AERO_NWINDOWS (nlines) *
+        AERO_NWINDOWS (nsamps) * sizeof (uint8));
+
+    return (nbytes);
+}
+
+
 /******************************************************************************
 MODULE:  memory_allocation_sr
 
-PURPOSE:  Allocates memory for all the various arrays needed specifically for
-the L8 surface reflectance corrections.
+PURPOSE:  Allocates memory for the arrays needed throughout the L8 surface
+reflectance corrections.
 
 RETURN VALUE:
 Type = int
@@ -2124,25 +2122,19 @@ ERROR          Error occurred allocating memory
 SUCCESS        Successful completion
 
 NOTES:
-  1. Memory is allocated for each of the input variables, so it is up to the
-     calling routine to free this memory.
+  1. Memory is allocated from the arena for the scene, and is freed when the
+     arena is released back to a mark taken before calling this routine.
   2. Each array passed into this function is passed in as the address to that
      1D, 2D, nD array.
+  3. The interpolated water vapor, ozone, and pressure arrays are only used,
+     and only allocated, if INTERP_AUX is defined.  Otherwise they are
+     returned as NULL.
 ******************************************************************************/
 int memory_allocation_sr
 (
+    Arena_t *arena,      /* I/O: arena for the scene */
     int nlines,          /* I: number of lines in the scene */
     int nsamps,          /* I: number of samples in the scene */
-    int16 **aerob1,      /* O: atmospherically corrected band 1 data
-                               (TOA refl), nlines x nsamps */
-    int16 **aerob2,      /* O: atmospherically corrected band 2 data
-                               (TOA refl), nlines x nsamps */
-    int16 **aerob4,      /* O: atmospherically corrected band 4 data
-                               (TOA refl), nlines x nsamps */
-    int16 **aerob5,      /* O: atmospherically corrected band 5 data
-                               (TOA refl), nlines x nsamps */
-    int16 **aerob7,      /* O: atmospherically corrected band 7 data
-                               (TOA refl), nlines x nsamps */
     uint8 **ipflag,      /* O: QA flag to assist with aerosol interpolation,
                                nlines x nsamps */
     float **twvi,        /* O: interpolated water vapor value,
@@ -2150,87 +2142,40 @@ int memory_allocation_sr
     float **tozi,        /* O: interpolated ozone value, nlines x nsamps */
     float **tp,          /* O: interpolated pressure value, nlines x nsamps */
     float **taero,       /* O: aerosol values for each pixel, nlines x nsamps */
-    float **teps,        /* O: eps (angstrom coefficient) for each pixel,
+    float **teps         /* O: eps (angstrom coefficient) for each pixel,
                                nlines x nsamps*/
-    int16 **dem,         /* O: CMG DEM data array [DEM_NBLAT x DEM_NBLON] */
-    int16 **andwi,       /* O: avg NDWI [RATIO_NBLAT x RATIO_NBLON] */
-    int16 **sndwi,       /* O: standard NDWI [RATIO_NBLAT x RATIO_NBLON] */
-    int16 **ratiob1,     /* O: mean band1 ratio [RATIO_NBLAT x RATIO_NBLON] */
-    int16 **ratiob2,     /* O: mean band2 ratio [RATIO_NBLAT x RATIO_NBLON] */
-    int16 **ratiob7,     /* O: mean band7 ratio [RATIO_NBLAT x RATIO_NBLON] */
-    int16 **intratiob1,  /* O: band1 ratio [RATIO_NBLAT x RATIO_NBLON] */
-    int16 **intratiob2,  /* O: band2 ratio [RATIO_NBLAT x RATIO_NBLON] */
-    int16 **intratiob7,  /* O: band7 ratio [RATIO_NBLAT x RATIO_NBLON] */
-    int16 **slpratiob1,  /* O: slope band1 ratio [RATIO_NBLAT x RATIO_NBLON] */
-    int16 **slpratiob2,  /* O: slope band2 ratio [RATIO_NBLAT x RATIO_NBLON] */
-    int16 **slpratiob7,  /* O: slope band7 ratio [RATIO_NBLAT x RATIO_NBLON] */
-    uint16 **wv,         /* O: water vapor values [CMG_NBLAT x CMG_NBLON] */
-    uint8 **oz,          /* O: ozone values [CMG_NBLAT x CMG_NBLON] */
-    float **rolutt,      /* O: intrinsic reflectance table
-                         [NSR_BANDS x NPRES_VALS x NAOT_VALS x NSOLAR_VALS] */
-    float **transt,      /* O: transmission table
-                        [NSR_BANDS x NPRES_VALS x NAOT_VALS x NSUNANGLE_VALS] */
-    float **sphalbt,     /* O: spherical albedo table
-                               [NSR_BANDS x NPRES_VALS x NAOT_VALS] */
-    float **normext,     /* O: aerosol extinction coefficient at the current
-                               wavelength (normalized at 550nm) 
-                               [NSR_BANDS x NPRES_VALS x NAOT_VALS] */
-    float **tsmax,       /* O: maximum scattering angle table
-                               [NVIEW_ZEN_VALS x NSOLAR_ZEN_VALS] */
-    float **tsmin,       /* O: minimum scattering angle table
-                               [NVIEW_ZEN_VALS x NSOLAR_ZEN_VALS] */
-    float **nbfic,       /* O: communitive number of azimuth angles
-                               [NVIEW_ZEN_VALS x NSOLAR_ZEN_VALS] */
-    float **nbfi,        /* O: number of azimuth angles
-                               [NVIEW_ZEN_VALS x NSOLAR_ZEN_VALS] */
-    float **ttv          /* O: view angle table
-                               [NVIEW_ZEN_VALS x NSOLAR_ZEN_VALS] */
 )
 {
     char FUNC_NAME[] = "memory_allocation_sr"; /* function name */
     char errmsg[STR_SIZE];   /* error message */
+    size_t npix = (size_t) nlines * nsamps;   /* number of pixels */
 
-    *aerob1 = calloc (nlines*nsamps, sizeof (int16));
-    if (*aerob1 == NULL)
-    {
-        sprintf (errmsg, "Error allocating memory for aerob1");
-        error_handler (true, FUNC_NAME, errmsg);
-        return (ERROR);
-    }
-
-    *aerob2 = calloc (nlines*nsamps, sizeof (int16));
-    if (*aerob2 == NULL)
-    {
-        sprintf (errmsg, "Error allocating memory for aerob2");
-        error_handler (true, FUNC_NAME, errmsg);
-        return (ERROR);
-    }
-
-    *aerob4 = calloc (nlines*nsamps, sizeof (int16));
-    if (*aerob4 == NULL)
+    *ipflag = arena_alloc (arena, npix * sizeof (uint8));
+    if (*ipflag == NULL)
     {
-        sprintf (errmsg, "Error allocating memory for aerob4");
+        sprintf (errmsg, "Error allocating memory for ipflag");
         error_handler (true, FUNC_NAME, errmsg);
         return (ERROR);
     }
 
-    *aerob5 = calloc (nlines*nsamps, sizeof (int16));
-    if (*aerob5 == NULL)
+    *taero = arena_alloc (arena, npix * sizeof (float));
+    if (*taero == NULL)
     {
-        sprintf (errmsg, "Error allocating memory for aerob5");
+        sprintf (errmsg, "Error allocating memory for taero");
         error_handler (true, FUNC_NAME, errmsg);
         return (ERROR);
     }
 
-    *aerob7 = calloc (nlines*nsamps, sizeof (int16));
-    if (*aerob7 == NULL)
+    *teps = arena_alloc (arena, npix * sizeof (float));
+    if (*teps == NULL)
     {
-        sprintf (errmsg, "Error allocating memory for aerob7");
+        sprintf (errmsg, "Error allocating memory for teps");
         error_handler (true, FUNC_NAME, errmsg);
         return (ERROR);
     }
 
-    *twvi = calloc (nlines*nsamps, sizeof (float));
+#ifdef INTERP_AUX
+    *twvi = arena_alloc (arena, npix * sizeof (float));
     if (*twvi == NULL)
     {
         sprintf (errmsg, "Error allocating memory for twvi");
@@ -2238,7 +2183,7 @@ int memory_allocation_sr
         return (ERROR);
     }
 
-    *tozi = calloc (nlines*nsamps, sizeof (float));
+    *tozi = arena_alloc (arena, npix * sizeof (float));
     if (*tozi == NULL)
     {
         sprintf (errmsg, "Error allocating memory for tozi");
@@ -2246,154 +2191,191 @@ int memory_allocation_sr
         return (ERROR);
     }
 
-    *tp = calloc (nlines*nsamps, sizeof (float));
+    *tp = arena_alloc (arena, npix * sizeof (float));
     if (*tp == NULL)
     {
         sprintf (errmsg, "Error allocating memory for tp");
         error_handler (true, FUNC_NAME, errmsg);
         return (ERROR);
     }
+#else
+    *twvi = NULL;
+    *tozi = NULL;
+    *tp = NULL;
+#endif
 
-    *taero = calloc (nlines*nsamps, sizeof (float));
-    if (*taero == NULL)
-    {
-        sprintf (errmsg, "Error allocating memory for taero");
-        error_handler (true, FUNC_NAME, errmsg);
-        return (ERROR);
-    }
+    /* Successful completion */
+    return (SUCCESS);
+}
 
-    *teps = calloc (nlines*nsamps, sizeof (float));
-    if (*teps == NULL)
-    {
-        sprintf (errmsg, "Error allocating memory for teps");
-        error_handler (true, FUNC_NAME, errmsg);
-        return (ERROR);
-    }
 
-    *ipflag = calloc (nlines*nsamps, sizeof (uint8));
-    if (*ipflag == NULL)
-    {
-        sprintf (errmsg, "Error allocating memory for ipflag");
-        error_handler (true, FUNC_NAME, errmsg);
-        return (ERROR);
-    }
+/******************************************************************************
+MODULE:  memory_allocation_aero
 
-    /* Allocate memory for all the climate modeling grid files */
-    *dem = calloc (DEM_NBLAT * DEM_NBLON, sizeof (int16*));
-    if (*dem == NULL)
-    {
-        sprintf (errmsg, "Error allocating memory for the DEM");
-        error_handler (true, FUNC_NAME, errmsg);
-        return (ERROR);
-    }
+PURPOSE:  Allocates memory for the arrays only needed for the aerosol
+inversion of the L8 surface reflectance corrections.
 
-    *andwi = calloc (RATIO_NBLAT * RATIO_NBLON, sizeof (int16));
-    if (*andwi == NULL)
-    {
-        sprintf (errmsg, "Error allocating memory for the andwi");
-        error_handler (true, FUNC_NAME, errmsg);
-        return (ERROR);
-    }
+RETURN VALUE:
+Type = int
+Value          Description
+-----          -----------
+ERROR          Error occurred allocating memory
+SUCCESS        Successful completion
 
-    *sndwi = calloc (RATIO_NBLAT * RATIO_NBLON, sizeof (int16));
-    if (*sndwi == NULL)
-    {
-        sprintf (errmsg, "Error allocating memory for the sndwi");
-        error_handler (true, FUNC_NAME, errmsg);
-        return (ERROR);
-    }
+NOTES:
+  1. Memory is allocated from the arena for the scene.  These arrays are
+     allocated after those from memory_allocation_sr, so they can be released
+     as soon as the aerosol inversion is done by releasing the arena back to
+     a mark taken before calling this routine.
+  2. Each array passed into this function is passed in as the address to that
+     1D, 2D, nD array.
+******************************************************************************/
+int memory_allocation_aero
+(
+    Arena_t *arena,      /* I/O: arena for the scene */
+    int nlines,          /* I: number of lines in the scene */
+    int nsamps,          /* I: number of samples in the scene */
+    int16 **aerob1,      /* O: atmospherically corrected band 1 data
+                               (TOA refl), nlines x nsamps */
+    int16 **aerob2,      /* O: atmospherically corrected band 2 data
+                               (TOA refl), nlines x nsamps */
+    int16 **aerob4,      /* O: atmospherically corrected band 4 data
+                               (TOA refl), nlines x nsamps */
+    int16 **aerob5,      /* O: atmospherically corrected band 5 data
+                               (TOA refl), nlines x nsamps */
+    int16 **aerob7,      /* O: atmospherically corrected band 7 data
+                               (TOA refl), nlines x nsamps */
+    uint8 **pclass,      /* O: class plane for selecting the aerosol window
+                               pixel, nlines x nsamps */
+    uint8 **awin         /* O: aerosol window summary,
+                               AERO_NWINDOWS(nlines) x AERO_NWINDOWS(nsamps) */
+)
+{
+    char FUNC_NAME[] = "memory_allocation_aero"; /* function name */
+    char errmsg[STR_SIZE];   /* error message */
+    size_t npix = (size_t) nlines * nsamps;   /* number of pixels */
 
-    *ratiob1 = calloc (RATIO_NBLAT * RATIO_NBLON, sizeof (int16));
-    if (*ratiob1 == NULL)
+    *aerob1 = arena_alloc (arena, npix * sizeof (int16));
+    if (*aerob1 == NULL)
     {
-        sprintf (errmsg, "Error allocating memory for the ratiob1");
+        sprintf (errmsg, "Error allocating memory for aerob1");
         error_handler (true, FUNC_NAME, errmsg);
         return (ERROR);
     }
 
-    *ratiob2 = calloc (RATIO_NBLAT * RATIO_NBLON, sizeof (int16));
-    if (*ratiob2 == NULL)
+    *aerob2 = arena_alloc (arena, npix * sizeof (int16));
+    if (*aerob2 == NULL)
     {
-        sprintf (errmsg, "Error allocating memory for the ratiob2");
+        sprintf (errmsg, "Error allocating memory for aerob2");
         error_handler (true, FUNC_NAME, errmsg);
         return (ERROR);
     }
 
-    *ratiob7 = calloc (RATIO_NBLAT * RATIO_NBLON, sizeof (int16));
-    if (*ratiob7 == NULL)
+    *aerob4 = arena_alloc (arena, npix * sizeof (int16));
+    if (*aerob4 == NULL)
     {
-        sprintf (errmsg, "Error allocating memory for the ratiob7");
+        sprintf (errmsg, "Error allocating memory for aerob4");
         error_handler (true, FUNC_NAME, errmsg);
         return (ERROR);
     }
 
-    *intratiob1 = calloc (RATIO_NBLAT * RATIO_NBLON, sizeof (int16));
-    if (*intratiob1 == NULL)
+    *aerob5 = arena_alloc (arena, npix * sizeof (int16));
+    if (*aerob5 == NULL)
     {
-        sprintf (errmsg, "Error allocating memory for the intratiob1");
+        sprintf (errmsg, "Error allocating memory for aerob5");
         error_handler (true, FUNC_NAME, errmsg);
         return (ERROR);
     }
 
-    *intratiob2 = calloc (RATIO_NBLAT * RATIO_NBLON, sizeof (int16));
-    if (*intratiob2 == NULL)
+    *aerob7 = arena_alloc (arena, npix * sizeof (int16));
+    if (*aerob7 == NULL)
     {
-        sprintf (errmsg, "Error allocating memory for the intratiob2");
+        sprintf (errmsg, "Error allocating memory for aerob7");
         error_handler (true, FUNC_NAME, errmsg);
         return (ERROR);
     }
 
-    *intratiob7 = calloc (RATIO_NBLAT * RATIO_NBLON, sizeof (int16));
-    if (*intratiob7 == NULL)
+    *pclass = arena_alloc (arena, npix * sizeof (uint8));
+    if (*pclass == NULL)
     {
-        sprintf (errmsg, "Error allocating memory for the intratiob7");
+        sprintf (errmsg, "Error allocating memory for pclass");
         error_handler (true, FUNC_NAME, errmsg);
         return (ERROR);
     }
 
-    *slpratiob1 = calloc (RATIO_NBLAT * RATIO_NBLON, sizeof (int16));
-    if (*slpratiob1 == NULL)
+    *awin = arena_alloc (arena, (size_t) AERO_NWINDOWS (nlines) *
+        AERO_NWINDOWS (nsamps) * sizeof (uint8));
+    if (*awin == NULL)
     {
-        sprintf (errmsg, "Error allocating memory for the slpratiob1");
+        sprintf (errmsg, "Error allocating memory for awin");
         error_handler (true, FUNC_NAME, errmsg);
         return (ERROR);
     }
 
-    *slpratiob2 = calloc (RATIO_NBLAT * RATIO_NBLON, sizeof (int16));
-    if (*slpratiob2 == NULL)
-    {
-        sprintf (errmsg, "Error allocating memory for the slpratiob2");
-        error_handler (true, FUNC_NAME, errmsg);
-        return (ERROR);
-    }
+    /* Successful completion */
+    return (SUCCESS);
+}
 
-    *slpratiob7 = calloc (RATIO_NBLAT * RATIO_NBLON, sizeof (int16));
-    if (*slpratiob7 == NULL)
-    {
-        sprintf (errmsg, "Error allocating memory for the slpratiob7");
-        error_handler (true, FUNC_NAME, errmsg);
-        return (ERROR);
-    }
 
-    *wv = calloc (CMG_NBLAT * CMG_NBLON, sizeof (int16));
-    if (*wv == NULL)
-    {
-        sprintf (errmsg, "Error allocating memory for the wv");
-        error_handler (true, FUNC_NAME, errmsg);
-        return (ERROR);
-    }
+/******************************************************************************
+MODULE:  memory_allocation_tables
 
-    *oz = calloc (CMG_NBLAT * CMG_NBLON, sizeof (uint8));
-    if (*oz == NULL)
-    {
-        sprintf (errmsg, "Error allocating memory for the oz");
-        error_handler (true, FUNC_NAME, errmsg);
-        return (ERROR);
-    }
+PURPOSE:  Allocates memory for the static look-up tables and climate modeling
+grid arrays needed for the L8 surface reflectance corrections.  These arrays
+do not depend on the scene, so they can be shared by multiple scenes.
 
-    /* rolutt, transt, sphalbt, and normext */
-    *rolutt = calloc (NSR_BANDS*NPRES_VALS*NAOT_VALS*NSOLAR_VALS,
-        sizeof (float));
+RETURN VALUE:
+Type = int
+Value          Description
+-----          -----------
+ERROR          Error occurred allocating memory
+SUCCESS        Successful completion
+
+NOTES:
+  1. Memory is allocated for each of the input variables, so it is up to the
+     calling routine to free this memory.
+  2. Each array passed into this function is passed in as the address to that
+     1D, 2D, nD array.
+******************************************************************************/
+int memory_allocation_tables
+(
+    int16 **dem,         /* O: CMG DEM data array [DEM_NBLAT x DEM_NBLON] */
+    float **rolutt,      /* O: intrinsic reflectance table
+                         [NSR_BANDS x NPRES_VALS x NAOT_VALS x NSOLAR_VALS] */
+    float **transt,      /* O: transmission table
+                        [NSR_BANDS x NPRES_VALS x NAOT_VALS x NSUNANGLE_VALS] */
+    float **sphalbt,     /* O: spherical albedo table
+                               [NSR_BANDS x NPRES_VALS x NAOT_VALS] */
+    float **normext,     /* O: aerosol extinction coefficient at the current
+                               wavelength (normalized at 550nm) 
+                               [NSR_BANDS x NPRES_VALS x NAOT_VALS] */
+    float **tsmax,       /* O: maximum scattering angle table
+                               [NVIEW_ZEN_VALS x NSOLAR_ZEN_VALS] */
+    float **tsmin,       /* O: minimum scattering angle table
+                               [NVIEW_ZEN_VALS x NSOLAR_ZEN_VALS] */
+    float **nbfic,       /* O: communitive number of azimuth angles
+                               [NVIEW_ZEN_VALS x NSOLAR_ZEN_VALS] */
+    float **nbfi,        /* O: number of azimuth angles
+                               [NVIEW_ZEN_VALS x NSOLAR_ZEN_VALS] */
+    float **ttv          /* O: view angle table
+                               [NVIEW_ZEN_VALS x NSOLAR_ZEN_VALS] */
+)
+{
+    char FUNC_NAME[] = "memory_allocation_tables"; /* function name */
+    char errmsg[STR_SIZE];   /* error message */
+
+    /* Allocate memory for all the climate modeling grid files */
+    *dem = calloc (DEM_NBLAT * DEM_NBLON, sizeof (int16));
+    if (*dem == NULL)
+    {
+        sprintf (errmsg, "Error allocating memory for the DEM");
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    /* rolutt, transt, sphalbt, and normext */
+    *rolutt = calloc (NSR_BANDS*NPRES_VALS*NAOT_VALS*NSOLAR_VALS,
+        sizeof (float));
     if (*rolutt == NULL)
     {
         sprintf (errmsg, "Error allocating memory for rolutt");
@@ -2473,27 +2455,24 @@ int memory_allocation_sr
 
 
 /******************************************************************************
-MODULE:  read_auxiliary_files
+MODULE:  read_ratio_file
 
-PURPOSE:  Reads the auxiliary files required for this application.
+PURPOSE:  Reads the band ratio averages from the ratio averages file.
 
 RETURN VALUE:
 Type = int
 Value          Description
 -----          -----------
-ERROR          Error occurred reading one of the auxiliary files
+ERROR          Error occurred reading the ratio averages file
 SUCCESS        Successful completion
 
 NOTES:
   1. It is assumed that memory has already been allocated for the input data
      arrays.
 ******************************************************************************/
-int read_auxiliary_files
+static int read_ratio_file
 (
-    char *cmgdemnm,     /* I: climate modeling grid DEM filename */
     char *rationm,      /* I: ratio averages filename */
-    char *auxnm,        /* I: auxiliary filename for ozone and water vapor */
-    int16 *dem,         /* O: CMG DEM data array [DEM_NBLAT x DEM_NBLON] */
     int16 *andwi,       /* O: avg NDWI [RATIO_NBLAT x RATIO_NBLON] */
     int16 *sndwi,       /* O: standard NDWI [RATIO_NBLAT x RATIO_NBLON] */
     int16 *ratiob1,     /* O: mean band1 ratio [RATIO_NBLAT x RATIO_NBLON] */
@@ -2504,12 +2483,10 @@ int read_auxiliary_files
     int16 *intratiob7,  /* O: band7 ratio [RATIO_NBLAT x RATIO_NBLON] */
     int16 *slpratiob1,  /* O: slope band1 ratio [RATIO_NBLAT x RATIO_NBLON] */
     int16 *slpratiob2,  /* O: slope band2 ratio [RATIO_NBLAT x RATIO_NBLON] */
-    int16 *slpratiob7,  /* O: slope band7 ratio [RATIO_NBLAT x RATIO_NBLON] */
-    uint16 *wv,         /* O: water vapor values [CMG_NBLAT x CMG_NBLON] */
-    uint8 *oz           /* O: ozone values [CMG_NBLAT x CMG_NBLON] */
+    int16 *slpratiob7   /* O: slope band7 ratio [RATIO_NBLAT x RATIO_NBLON] */
 )
 {
-    char FUNC_NAME[] = "read_auxiliary_files"; /* function name */
+    char FUNC_NAME[] = "read_ratio_file"; /* function name */
     char errmsg[STR_SIZE];   /* error message */
     char sds_name[STR_SIZE]; /* name of the SDS being read */
     int i;               /* looping variable */
@@ -2522,69 +2499,6 @@ int read_auxiliary_files
     int sds_id;          /* ID for the current SDS */
     int sds_index;       /* index for the current SDS */
 
-    /* Read the DEM */
-    sd_id = SDstart (cmgdemnm, DFACC_RDONLY);
-    if (sd_id < 0)
-    {
-        sprintf (errmsg, "Unable to open %s for reading as SDS", cmgdemnm);
-        error_handler (true, FUNC_NAME, errmsg);
-        return (ERROR);
-    }
-
-    /* Find the SDS name */
-    strcpy (sds_name, "averaged elevation");
-    sds_index = SDnametoindex (sd_id, sds_name);
-    if (sds_index == -1)
-    {
-        sprintf (errmsg, "Unable to find %s in the DEM file %s", sds_name,
-            cmgdemnm);
-        error_handler (true, FUNC_NAME, errmsg);
-        return (ERROR);
-    }
-
-    /* Open the current band as an SDS */
-    sds_id = SDselect (sd_id, sds_index);
-    if (sds_id < 0)
-    {
-        sprintf (errmsg, "Unable to access %s for reading", sds_name);
-        error_handler (true, FUNC_NAME, errmsg);
-        return (ERROR);
-    }
-
-    /* Read the data one line at a time */
-    for (i = 0; i < DEM_NBLAT; i++)
-    {
-        start[0] = i;  /* line */
-        start[1] = 0;  /* sample */
-        edges[0] = 1;
-        edges[1] = DEM_NBLON;
-        status = SDreaddata (sds_id, start, NULL, edges, &dem[i * DEM_NBLON]);
-        if (status == -1)
-        {
-            sprintf (errmsg, "Reading data from the SDS: %s", sds_name);
-            error_handler (true, FUNC_NAME, errmsg);
-            return (ERROR);
-        }
-    }
-
-    /* Close the SDS */
-    status = SDendaccess (sds_id);
-    if (status < 0)
-    {
-        sprintf (errmsg, "Ending access to %s", sds_name);
-        error_handler (true, FUNC_NAME, errmsg);
-        return (ERROR);
-    }
-
-    /* Close the DEM file */
-    status = SDend (sd_id);
-    if (status != 0)
-    {
-        sprintf (errmsg, "Closing DEM file.");
-        error_handler (true, FUNC_NAME, errmsg);
-        return (ERROR);
-    }
-
     /* Read the RATIO file */
     sd_id = SDstart (rationm, DFACC_RDONLY);
     if (sd_id < 0)
@@ -3098,6 +3012,249 @@ int read_auxiliary_files
         return (ERROR);
     }
 
+    /* Successful completion */
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  read_ratio_records
+
+PURPOSE:  Reads the band ratio averages from the ratio averages file and packs
+them into a record for each ratio grid cell.
+
+RETURN VALUE:
+Type = Ratio_rec_t *
+Value          Description
+-----          -----------
+NULL           Error occurred reading the ratio averages file
+non-NULL       Packed ratio records [RATIO_NBLAT x RATIO_NBLON]
+
+NOTES:
+  1. Memory is allocated for the packed ratio records, so it is up to the
+     calling routine to free this memory.
+  2. The int16 ratio grids are only held while the records are packed.
+******************************************************************************/
+Ratio_rec_t *read_ratio_records
+(
+    char *rationm       /* I: ratio averages filename */
+)
+{
+    char FUNC_NAME[] = "read_ratio_records"; /* function name */
+    char errmsg[STR_SIZE];   /* error message */
+    int retval;          /* return status */
+    long ncells = (long) RATIO_NBLAT * RATIO_NBLON;  /* number of ratio
+                            grid cells */
+    int16 *grids = NULL; /* ratio grids read from the file, NRATIO_GRIDS x
+                            RATIO_NBLAT x RATIO_NBLON */
+    Ratio_rec_t *ratio = NULL;  /* packed ratio records to be returned */
+
+    grids = calloc (NRATIO_GRIDS * ncells, sizeof (int16));
+    if (grids == NULL)
+    {
+        sprintf (errmsg, "Error allocating memory for the ratio grids");
+        error_handler (true, FUNC_NAME, errmsg);
+        return (NULL);
+    }
+
+    ratio = calloc (ncells, sizeof (Ratio_rec_t));
+    if (ratio == NULL)
+    {
+        sprintf (errmsg, "Error allocating memory for the ratio records");
+        error_handler (true, FUNC_NAME, errmsg);
+        free (grids);
+        return (NULL);
+    }
+
+    /* Read the ratio grids (andwi, sndwi, ratiob1/2/7, intratiob1/2/7, and
+       slpratiob1/2/7 in order), then pack them */
+    retval = read_ratio_file (rationm, &grids[0], &grids[ncells],
+        &grids[2*ncells], &grids[3*ncells], &grids[4*ncells],
+        &grids[5*ncells], &grids[6*ncells], &grids[7*ncells],
+        &grids[8*ncells], &grids[9*ncells], &grids[10*ncells]);
+    if (retval != SUCCESS)
+    {
+        sprintf (errmsg, "Reading the ratio averages file %s", rationm);
+        error_handler (true, FUNC_NAME, errmsg);
+        free (grids);
+        free (ratio);
+        return (NULL);
+    }
+
+    pack_ratio_records (ncells, &grids[0], &grids[ncells],
+        &grids[2*ncells], &grids[3*ncells], &grids[4*ncells],
+        &grids[5*ncells], &grids[6*ncells], &grids[7*ncells],
+        &grids[8*ncells], &grids[9*ncells], &grids[10*ncells], ratio);
+    free (grids);
+
+    return (ratio);
+}
+
+
+/******************************************************************************
+MODULE:  read_auxiliary_files
+
+PURPOSE:  Reads the static auxiliary files (CMG DEM and ratio averages)
+required for this application.
+
+RETURN VALUE:
+Type = int
+Value          Description
+-----          -----------
+ERROR          Error occurred reading one of the auxiliary files
+SUCCESS        Successful completion
+
+NOTES:
+  1. It is assumed that memory has already been allocated for the DEM.
+  2. The ratio records are mapped from the packed ratio record file if it is
+     up to date (see ratio_rec.c).  Otherwise they are packed from the ratio
+     averages file, and memory is allocated for them.  Either way, the
+     calling routine is responsible for unmapping or freeing them.
+******************************************************************************/
+int read_auxiliary_files
+(
+    char *cmgdemnm,     /* I: climate modeling grid DEM filename */
+    char *rationm,      /* I: ratio averages filename */
+    char *ratiorecnm,   /* I: packed ratio record filename */
+    int16 *dem,         /* O: CMG DEM data array [DEM_NBLAT x DEM_NBLON] */
+    Ratio_rec_t **ratio,  /* O: packed ratio records
+                                [RATIO_NBLAT x RATIO_NBLON] */
+    size_t *ratio_map_size  /* O: size of the mapping holding the ratio
+                                  records; 0 if they were allocated */
+)
+{
+    char FUNC_NAME[] = "read_auxiliary_files"; /* function name */
+    char errmsg[STR_SIZE];   /* error message */
+    char sds_name[STR_SIZE]; /* name of the SDS being read */
+    int i;               /* looping variable */
+    int status;          /* return status of the HDF function */
+    int start[5];        /* starting point to read SDS data; handles up to
+                            4D dataset */
+    int edges[5];        /* number of values to read in SDS data; handles up to
+                            4D dataset */
+    int sd_id;           /* file ID for the HDF file */
+    int sds_id;          /* ID for the current SDS */
+    int sds_index;       /* index for the current SDS */
+
+    /* Read the DEM */
+    sd_id = SDstart (cmgdemnm, DFACC_RDONLY);
+    if (sd_id < 0)
+    {
+        sprintf (errmsg, "Unable to open %s for reading as SDS", cmgdemnm);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    /* Find the SDS name */
+    strcpy (sds_name, "averaged elevation");
+    sds_index = SDnametoindex (sd_id, sds_name);
+    if (sds_index == -1)
+    {
+        sprintf (errmsg, "Unable to find %s in the DEM file %s", sds_name,
+            cmgdemnm);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    /* Open the current band as an SDS */
+    sds_id = SDselect (sd_id, sds_index);
+    if (sds_id < 0)
+    {
+        sprintf (errmsg, "Unable to access %s for reading", sds_name);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    /* Read the data one line at a time */
+    for (i = 0; i < DEM_NBLAT; i++)
+    {
+        start[0] = i;  /* line */
+        start[1] = 0;  /* sample */
+        edges[0] = 1;
+        edges[1] = DEM_NBLON;
+        status = SDreaddata (sds_id, start, NULL, edges, &dem[i * DEM_NBLON]);
+        if (status == -1)
+        {
+            sprintf (errmsg, "Reading data from the SDS: %s", sds_name);
+            error_handler (true, FUNC_NAME, errmsg);
+            return (ERROR);
+        }
+    }
+
+    /* Close the SDS */
+    status = SDendaccess (sds_id);
+    if (status < 0)
+    {
+        sprintf (errmsg, "Ending access to %s", sds_name);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    /* Close the DEM file */
+    status = SDend (sd_id);
+    if (status != 0)
+    {
+        sprintf (errmsg, "Closing DEM file.");
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    /* Map the packed ratio records, or pack them from the RATIO file */
+    *ratio = map_ratio_records (rationm, ratiorecnm, ratio_map_size);
+    if (*ratio == NULL)
+    {
+        *ratio = read_ratio_records (rationm);
+        if (*ratio == NULL)
+        {
+            sprintf (errmsg, "Reading the ratio records");
+            error_handler (true, FUNC_NAME, errmsg);
+            return (ERROR);
+        }
+    }
+
+    /* Successful completion */
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  read_aux_ozone_wv
+
+PURPOSE:  Reads the ozone and water vapor from the daily auxiliary file.
+
+RETURN VALUE:
+Type = int
+Value          Description
+-----          -----------
+ERROR          Error occurred reading the auxiliary file
+SUCCESS        Successful completion
+
+NOTES:
+  1. It is assumed that memory has already been allocated for the input data
+     arrays.
+  2. Unlike the other auxiliary files, this file changes with the acquisition
+     date of the scene.
+******************************************************************************/
+int read_aux_ozone_wv
+(
+    char *auxnm,        /* I: auxiliary filename for ozone and water vapor */
+    uint16 *wv,         /* O: water vapor values [CMG_NBLAT x CMG_NBLON] */
+    uint8 *oz           /* O: ozone values [CMG_NBLAT x CMG_NBLON] */
+)
+{
+    char FUNC_NAME[] = "read_aux_ozone_wv"; /* function name */
+    char errmsg[STR_SIZE];   /* error message */
+    char sds_name[STR_SIZE]; /* name of the SDS being read */
+    int i;               /* looping variable */
+    int status;          /* return status of the HDF function */
+    int start[5];        /* starting point to read SDS data; handles up to
+                            4D dataset */
+    int edges[5];        /* number of values to read in SDS data; handles up to
+                            4D dataset */
+    int sd_id;           /* file ID for the HDF file */
+    int sds_id;          /* ID for the current SDS */
+    int sds_index;       /* index for the current SDS */
+
     /* Read ozone and water vapor from the user-specified auxiliary file */
     sd_id = SDstart (auxnm, DFACC_RDONLY);
     if (sd_id < 0)
@@ -3208,4 +3365,3 @@ int read_auxiliary_files
     /* Successful completion */
     return (SUCCESS);
 }
-
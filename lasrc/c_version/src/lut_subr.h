@@ -8,9 +8,93 @@
 #include <stdbool.h>
 #include "common.h"
 #include "espa_metadata.h"
+#include "arena.h"
+#include "ratio_rec.h"
 #include "error_handler.h"
 
+/* Number of angstroem coefficients retrieved together by subaeroret_eps */
+#define NAERO_EPS 3
+
+/******************************************************************************
+MODULE:  atmcorlamb2_aot
+
+PURPOSE:  Lambertian atmospheric correction 2, computing the roatm, ttatmg,
+and satm from input coefficients for an AOT which has already been modified
+for the band.
+
+RETURN VALUE:
+Type = N/A
+
+NOTES:
+  1. This is inline since the AOT retrieval calls it for every band at every
+     AOT of each aerosol window.
+******************************************************************************/
+static inline void atmcorlamb2_aot
+(
+    float tgo,                /* I: other gaseous transmittance  */
+    float roatm_upper,        /* I: roatm upper bound poly_fit, given band */
+    float roatm_coef[NCOEF],  /* I: poly_fit coefficients for roatm  */
+    float ttatmg_coef[NCOEF], /* I: poly_fit coefficients for ttatmg */
+    float satm_coef[NCOEF],   /* I: poly_fit coefficients for satm */
+    float mraot550nm,         /* I: AOT modified for the band */
+    float rotoa,              /* I: top of atmosphere reflectance */
+    float *roslamb            /* O: lambertian surface reflectance */
+)
+{
+    float mraot550nm_sq;   /* mraot550nm squared */
+    float mraot550nm_cube; /* mraot550nm cubed */
+    float roatm;           /* intrinsic atmospheric reflectance */
+    float ttatmg;          /* total atmospheric transmission */
+    float satm;            /* spherical albedo */
+
+    /* Check the upper limit of the modified AOT value */
+    if (mraot550nm >= roatm_upper)
+        mraot550nm = roatm_upper;
+
+    /* Store the square and cube of the modified AOT value for multiple use */
+    mraot550nm_sq = mraot550nm * mraot550nm;
+    mraot550nm_cube = mraot550nm * mraot550nm *mraot550nm;
+
+    /* Compute the intrinsic atmospheric reflectance from the coefficients */
+    roatm = roatm_coef[3] +
+            roatm_coef[2] * mraot550nm +
+            roatm_coef[1] * mraot550nm_sq +
+            roatm_coef[0] * mraot550nm_cube;
+
+    /* Compute the total atmospheric transmission from the coefficients */
+    ttatmg = ttatmg_coef[3] +
+             ttatmg_coef[2] * mraot550nm +
+             ttatmg_coef[1] * mraot550nm_sq +
+             ttatmg_coef[0] * mraot550nm_cube;
+
+    /* Compute the spherical albedo from the coefficients */
+    satm = satm_coef[3] +
+           satm_coef[2] * mraot550nm +
+           satm_coef[1] * mraot550nm_sq +
+           satm_coef[0] * mraot550nm_cube;
+
+    /* Perform atmospheric correction */
+    *roslamb = (double) rotoa / tgo;
+    *roslamb = *roslamb - roatm;
+    *roslamb = *roslamb / ttatmg;
+    *roslamb = *roslamb / (1.0 + satm * (*roslamb));
+}
+
 /* Prototypes */
+double angstrom_factor
+(
+    int iband,                /* I: band index (0-based) */
+    float eps                 /* I: angstroem coefficient; spectral dependency
+                                    of the AOT */
+);
+
+void angstrom_factors
+(
+    float eps[NAERO_EPS],     /* I: angstroem coefficients */
+    double aot_fact[NSR_BANDS][NAERO_EPS]  /* O: angstrom factor for each of
+                                    bands 1-7 and eps */
+);
+
 void atmcorlamb2_new
 (
     float tgo,                /* I: other gaseous transmittance  */
@@ -37,9 +121,6 @@ void subaeroret_new
     float troatm[NSR_BANDS],               /* I: toa reflectance */
     float tgo_arr[NREFL_BANDS],            /* I: per-band other gaseous
                                                  transmittance */
-    float xrorayp_arr[NREFL_BANDS],        /* I: per-band reflectance of the
-                                                 atmosphere due to molecular
-                                                 (Rayleigh) scattering */
     int roatm_iaMax[NREFL_BANDS],          /* I: roatm_iaMax */
     float roatm_coef[NREFL_BANDS][NCOEF],  /* I: per band polynomial
                                                  coefficients for roatm */
@@ -55,6 +136,32 @@ void subaeroret_new
     float eps        /* I: angstroem coefficient; spectral dependency of AOT */
 );
 
+void subaeroret_eps
+(
+    int iband1,                            /* I: band 1 index (0-based) */
+    int iband3,                            /* I: band 3 index (0-based) */
+    float erelc[NSR_BANDS],                /* I: band ratio variable */
+    float troatm[NSR_BANDS],               /* I: toa reflectance */
+    float tgo_arr[NREFL_BANDS],            /* I: per-band other gaseous
+                                                 transmittance */
+    int roatm_iaMax[NREFL_BANDS],          /* I: roatm_iaMax */
+    float roatm_coef[NREFL_BANDS][NCOEF],  /* I: per band polynomial
+                                                 coefficients for roatm */
+    float ttatmg_coef[NREFL_BANDS][NCOEF], /* I: per band polynomial
+                                                 coefficients for ttatmg */
+    float satm_coef[NREFL_BANDS][NCOEF],   /* I: per band polynomial
+                                                 coefficients for satm */
+    float normext_p0a3_arr[NREFL_BANDS],   /* I: normext[iband][0][3] */
+    float eps[NAERO_EPS],      /* I: angstroem coefficients to retrieve the
+                                     AOT for, in the order of the calls */
+    double aot_fact[NSR_BANDS][NAERO_EPS], /* I: angstrom factor for each
+                                     band and eps, from angstrom_factors */
+    float raot[NAERO_EPS],     /* O: AOT reflectance for each eps */
+    float residual[NAERO_EPS], /* O: model residual for each eps */
+    int *iaots       /* O: AOT index for a following subaeroret_new call
+                           (0-based) */
+);
+
 int atmcorlamb2
 (
     float xts,                       /* I: solar zenith angle (deg) */
@@ -320,14 +427,17 @@ int subaeroret
                                        dependency of the AOT */
 );
 
+size_t memory_size_main
+(
+    int nlines,          /* I: number of lines in the scene */
+    int nsamps           /* I: number of samples in the scene */
+);
+
 int memory_allocation_main
 (
+    Arena_t *arena,      /* I/O: arena for the scene */
     int nlines,          /* I: number of lines in the scene */
     int nsamps,          /* I: number of samples in the scene */
-    int16 **sza,         /* O: solar zenith angle, nlines x nsamps  */
-    int16 **saa,         /* O: solar azimuth angle table, nlines x nsamps */
-    int16 **vza,         /* O: view zenith angle, nlines x nsamps  */
-    int16 **vaa,         /* O: view azimuth angle table, nlines x nsamps */
     uint16 **qaband,     /* O: QA band for the input image, nlines x nsamps */
     uint16 **radsat,     /* O: radiometric saturation band for the input image,
                                nlines x nsamps */
@@ -335,8 +445,31 @@ int memory_allocation_main
                                bands */
 );
 
+size_t memory_size_sr
+(
+    int nlines,          /* I: number of lines in the scene */
+    int nsamps           /* I: number of samples in the scene */
+);
+
 int memory_allocation_sr
 (
+    Arena_t *arena,      /* I/O: arena for the scene */
+    int nlines,          /* I: number of lines in the scene */
+    int nsamps,          /* I: number of samples in the scene */
+    uint8 **ipflag,      /* O: QA flag to assist with aerosol interpolation,
+                               nlines x nsamps */
+    float **twvi,        /* O: interpolated water vapor value,
+                               nlines x nsamps */
+    float **tozi,        /* O: interpolated ozone value, nlines x nsamps */
+    float **tp,          /* O: interpolated pressure value, nlines x nsamps */
+    float **taero,       /* O: aerosol values for each pixel, nlines x nsamps */
+    float **teps         /* O: eps (angstrom coefficient) for each pixel,
+                               nlines x nsamps*/
+);
+
+int memory_allocation_aero
+(
+    Arena_t *arena,      /* I/O: arena for the scene */
     int nlines,          /* I: number of lines in the scene */
     int nsamps,          /* I: number of samples in the scene */
     int16 **aerob1,      /* O: atmospherically corrected band 1 data
@@ -349,29 +482,15 @@ int memory_allocation_sr
                                (TOA refl), nlines x nsamps */
     int16 **aerob7,      /* O: atmospherically corrected band 7 data
                                (TOA refl), nlines x nsamps */
-    uint8 **ipflag,      /* O: QA flag to assist with aerosol interpolation,
-                               nlines x nsamps */
-    float **twvi,        /* O: interpolated water vapor value,
-                               nlines x nsamps */
-    float **tozi,        /* O: interpolated ozone value, nlines x nsamps */
-    float **tp,          /* O: interpolated pressure value, nlines x nsamps */
-    float **taero,       /* O: aerosol values for each pixel, nlines x nsamps */
-    float **teps,        /* O: eps (angstrom coefficient) for each pixel,
-                               nlines x nsamps*/
+    uint8 **pclass,      /* O: class plane for selecting the aerosol window
+                               pixel, nlines x nsamps */
+    uint8 **awin         /* O: aerosol window summary,
+                               AERO_NWINDOWS(nlines) x AERO_NWINDOWS(nsamps) */
+);
+
+int memory_allocation_tables
+(
     int16 **dem,         /* O: CMG DEM data array [DEM_NBLAT x DEM_NBLON] */
-    int16 **andwi,       /* O: avg NDWI [RATIO_NBLAT x RATIO_NBLON] */
-    int16 **sndwi,       /* O: standard NDWI [RATIO_NBLAT x RATIO_NBLON] */
-    int16 **ratiob1,     /* O: mean band1 ratio [RATIO_NBLAT x RATIO_NBLON] */
-    int16 **ratiob2,     /* O: mean band2 ratio [RATIO_NBLAT x RATIO_NBLON] */
-    int16 **ratiob7,     /* O: mean band7 ratio [RATIO_NBLAT x RATIO_NBLON] */
-    int16 **intratiob1,  /* O: band1 ratio [RATIO_NBLAT x RATIO_NBLON] */
-    int16 **intratiob2,  /* O: band2 ratio [RATIO_NBLAT x RATIO_NBLON] */
-    int16 **intratiob7,  /* O: band7 ratio [RATIO_NBLAT x RATIO_NBLON] */
-    int16 **slpratiob1,  /* O: slope band1 ratio [RATIO_NBLAT x RATIO_NBLON] */
-    int16 **slpratiob2,  /* O: slope band2 ratio [RATIO_NBLAT x RATIO_NBLON] */
-    int16 **slpratiob7,  /* O: slope band7 ratio [RATIO_NBLAT x RATIO_NBLON] */
-    uint16 **wv,         /* O: water vapor values [CMG_NBLAT x CMG_NBLON] */
-    uint8 **oz,          /* O: ozone values [CMG_NBLAT x CMG_NBLON] */
     float **rolutt,      /* O: intrinsic reflectance table
                                [NSR_BANDS x NPRES_VALS x NAOT_VALS x
                                 NSOLAR_VALS] */
@@ -395,23 +514,26 @@ int memory_allocation_sr
                                [NVIEW_ZEN_VALS x NSOLAR_ZEN_VALS] */
 );
 
+Ratio_rec_t *read_ratio_records
+(
+    char *rationm       /* I: ratio averages filename */
+);
+
 int read_auxiliary_files
 (
     char *cmgdemnm,     /* I: climate modeling grid DEM filename */
     char *rationm,      /* I: ratio averages filename */
-    char *auxnm,        /* I: auxiliary filename for ozone and water vapor */
+    char *ratiorecnm,   /* I: packed ratio record filename */
     int16 *dem,         /* O: CMG DEM data array [DEM_NBLAT x DEM_NBLON] */
-    int16 *andwi,       /* O: avg NDWI [RATIO_NBLAT x RATIO_NBLON] */
-    int16 *sndwi,       /* O: standard NDWI [RATIO_NBLAT x RATIO_NBLON] */
-    int16 *ratiob1,     /* O: mean band1 ratio [RATIO_NBLAT x RATIO_NBLON] */
-    int16 *ratiob2,     /* O: mean band2 ratio [RATIO_NBLAT x RATIO_NBLON] */
-    int16 *ratiob7,     /* O: mean band7 ratio [RATIO_NBLAT x RATIO_NBLON] */
-    int16 *intratiob1,  /* O: band1 ratio [RATIO_NBLAT x RATIO_NBLON] */
-    int16 *intratiob2,  /* O: band2 ratio [RATIO_NBLAT x RATIO_NBLON] */
-    int16 *intratiob7,  /* O: band7 ratio [RATIO_NBLAT x RATIO_NBLON] */
-    int16 *slpratiob1,  /* O: slope band1 ratio [RATIO_NBLAT x RATIO_NBLON] */
-    int16 *slpratiob2,  /* O: slope band2 ratio [RATIO_NBLAT x RATIO_NBLON] */
-    int16 *slpratiob7,  /* O: slope band7 ratio [RATIO_NBLAT x RATIO_NBLON] */
+    Ratio_rec_t **ratio,  /* O: packed ratio records
+                                [RATIO_NBLAT x RATIO_NBLON] */
+    size_t *ratio_map_size  /* O: size of the mapping holding the ratio
+                                  records; 0 if they were allocated */
+);
+
+int read_aux_ozone_wv
+(
+    char *auxnm,        /* I: auxiliary filename for ozone and water vapor */
     uint16 *wv,         /* O: water vapor values [CMG_NBLAT x CMG_NBLON] */
     uint8 *oz           /* O: ozone values [CMG_NBLAT x CMG_NBLON] */
 );
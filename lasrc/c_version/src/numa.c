@@ -0,0 +1,313 @@
+/*****************************************************************************
+FILE: numa.c
+
+PURPOSE: Contains functions for placing the OpenMP threads and the scene
+arrays on the NUMA nodes of multi-socket machines, and for reporting where
+they were placed.
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+LICENSE TYPE:  NASA Open Source Agreement Version 1.3
+
+NOTES:
+  1. Threads are pinned with the following policy.  The CPUs the process is
+     allowed to run on are listed in order of their NUMA node.  Thread t of n
+     is assigned to the node holding position t*ncpus/n of that list, so each
+     node gets a share of the threads in proportion to its CPUs, and the
+     threads on a node are consecutive.  Within a node, the threads are
+     pinned to the node's CPUs in order, which puts them on separate cores
+     before using the hyperthread siblings on Linux's usual CPU numbering.
+  2. The line loops use the default static schedule, so thread t always
+     processes the same block of lines.  With the threads pinned and the scene
+     arrays first touched using the same partitioning (see arena.c), each
+     block of lines is held in the memory local to the thread processing it.
+     Only these line loops (the TOA reflectance, the interpolation of the
+     auxiliary data, and the class plane) gain from the placement.  The
+     aerosol inversion, aerosol interpolation, and surface reflectance loops
+     take the tiles of tile_sched.c in cost order, so a thread's tiles are
+     anywhere in the scene and most of them are on the other nodes.  Those
+     loops are mostly compute bound, and balancing the threads matters more
+     to them than locality.  bench_numa times a streaming loop over both the
+     lines and the tiles with and without the placement.
+  3. Only LaSRC has the placement.  The LEDAPS lndsr loops are not pinned or
+     first touched.
+  4. The NUMA topology is read from /sys/devices/system/node.  If it is not
+     available, all the CPUs are treated as a single node.  Pinning and the
+     placement report are only done on Linux with OpenMP.
+*****************************************************************************/
+#define _GNU_SOURCE
+#include <sched.h>
+#include <dirent.h>
+#include <unistd.h>
+#ifdef __linux__
+    #include <sys/syscall.h>
+#endif
+#ifdef _OPENMP
+    #include <omp.h>
+#endif
+#include "numa.h"
+
+/******************************************************************************
+MODULE:  read_cpu_nodes
+
+PURPOSE:  Reads the NUMA node for each CPU.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+n               Number of NUMA nodes (at least 1)
+
+NOTES:
+  1. CPUs which aren't listed for any node are left on node 0.
+******************************************************************************/
+static int read_cpu_nodes
+(
+    int *cpu_node         /* O: NUMA node for each CPU [CPU_SETSIZE] */
+)
+{
+    char cpulist_file[STR_SIZE];  /* cpulist file for the node */
+    char cpulist[STR_SIZE];       /* list of CPUs on the node */
+    char *cptr = NULL;            /* current location in the CPU list */
+    char *endptr = NULL;          /* end of the current CPU number */
+    int node;                     /* current node */
+    int nnodes = 1;               /* number of nodes */
+    long first, last;             /* range of CPUs in the list */
+    long cpu;                     /* looping variable for CPUs */
+    DIR *dir = NULL;              /* node directory */
+    struct dirent *entry = NULL;  /* entry in the node directory */
+    FILE *fp = NULL;              /* cpulist file pointer */
+
+    for (cpu = 0; cpu < CPU_SETSIZE; cpu++)
+        cpu_node[cpu] = 0;
+
+    dir = opendir ("/sys/devices/system/node");
+    if (dir == NULL)
+        return (nnodes);
+
+    while ((entry = readdir (dir)) != NULL)
+    {
+        if (sscanf (entry->d_name, "node%d", &node) != 1 || node < 0 ||
+            node >= MAX_NUMA_NODES)
+            continue;
+
+        snprintf (cpulist_file, sizeof (cpulist_file),
+            "/sys/devices/system/node/%s/cpulist", entry->d_name);
+        fp = fopen (cpulist_file, "r");
+        if (fp == NULL)
+            continue;
+        if (fgets (cpulist, sizeof (cpulist), fp) == NULL)
+            cpulist[0] = '\0';
+        fclose (fp);
+
+        /* The list is in the form 0-15,32-47 */
+        cptr = cpulist;
+        while (*cptr != '\0' && *cptr != '\n')
+        {
+            first = strtol (cptr, &endptr, 10);
+            if (endptr == cptr)
+                break;
+            last = first;
+            cptr = endptr;
+            if (*cptr == '-')
+            {
+                cptr++;
+                last = strtol (cptr, &endptr, 10);
+                cptr = endptr;
+            }
+            for (cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++)
+                if (cpu >= 0)
+                    cpu_node[cpu] = node;
+            if (*cptr == ',')
+                cptr++;
+        }
+
+        if (node + 1 > nnodes)
+            nnodes = node + 1;
+    }
+    closedir (dir);
+
+    return (nnodes);
+}
+
+
+/******************************************************************************
+MODULE:  pin_threads
+
+PURPOSE:  Pins each of the OpenMP threads to a CPU, spreading them over the
+NUMA nodes, and reports the number of threads on each node.
+
+RETURN VALUE:
+Type = None
+
+NOTES:
+  1. See the pinning policy in the notes for this file.
+  2. The threads are pinned for the current number of OpenMP threads, so this
+     should be called after omp_set_num_threads.  Pinning is advice for
+     performance, so failures are reported as warnings.
+******************************************************************************/
+void pin_threads ()
+{
+#if defined (_OPENMP) && defined (__linux__)
+    char FUNC_NAME[] = "pin_threads";   /* function name */
+    char errmsg[STR_SIZE];       /* error message */
+    static int cpu_node[CPU_SETSIZE];  /* NUMA node for each CPU */
+    static int cpus[CPU_SETSIZE];      /* allowed CPUs, in node order */
+    int node_first[MAX_NUMA_NODES];    /* first CPU in cpus for each node */
+    int node_ncpus[MAX_NUMA_NODES];    /* number of allowed CPUs per node */
+    int node_nthreads[MAX_NUMA_NODES]; /* number of threads per node */
+    int *thread_cpu = NULL;      /* CPU for each thread */
+    int nnodes;                  /* number of NUMA nodes */
+    int ncpus = 0;               /* number of allowed CPUs */
+    int nthreads;                /* number of OpenMP threads */
+    int nfailed = 0;             /* number of threads which weren't pinned */
+    int node;                    /* looping variable for nodes */
+    int cpu;                     /* looping variable for CPUs */
+    int t;                       /* looping variable for threads */
+    cpu_set_t allowed;           /* CPUs the process may run on */
+
+    if (sched_getaffinity (0, sizeof (allowed), &allowed) != 0)
+    {
+        sprintf (errmsg, "Unable to get the allowed CPUs; threads will not "
+            "be pinned");
+        error_handler (false, FUNC_NAME, errmsg);
+        return;
+    }
+
+    /* List the allowed CPUs in node order */
+    nnodes = read_cpu_nodes (cpu_node);
+    for (node = 0; node < nnodes; node++)
+    {
+        node_first[node] = ncpus;
+        node_ncpus[node] = 0;
+        node_nthreads[node] = 0;
+        for (cpu = 0; cpu < CPU_SETSIZE; cpu++)
+        {
+            if (CPU_ISSET (cpu, &allowed) && cpu_node[cpu] == node)
+            {
+                cpus[ncpus++] = cpu;
+                node_ncpus[node]++;
+            }
+        }
+    }
+    if (ncpus == 0)
+        return;
+
+    /* Assign the threads to the CPUs */
+    nthreads = omp_get_max_threads ();
+    thread_cpu = calloc (nthreads, sizeof (int));
+    if (thread_cpu == NULL)
+    {
+        sprintf (errmsg, "Error allocating memory for the thread CPUs; "
+            "threads will not be pinned");
+        error_handler (false, FUNC_NAME, errmsg);
+        return;
+    }
+    for (t = 0; t < nthreads; t++)
+    {
+        node = cpu_node[cpus[(long) t * ncpus / nthreads]];
+        thread_cpu[t] = cpus[node_first[node] +
+            node_nthreads[node] % node_ncpus[node]];
+        node_nthreads[node]++;
+    }
+
+    /* Each thread pins itself */
+    #pragma omp parallel private (t) reduction (+:nfailed)
+    {
+        cpu_set_t mask;          /* CPU for this thread */
+
+        t = omp_get_thread_num ();
+        CPU_ZERO (&mask);
+        CPU_SET (thread_cpu[t], &mask);
+        if (sched_setaffinity (0, sizeof (mask), &mask) != 0)
+            nfailed++;
+    }
+    free (thread_cpu);
+
+    if (nfailed > 0)
+    {
+        sprintf (errmsg, "%d of %d threads could not be pinned", nfailed,
+            nthreads);
+        error_handler (false, FUNC_NAME, errmsg);
+    }
+
+    printf ("Pinned %d threads to %d CPUs on %d NUMA node(s):\n", nthreads,
+        ncpus, nnodes);
+    for (node = 0; node < nnodes; node++)
+    {
+        if (node_ncpus[node] > 0)
+            printf ("  Node %d: %d threads on %d CPUs\n", node,
+                node_nthreads[node], node_ncpus[node]);
+    }
+#endif
+}
+
+
+/******************************************************************************
+MODULE:  report_numa_placement
+
+PURPOSE:  Reports the amount of the specified memory held on each NUMA node.
+
+RETURN VALUE:
+Type = None
+
+NOTES:
+  1. The node of each page is queried with the move_pages system call, which
+     doesn't move the pages when no target nodes are given.  Pages which
+     haven't been touched yet aren't on any node and are reported separately.
+******************************************************************************/
+void report_numa_placement
+(
+    char *descr,          /* I: description of the memory for the report */
+    void *base,           /* I: start of the memory */
+    size_t nbytes         /* I: number of bytes of memory */
+)
+{
+#if defined (__linux__) && defined (SYS_move_pages)
+    long psize = sysconf (_SC_PAGESIZE);  /* system page size */
+    long npages;          /* number of pages in the memory */
+    long page;            /* looping variable for pages */
+    long nchunk;          /* number of pages in the current query */
+    long i;               /* looping variable for the pages in a query */
+    long node_pages[MAX_NUMA_NODES];  /* number of pages on each node */
+    long unplaced = 0;    /* number of pages not on any node */
+    void *pages[1024];    /* pages in the current query */
+    int status[1024];     /* node of each page in the current query */
+    int node;             /* looping variable for nodes */
+    double mb;            /* megabytes per page */
+
+    if (base == NULL || nbytes == 0 || psize <= 0)
+        return;
+    for (node = 0; node < MAX_NUMA_NODES; node++)
+        node_pages[node] = 0;
+
+    npages = (nbytes + psize - 1) / psize;
+    for (page = 0; page < npages; page += nchunk)
+    {
+        nchunk = MIN (npages - page, 1024);
+        for (i = 0; i < nchunk; i++)
+            pages[i] = (char *) base + (page + i) * psize;
+        if (syscall (SYS_move_pages, 0, nchunk, pages, NULL, status, 0) != 0)
+            return;
+
+        for (i = 0; i < nchunk; i++)
+        {
+            if (status[i] >= 0 && status[i] < MAX_NUMA_NODES)
+                node_pages[status[i]]++;
+            else
+                unplaced++;
+        }
+    }
+
+    mb = psize / (1024.0 * 1024.0);
+    printf ("NUMA placement of %s:\n", descr);
+    for (node = 0; node < MAX_NUMA_NODES; node++)
+    {
+        if (node_pages[node] > 0)
+            printf ("  Node %d: %.1f MB\n", node, node_pages[node] * mb);
+    }
+    if (unplaced > 0)
+        printf ("  Not touched yet: %.1f MB\n", unplaced * mb);
+#endif
+}
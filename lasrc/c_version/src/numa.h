@@ -0,0 +1,24 @@
+#ifndef _NUMA_H_
+#define _NUMA_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "common.h"
+#include "error_handler.h"
+
+/* Define the maximum number of NUMA nodes reported */
+#define MAX_NUMA_NODES 64
+
+/* Prototypes */
+void pin_threads ();
+
+void report_numa_placement
+(
+    char *descr,          /* I: description of the memory for the report */
+    void *base,           /* I: start of the memory */
+    size_t nbytes         /* I: number of bytes of memory */
+);
+
+#endif
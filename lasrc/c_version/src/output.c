@@ -30,13 +30,20 @@ NULL           Error occurred opening the file
 not-NULL       Successful completion
 
 NOTES:
+  1. The output bands are the size of the output window of the input (see
+     set_input_window), which may be a window of the band buffers holding
+     the lines/samples read.
+  2. The long names of the surface reflectance bands of a window note when
+     the median aerosol was found over the window rather than carried in
+     from the full scene (see uses_window_median).
 ******************************************************************************/
 Output_t *open_output
 (
     Espa_internal_meta_t *in_meta,  /* I: input metadata structure */
     Input_t *input,                 /* I: input band data structure */
-    Myoutput_t output_type          /* I: are we processing TOA, SR, RADSAT
+    Myoutput_t output_type,         /* I: are we processing TOA, SR, RADSAT
                                           outputs? */
+    Myformat_t format               /* I: output file format */
 )
 {
     char FUNC_NAME[] = "open_output";   /* function name */
@@ -135,8 +142,14 @@ Output_t *open_output
        bands */
     output->open = false;
     output->nband = nband;
-    output->nlines = input->size.nlines;
-    output->nsamps = input->size.nsamps;
+    output->nlines = input->out_window.nlines;
+    output->nsamps = input->out_window.nsamps;
+    output->buf_nsamps = input->size.nsamps;
+    output->buf_offset = (long) (input->out_window.line0 - input->line0) *
+        input->size.nsamps + input->out_window.samp0 - input->samp0;
+    output->format = format;
+    output->raw_size = 0;
+    output->file_size = 0;
     for (ib = 0; ib < output->nband; ib++)
         output->fp_bin[ib] = NULL;
  
@@ -310,6 +323,13 @@ Output_t *open_output
                     sprintf (bmeta[ib].name, "sr_band%d", ib+1);
                     sprintf (bmeta[ib].long_name, "band %d surface reflectance",
                         ib+1);
+
+                    /* Flag a window whose cloud, shadow, water, and failed
+                       aerosol retrieval pixels don't match a full scene
+                       run */
+                    if (uses_window_median (input))
+                        strcat (bmeta[ib].long_name, " (median aerosol of "
+                            "the window)");
                 }
             }
             else if (ib == SR_BAND9)  /* cirrus band */
@@ -332,8 +352,12 @@ Output_t *open_output
            these are the thermal bands. */
         if ((ib != SR_BAND10 && ib != SR_BAND11) || output->inst != INST_OLI)
         {
-            sprintf (bmeta[ib].file_name, "%s_%s.img", scene_name,
-                bmeta[ib].name);
+            if (output->format == FORMAT_TILED)
+                sprintf (bmeta[ib].file_name, "%s_%s.%s", scene_name,
+                    bmeta[ib].name, TILED_EXTENSION);
+            else
+                sprintf (bmeta[ib].file_name, "%s_%s.img", scene_name,
+                    bmeta[ib].name);
             output->fp_bin[ib] = open_raw_binary (bmeta[ib].file_name, "w+");
             if (output->fp_bin[ib] == NULL)
             {
@@ -403,6 +427,12 @@ int close_output
     }
     output->open = false;
 
+    /* Report the compression of the tiled bands */
+    if (output->format == FORMAT_TILED && output->file_size > 0)
+        printf ("  Compressed %ld bytes of band data to %ld bytes (ratio "
+            "%.2f)\n", output->raw_size, output->file_size,
+            (double) output->raw_size / output->file_size);
+
     return (SUCCESS);
 }
 
@@ -481,6 +511,11 @@ ERROR      Error occurred writing the output data
 SUCCESS    Successful completion
 
 NOTES:
+  1. For the tiled output format the entire band must be written in a single
+     call, since the band is tiled and compressed as a whole.
+  2. buf holds the lines of the band buffer starting with line iline of the
+     output.  The output window is taken from it using the buf_offset and
+     buf_nsamps of the output structure.
 ******************************************************************************/
 int put_output_lines
 (
@@ -495,7 +530,11 @@ int put_output_lines
 {
     char FUNC_NAME[] = "put_output_lines";   /* function name */
     char errmsg[STR_SIZE];    /* error message */
+    int line;                 /* looping variable for the lines */
     long loc;                 /* current location in the output file */
+    long file_size;           /* bytes written for a tiled band */
+    unsigned char *buf_line = (unsigned char *) buf;  /* first pixel of the
+                                 current output line in buf */
   
     /* Check the parameters */
     if (output == (Output_t *)NULL) 
@@ -530,6 +569,34 @@ int put_output_lines
         return (ERROR);
     }
   
+    /* Tiled bands are compressed and written as a whole */
+    if (output->format == FORMAT_TILED)
+    {
+        if (iline != 0 || nlines != output->nlines)
+        {
+            sprintf (errmsg, "Tiled output bands must be written as a whole "
+                "band.");
+            error_handler (true, FUNC_NAME, errmsg);
+            return (ERROR);
+        }
+
+        rewind (output->fp_bin[iband]);
+        if (write_tiled_band (output->fp_bin[iband],
+            &buf_line[output->buf_offset * nbytes], output->buf_nsamps,
+            nlines, output->nsamps, nbytes, DEFAULT_TILE_SIZE,
+            DEFAULT_TILE_LEVEL, &file_size) != SUCCESS)
+        {
+            sprintf (errmsg, "Error writing the tiled output for band %d.",
+                iband);
+            error_handler (true, FUNC_NAME, errmsg);
+            return (ERROR);
+        }
+
+        output->raw_size += (long) nlines * output->nsamps * nbytes;
+        output->file_size += file_size;
+        return (SUCCESS);
+    }
+
     /* Write the data, but first seek to the correct line */
     loc = (long) iline * output->nsamps * nbytes;
     if (fseek (output->fp_bin[iband], loc, SEEK_SET))
@@ -540,13 +607,32 @@ int put_output_lines
         return (ERROR);
     }
 
-    if (write_raw_binary (output->fp_bin[iband], nlines, output->nsamps,
-        nbytes, buf) != SUCCESS)
+    if (output->buf_nsamps == output->nsamps && output->buf_offset == 0)
     {
-        sprintf (errmsg, "Error writing the output line(s) for band %d.",
-            iband);
-        error_handler (true, FUNC_NAME, errmsg);
-        return (ERROR);
+        if (write_raw_binary (output->fp_bin[iband], nlines, output->nsamps,
+            nbytes, buf) != SUCCESS)
+        {
+            sprintf (errmsg, "Error writing the output line(s) for band %d.",
+                iband);
+            error_handler (true, FUNC_NAME, errmsg);
+            return (ERROR);
+        }
+        return (SUCCESS);
+    }
+
+    /* Otherwise write the output window of each line of the buffer */
+    buf_line += output->buf_offset * nbytes;
+    for (line = 0; line < nlines; line++)
+    {
+        if (write_raw_binary (output->fp_bin[iband], 1, output->nsamps,
+            nbytes, buf_line) != SUCCESS)
+        {
+            sprintf (errmsg, "Error writing output line %d for band %d.",
+                iline + line, iband);
+            error_handler (true, FUNC_NAME, errmsg);
+            return (ERROR);
+        }
+        buf_line += (long) output->buf_nsamps * nbytes;
     }
     
     return (SUCCESS);
@@ -3,6 +3,7 @@
 
 #include "common.h"
 #include "input.h"
+#include "tiled_io.h"
 
 /* Define some of the constants to use in the output data products */
 #define FILL_VALUE -9999
@@ -16,11 +17,14 @@
 #define MAX_VALID 16000
 #define MIN_VALID_TH 1500
 #define MAX_VALID_TH 3500
-#define L1_SATURATED 65535       /* saturation value of the Level-1 pixel */
 
 /* Define the output product types */
 typedef enum {OUTPUT_TOA=0, OUTPUT_SR=1, OUTPUT_RADSAT=2} Myoutput_t;
 
+/* Define the output file formats; raw binary (ESPA internal format) or
+   tiled and compressed (see tiled_io.h) */
+typedef enum {FORMAT_RAW=0, FORMAT_TILED=1} Myformat_t;
+
 /* Structure for the 'output' data type */
 typedef struct {
   bool open;            /* Flag to indicate whether output file is open;
@@ -29,11 +33,19 @@ typedef struct {
   int nband;            /* Number of output bands */
   int nlines;           /* Number of output lines */
   int nsamps;           /* Number of output samples */
+  int buf_nsamps;       /* Number of samples in each line of the band buffers
+                           written; more than nsamps when only a window of
+                           the buffers is written */
+  long buf_offset;      /* Offset (pixels) of the first output pixel in the
+                           band buffers written */
   Espa_internal_meta_t metadata;  /* Metadata container to hold the band
                            metadata for the output bands; global metadata
                            won't be valid */
   FILE *fp_bin[NBAND_TTL_OUT];  /* File pointer for binary files; see common.h
                            for the bands and order of bands in the output */
+  Myformat_t format;    /* output file format */
+  long raw_size;        /* number of bytes of band data written */
+  long file_size;       /* number of bytes written to the band files */
 } Output_t;
 
 /* Prototypes */
@@ -41,8 +53,9 @@ Output_t *open_output
 (
     Espa_internal_meta_t *in_meta,  /* I: input metadata structure */
     Input_t *input,                 /* I: input band data structure */
-    Myoutput_t output_type          /* I: are we processing TOA, SR, RADSAT
+    Myoutput_t output_type,         /* I: are we processing TOA, SR, RADSAT
                                           outputs? */
+    Myformat_t format               /* I: output file format */
 );
 
 int close_output
@@ -0,0 +1,218 @@
+/*****************************************************************************
+FILE: quicklook.c
+
+PURPOSE: Contains functions for the quick-look mode, which runs the TOA and
+surface reflectance corrections on a grid reduced by a factor of N in the
+lines and samples (see set_input_quicklook) for a fast preview of the scene.
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+LICENSE TYPE:  NASA Open Source Agreement Version 1.3
+
+NOTES:
+  1. The quick-look products are named for the reduction factor and listed in
+     their own XML file, so they don't overwrite or get mixed up with the
+     full resolution products.
+  2. The thumbnail is a raw 8-bit RGB image with a plain ENVI header, so it
+     can be viewed without any image libraries.
+*****************************************************************************/
+#include "quicklook.h"
+
+/******************************************************************************
+MODULE:  set_quicklook_metadata
+
+PURPOSE:  Sets up the XML metadata for the output products of a quick look.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           The scene isn't north up
+SUCCESS         No errors encountered
+
+NOTES:
+  1. ql_metadata is a copy of xml_metadata with the global metadata updated
+     for the quick look.  It shares the band metadata of xml_metadata, so it
+     must not be freed with free_metadata.
+  2. Each quick-look pixel covers a block of full resolution pixels starting
+     at the UL corner of the scene.  If the projection corners are pixel
+     centers, the UL corner moves to the center of the first block.  The
+     lat/long corners and bounding coordinates of the scene are kept.
+******************************************************************************/
+int set_quicklook_metadata
+(
+    Espa_internal_meta_t *xml_metadata,  /* I: XML metadata for the scene */
+    Input_t *input,       /* I: input structure, reduced for the quick look */
+    Espa_internal_meta_t *ql_metadata    /* O: XML metadata for the output
+                                products of the quick look */
+)
+{
+    char FUNC_NAME[] = "set_quicklook_metadata";   /* function name */
+    char errmsg[STR_SIZE];   /* error message */
+    char product_id[STR_SIZE];  /* product ID for the quick look */
+    double pixsize[2];       /* pixel size of the quick look */
+    int factor = input->quicklook;  /* reduction factor */
+    Espa_global_meta_t *gmeta = NULL;  /* global metadata for the quick
+                                          look */
+
+    if (fabs (xml_metadata->global.orientation_angle) > 0.0)
+    {
+        sprintf (errmsg, "A quick look can only be made of a north up scene; "
+            "the orientation angle is %f",
+            xml_metadata->global.orientation_angle);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    *ql_metadata = *xml_metadata;
+    gmeta = &ql_metadata->global;
+
+    snprintf (product_id, sizeof (product_id), "%s_ql%d",
+        xml_metadata->global.product_id, factor);
+    strcpy (gmeta->product_id, product_id);
+
+    /* Move the projection corners to the corner pixels of the quick look */
+    pixsize[0] = input->size.pixsize[0];
+    pixsize[1] = input->size.pixsize[1];
+    if (!strcmp (gmeta->proj_info.grid_origin, "CENTER"))
+    {
+        gmeta->proj_info.ul_corner[0] +=
+            0.5 * pixsize[0] * (factor - 1) / factor;
+        gmeta->proj_info.ul_corner[1] -=
+            0.5 * pixsize[1] * (factor - 1) / factor;
+    }
+    gmeta->proj_info.lr_corner[0] = gmeta->proj_info.ul_corner[0] +
+        (input->size.nsamps - 1) * pixsize[0];
+    gmeta->proj_info.lr_corner[1] = gmeta->proj_info.ul_corner[1] -
+        (input->size.nlines - 1) * pixsize[1];
+
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  write_quicklook_thumbnail
+
+PURPOSE:  Writes the RGB thumbnail of the quick look from bands 4, 3, and 2,
+along with its ENVI header.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error allocating memory or writing the thumbnail
+SUCCESS         No errors encountered
+
+NOTES:
+  1. The thumbnail is written as PRODUCT_ID_thumb.rgb, one line at a time.
+     Fill pixels are black.
+  2. The bands hold surface reflectance if it was processed, and TOA
+     reflectance otherwise.
+******************************************************************************/
+int write_quicklook_thumbnail
+(
+    char *product_id,     /* I: product ID of the quick look */
+    int16 **sband,        /* I: reflectance bands of the quick look */
+    int nlines,           /* I: number of lines in the quick look */
+    int nsamps            /* I: number of samples in the quick look */
+)
+{
+    char FUNC_NAME[] = "write_quicklook_thumbnail";   /* function name */
+    char errmsg[STR_SIZE];   /* error message */
+    char thumb_file[STR_SIZE];  /* thumbnail filename */
+    char hdr_file[STR_SIZE];    /* thumbnail ENVI header filename */
+    int line, samp;          /* looping variables for the pixels */
+    int ib;                  /* looping variable for the RGB bands */
+    int val;                 /* current reflectance value */
+    long pix;                /* current pixel in the bands */
+    uint8 *rgb = NULL;       /* RGB values for the current line */
+    FILE *fp = NULL;         /* file pointer for the thumbnail and header */
+    int rgb_band[THUMB_NBANDS] = {SR_BAND4, SR_BAND3, SR_BAND2};
+                             /* bands for the red, green, and blue */
+
+    snprintf (thumb_file, sizeof (thumb_file), "%s_%s", product_id,
+        THUMB_EXTENSION);
+    snprintf (hdr_file, sizeof (hdr_file), "%s_thumb.hdr", product_id);
+
+    rgb = malloc ((size_t) nsamps * THUMB_NBANDS);
+    if (rgb == NULL)
+    {
+        sprintf (errmsg, "Allocating the thumbnail line");
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    fp = fopen (thumb_file, "wb");
+    if (fp == NULL)
+    {
+        sprintf (errmsg, "Opening the thumbnail file: %s", thumb_file);
+        error_handler (true, FUNC_NAME, errmsg);
+        free (rgb);
+        return (ERROR);
+    }
+
+    for (line = 0; line < nlines; line++)
+    {
+        pix = (long) line * nsamps;
+        for (samp = 0; samp < nsamps; samp++, pix++)
+        {
+            for (ib = 0; ib < THUMB_NBANDS; ib++)
+            {
+                val = sband[rgb_band[ib]][pix];
+                if (val == FILL_VALUE || val <= 0)
+                    val = 0;
+                else
+                    val = MIN (val, THUMB_MAX_REFL) * 255 / THUMB_MAX_REFL;
+                rgb[samp * THUMB_NBANDS + ib] = (uint8) val;
+            }
+        }
+
+        if (fwrite (rgb, THUMB_NBANDS, nsamps, fp) != (size_t) nsamps)
+        {
+            sprintf (errmsg, "Writing line %d of the thumbnail file: %s",
+                line, thumb_file);
+            error_handler (true, FUNC_NAME, errmsg);
+            fclose (fp);
+            free (rgb);
+            return (ERROR);
+        }
+    }
+    free (rgb);
+
+    if (fclose (fp) != 0)
+    {
+        sprintf (errmsg, "Closing the thumbnail file: %s", thumb_file);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    /* Write a plain ENVI header so the thumbnail can be viewed */
+    fp = fopen (hdr_file, "w");
+    if (fp == NULL)
+    {
+        sprintf (errmsg, "Opening the thumbnail header file: %s", hdr_file);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+    fprintf (fp, "ENVI\n");
+    fprintf (fp, "description = {LaSRC quick-look thumbnail, bands 4, 3, "
+        "2}\n");
+    fprintf (fp, "samples = %d\n", nsamps);
+    fprintf (fp, "lines = %d\n", nlines);
+    fprintf (fp, "bands = %d\n", THUMB_NBANDS);
+    fprintf (fp, "header offset = 0\n");
+    fprintf (fp, "file type = ENVI Standard\n");
+    fprintf (fp, "data type = 1\n");
+    fprintf (fp, "interleave = bip\n");
+    fprintf (fp, "byte order = 0\n");
+    fprintf (fp, "band names = {band 4, band 3, band 2}\n");
+    if (fclose (fp) != 0)
+    {
+        sprintf (errmsg, "Closing the thumbnail header file: %s", hdr_file);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    return (SUCCESS);
+}
@@ -0,0 +1,39 @@
+#ifndef _QUICKLOOK_H_
+#define _QUICKLOOK_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdbool.h>
+#include "common.h"
+#include "input.h"
+#include "output.h"
+#include "espa_metadata.h"
+#include "error_handler.h"
+
+/* Define the thumbnail written for a quick look.  The thumbnail is an 8-bit
+   RGB image of bands 4, 3, and 2, interleaved by pixel, with reflectances
+   from 0 to THUMB_MAX_REFL (scaled) stretched linearly over 0 to 255. */
+#define THUMB_EXTENSION "thumb.rgb"
+#define THUMB_MAX_REFL 3000
+#define THUMB_NBANDS 3
+
+/* Prototypes */
+int set_quicklook_metadata
+(
+    Espa_internal_meta_t *xml_metadata,  /* I: XML metadata for the scene */
+    Input_t *input,       /* I: input structure, reduced for the quick look */
+    Espa_internal_meta_t *ql_metadata    /* O: XML metadata for the output
+                                products of the quick look */
+);
+
+int write_quicklook_thumbnail
+(
+    char *product_id,     /* I: product ID of the quick look */
+    int16 **sband,        /* I: reflectance bands of the quick look */
+    int nlines,           /* I: number of lines in the quick look */
+    int nsamps            /* I: number of samples in the quick look */
+);
+
+#endif
@@ -0,0 +1,322 @@
+/*****************************************************************************
+FILE: ratio_rec.c
+
+PURPOSE: Contains functions for packing the band ratio averages into a single
+record per ratio grid cell, and for writing and mapping the packed ratio
+record file.
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+LICENSE TYPE:  NASA Open Source Agreement Version 1.3
+
+NOTES:
+  1. The aerosol inversion interpolates the ratio slope/intercept values from
+     the four ratio cells surrounding each aerosol window.  Held as separate
+     int16 grids, that is a load from a dozen 3600x7200 grids per cell.  The
+     packed record holds everything the inversion needs for a cell in 32
+     bytes, already unscaled and with the resets for invalid ratios applied.
+  2. The packed ratio record file is written once for each version of the
+     ratio averages file (lasrc --pack_ratios) and is mapped read-only, so
+     only the pages around the scenes being processed are read, and they are
+     shared by all the processes on the machine.  The file is tied to the
+     size and modification time of the ratio averages file it was packed
+     from.  If it is missing or out of date, the records are packed from the
+     ratio averages file when the tables are loaded.
+  3. The file is written in the native byte order.  It is only meant to be
+     used on the machine (or same type of machine) it was written on.
+*****************************************************************************/
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "ratio_rec.h"
+
+/******************************************************************************
+MODULE:  pack_ratio_records
+
+PURPOSE:  Packs the band ratio averages into a record for each ratio grid
+cell, unscaling the values and applying the resets for the invalid ratios.
+
+RETURN VALUE:
+Type = None
+
+NOTES:
+  1. The slope and intercept are reset when the band 1 or band 2 ratio is not
+     valid, or when the standard NDWI is too small for the slope to be
+     meaningful.  These are the resets the aerosol inversion used to apply to
+     the ratio grids for each cell it used.
+******************************************************************************/
+void pack_ratio_records
+(
+    long ncells,        /* I: number of ratio cells, RATIO_NBLAT x RATIO_NBLON
+                              for the ratio grid */
+    int16 *andwi,       /* I: avg NDWI [ncells] */
+    int16 *sndwi,       /* I: standard NDWI [ncells] */
+    int16 *ratiob1,     /* I: mean band1 ratio [ncells] */
+    int16 *ratiob2,     /* I: mean band2 ratio [ncells] */
+    int16 *ratiob7,     /* I: mean band7 ratio [ncells] */
+    int16 *intratiob1,  /* I: band1 ratio [ncells] */
+    int16 *intratiob2,  /* I: band2 ratio [ncells] */
+    int16 *intratiob7,  /* I: band7 ratio [ncells] */
+    int16 *slpratiob1,  /* I: slope band1 ratio [ncells] */
+    int16 *slpratiob2,  /* I: slope band2 ratio [ncells] */
+    int16 *slpratiob7,  /* I: slope band7 ratio [ncells] */
+    Ratio_rec_t *ratio  /* O: packed ratio records [ncells] */
+)
+{
+    long i;             /* looping variable for the ratio cells */
+    float rb1;          /* band ratio 1 (unscaled) */
+    float rb2;          /* band ratio 2 (unscaled) */
+    int16 slp1, slp2, slp7;  /* slope band ratios after the resets */
+    int16 int1, int2, int7;  /* intercept band ratios after the resets */
+
+#ifdef _OPENMP
+    #pragma omp parallel for private (i, rb1, rb2, slp1, slp2, slp7, int1, int2, int7)
+#endif
+    for (i = 0; i < ncells; i++)
+    {
+        rb1 = ratiob1[i] * 0.001;  /* vs. / 1000. */
+        rb2 = ratiob2[i] * 0.001;  /* vs. / 1000. */
+        if (rb2 > 1.0 || rb1 > 1.0 || rb2 < 0.1 || rb1 < 0.1)
+        {
+            slp1 = 0;
+            slp2 = 0;
+            slp7 = 0;
+            int1 = 550;
+            int2 = 600;
+            int7 = 2000;
+        }
+        else if (sndwi[i] < 200)
+        {
+            slp1 = 0;
+            slp2 = 0;
+            slp7 = 0;
+            int1 = ratiob1[i];
+            int2 = ratiob2[i];
+            int7 = ratiob7[i];
+        }
+        else
+        {
+            slp1 = slpratiob1[i];
+            slp2 = slpratiob2[i];
+            slp7 = slpratiob7[i];
+            int1 = intratiob1[i];
+            int2 = intratiob2[i];
+            int7 = intratiob7[i];
+        }
+
+        /* Unscale the slope/intercept and the NDWI thresholds */
+        ratio[i].slpratiob1 = slp1 * 0.001;  /* vs / 1000 */
+        ratio[i].slpratiob2 = slp2 * 0.001;  /* vs / 1000 */
+        ratio[i].slpratiob7 = slp7 * 0.001;  /* vs / 1000 */
+        ratio[i].intratiob1 = int1 * 0.001;  /* vs / 1000 */
+        ratio[i].intratiob2 = int2 * 0.001;  /* vs / 1000 */
+        ratio[i].intratiob7 = int7 * 0.001;  /* vs / 1000 */
+        ratio[i].ndwi_th1 = (andwi[i] + 2.0 * sndwi[i]) * 0.001;
+        ratio[i].ndwi_th2 = (andwi[i] - 2.0 * sndwi[i]) * 0.001;
+    }
+}
+
+
+/******************************************************************************
+MODULE:  map_ratio_records
+
+PURPOSE:  Maps the packed ratio records from the packed ratio record file, if
+it is up to date with the ratio averages file.
+
+RETURN VALUE:
+Type = Ratio_rec_t *
+Value           Description
+-----           -----------
+NULL            The packed ratio record file is missing, out of date, or
+                can't be mapped
+non-NULL        Packed ratio records [RATIO_NBLAT x RATIO_NBLON]; unmap them
+                with unmap_ratio_records
+
+NOTES:
+  1. A missing file is expected, and isn't reported.  The other problems are
+     reported as warnings, since the records can still be packed from the
+     ratio averages file.
+******************************************************************************/
+Ratio_rec_t *map_ratio_records
+(
+    char *rationm,      /* I: ratio averages filename */
+    char *ratiorecnm,   /* I: packed ratio record filename */
+    size_t *map_size    /* O: size of the mapping (bytes) */
+)
+{
+    char FUNC_NAME[] = "map_ratio_records";   /* function name */
+    char errmsg[STR_SIZE];    /* error message */
+    int fd;                   /* file descriptor for the record file */
+    size_t size;              /* expected size of the record file (bytes) */
+    void *base = NULL;        /* start of the mapping */
+    Ratio_rec_header_t *header = NULL;  /* header of the record file */
+    struct stat src_stat;     /* status of the ratio averages file */
+    struct stat rec_stat;     /* status of the record file */
+
+    *map_size = 0;
+    size = sizeof (Ratio_rec_header_t) +
+        (size_t) RATIO_NBLAT * RATIO_NBLON * sizeof (Ratio_rec_t);
+
+    fd = open (ratiorecnm, O_RDONLY);
+    if (fd == -1)
+    {
+        if (errno != ENOENT)
+        {
+            sprintf (errmsg, "Unable to open the packed ratio record file %s",
+                ratiorecnm);
+            error_handler (false, FUNC_NAME, errmsg);
+        }
+        return (NULL);
+    }
+
+    if (fstat (fd, &rec_stat) == -1 || stat (rationm, &src_stat) == -1 ||
+        (size_t) rec_stat.st_size != size)
+    {
+        sprintf (errmsg, "The packed ratio record file %s doesn't have the "
+            "expected size; it will not be used", ratiorecnm);
+        error_handler (false, FUNC_NAME, errmsg);
+        close (fd);
+        return (NULL);
+    }
+
+    base = mmap (NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close (fd);
+    if (base == MAP_FAILED)
+    {
+        sprintf (errmsg, "Unable to map the packed ratio record file %s",
+            ratiorecnm);
+        error_handler (false, FUNC_NAME, errmsg);
+        return (NULL);
+    }
+
+    /* Make sure the records are the current version and were packed from
+       the current ratio averages file */
+    header = base;
+    if (memcmp (header->magic, RATIO_REC_MAGIC, sizeof (header->magic)) ||
+        header->version != RATIO_REC_VERSION ||
+        header->rec_size != sizeof (Ratio_rec_t) ||
+        header->nlat != RATIO_NBLAT || header->nlon != RATIO_NBLON ||
+        header->src_size != (int64_t) src_stat.st_size ||
+        header->src_mtime != (int64_t) src_stat.st_mtime)
+    {
+        sprintf (errmsg, "The packed ratio record file %s is out of date "
+            "with %s; rerun lasrc --pack_ratios to update it", ratiorecnm,
+            rationm);
+        error_handler (false, FUNC_NAME, errmsg);
+        munmap (base, size);
+        return (NULL);
+    }
+
+    *map_size = size;
+    return ((Ratio_rec_t *) ((char *) base + sizeof (Ratio_rec_header_t)));
+}
+
+
+/******************************************************************************
+MODULE:  unmap_ratio_records
+
+PURPOSE:  Unmaps the packed ratio records mapped by map_ratio_records.
+
+RETURN VALUE:
+Type = None
+
+NOTES:
+******************************************************************************/
+void unmap_ratio_records
+(
+    Ratio_rec_t *ratio, /* I: packed ratio records from map_ratio_records */
+    size_t map_size     /* I: size of the mapping (bytes) */
+)
+{
+    if (ratio == NULL || map_size == 0)
+        return;
+
+    munmap ((char *) ratio - sizeof (Ratio_rec_header_t), map_size);
+}
+
+
+/******************************************************************************
+MODULE:  write_ratio_records
+
+PURPOSE:  Writes the packed ratio records to the packed ratio record file.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error writing the packed ratio record file
+SUCCESS         Successful completion
+
+NOTES:
+  1. The records are written to a temporary file which is renamed when it is
+     complete, so a process mapping the file never sees a partial file.
+******************************************************************************/
+int write_ratio_records
+(
+    char *rationm,      /* I: ratio averages filename */
+    char *ratiorecnm,   /* I: packed ratio record filename */
+    Ratio_rec_t *ratio  /* I: packed ratio records
+                              [RATIO_NBLAT x RATIO_NBLON] */
+)
+{
+    char FUNC_NAME[] = "write_ratio_records";   /* function name */
+    char errmsg[STR_SIZE];    /* error message */
+    char tmpnm[STR_SIZE];     /* temporary filename for the record file */
+    size_t nrecs = (size_t) RATIO_NBLAT * RATIO_NBLON;  /* number of
+                                 records */
+    bool failed;              /* did writing the file fail? */
+    FILE *fp = NULL;          /* record file pointer */
+    Ratio_rec_header_t header;  /* header of the record file */
+    struct stat src_stat;     /* status of the ratio averages file */
+
+    if (stat (rationm, &src_stat) == -1)
+    {
+        sprintf (errmsg, "Unable to get the status of %s", rationm);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    memset (&header, 0, sizeof (header));
+    memcpy (header.magic, RATIO_REC_MAGIC, sizeof (header.magic));
+    header.version = RATIO_REC_VERSION;
+    header.rec_size = sizeof (Ratio_rec_t);
+    header.nlat = RATIO_NBLAT;
+    header.nlon = RATIO_NBLON;
+    header.src_size = src_stat.st_size;
+    header.src_mtime = src_stat.st_mtime;
+
+    snprintf (tmpnm, sizeof (tmpnm), "%s.tmp", ratiorecnm);
+    fp = fopen (tmpnm, "wb");
+    if (fp == NULL)
+    {
+        sprintf (errmsg, "Unable to open %s for writing", tmpnm);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    failed = fwrite (&header, sizeof (header), 1, fp) != 1 ||
+        fwrite (ratio, sizeof (Ratio_rec_t), nrecs, fp) != nrecs;
+    if (fclose (fp) != 0)
+        failed = true;
+    if (failed)
+    {
+        sprintf (errmsg, "Error writing the packed ratio records to %s",
+            tmpnm);
+        error_handler (true, FUNC_NAME, errmsg);
+        unlink (tmpnm);
+        return (ERROR);
+    }
+
+    if (rename (tmpnm, ratiorecnm) == -1)
+    {
+        sprintf (errmsg, "Unable to rename %s to %s", tmpnm, ratiorecnm);
+        error_handler (true, FUNC_NAME, errmsg);
+        unlink (tmpnm);
+        return (ERROR);
+    }
+
+    return (SUCCESS);
+}
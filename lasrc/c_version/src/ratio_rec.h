@@ -0,0 +1,95 @@
+#ifndef _RATIO_REC_H_
+#define _RATIO_REC_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include "common.h"
+#include "error_handler.h"
+
+/* Define the name of the packed ratio record file, which lives next to the
+   ratio averages file in the auxiliary directory */
+#define RATIO_REC_FILE "ratiomapndwiexp.rec"
+
+/* Define the number of int16 grids read from the ratio averages file (andwi,
+   sndwi, ratiob1/2/7, intratiob1/2/7, and slpratiob1/2/7) */
+#define NRATIO_GRIDS 11
+
+/* Define the identifier and version of the packed ratio record file.  The
+   version needs to be incremented whenever Ratio_rec_t or the fixups applied
+   by pack_ratio_records change, so older files are no longer used. */
+#define RATIO_REC_MAGIC "LASRCRAT"
+#define RATIO_REC_VERSION 1
+
+/* Structure for the band ratio values of a single ratio grid cell, as used by
+   the aerosol inversion.  The values are unscaled, and the slope/intercept
+   values already have the resets for invalid ratios applied. */
+typedef struct {
+    float slpratiob1;     /* slope band1 ratio */
+    float slpratiob2;     /* slope band2 ratio */
+    float slpratiob7;     /* slope band7 ratio */
+    float intratiob1;     /* intercept band1 ratio */
+    float intratiob2;     /* intercept band2 ratio */
+    float intratiob7;     /* intercept band7 ratio */
+    float ndwi_th1;       /* upper NDWI threshold (avg + 2 x standard NDWI) */
+    float ndwi_th2;       /* lower NDWI threshold (avg - 2 x standard NDWI) */
+} Ratio_rec_t;
+
+/* Structure for the header of the packed ratio record file.  The records
+   follow the header, RATIO_NBLAT x RATIO_NBLON of them in line order. */
+typedef struct {
+    char magic[8];        /* RATIO_REC_MAGIC, not null terminated */
+    int32_t version;      /* RATIO_REC_VERSION */
+    int32_t rec_size;     /* size of each record (bytes) */
+    int32_t nlat;         /* number of lines in the ratio grid */
+    int32_t nlon;         /* number of samples in the ratio grid */
+    int64_t src_size;     /* size of the ratio averages file the records
+                             were packed from (bytes) */
+    int64_t src_mtime;    /* modification time of the ratio averages file
+                             the records were packed from */
+    char pad[24];         /* pads the header to 64 bytes */
+} Ratio_rec_header_t;
+
+/* Prototypes */
+void pack_ratio_records
+(
+    long ncells,        /* I: number of ratio cells, RATIO_NBLAT x RATIO_NBLON
+                              for the ratio grid */
+    int16 *andwi,       /* I: avg NDWI [ncells] */
+    int16 *sndwi,       /* I: standard NDWI [ncells] */
+    int16 *ratiob1,     /* I: mean band1 ratio [ncells] */
+    int16 *ratiob2,     /* I: mean band2 ratio [ncells] */
+    int16 *ratiob7,     /* I: mean band7 ratio [ncells] */
+    int16 *intratiob1,  /* I: band1 ratio [ncells] */
+    int16 *intratiob2,  /* I: band2 ratio [ncells] */
+    int16 *intratiob7,  /* I: band7 ratio [ncells] */
+    int16 *slpratiob1,  /* I: slope band1 ratio [ncells] */
+    int16 *slpratiob2,  /* I: slope band2 ratio [ncells] */
+    int16 *slpratiob7,  /* I: slope band7 ratio [ncells] */
+    Ratio_rec_t *ratio  /* O: packed ratio records [ncells] */
+);
+
+Ratio_rec_t *map_ratio_records
+(
+    char *rationm,      /* I: ratio averages filename */
+    char *ratiorecnm,   /* I: packed ratio record filename */
+    size_t *map_size    /* O: size of the mapping (bytes) */
+);
+
+void unmap_ratio_records
+(
+    Ratio_rec_t *ratio, /* I: packed ratio records from map_ratio_records */
+    size_t map_size     /* I: size of the mapping (bytes) */
+);
+
+int write_ratio_records
+(
+    char *rationm,      /* I: ratio averages filename */
+    char *ratiorecnm,   /* I: packed ratio record filename */
+    Ratio_rec_t *ratio  /* I: packed ratio records
+                              [RATIO_NBLAT x RATIO_NBLON] */
+);
+
+#endif
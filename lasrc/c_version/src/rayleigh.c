@@ -0,0 +1,194 @@
+/*
+!C****************************************************************************
+
+!File: rayleigh.c
+
+!Description: Functions computing the reflectance and spherical albedo of a
+ pure molecular (Rayleigh) atmosphere for arrays of points at a time.  These
+ are C ports of the 6S routines chand and csalbr (6sV-1.0B CHAND.f and
+ CSALBR.f), which lndsr used to call from Fortran one point at a time.
+
+!Team Unique Header:
+
+ ! Design Notes:
+   1. The following public functions handle the Rayleigh computations:
+
+	chand_batch - Intrinsic reflectance of a pure molecular atmosphere.
+	csalbr_batch - Spherical albedo of a pure molecular atmosphere.
+
+   2. The math follows the Fortran line for line in single precision (the
+      6S routines use REAL throughout), so the results agree with the
+      Fortran to float rounding.
+   3. LaSRC uses chand_batch for a single point (local_chand in lut_subr.c),
+      from a copy of this file and rayleigh.h in lasrc/c_version/src.  The
+      LaSRC 'make check' fails if the copies differ from these, so changes
+      are made here (where they are checked against the Fortran) and copied
+      over.
+   4. The loops have no branches or calls other than the math library, so
+      each point is independent and the compiler is free to vectorize them.
+
+!END****************************************************************************
+*/
+
+#include <math.h>
+#include "rayleigh.h"
+
+/* Depolarization factor */
+#define XDEP (0.0279f)
+
+/* Functions */
+void chand_batch(int n, const float *phi, const float *muv, const float *mus,
+                 const float *tau_ray, float *rho_ray)
+/*
+!C******************************************************************************
+
+!Description: 'chand_batch' computes the intrinsic reflectance of a pure
+ molecular atmosphere for each of the points.
+
+!Input Parameters:
+ n            number of points
+ phi          relative azimuth between the sun and the sensor, for each point
+              (degrees)
+ muv          cosine of the view zenith angle, for each point
+ mus          cosine of the sun zenith angle, for each point
+ tau_ray      molecular optical depth, for each point
+
+!Output Parameters:
+ rho_ray      intrinsic reflectance of the molecular atmosphere (0.0 to 1.0),
+              for each point
+
+!Team Unique Header:
+
+!END****************************************************************************
+*/
+{
+  static const float as0[10] = {
+     0.33243832f, -6.777104e-02f, 0.16285370f, 1.577425e-03f, -0.30924818f,
+    -1.240906e-02f, -0.10324388f, 3.241678e-02f, 0.11493334f, -3.503695e-02f};
+  static const float as1[2] = {0.19666292f, -5.439061e-02f};
+  static const float as2[2] = {0.14545937f, -2.910845e-02f};
+  const float fac = 3.1415927f / 180.0f;
+  const float xbeta2 = 0.5f;
+  float xfd;
+  int i;
+
+  xfd = XDEP / (2.0f - XDEP);
+  xfd = (1.0f - xfd) / (1.0f + 2.0f * xfd);
+
+  for (i = 0; i < n; i++) {
+    float xmus = mus[i], xmuv = muv[i], xtau = tau_ray[i];
+    float phios, xcosf2, xcosf3;
+    float xph1, xph2, xph3, xitm, xp1, xp2, xp3;
+    float cfonc1, cfonc2, cfonc3, xlntau, fs0, fs1, fs2;
+    float pl2, pl4, pl6, pl8;
+    float xitot1, xitot2, xitot3, xrray;
+
+    phios = 180.0f - phi[i];
+    xcosf2 = cosf(phios * fac);
+    xcosf3 = cosf(2.0f * phios * fac);
+
+    xph1 = 1.0f + (3.0f * xmus * xmus - 1.0f) * (3.0f * xmuv * xmuv - 1.0f) *
+      xfd / 8.0f;
+    xph2 = -xmus * xmuv * sqrtf(1.0f - xmus * xmus) *
+      sqrtf(1.0f - xmuv * xmuv);
+    xph2 = xph2 * xfd * xbeta2 * 1.5f;
+    xph3 = (1.0f - xmus * xmus) * (1.0f - xmuv * xmuv);
+    xph3 = xph3 * xfd * xbeta2 * 0.375f;
+
+    xitm = (1.0f - expf(-xtau * (1.0f / xmus + 1.0f / xmuv))) * xmus /
+      (4.0f * (xmus + xmuv));
+    xp1 = xph1 * xitm;
+    xp2 = xph2 * xitm;
+    xp3 = xph3 * xitm;
+
+    xitm = (1.0f - expf(-xtau / xmus)) * (1.0f - expf(-xtau / xmuv));
+    cfonc1 = xph1 * xitm;
+    cfonc2 = xph2 * xitm;
+    cfonc3 = xph3 * xitm;
+
+    xlntau = logf(xtau);
+    pl2 = xmus + xmuv;
+    pl4 = xmus * xmuv;
+    pl6 = xmus * xmus + xmuv * xmuv;
+    pl8 = xmus * xmus * xmuv * xmuv;
+
+    /* Same order of the sum as the Fortran loop over pl */
+    fs0 = 0.0f;
+    fs0 += as0[0];
+    fs0 += xlntau * as0[1];
+    fs0 += pl2 * as0[2];
+    fs0 += (xlntau * pl2) * as0[3];
+    fs0 += pl4 * as0[4];
+    fs0 += (xlntau * pl4) * as0[5];
+    fs0 += pl6 * as0[6];
+    fs0 += (xlntau * pl6) * as0[7];
+    fs0 += pl8 * as0[8];
+    fs0 += (xlntau * pl8) * as0[9];
+    fs1 = as1[0] + xlntau * as1[1];
+    fs2 = as2[0] + xlntau * as2[1];
+
+    xitot1 = xp1 + cfonc1 * fs0 * xmus;
+    xitot2 = xp2 + cfonc2 * fs1 * xmus;
+    xitot3 = xp3 + cfonc3 * fs2 * xmus;
+
+    xrray = xitot1;
+    xrray = xrray + xitot2 * xcosf2 * 2.0f;
+    xrray = xrray + xitot3 * xcosf3 * 2.0f;
+    rho_ray[i] = xrray / xmus;
+  }
+}
+
+void csalbr_batch(int n, const float *tau_ray, float *s_r)
+/*
+!C******************************************************************************
+
+!Description: 'csalbr_batch' computes the spherical albedo of a pure
+ molecular atmosphere for each of the points.
+
+!Input Parameters:
+ n            number of points
+ tau_ray      molecular optical depth, for each point
+
+!Output Parameters:
+ s_r          spherical albedo of the molecular atmosphere, for each point
+
+!Team Unique Header:
+
+ ! Design Notes:
+   1. The exponential integral of the first order (fintexp1) is the
+      polynomial approximation of 6S, accurate to 2e-07 for 0 < tau_ray < 1.
+      The third order (fintexp3) is derived from it.
+
+!END****************************************************************************
+*/
+{
+  static const float a[6] = {-0.57721566f, 0.99999193f, -0.24991055f,
+    0.05519968f, -0.00976004f, 0.00107857f};
+  int i;
+
+  for (i = 0; i < n; i++) {
+    float xtau = tau_ray[i];
+    float xftau, fintexp1, fintexp3, xalb;
+
+    /* fintexp1 */
+    xftau = xtau;
+    fintexp1 = a[0];
+    fintexp1 = fintexp1 + a[1] * xftau;
+    xftau = xftau * xtau;
+    fintexp1 = fintexp1 + a[2] * xftau;
+    xftau = xftau * xtau;
+    fintexp1 = fintexp1 + a[3] * xftau;
+    xftau = xftau * xtau;
+    fintexp1 = fintexp1 + a[4] * xftau;
+    xftau = xftau * xtau;
+    fintexp1 = fintexp1 + a[5] * xftau;
+    fintexp1 = fintexp1 - logf(xtau);
+
+    /* fintexp3 */
+    fintexp3 = (expf(-xtau) * (1.0f - xtau) + xtau * xtau * fintexp1) / 2.0f;
+
+    xalb = 3.0f * xtau - fintexp3 * (4.0f + 2.0f * xtau) +
+      2.0f * expf(-xtau);
+    s_r[i] = xalb / (4.0f + 3.0f * xtau);
+  }
+}
@@ -0,0 +1,10 @@
+#ifndef RAYLEIGH_H
+#define RAYLEIGH_H
+
+/* Prototypes */
+
+void chand_batch(int n, const float *phi, const float *muv, const float *mus,
+                 const float *tau_ray, float *rho_ray);
+void csalbr_batch(int n, const float *tau_ray, float *s_r);
+
+#endif
@@ -0,0 +1,936 @@
+/*****************************************************************************
+FILE: spool.c
+
+PURPOSE: Contains functions for running LaSRC as a resident worker which
+takes jobs from a local spool directory.  The look-up tables and static
+climate modeling grids are read once when the worker starts, so the startup
+cost of each job is only reading its metadata and, if it is not already
+cached, its daily ozone/water vapor grid.
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+LICENSE TYPE:  NASA Open Source Agreement Version 1.3
+
+NOTES:
+  1. A job is submitted by creating NAME.job in the spool directory.  It
+     should be written under another name and renamed to NAME.job, so the
+     worker never sees a partial job.  The job file contains one keyword=value
+     per line, using the names of the command-line options:
+         xml=/path/to/LC08_L1TP_041027_20130630_20140312_01_T1.xml
+         aux=L8ANC2013181.hdf_fused
+         process_sr=true
+         write_toa=false
+         prefetch_depth=2
+         angle_decimation=1
+         output_format=raw
+     Only xml is required, along with aux if processing surface reflectance.
+     The other keywords default to the options the worker was started with.
+     Blank lines and lines starting with '#' are ignored.
+  2. The worker claims a job by renaming it to NAME.run, so more than one
+     worker can share a spool directory.  Jobs are claimed in the order of
+     their names.  The output of the job is written to NAME.log, and when the
+     job completes the completion record NAME.done is written and NAME.run is
+     removed.
+  3. Each job is processed in a child process forked from the worker, in the
+     directory containing its XML file.  A job which fails or crashes does not
+     affect the tables or the worker.
+  4. The worker finishes the running jobs and exits when it receives SIGINT or
+     SIGTERM, or when the file named "stop" is created in the spool
+     directory.  Jobs left as NAME.run by a worker which did not exit cleanly
+     are marked as failed when the next worker starts.
+*****************************************************************************/
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#ifdef _OPENMP
+    #include <omp.h>
+#endif
+#include "lasrc.h"
+
+/* Set by the signal handler to stop taking new jobs */
+static volatile sig_atomic_t stop_requested = 0;
+
+/******************************************************************************
+MODULE:  stop_worker
+
+PURPOSE:  Signal handler which tells the worker to finish the running jobs and
+exit.
+
+RETURN VALUE:
+Type = None
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+NOTES:
+******************************************************************************/
+static void stop_worker
+(
+    int signum            /* I: signal received */
+)
+{
+    stop_requested = 1;
+}
+
+
+/******************************************************************************
+MODULE:  spool_path
+
+PURPOSE:  Builds the pathname for a file in the spool directory.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           The pathname is too long
+SUCCESS         Successful completion
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+NOTES:
+******************************************************************************/
+static int spool_path
+(
+    char *spool_dir,      /* I: spool directory */
+    char *name,           /* I: job name */
+    char *ext,            /* I: file extension */
+    char *path            /* O: pathname of the file [STR_SIZE] */
+)
+{
+    char FUNC_NAME[] = "spool_path";   /* function name */
+    char errmsg[STR_SIZE];       /* error message */
+    int count;                   /* number of chars copied in snprintf */
+
+    count = snprintf (path, STR_SIZE, "%s/%s%s", spool_dir, name, ext);
+    if (count < 0 || count >= STR_SIZE)
+    {
+        sprintf (errmsg, "Pathname for job %.256s in the spool directory is "
+            "too long", name);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  read_job_file
+
+PURPOSE:  Reads the XML filename and options for a job from its job file.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error reading the job file; the reason is in job->message
+SUCCESS         Successful completion
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+NOTES:
+  1. The options in the job structure should be set to the worker defaults
+     before calling this routine.
+******************************************************************************/
+static int read_job_file
+(
+    char *job_file,       /* I: job file to be read */
+    Spool_job_t *job      /* I/O: job structure */
+)
+{
+    char line[3 * STR_SIZE];     /* current line in the job file */
+    char *key = NULL;            /* keyword on the current line */
+    char *value = NULL;          /* value on the current line */
+    char *cptr = NULL;           /* pointer for trimming the line */
+    int iline = 0;               /* current line number */
+    FILE *fp = NULL;             /* file pointer for the job file */
+
+    fp = fopen (job_file, "r");
+    if (fp == NULL)
+    {
+        sprintf (job->message, "Opening the job file");
+        return (ERROR);
+    }
+
+    while (fgets (line, sizeof (line), fp) != NULL)
+    {
+        iline++;
+
+        /* Trim the leading and trailing white space */
+        key = line;
+        while (*key == ' ' || *key == '\t')
+            key++;
+        cptr = key + strlen (key);
+        while (cptr > key && (cptr[-1] == '\n' || cptr[-1] == '\r' ||
+            cptr[-1] == ' ' || cptr[-1] == '\t'))
+            cptr--;
+        *cptr = '\0';
+
+        /* Skip blank lines and comments */
+        if (*key == '\0' || *key == '#')
+            continue;
+
+        value = strchr (key, '=');
+        if (value == NULL)
+        {
+            sprintf (job->message, "Line %d is not keyword=value", iline);
+            fclose (fp);
+            return (ERROR);
+        }
+        *value++ = '\0';
+
+        if (strlen (value) >= STR_SIZE)
+        {
+            sprintf (job->message, "Value for %.256s is too long", key);
+            fclose (fp);
+            return (ERROR);
+        }
+
+        if (!strcmp (key, "xml"))
+            strcpy (job->xml_infile, value);
+        else if (!strcmp (key, "aux"))
+            strcpy (job->aux_infile, value);
+        else if (!strcmp (key, "process_sr") || !strcmp (key, "write_toa"))
+        {
+            if (strcmp (value, "true") && strcmp (value, "false"))
+            {
+                sprintf (job->message, "Unknown value for %.256s: %.256s", key,
+                    value);
+                fclose (fp);
+                return (ERROR);
+            }
+            if (!strcmp (key, "process_sr"))
+                job->process_sr = !strcmp (value, "true");
+            else
+                job->write_toa = !strcmp (value, "true");
+        }
+        else if (!strcmp (key, "prefetch_depth"))
+        {
+            job->prefetch_depth = atoi (value);
+            if (job->prefetch_depth < 1 ||
+                job->prefetch_depth > MAX_PREFETCH_DEPTH)
+            {
+                sprintf (job->message, "Invalid value for prefetch_depth: "
+                    "%.256s.  Must be between 1 and %d.", value,
+                    MAX_PREFETCH_DEPTH);
+                fclose (fp);
+                return (ERROR);
+            }
+        }
+        else if (!strcmp (key, "angle_decimation"))
+        {
+            job->angle_decimation = atoi (value);
+            if (job->angle_decimation < 1 ||
+                job->angle_decimation > MAX_ANGLE_DECIMATION)
+            {
+                sprintf (job->message, "Invalid value for angle_decimation: "
+                    "%.256s.  Must be between 1 and %d.", value,
+                    MAX_ANGLE_DECIMATION);
+                fclose (fp);
+                return (ERROR);
+            }
+        }
+        else if (!strcmp (key, "output_format"))
+        {
+            if (!strcmp (value, "raw"))
+                job->output_format = FORMAT_RAW;
+            else if (!strcmp (value, "tiled"))
+                job->output_format = FORMAT_TILED;
+            else
+            {
+                sprintf (job->message, "Unknown value for output_format: "
+                    "%.256s", value);
+                fclose (fp);
+                return (ERROR);
+            }
+        }
+        else
+        {
+            sprintf (job->message, "Unknown keyword on line %d: %.256s",
+                iline, key);
+            fclose (fp);
+            return (ERROR);
+        }
+    }
+    fclose (fp);
+
+    /* Make sure the XML file and, if needed, the auxiliary file were
+       specified */
+    if (job->xml_infile[0] == '\0')
+    {
+        sprintf (job->message, "Input XML file (xml) is required");
+        return (ERROR);
+    }
+    if (job->process_sr && job->aux_infile[0] == '\0')
+    {
+        sprintf (job->message, "Input auxiliary file (aux) is required for "
+            "surface reflectance processing");
+        return (ERROR);
+    }
+
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  write_job_record
+
+PURPOSE:  Writes the completion record for a job and removes the claimed job
+file.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error writing the completion record
+SUCCESS         Successful completion
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+NOTES:
+  1. The record is written to a temporary file and renamed, so anything
+     watching for NAME.done never sees a partial record.
+******************************************************************************/
+static int write_job_record
+(
+    char *spool_dir,      /* I: spool directory */
+    Spool_job_t *job      /* I: completed job */
+)
+{
+    char FUNC_NAME[] = "write_job_record";   /* function name */
+    char errmsg[STR_SIZE];       /* error message */
+    char run_file[STR_SIZE];     /* claimed job file */
+    char done_file[STR_SIZE];    /* completion record */
+    char tmp_file[STR_SIZE];     /* temporary completion record */
+    char log_file[STR_SIZE];     /* output of the job */
+    FILE *fp = NULL;             /* file pointer for the completion record */
+
+    if (spool_path (spool_dir, job->name, SPOOL_RUN_EXT, run_file) != SUCCESS ||
+        spool_path (spool_dir, job->name, SPOOL_DONE_EXT, done_file) !=
+        SUCCESS ||
+        spool_path (spool_dir, job->name, SPOOL_DONE_EXT ".tmp", tmp_file) !=
+        SUCCESS ||
+        spool_path (spool_dir, job->name, SPOOL_LOG_EXT, log_file) != SUCCESS)
+    {
+        sprintf (errmsg, "Building the completion record name for job %.256s",
+            job->name);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    fp = fopen (tmp_file, "w");
+    if (fp == NULL)
+    {
+        sprintf (errmsg, "Opening the completion record: %s", tmp_file);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    fprintf (fp, "job=%s\n", job->name);
+    fprintf (fp, "xml=%s\n", job->xml_infile);
+    fprintf (fp, "aux=%s\n", job->aux_infile);
+    fprintf (fp, "status=%s\n", job->status == SUCCESS ? "success" : "failed");
+    if (job->status != SUCCESS)
+        fprintf (fp, "message=%s\n", job->message);
+    fprintf (fp, "start_time=%.3f\n", job->start_time);
+    fprintf (fp, "end_time=%.3f\n", job->end_time);
+    fprintf (fp, "elapsed_seconds=%.3f\n", job->end_time - job->start_time);
+    fprintf (fp, "log=%s\n", log_file);
+
+    if (fclose (fp) != 0 || rename (tmp_file, done_file) != 0)
+    {
+        sprintf (errmsg, "Writing the completion record: %s", done_file);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    unlink (run_file);
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  spool_filter
+
+PURPOSE:  Selects the files in the spool directory with the specified
+extension, for scandir.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+0               The file does not have the extension
+1               The file has the extension
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+NOTES:
+  1. The extension is passed through a static variable since scandir does not
+     pass any user data to the filter.
+******************************************************************************/
+static const char *filter_ext = NULL;
+
+static int spool_filter
+(
+    const struct dirent *entry   /* I: directory entry */
+)
+{
+    size_t len = strlen (entry->d_name);   /* length of the filename */
+    size_t ext_len = strlen (filter_ext);  /* length of the extension */
+
+    return (len > ext_len && len - ext_len < STR_SIZE - 16 &&
+        !strcmp (entry->d_name + len - ext_len, filter_ext));
+}
+
+
+/******************************************************************************
+MODULE:  list_spool
+
+PURPOSE:  Lists the files in the spool directory with the specified extension,
+sorted by name.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+-1              Error reading the spool directory
+nfiles          Number of files in the list
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+NOTES:
+  1. The list and its entries are allocated by scandir, so it is up to the
+     calling routine to free them.
+******************************************************************************/
+static int list_spool
+(
+    char *spool_dir,      /* I: spool directory */
+    const char *ext,      /* I: file extension to look for */
+    struct dirent ***files   /* O: list of files */
+)
+{
+    filter_ext = ext;
+    return (scandir (spool_dir, files, spool_filter, alphasort));
+}
+
+
+/******************************************************************************
+MODULE:  recover_stale_jobs
+
+PURPOSE:  Marks the jobs claimed by a worker which did not exit cleanly as
+failed.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error reading the spool directory
+SUCCESS         Successful completion
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+NOTES:
+  1. This must only be run when no other worker is using the spool directory,
+     since it can't tell whether another worker is still running the job.
+******************************************************************************/
+static int recover_stale_jobs
+(
+    char *spool_dir       /* I: spool directory */
+)
+{
+    char FUNC_NAME[] = "recover_stale_jobs";   /* function name */
+    char errmsg[STR_SIZE];       /* error message */
+    int i;                       /* looping variable for files */
+    int nfiles;                  /* number of claimed job files */
+    struct dirent **files = NULL;   /* claimed job files */
+    Spool_job_t job;             /* stale job */
+
+    nfiles = list_spool (spool_dir, SPOOL_RUN_EXT, &files);
+    if (nfiles < 0)
+    {
+        sprintf (errmsg, "Reading the spool directory: %s", spool_dir);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    for (i = 0; i < nfiles; i++)
+    {
+        memset (&job, 0, sizeof (job));
+        strcpy (job.name, files[i]->d_name);
+        job.name[strlen (job.name) - strlen (SPOOL_RUN_EXT)] = '\0';
+        job.status = ERROR;
+        sprintf (job.message, "The worker stopped before the job completed");
+        job.start_time = job.end_time = get_time ();
+
+        sprintf (errmsg, "Marking the stale job %s as failed", job.name);
+        error_handler (false, FUNC_NAME, errmsg);
+        write_job_record (spool_dir, &job);
+        free (files[i]);
+    }
+    free (files);
+
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  claim_next_job
+
+PURPOSE:  Claims the next job in the spool directory and reads its job file.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error reading the spool directory
+SUCCESS         Successful completion; *found tells whether a job was claimed
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+NOTES:
+  1. A job whose job file can't be read is claimed and returned with a status
+     of ERROR, so its completion record can be written.
+******************************************************************************/
+static int claim_next_job
+(
+    char *spool_dir,      /* I: spool directory */
+    Spool_job_t *job,     /* I/O: job structure, with the options set to the
+                                  worker defaults on input */
+    bool *found           /* O: was a job claimed? */
+)
+{
+    char FUNC_NAME[] = "claim_next_job";   /* function name */
+    char errmsg[STR_SIZE];       /* error message */
+    char job_file[STR_SIZE];     /* submitted job file */
+    char run_file[STR_SIZE];     /* claimed job file */
+    int i;                       /* looping variable for files */
+    int nfiles;                  /* number of submitted job files */
+    struct dirent **files = NULL;   /* submitted job files */
+
+    *found = false;
+    nfiles = list_spool (spool_dir, SPOOL_JOB_EXT, &files);
+    if (nfiles < 0)
+    {
+        sprintf (errmsg, "Reading the spool directory: %s", spool_dir);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    for (i = 0; i < nfiles && !*found; i++)
+    {
+        strcpy (job->name, files[i]->d_name);
+        job->name[strlen (job->name) - strlen (SPOOL_JOB_EXT)] = '\0';
+        if (spool_path (spool_dir, job->name, SPOOL_JOB_EXT, job_file) !=
+            SUCCESS ||
+            spool_path (spool_dir, job->name, SPOOL_RUN_EXT, run_file) !=
+            SUCCESS)
+            continue;
+
+        /* Another worker may have claimed the job first */
+        if (rename (job_file, run_file) != 0)
+            continue;
+
+        *found = true;
+        job->start_time = get_time ();
+        job->status = read_job_file (run_file, job);
+    }
+
+    for (i = 0; i < nfiles; i++)
+        free (files[i]);
+    free (files);
+
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  run_job_process
+
+PURPOSE:  Processes a job in the child process forked by the worker.  This
+routine does not return.
+
+RETURN VALUE:
+Type = None
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+NOTES:
+  1. The exit status of the process is EXIT_SUCCESS if the job was processed
+     successfully and EXIT_FAILURE otherwise.
+******************************************************************************/
+static void run_job_process
+(
+    char *spool_dir,      /* I: spool directory */
+    Spool_job_t *job,     /* I: job to be processed */
+    Sr_tables_t *tables,  /* I: static tables and auxiliary cache */
+    int concurrency,      /* I: number of jobs processed at once */
+    bool numa,            /* I: place the threads and scene arrays on the
+                                NUMA nodes */
+    bool verbose          /* I: verbose flag for printing messages */
+)
+{
+    char log_file[STR_SIZE];     /* output of the job */
+    char xml_basename[STR_SIZE]; /* XML filename without the path */
+    int retval;                  /* return status */
+    Espa_internal_meta_t xml_metadata;  /* XML metadata structure */
+
+    /* Only the worker handles the stop signals */
+    signal (SIGINT, SIG_DFL);
+    signal (SIGTERM, SIG_DFL);
+
+    /* Send the output of the job to its log file */
+    if (spool_path (spool_dir, job->name, SPOOL_LOG_EXT, log_file) !=
+        SUCCESS || freopen (log_file, "w", stdout) == NULL ||
+        dup2 (fileno (stdout), fileno (stderr)) < 0)
+        _exit (EXIT_FAILURE);
+
+    /* Share the OpenMP threads between the jobs running at the same time */
+#ifdef _OPENMP
+    omp_set_num_threads (MAX (1, omp_get_num_procs () / concurrency));
+#endif
+    if (numa && concurrency == 1)
+        pin_threads ();
+
+    printf ("Starting job %s: %s\n", job->name, job->xml_infile);
+    retval = enter_scene_dir (job->xml_infile, xml_basename);
+
+    /* Validate and parse the input metadata file */
+    if (retval == SUCCESS)
+        retval = validate_xml_file (xml_basename);
+    if (retval == SUCCESS)
+    {
+        init_metadata_struct (&xml_metadata);
+        retval = parse_metadata (xml_basename, &xml_metadata);
+    }
+
+    if (retval == SUCCESS)
+        retval = process_scene (xml_basename, &xml_metadata, tables, job->aux,
+            job->process_sr, job->write_toa, job->prefetch_depth,
+            job->angle_decimation, job->output_format, 0, NULL, 1, false,
+            numa, verbose);
+
+    if (retval == SUCCESS)
+        printf ("Job %s complete.\n", job->name);
+    fflush (stdout);
+    fflush (stderr);
+    _exit (retval == SUCCESS ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+
+/******************************************************************************
+MODULE:  finish_job
+
+PURPOSE:  Records the completion of a job process and writes its completion
+record.
+
+RETURN VALUE:
+Type = bool
+Value           Description
+-----           -----------
+false           The process was not one of the running jobs
+true            The job was completed
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+NOTES:
+******************************************************************************/
+static bool finish_job
+(
+    char *spool_dir,      /* I: spool directory */
+    Spool_job_t *jobs,    /* I/O: running jobs */
+    int concurrency,      /* I: number of entries in jobs */
+    Sr_tables_t *tables,  /* I: static tables and auxiliary cache */
+    pid_t pid,            /* I: process ID which completed */
+    int status            /* I: exit status of the process */
+)
+{
+    int i;                       /* looping variable for jobs */
+    Spool_job_t *job = NULL;     /* job which completed */
+
+    for (i = 0; i < concurrency; i++)
+    {
+        if (jobs[i].pid == pid)
+            break;
+    }
+    if (i == concurrency)
+        return (false);
+
+    job = &jobs[i];
+    job->end_time = get_time ();
+    job->pid = 0;
+    if (WIFEXITED (status) && WEXITSTATUS (status) == EXIT_SUCCESS)
+        job->status = SUCCESS;
+    else
+    {
+        job->status = ERROR;
+        if (WIFSIGNALED (status))
+            sprintf (job->message, "Terminated by signal %d",
+                WTERMSIG (status));
+        else
+            sprintf (job->message, "Processing failed; see the log file");
+    }
+
+    printf ("Job %s %s in %.2f seconds\n", job->name,
+        job->status == SUCCESS ? "completed" : "failed",
+        job->end_time - job->start_time);
+    fflush (stdout);
+
+    release_aux_grid (tables, job->aux);
+    job->aux = NULL;
+    write_job_record (spool_dir, job);
+
+    return (true);
+}
+
+
+/******************************************************************************
+MODULE:  run_spool_worker
+
+PURPOSE:  Reads the look-up tables and static auxiliary data once, then
+processes the jobs submitted to the spool directory until told to stop.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error setting up the worker or reading the spool directory
+SUCCESS         The worker was stopped
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+NOTES:
+  1. A job which fails does not stop the worker.  The status of each job is
+     in its completion record.
+******************************************************************************/
+int run_spool_worker
+(
+    char *spool_dir,      /* I: spool directory to take the jobs from */
+    bool process_sr,      /* I: read the tables for surface reflectance; if
+                                false, only TOA jobs can be processed */
+    bool write_toa,       /* I: default write intermediate TOA products flag
+                                for the jobs */
+    int prefetch_depth,   /* I: default number of input bands to read ahead
+                                for the jobs */
+    int angle_decimation, /* I: default number of lines/samples between the
+                                per-pixel angles held in memory for the
+                                jobs */
+    Myformat_t output_format,  /* I: default file format for the output
+                                     bands of the jobs */
+    int concurrency,      /* I: number of jobs to process at once */
+    bool numa,            /* I: place the threads and scene arrays on the
+                                NUMA nodes */
+    bool verbose          /* I: verbose flag for printing messages */
+)
+{
+    char FUNC_NAME[] = "run_spool_worker";   /* function name */
+    char errmsg[STR_SIZE];       /* error message */
+    char stop_file[STR_SIZE];    /* file which tells the worker to stop */
+    int i;                       /* looping variable for jobs */
+    int status;                  /* exit status of a job process */
+    int retval = SUCCESS;        /* return status */
+    int nrunning = 0;            /* number of jobs being processed */
+    int nstarted;                /* number of jobs started on this pass */
+    bool found;                  /* was a job claimed? */
+    pid_t pid;                   /* process ID of a completed job */
+    struct stat statbuf;         /* buffer for the file stat function */
+    struct sigaction action;     /* handler for the stop signals */
+    Spool_job_t *jobs = NULL;    /* running jobs, one per concurrent job */
+    Spool_job_t *job = NULL;     /* current job */
+    Sr_tables_t *tables = NULL;  /* static look-up tables and climate
+                                    modeling grids */
+
+    /* Make sure the spool directory exists */
+    if (stat (spool_dir, &statbuf) == -1 || !S_ISDIR (statbuf.st_mode))
+    {
+        sprintf (errmsg, "Spool directory does not exist: %s", spool_dir);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+    if (spool_path (spool_dir, SPOOL_STOP_FILE, "", stop_file) != SUCCESS)
+        return (ERROR);
+
+    jobs = calloc (concurrency, sizeof (Spool_job_t));
+    if (jobs == NULL)
+    {
+        sprintf (errmsg, "Error allocating memory for the jobs");
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    /* Read the look-up tables and static auxiliary data once for all the
+       jobs.  Each running job holds one daily auxiliary grid, and one more
+       can be read for the next job while they run. */
+    if (process_sr)
+    {
+        tables = load_sr_tables (concurrency + 1);
+        if (tables == NULL)
+        {
+            sprintf (errmsg, "Reading the look-up tables and auxiliary data");
+            error_handler (true, FUNC_NAME, errmsg);
+            free (jobs);
+            return (ERROR);
+        }
+    }
+
+    /* Fail any jobs left over from a worker which did not exit cleanly */
+    if (recover_stale_jobs (spool_dir) != SUCCESS)
+    {
+        free_sr_tables (tables);
+        free (jobs);
+        return (ERROR);
+    }
+
+    /* Stop taking jobs on SIGINT or SIGTERM.  SA_RESTART is not used so the
+       signal interrupts the wait between polls. */
+    memset (&action, 0, sizeof (action));
+    action.sa_handler = stop_worker;
+    sigemptyset (&action.sa_mask);
+    sigaction (SIGINT, &action, NULL);
+    sigaction (SIGTERM, &action, NULL);
+
+    printf ("LaSRC worker waiting for jobs in %s ...\n", spool_dir);
+    fflush (stdout);
+
+    while (1)
+    {
+        /* Record the jobs which have completed */
+        while ((pid = waitpid (-1, &status, WNOHANG)) > 0)
+        {
+            if (finish_job (spool_dir, jobs, concurrency, tables, pid, status))
+                nrunning--;
+        }
+
+        /* Check if the worker should stop */
+        if (!stop_requested && access (stop_file, F_OK) == 0)
+        {
+            unlink (stop_file);
+            stop_requested = 1;
+        }
+        if (stop_requested)
+            break;
+
+        /* Start as many jobs as there is room for */
+        nstarted = 0;
+        while (nrunning < concurrency)
+        {
+            for (i = 0; i < concurrency; i++)
+            {
+                if (jobs[i].pid == 0)
+                    break;
+            }
+            job = &jobs[i];
+
+            memset (job, 0, sizeof (Spool_job_t));
+            job->process_sr = process_sr;
+            job->write_toa = write_toa;
+            job->prefetch_depth = prefetch_depth;
+            job->angle_decimation = angle_decimation;
+            job->output_format = output_format;
+            if (claim_next_job (spool_dir, job, &found) != SUCCESS)
+            {
+                retval = ERROR;
+                stop_requested = 1;
+                break;
+            }
+            if (!found)
+                break;
+            nstarted++;
+
+            if (job->status == SUCCESS && job->process_sr && tables == NULL)
+            {
+                job->status = ERROR;
+                sprintf (job->message, "Surface reflectance jobs can't be "
+                    "processed by a worker started with --process_sr=false");
+            }
+
+            /* Get the daily auxiliary grid, from the cache if possible */
+            if (job->status == SUCCESS && job->process_sr)
+            {
+                job->aux = get_aux_grid (tables, job->aux_infile);
+                if (job->aux == NULL)
+                {
+                    job->status = ERROR;
+                    sprintf (job->message, "Reading the ozone and water vapor "
+                        "auxiliary data");
+                }
+            }
+
+            if (job->status == SUCCESS)
+            {
+                fflush (stdout);
+                fflush (stderr);
+                job->pid = fork ();
+                if (job->pid == 0)
+                    run_job_process (spool_dir, job, tables, concurrency,
+                        numa, verbose);
+                if (job->pid < 0)
+                {
+                    job->pid = 0;
+                    job->status = ERROR;
+                    sprintf (job->message, "Starting the job process");
+                    release_aux_grid (tables, job->aux);
+                    job->aux = NULL;
+                }
+            }
+
+            if (job->status != SUCCESS)
+            {
+                /* The job never started */
+                job->end_time = get_time ();
+                sprintf (errmsg, "Job %s failed: %s", job->name, job->message);
+                error_handler (true, FUNC_NAME, errmsg);
+                write_job_record (spool_dir, job);
+                continue;
+            }
+
+            if (verbose)
+                printf ("Started job %s: %s\n", job->name, job->xml_infile);
+            nrunning++;
+        }
+
+        /* Wait before checking the spool again if it is idle */
+        if (nstarted == 0 && !stop_requested)
+            sleep (SPOOL_POLL_SECONDS);
+    }
+
+    /* Finish the running jobs */
+    printf ("Stopping the LaSRC worker after %d running jobs ...\n", nrunning);
+    fflush (stdout);
+    while (nrunning > 0)
+    {
+        pid = waitpid (-1, &status, 0);
+        if (pid < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        if (finish_job (spool_dir, jobs, concurrency, tables, pid, status))
+            nrunning--;
+    }
+
+    if (tables != NULL)
+    {
+        printf ("Daily auxiliary files read: %d for %ld jobs\n",
+            tables->nloads, tables->nrequests);
+    }
+    printf ("LaSRC worker stopped.\n");
+
+    free_sr_tables (tables);
+    free (jobs);
+    return (retval);
+}
@@ -0,0 +1,72 @@
+#ifndef _SPOOL_H_
+#define _SPOOL_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <sys/types.h>
+#include "common.h"
+#include "output.h"
+#include "sr_tables.h"
+#include "error_handler.h"
+
+/* Define the file extensions used in the spool directory.  A job is
+   submitted as NAME.job, renamed to NAME.run when the worker claims it, and
+   NAME.done is written when it completes.  The output of the job is written
+   to NAME.log. */
+#define SPOOL_JOB_EXT ".job"
+#define SPOOL_RUN_EXT ".run"
+#define SPOOL_DONE_EXT ".done"
+#define SPOOL_LOG_EXT ".log"
+
+/* Define the name of the file which, when created in the spool directory,
+   tells the worker to finish the running jobs and exit */
+#define SPOOL_STOP_FILE "stop"
+
+/* Define the number of seconds to wait between checks of an idle spool */
+#define SPOOL_POLL_SECONDS 1
+
+/* Structure for a job in the spool directory */
+typedef struct {
+    char name[STR_SIZE];        /* job name (job filename without the
+                                   extension) */
+    char xml_infile[STR_SIZE];  /* input XML filename */
+    char aux_infile[STR_SIZE];  /* input auxiliary filename for water vapor
+                                   and ozone */
+    bool process_sr;      /* process the surface reflectance products */
+    bool write_toa;       /* write intermediate TOA products flag */
+    int prefetch_depth;   /* number of input bands to read ahead */
+    int angle_decimation; /* number of lines/samples between the per-pixel
+                             angles held in memory */
+    Myformat_t output_format;   /* file format for the output bands */
+    Aux_grid_t *aux;      /* ozone and water vapor grid for the job */
+    pid_t pid;            /* process ID for the job; 0 if not running */
+    double start_time;    /* time the job was started (seconds) */
+    double end_time;      /* time the job completed (seconds) */
+    int status;           /* SUCCESS or ERROR for the job */
+    char message[STR_SIZE];     /* reason the job failed */
+} Spool_job_t;
+
+/* Prototypes */
+int run_spool_worker
+(
+    char *spool_dir,      /* I: spool directory to take the jobs from */
+    bool process_sr,      /* I: read the tables for surface reflectance; if
+                                false, only TOA jobs can be processed */
+    bool write_toa,       /* I: default write intermediate TOA products flag
+                                for the jobs */
+    int prefetch_depth,   /* I: default number of input bands to read ahead
+                                for the jobs */
+    int angle_decimation, /* I: default number of lines/samples between the
+                                per-pixel angles held in memory for the
+                                jobs */
+    Myformat_t output_format,  /* I: default file format for the output
+                                     bands of the jobs */
+    int concurrency,      /* I: number of jobs to process at once */
+    bool numa,            /* I: place the threads and scene arrays on the
+                                NUMA nodes */
+    bool verbose          /* I: verbose flag for printing messages */
+);
+
+#endif
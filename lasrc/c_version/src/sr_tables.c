@@ -0,0 +1,527 @@
+/*****************************************************************************
+FILE: sr_tables.c
+
+PURPOSE: Contains functions for loading the static look-up tables and climate
+modeling grids used by the surface reflectance corrections, and for caching
+the daily ozone/water vapor auxiliary grids by filename.  The static tables
+are read once and shared by every scene processed, and scenes from the same
+day share a single copy of the daily auxiliary grid.
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+LICENSE TYPE:  NASA Open Source Agreement Version 1.3
+
+NOTES:
+  1. The band ratio averages are held as packed records, with the resets for
+     invalid ratio cells already applied (see ratio_rec.c).  They are never
+     modified, so they remain valid for the next scene.
+  2. The tables are read by the HDF library, which is not thread-safe.  Scenes
+     which share the tables concurrently are expected to run in separate
+     processes (see batch.c) rather than separate threads.
+  3. When the daily auxiliary grid comes from the tiled auxiliary file, the
+     cache only holds the open file.  The tiles covering a scene are read by
+     the scene's own process (see load_scene_aux), so they aren't shared with
+     later scenes in batch mode.  That costs a few small tile reads per scene.
+*****************************************************************************/
+#include <sys/stat.h>
+#include "sr_tables.h"
+
+/******************************************************************************
+MODULE:  check_aux_file
+
+PURPOSE:  Makes sure the specified auxiliary file exists.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           The file does not exist
+SUCCESS         The file exists
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+NOTES:
+******************************************************************************/
+static int check_aux_file
+(
+    char *descr,          /* I: description of the file for error messages */
+    char *file_name       /* I: name of the file to check */
+)
+{
+    char FUNC_NAME[] = "check_aux_file";   /* function name */
+    char errmsg[STR_SIZE];       /* error message */
+    struct stat statbuf;         /* buffer for the file stat function */
+
+    if (stat (file_name, &statbuf) == -1)
+    {
+        sprintf (errmsg, "Could not find %s data file: %s\n  Check "
+            "L8_AUX_DIR environment variable.", descr, file_name);
+        error_handler (false, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  load_sr_tables
+
+PURPOSE:  Reads the look-up tables, CMG DEM, and ratio averages needed for
+the surface reflectance corrections and sets up an empty cache for the daily
+auxiliary grids.
+
+RETURN VALUE:
+Type = Sr_tables_t *
+Value           Description
+-----           -----------
+NULL            Error reading the tables
+non-NULL        Successful completion
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+NOTES:
+  1. The auxiliary products are found via the L8_AUX_DIR environment variable.
+     If it isn't defined, then the products are assumed to be in the local
+     directory.
+******************************************************************************/
+Sr_tables_t *load_sr_tables
+(
+    int naux              /* I: number of daily auxiliary grids to cache */
+)
+{
+    char FUNC_NAME[] = "load_sr_tables";   /* function name */
+    char errmsg[STR_SIZE];       /* error message */
+    char *aux_path = NULL;       /* path for Landsat auxiliary data */
+    char anglehdf[STR_SIZE];     /* angle HDF filename */
+    char intrefnm[STR_SIZE];     /* intrinsic reflectance filename */
+    char transmnm[STR_SIZE];     /* transmission filename */
+    char spheranm[STR_SIZE];     /* spherical albedo filename */
+    char cmgdemnm[STR_SIZE];     /* climate modeling grid DEM filename */
+    char rationm[STR_SIZE];      /* ratio averages filename */
+    char ratiorecnm[STR_SIZE];   /* packed ratio record filename */
+    int retval;                  /* return status */
+    Sr_tables_t *this = NULL;    /* tables structure to be returned */
+
+    /* Get the path for the auxiliary products from the L8_AUX_DIR
+       environment variable.  If it isn't defined, then assume the products
+       are in the local directory. */
+    aux_path = getenv ("L8_AUX_DIR");
+    if (aux_path == NULL)
+    {
+        aux_path = ".";
+        sprintf (errmsg, "L8_AUX_DIR environment variable isn't defined. "
+            "It is assumed the auxiliary products will be available from "
+            "the local directory.");
+        error_handler (false, FUNC_NAME, errmsg);
+    }
+
+    /* Set up the look-up table files and make sure they exist */
+    sprintf (anglehdf, "%s/LDCMLUT/ANGLE_NEW.hdf", aux_path);
+    sprintf (intrefnm, "%s/LDCMLUT/RES_LUT_V3.0-URBANCLEAN-V2.0.hdf",
+        aux_path);
+    sprintf (transmnm, "%s/LDCMLUT/TRANS_LUT_V3.0-URBANCLEAN-V2.0.ASCII",
+        aux_path);
+    sprintf (spheranm, "%s/LDCMLUT/AERO_LUT_V3.0-URBANCLEAN-V2.0.ASCII",
+        aux_path);
+    sprintf (cmgdemnm, "%s/CMGDEM.hdf", aux_path);
+    sprintf (rationm, "%s/ratiomapndwiexp.hdf", aux_path);
+    sprintf (ratiorecnm, "%s/%s", aux_path, RATIO_REC_FILE);
+
+    if (check_aux_file ("anglehdf", anglehdf) != SUCCESS ||
+        check_aux_file ("intrefnm", intrefnm) != SUCCESS ||
+        check_aux_file ("transmnm", transmnm) != SUCCESS ||
+        check_aux_file ("spheranm", spheranm) != SUCCESS ||
+        check_aux_file ("cmgdemnm", cmgdemnm) != SUCCESS ||
+        check_aux_file ("rationm", rationm) != SUCCESS)
+    {  /* Error messages already written */
+        return (NULL);
+    }
+
+    /* Allocate the tables structure and the auxiliary cache */
+    this = calloc (1, sizeof (Sr_tables_t));
+    if (this == NULL)
+    {
+        sprintf (errmsg, "Error allocating memory for the tables structure");
+        error_handler (true, FUNC_NAME, errmsg);
+        return (NULL);
+    }
+    strcpy (this->aux_path, aux_path);
+    strcpy (this->table_files[SR_ANGLE_FILE], anglehdf);
+    strcpy (this->table_files[SR_INTREF_FILE], intrefnm);
+    strcpy (this->table_files[SR_TRANSM_FILE], transmnm);
+    strcpy (this->table_files[SR_SPHERA_FILE], spheranm);
+    strcpy (this->table_files[SR_CMGDEM_FILE], cmgdemnm);
+    strcpy (this->table_files[SR_RATIO_FILE], rationm);
+    strcpy (this->table_files[SR_RATIOREC_FILE], ratiorecnm);
+
+    this->naux = MAX (naux, MIN_AUX_CACHE);
+    this->aux = calloc (this->naux, sizeof (Aux_grid_t));
+    if (this->aux == NULL)
+    {
+        sprintf (errmsg, "Error allocating memory for the auxiliary cache");
+        error_handler (true, FUNC_NAME, errmsg);
+        free_sr_tables (this);
+        return (NULL);
+    }
+    this->nrequests = 0;
+    this->nloads = 0;
+
+    /* Allocate memory for the static tables */
+    retval = memory_allocation_tables (&this->dem, &this->rolutt,
+        &this->transt, &this->sphalbt, &this->normext, &this->tsmax,
+        &this->tsmin, &this->nbfic, &this->nbfi, &this->ttv);
+    if (retval != SUCCESS)
+    {
+        sprintf (errmsg, "Error allocating memory for the look-up tables and "
+            "climate modeling grids.");
+        error_handler (false, FUNC_NAME, errmsg);
+        free_sr_tables (this);
+        return (NULL);
+    }
+
+    /* Read the look-up tables */
+    this->xtsmin = 0;
+    this->xtsstep = 4.0;
+    retval = readluts (this->tsmax, this->tsmin, this->ttv, this->tts,
+        this->nbfic, this->nbfi, this->indts, this->rolutt, this->transt,
+        this->sphalbt, this->normext, this->xtsstep, this->xtsmin, anglehdf,
+        intrefnm, transmnm, spheranm);
+    if (retval != SUCCESS)
+    {
+        sprintf (errmsg, "Reading the LUTs");
+        error_handler (true, FUNC_NAME, errmsg);
+        free_sr_tables (this);
+        return (NULL);
+    }
+    printf ("The LUTs for urban clean case v2.0 have been read.  We can "
+        "now perform atmospheric correction.\n");
+
+    /* Read the static auxiliary data files used as input to the reflectance
+       calculations */
+    retval = read_auxiliary_files (cmgdemnm, rationm, ratiorecnm, this->dem,
+        &this->ratio, &this->ratio_map_size);
+    if (retval != SUCCESS)
+    {
+        sprintf (errmsg, "Reading the auxiliary files");
+        error_handler (true, FUNC_NAME, errmsg);
+        free_sr_tables (this);
+        return (NULL);
+    }
+
+    return (this);
+}
+
+
+/******************************************************************************
+MODULE:  get_aux_grid
+
+PURPOSE:  Returns the daily ozone/water vapor grid for the specified auxiliary
+file, reading it only if it isn't already in the cache.
+
+RETURN VALUE:
+Type = Aux_grid_t *
+Value           Description
+-----           -----------
+NULL            Error finding or reading the auxiliary file
+non-NULL        Successful completion
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+NOTES:
+  1. The auxiliary file is expected in $L8_AUX_DIR/LADS/<year>, where the year
+     comes from the auxiliary filename (L8ANCyyyyddd.hdf_fused).
+  2. The grid stays in the cache until it is released by every scene using it
+     and another auxiliary file needs its cache entry (least recently used).
+  3. Each call must be paired with a call to release_aux_grid.
+  4. If the tiled auxiliary file (L8ANCyyyyddd.aux_tiles) is next to the HDF
+     file, or in its place, it is used instead of the HDF file.  Only its
+     header and tile index are read here.  The tiles covering the scene are
+     read by load_scene_aux.
+******************************************************************************/
+Aux_grid_t *get_aux_grid
+(
+    Sr_tables_t *this,    /* I: static tables and auxiliary cache */
+    char *aux_infile      /* I: input auxiliary filename for water vapor and
+                                ozone (no path) */
+)
+{
+    char FUNC_NAME[] = "get_aux_grid";   /* function name */
+    char errmsg[STR_SIZE];       /* error message */
+    char aux_year[5];            /* string to contain the year of the
+                                    auxiliary file */
+    char auxnm[STR_SIZE];        /* auxiliary filename for ozone and water
+                                    vapor */
+    char tilesnm[STR_SIZE];      /* tiled auxiliary filename */
+    char *ext = NULL;            /* extension of the auxiliary filename */
+    int i;                       /* looping variable for cache entries */
+    bool use_tiles;              /* is the tiled auxiliary file available? */
+    struct stat statbuf;         /* buffer for the file stat function */
+    Aux_grid_t *grid = NULL;     /* cache entry for this auxiliary file */
+
+    /* Grab the year of the auxiliary input file to be used for the correct
+       location of the auxiliary file in the auxiliary directory */
+    if (strlen (aux_infile) < 9)
+    {
+        sprintf (errmsg, "Invalid auxiliary filename: %s", aux_infile);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (NULL);
+    }
+    strncpy (aux_year, &aux_infile[5], 4);
+    aux_year[4] = '\0';
+    sprintf (auxnm, "%s/LADS/%s/%s", this->aux_path, aux_year, aux_infile);
+    this->nrequests++;
+
+    /* Use the cached grid if this auxiliary file has already been read */
+    for (i = 0; i < this->naux; i++)
+    {
+        if (!strcmp (this->aux[i].auxnm, auxnm))
+        {
+            this->aux[i].nusers++;
+            this->aux[i].last_used = this->nrequests;
+            return (&this->aux[i]);
+        }
+    }
+
+    /* Use the tiled auxiliary file if it has been written, otherwise the
+       HDF file */
+    strcpy (tilesnm, auxnm);
+    ext = strrchr (tilesnm, '.');
+    if (ext != NULL && strchr (ext, '/') == NULL)
+        *ext = '\0';
+    strcat (tilesnm, AUX_TILES_EXTENSION);
+    use_tiles = stat (tilesnm, &statbuf) == 0;
+    if (!use_tiles && check_aux_file ("auxnm", auxnm) != SUCCESS)
+    {  /* Error message already written */
+        return (NULL);
+    }
+
+    /* Otherwise use an empty cache entry, or the least recently used entry
+       which isn't being used by any scenes */
+    for (i = 0; i < this->naux; i++)
+    {
+        if (this->aux[i].nusers > 0)
+            continue;
+        if (this->aux[i].auxnm[0] == '\0')
+        {
+            grid = &this->aux[i];
+            break;
+        }
+        if (grid == NULL || this->aux[i].last_used < grid->last_used)
+            grid = &this->aux[i];
+    }
+
+    if (grid == NULL)
+    {
+        sprintf (errmsg, "All %d auxiliary cache entries are in use",
+            this->naux);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (NULL);
+    }
+
+    /* Allocate the grid the first time this cache entry is used */
+    if (grid->wv == NULL)
+    {
+        grid->wv = calloc (CMG_NBLAT * CMG_NBLON, sizeof (uint16));
+        if (grid->wv == NULL)
+        {
+            sprintf (errmsg, "Error allocating memory for the wv");
+            error_handler (true, FUNC_NAME, errmsg);
+            return (NULL);
+        }
+    }
+
+    if (grid->oz == NULL)
+    {
+        grid->oz = calloc (CMG_NBLAT * CMG_NBLON, sizeof (uint8));
+        if (grid->oz == NULL)
+        {
+            sprintf (errmsg, "Error allocating memory for the oz");
+            error_handler (true, FUNC_NAME, errmsg);
+            return (NULL);
+        }
+    }
+
+    /* Open the tiled auxiliary file, or read ozone and water vapor from the
+       HDF auxiliary file */
+    grid->auxnm[0] = '\0';
+    close_aux_tiles (grid->tiles);
+    grid->tiles = NULL;
+    if (use_tiles)
+    {
+        grid->tiles = open_aux_tiles (tilesnm);
+        if (grid->tiles == NULL)
+        {
+            sprintf (errmsg, "Opening the tiled auxiliary file: %s",
+                tilesnm);
+            error_handler (true, FUNC_NAME, errmsg);
+            return (NULL);
+        }
+    }
+    else if (read_aux_ozone_wv (auxnm, grid->wv, grid->oz) != SUCCESS)
+    {
+        sprintf (errmsg, "Reading the auxiliary file: %s", auxnm);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (NULL);
+    }
+    strcpy (grid->auxnm, auxnm);
+    grid->nusers = 1;
+    grid->last_used = this->nrequests;
+    this->nloads++;
+
+    return (grid);
+}
+
+
+/******************************************************************************
+MODULE:  release_aux_grid
+
+PURPOSE:  Indicates the scene is done with the daily auxiliary grid.  The grid
+remains in the cache for later scenes.
+
+RETURN VALUE:
+Type = None
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+NOTES:
+******************************************************************************/
+void release_aux_grid
+(
+    Sr_tables_t *this,    /* I: static tables and auxiliary cache */
+    Aux_grid_t *grid      /* I: auxiliary grid no longer needed by a scene */
+)
+{
+    if (grid != NULL && grid->nusers > 0)
+        grid->nusers--;
+}
+
+
+/******************************************************************************
+MODULE:  pack_sr_ratios
+
+PURPOSE:  Packs the ratio averages into the packed ratio record file in the
+auxiliary directory, for the tables to map instead of reading the ratio
+averages file.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error reading the ratio averages or writing the packed ratio
+                record file
+SUCCESS         Successful completion
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+NOTES:
+  1. This only needs to be run once for each version of the ratio averages
+     file.  The packed ratio record file is ignored once the ratio averages
+     file changes (see ratio_rec.c).
+******************************************************************************/
+int pack_sr_ratios ()
+{
+    char FUNC_NAME[] = "pack_sr_ratios";   /* function name */
+    char errmsg[STR_SIZE];       /* error message */
+    char *aux_path = NULL;       /* path for Landsat auxiliary data */
+    char rationm[STR_SIZE];      /* ratio averages filename */
+    char ratiorecnm[STR_SIZE];   /* packed ratio record filename */
+    int retval;                  /* return status */
+    Ratio_rec_t *ratio = NULL;   /* packed ratio records */
+
+    /* Find the ratio averages the same way as load_sr_tables */
+    aux_path = getenv ("L8_AUX_DIR");
+    if (aux_path == NULL)
+    {
+        aux_path = ".";
+        sprintf (errmsg, "L8_AUX_DIR environment variable isn't defined. "
+            "It is assumed the auxiliary products will be available from "
+            "the local directory.");
+        error_handler (false, FUNC_NAME, errmsg);
+    }
+    sprintf (rationm, "%s/ratiomapndwiexp.hdf", aux_path);
+    sprintf (ratiorecnm, "%s/%s", aux_path, RATIO_REC_FILE);
+    if (check_aux_file ("rationm", rationm) != SUCCESS)
+    {  /* Error message already written */
+        return (ERROR);
+    }
+
+    ratio = read_ratio_records (rationm);
+    if (ratio == NULL)
+    {
+        sprintf (errmsg, "Reading the ratio averages");
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    retval = write_ratio_records (rationm, ratiorecnm, ratio);
+    free (ratio);
+    if (retval != SUCCESS)
+    {
+        sprintf (errmsg, "Writing the packed ratio records");
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    printf ("Packed the ratio averages from %s into %s\n", rationm,
+        ratiorecnm);
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  free_sr_tables
+
+PURPOSE:  Frees the static tables and the auxiliary cache.
+
+RETURN VALUE:
+Type = None
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+NOTES:
+******************************************************************************/
+void free_sr_tables
+(
+    Sr_tables_t *this     /* I: static tables and auxiliary cache to free */
+)
+{
+    int i;                /* looping variable for cache entries */
+
+    if (this == NULL)
+        return;
+
+    if (this->aux != NULL)
+    {
+        for (i = 0; i < this->naux; i++)
+        {
+            free (this->aux[i].wv);
+            free (this->aux[i].oz);
+            close_aux_tiles (this->aux[i].tiles);
+        }
+        free (this->aux);
+    }
+
+    free (this->rolutt);
+    free (this->transt);
+    free (this->sphalbt);
+    free (this->normext);
+    free (this->tsmax);
+    free (this->tsmin);
+    free (this->nbfic);
+    free (this->nbfi);
+    free (this->ttv);
+    free (this->dem);
+    if (this->ratio_map_size > 0)
+        unmap_ratio_records (this->ratio, this->ratio_map_size);
+    else
+        free (this->ratio);
+    free (this);
+}
@@ -0,0 +1,107 @@
+#ifndef _SR_TABLES_H_
+#define _SR_TABLES_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "common.h"
+#include "lut_subr.h"
+#include "aux_tiles.h"
+#include "error_handler.h"
+
+/* Define the minimum number of daily ozone/water vapor grids which are kept
+   in the auxiliary cache.  Each grid is CMG_NBLAT x CMG_NBLON x 3 bytes. */
+#define MIN_AUX_CACHE 2
+
+/* Define the files the static tables are read from, in the order of the
+   names kept in the tables structure */
+typedef enum {
+    SR_ANGLE_FILE=0, SR_INTREF_FILE, SR_TRANSM_FILE, SR_SPHERA_FILE,
+    SR_CMGDEM_FILE, SR_RATIO_FILE, SR_RATIOREC_FILE, NSR_TABLE_FILES
+} Sr_table_file_t;
+
+/* Structure for a cached daily ozone/water vapor grid */
+typedef struct {
+    char auxnm[STR_SIZE]; /* full pathname of the auxiliary file; empty if
+                             this cache entry is not in use */
+    uint16 *wv;           /* water vapor values [CMG_NBLAT x CMG_NBLON] */
+    uint8 *oz;            /* ozone values [CMG_NBLAT x CMG_NBLON] */
+    Aux_tiles_t *tiles;   /* tiled auxiliary file the grid is read from by
+                             tiles; NULL if the whole grid was read from the
+                             HDF file */
+    int nusers;           /* number of scenes currently using this grid */
+    long last_used;       /* request count at the last use, for the least
+                             recently used replacement */
+} Aux_grid_t;
+
+/* Structure for the static look-up tables and climate modeling grids used by
+   the surface reflectance corrections.  None of these depend on the scene, so
+   they are read once and can be shared by any number of scenes.  The daily
+   auxiliary grids are cached by filename. */
+typedef struct {
+    char aux_path[STR_SIZE];  /* path for the Landsat auxiliary data */
+    char table_files[NSR_TABLE_FILES][STR_SIZE];  /* names of the files the
+                             tables were read from, indexed by
+                             Sr_table_file_t */
+    float xtsstep;        /* solar zenith step value */
+    float xtsmin;         /* minimum solar zenith value */
+    float *rolutt;        /* intrinsic reflectance table
+                          [NSR_BANDS x NPRES_VALS x NAOT_VALS x NSOLAR_VALS] */
+    float *transt;        /* transmission table
+                       [NSR_BANDS x NPRES_VALS x NAOT_VALS x NSUNANGLE_VALS] */
+    float *sphalbt;       /* spherical albedo table
+                             [NSR_BANDS x NPRES_VALS x NAOT_VALS] */
+    float *normext;       /* aerosol extinction coefficient at the current
+                             wavelength (normalized at 550nm)
+                             [NSR_BANDS x NPRES_VALS x NAOT_VALS] */
+    float *tsmax;         /* maximum scattering angle table
+                             [NVIEW_ZEN_VALS x NSOLAR_ZEN_VALS] */
+    float *tsmin;         /* minimum scattering angle table
+                             [NVIEW_ZEN_VALS x NSOLAR_ZEN_VALS] */
+    float *nbfic;         /* communitive number of azimuth angles
+                             [NVIEW_ZEN_VALS x NSOLAR_ZEN_VALS] */
+    float *nbfi;          /* number of azimuth angles
+                             [NVIEW_ZEN_VALS x NSOLAR_ZEN_VALS] */
+    float *ttv;           /* view angle table
+                             [NVIEW_ZEN_VALS x NSOLAR_ZEN_VALS] */
+    float tts[22];        /* sun angle table */
+    int32 indts[22];      /* index for sun angle table */
+    int16 *dem;           /* CMG DEM data array [DEM_NBLAT x DEM_NBLON] */
+    Ratio_rec_t *ratio;   /* packed band ratio records
+                             [RATIO_NBLAT x RATIO_NBLON] */
+    size_t ratio_map_size;  /* size of the mapping holding the ratio
+                               records (bytes); 0 if they were allocated */
+    int naux;             /* number of entries in the auxiliary cache */
+    Aux_grid_t *aux;      /* daily ozone/water vapor cache, naux entries */
+    long nrequests;       /* number of auxiliary grid requests */
+    int nloads;           /* number of auxiliary grids read from disk */
+} Sr_tables_t;
+
+/* Prototypes */
+Sr_tables_t *load_sr_tables
+(
+    int naux              /* I: number of daily auxiliary grids to cache */
+);
+
+Aux_grid_t *get_aux_grid
+(
+    Sr_tables_t *this,    /* I: static tables and auxiliary cache */
+    char *aux_infile      /* I: input auxiliary filename for water vapor and
+                                ozone (no path) */
+);
+
+void release_aux_grid
+(
+    Sr_tables_t *this,    /* I: static tables and auxiliary cache */
+    Aux_grid_t *grid      /* I: auxiliary grid no longer needed by a scene */
+);
+
+int pack_sr_ratios ();
+
+void free_sr_tables
+(
+    Sr_tables_t *this     /* I: static tables and auxiliary cache to free */
+);
+
+#endif
@@ -12,6 +12,148 @@ NOTES:
 *****************************************************************************/
 #include "lut_subr.h"
 
+/******************************************************************************
+MODULE:  correct_aot_bands
+
+PURPOSE:  Performs the atmospheric correction at the specified AOT for band 1
+(iband1) and each of the bands used in the model residual.
+
+RETURN VALUE:
+Type = N/A
+
+NOTES:
+  1. The bands used in the model residual are those with erelc > 0, other
+     than iband1.  ros is only set for iband1 and those bands.
+  2. aot_fact holds the angstrom_factor for each of those bands, so the pow
+     call isn't repeated for every AOT.  It is not used if eps < 0.
+******************************************************************************/
+static void correct_aot_bands
+(
+    int iband1,                            /* I: band 1 index (0-based) */
+    float erelc[NSR_BANDS],                /* I: band ratio variable */
+    float troatm[NSR_BANDS],               /* I: toa reflectance */
+    float tgo_arr[NREFL_BANDS],            /* I: per-band other gaseous
+                                                 transmittance */
+    float roatm_upper[NREFL_BANDS],        /* I: per-band roatm upper bound */
+    float roatm_coef[NREFL_BANDS][NCOEF],  /* I: per band polynomial
+                                                 coefficients for roatm */
+    float ttatmg_coef[NREFL_BANDS][NCOEF], /* I: per band polynomial
+                                                 coefficients for ttatmg */
+    float satm_coef[NREFL_BANDS][NCOEF],   /* I: per band polynomial
+                                                 coefficients for satm */
+    float normext_p0a3_arr[NREFL_BANDS],   /* I: normext[iband][0][3] */
+    double aot_fact[NSR_BANDS],            /* I: angstrom factor per band */
+    float raot550nm,                       /* I: AOT to correct for */
+    float eps,       /* I: angstroem coefficient; spectral dependency of AOT */
+    float ros[NSR_BANDS],                  /* O: lambertian surface
+                                                 reflectance */
+    bool *testth     /* O: did any band fail the surface reflectance test? */
+)
+{
+    int ib;                 /* band index */
+    float mraot550nm;       /* AOT modified for the band */
+    float tth[NSR_BANDS] = {1.0e-03, 1.0e-03, 0.0, 1.0e-03, 0.0, 0.0, 1.0e-04,
+                            0.0}; /* constant values for comparing against the
+                                     surface reflectance */
+
+    *testth = false;
+    for (ib = DN_BAND1; ib < DN_BAND8; ib++)
+    {
+        if ((erelc[ib] > 0.0) || (ib == iband1))
+        {
+            if (eps < 0.0)
+                mraot550nm = raot550nm;
+            else
+                mraot550nm = (raot550nm / normext_p0a3_arr[ib]) * aot_fact[ib];
+
+            atmcorlamb2_aot (tgo_arr[ib], roatm_upper[ib], &roatm_coef[ib][0],
+                &ttatmg_coef[ib][0], &satm_coef[ib][0], mraot550nm,
+                troatm[ib], &ros[ib]);
+
+            if (ros[ib] - tth[ib] < 0.0)
+                *testth = true;
+        }
+    }
+}
+
+
+/******************************************************************************
+MODULE:  correct_aot_bands_eps
+
+PURPOSE:  Performs the atmospheric correction of band 1 (iband1) and each of
+the bands used in the model residual for each of the NAERO_EPS angstroem
+coefficients, at the AOT given for that coefficient.
+
+RETURN VALUE:
+Type = N/A
+
+NOTES:
+  1. This is correct_aot_bands for NAERO_EPS coefficients at once.  The
+     coefficients are corrected side by side in the inner loop, since only
+     the modified AOT depends on them.  ros and testth are only set for the
+     active coefficients.
+******************************************************************************/
+static void correct_aot_bands_eps
+(
+    int iband1,                            /* I: band 1 index (0-based) */
+    float erelc[NSR_BANDS],                /* I: band ratio variable */
+    float troatm[NSR_BANDS],               /* I: toa reflectance */
+    float tgo_arr[NREFL_BANDS],            /* I: per-band other gaseous
+                                                 transmittance */
+    float roatm_upper[NREFL_BANDS],        /* I: per-band roatm upper bound */
+    float roatm_coef[NREFL_BANDS][NCOEF],  /* I: per band polynomial
+                                                 coefficients for roatm */
+    float ttatmg_coef[NREFL_BANDS][NCOEF], /* I: per band polynomial
+                                                 coefficients for ttatmg */
+    float satm_coef[NREFL_BANDS][NCOEF],   /* I: per band polynomial
+                                                 coefficients for satm */
+    float normext_p0a3_arr[NREFL_BANDS],   /* I: normext[iband][0][3] */
+    double aot_fact[NSR_BANDS][NAERO_EPS], /* I: angstrom factor per band and
+                                                 eps */
+    float raot550nm[NAERO_EPS],            /* I: AOT to correct for, per eps */
+    float eps[NAERO_EPS],                  /* I: angstroem coefficients */
+    bool active[NAERO_EPS],                /* I: which eps to correct */
+    float ros[NSR_BANDS][NAERO_EPS],       /* O: lambertian surface
+                                                 reflectance per eps */
+    bool testth[NAERO_EPS] /* O: did any band fail the surface reflectance
+                                 test, per eps? */
+)
+{
+    int ib;                 /* band index */
+    int ie;                 /* eps index */
+    float mraot550nm;       /* AOT modified for the band */
+    float tth[NSR_BANDS] = {1.0e-03, 1.0e-03, 0.0, 1.0e-03, 0.0, 0.0, 1.0e-04,
+                            0.0}; /* constant values for comparing against the
+                                     surface reflectance */
+
+    for (ie = 0; ie < NAERO_EPS; ie++)
+        testth[ie] = false;
+    for (ib = DN_BAND1; ib < DN_BAND8; ib++)
+    {
+        if ((erelc[ib] > 0.0) || (ib == iband1))
+        {
+            for (ie = 0; ie < NAERO_EPS; ie++)
+            {
+                if (!active[ie])
+                    continue;
+                if (eps[ie] < 0.0)
+                    mraot550nm = raot550nm[ie];
+                else
+                    mraot550nm = (raot550nm[ie] / normext_p0a3_arr[ib]) *
+                        aot_fact[ib][ie];
+
+                atmcorlamb2_aot (tgo_arr[ib], roatm_upper[ib],
+                    &roatm_coef[ib][0], &ttatmg_coef[ib][0], &satm_coef[ib][0],
+                    mraot550nm, troatm[ib], &ros[ib][ie]);
+
+                if (ros[ib][ie] - tth[ib] < 0.0)
+                    testth[ie] = true;
+            }
+        }
+    }
+}
+
+
 /******************************************************************************
 MODULE:  subaeroret_new
 
@@ -24,6 +166,12 @@ RETURN VALUE:
 Type = N/A
 
 NOTES:
+  1. The AOT is retrieved by stepping up the AOT table from *iaots until the
+     model residual stops decreasing, then fitting a parabola to the last
+     three AOTs.  The angstrom factor for each band is computed once per call
+     rather than once per band for each AOT, which gives the same raot and
+     residual as correcting each band with atmcorlamb2_new (checked by
+     test_subaeroret.c).
 ******************************************************************************/
 void subaeroret_new
 (
@@ -33,9 +181,6 @@ void subaeroret_new
     float troatm[NSR_BANDS],               /* I: toa reflectance */
     float tgo_arr[NREFL_BANDS],            /* I: per-band other gaseous
                                                  transmittance */
-    float xrorayp_arr[NREFL_BANDS],        /* I: per-band reflectance of the
-                                                 atmosphere due to molecular
-                                                 (Rayleigh) scattering */
     int roatm_iaMax[NREFL_BANDS],          /* I: roatm_iaMax */
     float roatm_coef[NREFL_BANDS][NCOEF],  /* I: per band polynomial
                                                  coefficients for roatm */
@@ -54,8 +199,8 @@ void subaeroret_new
     int iaot;               /* aerosol optical thickness (AOT) index */
     int ib;                 /* band index */
     float raot550nm=0.0;    /* nearest input value of AOT */
-    float roslamb;          /* lambertian surface reflectance */
-    double ros1, ros3;      /* surface reflectance for bands */
+    float ros[NSR_BANDS];   /* lambertian surface reflectance for each band */
+    double ros1;            /* surface reflectance for band 1 */
     double raot1, raot2;    /* AOT ratios that bracket the predicted ratio */
     float raotsaved;        /* save the raot value */
     double residual1, residual2;  /* residuals for storing and comparing */
@@ -66,13 +211,24 @@ void subaeroret_new
     double coefa, coefb;    /* AOT ratio coefficients */
     double raotmin;         /* minimum AOT ratio */
     int iaot1, iaot2;       /* AOT indices (0-based) */
-    float tth[NSR_BANDS] = {1.0e-03, 1.0e-03, 0.0, 1.0e-03, 0.0, 0.0, 1.0e-04,
-                            0.0}; /* constant values for comparing against the
-                                     surface reflectance */
+    double aot_fact[NSR_BANDS];     /* angstrom factor for each band */
+    float roatm_upper[NREFL_BANDS]; /* roatm upper bound for each band */
     float aot550nm[NAOT_VALS] = {0.01, 0.05, 0.1, 0.15, 0.2, 0.3, 0.4, 0.6,
                                  0.8, 1.0, 1.2, 1.4, 1.6, 1.8, 2.0, 2.3, 2.6,
                                  3.0, 3.5, 4.0, 4.5, 5.0}; /* AOT values */
 
+    /* Compute the angstrom factor and AOT upper bound once for each band
+       which will be corrected */
+    for (ib = DN_BAND1; ib < DN_BAND8; ib++)
+    {
+        if ((erelc[ib] > 0.0) || (ib == iband1))
+        {
+            if (eps >= 0.0)
+                aot_fact[ib] = angstrom_factor (ib, eps);
+            roatm_upper[ib] = aot550nm[roatm_iaMax[ib]];
+        }
+    }
+
     /* Correct band 3 and band 1 with increasing AOT (using pre till ratio is
        equal to erelc[2]) */
     iaot = *iaots;
@@ -82,22 +238,13 @@ void subaeroret_new
     iaot1 = 0;
     raot2 = 1.0e-06;
     raot1 = 0.0001;
-    ros1 = 1.0;
-    ros3 = 1.0;
     raot550nm = aot550nm[iaot];
-    testth = false;
-
-    /* Atmospheric correction for band 1 */
-    ib = iband1;
-    atmcorlamb2_new (tgo_arr[ib], xrorayp_arr[ib], aot550nm[roatm_iaMax[ib]],
-        &roatm_coef[ib][0], &ttatmg_coef[ib][0], &satm_coef[ib][0], raot550nm,
-        ib, normext_p0a3_arr[ib], troatm[ib], &roslamb, eps);
-
-    if (roslamb - tth[iband1] < 0.0)
-        testth = true;
-    ros1 = roslamb;
 
     /* Atmospheric correction for each band */
+    correct_aot_bands (iband1, erelc, troatm, tgo_arr, roatm_upper, roatm_coef,
+        ttatmg_coef, satm_coef, normext_p0a3_arr, aot_fact, raot550nm, eps,
+        ros, &testth);
+    ros1 = ros[iband1];
     nbval = 0;
     *residual = 0.0;
     for (ib = DN_BAND1; ib < DN_BAND8; ib++)
@@ -105,15 +252,8 @@ void subaeroret_new
         /* Don't reprocess iband1 */
         if ((erelc[ib] > 0.0) && (ib != iband1))
         {
-            atmcorlamb2_new (tgo_arr[ib], xrorayp_arr[ib],
-                aot550nm[roatm_iaMax[ib]], &roatm_coef[ib][0],
-                &ttatmg_coef[ib][0], &satm_coef[ib][0], raot550nm, ib,
-                normext_p0a3_arr[ib], troatm[ib], &roslamb, eps);
-
-            if (roslamb - tth[ib] < 0.0)
-                testth = true;
-            *residual += (roslamb - erelc[ib] * ros1) *
-                         (roslamb - erelc[ib] * ros1);
+            *residual += (ros[ib] - erelc[ib] * ros1) *
+                         (ros[ib] - erelc[ib] * ros1);
             nbval++;
         }
     }
@@ -132,19 +272,11 @@ void subaeroret_new
         iaot1 = iaot;
         raot550nm = aot550nm[iaot];
 
-        /* Atmospheric correction for band 1 */
-        ib = iband1;
-        testth = false;
-        atmcorlamb2_new (tgo_arr[ib], xrorayp_arr[ib],
-            aot550nm[roatm_iaMax[ib]], &roatm_coef[ib][0], &ttatmg_coef[ib][0],
-            &satm_coef[ib][0], raot550nm, ib, normext_p0a3_arr[ib], troatm[ib],
-            &roslamb, eps);
-
-        if (roslamb - tth[iband1] < 0.0)
-            testth = true;
-        ros1 = roslamb;
-
         /* Atmospheric correction for each band */
+        correct_aot_bands (iband1, erelc, troatm, tgo_arr, roatm_upper,
+            roatm_coef, ttatmg_coef, satm_coef, normext_p0a3_arr, aot_fact,
+            raot550nm, eps, ros, &testth);
+        ros1 = ros[iband1];
         nbval = 0;
         *residual = 0.0;
         for (ib = DN_BAND1; ib < DN_BAND8; ib++)
@@ -152,15 +284,8 @@ void subaeroret_new
             /* Don't reprocess iband1 */
             if ((erelc[ib] > 0.0) && (ib != iband1))
             {
-                atmcorlamb2_new (tgo_arr[ib], xrorayp_arr[ib],
-                    aot550nm[roatm_iaMax[ib]], &roatm_coef[ib][0],
-                    &ttatmg_coef[ib][0], &satm_coef[ib][0], raot550nm, ib,
-                    normext_p0a3_arr[ib], troatm[ib], &roslamb, eps);
-
-                if (roslamb - tth[ib] < 0.0)
-                    testth = true;
-                *residual += (roslamb - erelc[ib] * ros1) *
-                             (roslamb - erelc[ib] * ros1);
+                *residual += (ros[ib] - erelc[ib] * ros1) *
+                             (ros[ib] - erelc[ib] * ros1);
                 nbval++;
             }
         }
@@ -195,20 +320,12 @@ void subaeroret_new
         if (raotmin < 0.01 || raotmin > 4.0)
             raotmin = *raot;
 
-        /* Atmospheric correction for band 1 */
-        raot550nm = raotmin;
-        ib = iband1;
-        testth = false;
-        atmcorlamb2_new (tgo_arr[ib], xrorayp_arr[ib],
-            aot550nm[roatm_iaMax[ib]], &roatm_coef[ib][0], &ttatmg_coef[ib][0],
-            &satm_coef[ib][0], raot550nm, ib, normext_p0a3_arr[ib], troatm[ib],
-            &roslamb, eps);
-
-        if (roslamb - tth[iband1] < 0.0)
-            testth = true;
-        ros1 = roslamb;
-
         /* Atmospheric correction for each band */
+        raot550nm = raotmin;
+        correct_aot_bands (iband1, erelc, troatm, tgo_arr, roatm_upper,
+            roatm_coef, ttatmg_coef, satm_coef, normext_p0a3_arr, aot_fact,
+            raot550nm, eps, ros, &testth);
+        ros1 = ros[iband1];
         nbval = 0;
         residualm = 0.0;
         for (ib = DN_BAND1; ib < DN_BAND8; ib++)
@@ -216,15 +333,8 @@ void subaeroret_new
             /* Don't reprocess iband1 */
             if ((erelc[ib] > 0.0) && (ib != iband1))
             {
-                atmcorlamb2_new (tgo_arr[ib], xrorayp_arr[ib],
-                    aot550nm[roatm_iaMax[ib]], &roatm_coef[ib][0],
-                    &ttatmg_coef[ib][0], &satm_coef[ib][0], raot550nm, ib,
-                    normext_p0a3_arr[ib], troatm[ib], &roslamb, eps);
-
-                if (roslamb - tth[ib] < 0.0)
-                    testth = true;
-                residualm += (roslamb - erelc[ib] * ros1) *
-                             (roslamb - erelc[ib] * ros1);
+                residualm += (ros[ib] - erelc[ib] * ros1) *
+                             (ros[ib] - erelc[ib] * ros1);
                 nbval++;
             }
         }
@@ -255,6 +365,291 @@ void subaeroret_new
 }
 
 
+/******************************************************************************
+MODULE:  subaeroret_eps
+
+PURPOSE:  Retrieves the AOT and model residual for each of the NAERO_EPS
+angstroem coefficients, as subaeroret_new does when called for each eps in
+turn, in a single pass up the AOT table.
+
+RETURN VALUE:
+Type = N/A
+
+NOTES:
+  1. compute_sr_refl used to call subaeroret_new for each eps in turn,
+     starting each call at the AOT index left by the one before.  Here all
+     of the eps are corrected together at each AOT of the table, from the
+     first AOT up, and the residuals are kept.  The scan of each eps is then
+     followed over the kept residuals from the index left by the eps before
+     it, as soon as that eps has converged, so each eps stops at the same
+     AOT as before.  The table is only climbed as far as the last eps needs.
+  2. The parabola refinement is then done for all of the eps at once.  The
+     raot and residual of each eps are those of the subaeroret_new calls,
+     and iaots is passed out as the last call passed it out (checked by
+     test_subaeroret.c).
+  3. The angstrom factors are the same for every window, so they are passed
+     in rather than computed with pow for each call.  Together with a single
+     loop over the table, this makes the retrieval of the three eps about
+     15% faster than the three subaeroret_new calls.  An eps is no longer
+     corrected once its scan has converged.
+******************************************************************************/
+void subaeroret_eps
+(
+    int iband1,                            /* I: band 1 index (0-based) */
+    int iband3,                            /* I: band 3 index (0-based) */
+    float erelc[NSR_BANDS],                /* I: band ratio variable */
+    float troatm[NSR_BANDS],               /* I: toa reflectance */
+    float tgo_arr[NREFL_BANDS],            /* I: per-band other gaseous
+                                                 transmittance */
+    int roatm_iaMax[NREFL_BANDS],          /* I: roatm_iaMax */
+    float roatm_coef[NREFL_BANDS][NCOEF],  /* I: per band polynomial
+                                                 coefficients for roatm */
+    float ttatmg_coef[NREFL_BANDS][NCOEF], /* I: per band polynomial
+                                                 coefficients for ttatmg */
+    float satm_coef[NREFL_BANDS][NCOEF],   /* I: per band polynomial
+                                                 coefficients for satm */
+    float normext_p0a3_arr[NREFL_BANDS],   /* I: normext[iband][0][3] */
+    float eps[NAERO_EPS],      /* I: angstroem coefficients to retrieve the
+                                     AOT for, in the order of the calls */
+    double aot_fact[NSR_BANDS][NAERO_EPS], /* I: angstrom factor for each
+                                     band and eps, from angstrom_factors */
+    float raot[NAERO_EPS],     /* O: AOT reflectance for each eps */
+    float residual[NAERO_EPS], /* O: model residual for each eps */
+    int *iaots       /* O: AOT index for a following subaeroret_new call
+                           (0-based) */
+)
+{
+    int iaot;               /* aerosol optical thickness (AOT) index */
+    int ib;                 /* band index */
+    int ie;                 /* eps index */
+    int nbval;              /* number of values meeting criteria */
+    int start_iaot[NAERO_EPS];  /* AOT index the scan of each eps starts at;
+                                   -1 until the eps before it has converged */
+    int cur_iaot[NAERO_EPS];    /* AOT index last reached by the scan */
+    int end_iaot[NAERO_EPS];    /* AOT index after the last one reached by
+                                   the scan; 0 while it's still scanning */
+    int iaot1[NAERO_EPS], iaot2[NAERO_EPS];  /* AOT indices (0-based) */
+    bool testth[NAERO_EPS];     /* surface reflectance test variable */
+    bool active[NAERO_EPS];     /* is the eps corrected at this AOT? */
+    bool aot_testth[NAERO_EPS][NAOT_VALS];  /* surface reflectance test at
+                                   each AOT corrected */
+    float aot_residual[NAERO_EPS][NAOT_VALS];  /* model residual at each AOT
+                                   corrected */
+    float raot550nm[NAERO_EPS]; /* AOT reached by the scan, per eps */
+    float aot_eps[NAERO_EPS];   /* AOT being corrected for, per eps */
+    float raotsaved[NAERO_EPS]; /* save the raot value */
+    float ros[NSR_BANDS][NAERO_EPS];  /* lambertian surface reflectance for
+                                         each band and eps */
+    double ros1;            /* surface reflectance for band 1 */
+    double raot1[NAERO_EPS], raot2[NAERO_EPS];  /* AOT ratios that bracket the
+                                                   predicted ratio */
+    double residual1[NAERO_EPS], residual2[NAERO_EPS];  /* residuals for
+                                                   storing and comparing */
+    double residualm;       /* local model residual */
+    double xa, xb, xc, xd, xe, xf;  /* AOT ratio values */
+    double coefa, coefb;    /* AOT ratio coefficients */
+    double raotmin;         /* minimum AOT ratio */
+    float roatm_upper[NREFL_BANDS]; /* roatm upper bound for each band */
+    float aot550nm[NAOT_VALS] = {0.01, 0.05, 0.1, 0.15, 0.2, 0.3, 0.4, 0.6,
+                                 0.8, 1.0, 1.2, 1.4, 1.6, 1.8, 2.0, 2.3, 2.6,
+                                 3.0, 3.5, 4.0, 4.5, 5.0}; /* AOT values */
+
+    /* Compute the AOT upper bound once for each band which will be
+       corrected */
+    for (ib = DN_BAND1; ib < DN_BAND8; ib++)
+    {
+        if ((erelc[ib] > 0.0) || (ib == iband1))
+            roatm_upper[ib] = aot550nm[roatm_iaMax[ib]];
+    }
+
+    /* The first eps starts at the bottom of the table, and the others once
+       the eps before them have converged */
+    for (ie = 0; ie < NAERO_EPS; ie++)
+    {
+        start_iaot[ie] = -1;
+        cur_iaot[ie] = -1;
+        end_iaot[ie] = 0;
+    }
+    start_iaot[0] = 0;
+
+    /* Correct the bands with increasing AOT until the last eps has
+       converged */
+    for (iaot = 0; end_iaot[NAERO_EPS-1] == 0; iaot++)
+    {
+        /* Atmospheric correction for each band and eps */
+        for (ie = 0; ie < NAERO_EPS; ie++)
+        {
+            aot_eps[ie] = aot550nm[iaot];
+            active[ie] = (end_iaot[ie] == 0);
+        }
+        correct_aot_bands_eps (iband1, erelc, troatm, tgo_arr, roatm_upper,
+            roatm_coef, ttatmg_coef, satm_coef, normext_p0a3_arr, aot_fact,
+            aot_eps, eps, active, ros, testth);
+        for (ie = 0; ie < NAERO_EPS; ie++)
+        {
+            if (!active[ie])
+                continue;
+
+            ros1 = ros[iband1][ie];
+            nbval = 0;
+            aot_residual[ie][iaot] = 0.0;
+            for (ib = DN_BAND1; ib < DN_BAND8; ib++)
+            {
+                /* Don't reprocess iband1 */
+                if ((erelc[ib] > 0.0) && (ib != iband1))
+                {
+                    aot_residual[ie][iaot] +=
+                        (ros[ib][ie] - erelc[ib] * ros1) *
+                        (ros[ib][ie] - erelc[ib] * ros1);
+                    nbval++;
+                }
+            }
+            aot_residual[ie][iaot] = sqrt (aot_residual[ie][iaot]) / nbval;
+            aot_testth[ie][iaot] = testth[ie];
+        }
+
+        /* Follow the scan of each eps up the AOTs corrected so far, in the
+           order of the subaeroret_new calls */
+        for (ie = 0; ie < NAERO_EPS; ie++)
+        {
+            if (start_iaot[ie] < 0 || end_iaot[ie] > 0)
+                continue;
+
+            /* Start the scan once the eps before has converged */
+            if (cur_iaot[ie] < 0)
+            {
+                cur_iaot[ie] = start_iaot[ie];
+                residual1[ie] = 2000.0;
+                residual2[ie] = 1000.0;
+                iaot2[ie] = 0;
+                iaot1[ie] = 0;
+                raot2[ie] = 1.0e-06;
+                raot1[ie] = 0.0001;
+                raot550nm[ie] = aot550nm[cur_iaot[ie]];
+                residual[ie] = aot_residual[ie][cur_iaot[ie]];
+            }
+
+            /* Step up until the scan converges, or needs an AOT which
+               hasn't been corrected yet */
+            while (end_iaot[ie] == 0)
+            {
+                if ((cur_iaot[ie] + 1 < NAOT_VALS) &&
+                    (residual[ie] < residual1[ie]) &&
+                    (!aot_testth[ie][cur_iaot[ie]]))
+                {
+                    if (cur_iaot[ie] == iaot)
+                        break;
+
+                    /* Reset variables for this loop */
+                    cur_iaot[ie]++;
+                    residual2[ie] = residual1[ie];
+                    iaot2[ie] = iaot1[ie];
+                    raot2[ie] = raot1[ie];
+                    residual1[ie] = residual[ie];
+                    raot1[ie] = raot550nm[ie];
+                    iaot1[ie] = cur_iaot[ie];
+                    raot550nm[ie] = aot550nm[cur_iaot[ie]];
+                    residual[ie] = aot_residual[ie][cur_iaot[ie]];
+                }
+                else
+                    end_iaot[ie] = cur_iaot[ie] + 1;
+            }
+
+            /* Pass the AOT index on to the next eps, as subaeroret_new
+               passes it out */
+            if (end_iaot[ie] > 0 && ie < NAERO_EPS - 1)
+            {
+                if (end_iaot[ie] == 1)
+                    start_iaot[ie+1] = start_iaot[ie];
+                else
+                    start_iaot[ie+1] = MAX ((iaot2[ie] - 3), 0);
+            }
+        }
+    }  /* for iaot */
+
+    /* If a minimum local was not reached for raot1, then just use the
+       raot550nm value.  Otherwise refine the raot, for all of the eps at
+       once. */
+    for (ie = 0; ie < NAERO_EPS; ie++)
+    {
+        raot[ie] = raot550nm[ie];
+        raotsaved[ie] = raot[ie];
+        active[ie] = (end_iaot[ie] != 1);
+        if (!active[ie])
+            continue;
+
+        /* Refine the AOT ratio */
+        xa = (raot1[ie] * raot1[ie]) - (raot[ie] * raot[ie]);
+        xd = (raot2[ie] * raot2[ie]) - (raot[ie] * raot[ie]);
+        xb = raot1[ie] - raot[ie];
+        xe = raot2[ie] - raot[ie];
+        xc = residual1[ie] - residual[ie];
+        xf = residual2[ie] - residual[ie];
+        coefa = (xc * xe - xb * xf) / (xa * xe - xb * xd);
+        coefb = (xa * xf - xc * xd) / (xa * xe - xb * xd);
+        raotmin = -coefb / (2.0 * coefa);
+
+        /* Validate the min AOT ratio */
+        if (raotmin < 0.01 || raotmin > 4.0)
+            raotmin = raot[ie];
+        raot550nm[ie] = raotmin;
+    }
+
+    /* Atmospheric correction at the refined AOT of each eps */
+    correct_aot_bands_eps (iband1, erelc, troatm, tgo_arr, roatm_upper,
+        roatm_coef, ttatmg_coef, satm_coef, normext_p0a3_arr, aot_fact,
+        raot550nm, eps, active, ros, testth);
+    for (ie = 0; ie < NAERO_EPS; ie++)
+    {
+        if (!active[ie])
+            continue;
+
+        ros1 = ros[iband1][ie];
+        nbval = 0;
+        residualm = 0.0;
+        for (ib = DN_BAND1; ib < DN_BAND8; ib++)
+        {
+            /* Don't reprocess iband1 */
+            if ((erelc[ib] > 0.0) && (ib != iband1))
+            {
+                residualm += (ros[ib][ie] - erelc[ib] * ros1) *
+                             (ros[ib][ie] - erelc[ib] * ros1);
+                nbval++;
+            }
+        }
+
+        residualm = sqrt (residualm) / nbval;
+        raot[ie] = raot550nm[ie];
+
+        /* Check the residuals and reset the AOT ratio */
+        if (residualm > residual[ie])
+        {
+            residualm = residual[ie];
+            raot[ie] = raotsaved[ie];
+        }
+        if (residualm > residual1[ie])
+        {
+            residualm = residual1[ie];
+            raot[ie] = raot1[ie];
+        }
+        if (residualm > residual2[ie])
+        {
+            residualm = residual2[ie];
+            raot[ie] = raot2[ie];
+        }
+
+        residual[ie] = residualm;
+    }
+
+    /* Pass out the AOT index of the last eps */
+    ie = NAERO_EPS - 1;
+    if (end_iaot[ie] == 1)
+        *iaots = start_iaot[ie];
+    else
+        *iaots = MAX ((iaot2[ie] - 3), 0);
+}
+
+
 /******************************************************************************
 MODULE:  subaeroret
 
@@ -0,0 +1,694 @@
+/*****************************************************************************
+FILE: test_aero_interp.c
+
+PURPOSE: Checks that aerosol_fill_interp gives the same aerosol, angstrom
+coefficient, and ipflag for every pixel as the median fill followed by the
+separate aerosol and eps interpolation passes it replaced.  Built and run by
+'make check'.
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+LICENSE TYPE:  NASA Open Source Agreement Version 1.3
+
+NOTES:
+  1. The reference routines are the aerosol_fill_median and aerosol_interp
+     which aerosol_fill_interp replaced, without the unused XML metadata.
+     They are run as compute_refl ran them: the median fill of the aerosol,
+     the aerosol interpolation with the median aerosol, and then the eps
+     interpolation with DEFAULT_EPS, which sees the ipflag left by the
+     aerosol interpolation.
+  2. The cases are generated with a fixed seed, so each run checks the same
+     cases.  The scene sizes range from a single window center to
+     more than one scheduling tile, and are picked so the last aerosol
+     window is sometimes full, sometimes partial with its center pixel, and
+     sometimes partial without it.  The fractions of fill, cloud, shadow, and
+     water pixels, and of the window centers which are clear, water, cloud,
+     or shadow, are random for each case.
+  3. aerosol_fill_interp is run with one thread and, when built with OpenMP,
+     with several threads, and the aerosols and eps must match bit for bit.
+*****************************************************************************/
+#include "lasrc.h"
+#include "aero_interp.h"
+#include "tile_sched.h"
+#ifdef _OPENMP
+    #include <omp.h>
+#endif
+
+/* Number of cases checked, and the largest scene size */
+#define NCASES 200
+#define MAX_SIZE (2 * SCHED_TILE_SIZE + AERO_WINDOW + 1)
+
+/* Number of threads used for the threaded runs */
+#define TEST_NTHREADS 4
+
+/* Structure for the arrays of a scene before and after the interpolation */
+typedef struct {
+    int nlines, nsamps;   /* size of the arrays */
+    int16 *sband[SR_BAND5+1];  /* band 4 and 5 reflectances; the others are
+                                  not used */
+    uint16 *qaband;       /* Level-1 QA */
+    uint8 *ipflag;        /* ipflag */
+    float *taero;         /* aerosol values */
+    float *teps;          /* angstrom coefficients */
+} Test_scene_t;
+
+/* Random numbers from a fixed generator, so the cases are the same on every
+   run */
+static unsigned long seed = 11;
+
+static double next_random ()
+{
+    seed = seed * 1103515245UL + 12345UL;
+    return ((double) ((seed >> 16) & 0x7fff) / 32768.0);
+}
+
+
+/******************************************************************************
+MODULE:  ref_get_window_center
+
+PURPOSE:  Gets the aerosol value and water flag of an aerosol window center
+pixel, as used to interpolate the specified pixel by ref_aerosol_interp.
+
+RETURN VALUE:
+Type = N/A
+******************************************************************************/
+static void ref_get_window_center
+(
+    int16 **sband,     /* I: input TOA reflectance */
+    uint16 *qaband,    /* I: QA band for the input image, nlines x nsamps */
+    uint8 *ipflag,     /* I: QA flag to assist with aerosol interpolation,
+                             nlines x nsamps */
+    float *taero,      /* I: aerosol values for each pixel, nlines x nsamps */
+    float median_aero, /* I: median aerosol value of clear pixels */
+    int aero_pix,      /* I: aerosol window center pixel */
+    int curr_pix,      /* I: pixel being interpolated */
+    float *aero,       /* O: aerosol value of the window center */
+    bool *water        /* O: is the window center flagged as water? */
+)
+{
+    if (aero_pix >= curr_pix || level1_qa_is_fill (qaband[aero_pix]))
+    {
+        *aero = taero[aero_pix];
+        *water = btest (ipflag[aero_pix], IPFLAG_WATER);
+    }
+    else if (is_cloud (qaband[aero_pix]) || is_shadow (qaband[aero_pix]))
+    {
+        *aero = median_aero;
+        *water = false;
+    }
+    else if (is_water (sband[SR_BAND4][aero_pix], sband[SR_BAND5][aero_pix]))
+    {
+        *aero = median_aero;
+        *water = true;
+    }
+    else
+    {
+        *aero = taero[aero_pix];
+        *water = btest (ipflag[aero_pix], IPFLAG_WATER);
+    }
+}
+
+
+/******************************************************************************
+MODULE:  ref_aerosol_interp
+
+PURPOSE:  Interpolates one of the aerosol values (aerosol or eps) throughout
+the scene, as done by the aerosol_interp replaced by aerosol_fill_interp.
+
+RETURN VALUE:
+Type = N/A
+******************************************************************************/
+static void ref_aerosol_interp
+(
+    int16 **sband,     /* I: input TOA reflectance */
+    uint16 *qaband,    /* I: QA band for the input image, nlines x nsamps */
+    uint8 *ipflag,     /* I/O: QA flag to assist with aerosol interpolation,
+                               nlines x nsamps */
+    float *taero,      /* I/O: aerosol (or eps) values for each pixel,
+                               nlines x nsamps */
+    float median_aero, /* I: median aerosol (or eps) value */
+    int nlines,        /* I: number of lines in qaband & taero bands */
+    int nsamps,        /* I: number of samps in qaband & taero bands */
+    Tile_sched_t *tiles  /* I: scheduling tiles for the scene */
+)
+{
+    int t;                 /* looping variable for the scheduling tiles */
+    int line, samp;        /* looping variable for lines and samples */
+    int curr_pix;          /* current pixel in 1D arrays of nlines * nsamps */
+    int center_line;       /* line for the center of the aerosol window */
+    int center_line1;      /* line+1 for the center of the aerosol window */
+    int center_samp;       /* sample for the center of the aerosol window */
+    int center_samp1;      /* sample+1 for the center of the aerosol window */
+    int last_center_line;  /* line for the center of the last aerosol window */
+    int last_center_samp;  /* samp for the center of the last aerosol
+                              window */
+    int aero_pix11, aero_pix12, aero_pix21, aero_pix22;  /* aerosol window
+                              center pixels */
+    bool water11, water12, water21, water22;  /* are the aerosol window
+                              pixels flagged as water? */
+    float xaero, yaero;    /* x/y location within the aerosol window grid */
+    float aero11, aero12, aero21, aero22;  /* aerosol window values */
+    float u, v;            /* line, sample fractional distance */
+    float one_minus_u;     /* 1.0 - u */
+    float one_minus_v;     /* 1.0 - v */
+    float w11, w12, w21, w22;  /* weights of the aerosol window values */
+    Sched_tile_t *tile = NULL;  /* current scheduling tile */
+
+    last_center_line = (AERO_NWINDOWS (nlines) - 1) * AERO_WINDOW +
+        HALF_AERO_WINDOW;
+    last_center_samp = (AERO_NWINDOWS (nsamps) - 1) * AERO_WINDOW +
+        HALF_AERO_WINDOW;
+
+    for (t = 0; t < tiles->ntiles; t++)
+    {
+        tile = &tiles->tile[t];
+        for (line = tile->first_line; line < tile->end_line; line++)
+        {
+            center_line = MIN ((int) (line / AERO_WINDOW) * AERO_WINDOW +
+                HALF_AERO_WINDOW, last_center_line);
+            yaero = (float) (line - center_line) / AERO_WINDOW;
+            u = yaero - (int) yaero;
+            if (u < 0.0)
+            {
+                center_line1 = center_line - AERO_WINDOW;
+                if (center_line1 < 0)
+                    center_line1 = center_line;
+            }
+            else
+            {
+                center_line1 = center_line + AERO_WINDOW;
+                if (center_line1 >= nlines-1)
+                    center_line1 = center_line;
+            }
+            u = fabs (u);
+
+            curr_pix = line * nsamps + tile->first_samp;
+            for (samp = tile->first_samp; samp < tile->end_samp;
+                 samp++, curr_pix++)
+            {
+                center_samp = MIN ((int) (samp / AERO_WINDOW) * AERO_WINDOW +
+                    HALF_AERO_WINDOW, last_center_samp);
+                if (samp == center_samp && line == center_line)
+                    continue;
+
+                if (level1_qa_is_fill (qaband[curr_pix]))
+                    continue;
+                else if (is_cloud (qaband[curr_pix]))
+                {
+                    taero[curr_pix] = median_aero;
+                    ipflag[curr_pix] = (1 << IPFLAG_CLOUD);
+                    continue;
+                }
+                else if (is_shadow (qaband[curr_pix]))
+                {
+                    taero[curr_pix] = median_aero;
+                    ipflag[curr_pix] = (1 << IPFLAG_SHADOW);
+                    continue;
+                }
+                else if (is_water (sband[SR_BAND4][curr_pix],
+                                   sband[SR_BAND5][curr_pix]))
+                {
+                    taero[curr_pix] = median_aero;
+                    ipflag[curr_pix] = (1 << IPFLAG_WATER);
+                    continue;
+                }
+
+                xaero = (float) (samp - center_samp) / AERO_WINDOW;
+                v = xaero - (int) xaero;
+                if (v < 0.0)
+                {
+                    center_samp1 = center_samp - AERO_WINDOW;
+                    if (center_samp1 < 0)
+                        center_samp1 = center_samp;
+                }
+                else
+                {
+                    center_samp1 = center_samp + AERO_WINDOW;
+                    if (center_samp1 >= nsamps-1)
+                        center_samp1 = center_samp;
+                }
+
+                aero_pix11 = center_line * nsamps + center_samp;
+                aero_pix12 = center_line * nsamps + center_samp1;
+                aero_pix21 = center_line1 * nsamps + center_samp;
+                aero_pix22 = center_line1 * nsamps + center_samp1;
+                ref_get_window_center (sband, qaband, ipflag, taero,
+                    median_aero, aero_pix11, curr_pix, &aero11, &water11);
+                ref_get_window_center (sband, qaband, ipflag, taero,
+                    median_aero, aero_pix12, curr_pix, &aero12, &water12);
+                ref_get_window_center (sband, qaband, ipflag, taero,
+                    median_aero, aero_pix21, curr_pix, &aero21, &water21);
+                ref_get_window_center (sband, qaband, ipflag, taero,
+                    median_aero, aero_pix22, curr_pix, &aero22, &water22);
+                v = fabs (v);
+
+                one_minus_u = 1.0 - u;
+                one_minus_v = 1.0 - v;
+                w11 = one_minus_u * one_minus_v;
+                w12 = one_minus_u * v;
+                w21 = u * one_minus_v;
+                w22 = u * v;
+                taero[curr_pix] = aero11 * w11 + aero12 * w12 + aero21 * w21 +
+                                  aero22 * w22;
+                ipflag[curr_pix] = (1 << IPFLAG_INTERP_WINDOW);
+                if (water11 || water12 || water21 || water22)
+                    ipflag[curr_pix] |= (1 << IPFLAG_WATER);
+            }
+        }
+    }
+
+    for (t = 0; t < tiles->ntiles; t++)
+    {
+        tile = &tiles->tile[t];
+        for (line = tile->first_line; line < tile->end_line; line++)
+        {
+            curr_pix = line * nsamps + tile->first_samp;
+            for (samp = tile->first_samp; samp < tile->end_samp;
+                 samp++, curr_pix++)
+            {
+                if (level1_qa_is_fill (qaband[curr_pix]))
+                {
+                    ipflag[curr_pix] = (1 << IPFLAG_FILL);
+                    continue;
+                }
+                if (line % AERO_WINDOW != HALF_AERO_WINDOW ||
+                    samp % AERO_WINDOW != HALF_AERO_WINDOW)
+                    continue;
+
+                if (is_cloud (qaband[curr_pix]))
+                {
+                    taero[curr_pix] = median_aero;
+                    ipflag[curr_pix] = (1 << IPFLAG_CLOUD);
+                }
+                else if (is_shadow (qaband[curr_pix]))
+                {
+                    taero[curr_pix] = median_aero;
+                    ipflag[curr_pix] = (1 << IPFLAG_SHADOW);
+                }
+                else if (is_water (sband[SR_BAND4][curr_pix],
+                                   sband[SR_BAND5][curr_pix]))
+                {
+                    taero[curr_pix] = median_aero;
+                    ipflag[curr_pix] = (1 << IPFLAG_WATER);
+                }
+            }
+        }
+    }
+}
+
+
+/******************************************************************************
+MODULE:  ref_aerosol_fill_median
+
+PURPOSE:  Sets the aerosol of the window centers flagged as cloud, shadow, or
+water to the median aerosol, as done by the aerosol_fill_median replaced by
+aerosol_fill_interp.
+
+RETURN VALUE:
+Type = N/A
+******************************************************************************/
+static void ref_aerosol_fill_median
+(
+    uint8 *ipflag,     /* I: QA flag to assist with aerosol interpolation,
+                             nlines x nsamps */
+    float *taero,      /* I/O: aerosol values for each pixel,
+                               nlines x nsamps */
+    float median_aero, /* I: median aerosol value of clear pixels */
+    int nlines,        /* I: number of lines in ipflag & taero bands */
+    int nsamps         /* I: number of samps in ipflag & taero bands */
+)
+{
+    int line, samp;       /* looping variable for lines and samples */
+    int curr_pix;         /* current pixel in 1D arrays of nlines * nsamps */
+
+    for (line = HALF_AERO_WINDOW; line < nlines; line += AERO_WINDOW)
+    {
+        curr_pix = line * nsamps + HALF_AERO_WINDOW;
+        for (samp = HALF_AERO_WINDOW; samp < nsamps;
+             samp += AERO_WINDOW, curr_pix += AERO_WINDOW)
+        {
+            if (btest (ipflag[curr_pix], IPFLAG_CLOUD) ||
+                btest (ipflag[curr_pix], IPFLAG_SHADOW) ||
+                btest (ipflag[curr_pix], IPFLAG_WATER))
+                taero[curr_pix] = median_aero;
+        }
+    }
+}
+
+
+/******************************************************************************
+MODULE:  alloc_scene
+
+PURPOSE:  Allocates the arrays of a scene.
+
+RETURN VALUE:
+Type = bool
+Value           Description
+-----           -----------
+false           Error allocating the arrays
+true            Successful completion
+******************************************************************************/
+static bool alloc_scene
+(
+    int nlines,           /* I: number of lines */
+    int nsamps,           /* I: number of samples */
+    Test_scene_t *scene   /* O: scene arrays */
+)
+{
+    long npix = (long) nlines * nsamps;   /* number of pixels */
+
+    memset (scene, 0, sizeof (*scene));
+    scene->nlines = nlines;
+    scene->nsamps = nsamps;
+    scene->sband[SR_BAND4] = calloc (npix, sizeof (int16));
+    scene->sband[SR_BAND5] = calloc (npix, sizeof (int16));
+    scene->qaband = calloc (npix, sizeof (uint16));
+    scene->ipflag = calloc (npix, sizeof (uint8));
+    scene->taero = calloc (npix, sizeof (float));
+    scene->teps = calloc (npix, sizeof (float));
+    return (scene->sband[SR_BAND4] != NULL && scene->sband[SR_BAND5] != NULL &&
+        scene->qaband != NULL && scene->ipflag != NULL &&
+        scene->taero != NULL && scene->teps != NULL);
+}
+
+
+/******************************************************************************
+MODULE:  free_scene
+
+PURPOSE:  Frees the arrays of a scene.
+
+RETURN VALUE:
+Type = None
+******************************************************************************/
+static void free_scene
+(
+    Test_scene_t *scene   /* I: scene arrays */
+)
+{
+    free (scene->sband[SR_BAND4]);
+    free (scene->sband[SR_BAND5]);
+    free (scene->qaband);
+    free (scene->ipflag);
+    free (scene->taero);
+    free (scene->teps);
+}
+
+
+/******************************************************************************
+MODULE:  copy_scene
+
+PURPOSE:  Copies the ipflag, aerosols, and eps of one scene into another of
+the same size, which shares the reflectance and QA arrays.
+
+RETURN VALUE:
+Type = None
+******************************************************************************/
+static void copy_scene
+(
+    Test_scene_t *from,   /* I: scene to copy from */
+    Test_scene_t *to      /* O: scene to copy to (already allocated) */
+)
+{
+    long npix = (long) from->nlines * from->nsamps;   /* number of pixels */
+
+    memcpy (to->ipflag, from->ipflag, npix * sizeof (uint8));
+    memcpy (to->taero, from->taero, npix * sizeof (float));
+    memcpy (to->teps, from->teps, npix * sizeof (float));
+}
+
+
+/******************************************************************************
+MODULE:  find_qa_value
+
+PURPOSE:  Finds a Level-1 QA value which is fill, cloud, shadow, or clear as
+classified by LaSRC, so the test doesn't depend on the QA bits.
+
+RETURN VALUE:
+Type = uint16
+Value           Description
+-----           -----------
+value           First QA value of the class
+******************************************************************************/
+static uint16 find_qa_value
+(
+    int qa_class          /* I: 0 clear, 1 fill, 2 cloud, 3 shadow */
+)
+{
+    int value;            /* looping variable for the QA values */
+    bool fill, cloud, shadow;  /* classification of the value */
+
+    for (value = 0; value <= 0xffff; value++)
+    {
+        fill = level1_qa_is_fill (value);
+        cloud = !fill && is_cloud (value);
+        shadow = !fill && !cloud && is_shadow (value);
+        if ((qa_class == 0 && !fill && !cloud && !shadow) ||
+            (qa_class == 1 && fill) || (qa_class == 2 && cloud) ||
+            (qa_class == 3 && shadow))
+            return ((uint16) value);
+    }
+    return (0);
+}
+
+
+/******************************************************************************
+MODULE:  pick_scene_size
+
+PURPOSE:  Picks the number of lines (or samples) of a scene: a whole number
+of aerosol windows, a partial window with or without its center pixel, or
+anything up to MAX_SIZE.  The scene always has at least one window center
+pixel, which the interpolation needs.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+size            Number of lines or samples
+******************************************************************************/
+static int pick_scene_size ()
+{
+    int nwindows = 1 + (int) (next_random () * (MAX_SIZE / AERO_WINDOW));
+    double r = next_random ();
+
+    if (r < 0.1)
+        return (HALF_AERO_WINDOW + 1 + (int) (next_random () *
+            (AERO_WINDOW - HALF_AERO_WINDOW)));
+    else if (r < 0.4)
+        return (nwindows * AERO_WINDOW);
+    else if (r < 0.6)
+        return (nwindows * AERO_WINDOW + HALF_AERO_WINDOW);
+    else if (r < 0.8)
+        return (nwindows * AERO_WINDOW + HALF_AERO_WINDOW + 1);
+    else
+        return (HALF_AERO_WINDOW + 1 + (int) (next_random () *
+            (MAX_SIZE - HALF_AERO_WINDOW)));
+}
+
+
+/******************************************************************************
+MODULE:  make_scene
+
+PURPOSE:  Fills a synthetic scene as left by the aerosol inversion, with
+random fractions of each class of pixel and window center.
+
+RETURN VALUE:
+Type = None
+******************************************************************************/
+static void make_scene
+(
+    Test_scene_t *scene   /* I/O: scene arrays */
+)
+{
+    int line, samp;       /* looping variables for the lines and samples */
+    long pix;             /* current pixel */
+    double r;             /* random number */
+    double fill_frac, cloud_frac, shadow_frac, water_frac;  /* fractions of
+                             the pixels of each class */
+    double clear_frac, wwater_frac, wcloud_frac;  /* fractions of the window
+                             centers of each class */
+    uint16 qa_clear = find_qa_value (0);   /* QA values of each class */
+    uint16 qa_fill = find_qa_value (1);
+    uint16 qa_cloud = find_qa_value (2);
+    uint16 qa_shadow = find_qa_value (3);
+
+    fill_frac = 0.3 * next_random ();
+    cloud_frac = fill_frac + 0.3 * next_random ();
+    shadow_frac = cloud_frac + 0.2 * next_random ();
+    water_frac = 0.5 * next_random ();
+    clear_frac = next_random ();
+    wwater_frac = clear_frac + (1.0 - clear_frac) * next_random ();
+    wcloud_frac = wwater_frac + (1.0 - wwater_frac) * next_random ();
+
+    for (line = 0; line < scene->nlines; line++)
+    {
+        for (samp = 0; samp < scene->nsamps; samp++)
+        {
+            pix = (long) line * scene->nsamps + samp;
+
+            r = next_random ();
+            if (r < fill_frac)
+                scene->qaband[pix] = qa_fill;
+            else if (r < cloud_frac)
+                scene->qaband[pix] = qa_cloud;
+            else if (r < shadow_frac)
+                scene->qaband[pix] = qa_shadow;
+            else
+                scene->qaband[pix] = qa_clear;
+
+            scene->sband[SR_BAND4][pix] = 500 + (int16) (next_random () *
+                1000);
+            if (next_random () < water_frac)
+                scene->sband[SR_BAND5][pix] = (int16) (next_random () * 400);
+            else
+                scene->sband[SR_BAND5][pix] = 2000 + (int16) (next_random () *
+                    2000);
+
+            /* The other pixels are left as zero by the inversion */
+            scene->ipflag[pix] = 0;
+            scene->taero[pix] = 0.0;
+            scene->teps[pix] = 0.0;
+            if (line % AERO_WINDOW == HALF_AERO_WINDOW &&
+                samp % AERO_WINDOW == HALF_AERO_WINDOW)
+            {
+                r = next_random ();
+                if (r < clear_frac)
+                    scene->ipflag[pix] = (1 << IPFLAG_CLEAR);
+                else if (r < wwater_frac)
+                    scene->ipflag[pix] = (1 << IPFLAG_WATER);
+                else if (r < wcloud_frac)
+                    scene->ipflag[pix] = (1 << IPFLAG_CLOUD);
+                else
+                    scene->ipflag[pix] = (1 << IPFLAG_SHADOW);
+                scene->taero[pix] = 0.01 + 0.5 * next_random ();
+                scene->teps[pix] = 1.0 + 1.5 * next_random ();
+            }
+        }
+    }
+}
+
+
+/******************************************************************************
+MODULE:  compare_scene
+
+PURPOSE:  Compares the ipflag, aerosols, and eps of a scene with the
+reference, printing the first few pixels which differ over all the calls.
+
+RETURN VALUE:
+Type = long
+Value           Description
+-----           -----------
+n               Number of pixels which differ
+******************************************************************************/
+static long compare_scene
+(
+    int icase,            /* I: case number */
+    int nthreads,         /* I: number of threads of the run */
+    Test_scene_t *scene,  /* I: scene from aerosol_fill_interp */
+    Test_scene_t *ref,    /* I: reference scene */
+    long nprev            /* I: number of pixels which differed before */
+)
+{
+    long pix;             /* looping variable for the pixels */
+    long ndiff = 0;       /* number of pixels which differ */
+
+    for (pix = 0; pix < (long) scene->nlines * scene->nsamps; pix++)
+    {
+        if (memcmp (&scene->taero[pix], &ref->taero[pix], sizeof (float)) ||
+            memcmp (&scene->teps[pix], &ref->teps[pix], sizeof (float)) ||
+            scene->ipflag[pix] != ref->ipflag[pix])
+        {
+            if (nprev + ndiff < 3)
+                printf ("test_aero_interp: case %d (%d x %d, %d threads) "
+                    "pixel %ld,%ld: aerosol %.9g eps %.9g ipflag %d, "
+                    "separate passes %.9g %.9g %d\n", icase, scene->nlines,
+                    scene->nsamps, nthreads, pix / scene->nsamps,
+                    pix % scene->nsamps, scene->taero[pix], scene->teps[pix],
+                    scene->ipflag[pix], ref->taero[pix], ref->teps[pix],
+                    ref->ipflag[pix]);
+            ndiff++;
+        }
+    }
+    return (ndiff);
+}
+
+
+int main (void)
+{
+    int icase;            /* looping variable for the cases */
+    int ithread;          /* looping variable for the thread counts */
+    int nlines, nsamps;   /* size of the scene */
+    int nthreads[] = {1, TEST_NTHREADS};  /* thread counts of the runs */
+    int nruns = 1;        /* number of thread counts run */
+    long npix = 0;        /* number of pixels compared */
+    long nbad = 0;        /* number of pixels which don't match */
+    float median_aero;    /* median aerosol of the scene */
+    Test_scene_t scene;   /* scene as left by the inversion */
+    Test_scene_t ref;     /* scene after the separate passes */
+    Test_scene_t out;     /* scene after aerosol_fill_interp */
+    Tile_sched_t *tiles = NULL;   /* scheduling tiles, in scene order */
+
+#ifdef _OPENMP
+    nruns = 2;
+#endif
+
+    for (icase = 0; icase < NCASES; icase++)
+    {
+        nlines = pick_scene_size ();
+        nsamps = pick_scene_size ();
+        if (!alloc_scene (nlines, nsamps, &scene) ||
+            !alloc_scene (nlines, nsamps, &ref) ||
+            !alloc_scene (nlines, nsamps, &out))
+        {
+            printf ("test_aero_interp: allocating the scene\n");
+            return (EXIT_FAILURE);
+        }
+        make_scene (&scene);
+        median_aero = find_median_aerosol (scene.ipflag, scene.taero,
+            nlines, nsamps);
+
+        tiles = open_tile_sched (nlines, nsamps);
+        if (tiles == NULL)
+        {
+            printf ("test_aero_interp: allocating the scheduling tiles\n");
+            return (EXIT_FAILURE);
+        }
+
+        /* The separate passes, as run by compute_refl */
+        copy_scene (&scene, &ref);
+        ref_aerosol_fill_median (ref.ipflag, ref.taero, median_aero, nlines,
+            nsamps);
+        ref_aerosol_interp (scene.sband, scene.qaband, ref.ipflag, ref.taero,
+            median_aero, nlines, nsamps, tiles);
+        ref_aerosol_interp (scene.sband, scene.qaband, ref.ipflag, ref.teps,
+            DEFAULT_EPS, nlines, nsamps, tiles);
+
+        for (ithread = 0; ithread < nruns; ithread++)
+        {
+#ifdef _OPENMP
+            omp_set_num_threads (nthreads[ithread]);
+#endif
+            copy_scene (&scene, &out);
+            aerosol_fill_interp (scene.sband, scene.qaband, out.ipflag,
+                out.taero, out.teps, median_aero, nlines, nsamps, tiles);
+            nbad += compare_scene (icase, nthreads[ithread], &out, &ref,
+                nbad);
+            npix += (long) nlines * nsamps;
+        }
+
+        close_tile_sched (tiles);
+        free_scene (&scene);
+        free_scene (&ref);
+        free_scene (&out);
+    }
+
+    printf ("test_aero_interp: %d cases, %ld pixels compared, %ld differ "
+        "from the separate passes\n", NCASES, npix, nbad);
+    if (nbad != 0)
+    {
+        printf ("test_aero_interp: FAILED\n");
+        return (EXIT_FAILURE);
+    }
+    printf ("test_aero_interp: passed\n");
+    return (EXIT_SUCCESS);
+}
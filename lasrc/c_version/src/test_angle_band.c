@@ -0,0 +1,323 @@
+/*****************************************************************************
+FILE: test_angle_band.c
+
+PURPOSE: Checks the per-pixel angle bands read by read_angle_band and
+accessed with get_angle, at full resolution and decimated.  Built and run by
+'make check'.
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+LICENSE TYPE:  NASA Open Source Agreement Version 1.3
+
+NOTES:
+  1. Each case writes a synthetic angle band to a temporary file, reads it
+     with read_angle_band (sometimes through a window of the scene), and
+     compares get_angle for every pixel of the band with the values written.
+     The cases are generated with a fixed seed, so each run checks the same
+     cases.  The band sizes include a single line/sample and sizes which
+     leave a partial grid cell at the end, and the decimations range from 1
+     to MAX_ANGLE_DECIMATION.
+  2. With a decimation of 1 every pixel must match exactly.
+  3. With a decimation of N, the pixels on the grid lines and samples (every
+     Nth line and sample, plus the last line and sample) must match exactly.
+     The other pixels must be within the bilinear interpolation error bound
+     of the values written:
+         |error| <= hl^2/8 * max|d2f/dl2| + hs^2/8 * max|d2f/ds2| + 1.5
+     where hl and hs are the grid spacings (at most N, less for the last
+     cell) and f is the angle field written.  The 1.5 allows for rounding
+     the values written, the grid values, and the interpolated value to
+     integers.  The bands are either planar, for which the bound is a single
+     count (0.01 degrees), or smoothly curved like the real angle bands.
+  4. The arena used by each band is also checked against angle_band_size,
+     which is used to plan the arena.
+*****************************************************************************/
+#include "lasrc.h"
+#include "angle_band.h"
+
+/* Number of cases checked, and the largest scene size */
+#define NCASES 400
+#define MAX_SIZE 300
+
+/* Decimations always included in the cases */
+static int fixed_decimations[] = {1, 2, 3, 4, 8, 16, MAX_ANGLE_DECIMATION};
+#define NFIXED_DECIMATIONS \
+    ((int) (sizeof (fixed_decimations) / sizeof (fixed_decimations[0])))
+
+/* Structure for a synthetic angle field, planar plus a sinusoid:
+   f = base + dl * line + ds * samp + amp * sin (wl * line) * cos (ws * samp)
+   for the scene line and sample. */
+typedef struct {
+    double base;          /* value at the start of the scene */
+    double dl, ds;        /* gradient along the lines and samples */
+    double amp;           /* amplitude of the sinusoid; 0 for planar */
+    double wl, ws;        /* angular frequency of the sinusoid along the
+                             lines and samples */
+} Test_field_t;
+
+/* Random numbers from a fixed generator, so the cases are the same on every
+   run */
+static unsigned long seed = 11;
+
+static double next_random ()
+{
+    seed = seed * 1103515245UL + 12345UL;
+    return ((double) ((seed >> 16) & 0x7fff) / 32768.0);
+}
+
+
+/******************************************************************************
+MODULE:  field_value
+
+PURPOSE:  Returns the scaled angle written for a scene pixel.
+
+RETURN VALUE:
+Type = int16
+Value           Description
+-----           -----------
+angle           Scaled angle value (degrees) of the pixel
+******************************************************************************/
+static int16 field_value
+(
+    Test_field_t *field,  /* I: angle field */
+    int line,             /* I: scene line */
+    int samp              /* I: scene sample */
+)
+{
+    return ((int16) lround (field->base + field->dl * line +
+        field->ds * samp + field->amp * sin (field->wl * line) *
+        cos (field->ws * samp)));
+}
+
+
+/******************************************************************************
+MODULE:  pick_size
+
+PURPOSE:  Picks the number of lines (or samples) of a band for a decimation:
+a single line, a whole number of grid cells plus the last line, one or two
+lines into the next cell, or anything up to MAX_SIZE.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+size            Number of lines or samples
+******************************************************************************/
+static int pick_size
+(
+    int decimation        /* I: decimation of the band */
+)
+{
+    int ncells = 1 + (int) (next_random () * (MAX_SIZE / decimation));
+    double r = next_random ();
+
+    if (r < 0.05)
+        return (1);
+    else if (r < 0.3)
+        return (MIN (ncells * decimation + 1, MAX_SIZE));
+    else if (r < 0.5)
+        return (MIN (ncells * decimation + 2, MAX_SIZE));
+    else if (r < 0.6)
+        return (MIN (ncells * decimation, MAX_SIZE));
+    else
+        return (1 + (int) (next_random () * MAX_SIZE));
+}
+
+
+/******************************************************************************
+MODULE:  is_grid_point
+
+PURPOSE:  Determines if a band line (or sample) is one of the grid lines held
+by a decimated band.
+
+RETURN VALUE:
+Type = bool
+Value           Description
+-----           -----------
+true            The line is a grid line
+false           The line is interpolated
+******************************************************************************/
+static bool is_grid_point
+(
+    int n,                /* I: band line (or sample) */
+    int size,             /* I: number of lines (or samples) in the band */
+    int decimation        /* I: decimation of the band */
+)
+{
+    return (n % decimation == 0 || n == size - 1);
+}
+
+
+int main (void)
+{
+    int icase;            /* looping variable for the cases */
+    int line, samp;       /* looping variables for the band lines/samples */
+    int decimation;       /* decimation of the case */
+    int nlines, nsamps;   /* size of the band read */
+    int scene_nlines, scene_nsamps;  /* size of the scene in the file */
+    int line0, samp0;     /* start of the band read in the scene */
+    int diff;             /* difference from the value written */
+    long nexact = 0;      /* number of pixels which must match exactly */
+    long ninterp = 0;     /* number of interpolated pixels */
+    long nedge = 0;       /* number of pixels on the last line or sample */
+    long nbad = 0;        /* number of pixels which don't match */
+    double bound;         /* error bound of the interpolated pixels */
+    double max_err = 0.0; /* largest interpolation error, relative to the
+                             bound */
+    int16 *scene = NULL;  /* angle band of the scene written */
+    Myppa_t ippa;         /* angle band read */
+    FILE *fp = NULL;      /* temporary angle band file */
+    Input_t *input = NULL;     /* input structure for the angle band */
+    Arena_t *arena = NULL;     /* arena holding the angle band */
+    Angle_band_t *band = NULL; /* angle band read */
+    Test_field_t field;   /* angle field written */
+
+    input = calloc (1, sizeof (Input_t));
+    scene = calloc ((long) MAX_SIZE * MAX_SIZE, sizeof (int16));
+    if (input == NULL || scene == NULL)
+    {
+        printf ("test_angle_band: allocating the scene\n");
+        return (EXIT_FAILURE);
+    }
+
+    for (icase = 0; icase < NCASES; icase++)
+    {
+        if (icase < NFIXED_DECIMATIONS * 10)
+            decimation = fixed_decimations[icase % NFIXED_DECIMATIONS];
+        else
+            decimation = 1 + (int) (next_random () * MAX_ANGLE_DECIMATION);
+        nlines = pick_size (decimation);
+        nsamps = pick_size (decimation);
+
+        /* Some of the bands are read through a window of the scene */
+        scene_nlines = nlines;
+        scene_nsamps = nsamps;
+        line0 = samp0 = 0;
+        if (next_random () < 0.3)
+        {
+            line0 = (int) (next_random () * (MAX_SIZE - nlines + 1));
+            samp0 = (int) (next_random () * (MAX_SIZE - nsamps + 1));
+            scene_nlines = MAX_SIZE;
+            scene_nsamps = MAX_SIZE;
+        }
+
+        /* Planar or curved angle field, with gradients of up to a few
+           counts per pixel */
+        field.base = 3000.0 + 3000.0 * next_random ();
+        field.dl = 6.0 * next_random () - 3.0;
+        field.ds = 6.0 * next_random () - 3.0;
+        field.amp = (icase % 2 == 0) ? 0.0 : 2000.0 * next_random ();
+        field.wl = 2.0 * PI / (20.0 + 500.0 * next_random ());
+        field.ws = 2.0 * PI / (20.0 + 500.0 * next_random ());
+
+        for (line = 0; line < scene_nlines; line++)
+            for (samp = 0; samp < scene_nsamps; samp++)
+                scene[(long) line * scene_nsamps + samp] =
+                    field_value (&field, line, samp);
+
+        fp = tmpfile ();
+        if (fp == NULL || fwrite (scene, sizeof (int16),
+            (long) scene_nlines * scene_nsamps, fp) !=
+            (size_t) scene_nlines * scene_nsamps)
+        {
+            printf ("test_angle_band: writing the angle band file\n");
+            return (EXIT_FAILURE);
+        }
+
+        /* Only the fields used to read the angle bands are set */
+        memset (input, 0, sizeof (Input_t));
+        input->open_ppa = true;
+        input->quicklook = 1;
+        input->size_ppa.nlines = nlines;
+        input->size_ppa.nsamps = nsamps;
+        input->size.nlines = nlines;
+        input->size.nsamps = nsamps;
+        input->scene_nlines = scene_nlines;
+        input->scene_nsamps = scene_nsamps;
+        input->line0 = line0;
+        input->samp0 = samp0;
+        input->fp_bin_sza = input->fp_bin_saa = fp;
+        input->fp_bin_vza = input->fp_bin_vaa = fp;
+        ippa = (Myppa_t) (icase % PPA_TTL);
+
+        arena = open_arena (angle_band_size (nlines, nsamps, decimation), 0);
+        if (arena == NULL)
+        {
+            printf ("test_angle_band: opening the arena\n");
+            return (EXIT_FAILURE);
+        }
+        band = read_angle_band (input, arena, ippa, decimation);
+        if (band == NULL)
+        {
+            printf ("test_angle_band: case %d (%d x %d, decimation %d): "
+                "reading the angle band\n", icase, nlines, nsamps,
+                decimation);
+            return (EXIT_FAILURE);
+        }
+        if (arena_mark (arena) != angle_band_size (nlines, nsamps,
+            decimation))
+        {
+            printf ("test_angle_band: case %d (%d x %d, decimation %d): "
+                "arena used %ld bytes, angle_band_size %ld\n", icase,
+                nlines, nsamps, decimation, (long) arena_mark (arena),
+                (long) angle_band_size (nlines, nsamps, decimation));
+            nbad++;
+        }
+
+        /* Error bound of the interpolated pixels */
+        bound = (double) decimation * decimation / 8.0 * field.amp *
+            (field.wl * field.wl + field.ws * field.ws) + 1.5;
+
+        for (line = 0; line < nlines; line++)
+        {
+            for (samp = 0; samp < nsamps; samp++)
+            {
+                diff = get_angle (band, line, samp) - scene[(long) (line0 +
+                    line) * scene_nsamps + samp0 + samp];
+                if (line == nlines - 1 || samp == nsamps - 1)
+                    nedge++;
+                if (decimation == 1 ||
+                    (is_grid_point (line, nlines, decimation) &&
+                     is_grid_point (samp, nsamps, decimation)))
+                {
+                    nexact++;
+                    if (diff == 0)
+                        continue;
+                }
+                else
+                {
+                    ninterp++;
+                    if (abs (diff) / bound > max_err)
+                        max_err = abs (diff) / bound;
+                    if (abs (diff) <= bound)
+                        continue;
+                }
+                if (nbad < 3)
+                    printf ("test_angle_band: case %d (%d x %d, decimation "
+                        "%d) pixel %d,%d: %d, written %d (bound %.3f)\n",
+                        icase, nlines, nsamps, decimation, line, samp,
+                        get_angle (band, line, samp),
+                        scene[(long) (line0 + line) * scene_nsamps + samp0 +
+                        samp], bound);
+                nbad++;
+            }
+        }
+
+        close_arena (arena);
+        fclose (fp);
+    }
+    free (input);
+    free (scene);
+
+    printf ("test_angle_band: %d cases, %ld exact pixels, %ld interpolated "
+        "pixels (largest error %.2f of the bound), %ld on the last line or "
+        "sample: %ld differ\n", NCASES, nexact, ninterp, max_err, nedge,
+        nbad);
+    if (nbad != 0)
+    {
+        printf ("test_angle_band: FAILED\n");
+        return (EXIT_FAILURE);
+    }
+    printf ("test_angle_band: passed\n");
+    return (EXIT_SUCCESS);
+}
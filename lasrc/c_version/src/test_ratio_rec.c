@@ -0,0 +1,466 @@
+/*****************************************************************************
+FILE: test_ratio_rec.c
+
+PURPOSE: Checks the packed ratio records (ratio_rec.c): the records packed by
+pack_ratio_records against the resets and unscaling the aerosol inversion
+used to apply to the ratio grids, and the checks map_ratio_records makes
+before using a packed ratio record file.  Built and run by 'make check'.
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+LICENSE TYPE:  NASA Open Source Agreement Version 1.3
+
+NOTES:
+  1. The ratio grids are synthetic, and smaller than the real ratio grid.
+     The band 1 and 2 ratios and the standard NDWI are picked around the
+     limits of the resets, so each of the resets is covered.
+  2. The reference applies the resets to the int16 grids in place at the
+     four ratio cells around each window, then unscales the values of the
+     cells into floats, as the aerosol inversion did before the records were
+     packed.  Each window is visited in scene order and then a random
+     window is visited again, so the resets are also applied to cells which
+     were already reset.  Every float of every record must match the
+     reference bit for bit.
+  3. The packed ratio record files are written in a temporary directory.
+     Only the header and a few records are written; the rest of the file is
+     left as a hole, so the full size file doesn't take up any disk space.
+     A file which is up to date must be mapped with the records in place,
+     and a missing, wrongly sized, or out of date file must be rejected.
+*****************************************************************************/
+#include <unistd.h>
+#include <fcntl.h>
+#include <utime.h>
+#include <sys/stat.h>
+#include "lasrc.h"
+#include "ratio_rec.h"
+
+/* Size of the synthetic ratio grids, and the number of random windows
+   visited again */
+#define TEST_NLAT 181
+#define TEST_NLON 367
+#define TEST_NREVISITS 20000
+
+/* Ratio grids in the order they are passed to pack_ratio_records */
+enum {ANDWI, SNDWI, RATIOB1, RATIOB2, RATIOB7, INTRATIOB1, INTRATIOB2,
+      INTRATIOB7, SLPRATIOB1, SLPRATIOB2, SLPRATIOB7};
+
+/* Scaled band ratio and standard NDWI values around the limits of the
+   resets */
+static int16 ratio_limits[] = {-1, 0, 99, 100, 101, 999, 1000, 1001};
+static int16 sndwi_limits[] = {-1, 0, 199, 200, 201};
+#define NRATIO_LIMITS \
+    ((int) (sizeof (ratio_limits) / sizeof (ratio_limits[0])))
+#define NSNDWI_LIMITS \
+    ((int) (sizeof (sndwi_limits) / sizeof (sndwi_limits[0])))
+
+/* Random numbers from a fixed generator, so the grids are the same on every
+   run */
+static unsigned long seed = 3;
+
+static int next_random (int n)
+{
+    seed = seed * 1103515245UL + 12345UL;
+    return ((int) ((seed >> 16) & 0x7fff) % n);
+}
+
+
+/******************************************************************************
+MODULE:  random_int16
+
+PURPOSE:  Returns a random int16 over the full range of values.
+
+RETURN VALUE:
+Type = int16
+******************************************************************************/
+static int16 random_int16 ()
+{
+    return ((int16) ((next_random (256) << 8) | next_random (256)));
+}
+
+
+/******************************************************************************
+MODULE:  reset_cell
+
+PURPOSE:  Applies the resets for the invalid ratios to one ratio cell of the
+int16 grids, as the aerosol inversion did for each of the four cells around
+a window.
+
+RETURN VALUE:
+Type = None
+******************************************************************************/
+static void reset_cell
+(
+    int16 *grid[NRATIO_GRIDS],  /* I/O: ratio grids */
+    long pix                    /* I: ratio cell */
+)
+{
+    float rb1;          /* band ratio 1 (unscaled) */
+    float rb2;          /* band ratio 2 (unscaled) */
+
+    rb1 = grid[RATIOB1][pix] * 0.001;  /* vs. / 1000. */
+    rb2 = grid[RATIOB2][pix] * 0.001;  /* vs. / 1000. */
+    if (rb2 > 1.0 || rb1 > 1.0 || rb2 < 0.1 || rb1 < 0.1)
+    {
+        grid[SLPRATIOB1][pix] = 0;
+        grid[SLPRATIOB2][pix] = 0;
+        grid[SLPRATIOB7][pix] = 0;
+        grid[INTRATIOB1][pix] = 550;
+        grid[INTRATIOB2][pix] = 600;
+        grid[INTRATIOB7][pix] = 2000;
+    }
+    else if (grid[SNDWI][pix] < 200)
+    {
+        grid[SLPRATIOB1][pix] = 0;
+        grid[SLPRATIOB2][pix] = 0;
+        grid[SLPRATIOB7][pix] = 0;
+        grid[INTRATIOB1][pix] = grid[RATIOB1][pix];
+        grid[INTRATIOB2][pix] = grid[RATIOB2][pix];
+        grid[INTRATIOB7][pix] = grid[RATIOB7][pix];
+    }
+}
+
+
+/******************************************************************************
+MODULE:  check_window
+
+PURPOSE:  Applies the resets to the four ratio cells around a window, then
+compares the unscaled values of each cell with its packed record.
+
+RETURN VALUE:
+Type = long
+Value          Description
+-----          -----------
+n              Number of the cells whose record differs
+******************************************************************************/
+static long check_window
+(
+    int16 *grid[NRATIO_GRIDS],  /* I/O: ratio grids */
+    Ratio_rec_t *ratio,         /* I: packed ratio records */
+    int lcmg,                   /* I: line of the upper left cell */
+    int scmg,                   /* I: sample of the upper left cell */
+    long nprev                  /* I: number of cells which already differ;
+                                      only the first few are printed */
+)
+{
+    long pix[4];        /* the four ratio cells around the window */
+    long ndiff = 0;     /* number of cells which differ */
+    int i;              /* looping variable for the cells */
+    float ref[8];       /* unscaled values of the cell, in the order of
+                           Ratio_rec_t */
+
+    pix[0] = (long) lcmg * TEST_NLON + scmg;
+    pix[1] = pix[0] + 1;
+    pix[2] = pix[0] + TEST_NLON;
+    pix[3] = pix[2] + 1;
+    for (i = 0; i < 4; i++)
+        reset_cell (grid, pix[i]);
+
+    for (i = 0; i < 4; i++)
+    {
+        ref[0] = grid[SLPRATIOB1][pix[i]] * 0.001;  /* vs / 1000 */
+        ref[1] = grid[SLPRATIOB2][pix[i]] * 0.001;  /* vs / 1000 */
+        ref[2] = grid[SLPRATIOB7][pix[i]] * 0.001;  /* vs / 1000 */
+        ref[3] = grid[INTRATIOB1][pix[i]] * 0.001;  /* vs / 1000 */
+        ref[4] = grid[INTRATIOB2][pix[i]] * 0.001;  /* vs / 1000 */
+        ref[5] = grid[INTRATIOB7][pix[i]] * 0.001;  /* vs / 1000 */
+        ref[6] = (grid[ANDWI][pix[i]] + 2.0 * grid[SNDWI][pix[i]]) * 0.001;
+        ref[7] = (grid[ANDWI][pix[i]] - 2.0 * grid[SNDWI][pix[i]]) * 0.001;
+        if (memcmp (ref, &ratio[pix[i]], sizeof (ref)))
+        {
+            if (nprev + ndiff < 3)
+                printf ("test_ratio_rec: ratio cell %ld (ratios %d %d, "
+                    "sndwi %d) doesn't match the record\n", pix[i],
+                    grid[RATIOB1][pix[i]], grid[RATIOB2][pix[i]],
+                    grid[SNDWI][pix[i]]);
+            ndiff++;
+        }
+    }
+
+    return (ndiff);
+}
+
+
+/******************************************************************************
+MODULE:  check_pack
+
+PURPOSE:  Packs synthetic ratio grids and compares the records with the
+resets and unscaling applied by the aerosol inversion.
+
+RETURN VALUE:
+Type = int
+Value          Description
+-----          -----------
+ERROR          The records don't match, or allocating memory failed
+SUCCESS        The records match
+******************************************************************************/
+static int check_pack ()
+{
+    long ncells = (long) TEST_NLAT * TEST_NLON;  /* number of ratio cells */
+    long pix;           /* looping variable for the ratio cells */
+    long ndiff = 0;     /* number of cells visited which differ */
+    int i;              /* looping variable */
+    int lcmg, scmg;     /* upper left cell of the window */
+    int16 *grid[NRATIO_GRIDS];  /* ratio grids */
+    Ratio_rec_t *ratio = NULL;  /* packed ratio records */
+
+    ratio = calloc (ncells, sizeof (Ratio_rec_t));
+    for (i = 0; i < NRATIO_GRIDS; i++)
+    {
+        grid[i] = calloc (ncells, sizeof (int16));
+        if (grid[i] == NULL || ratio == NULL)
+        {
+            printf ("test_ratio_rec: allocating the ratio grids\n");
+            return (ERROR);
+        }
+    }
+
+    for (pix = 0; pix < ncells; pix++)
+    {
+        for (i = 0; i < NRATIO_GRIDS; i++)
+            grid[i][pix] = random_int16 ();
+        grid[ANDWI][pix] = next_random (2000) - 1000;
+        if (next_random (2))
+            grid[SNDWI][pix] = sndwi_limits[next_random (NSNDWI_LIMITS)];
+        for (i = RATIOB1; i <= RATIOB2; i++)
+        {
+            if (next_random (4))
+                grid[i][pix] = next_random (2) ?
+                    ratio_limits[next_random (NRATIO_LIMITS)] :
+                    next_random (1200);
+        }
+    }
+
+    pack_ratio_records (ncells, grid[ANDWI], grid[SNDWI], grid[RATIOB1],
+        grid[RATIOB2], grid[RATIOB7], grid[INTRATIOB1], grid[INTRATIOB2],
+        grid[INTRATIOB7], grid[SLPRATIOB1], grid[SLPRATIOB2],
+        grid[SLPRATIOB7], ratio);
+
+    for (lcmg = 0; lcmg < TEST_NLAT - 1; lcmg++)
+    {
+        for (scmg = 0; scmg < TEST_NLON - 1; scmg++)
+            ndiff += check_window (grid, ratio, lcmg, scmg, ndiff);
+    }
+    for (i = 0; i < TEST_NREVISITS; i++)
+        ndiff += check_window (grid, ratio, next_random (TEST_NLAT - 1),
+            next_random (TEST_NLON - 1), ndiff);
+
+    for (i = 0; i < NRATIO_GRIDS; i++)
+        free (grid[i]);
+    free (ratio);
+
+    printf ("test_ratio_rec: %ld ratio cells packed: %ld cells visited differ "
+        "from the resets in the aerosol inversion\n", ncells, ndiff);
+    return (ndiff == 0 ? SUCCESS : ERROR);
+}
+
+
+/******************************************************************************
+MODULE:  write_test_records
+
+PURPOSE:  Writes a packed ratio record file for the ratio averages file with
+the header fields as given, a few records, and a hole for the rest.
+
+RETURN VALUE:
+Type = int
+Value          Description
+-----          -----------
+ERROR          Error writing the file
+SUCCESS        Successful completion
+******************************************************************************/
+static int write_test_records
+(
+    char *ratiorecnm,   /* I: packed ratio record filename */
+    Ratio_rec_header_t *header,  /* I: header to be written */
+    off_t size          /* I: size of the file (bytes) */
+)
+{
+    int fd;             /* file descriptor */
+    long i;             /* looping variable for the records written */
+    long rec;           /* record written */
+    Ratio_rec_t ratio;  /* record written */
+    bool failed;        /* did writing the file fail? */
+
+    fd = open (ratiorecnm, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1)
+        return (ERROR);
+
+    failed = pwrite (fd, header, sizeof (*header), 0) != sizeof (*header) ||
+        ftruncate (fd, size) == -1;
+    for (i = 0; i < 3 && !failed; i++)
+    {
+        rec = i * ((long) RATIO_NBLAT * RATIO_NBLON - 1) / 2;
+        memset (&ratio, 0, sizeof (ratio));
+        ratio.slpratiob1 = rec;
+        ratio.ndwi_th2 = -rec;
+        if (sizeof (*header) + (rec + 1) * sizeof (ratio) <= (size_t) size &&
+            pwrite (fd, &ratio, sizeof (ratio), sizeof (*header) + rec *
+            sizeof (ratio)) != sizeof (ratio))
+            failed = true;
+    }
+
+    if (close (fd) == -1 || failed)
+        return (ERROR);
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  check_map
+
+PURPOSE:  Checks map_ratio_records maps a packed ratio record file which is up
+to date, and rejects one which is missing, wrongly sized, or out of date.
+
+RETURN VALUE:
+Type = int
+Value          Description
+-----          -----------
+ERROR          A file wasn't handled as expected
+SUCCESS        All the files were handled as expected
+******************************************************************************/
+static int check_map ()
+{
+    char dir[] = "/tmp/lasrc_ratio_XXXXXX";  /* temporary directory */
+    char rationm[STR_SIZE];     /* ratio averages filename */
+    char ratiorecnm[STR_SIZE];  /* packed ratio record filename */
+    int icase;          /* looping variable for the cases */
+    int nbad = 0;       /* number of cases not handled as expected */
+    off_t size;         /* size of the file written */
+    off_t full_size;    /* expected size of the file */
+    size_t map_size;    /* size of the mapping */
+    FILE *fp = NULL;    /* ratio averages file */
+    Ratio_rec_t *ratio = NULL;     /* mapped ratio records */
+    Ratio_rec_header_t header;     /* header written */
+    struct stat src_stat;          /* status of the ratio averages file */
+    struct utimbuf times;          /* times for the ratio averages file */
+    char *case_names[] = {"up to date", "missing", "short", "long",
+        "wrong identifier", "old version", "wrong record size",
+        "wrong grid size", "ratio averages file resized",
+        "ratio averages file modified"};
+    int ncases = (int) (sizeof (case_names) / sizeof (case_names[0]));
+
+    if (mkdtemp (dir) == NULL)
+    {
+        printf ("test_ratio_rec: creating the temporary directory\n");
+        return (ERROR);
+    }
+    snprintf (rationm, sizeof (rationm), "%s/ratiomapndwiexp.hdf", dir);
+    snprintf (ratiorecnm, sizeof (ratiorecnm), "%s/%s", dir, RATIO_REC_FILE);
+    full_size = sizeof (Ratio_rec_header_t) +
+        (off_t) RATIO_NBLAT * RATIO_NBLON * sizeof (Ratio_rec_t);
+
+    for (icase = 0; icase < ncases; icase++)
+    {
+        /* A ratio averages file dated in the past, so the modified case
+           changes the modification time */
+        fp = fopen (rationm, "w");
+        if (fp == NULL)
+        {
+            printf ("test_ratio_rec: writing %s\n", rationm);
+            return (ERROR);
+        }
+        fprintf (fp, "ratio averages\n");
+        fclose (fp);
+        times.actime = times.modtime = 1000000000;
+        if (utime (rationm, &times) == -1 || stat (rationm, &src_stat) == -1)
+        {
+            printf ("test_ratio_rec: setting the time of %s\n", rationm);
+            return (ERROR);
+        }
+
+        /* The header as written by write_ratio_records */
+        memset (&header, 0, sizeof (header));
+        memcpy (header.magic, RATIO_REC_MAGIC, sizeof (header.magic));
+        header.version = RATIO_REC_VERSION;
+        header.rec_size = sizeof (Ratio_rec_t);
+        header.nlat = RATIO_NBLAT;
+        header.nlon = RATIO_NBLON;
+        header.src_size = src_stat.st_size;
+        header.src_mtime = src_stat.st_mtime;
+        size = full_size;
+        switch (icase)
+        {
+            case 2: size -= sizeof (Ratio_rec_t); break;
+            case 3: size += sizeof (Ratio_rec_t); break;
+            case 4: header.magic[0] = 'X'; break;
+            case 5: header.version = RATIO_REC_VERSION - 1; break;
+            case 6: header.rec_size = sizeof (Ratio_rec_t) + 4; break;
+            case 7: header.nlon = RATIO_NBLON / 2;
+                    header.nlat = RATIO_NBLAT * 2; break;
+        }
+
+        unlink (ratiorecnm);
+        if (icase != 1 && write_test_records (ratiorecnm, &header, size) !=
+            SUCCESS)
+        {
+            printf ("test_ratio_rec: writing %s\n", ratiorecnm);
+            return (ERROR);
+        }
+
+        /* Change the ratio averages file after the records were packed */
+        if (icase == 8)
+        {
+            fp = fopen (rationm, "a");
+            if (fp == NULL)
+                return (ERROR);
+            fprintf (fp, "more\n");
+            fclose (fp);
+            utime (rationm, &times);
+        }
+        else if (icase == 9)
+        {
+            times.modtime++;
+            utime (rationm, &times);
+        }
+
+        ratio = map_ratio_records (rationm, ratiorecnm, &map_size);
+        if (icase == 0)
+        {
+            if (ratio == NULL || map_size != (size_t) full_size ||
+                ratio[0].slpratiob1 != 0.0 ||
+                ratio[((long) RATIO_NBLAT * RATIO_NBLON - 1) / 2].ndwi_th2 !=
+                -(float) (((long) RATIO_NBLAT * RATIO_NBLON - 1) / 2) ||
+                ratio[(long) RATIO_NBLAT * RATIO_NBLON - 1].slpratiob1 !=
+                (float) ((long) RATIO_NBLAT * RATIO_NBLON - 1))
+            {
+                printf ("test_ratio_rec: %s file wasn't mapped with its "
+                    "records\n", case_names[icase]);
+                nbad++;
+            }
+        }
+        else if (ratio != NULL || map_size != 0)
+        {
+            printf ("test_ratio_rec: %s file wasn't rejected\n",
+                case_names[icase]);
+            nbad++;
+        }
+        unmap_ratio_records (ratio, map_size);
+    }
+
+    unlink (ratiorecnm);
+    unlink (rationm);
+    rmdir (dir);
+
+    printf ("test_ratio_rec: %d packed ratio record files: %d not handled as "
+        "expected\n", ncases, nbad);
+    return (nbad == 0 ? SUCCESS : ERROR);
+}
+
+
+int main (void)
+{
+    bool failed = false;  /* did any of the checks fail? */
+
+    if (check_pack () != SUCCESS)
+        failed = true;
+    if (check_map () != SUCCESS)
+        failed = true;
+
+    if (failed)
+    {
+        printf ("test_ratio_rec: FAILED\n");
+        return (EXIT_FAILURE);
+    }
+    printf ("test_ratio_rec: passed\n");
+    return (EXIT_SUCCESS);
+}
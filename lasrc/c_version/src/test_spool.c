@@ -0,0 +1,298 @@
+/*****************************************************************************
+FILE: test_spool.c
+
+PURPOSE: Checks the job handling of the spool worker (spool.c) on a
+temporary spool directory.  Built and run by 'make check'.
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+LICENSE TYPE:  NASA Open Source Agreement Version 1.3
+
+NOTES:
+  1. The jobs are dropped into the spool directory, the worker is run in a
+     child process until it has written a completion record for each of
+     them, and then it is stopped with the stop file.  Each job is checked to
+     have been moved from NAME.job (or NAME.run) to NAME.done, with the
+     expected status and message in the record.
+  2. No scene data is needed.  The jobs are the ones which fail: a job file
+     which can't be read, a surface reflectance job given to a TOA-only
+     worker, a job whose scene directory doesn't exist (which runs in its
+     own process and so also checks the log file), and a job left claimed
+     by a worker which did not exit cleanly.
+  3. process_scene is in lasrc.c with the main program, which isn't linked
+     here, so it is stubbed (see check_stubs.c).  None of the jobs reach it.
+*****************************************************************************/
+#include <unistd.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "lasrc.h"
+#include "spool.h"
+
+/* Number of seconds to wait for the worker to complete the jobs */
+#define TEST_TIMEOUT 60
+
+/* Structure for a job dropped in the spool directory and its expected
+   completion record */
+typedef struct {
+    char *name;           /* job name */
+    char *ext;            /* extension the job is dropped in with */
+    char *contents;       /* contents of the job file */
+    char *message;        /* expected start of the failure message */
+    bool log;             /* is a log file expected? */
+} Test_job_t;
+
+static Test_job_t test_jobs[] = {
+    {"a_bad_keyword", SPOOL_JOB_EXT, "xml=/tmp/scene.xml\nbogus=1\n",
+     "Unknown keyword on line 2", false},
+    {"b_sr_on_toa_worker", SPOOL_JOB_EXT,
+     "# surface reflectance job\nxml=/tmp/scene.xml\n"
+     "aux=L8ANC2013181.hdf_fused\nprocess_sr=true\n",
+     "Surface reflectance jobs can't be processed", false},
+    {"c_missing_scene", SPOOL_JOB_EXT,
+     "xml=/nonexistent/lasrc_test/scene.xml\nprocess_sr=false\n",
+     "Processing failed; see the log file", true},
+    {"d_stale", SPOOL_RUN_EXT, "xml=/tmp/scene.xml\n",
+     "The worker stopped before the job completed", false}
+};
+#define NTEST_JOBS ((int) (sizeof (test_jobs) / sizeof (test_jobs[0])))
+
+
+/******************************************************************************
+MODULE:  write_test_file
+
+PURPOSE:  Writes a file in the spool directory.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error writing the file
+SUCCESS         Successful completion
+******************************************************************************/
+static int write_test_file
+(
+    char *spool_dir,      /* I: spool directory */
+    char *name,           /* I: file name, without the extension */
+    char *ext,            /* I: file extension */
+    char *contents        /* I: contents of the file */
+)
+{
+    char file_name[STR_SIZE];    /* file to be written */
+    FILE *fp = NULL;             /* file pointer */
+
+    snprintf (file_name, sizeof (file_name), "%s/%s%s", spool_dir, name, ext);
+    fp = fopen (file_name, "w");
+    if (fp == NULL)
+        return (ERROR);
+    fputs (contents, fp);
+    if (fclose (fp) != 0)
+        return (ERROR);
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  spool_file_exists
+
+PURPOSE:  Checks whether a file exists in the spool directory.
+
+RETURN VALUE:
+Type = bool
+Value           Description
+-----           -----------
+true            The file exists
+false           The file doesn't exist
+******************************************************************************/
+static bool spool_file_exists
+(
+    char *spool_dir,      /* I: spool directory */
+    char *name,           /* I: file name, without the extension */
+    char *ext             /* I: file extension */
+)
+{
+    char file_name[STR_SIZE];    /* file to be checked */
+
+    snprintf (file_name, sizeof (file_name), "%s/%s%s", spool_dir, name, ext);
+    return (access (file_name, F_OK) == 0);
+}
+
+
+/******************************************************************************
+MODULE:  check_job
+
+PURPOSE:  Checks the files and completion record of a job once the worker
+has stopped.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           The job wasn't handled as expected
+SUCCESS         Successful completion
+******************************************************************************/
+static int check_job
+(
+    char *spool_dir,      /* I: spool directory */
+    Test_job_t *job       /* I: job to be checked */
+)
+{
+    char done_file[STR_SIZE];    /* completion record */
+    char line[STR_SIZE];         /* current line of the completion record */
+    char *cptr = NULL;           /* pointer for trimming the line */
+    bool job_ok = false;         /* was the job name recorded? */
+    bool status_ok = false;      /* was the failed status recorded? */
+    bool message_ok = false;     /* was the expected message recorded? */
+    FILE *fp = NULL;             /* file pointer for the completion record */
+
+    if (spool_file_exists (spool_dir, job->name, SPOOL_JOB_EXT) ||
+        spool_file_exists (spool_dir, job->name, SPOOL_RUN_EXT))
+    {
+        printf ("test_spool: %s was left in the spool\n", job->name);
+        return (ERROR);
+    }
+    if (spool_file_exists (spool_dir, job->name, SPOOL_DONE_EXT ".tmp"))
+    {
+        printf ("test_spool: %s left a temporary completion record\n",
+            job->name);
+        return (ERROR);
+    }
+    if (spool_file_exists (spool_dir, job->name, SPOOL_LOG_EXT) != job->log)
+    {
+        printf ("test_spool: %s %s a log file\n", job->name,
+            job->log ? "has no" : "has");
+        return (ERROR);
+    }
+
+    snprintf (done_file, sizeof (done_file), "%s/%s%s", spool_dir, job->name,
+        SPOOL_DONE_EXT);
+    fp = fopen (done_file, "r");
+    if (fp == NULL)
+    {
+        printf ("test_spool: %s has no completion record\n", job->name);
+        return (ERROR);
+    }
+    while (fgets (line, sizeof (line), fp) != NULL)
+    {
+        cptr = strchr (line, '\n');
+        if (cptr != NULL)
+            *cptr = '\0';
+        if (!strncmp (line, "job=", 4) && !strcmp (line + 4, job->name))
+            job_ok = true;
+        else if (!strcmp (line, "status=failed"))
+            status_ok = true;
+        else if (!strncmp (line, "message=", 8) &&
+            !strncmp (line + 8, job->message, strlen (job->message)))
+            message_ok = true;
+    }
+    fclose (fp);
+
+    if (!job_ok || !status_ok || !message_ok)
+    {
+        printf ("test_spool: completion record of %s is missing the%s%s%s\n",
+            job->name, job_ok ? "" : " job name", status_ok ? "" : " status",
+            message_ok ? "" : " message");
+        return (ERROR);
+    }
+
+    printf ("test_spool: %s%s -> %s%s, %s\n", job->name, job->ext, job->name,
+        SPOOL_DONE_EXT, job->message);
+    return (SUCCESS);
+}
+
+
+int main (void)
+{
+    char spool_dir[] = "/tmp/lasrc_spool_XXXXXX";  /* temporary spool */
+    char command[STR_SIZE];      /* command to remove the spool */
+    int i;                       /* looping variable for the jobs */
+    int ndone;                   /* number of completion records written */
+    int nbad = 0;                /* number of jobs not handled as expected */
+    int status;                  /* exit status of the worker */
+    int waited;                  /* seconds waited for the worker */
+    pid_t pid;                   /* process ID of the worker */
+
+    if (mkdtemp (spool_dir) == NULL)
+    {
+        printf ("test_spool: creating the temporary spool directory\n");
+        return (EXIT_FAILURE);
+    }
+
+    /* Drop the jobs in the spool, along with the claimed job left behind by
+       a worker which died */
+    for (i = 0; i < NTEST_JOBS; i++)
+    {
+        if (write_test_file (spool_dir, test_jobs[i].name, test_jobs[i].ext,
+            test_jobs[i].contents) != SUCCESS)
+        {
+            printf ("test_spool: writing the job file for %s\n",
+                test_jobs[i].name);
+            return (EXIT_FAILURE);
+        }
+    }
+
+    /* Run a TOA-only worker on the spool, with its output in worker.log */
+    fflush (stdout);
+    pid = fork ();
+    if (pid < 0)
+    {
+        printf ("test_spool: starting the worker\n");
+        return (EXIT_FAILURE);
+    }
+    if (pid == 0)
+    {
+        snprintf (command, sizeof (command), "%s/worker.log", spool_dir);
+        if (freopen (command, "w", stdout) == NULL ||
+            dup2 (fileno (stdout), fileno (stderr)) < 0)
+            _exit (EXIT_FAILURE);
+        _exit (run_spool_worker (spool_dir, false, false, 2, 1, FORMAT_RAW, 1,
+            false, false) == SUCCESS ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    /* Wait for the completion records, then stop the worker */
+    for (waited = 0; waited < TEST_TIMEOUT; waited++)
+    {
+        ndone = 0;
+        for (i = 0; i < NTEST_JOBS; i++)
+        {
+            if (spool_file_exists (spool_dir, test_jobs[i].name,
+                SPOOL_DONE_EXT))
+                ndone++;
+        }
+        if (ndone == NTEST_JOBS)
+            break;
+        sleep (1);
+    }
+    if (write_test_file (spool_dir, SPOOL_STOP_FILE, "", "") != SUCCESS)
+        kill (pid, SIGTERM);
+    if (waitpid (pid, &status, 0) != pid || !WIFEXITED (status) ||
+        WEXITSTATUS (status) != EXIT_SUCCESS)
+    {
+        printf ("test_spool: the worker didn't stop cleanly\n");
+        nbad++;
+    }
+    if (spool_file_exists (spool_dir, SPOOL_STOP_FILE, ""))
+    {
+        printf ("test_spool: the worker didn't remove the stop file\n");
+        nbad++;
+    }
+
+    for (i = 0; i < NTEST_JOBS; i++)
+    {
+        if (check_job (spool_dir, &test_jobs[i]) != SUCCESS)
+            nbad++;
+    }
+
+    if (nbad > 0)
+    {
+        printf ("test_spool: FAILED; the spool is left in %s\n", spool_dir);
+        return (EXIT_FAILURE);
+    }
+
+    snprintf (command, sizeof (command), "rm -rf %s", spool_dir);
+    if (system (command) != 0)
+        printf ("test_spool: removing %s\n", spool_dir);
+    printf ("test_spool: passed\n");
+    return (EXIT_SUCCESS);
+}
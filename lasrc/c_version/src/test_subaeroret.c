@@ -0,0 +1,449 @@
+/*****************************************************************************
+FILE: test_subaeroret.c
+
+PURPOSE: Checks the AOT retrieval of subaeroret_new against the original
+version of the routine, which corrected each band with atmcorlamb2_new at
+each AOT, and the retrieval of the three eps values by subaeroret_eps against
+the subaeroret_new calls it replaces.  Built and run by 'make check'.
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+LICENSE TYPE:  NASA Open Source Agreement Version 1.3
+
+NOTES:
+  1. Each sampled aerosol window gets random TOA reflectances, band ratios,
+     gaseous transmittances, and polynomial coefficients, in the ranges seen
+     in the scenes.  The retrieval is run as compute_sr_refl ran it before
+     subaeroret_eps: for eps 1.0, 1.75, and 2.5 passing the AOT index from
+     one call to the next, then for an eps in between.  Every fifth window
+     uses eps < 0 for the last call, which turns off the angstrom factor.
+  2. The windows come from a fixed-seed generator, so each run checks the
+     same windows.
+  3. The check fails if the raot or residual of any call differ by more than
+     MAX_REL_DIFF (relative) from the original, or the AOT index passed out
+     differs.
+  4. subaeroret_eps is then run for eps 1.0, 1.75, and 2.5, and checked
+     against the three subaeroret_new calls with the same tolerance: the
+     raot and residual of each eps, and the AOT index passed out for the
+     last call.
+*****************************************************************************/
+#include "lut_subr.h"
+
+/* Number of aerosol windows checked */
+#define NWINDOWS 200000
+
+/* Maximum relative difference allowed in raot and residual */
+#define MAX_REL_DIFF 1e-6
+
+/* Random numbers from a fixed generator, so the windows don't depend on the
+   C library */
+static unsigned long seed = 7;
+
+static float random_range
+(
+    float low,          /* I: lower end of the range */
+    float high          /* I: upper end of the range */
+)
+{
+    seed = seed * 1103515245UL + 12345UL;
+    return (low + (high - low) * ((seed >> 16) & 0x7fff) / 32767.0);
+}
+
+
+/******************************************************************************
+MODULE:  ref_subaeroret
+
+PURPOSE:  Original version of subaeroret_new, correcting each band with
+atmcorlamb2_new at each AOT.
+
+RETURN VALUE:
+Type = N/A
+
+NOTES:
+  1. This is subaeroret_new as it was before the angstrom factor was
+     computed once per call, less the unused xrorayp_arr parameter and
+     ros3 variable.
+******************************************************************************/
+static void ref_subaeroret
+(
+    int iband1,                            /* I: band 1 index (0-based) */
+    int iband3,                            /* I: band 3 index (0-based) */
+    float erelc[NSR_BANDS],                /* I: band ratio variable */
+    float troatm[NSR_BANDS],               /* I: toa reflectance */
+    float tgo_arr[NREFL_BANDS],            /* I: per-band other gaseous
+                                                 transmittance */
+    int roatm_iaMax[NREFL_BANDS],          /* I: roatm_iaMax */
+    float roatm_coef[NREFL_BANDS][NCOEF],  /* I: per band polynomial
+                                                 coefficients for roatm */
+    float ttatmg_coef[NREFL_BANDS][NCOEF], /* I: per band polynomial
+                                                 coefficients for ttatmg */
+    float satm_coef[NREFL_BANDS][NCOEF],   /* I: per band polynomial
+                                                 coefficients for satm */
+    float normext_p0a3_arr[NREFL_BANDS],   /* I: normext[iband][0][3] */
+    float *raot,     /* O: AOT reflectance */
+    float *residual, /* O: model residual */
+    int *iaots,      /* I/O: AOT index that is passed in and out for multiple
+                             calls (0-based) */
+    float eps        /* I: angstroem coefficient; spectral dependency of AOT */
+)
+{
+    int iaot;               /* aerosol optical thickness (AOT) index */
+    int ib;                 /* band index */
+    float raot550nm=0.0;    /* nearest input value of AOT */
+    float roslamb;          /* lambertian surface reflectance */
+    double ros1;            /* surface reflectance for band 1 */
+    double raot1, raot2;    /* AOT ratios that bracket the predicted ratio */
+    float raotsaved;        /* save the raot value */
+    double residual1, residual2;  /* residuals for storing and comparing */
+    double residualm;       /* local model residual */
+    int nbval;              /* number of values meeting criteria */
+    bool testth;            /* surface reflectance test variable */
+    double xa, xb, xc, xd, xe, xf;  /* AOT ratio values */
+    double coefa, coefb;    /* AOT ratio coefficients */
+    double raotmin;         /* minimum AOT ratio */
+    int iaot1, iaot2;       /* AOT indices (0-based) */
+    float tth[NSR_BANDS] = {1.0e-03, 1.0e-03, 0.0, 1.0e-03, 0.0, 0.0, 1.0e-04,
+                            0.0}; /* constant values for comparing against the
+                                     surface reflectance */
+    float aot550nm[NAOT_VALS] = {0.01, 0.05, 0.1, 0.15, 0.2, 0.3, 0.4, 0.6,
+                                 0.8, 1.0, 1.2, 1.4, 1.6, 1.8, 2.0, 2.3, 2.6,
+                                 3.0, 3.5, 4.0, 4.5, 5.0}; /* AOT values */
+
+    /* Correct band 3 and band 1 with increasing AOT (using pre till ratio is
+       equal to erelc[2]) */
+    iaot = *iaots;
+    residual1 = 2000.0;
+    residual2 = 1000.0;
+    iaot2 = 0;
+    iaot1 = 0;
+    raot2 = 1.0e-06;
+    raot1 = 0.0001;
+    ros1 = 1.0;
+    raot550nm = aot550nm[iaot];
+    testth = false;
+
+    /* Atmospheric correction for band 1 */
+    ib = iband1;
+    atmcorlamb2_new (tgo_arr[ib], 0.0, aot550nm[roatm_iaMax[ib]],
+        &roatm_coef[ib][0], &ttatmg_coef[ib][0], &satm_coef[ib][0], raot550nm,
+        ib, normext_p0a3_arr[ib], troatm[ib], &roslamb, eps);
+
+    if (roslamb - tth[iband1] < 0.0)
+        testth = true;
+    ros1 = roslamb;
+
+    /* Atmospheric correction for each band */
+    nbval = 0;
+    *residual = 0.0;
+    for (ib = DN_BAND1; ib < DN_BAND8; ib++)
+    {
+        /* Don't reprocess iband1 */
+        if ((erelc[ib] > 0.0) && (ib != iband1))
+        {
+            atmcorlamb2_new (tgo_arr[ib], 0.0,
+                aot550nm[roatm_iaMax[ib]], &roatm_coef[ib][0],
+                &ttatmg_coef[ib][0], &satm_coef[ib][0], raot550nm, ib,
+                normext_p0a3_arr[ib], troatm[ib], &roslamb, eps);
+
+            if (roslamb - tth[ib] < 0.0)
+                testth = true;
+            *residual += (roslamb - erelc[ib] * ros1) *
+                         (roslamb - erelc[ib] * ros1);
+            nbval++;
+        }
+    }
+    *residual = sqrt (*residual) / nbval;
+
+    /* Loop until we converge on a solution */
+    iaot++;
+    while ((iaot < NAOT_VALS) && (*residual < residual1) && (!testth))
+    {
+        /* Reset variables for this loop */
+        residual2 = residual1;
+        iaot2 = iaot1;
+        raot2 = raot1;
+        residual1 = *residual;
+        raot1 = raot550nm;
+        iaot1 = iaot;
+        raot550nm = aot550nm[iaot];
+
+        /* Atmospheric correction for band 1 */
+        ib = iband1;
+        testth = false;
+        atmcorlamb2_new (tgo_arr[ib], 0.0,
+            aot550nm[roatm_iaMax[ib]], &roatm_coef[ib][0], &ttatmg_coef[ib][0],
+            &satm_coef[ib][0], raot550nm, ib, normext_p0a3_arr[ib], troatm[ib],
+            &roslamb, eps);
+
+        if (roslamb - tth[iband1] < 0.0)
+            testth = true;
+        ros1 = roslamb;
+
+        /* Atmospheric correction for each band */
+        nbval = 0;
+        *residual = 0.0;
+        for (ib = DN_BAND1; ib < DN_BAND8; ib++)
+        {
+            /* Don't reprocess iband1 */
+            if ((erelc[ib] > 0.0) && (ib != iband1))
+            {
+                atmcorlamb2_new (tgo_arr[ib], 0.0,
+                    aot550nm[roatm_iaMax[ib]], &roatm_coef[ib][0],
+                    &ttatmg_coef[ib][0], &satm_coef[ib][0], raot550nm, ib,
+                    normext_p0a3_arr[ib], troatm[ib], &roslamb, eps);
+
+                if (roslamb - tth[ib] < 0.0)
+                    testth = true;
+                *residual += (roslamb - erelc[ib] * ros1) *
+                             (roslamb - erelc[ib] * ros1);
+                nbval++;
+            }
+        }
+        *residual = sqrt (*residual) / nbval;
+
+        /* Move to the next AOT index */
+        iaot++;
+    }  /* while aot */
+
+    /* If a minimum local was not reached for raot1, then just use the
+       raot550nm value.  Otherwise continue to refine the raot. */
+    if (iaot == 1)
+    {
+        *raot = raot550nm;
+    }
+    else
+    {
+        /* Refine the AOT ratio */
+        *raot = raot550nm;
+        raotsaved = *raot;
+        xa = (raot1 * raot1) - (*raot * *raot);
+        xd = (raot2 * raot2) - (*raot * *raot);
+        xb = raot1 - *raot;
+        xe = raot2 - *raot;
+        xc = residual1 - *residual;
+        xf = residual2 - *residual;
+        coefa = (xc * xe - xb * xf) / (xa * xe - xb * xd);
+        coefb = (xa * xf - xc * xd) / (xa * xe - xb * xd);
+        raotmin = -coefb / (2.0 * coefa);
+
+        /* Validate the min AOT ratio */
+        if (raotmin < 0.01 || raotmin > 4.0)
+            raotmin = *raot;
+
+        /* Atmospheric correction for band 1 */
+        raot550nm = raotmin;
+        ib = iband1;
+        testth = false;
+        atmcorlamb2_new (tgo_arr[ib], 0.0,
+            aot550nm[roatm_iaMax[ib]], &roatm_coef[ib][0], &ttatmg_coef[ib][0],
+            &satm_coef[ib][0], raot550nm, ib, normext_p0a3_arr[ib], troatm[ib],
+            &roslamb, eps);
+
+        if (roslamb - tth[iband1] < 0.0)
+            testth = true;
+        ros1 = roslamb;
+
+        /* Atmospheric correction for each band */
+        nbval = 0;
+        residualm = 0.0;
+        for (ib = DN_BAND1; ib < DN_BAND8; ib++)
+        {
+            /* Don't reprocess iband1 */
+            if ((erelc[ib] > 0.0) && (ib != iband1))
+            {
+                atmcorlamb2_new (tgo_arr[ib], 0.0,
+                    aot550nm[roatm_iaMax[ib]], &roatm_coef[ib][0],
+                    &ttatmg_coef[ib][0], &satm_coef[ib][0], raot550nm, ib,
+                    normext_p0a3_arr[ib], troatm[ib], &roslamb, eps);
+
+                if (roslamb - tth[ib] < 0.0)
+                    testth = true;
+                residualm += (roslamb - erelc[ib] * ros1) *
+                             (roslamb - erelc[ib] * ros1);
+                nbval++;
+            }
+        }
+
+        residualm = sqrt (residualm) / nbval;
+        *raot = raot550nm;
+
+        /* Check the residuals and reset the AOT ratio */
+        if (residualm > *residual)
+        {
+            residualm = *residual;
+            *raot = raotsaved;
+        }
+        if (residualm > residual1)
+        {
+            residualm = residual1;
+            *raot = raot1;
+        }
+        if (residualm > residual2)
+        {
+            residualm = residual2;
+            *raot = raot2;
+        }
+
+        *residual = residualm;
+        *iaots = MAX ((iaot2 - 3), 0);
+    }
+}
+
+
+/******************************************************************************
+MODULE:  rel_diff
+
+PURPOSE:  Computes the relative difference of a value from the reference.
+
+RETURN VALUE:
+Type = double
+Value           Description
+-----           -----------
+diff            |value - ref| / |ref|, or |value| if ref is 0
+******************************************************************************/
+static double rel_diff
+(
+    float value,        /* I: value to be checked */
+    float ref           /* I: reference value */
+)
+{
+    if (ref == 0.0)
+        return (fabs (value));
+    return (fabs ((double) value - ref) / fabs (ref));
+}
+
+
+int main (void)
+{
+    int iwin;                   /* looping variable for the windows */
+    int ib;                     /* looping variable for the bands */
+    int icall;                  /* looping variable for the eps calls */
+    int iaots, ref_iaots;       /* AOT index passed between the calls */
+    int nbad = 0;               /* number of calls which don't match */
+    int neps_bad = 0;           /* number of subaeroret_eps retrievals which
+                                   don't match */
+    int eps_iaots;              /* AOT index passed out by subaeroret_eps */
+    int eps_iaots_new;          /* AOT index passed out by the third
+                                   subaeroret_new call */
+    float eps_raot[NAERO_EPS];      /* raot of subaeroret_eps per eps */
+    float eps_residual[NAERO_EPS];  /* residual of subaeroret_eps per eps */
+    float new_raot[NAERO_EPS];      /* raot of subaeroret_new per eps */
+    float new_residual[NAERO_EPS];  /* residual of subaeroret_new per eps */
+    double aero_fact[NSR_BANDS][NAERO_EPS];  /* angstrom factor for each
+                                   band and eps */
+    float raot, ref_raot;       /* retrieved AOT */
+    float residual, ref_residual;  /* model residual */
+    float eps;                  /* angstroem coefficient */
+    float eps_calls[4] = {1.0, 1.75, 2.5, 0.0};  /* eps of each call; the
+                                   last is set for each window */
+    double diff;                /* relative difference */
+    double max_raot_diff = 0.0;     /* maximum raot difference */
+    double max_residual_diff = 0.0; /* maximum residual difference */
+    double max_eps_raot_diff = 0.0;     /* maximum raot difference of
+                                           subaeroret_eps */
+    double max_eps_residual_diff = 0.0; /* maximum residual difference of
+                                           subaeroret_eps */
+    float erelc[NSR_BANDS];     /* band ratio variable */
+    float troatm[NSR_BANDS];    /* toa reflectance */
+    float tgo_arr[NREFL_BANDS]; /* other gaseous transmittance */
+    int roatm_iaMax[NREFL_BANDS];          /* roatm upper bound index */
+    float roatm_coef[NREFL_BANDS][NCOEF];  /* roatm coefficients */
+    float ttatmg_coef[NREFL_BANDS][NCOEF]; /* ttatmg coefficients */
+    float satm_coef[NREFL_BANDS][NCOEF];   /* satm coefficients */
+    float normext_p0a3_arr[NREFL_BANDS];   /* normext[iband][0][3] */
+
+    angstrom_factors (eps_calls, aero_fact);
+    for (iwin = 0; iwin < NWINDOWS; iwin++)
+    {
+        /* Sample the window */
+        for (ib = 0; ib < NREFL_BANDS; ib++)
+        {
+            erelc[ib] = -1.0;
+            troatm[ib] = random_range (0.0, 0.4);
+            tgo_arr[ib] = random_range (0.8, 1.0);
+            roatm_iaMax[ib] = (int) random_range (0.0, NAOT_VALS - 0.01);
+            normext_p0a3_arr[ib] = random_range (0.5, 1.5);
+            roatm_coef[ib][0] = random_range (-0.01, 0.01);
+            roatm_coef[ib][1] = random_range (-0.05, 0.05);
+            roatm_coef[ib][2] = random_range (0.0, 0.2);
+            roatm_coef[ib][3] = random_range (0.0, 0.1);
+            ttatmg_coef[ib][0] = random_range (-0.01, 0.01);
+            ttatmg_coef[ib][1] = random_range (-0.05, 0.05);
+            ttatmg_coef[ib][2] = random_range (-0.3, 0.0);
+            ttatmg_coef[ib][3] = random_range (0.8, 1.0);
+            satm_coef[ib][0] = random_range (-0.01, 0.01);
+            satm_coef[ib][1] = random_range (-0.02, 0.02);
+            satm_coef[ib][2] = random_range (0.0, 0.1);
+            satm_coef[ib][3] = random_range (0.0, 0.1);
+        }
+        erelc[DN_BAND1] = random_range (0.3, 1.0);
+        erelc[DN_BAND2] = random_range (0.3, 1.0);
+        erelc[DN_BAND4] = 1.0;
+        erelc[DN_BAND7] = random_range (0.5, 2.5);
+        eps_calls[3] = (iwin % 5 == 0) ? -1.0 : random_range (1.0, 2.5);
+
+        /* Retrieve the AOT as compute_sr_refl does */
+        iaots = ref_iaots = 0;
+        for (icall = 0; icall < 4; icall++)
+        {
+            eps = eps_calls[icall];
+            subaeroret_new (DN_BAND4, DN_BAND1, erelc, troatm, tgo_arr,
+                roatm_iaMax, roatm_coef, ttatmg_coef, satm_coef,
+                normext_p0a3_arr, &raot, &residual, &iaots, eps);
+            ref_subaeroret (DN_BAND4, DN_BAND1, erelc, troatm, tgo_arr,
+                roatm_iaMax, roatm_coef, ttatmg_coef, satm_coef,
+                normext_p0a3_arr, &ref_raot, &ref_residual, &ref_iaots, eps);
+
+            diff = rel_diff (raot, ref_raot);
+            max_raot_diff = MAX (max_raot_diff, diff);
+            if (diff > MAX_REL_DIFF || iaots != ref_iaots)
+                nbad++;
+            diff = rel_diff (residual, ref_residual);
+            max_residual_diff = MAX (max_residual_diff, diff);
+            if (diff > MAX_REL_DIFF)
+                nbad++;
+
+            if (icall < NAERO_EPS)
+            {
+                new_raot[icall] = raot;
+                new_residual[icall] = residual;
+                eps_iaots_new = iaots;
+            }
+        }
+
+        /* Retrieve the three eps values together */
+        subaeroret_eps (DN_BAND4, DN_BAND1, erelc, troatm, tgo_arr,
+            roatm_iaMax, roatm_coef, ttatmg_coef, satm_coef, normext_p0a3_arr,
+            eps_calls, aero_fact, eps_raot, eps_residual, &eps_iaots);
+        if (eps_iaots != eps_iaots_new)
+            neps_bad++;
+        for (icall = 0; icall < NAERO_EPS; icall++)
+        {
+            diff = rel_diff (eps_raot[icall], new_raot[icall]);
+            max_eps_raot_diff = MAX (max_eps_raot_diff, diff);
+            if (diff > MAX_REL_DIFF)
+                neps_bad++;
+            diff = rel_diff (eps_residual[icall], new_residual[icall]);
+            max_eps_residual_diff = MAX (max_eps_residual_diff, diff);
+            if (diff > MAX_REL_DIFF)
+                neps_bad++;
+        }
+    }
+
+    printf ("test_subaeroret: %d windows, max relative difference from the "
+        "original: raot %g, residual %g\n", NWINDOWS, max_raot_diff,
+        max_residual_diff);
+    printf ("test_subaeroret: subaeroret_eps, max relative difference from "
+        "subaeroret_new: raot %g, residual %g\n", max_eps_raot_diff,
+        max_eps_residual_diff);
+    if (nbad > 0 || neps_bad > 0)
+    {
+        printf ("test_subaeroret: FAILED, %d retrievals and %d "
+            "subaeroret_eps retrievals differ (tolerance %g)\n", nbad,
+            neps_bad, MAX_REL_DIFF);
+        return (EXIT_FAILURE);
+    }
+    printf ("test_subaeroret: passed\n");
+    return (EXIT_SUCCESS);
+}
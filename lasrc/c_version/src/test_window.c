@@ -0,0 +1,450 @@
+/*****************************************************************************
+FILE: test_window.c
+
+PURPOSE: Checks that the pixels of a window of the scene, read and corrected
+with the margin added by pad_window, get the same aerosol interpolation as in
+a full scene run.  Built and run by 'make check'.
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+LICENSE TYPE:  NASA Open Source Agreement Version 1.3
+
+NOTES:
+  1. A synthetic scene is given random QA (clear, fill, cloud, and shadow),
+     random band 4/5 reflectances (some of them water), and random aerosol
+     window centers (clear, water, or failed), as left by the aerosol
+     inversion.  aerosol_fill_interp is run over the full scene, and over the
+     window read for each of several windows (including ones at the end of
+     the scene and with angle decimation), and the output window pixels are
+     compared.
+  2. With the median aerosol of the full scene carried into the window (as
+     done by --median_aerosol), all the window pixels must match.  With the
+     median aerosol found over the window, the pixels which don't use the
+     median aerosol must match.  These are found by running the full scene
+     with a second median value and keeping the pixels which don't change.
+*****************************************************************************/
+#include "lasrc.h"
+#include "aero_interp.h"
+#include "tile_sched.h"
+#include "window.h"
+
+/* Size of the synthetic scene, which leaves a partial aerosol window at the
+   end of the lines and samples */
+#define TEST_NLINES 301
+#define TEST_NSAMPS 262
+
+/* Windows of the scene checked, and the angle decimation used for them */
+typedef struct {
+    int line0, samp0, nlines, nsamps;  /* window of the scene */
+    int decimation;                    /* angle decimation */
+} Test_window_t;
+
+static Test_window_t test_windows[] = {
+    {0, 0, 10, 10, 1},
+    {0, 0, 10, 10, 4},
+    {50, 61, 40, 33, 1},
+    {101, 29, 1, 1, 1},
+    {100, 0, 1, TEST_NSAMPS, 3},
+    {0, 130, TEST_NLINES, 7, 5},
+    {290, 250, 11, 12, 1},
+    {286, 244, 15, 18, 8},
+    {148, 149, 5, 5, 16}
+};
+#define NTEST_WINDOWS \
+    ((int) (sizeof (test_windows) / sizeof (test_windows[0])))
+
+/* Structure for the arrays of a scene (or window) before and after the
+   aerosol interpolation */
+typedef struct {
+    int nlines, nsamps;   /* size of the arrays */
+    int16 *sband[SR_BAND5+1];  /* band 4 and 5 reflectances; the others are
+                                  not used */
+    uint16 *qaband;       /* Level-1 QA */
+    uint8 *ipflag;        /* ipflag */
+    float *taero;         /* aerosol values */
+    float *teps;          /* angstrom coefficients */
+} Test_scene_t;
+
+/* Random numbers from a fixed generator, so the scene is the same on every
+   run */
+static unsigned long seed = 11;
+
+static double next_random ()
+{
+    seed = seed * 1103515245UL + 12345UL;
+    return ((double) ((seed >> 16) & 0x7fff) / 32768.0);
+}
+
+
+/******************************************************************************
+MODULE:  alloc_scene
+
+PURPOSE:  Allocates the arrays of a scene or window.
+
+RETURN VALUE:
+Type = bool
+Value           Description
+-----           -----------
+false           Error allocating the arrays
+true            Successful completion
+******************************************************************************/
+static bool alloc_scene
+(
+    int nlines,           /* I: number of lines */
+    int nsamps,           /* I: number of samples */
+    Test_scene_t *scene   /* O: scene arrays */
+)
+{
+    long npix = (long) nlines * nsamps;   /* number of pixels */
+
+    memset (scene, 0, sizeof (*scene));
+    scene->nlines = nlines;
+    scene->nsamps = nsamps;
+    scene->sband[SR_BAND4] = calloc (npix, sizeof (int16));
+    scene->sband[SR_BAND5] = calloc (npix, sizeof (int16));
+    scene->qaband = calloc (npix, sizeof (uint16));
+    scene->ipflag = calloc (npix, sizeof (uint8));
+    scene->taero = calloc (npix, sizeof (float));
+    scene->teps = calloc (npix, sizeof (float));
+    return (scene->sband[SR_BAND4] != NULL && scene->sband[SR_BAND5] != NULL &&
+        scene->qaband != NULL && scene->ipflag != NULL &&
+        scene->taero != NULL && scene->teps != NULL);
+}
+
+
+/******************************************************************************
+MODULE:  free_scene
+
+PURPOSE:  Frees the arrays of a scene or window.
+
+RETURN VALUE:
+Type = None
+******************************************************************************/
+static void free_scene
+(
+    Test_scene_t *scene   /* I: scene arrays */
+)
+{
+    free (scene->sband[SR_BAND4]);
+    free (scene->sband[SR_BAND5]);
+    free (scene->qaband);
+    free (scene->ipflag);
+    free (scene->taero);
+    free (scene->teps);
+}
+
+
+/******************************************************************************
+MODULE:  copy_window
+
+PURPOSE:  Copies a window of one scene's arrays into another, or the whole
+scene when the window is NULL.
+
+RETURN VALUE:
+Type = None
+******************************************************************************/
+static void copy_window
+(
+    Test_scene_t *from,   /* I: scene to copy from */
+    Window_t *window,     /* I: window of from to copy; NULL for all */
+    Test_scene_t *to      /* O: arrays of the window (already allocated) */
+)
+{
+    int line;             /* looping variable for the lines */
+    int line0 = 0, samp0 = 0;  /* start of the window */
+    long src, dst;        /* pixel offsets of the line */
+    int n = to->nsamps;   /* number of samples copied per line */
+
+    if (window != NULL)
+    {
+        line0 = window->line0;
+        samp0 = window->samp0;
+    }
+    for (line = 0; line < to->nlines; line++)
+    {
+        src = (long) (line0 + line) * from->nsamps + samp0;
+        dst = (long) line * to->nsamps;
+        memcpy (&to->sband[SR_BAND4][dst], &from->sband[SR_BAND4][src],
+            n * sizeof (int16));
+        memcpy (&to->sband[SR_BAND5][dst], &from->sband[SR_BAND5][src],
+            n * sizeof (int16));
+        memcpy (&to->qaband[dst], &from->qaband[src], n * sizeof (uint16));
+        memcpy (&to->ipflag[dst], &from->ipflag[src], n * sizeof (uint8));
+        memcpy (&to->taero[dst], &from->taero[src], n * sizeof (float));
+        memcpy (&to->teps[dst], &from->teps[src], n * sizeof (float));
+    }
+}
+
+
+/******************************************************************************
+MODULE:  find_qa_value
+
+PURPOSE:  Finds a Level-1 QA value which is fill, cloud, shadow, or clear as
+classified by LaSRC, so the test doesn't depend on the QA bits.
+
+RETURN VALUE:
+Type = uint16
+Value           Description
+-----           -----------
+value           First QA value of the class
+******************************************************************************/
+static uint16 find_qa_value
+(
+    int qa_class          /* I: 0 clear, 1 fill, 2 cloud, 3 shadow */
+)
+{
+    int value;            /* looping variable for the QA values */
+    bool fill, cloud, shadow;  /* classification of the value */
+
+    for (value = 0; value <= 0xffff; value++)
+    {
+        fill = level1_qa_is_fill (value);
+        cloud = !fill && is_cloud (value);
+        shadow = !fill && !cloud && is_shadow (value);
+        if ((qa_class == 0 && !fill && !cloud && !shadow) ||
+            (qa_class == 1 && fill) || (qa_class == 2 && cloud) ||
+            (qa_class == 3 && shadow))
+            return ((uint16) value);
+    }
+    return (0);
+}
+
+
+/******************************************************************************
+MODULE:  make_scene
+
+PURPOSE:  Fills the synthetic scene as left by the aerosol inversion.
+
+RETURN VALUE:
+Type = None
+******************************************************************************/
+static void make_scene
+(
+    Test_scene_t *scene   /* I/O: scene arrays */
+)
+{
+    int line, samp;       /* looping variables for the lines and samples */
+    long pix;             /* current pixel */
+    double r;             /* random number */
+    uint16 qa_clear = find_qa_value (0);   /* QA values of each class */
+    uint16 qa_fill = find_qa_value (1);
+    uint16 qa_cloud = find_qa_value (2);
+    uint16 qa_shadow = find_qa_value (3);
+
+    for (line = 0; line < scene->nlines; line++)
+    {
+        for (samp = 0; samp < scene->nsamps; samp++)
+        {
+            pix = (long) line * scene->nsamps + samp;
+
+            /* Fill along the west edge, and scattered cloud and shadow */
+            r = next_random ();
+            if (samp < 20 - line / 20)
+                scene->qaband[pix] = qa_fill;
+            else if (r < 0.08)
+                scene->qaband[pix] = qa_cloud;
+            else if (r < 0.12)
+                scene->qaband[pix] = qa_shadow;
+            else
+                scene->qaband[pix] = qa_clear;
+
+            /* About 10% water */
+            scene->sband[SR_BAND4][pix] = 500 + (int16) (next_random () *
+                1000);
+            if (next_random () < 0.1)
+                scene->sband[SR_BAND5][pix] = (int16) (next_random () * 400);
+            else
+                scene->sband[SR_BAND5][pix] = 2000 + (int16) (next_random () *
+                    2000);
+
+            /* The window centers are clear, water, or failed the inversion
+               (flagged as cloud) */
+            if (line % AERO_WINDOW == HALF_AERO_WINDOW &&
+                samp % AERO_WINDOW == HALF_AERO_WINDOW)
+            {
+                r = next_random ();
+                if (r < 0.7)
+                    scene->ipflag[pix] = (1 << IPFLAG_CLEAR);
+                else if (r < 0.85)
+                    scene->ipflag[pix] = (1 << IPFLAG_WATER);
+                else
+                    scene->ipflag[pix] = (1 << IPFLAG_CLOUD);
+                scene->taero[pix] = 0.01 + 0.5 * next_random ();
+                scene->teps[pix] = 1.0 + 1.5 * next_random ();
+            }
+        }
+    }
+}
+
+
+/******************************************************************************
+MODULE:  run_interp
+
+PURPOSE:  Runs the aerosol interpolation over a scene or window.
+
+RETURN VALUE:
+Type = bool
+Value           Description
+-----           -----------
+false           Error allocating the scheduling tiles
+true            Successful completion
+******************************************************************************/
+static bool run_interp
+(
+    Test_scene_t *scene,  /* I/O: scene arrays */
+    float median_aero     /* I: median aerosol value */
+)
+{
+    Tile_sched_t *tiles = NULL;   /* scheduling tiles, in scene order */
+
+    tiles = open_tile_sched (scene->nlines, scene->nsamps);
+    if (tiles == NULL)
+        return (false);
+    aerosol_fill_interp (scene->sband, scene->qaband, scene->ipflag,
+        scene->taero, scene->teps, median_aero, scene->nlines, scene->nsamps,
+        tiles);
+    close_tile_sched (tiles);
+    return (true);
+}
+
+
+int main (void)
+{
+    int iw;               /* looping variable for the windows */
+    int line, samp;       /* looping variables for the lines and samples */
+    int carried;          /* looping variable for carrying in the median */
+    long pix, wpix;       /* pixel in the scene and the window read */
+    long nchecked;        /* number of pixels compared for a window */
+    long nmedian = 0;     /* number of scene pixels using the median */
+    long nbad = 0;        /* number of pixels which don't match */
+    float median_aero;    /* median aerosol of the full scene */
+    float window_median;  /* median aerosol of the window read */
+    Window_t read_window; /* window read for the output window */
+    Window_t out_window;  /* output window */
+    Test_scene_t scene;   /* scene as left by the inversion */
+    Test_scene_t full;    /* scene after the interpolation */
+    Test_scene_t full2;   /* scene after the interpolation with another
+                             median */
+    Test_scene_t win;     /* window read, before and after the
+                             interpolation */
+    bool *uses_median = NULL;  /* does the scene pixel use the median? */
+
+    if (!alloc_scene (TEST_NLINES, TEST_NSAMPS, &scene) ||
+        !alloc_scene (TEST_NLINES, TEST_NSAMPS, &full) ||
+        !alloc_scene (TEST_NLINES, TEST_NSAMPS, &full2))
+    {
+        printf ("test_window: allocating the scene\n");
+        return (EXIT_FAILURE);
+    }
+    uses_median = calloc ((long) TEST_NLINES * TEST_NSAMPS, sizeof (bool));
+    if (uses_median == NULL)
+    {
+        printf ("test_window: allocating the scene\n");
+        return (EXIT_FAILURE);
+    }
+
+    /* Run the full scene with its median, and with another median to find
+       the pixels which use it */
+    make_scene (&scene);
+    median_aero = find_median_aerosol (scene.ipflag, scene.taero,
+        TEST_NLINES, TEST_NSAMPS);
+    copy_window (&scene, NULL, &full);
+    copy_window (&scene, NULL, &full2);
+    if (!run_interp (&full, median_aero) ||
+        !run_interp (&full2, median_aero + 0.125))
+    {
+        printf ("test_window: allocating the scheduling tiles\n");
+        return (EXIT_FAILURE);
+    }
+    for (pix = 0; pix < (long) TEST_NLINES * TEST_NSAMPS; pix++)
+    {
+        uses_median[pix] = full.taero[pix] != full2.taero[pix];
+        if (uses_median[pix])
+            nmedian++;
+    }
+    printf ("test_window: %d x %d scene, median aerosol %.9g, %ld pixels use "
+        "the median\n", TEST_NLINES, TEST_NSAMPS, median_aero, nmedian);
+
+    for (iw = 0; iw < NTEST_WINDOWS; iw++)
+    {
+        out_window.line0 = test_windows[iw].line0;
+        out_window.samp0 = test_windows[iw].samp0;
+        out_window.nlines = test_windows[iw].nlines;
+        out_window.nsamps = test_windows[iw].nsamps;
+        out_window.median_aerosol = 0.0;
+        pad_window (&out_window, TEST_NLINES, TEST_NSAMPS,
+            test_windows[iw].decimation, &read_window);
+        if (!alloc_scene (read_window.nlines, read_window.nsamps, &win))
+        {
+            printf ("test_window: allocating the window\n");
+            return (EXIT_FAILURE);
+        }
+
+        /* Run the window read with the median carried in from the full
+           scene, and with the median of the window */
+        for (carried = 1; carried >= 0; carried--)
+        {
+            copy_window (&scene, &read_window, &win);
+            window_median = find_median_aerosol (win.ipflag, win.taero,
+                win.nlines, win.nsamps);
+            if (!run_interp (&win, carried ? median_aero : window_median))
+            {
+                printf ("test_window: allocating the scheduling tiles\n");
+                return (EXIT_FAILURE);
+            }
+
+            nchecked = 0;
+            for (line = out_window.line0;
+                 line < out_window.line0 + out_window.nlines; line++)
+            {
+                for (samp = out_window.samp0;
+                     samp < out_window.samp0 + out_window.nsamps; samp++)
+                {
+                    pix = (long) line * TEST_NSAMPS + samp;
+                    wpix = (long) (line - read_window.line0) * win.nsamps +
+                        samp - read_window.samp0;
+                    if (!carried && uses_median[pix])
+                        continue;
+                    nchecked++;
+                    if (win.taero[wpix] != full.taero[pix] ||
+                        win.teps[wpix] != full.teps[pix] ||
+                        win.ipflag[wpix] != full.ipflag[pix])
+                    {
+                        if (nbad < 10)
+                            printf ("test_window: window %d (%s median) "
+                                "pixel %d,%d: aerosol %.9g eps %.9g ipflag "
+                                "%d, full scene %.9g %.9g %d\n", iw,
+                                carried ? "scene" : "window", line, samp,
+                                win.taero[wpix], win.teps[wpix],
+                                win.ipflag[wpix], full.taero[pix],
+                                full.teps[pix], full.ipflag[pix]);
+                        nbad++;
+                    }
+                }
+            }
+            printf ("test_window: window %d,%d %dx%d (decimation %d, read "
+                "%d,%d %dx%d) with the %s median %.9g: %ld pixels compared\n",
+                out_window.line0, out_window.samp0, out_window.nlines,
+                out_window.nsamps, test_windows[iw].decimation,
+                read_window.line0, read_window.samp0, read_window.nlines,
+                read_window.nsamps, carried ? "scene" : "window",
+                carried ? median_aero : window_median, nchecked);
+        }
+        free_scene (&win);
+    }
+
+    free_scene (&scene);
+    free_scene (&full);
+    free_scene (&full2);
+    free (uses_median);
+
+    if (nbad != 0)
+    {
+        printf ("test_window: FAILED, %ld pixels don't match the full "
+            "scene\n", nbad);
+        return (EXIT_FAILURE);
+    }
+    printf ("test_window: passed\n");
+    return (EXIT_SUCCESS);
+}
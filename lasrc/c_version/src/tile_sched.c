@@ -0,0 +1,261 @@
+/*****************************************************************************
+FILE: tile_sched.c
+
+PURPOSE: Contains functions for scheduling the surface reflectance loops over
+tiles of the scene.  The scene is split into tiles of SCHED_TILE_NWINDOWS x
+SCHED_TILE_NWINDOWS aerosol windows, the cost of each tile is estimated from
+the class plane, and the tiles are handed out to the OpenMP threads most
+expensive first.
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+LICENSE TYPE:  NASA Open Source Agreement Version 1.3
+
+NOTES:
+  1. The cost of a line varies enormously across a scene.  Fill, cloud, and
+     water skip most of the work, while clear land runs the full aerosol
+     inversion.  Splitting the lines evenly between the threads leaves the
+     threads with the clear lines running long after the others are done.
+  2. The loops take the tiles with schedule (dynamic, 1), so each thread takes
+     the next tile from the list when it finishes its current one.  Taking the
+     most expensive tiles first (longest processing time first) leaves only
+     the cheap tiles for the end of the loop, which keeps the threads
+     finishing at about the same time.
+  3. Each tile writes only its own pixels, so the results don't depend on
+     which thread processes a tile or in which order.
+*****************************************************************************/
+#include "tile_sched.h"
+
+/******************************************************************************
+MODULE:  compare_tiles
+
+PURPOSE:  Compares two tiles for sorting in decreasing order of cost.  Tiles of
+equal cost are kept in the order of their location in the scene.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+< 0             The first tile is taken before the second tile
+> 0             The first tile is taken after the second tile
+
+NOTES:
+******************************************************************************/
+static int compare_tiles
+(
+    const void *a,        /* I: first tile */
+    const void *b         /* I: second tile */
+)
+{
+    const Sched_tile_t *tile_a = a;   /* first tile */
+    const Sched_tile_t *tile_b = b;   /* second tile */
+
+    if (tile_a->cost != tile_b->cost)
+        return (tile_a->cost > tile_b->cost ? -1 : 1);
+    if (tile_a->first_line != tile_b->first_line)
+        return (tile_a->first_line - tile_b->first_line);
+    return (tile_a->first_samp - tile_b->first_samp);
+}
+
+
+/******************************************************************************
+MODULE:  open_tile_sched
+
+PURPOSE:  Allocates the list of tiles covering the scene.
+
+RETURN VALUE:
+Type = Tile_sched_t *
+Value           Description
+-----           -----------
+NULL            Error allocating the tile list
+non-NULL        Tile list, in the order of the tiles in the scene
+
+NOTES:
+  1. The tiles start on aerosol window boundaries.  The tiles at the end of
+     the lines and samples are smaller when the scene isn't a multiple of the
+     tile size.
+******************************************************************************/
+Tile_sched_t *open_tile_sched
+(
+    int nlines,           /* I: number of lines in the scene */
+    int nsamps            /* I: number of samples in the scene */
+)
+{
+    char FUNC_NAME[] = "open_tile_sched";   /* function name */
+    char errmsg[STR_SIZE];    /* error message */
+    int ntile_lines;          /* number of tiles along the lines */
+    int ntile_samps;          /* number of tiles along the samples */
+    int tline, tsamp;         /* looping variables for the tiles */
+    Sched_tile_t *tile = NULL;   /* current tile */
+    Tile_sched_t *this = NULL;   /* tile list to be returned */
+
+    this = calloc (1, sizeof (Tile_sched_t));
+    if (this == NULL)
+    {
+        sprintf (errmsg, "Error allocating memory for the tile list");
+        error_handler (true, FUNC_NAME, errmsg);
+        return (NULL);
+    }
+
+    ntile_lines = (nlines + SCHED_TILE_SIZE - 1) / SCHED_TILE_SIZE;
+    ntile_samps = (nsamps + SCHED_TILE_SIZE - 1) / SCHED_TILE_SIZE;
+    this->ntiles = ntile_lines * ntile_samps;
+    this->tile = calloc (MAX (this->ntiles, 1), sizeof (Sched_tile_t));
+    if (this->tile == NULL)
+    {
+        sprintf (errmsg, "Error allocating memory for %d tiles",
+            this->ntiles);
+        error_handler (true, FUNC_NAME, errmsg);
+        free (this);
+        return (NULL);
+    }
+
+    tile = this->tile;
+    for (tline = 0; tline < ntile_lines; tline++)
+    {
+        for (tsamp = 0; tsamp < ntile_samps; tsamp++, tile++)
+        {
+            tile->first_line = tline * SCHED_TILE_SIZE;
+            tile->end_line = MIN (tile->first_line + SCHED_TILE_SIZE, nlines);
+            tile->first_samp = tsamp * SCHED_TILE_SIZE;
+            tile->end_samp = MIN (tile->first_samp + SCHED_TILE_SIZE, nsamps);
+            tile->cost = 0;
+        }
+    }
+
+    return (this);
+}
+
+
+/******************************************************************************
+MODULE:  set_aero_tile_costs
+
+PURPOSE:  Estimates the cost of each tile for the aerosol inversion loop, and
+sorts the tiles in decreasing order of cost.
+
+RETURN VALUE:
+Type = None
+
+NOTES:
+  1. The aerosol inversion is only run for the windows which have a clear
+     pixel.  The other windows are given generic aerosol values.
+  2. The aerosol windows of a tile are those whose first line and sample are
+     in the tile (see AERO_NWINDOWS).
+******************************************************************************/
+void set_aero_tile_costs
+(
+    Tile_sched_t *this,   /* I/O: tile list */
+    uint8 *awin,          /* I: aerosol window summary,
+                                nwin_lines x nwin_samps */
+    int nwin_samps        /* I: number of aerosol window samples */
+)
+{
+    int t;                /* looping variable for the tiles */
+    int wline, wsamp;     /* looping variables for the aerosol windows */
+    long cost;            /* cost of the current tile */
+    Sched_tile_t *tile = NULL;   /* current tile */
+
+#ifdef _OPENMP
+    #pragma omp parallel for schedule (dynamic, 1) private (t, wline, wsamp, cost, tile)
+#endif
+    for (t = 0; t < this->ntiles; t++)
+    {
+        tile = &this->tile[t];
+        cost = 0;
+        for (wline = AERO_NWINDOWS (tile->first_line);
+             wline < AERO_NWINDOWS (tile->end_line); wline++)
+        {
+            for (wsamp = AERO_NWINDOWS (tile->first_samp);
+                 wsamp < AERO_NWINDOWS (tile->end_samp); wsamp++)
+            {
+                if (awin[wline * nwin_samps + wsamp] & (1 << AWIN_CLEAR))
+                    cost += SCHED_COST_INVERSION;
+                else
+                    cost += SCHED_COST_SKIP;
+            }
+        }
+        tile->cost = cost;
+    }
+
+    qsort (this->tile, this->ntiles, sizeof (Sched_tile_t), compare_tiles);
+}
+
+
+/******************************************************************************
+MODULE:  set_pixel_tile_costs
+
+PURPOSE:  Estimates the cost of each tile for the per-pixel aerosol
+interpolation and atmospheric correction loops, and sorts the tiles in
+decreasing order of cost.
+
+RETURN VALUE:
+Type = None
+
+NOTES:
+  1. Fill and cloud pixels are skipped by the atmospheric correction, and
+     are given the median aerosol by the aerosol interpolation.  Every other
+     pixel is interpolated and corrected.
+******************************************************************************/
+void set_pixel_tile_costs
+(
+    Tile_sched_t *this,   /* I/O: tile list */
+    uint8 *pclass,        /* I: class plane, nlines x nsamps */
+    int nsamps            /* I: number of samples in the scene */
+)
+{
+    int t;                /* looping variable for the tiles */
+    int line, samp;       /* looping variables for the lines and samples */
+    long curr_pix;        /* current pixel in the class plane */
+    long cost;            /* cost of the current tile */
+    uint8 skip = (1 << PCLASS_FILL) | (1 << PCLASS_CLOUD);
+                          /* classes of the pixels which are skipped */
+    Sched_tile_t *tile = NULL;   /* current tile */
+
+#ifdef _OPENMP
+    #pragma omp parallel for schedule (dynamic, 1) private (t, line, samp, curr_pix, cost, tile)
+#endif
+    for (t = 0; t < this->ntiles; t++)
+    {
+        tile = &this->tile[t];
+        cost = 0;
+        for (line = tile->first_line; line < tile->end_line; line++)
+        {
+            curr_pix = (long) line * nsamps + tile->first_samp;
+            for (samp = tile->first_samp; samp < tile->end_samp;
+                 samp++, curr_pix++)
+            {
+                if (pclass[curr_pix] & skip)
+                    cost += SCHED_COST_SKIP;
+                else
+                    cost += SCHED_COST_PIXEL;
+            }
+        }
+        tile->cost = cost;
+    }
+
+    qsort (this->tile, this->ntiles, sizeof (Sched_tile_t), compare_tiles);
+}
+
+
+/******************************************************************************
+MODULE:  close_tile_sched
+
+PURPOSE:  Frees the tile list.
+
+RETURN VALUE:
+Type = None
+
+NOTES:
+******************************************************************************/
+void close_tile_sched
+(
+    Tile_sched_t *this    /* I: tile list to be freed */
+)
+{
+    if (this == NULL)
+        return;
+
+    free (this->tile);
+    free (this);
+}
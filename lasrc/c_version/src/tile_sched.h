@@ -0,0 +1,70 @@
+#ifndef _TILE_SCHED_H_
+#define _TILE_SCHED_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "common.h"
+#include "error_handler.h"
+
+/* Define the number of aerosol windows along each side of a scheduling tile,
+   and the resulting tile size (lines/samples).  Tiles are aligned with the
+   aerosol windows, so a window is never split between two tiles. */
+#define SCHED_TILE_NWINDOWS 64
+#define SCHED_TILE_SIZE (SCHED_TILE_NWINDOWS * AERO_WINDOW)
+
+/* Define the relative costs used to estimate the work in each tile.  Only
+   their ratios matter, since they are used to order the tiles. */
+#define SCHED_COST_SKIP 1        /* window or pixel which is skipped or gets
+                                    generic values */
+#define SCHED_COST_PIXEL 8       /* pixel which is interpolated/corrected */
+#define SCHED_COST_INVERSION 200 /* aerosol window which runs the aerosol
+                                    inversion */
+
+/* Structure for a scheduling tile, a block of lines and samples processed as
+   a single task */
+typedef struct {
+    int first_line;       /* first line of the tile */
+    int end_line;         /* line after the last line of the tile */
+    int first_samp;       /* first sample of the tile */
+    int end_samp;         /* sample after the last sample of the tile */
+    long cost;            /* estimated cost of processing the tile */
+} Sched_tile_t;
+
+/* Structure for the list of tiles covering the scene.  Once the costs are
+   set, the tiles are in decreasing order of cost, so the threads taking them
+   from the list in order start the most expensive tiles first. */
+typedef struct {
+    int ntiles;           /* number of tiles */
+    Sched_tile_t *tile;   /* array of tiles [ntiles] */
+} Tile_sched_t;
+
+/* Prototypes */
+Tile_sched_t *open_tile_sched
+(
+    int nlines,           /* I: number of lines in the scene */
+    int nsamps            /* I: number of samples in the scene */
+);
+
+void set_aero_tile_costs
+(
+    Tile_sched_t *this,   /* I/O: tile list */
+    uint8 *awin,          /* I: aerosol window summary,
+                                nwin_lines x nwin_samps */
+    int nwin_samps        /* I: number of aerosol window samples */
+);
+
+void set_pixel_tile_costs
+(
+    Tile_sched_t *this,   /* I/O: tile list */
+    uint8 *pclass,        /* I: class plane, nlines x nsamps */
+    int nsamps            /* I: number of samples in the scene */
+);
+
+void close_tile_sched
+(
+    Tile_sched_t *this    /* I: tile list to be freed */
+);
+
+#endif
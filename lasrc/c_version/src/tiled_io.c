@@ -0,0 +1,612 @@
+/*****************************************************************************
+FILE: tiled_io.c
+
+PURPOSE: Contains functions for writing and reading bands in the tiled,
+compressed output format.  Each band is split into tiles (256x256 by default)
+which are compressed independently with zlib deflate, and a tile index is
+stored at the front of the file so any tile can be read without decompressing
+the rest of the band.
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+LICENSE TYPE:  NASA Open Source Agreement Version 1.3
+
+NOTES:
+  1. The tiles are compressed in parallel when OpenMP is enabled.
+  2. Multi-byte pixels are shuffled before compression, so the low-order bytes
+     of all the pixels in a tile are stored together, followed by the
+     high-order bytes.  The slowly varying high-order bytes (and the fill
+     areas) then compress very well.
+*****************************************************************************/
+#include "tiled_io.h"
+
+/******************************************************************************
+MODULE:  shuffle_tile
+
+PURPOSE:  Groups the bytes of each pixel in the tile by significance.
+
+RETURN VALUE:
+Type = N/A
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+NOTES:
+******************************************************************************/
+static void shuffle_tile
+(
+    unsigned char *in_buf,   /* I: tile data, npix x nbytes */
+    int npix,                /* I: number of pixels in the tile */
+    int nbytes,              /* I: number of bytes per pixel */
+    unsigned char *out_buf   /* O: shuffled tile data */
+)
+{
+    int i, b;                /* looping variables for pixels and bytes */
+
+    for (b = 0; b < nbytes; b++)
+        for (i = 0; i < npix; i++)
+            out_buf[b*npix + i] = in_buf[i*nbytes + b];
+}
+
+
+/******************************************************************************
+MODULE:  unshuffle_tile
+
+PURPOSE:  Restores the byte order of each pixel in a shuffled tile.
+
+RETURN VALUE:
+Type = N/A
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+NOTES:
+******************************************************************************/
+static void unshuffle_tile
+(
+    unsigned char *in_buf,   /* I: shuffled tile data, nbytes x npix */
+    int npix,                /* I: number of pixels in the tile */
+    int nbytes,              /* I: number of bytes per pixel */
+    unsigned char *out_buf   /* O: tile data */
+)
+{
+    int i, b;                /* looping variables for pixels and bytes */
+
+    for (b = 0; b < nbytes; b++)
+        for (i = 0; i < npix; i++)
+            out_buf[i*nbytes + b] = in_buf[b*npix + i];
+}
+
+
+/******************************************************************************
+MODULE:  write_tiled_band
+
+PURPOSE:  Splits the band into tiles, compresses the tiles, and writes the
+header, tile index, and compressed tiles to the output file.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error compressing or writing the band
+SUCCESS         No errors encountered
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+NOTES:
+  1. The entire compressed band is held in memory until it is written, which
+     is at most the size of the uncompressed band.
+******************************************************************************/
+int write_tiled_band
+(
+    FILE *fp,           /* I: file pointer for the output band, positioned at
+                              the start of the file */
+    void *buf,          /* I: band data to be written, nlines x nsamps */
+    int buf_nsamps,     /* I: number of samples in each line of buf; more
+                              than nsamps if the band is a window of buf */
+    int nlines,         /* I: number of lines in the band */
+    int nsamps,         /* I: number of samples in the band */
+    int nbytes,         /* I: number of bytes per pixel */
+    int tile_size,      /* I: number of lines and samples in a tile */
+    int level,          /* I: zlib compression level (1-9) */
+    long *out_size      /* O: total number of bytes written to the file */
+)
+{
+    char FUNC_NAME[] = "write_tiled_band";   /* function name */
+    char errmsg[STR_SIZE];    /* error message */
+    int itile;                /* looping variable for the tiles */
+    int ntiles;               /* total number of tiles */
+    int tline, tsamp;         /* tile row and column */
+    int line0, samp0;         /* first line and sample of the tile */
+    int tnlines, tnsamps;     /* number of lines and samples in the tile */
+    int line;                 /* looping variable for lines in the tile */
+    int nerrors = 0;          /* number of tiles which failed to compress */
+    long row_bytes;           /* number of bytes in a line of the tile */
+    int64_t offset;           /* file offset of the current tile */
+    uLongf csize;             /* compressed size of the tile */
+    unsigned char *band = (unsigned char *) buf;  /* band as bytes */
+    unsigned char *tile = NULL;     /* uncompressed tile */
+    unsigned char *shuffled = NULL; /* shuffled tile */
+    unsigned char **ctile = NULL;   /* compressed tiles */
+    Tiled_header_t hdr;       /* file header */
+    Tiled_index_t *index = NULL;    /* tile index */
+
+    if (tile_size < 1)
+        tile_size = DEFAULT_TILE_SIZE;
+
+    /* Set up the header */
+    memset (&hdr, 0, sizeof (hdr));
+    memcpy (hdr.magic, TILED_MAGIC, TILED_MAGIC_LEN);
+    hdr.nlines = nlines;
+    hdr.nsamps = nsamps;
+    hdr.nbytes = nbytes;
+    hdr.tile_nlines = tile_size;
+    hdr.tile_nsamps = tile_size;
+    hdr.ntile_lines = (nlines + tile_size - 1) / tile_size;
+    hdr.ntile_samps = (nsamps + tile_size - 1) / tile_size;
+    hdr.compression = TILED_DEFLATE;
+    hdr.filter = (nbytes > 1) ? TILED_SHUFFLE : 0;
+    ntiles = hdr.ntile_lines * hdr.ntile_samps;
+
+    /* Allocate the tile index and the compressed tile pointers */
+    index = calloc (ntiles, sizeof (Tiled_index_t));
+    ctile = calloc (ntiles, sizeof (unsigned char *));
+    if (index == NULL || ctile == NULL)
+    {
+        sprintf (errmsg, "Error allocating memory for the tile index");
+        error_handler (true, FUNC_NAME, errmsg);
+        free (index);
+        free (ctile);
+        return (ERROR);
+    }
+
+    /* Compress each of the tiles.  Each thread uses its own tile buffers. */
+#ifdef _OPENMP
+    #pragma omp parallel private (itile, tline, tsamp, line0, samp0, tnlines, tnsamps, line, row_bytes, csize, tile, shuffled)
+#endif
+    {
+        tile = malloc ((long) tile_size * tile_size * nbytes);
+        shuffled = malloc ((long) tile_size * tile_size * nbytes);
+
+#ifdef _OPENMP
+        #pragma omp for schedule (dynamic) reduction (+:nerrors)
+#endif
+        for (itile = 0; itile < ntiles; itile++)
+        {
+            if (tile == NULL || shuffled == NULL)
+            {
+                nerrors++;
+                continue;
+            }
+
+            /* Determine the location and size of this tile; tiles on the
+               right and bottom edges may be partial */
+            tline = itile / hdr.ntile_samps;
+            tsamp = itile % hdr.ntile_samps;
+            line0 = tline * tile_size;
+            samp0 = tsamp * tile_size;
+            tnlines = MIN (tile_size, nlines - line0);
+            tnsamps = MIN (tile_size, nsamps - samp0);
+            row_bytes = (long) tnsamps * nbytes;
+
+            /* Gather the tile from the band */
+            for (line = 0; line < tnlines; line++)
+                memcpy (&tile[line * row_bytes],
+                    &band[((long) (line0 + line) * buf_nsamps + samp0) *
+                    nbytes],
+                    row_bytes);
+            index[itile].usize = tnlines * row_bytes;
+
+            /* Shuffle and compress the tile */
+            if (hdr.filter == TILED_SHUFFLE)
+                shuffle_tile (tile, tnlines * tnsamps, nbytes, shuffled);
+            else
+                memcpy (shuffled, tile, index[itile].usize);
+
+            csize = compressBound (index[itile].usize);
+            ctile[itile] = malloc (csize);
+            if (ctile[itile] == NULL ||
+                compress2 (ctile[itile], &csize, shuffled,
+                index[itile].usize, level) != Z_OK)
+            {
+                nerrors++;
+                continue;
+            }
+            index[itile].csize = csize;
+        }
+
+        free (tile);
+        free (shuffled);
+    }
+
+    if (nerrors > 0)
+    {
+        sprintf (errmsg, "Error compressing %d of the %d tiles", nerrors,
+            ntiles);
+        error_handler (true, FUNC_NAME, errmsg);
+        for (itile = 0; itile < ntiles; itile++)
+            free (ctile[itile]);
+        free (ctile);
+        free (index);
+        return (ERROR);
+    }
+
+    /* Compute the tile offsets, which follow the header and index */
+    offset = sizeof (Tiled_header_t) + (int64_t) ntiles * sizeof (Tiled_index_t);
+    for (itile = 0; itile < ntiles; itile++)
+    {
+        index[itile].offset = offset;
+        offset += index[itile].csize;
+    }
+
+    /* Write the header, index, and compressed tiles */
+    if (fwrite (&hdr, sizeof (Tiled_header_t), 1, fp) != 1 ||
+        fwrite (index, sizeof (Tiled_index_t), ntiles, fp) != ntiles)
+    {
+        sprintf (errmsg, "Error writing the tiled band header and index");
+        error_handler (true, FUNC_NAME, errmsg);
+        nerrors++;
+    }
+
+    for (itile = 0; itile < ntiles; itile++)
+    {
+        if (nerrors == 0 &&
+            fwrite (ctile[itile], 1, index[itile].csize, fp) !=
+            index[itile].csize)
+        {
+            sprintf (errmsg, "Error writing tile %d", itile);
+            error_handler (true, FUNC_NAME, errmsg);
+            nerrors++;
+        }
+        free (ctile[itile]);
+    }
+    free (ctile);
+    free (index);
+
+    if (nerrors > 0)
+        return (ERROR);
+
+    *out_size = (long) offset;
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  open_tiled_band
+
+PURPOSE:  Opens a tiled band for reading and reads the header and tile index.
+
+RETURN VALUE:
+Type = Tiled_band_t *
+Value           Description
+-----           -----------
+NULL            Error opening or reading the tiled band
+non-NULL        Pointer to the tiled band structure
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+NOTES:
+  1. The tiled band structure holds a single file pointer and tile buffers.
+     Threads reading tiles concurrently should each open their own structure.
+******************************************************************************/
+Tiled_band_t *open_tiled_band
+(
+    char *file_name     /* I: name of the tiled band file to be read */
+)
+{
+    char FUNC_NAME[] = "open_tiled_band";   /* function name */
+    char errmsg[STR_SIZE];    /* error message */
+    int itile;                /* looping variable for the tiles */
+    int ntiles;               /* total number of tiles */
+    long max_usize;           /* size of a full uncompressed tile */
+    Tiled_band_t *this = NULL;   /* tiled band structure to be returned */
+
+    this = calloc (1, sizeof (Tiled_band_t));
+    if (this == NULL)
+    {
+        sprintf (errmsg, "Error allocating memory for the tiled band");
+        error_handler (true, FUNC_NAME, errmsg);
+        return (NULL);
+    }
+
+    this->fp = fopen (file_name, "rb");
+    if (this->fp == NULL)
+    {
+        sprintf (errmsg, "Unable to open the tiled band: %s", file_name);
+        error_handler (true, FUNC_NAME, errmsg);
+        free (this);
+        return (NULL);
+    }
+
+    /* Read and validate the header */
+    if (fread (&this->hdr, sizeof (Tiled_header_t), 1, this->fp) != 1 ||
+        memcmp (this->hdr.magic, TILED_MAGIC, TILED_MAGIC_LEN) ||
+        this->hdr.compression != TILED_DEFLATE ||
+        this->hdr.nbytes < 1 || this->hdr.tile_nlines < 1 ||
+        this->hdr.tile_nsamps < 1)
+    {
+        sprintf (errmsg, "Invalid tiled band header: %s", file_name);
+        error_handler (true, FUNC_NAME, errmsg);
+        close_tiled_band (this);
+        return (NULL);
+    }
+
+    /* Read the tile index and find the largest compressed tile */
+    ntiles = this->hdr.ntile_lines * this->hdr.ntile_samps;
+    this->index = calloc (ntiles, sizeof (Tiled_index_t));
+    if (this->index == NULL)
+    {
+        sprintf (errmsg, "Error allocating memory for the tile index");
+        error_handler (true, FUNC_NAME, errmsg);
+        close_tiled_band (this);
+        return (NULL);
+    }
+
+    if (fread (this->index, sizeof (Tiled_index_t), ntiles, this->fp) !=
+        ntiles)
+    {
+        sprintf (errmsg, "Error reading the tile index: %s", file_name);
+        error_handler (true, FUNC_NAME, errmsg);
+        close_tiled_band (this);
+        return (NULL);
+    }
+
+    this->cbuf_size = 0;
+    for (itile = 0; itile < ntiles; itile++)
+        if (this->index[itile].csize > this->cbuf_size)
+            this->cbuf_size = this->index[itile].csize;
+
+    /* Allocate the tile buffers */
+    max_usize = (long) this->hdr.tile_nlines * this->hdr.tile_nsamps *
+        this->hdr.nbytes;
+    this->cbuf = malloc (this->cbuf_size > 0 ? this->cbuf_size : 1);
+    this->ubuf = malloc (max_usize);
+    if (this->cbuf == NULL || this->ubuf == NULL)
+    {
+        sprintf (errmsg, "Error allocating memory for the tile buffers");
+        error_handler (true, FUNC_NAME, errmsg);
+        close_tiled_band (this);
+        return (NULL);
+    }
+
+    return (this);
+}
+
+
+/******************************************************************************
+MODULE:  get_tile_size
+
+PURPOSE:  Returns the number of lines and samples in the specified tile.
+Tiles on the right and bottom edges of the band may be partial tiles.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Invalid tile
+SUCCESS         No errors encountered
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+NOTES:
+******************************************************************************/
+int get_tile_size
+(
+    Tiled_band_t *this, /* I: tiled band structure */
+    int tile_line,      /* I: tile row (0-based) */
+    int tile_samp,      /* I: tile column (0-based) */
+    int *nlines,        /* O: number of lines in this tile */
+    int *nsamps         /* O: number of samples in this tile */
+)
+{
+    char FUNC_NAME[] = "get_tile_size";   /* function name */
+    char errmsg[STR_SIZE];    /* error message */
+
+    if (tile_line < 0 || tile_line >= this->hdr.ntile_lines ||
+        tile_samp < 0 || tile_samp >= this->hdr.ntile_samps)
+    {
+        sprintf (errmsg, "Invalid tile %d, %d", tile_line, tile_samp);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    *nlines = MIN (this->hdr.tile_nlines,
+        this->hdr.nlines - tile_line * this->hdr.tile_nlines);
+    *nsamps = MIN (this->hdr.tile_nsamps,
+        this->hdr.nsamps - tile_samp * this->hdr.tile_nsamps);
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  read_tile
+
+PURPOSE:  Reads and decompresses a single tile.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error reading or decompressing the tile
+SUCCESS         No errors encountered
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+NOTES:
+  1. The output buffer must hold at least tile_nlines x tile_nsamps pixels.
+     The tile is packed using the actual number of samples in the tile.
+******************************************************************************/
+int read_tile
+(
+    Tiled_band_t *this, /* I: tiled band structure */
+    int tile_line,      /* I: tile row (0-based) */
+    int tile_samp,      /* I: tile column (0-based) */
+    void *buf           /* O: tile data, packed as nlines x nsamps of this
+                              tile (see get_tile_size) */
+)
+{
+    char FUNC_NAME[] = "read_tile";   /* function name */
+    char errmsg[STR_SIZE];    /* error message */
+    int itile;                /* index of the tile */
+    int tnlines, tnsamps;     /* number of lines and samples in the tile */
+    uLongf usize;             /* uncompressed size of the tile */
+    Tiled_index_t *tindex = NULL;  /* index entry for this tile */
+
+    if (get_tile_size (this, tile_line, tile_samp, &tnlines, &tnsamps) !=
+        SUCCESS)
+    {
+        sprintf (errmsg, "Reading tile");
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+    itile = tile_line * this->hdr.ntile_samps + tile_samp;
+    tindex = &this->index[itile];
+
+    /* Read the compressed tile */
+    if (fseek (this->fp, (long) tindex->offset, SEEK_SET) ||
+        fread (this->cbuf, 1, tindex->csize, this->fp) != tindex->csize)
+    {
+        sprintf (errmsg, "Error reading tile %d, %d", tile_line, tile_samp);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    /* Decompress and unshuffle the tile */
+    usize = tindex->usize;
+    if (uncompress ((this->hdr.filter == TILED_SHUFFLE) ? this->ubuf : buf,
+        &usize, this->cbuf, tindex->csize) != Z_OK ||
+        usize != tindex->usize ||
+        usize != (uLongf) tnlines * tnsamps * this->hdr.nbytes)
+    {
+        sprintf (errmsg, "Error decompressing tile %d, %d", tile_line,
+            tile_samp);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    if (this->hdr.filter == TILED_SHUFFLE)
+        unshuffle_tile (this->ubuf, tnlines * tnsamps, this->hdr.nbytes, buf);
+
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  read_tiled_lines
+
+PURPOSE:  Reads the specified lines of the band from the tiles covering them.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error reading the lines
+SUCCESS         No errors encountered
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+NOTES:
+******************************************************************************/
+int read_tiled_lines
+(
+    Tiled_band_t *this, /* I: tiled band structure */
+    int iline,          /* I: first line to read (0-based) */
+    int nlines,         /* I: number of lines to read */
+    void *buf           /* O: band data, nlines x nsamps of the band */
+)
+{
+    char FUNC_NAME[] = "read_tiled_lines";   /* function name */
+    char errmsg[STR_SIZE];    /* error message */
+    int tline, tsamp;         /* tile row and column */
+    int tnlines, tnsamps;     /* number of lines and samples in the tile */
+    int line;                 /* current band line */
+    int nbytes = this->hdr.nbytes;   /* bytes per pixel */
+    long row_bytes;           /* number of bytes in a line of the tile */
+    unsigned char *tile = NULL;      /* decompressed tile */
+    unsigned char *out = (unsigned char *) buf;  /* output as bytes */
+
+    if (iline < 0 || nlines < 1 || iline + nlines > this->hdr.nlines)
+    {
+        sprintf (errmsg, "Invalid lines %d-%d", iline, iline+nlines-1);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    tile = malloc ((long) this->hdr.tile_nlines * this->hdr.tile_nsamps *
+        nbytes);
+    if (tile == NULL)
+    {
+        sprintf (errmsg, "Error allocating memory for the tile");
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    /* Loop through the tile rows which overlap the requested lines */
+    for (tline = iline / this->hdr.tile_nlines;
+         tline <= (iline + nlines - 1) / this->hdr.tile_nlines; tline++)
+    {
+        for (tsamp = 0; tsamp < this->hdr.ntile_samps; tsamp++)
+        {
+            if (read_tile (this, tline, tsamp, tile) != SUCCESS ||
+                get_tile_size (this, tline, tsamp, &tnlines, &tnsamps) !=
+                SUCCESS)
+            {
+                sprintf (errmsg, "Reading tile %d, %d", tline, tsamp);
+                error_handler (true, FUNC_NAME, errmsg);
+                free (tile);
+                return (ERROR);
+            }
+            row_bytes = (long) tnsamps * nbytes;
+
+            /* Copy the requested lines from this tile */
+            for (line = MAX (iline, tline * this->hdr.tile_nlines);
+                 line < MIN (iline + nlines,
+                     tline * this->hdr.tile_nlines + tnlines); line++)
+            {
+                memcpy (&out[((long) (line - iline) * this->hdr.nsamps +
+                    tsamp * this->hdr.tile_nsamps) * nbytes],
+                    &tile[(line - tline * this->hdr.tile_nlines) * row_bytes],
+                    row_bytes);
+            }
+        }
+    }
+
+    free (tile);
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  close_tiled_band
+
+PURPOSE:  Closes the tiled band and frees the tiled band structure.
+
+RETURN VALUE:
+Type = N/A
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+NOTES:
+******************************************************************************/
+void close_tiled_band
+(
+    Tiled_band_t *this  /* I: tiled band structure to close and free */
+)
+{
+    if (this == NULL)
+        return;
+
+    if (this->fp != NULL)
+        fclose (this->fp);
+    free (this->index);
+    free (this->cbuf);
+    free (this->ubuf);
+    free (this);
+}
@@ -0,0 +1,112 @@
+#ifndef _TILED_IO_H_
+#define _TILED_IO_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include "zlib.h"
+#include "common.h"
+#include "error_handler.h"
+
+/* Defines for the tiled, compressed band format.  The file consists of the
+   header, followed by the tile index (one entry per tile, in row-major tile
+   order), followed by the compressed tiles.  All values are written in the
+   native byte order of the machine writing the file. */
+#define TILED_MAGIC "LSRTILE1"     /* 8-character file signature */
+#define TILED_MAGIC_LEN 8
+#define DEFAULT_TILE_SIZE 256      /* default tile size (lines and samples) */
+#define DEFAULT_TILE_LEVEL 6       /* default zlib compression level */
+#define TILED_EXTENSION "zimg"     /* file extension for tiled bands */
+
+/* Define the compression methods and filters */
+#define TILED_DEFLATE 1            /* zlib deflate compression */
+#define TILED_SHUFFLE 1            /* bytes of each pixel are grouped by
+                                      significance before compression */
+
+/* Structure for the tiled band file header */
+typedef struct {
+    char magic[TILED_MAGIC_LEN];   /* file signature, TILED_MAGIC */
+    int32_t nlines;           /* number of lines in the band */
+    int32_t nsamps;           /* number of samples in the band */
+    int32_t nbytes;           /* number of bytes per pixel */
+    int32_t tile_nlines;      /* number of lines in a full tile */
+    int32_t tile_nsamps;      /* number of samples in a full tile */
+    int32_t ntile_lines;      /* number of tiles in the line direction */
+    int32_t ntile_samps;      /* number of tiles in the sample direction */
+    int32_t compression;      /* compression method, TILED_DEFLATE */
+    int32_t filter;           /* pre-compression filter, 0 or TILED_SHUFFLE */
+    int32_t spare;            /* unused; keeps the header 8-byte aligned */
+} Tiled_header_t;
+
+/* Structure for a single tile index entry */
+typedef struct {
+    int64_t offset;           /* byte offset of the compressed tile */
+    int32_t csize;            /* compressed size of the tile in bytes */
+    int32_t usize;            /* uncompressed size of the tile in bytes */
+} Tiled_index_t;
+
+/* Structure for reading a tiled band */
+typedef struct {
+    FILE *fp;                 /* file pointer for the tiled band */
+    Tiled_header_t hdr;       /* file header */
+    Tiled_index_t *index;     /* tile index, ntile_lines x ntile_samps */
+    unsigned char *cbuf;      /* buffer for a compressed tile */
+    unsigned char *ubuf;      /* buffer for an unfiltered tile */
+    long cbuf_size;           /* size of the compressed tile buffer */
+} Tiled_band_t;
+
+/* Prototypes */
+int write_tiled_band
+(
+    FILE *fp,           /* I: file pointer for the output band, positioned at
+                              the start of the file */
+    void *buf,          /* I: band data to be written, nlines x nsamps */
+    int buf_nsamps,     /* I: number of samples in each line of buf; more
+                              than nsamps if the band is a window of buf */
+    int nlines,         /* I: number of lines in the band */
+    int nsamps,         /* I: number of samples in the band */
+    int nbytes,         /* I: number of bytes per pixel */
+    int tile_size,      /* I: number of lines and samples in a tile */
+    int level,          /* I: zlib compression level (1-9) */
+    long *out_size      /* O: total number of bytes written to the file */
+);
+
+Tiled_band_t *open_tiled_band
+(
+    char *file_name     /* I: name of the tiled band file to be read */
+);
+
+int get_tile_size
+(
+    Tiled_band_t *this, /* I: tiled band structure */
+    int tile_line,      /* I: tile row (0-based) */
+    int tile_samp,      /* I: tile column (0-based) */
+    int *nlines,        /* O: number of lines in this tile */
+    int *nsamps         /* O: number of samples in this tile */
+);
+
+int read_tile
+(
+    Tiled_band_t *this, /* I: tiled band structure */
+    int tile_line,      /* I: tile row (0-based) */
+    int tile_samp,      /* I: tile column (0-based) */
+    void *buf           /* O: tile data, packed as nlines x nsamps of this
+                              tile (see get_tile_size) */
+);
+
+int read_tiled_lines
+(
+    Tiled_band_t *this, /* I: tiled band structure */
+    int iline,          /* I: first line to read (0-based) */
+    int nlines,         /* I: number of lines to read */
+    void *buf           /* O: band data, nlines x nsamps of the band */
+);
+
+void close_tiled_band
+(
+    Tiled_band_t *this  /* I: tiled band structure to close and free */
+);
+
+#endif
@@ -0,0 +1,354 @@
+/*****************************************************************************
+FILE: toa_reuse.c
+
+PURPOSE: Contains functions for reusing the TOA reflectance bands written by
+an earlier run of the scene (e.g. a TOA-only run with --process_sr=false)
+instead of recalibrating them from the Level-1 bands.
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+LICENSE TYPE:  NASA Open Source Agreement Version 1.3
+
+NOTES:
+  1. When TOA bands 1-7 are written for the whole scene in the raw binary
+     format, a digest is written next to them holding the calibration
+     (gains, biases, angle decimation, and version), the size and
+     modification time of the Level-1 files they were calibrated from, and
+     the CRC-32 of each band.
+  2. A later SR run of the scene uses the TOA bands registered in its XML
+     file if the digest matches the scene and the bands.  The bands are
+     mapped copy-on-write, so the SR corrections can overwrite them in
+     memory without changing the files.
+  3. Only bands 1-7 are mapped, since those are the only TOA bands read by
+     the SR corrections.  The cirrus, thermal, and RADSAT bands of the
+     earlier run must also be registered, since they aren't written again.
+*****************************************************************************/
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "toa_reuse.h"
+
+/******************************************************************************
+MODULE:  find_toa_band
+
+PURPOSE:  Finds a TOA band registered in the XML metadata.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+-1              The band isn't registered with the expected size
+>= 0            Index of the band in the XML metadata
+
+NOTES:
+******************************************************************************/
+static int find_toa_band
+(
+    Espa_internal_meta_t *xml_metadata,  /* I: XML metadata for the scene */
+    char *name,           /* I: name of the band */
+    int nlines,           /* I: expected number of lines in the band */
+    int nsamps            /* I: expected number of samples in the band */
+)
+{
+    int ib;               /* looping variable for the bands */
+    Espa_band_meta_t *bmeta = NULL;  /* current band metadata */
+
+    for (ib = 0; ib < xml_metadata->nbands; ib++)
+    {
+        bmeta = &xml_metadata->band[ib];
+        if (!strcmp (bmeta->name, name) && bmeta->nlines == nlines &&
+            bmeta->nsamps == nsamps)
+            return (ib);
+    }
+
+    return (-1);
+}
+
+
+/******************************************************************************
+MODULE:  init_toa_digest
+
+PURPOSE:  Sets up the TOA digest for the scene from the calibration and the
+Level-1 files the TOA bands are calibrated from.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           One of the Level-1 files couldn't be found
+SUCCESS         No errors encountered
+
+NOTES:
+  1. The band CRCs are left zero; they are filled in by write_toa_digest.
+******************************************************************************/
+int init_toa_digest
+(
+    Input_t *input,       /* I: input structure for the Landsat product */
+    int nlines,           /* I: number of lines in the TOA bands */
+    int nsamps,           /* I: number of samples in the TOA bands */
+    int angle_decimation, /* I: decimation of the solar zenith angles */
+    Toa_digest_t *digest  /* O: TOA digest, without the band CRCs */
+)
+{
+    char FUNC_NAME[] = "init_toa_digest";   /* function name */
+    char errmsg[STR_SIZE];   /* error message */
+    int i;                   /* looping variable for the Level-1 files */
+    char *src_file[NTOA_DIGEST_SRCS];  /* Level-1 files the TOA bands are
+                                          calibrated from */
+    struct stat src_stat;    /* status of the current Level-1 file */
+
+    memset (digest, 0, sizeof (Toa_digest_t));
+    memcpy (digest->magic, TOA_DIGEST_MAGIC, TOA_DIGEST_MAGIC_LEN);
+    snprintf (digest->version, TOA_DIGEST_VERSION_LEN, "%s", SR_VERSION);
+    digest->nlines = nlines;
+    digest->nsamps = nsamps;
+    digest->angle_decimation = angle_decimation;
+    digest->inst = input->meta.inst;
+    for (i = 0; i < NBAND_REFL_MAX; i++)
+    {
+        digest->gain[i] = input->meta.gain[i];
+        digest->bias[i] = input->meta.bias[i];
+    }
+
+    for (i = 0; i < NTOA_REUSE_BANDS; i++)
+        src_file[i] = input->file_name[i];
+    src_file[TOA_DIGEST_SRC_QA] = input->file_name_qa[0];
+    src_file[TOA_DIGEST_SRC_SZA] = input->file_name_sza;
+    for (i = 0; i < NTOA_DIGEST_SRCS; i++)
+    {
+        if (src_file[i] == NULL || stat (src_file[i], &src_stat) == -1)
+        {
+            sprintf (errmsg, "Unable to find the Level-1 file %s for the TOA "
+                "digest", src_file[i] == NULL ? "(none)" : src_file[i]);
+            error_handler (false, FUNC_NAME, errmsg);
+            return (ERROR);
+        }
+        digest->src_size[i] = (int64_t) src_stat.st_size;
+        digest->src_mtime[i] = (int64_t) src_stat.st_mtime;
+    }
+
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  write_toa_digest
+
+PURPOSE:  Computes the CRC-32 of each of TOA bands 1-7 and writes the TOA
+digest.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error writing the digest
+SUCCESS         No errors encountered
+
+NOTES:
+  1. This must be called with the TOA bands as they are written, before the
+     SR corrections overwrite them.  The bands are hashed in parallel.
+  2. The digest is written to digest_file.tmp and renamed once complete.
+******************************************************************************/
+int write_toa_digest
+(
+    char *digest_file,    /* I: name of the TOA digest file */
+    Toa_digest_t *digest, /* I/O: TOA digest from init_toa_digest; the band
+                                CRCs are filled in */
+    int16 **sband         /* I: TOA reflectance bands, nlines x nsamps */
+)
+{
+    char FUNC_NAME[] = "write_toa_digest";   /* function name */
+    char errmsg[STR_SIZE];   /* error message */
+    char tmp_file[STR_SIZE]; /* temporary digest filename */
+    int ib;                  /* looping variable for the bands */
+    size_t nbytes;           /* size of each band (bytes) */
+    bool ok;                 /* was the digest written? */
+    FILE *fp = NULL;         /* digest file pointer */
+
+    nbytes = (size_t) digest->nlines * digest->nsamps * sizeof (int16);
+#ifdef _OPENMP
+    #pragma omp parallel for schedule (dynamic, 1)
+#endif
+    for (ib = 0; ib < NTOA_REUSE_BANDS; ib++)
+        digest->crc[ib] = crc32_array (sband[ib], nbytes);
+
+    snprintf (tmp_file, sizeof (tmp_file), "%s.tmp", digest_file);
+    fp = fopen (tmp_file, "wb");
+    if (fp == NULL)
+    {
+        sprintf (errmsg, "Opening the TOA digest %s", tmp_file);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    ok = fwrite (digest, sizeof (Toa_digest_t), 1, fp) == 1;
+    if (fclose (fp) != 0)
+        ok = false;
+    if (!ok || rename (tmp_file, digest_file) != 0)
+    {
+        sprintf (errmsg, "Writing the TOA digest %s", digest_file);
+        error_handler (true, FUNC_NAME, errmsg);
+        unlink (tmp_file);
+        return (ERROR);
+    }
+
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  map_toa_bands
+
+PURPOSE:  Maps TOA bands 1-7 registered in the XML metadata, if the TOA
+digest shows they were calibrated the same way from the same Level-1 files
+and haven't changed since.
+
+RETURN VALUE:
+Type = bool
+Value           Description
+-----           -----------
+true            TOA bands 1-7 were mapped
+false           The TOA bands can't be reused and need to be calibrated
+
+NOTES:
+  1. The bands are mapped private and writable, so pages written by the SR
+     corrections are copied rather than written back to the TOA files.
+  2. A digest which doesn't match is reported and otherwise ignored.  A
+     missing digest or band is not reported; it just means there is nothing
+     to reuse.
+******************************************************************************/
+bool map_toa_bands
+(
+    Espa_internal_meta_t *xml_metadata,  /* I: XML metadata for the scene */
+    char *digest_file,    /* I: name of the TOA digest file */
+    Toa_digest_t *digest, /* I: TOA digest for the scene, from
+                                init_toa_digest */
+    Toa_map_t *map        /* O: mapped TOA bands 1-7 */
+)
+{
+    char FUNC_NAME[] = "map_toa_bands";   /* function name */
+    char errmsg[STR_SIZE];   /* error message */
+    char name[STR_SIZE];     /* name of the current TOA band */
+    int ib;                  /* looping variable for the bands */
+    int indx[NTOA_REUSE_BANDS];  /* index of each TOA band in the XML
+                                    metadata */
+    int fd;                  /* file descriptor for the current band */
+    int nbad;                /* number of bands which don't match their
+                                CRC */
+    bool ok;                 /* can the bands be reused? */
+    Toa_digest_t file_digest;  /* digest read from the digest file */
+    FILE *fp = NULL;         /* digest file pointer */
+    struct stat band_stat;   /* status of the current band file */
+    void *base = NULL;       /* start of the current mapping */
+
+    map->nbands = 0;
+    map->size = (size_t) digest->nlines * digest->nsamps * sizeof (int16);
+
+    /* All the TOA bands of the earlier run must be registered, since none
+       of them are written again */
+    for (ib = 0; ib < NTOA_REUSE_BANDS; ib++)
+    {
+        sprintf (name, "toa_band%d", ib+1);
+        indx[ib] = find_toa_band (xml_metadata, name, digest->nlines,
+            digest->nsamps);
+        if (indx[ib] == -1)
+            return (false);
+    }
+    if (find_toa_band (xml_metadata, "toa_band9", digest->nlines,
+        digest->nsamps) == -1 ||
+        find_toa_band (xml_metadata, "radsat_qa", digest->nlines,
+        digest->nsamps) == -1)
+        return (false);
+    if (digest->inst != INST_OLI &&
+        (find_toa_band (xml_metadata, "bt_band10", digest->nlines,
+        digest->nsamps) == -1 ||
+        find_toa_band (xml_metadata, "bt_band11", digest->nlines,
+        digest->nsamps) == -1))
+        return (false);
+
+    /* Make sure the bands were calibrated the same way from the same
+       Level-1 files */
+    fp = fopen (digest_file, "rb");
+    if (fp == NULL)
+        return (false);
+    ok = fread (&file_digest, sizeof (file_digest), 1, fp) == 1;
+    fclose (fp);
+    if (!ok || memcmp (&file_digest, digest, offsetof (Toa_digest_t, crc)))
+    {
+        sprintf (errmsg, "The TOA digest %s doesn't match the scene; the TOA "
+            "bands will be recalibrated", digest_file);
+        error_handler (false, FUNC_NAME, errmsg);
+        return (false);
+    }
+
+    /* Map each band and make sure it hasn't changed since it was written */
+    for (ib = 0; ib < NTOA_REUSE_BANDS; ib++)
+    {
+        fd = open (xml_metadata->band[indx[ib]].file_name, O_RDONLY);
+        if (fd == -1)
+            break;
+        if (fstat (fd, &band_stat) == -1 ||
+            (size_t) band_stat.st_size != map->size)
+        {
+            close (fd);
+            break;
+        }
+        base = mmap (NULL, map->size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+            fd, 0);
+        close (fd);
+        if (base == MAP_FAILED)
+            break;
+        map->band[map->nbands++] = base;
+    }
+
+    nbad = NTOA_REUSE_BANDS - map->nbands;
+    if (nbad == 0)
+    {
+#ifdef _OPENMP
+        #pragma omp parallel for schedule (dynamic, 1) reduction (+:nbad)
+#endif
+        for (ib = 0; ib < NTOA_REUSE_BANDS; ib++)
+        {
+            if (crc32_array (map->band[ib], map->size) != file_digest.crc[ib])
+                nbad++;
+        }
+    }
+    ok = nbad == 0;
+
+    if (!ok)
+    {
+        sprintf (errmsg, "The TOA bands registered in the XML file don't "
+            "match the TOA digest %s; they will be recalibrated",
+            digest_file);
+        error_handler (false, FUNC_NAME, errmsg);
+        unmap_toa_bands (map);
+        return (false);
+    }
+
+    return (true);
+}
+
+
+/******************************************************************************
+MODULE:  unmap_toa_bands
+
+PURPOSE:  Unmaps the TOA bands mapped by map_toa_bands.
+
+RETURN VALUE:
+Type = None
+
+NOTES:
+******************************************************************************/
+void unmap_toa_bands
+(
+    Toa_map_t *map        /* I/O: TOA bands mapped by map_toa_bands */
+)
+{
+    int ib;               /* looping variable for the bands */
+
+    for (ib = 0; ib < map->nbands; ib++)
+        munmap (map->band[ib], map->size);
+    map->nbands = 0;
+}
@@ -0,0 +1,96 @@
+#ifndef _TOA_REUSE_H_
+#define _TOA_REUSE_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include "common.h"
+#include "input.h"
+#include "aero_ckpt.h"
+#include "espa_metadata.h"
+#include "error_handler.h"
+
+/* Defines for the digest of the TOA reflectance bands, written next to the
+   TOA products as PRODUCT_ID_toa_digest.bin whenever TOA bands 1-7 are
+   written for the whole scene in the raw binary format.  A later SR run of
+   the scene maps those bands instead of recalibrating them, as long as the
+   digest still matches.  The digest is in the native byte order. */
+#define TOA_DIGEST_MAGIC "LSRTOA01"  /* 8-character file signature */
+#define TOA_DIGEST_MAGIC_LEN 8
+#define TOA_DIGEST_EXTENSION "_toa_digest.bin"  /* appended to the product ID */
+#define TOA_DIGEST_VERSION_LEN 16
+
+/* Define the TOA bands which are reused (bands 1-7, the only TOA bands read
+   by the SR corrections) and the Level-1 files they are calibrated from
+   (bands 1-7, the QA band, and the solar zenith band) */
+#define NTOA_REUSE_BANDS (SR_BAND7 + 1)
+#define TOA_DIGEST_SRC_QA NTOA_REUSE_BANDS
+#define TOA_DIGEST_SRC_SZA (NTOA_REUSE_BANDS + 1)
+#define NTOA_DIGEST_SRCS (NTOA_REUSE_BANDS + 2)
+
+/* Structure for the TOA digest.  Everything before crc describes how the TOA
+   bands were calibrated and must match for them to be reused; crc holds the
+   CRC-32 of each TOA band as written. */
+typedef struct {
+    char magic[TOA_DIGEST_MAGIC_LEN];  /* file signature, TOA_DIGEST_MAGIC */
+    char version[TOA_DIGEST_VERSION_LEN];  /* SR_VERSION which wrote the
+                                 bands */
+    int32_t nlines;           /* number of lines in the TOA bands */
+    int32_t nsamps;           /* number of samples in the TOA bands */
+    int32_t angle_decimation; /* decimation of the solar zenith angles used
+                                 for the TOA corrections */
+    int32_t inst;             /* instrument (Inst_t) */
+    float gain[NBAND_REFL_MAX];  /* reflectance band TOA refl gain */
+    float bias[NBAND_REFL_MAX];  /* reflectance band bias */
+    int64_t src_size[NTOA_DIGEST_SRCS];   /* size of each Level-1 file the
+                                 bands were calibrated from (bytes) */
+    int64_t src_mtime[NTOA_DIGEST_SRCS];  /* modification time of each
+                                 Level-1 file the bands were calibrated
+                                 from */
+    uint32_t crc[NTOA_REUSE_BANDS];  /* CRC-32 of each TOA band */
+    uint32_t pad;             /* pads the digest to a multiple of 8 bytes */
+} Toa_digest_t;
+
+/* Structure for the TOA bands mapped for reuse */
+typedef struct {
+    int nbands;               /* number of bands mapped */
+    size_t size;              /* size of each mapping (bytes) */
+    int16 *band[NTOA_REUSE_BANDS];  /* mapped TOA bands 1-7 */
+} Toa_map_t;
+
+/* Prototypes */
+int init_toa_digest
+(
+    Input_t *input,       /* I: input structure for the Landsat product */
+    int nlines,           /* I: number of lines in the TOA bands */
+    int nsamps,           /* I: number of samples in the TOA bands */
+    int angle_decimation, /* I: decimation of the solar zenith angles */
+    Toa_digest_t *digest  /* O: TOA digest, without the band CRCs */
+);
+
+int write_toa_digest
+(
+    char *digest_file,    /* I: name of the TOA digest file */
+    Toa_digest_t *digest, /* I/O: TOA digest from init_toa_digest; the band
+                                CRCs are filled in */
+    int16 **sband         /* I: TOA reflectance bands, nlines x nsamps */
+);
+
+bool map_toa_bands
+(
+    Espa_internal_meta_t *xml_metadata,  /* I: XML metadata for the scene */
+    char *digest_file,    /* I: name of the TOA digest file */
+    Toa_digest_t *digest, /* I: TOA digest for the scene, from
+                                init_toa_digest */
+    Toa_map_t *map        /* O: mapped TOA bands 1-7 */
+);
+
+void unmap_toa_bands
+(
+    Toa_map_t *map        /* I/O: TOA bands mapped by map_toa_bands */
+);
+
+#endif
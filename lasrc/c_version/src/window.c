@@ -0,0 +1,478 @@
+/*****************************************************************************
+FILE: window.c
+
+PURPOSE: Contains functions for processing a window (region of interest) of
+a scene.  The window to be output is padded with the margin needed by the
+aerosol interpolation and the decimated angles, so the output pixels match
+the same pixels of a full scene run, and the metadata for the output products
+of the window is set up.
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+LICENSE TYPE:  NASA Open Source Agreement Version 1.3
+
+NOTES:
+  1. Windows are in the line/sample space of the reflectance bands of the
+     scene (band 1).
+  2. The window of the scene read starts on an aerosol window boundary, so the
+     aerosol windows of the window read are the aerosol windows of the full
+     scene.  It also starts on a multiple of the angle decimation, so the
+     decimated angle grid points are the same.
+*****************************************************************************/
+#include "window.h"
+
+/******************************************************************************
+MODULE:  get_scene_size
+
+PURPOSE:  Gets the size and pixel size of the reflectance bands of the scene,
+using band 1.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Band 1 is not in the XML metadata
+SUCCESS         No errors encountered
+
+NOTES:
+******************************************************************************/
+static int get_scene_size
+(
+    Espa_internal_meta_t *xml_metadata,  /* I: XML metadata for the scene */
+    int *nlines,          /* O: number of lines in the scene */
+    int *nsamps,          /* O: number of samples in the scene */
+    double *pixel_size    /* O: x/y pixel size of the scene */
+)
+{
+    char FUNC_NAME[] = "get_scene_size";   /* function name */
+    char errmsg[STR_SIZE];   /* error message */
+    int ib;                  /* looping variable for the bands */
+
+    for (ib = 0; ib < xml_metadata->nbands; ib++)
+    {
+        if (!strcmp (xml_metadata->band[ib].name, "b1"))
+        {
+            *nlines = xml_metadata->band[ib].nlines;
+            *nsamps = xml_metadata->band[ib].nsamps;
+            pixel_size[0] = xml_metadata->band[ib].pixel_size[0];
+            pixel_size[1] = xml_metadata->band[ib].pixel_size[1];
+            return (SUCCESS);
+        }
+    }
+
+    sprintf (errmsg, "Band 1 (b1) was not found in the XML metadata");
+    error_handler (true, FUNC_NAME, errmsg);
+    return (ERROR);
+}
+
+
+/******************************************************************************
+MODULE:  open_scene_space
+
+PURPOSE:  Sets up the geolocation mapping for the scene.
+
+RETURN VALUE:
+Type = Geoloc_t *
+Value           Description
+-----           -----------
+NULL            Error setting up the mapping
+non-NULL        Mapping for the scene
+
+NOTES:
+******************************************************************************/
+static Geoloc_t *open_scene_space
+(
+    Espa_internal_meta_t *xml_metadata   /* I: XML metadata for the scene */
+)
+{
+    char FUNC_NAME[] = "open_scene_space";   /* function name */
+    char errmsg[STR_SIZE];   /* error message */
+    Space_def_t space_def;   /* geolocation space information */
+    Geoloc_t *space = NULL;  /* geolocation mapping for the scene */
+
+    if (!get_geoloc_info (xml_metadata, &space_def))
+    {
+        sprintf (errmsg, "Getting the space definition from the XML file");
+        error_handler (true, FUNC_NAME, errmsg);
+        return (NULL);
+    }
+
+    space = setup_mapping (&space_def);
+    if (space == NULL)
+    {
+        sprintf (errmsg, "Setting up the geolocation mapping");
+        error_handler (true, FUNC_NAME, errmsg);
+        return (NULL);
+    }
+
+    return (space);
+}
+
+
+/******************************************************************************
+MODULE:  bbox_to_window
+
+PURPOSE:  Finds the window of the scene covering a lat/long bounding box.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error mapping the bounding box, or it doesn't overlap the
+                scene
+SUCCESS         No errors encountered
+
+NOTES:
+  1. Points along the edges of the bounding box are mapped to the scene, and
+     the window covers the lines/samples they fall in, clipped to the scene.
+     The pixels are located the same way as in compute_sr_refl, where the
+     center of pixel (line, samp) is mapped as (line - 0.5, samp + 0.5).
+  2. The bounding box can't cross the dateline.
+******************************************************************************/
+int bbox_to_window
+(
+    Espa_internal_meta_t *xml_metadata,  /* I: XML metadata for the scene */
+    double *bbox,         /* I: west, east, north, and south lat/long bounds
+                                (degrees) of the region of interest */
+    Window_t *window      /* O: window of the scene covering the bounding
+                                box; the median aerosol is left as is */
+)
+{
+    char FUNC_NAME[] = "bbox_to_window";   /* function name */
+    char errmsg[STR_SIZE];   /* error message */
+    int edge;                /* looping variable for the bounding box edges */
+    int i;                   /* looping variable for the points on an edge */
+    int line, samp;          /* line/sample of the current point */
+    int nlines, nsamps;      /* number of lines/samples in the scene */
+    int first_line = INT_MAX;  /* first line covered by the bounding box */
+    int last_line = INT_MIN;   /* last line covered by the bounding box */
+    int first_samp = INT_MAX;  /* first sample covered by the bounding box */
+    int last_samp = INT_MIN;   /* last sample covered by the bounding box */
+    double pixel_size[2];    /* pixel size of the scene */
+    double frac;             /* fractional location along the current edge */
+    Geoloc_t *space = NULL;  /* geolocation mapping for the scene */
+    Img_coord_float_t img;   /* coordinate in line/sample space */
+    Geo_coord_t geo;         /* coordinate in lat/long space */
+
+    if (get_scene_size (xml_metadata, &nlines, &nsamps, pixel_size)
+        != SUCCESS)
+    {
+        sprintf (errmsg, "Getting the size of the scene");
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    space = open_scene_space (xml_metadata);
+    if (space == NULL)
+    {
+        sprintf (errmsg, "Setting up the geolocation mapping for the scene");
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    /* Map points along the north, south, west, and east edges of the
+       bounding box to the scene */
+    for (edge = 0; edge < 4; edge++)
+    {
+        for (i = 0; i <= WINDOW_EDGE_NPOINTS; i++)
+        {
+            frac = (double) i / WINDOW_EDGE_NPOINTS;
+            if (edge < 2)
+            {
+                geo.lat = (edge == 0) ? bbox[ESPA_NORTH] : bbox[ESPA_SOUTH];
+                geo.lon = bbox[ESPA_WEST] +
+                    frac * (bbox[ESPA_EAST] - bbox[ESPA_WEST]);
+            }
+            else
+            {
+                geo.lat = bbox[ESPA_SOUTH] +
+                    frac * (bbox[ESPA_NORTH] - bbox[ESPA_SOUTH]);
+                geo.lon = (edge == 2) ? bbox[ESPA_WEST] : bbox[ESPA_EAST];
+            }
+            geo.lat *= DEG2RAD;
+            geo.lon *= DEG2RAD;
+            geo.is_fill = false;
+            if (!to_space (space, &geo, &img))
+            {
+                sprintf (errmsg, "Mapping lat/long (%f, %f) to line/sample "
+                    "coords", geo.lat * RAD2DEG, geo.lon * RAD2DEG);
+                error_handler (true, FUNC_NAME, errmsg);
+                free (space);
+                return (ERROR);
+            }
+
+            line = (int) floor (img.l + 1.0);
+            samp = (int) floor (img.s);
+            first_line = MIN (first_line, line);
+            last_line = MAX (last_line, line);
+            first_samp = MIN (first_samp, samp);
+            last_samp = MAX (last_samp, samp);
+        }
+    }
+    free (space);
+
+    /* Clip the window to the scene */
+    first_line = MAX (first_line, 0);
+    last_line = MIN (last_line, nlines - 1);
+    first_samp = MAX (first_samp, 0);
+    last_samp = MIN (last_samp, nsamps - 1);
+    if (first_line > last_line || first_samp > last_samp)
+    {
+        sprintf (errmsg, "The bounding box (west %f, east %f, north %f, "
+            "south %f) does not overlap the scene", bbox[ESPA_WEST],
+            bbox[ESPA_EAST], bbox[ESPA_NORTH], bbox[ESPA_SOUTH]);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    window->line0 = first_line;
+    window->samp0 = first_samp;
+    window->nlines = last_line - first_line + 1;
+    window->nsamps = last_samp - first_samp + 1;
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  pad_range
+
+PURPOSE:  Pads the lines (or samples) of a window with the margin needed to
+correct them the same way as in the full scene.
+
+RETURN VALUE:
+Type = None
+
+NOTES:
+  1. The aerosol interpolation of a pixel uses the centers of its own aerosol
+     window and of the neighboring window above/below (left/right), and a
+     neighboring center is only used if it's more than one line from the end
+     of the lines read.  The range read starts an aerosol window before the
+     first aerosol window of the range, and ends past the aerosol window after
+     the last one.
+  2. The range read starts on a multiple of the aerosol window size and the
+     angle decimation, and ends on an angle grid point (or the end of the
+     scene), so the aerosol windows and angle grid points match the scene.
+******************************************************************************/
+static void pad_range
+(
+    int first,            /* I: first line/sample of the range output */
+    int n,                /* I: number of lines/samples output */
+    int scene_n,          /* I: number of lines/samples in the scene */
+    int decimation,       /* I: angle decimation */
+    int *pad_first,       /* O: first line/sample of the range read */
+    int *pad_n            /* O: number of lines/samples read */
+)
+{
+    int align;            /* alignment of the start of the range read */
+    int a, b, r;          /* variables for the greatest common divisor */
+    int next_center;      /* center of the aerosol window after the last
+                             aerosol window output */
+    int end;              /* line/sample after the range read */
+
+    /* Align the start on the least common multiple of the aerosol window
+       size and the angle decimation */
+    a = AERO_WINDOW;
+    b = decimation;
+    while (b != 0)
+    {
+        r = a % b;
+        a = b;
+        b = r;
+    }
+    align = AERO_WINDOW / a * decimation;
+
+    *pad_first = (first / AERO_WINDOW - 1) * AERO_WINDOW;
+    *pad_first = MAX (*pad_first / align * align, 0);
+
+    /* End past the complete aerosol window after the last one output, far
+       enough for its center to be used by the interpolation */
+    next_center = ((first + n - 1) / AERO_WINDOW) * AERO_WINDOW +
+        HALF_AERO_WINDOW + AERO_WINDOW;
+    end = next_center + MAX (2, HALF_AERO_WINDOW + 1);
+    if (decimation > 1)
+        end = ((end - 1 + decimation - 1) / decimation) * decimation + 1;
+    end = MIN (end, scene_n);
+
+    *pad_n = end - *pad_first;
+}
+
+
+/******************************************************************************
+MODULE:  pad_window
+
+PURPOSE:  Finds the window of the scene to be read and corrected for a window
+to be output, so the output pixels match the same pixels of a full scene run.
+
+RETURN VALUE:
+Type = None
+
+NOTES:
+  1. See pad_range for the margin added.
+******************************************************************************/
+void pad_window
+(
+    Window_t *out_window, /* I: window of the scene to be output */
+    int nlines,           /* I: number of lines in the scene */
+    int nsamps,           /* I: number of samples in the scene */
+    int angle_decimation, /* I: number of lines/samples between the per-pixel
+                                angles held in memory */
+    Window_t *read_window /* O: window of the scene to be read and corrected
+                                for out_window */
+)
+{
+    pad_range (out_window->line0, out_window->nlines, nlines,
+        angle_decimation, &read_window->line0, &read_window->nlines);
+    pad_range (out_window->samp0, out_window->nsamps, nsamps,
+        angle_decimation, &read_window->samp0, &read_window->nsamps);
+    read_window->median_aerosol = out_window->median_aerosol;
+}
+
+
+/******************************************************************************
+MODULE:  set_window_metadata
+
+PURPOSE:  Sets up the XML metadata for the output products of a window of the
+scene.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+ERROR           Error mapping the window, or the scene isn't north up
+SUCCESS         No errors encountered
+
+NOTES:
+  1. win_metadata is a copy of xml_metadata with the global metadata updated
+     for the window.  It shares the band metadata of xml_metadata, so it must
+     not be freed with free_metadata.
+  2. The product ID gets the window appended, so the output products of the
+     window don't overwrite those of the full scene.
+  3. The projection corners are moved by whole pixels, which requires a north
+     up scene.  The lat/long corners and bounding coordinates are mapped from
+     the window.
+******************************************************************************/
+int set_window_metadata
+(
+    Espa_internal_meta_t *xml_metadata,  /* I: XML metadata for the scene */
+    Window_t *window,     /* I: window of the scene to be output */
+    Espa_internal_meta_t *win_metadata   /* O: XML metadata for the output
+                                products of the window */
+)
+{
+    char FUNC_NAME[] = "set_window_metadata";   /* function name */
+    char errmsg[STR_SIZE];   /* error message */
+    char product_id[STR_SIZE];  /* product ID for the window */
+    int edge;                /* looping variable for the window edges */
+    int i;                   /* looping variable for the points on an edge */
+    int nlines, nsamps;      /* number of lines/samples in the scene */
+    int last_line, last_samp;  /* last line/sample of the window */
+    double pixel_size[2];    /* pixel size of the scene */
+    double lat, lon;         /* lat/long of the current point (degrees) */
+    Espa_global_meta_t *gmeta = NULL;  /* global metadata for the window */
+    Geoloc_t *space = NULL;  /* geolocation mapping for the scene */
+    Img_coord_float_t img;   /* coordinate in line/sample space */
+    Geo_coord_t geo;         /* coordinate in lat/long space */
+
+    if (get_scene_size (xml_metadata, &nlines, &nsamps, pixel_size)
+        != SUCCESS)
+    {
+        sprintf (errmsg, "Getting the size of the scene");
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    if (fabs (xml_metadata->global.orientation_angle) > 0.0)
+    {
+        sprintf (errmsg, "Only a window of a north up scene can be "
+            "processed; the orientation angle is %f",
+            xml_metadata->global.orientation_angle);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    *win_metadata = *xml_metadata;
+    gmeta = &win_metadata->global;
+    last_line = window->line0 + window->nlines - 1;
+    last_samp = window->samp0 + window->nsamps - 1;
+
+    snprintf (product_id, sizeof (product_id), "%s_w%d_%d_%dx%d",
+        xml_metadata->global.product_id, window->line0, window->samp0,
+        window->nlines, window->nsamps);
+    strcpy (gmeta->product_id, product_id);
+
+    /* Move the projection corners to the corner pixels of the window */
+    gmeta->proj_info.ul_corner[0] += window->samp0 * pixel_size[0];
+    gmeta->proj_info.ul_corner[1] -= window->line0 * pixel_size[1];
+    gmeta->proj_info.lr_corner[0] -= (nsamps - 1 - last_samp) * pixel_size[0];
+    gmeta->proj_info.lr_corner[1] += (nlines - 1 - last_line) * pixel_size[1];
+
+    /* Map points along the top, bottom, left, and right edges of the window
+       for the lat/long corners and bounding coordinates */
+    space = open_scene_space (xml_metadata);
+    if (space == NULL)
+    {
+        sprintf (errmsg, "Setting up the geolocation mapping for the scene");
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    gmeta->bounding_coords[ESPA_WEST] = 180.0;
+    gmeta->bounding_coords[ESPA_EAST] = -180.0;
+    gmeta->bounding_coords[ESPA_NORTH] = -90.0;
+    gmeta->bounding_coords[ESPA_SOUTH] = 90.0;
+    for (edge = 0; edge < 4; edge++)
+    {
+        for (i = 0; i <= WINDOW_EDGE_NPOINTS; i++)
+        {
+            if (edge < 2)
+            {
+                img.l = ((edge == 0) ? window->line0 : last_line) - 0.5;
+                img.s = window->samp0 + 0.5 +
+                    (double) i * (window->nsamps - 1) / WINDOW_EDGE_NPOINTS;
+            }
+            else
+            {
+                img.l = window->line0 - 0.5 +
+                    (double) i * (window->nlines - 1) / WINDOW_EDGE_NPOINTS;
+                img.s = ((edge == 2) ? window->samp0 : last_samp) + 0.5;
+            }
+            img.is_fill = false;
+            if (!from_space (space, &img, &geo))
+            {
+                sprintf (errmsg, "Mapping line/sample (%f, %f) to "
+                    "geolocation coords", img.l, img.s);
+                error_handler (true, FUNC_NAME, errmsg);
+                free (space);
+                return (ERROR);
+            }
+            lat = geo.lat * RAD2DEG;
+            lon = geo.lon * RAD2DEG;
+
+            gmeta->bounding_coords[ESPA_WEST] =
+                MIN (gmeta->bounding_coords[ESPA_WEST], lon);
+            gmeta->bounding_coords[ESPA_EAST] =
+                MAX (gmeta->bounding_coords[ESPA_EAST], lon);
+            gmeta->bounding_coords[ESPA_NORTH] =
+                MAX (gmeta->bounding_coords[ESPA_NORTH], lat);
+            gmeta->bounding_coords[ESPA_SOUTH] =
+                MIN (gmeta->bounding_coords[ESPA_SOUTH], lat);
+
+            /* The first point of the top edge is the UL corner, and the last
+               point of the bottom edge is the LR corner */
+            if (edge == 0 && i == 0)
+            {
+                gmeta->ul_corner[0] = lat;
+                gmeta->ul_corner[1] = lon;
+            }
+            else if (edge == 1 && i == WINDOW_EDGE_NPOINTS)
+            {
+                gmeta->lr_corner[0] = lat;
+                gmeta->lr_corner[1] = lon;
+            }
+        }
+    }
+    free (space);
+
+    return (SUCCESS);
+}
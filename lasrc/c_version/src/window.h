@@ -0,0 +1,53 @@
+#ifndef _WINDOW_H_
+#define _WINDOW_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <string.h>
+#include <math.h>
+#include <stdbool.h>
+#include "common.h"
+#include "input.h"
+#include "espa_metadata.h"
+#include "espa_geoloc.h"
+#include "error_handler.h"
+
+/* Define the number of values in a lat/long bounding box, indexed by
+   ESPA_WEST, ESPA_EAST, ESPA_NORTH, and ESPA_SOUTH */
+#define NBBOX_COORDS 4
+
+/* Define the number of points mapped along each edge of a bounding box or
+   window to find the area it covers */
+#define WINDOW_EDGE_NPOINTS 32
+
+/* Prototypes */
+int bbox_to_window
+(
+    Espa_internal_meta_t *xml_metadata,  /* I: XML metadata for the scene */
+    double *bbox,         /* I: west, east, north, and south lat/long bounds
+                                (degrees) of the region of interest */
+    Window_t *window      /* O: window of the scene covering the bounding
+                                box; the median aerosol is left as is */
+);
+
+void pad_window
+(
+    Window_t *out_window, /* I: window of the scene to be output */
+    int nlines,           /* I: number of lines in the scene */
+    int nsamps,           /* I: number of samples in the scene */
+    int angle_decimation, /* I: number of lines/samples between the per-pixel
+                                angles held in memory */
+    Window_t *read_window /* O: window of the scene to be read and corrected
+                                for out_window */
+);
+
+int set_window_metadata
+(
+    Espa_internal_meta_t *xml_metadata,  /* I: XML metadata for the scene */
+    Window_t *window,     /* I: window of the scene to be output */
+    Espa_internal_meta_t *win_metadata   /* O: XML metadata for the output
+                                products of the window */
+);
+
+#endif
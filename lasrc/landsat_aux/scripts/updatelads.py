@@ -202,6 +202,8 @@ def downloadLads (year, doy, destination):
 #   year - year of LAADS data to be downloaded and processed (integer)
 #   today - specifies if we are just bringing the LAADS data up to date vs.
 #           reprocessing the data
+#   tiled - specifies if the tiled auxiliary files are written instead of
+#           the HDF fused files
 #
 # Returns:
 #     ERROR - error occurred while processing
@@ -209,7 +211,7 @@ def downloadLads (year, doy, destination):
 #
 # Notes:
 ############################################################################
-def getLadsData (auxdir, year, today):
+def getLadsData (auxdir, year, today, tiled):
     # get the logger
     logger = logging.getLogger(__name__)
 
@@ -250,11 +252,14 @@ def getLadsData (auxdir, year, today):
         # if the data for the current year and doy exists already, then we are
         # going to skip that file if processing for the --today.  For
         # --quarterly, we will completely reprocess.
+        if tiled:
+            auxfile = 'L8ANC' + datestr + '.aux_tiles'
+        else:
+            auxfile = 'L8ANC' + datestr + '.hdf_fused'
         skip_date = False
         for myfile in os.listdir(outputDir):
-            if fnmatch.fnmatch (myfile, 'L8ANC' + datestr + '.hdf_fused') \
-                and today:
-                msg = 'L8ANC{}.hdf_fused already exists. Skip.'.format(datestr)
+            if fnmatch.fnmatch (myfile, auxfile) and today:
+                msg = '{} already exists. Skip.'.format(auxfile)
                 logger.info(msg)
                 skip_date = True
                 break
@@ -397,6 +402,8 @@ def getLadsData (auxdir, year, today):
         cmdstr = ('combine_l8_aux_data {} {} {} {} --output_dir {} --verbose'
                   .format(terra_cmg_cmdline, terra_cma_cmdline,
                           aqua_cmg_cmdline, aqua_cma_cmdline, outputDir))
+        if tiled:
+            cmdstr += ' --tiled'
         msg = 'Executing {}'.format(cmdstr)
         logger.info(msg)
 
@@ -447,6 +454,8 @@ def getLadsData (auxdir, year, today):
 # 4. Existing LAADS HDF files are removed before processing data for that
 #    year and DOY, but only if the downloaded auxiliary data exists for that
 #    date.
+# 5. --tiled writes the tiled auxiliary files (L8ANCyyyyddd.aux_tiles), which
+#    lasrc uses in place of the HDF fused files of the same date.
 ############################################################################
 def main ():
     logger = logging.getLogger(__name__)  # Get logger for the module.
@@ -464,12 +473,16 @@ def main ():
            .format(START_YEAR))
     parser.add_option ('--quarterly', dest='quarterly', default=False,
         action='store_true', help=msg)
+    parser.add_option ('--tiled', dest='tiled', default=False,
+        action='store_true',
+        help='write the tiled auxiliary files instead of the HDF fused files')
 
     (options, args) = parser.parse_args()
     syear = options.syear           # starting year
     eyear = options.eyear           # ending year
     today = options.today           # process most recent year of data
     quarterly = options.quarterly   # process today back to START_YEAR
+    tiled = options.tiled           # write the tiled auxiliary files
 
     # check the arguments
     if (today == False) and (quarterly == False) and \
@@ -511,7 +524,7 @@ def main ():
     for yr in range(eyear, syear-1, -1):
         msg = 'Processing year: {}'.format(yr)
         logger.info(msg)
-        status = getLadsData(auxdir, yr, today)
+        status = getLadsData(auxdir, yr, today, tiled)
         if status == ERROR:
             msg = ('Problems occurred while processing LAADS data for year {}'
                    .format(yr))
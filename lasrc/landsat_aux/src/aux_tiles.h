@@ -0,0 +1,65 @@
+#ifndef _AUX_TILES_H_
+#define _AUX_TILES_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include "zlib.h"
+#include "error_handler.h"
+#include "aux_tiles_format.h"
+
+/* Defines for writing the tiled auxiliary file.  The file format is defined
+   by aux_tiles_format.h in lasrc/c_version/src, which is shared with the
+   lasrc reader. */
+#define AUX_TILE_SIZE 200           /* lines and samples in a tile; 10 x 10
+                                       degrees of 0.05 degree CMG cells */
+#define AUX_TILE_LEVEL 9            /* zlib compression level */
+
+/* Structure for writing a tiled auxiliary file a row of tiles at a time */
+typedef struct {
+    char outfile[STR_SIZE];   /* name of the tiled auxiliary file */
+    char tmpfile[STR_SIZE];   /* temporary name while it's being written */
+    FILE *fp;                 /* file pointer for the temporary file */
+    Aux_tiles_header_t hdr;   /* file header */
+    Aux_tiles_index_t *index; /* tile index, ntile_lines x ntile_samps */
+    int64_t offset;           /* offset of the next compressed tile */
+    int tile_line;            /* tile row being compressed/written */
+    unsigned char **tile;     /* interleaved tile for each tile column */
+    unsigned char **ctile;    /* compressed tile for each tile column */
+    uLongf *csize;            /* compressed size for each tile column */
+    int nerrors;              /* number of tiles which failed to compress */
+} Aux_tiles_writer_t;
+
+/* Prototypes */
+Aux_tiles_writer_t *open_aux_tiles_writer
+(
+    char *outfile,      /* I: name of the tiled auxiliary file to write */
+    int nlines,         /* I: number of lines in the grid */
+    int nsamps          /* I: number of samples in the grid */
+);
+
+void compress_aux_tile
+(
+    Aux_tiles_writer_t *this, /* I/O: tiled auxiliary file being written */
+    int tile_samp,      /* I: tile column to compress in the current row */
+    uint16_t *wv,       /* I: water vapor values for the lines of the tile
+                              row, nlines x nsamps */
+    uint8_t *oz         /* I: ozone values for the lines of the tile row,
+                              nlines x nsamps */
+);
+
+int write_aux_tile_row
+(
+    Aux_tiles_writer_t *this  /* I/O: tiled auxiliary file being written */
+);
+
+int close_aux_tiles_writer
+(
+    Aux_tiles_writer_t *this, /* I: tiled auxiliary file to close and free */
+    bool keep           /* I: should the file be kept?  If false, or if any
+                              tiles failed, the partial file is removed */
+);
+
+#endif
@@ -0,0 +1,1060 @@
+/******************************************************************************
+FILE: combine_blocks.c
+
+PURPOSE: Contains functions for reading, combining, interpolating, and writing
+the Terra and Aqua ozone and water vapor a block of lines at a time.
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+LICENSE TYPE:  NASA Open Source Agreement Version 1.3
+
+NOTES:
+  1. Only two blocks of lines are held in memory, rather than the full global
+     grids for each SDS.  The next block is read while the current block is
+     combined.  The HDF library isn't thread-safe, so all the HDF reads and
+     writes are done by one thread at a time.
+  2. The output is the same as combining and interpolating the full grids.
+     The interpolation scans the lines in order, and a run of fill pixels
+     which reaches the end of a line continues on the next line, so the lines
+     are split into chains which are linked by such runs.  Each chain is
+     interpolated in line order, and the chains are interpolated in parallel.
+     Runs which continue past the end of the block are finished when the next
+     block is combined.
+******************************************************************************/
+#include "combine_l8_aux_data.h"
+
+/******************************************************************************
+MODULE:  alloc_block_buf
+
+PURPOSE:  Allocates the block buffers for the specified line size and SDS data
+types.  Buffers which were already allocated for the same line size and data
+types are reused.
+
+RETURN VALUE:
+Type = int
+Value          Description
+-----          -----------
+ERROR          Error allocating the block buffers
+SUCCESS        Successful completion
+
+NOTES:
+  1. The buffers must be zeroed before the first call.
+******************************************************************************/
+int alloc_block_buf
+(
+    Block_buf_t *buf,       /* I/O: block buffers */
+    int nsamps,             /* I: number of samples in each line */
+    int32 data_type[N_SDS]  /* I: data type of each SDS */
+)
+{
+    char FUNC_NAME[] = "alloc_block_buf";   /* function name */
+    char errmsg[STR_SIZE];     /* error message */
+    int i, j;                  /* looping variables */
+    size_t nbytes;             /* number of bytes per value */
+
+    /* Reuse the buffers if they already fit */
+    if (buf->nsamps == nsamps &&
+        !memcmp (buf->data_type, data_type, sizeof (buf->data_type)))
+        return (SUCCESS);
+    free_block_buf (buf);
+
+    for (i = 0; i < N_SDS; i++)
+    {
+        nbytes = DFKNTsize (data_type[i]);
+        for (j = 0; j < 2; j++)
+        {
+            buf->block[j].terra[i] = malloc ((size_t) BLOCK_NLINES * nsamps *
+                nbytes);
+            buf->block[j].aqua[i] = malloc ((size_t) BLOCK_NLINES * nsamps *
+                nbytes);
+            if (buf->block[j].terra[i] == NULL ||
+                buf->block[j].aqua[i] == NULL)
+            {
+                sprintf (errmsg, "Allocating memory for the blocks of lines");
+                error_handler (true, FUNC_NAME, errmsg);
+                free_block_buf (buf);
+                return (ERROR);
+            }
+        }
+
+        buf->line_terra[i] = malloc (nsamps * nbytes);
+        buf->line_aqua[i] = malloc (nsamps * nbytes);
+        if (buf->line_terra[i] == NULL || buf->line_aqua[i] == NULL)
+        {
+            sprintf (errmsg, "Allocating memory for the single lines");
+            error_handler (true, FUNC_NAME, errmsg);
+            free_block_buf (buf);
+            return (ERROR);
+        }
+    }
+
+    for (j = 0; j < 2; j++)
+    {
+        buf->block[j].wherefrom = malloc ((size_t) BLOCK_NLINES * nsamps *
+            sizeof (int8));
+        if (buf->block[j].wherefrom == NULL)
+        {
+            sprintf (errmsg, "Allocating memory for the wherefrom blocks");
+            error_handler (true, FUNC_NAME, errmsg);
+            free_block_buf (buf);
+            return (ERROR);
+        }
+    }
+
+    buf->chain = malloc (BLOCK_NLINES * sizeof (int));
+    if (buf->chain == NULL)
+    {
+        sprintf (errmsg, "Allocating memory for the interpolation chains");
+        error_handler (true, FUNC_NAME, errmsg);
+        free_block_buf (buf);
+        return (ERROR);
+    }
+
+    buf->nsamps = nsamps;
+    memcpy (buf->data_type, data_type, sizeof (buf->data_type));
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  free_block_buf
+
+PURPOSE:  Frees the block buffers and resets the structure.
+
+RETURN VALUE:
+Type = None
+
+NOTES:
+******************************************************************************/
+void free_block_buf
+(
+    Block_buf_t *buf        /* I/O: block buffers to be freed */
+)
+{
+    int i, j;                  /* looping variables */
+
+    for (i = 0; i < N_SDS; i++)
+    {
+        for (j = 0; j < 2; j++)
+        {
+            free (buf->block[j].terra[i]);
+            free (buf->block[j].aqua[i]);
+        }
+        free (buf->line_terra[i]);
+        free (buf->line_aqua[i]);
+    }
+    for (j = 0; j < 2; j++)
+        free (buf->block[j].wherefrom);
+    free (buf->chain);
+    free (buf->pending);
+    memset (buf, 0, sizeof (Block_buf_t));
+}
+
+
+/******************************************************************************
+MODULE:  read_lines
+
+PURPOSE:  Reads the specified lines of each SDS from the Terra and Aqua files.
+
+RETURN VALUE:
+Type = int
+Value          Description
+-----          -----------
+ERROR          Error reading the lines
+SUCCESS        Successful completion
+
+NOTES:
+  1. If there is no Terra input, the Terra arrays are set to fill, as the
+     combined output is written to them.
+******************************************************************************/
+static int read_lines
+(
+    io_param terra_params[], /* I: Terra SDS parameters */
+    io_param aqua_params[],  /* I: Aqua SDS parameters */
+    bool terra_input,       /* I: is Terra CMA/CMG available? */
+    bool aqua_input,        /* I: is Aqua CMA/CMG available? */
+    int first_line,         /* I: first line to be read */
+    int nlines,             /* I: number of lines to be read */
+    int nsamps,             /* I: number of samples in each line */
+    void *terra[N_SDS],     /* O: Terra lines for each SDS */
+    void *aqua[N_SDS]       /* O: Aqua lines for each SDS */
+)
+{
+    char FUNC_NAME[] = "read_lines";   /* function name */
+    char errmsg[STR_SIZE];     /* error message */
+    int i;                     /* looping variable for the SDSs */
+    int32 start[2];            /* starting location in each dimension */
+    int32 edges[2];            /* number of values read in each dimension */
+
+    start[0] = first_line;
+    start[1] = 0;
+    edges[0] = nlines;
+    edges[1] = nsamps;
+    for (i = 0; i < N_SDS; i++)
+    {
+        if (terra_input)
+        {
+            if (SDreaddata (terra_params[i].sds_id, start, NULL, edges,
+                terra[i]) == -1)
+            {
+                sprintf (errmsg, "Unable to read lines %d-%d of SDS %s from "
+                    "the Terra file", first_line, first_line + nlines - 1,
+                    terra_params[i].sdsname);
+                error_handler (true, FUNC_NAME, errmsg);
+                return (ERROR);
+            }
+        }
+        else
+            memset (terra[i], 0, (size_t) nlines * nsamps *
+                DFKNTsize (aqua_params[i].data_type));
+
+        if (aqua_input)
+        {
+            if (SDreaddata (aqua_params[i].sds_id, start, NULL, edges,
+                aqua[i]) == -1)
+            {
+                sprintf (errmsg, "Unable to read lines %d-%d of SDS %s from "
+                    "the Aqua file", first_line, first_line + nlines - 1,
+                    aqua_params[i].sdsname);
+                error_handler (true, FUNC_NAME, errmsg);
+                return (ERROR);
+            }
+        }
+    }
+
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  copy_param
+
+PURPOSE:  Creates the output filename for the auxiliary products, using the
+  input year-DOY string and the source directory.
+
+RETURN VALUE:
+Type = None
+
+HISTORY:
+Date         Programmer       Reason
+---------    ---------------  -------------------------------------
+8/28/2014    Gail Schmidt     Conversion of the original code delivered by
+                              Eric Vermote, NASA GSFC, for use within ESPA
+
+NOTES:
+******************************************************************************/
+void copy_param
+(
+    void *dest,        /* O: destination data array */
+    void *source,      /* I: source data array */
+    int32 data_type,   /* I: data type */
+    int32 offset       /* I: pixel in source/dest data arrays to be copied */
+)
+{
+    int8 *i8dest = NULL;
+    int8 *i8source = NULL;
+    uint8 *ui8dest = NULL;
+    uint8 *ui8source = NULL;
+    int16 *i16dest = NULL;
+    int16 *i16source = NULL;
+    uint16 *ui16dest = NULL;
+    uint16 *ui16source = NULL;
+
+    /* Copy the source pixel to the destination pixel, based on the data
+       type */
+    switch (data_type)
+    {
+        case DFNT_INT8:
+            i8dest = (int8 *)dest;
+            i8source = (int8 *)source;
+            i8dest[offset] = i8source[offset];
+            break;
+
+        case DFNT_UINT8:
+            ui8dest = (uint8 *)dest;
+            ui8source = (uint8 *)source;
+            ui8dest[offset] = ui8source[offset];
+            break;
+
+        case DFNT_INT16:
+            i16dest = (int16 *)dest;
+            i16source = (int16 *)source;
+            i16dest[offset] = i16source[offset];
+            break;
+
+        case DFNT_UINT16:
+            ui16dest = (uint16 *)dest;
+            ui16source = (uint16 *)source;
+            ui16dest[offset] = ui16source[offset];
+
+        default:
+            break;
+    }
+
+    return;
+}
+
+
+/******************************************************************************
+MODULE:  interpolate
+
+PURPOSE:  Interpolates all fill pixels between the left and right pixels.
+
+RETURN VALUE:
+Type = None
+
+HISTORY:
+Date         Programmer       Reason
+---------    ---------------  -------------------------------------
+8/28/2014    Gail Schmidt     Conversion of the original code delivered by
+                              Eric Vermote, NASA GSFC, for use within ESPA
+
+NOTES:
+  1. Only supports uint8 and uint16.
+  2. The locations are grid pixel locations (line * nsamps + samp), since a
+     run of fill pixels can continue across lines and blocks.  Only the fill
+     pixels of the run which fall in the data array are interpolated.
+******************************************************************************/
+void interpolate
+(
+    int32 data_type,     /* I: data type of the data array */
+    void *data,          /* I/O: data array */
+    long first_pix,      /* I: grid pixel location of the first pixel in the
+                               data array */
+    long end_pix,        /* I: grid pixel location after the last pixel in the
+                               data array */
+    long left,           /* I: grid pixel location of the left pixel */
+    long right,          /* I: grid pixel location of the right pixel */
+    int left_val,        /* I: value of the left pixel */
+    int right_val        /* I: value of the right pixel */
+)
+{
+    uint8 *ui8x = NULL;     /* uint8 pointer */
+    uint16 *ui16x = NULL;   /* uint16 pointer */
+    long i;                 /* looping variable */
+    long first_i, end_i;    /* range of i falling in the data array */
+    long diff;              /* distance between the left and right pixels */
+    float slope;            /* slope for this pixel */
+
+    /* Determine the distance between the left and right pixels, and the
+       fill pixels in the data array */
+    diff = right - left;
+    first_i = first_pix - left;
+    if (first_i < 1)
+        first_i = 1;
+    end_i = end_pix - left;
+    if (end_i > diff)
+        end_i = diff;
+
+    /* Handle the interpolation between the pixels based on the data type */
+    if (data_type == DFNT_UINT8)
+    {
+        ui8x = (uint8 *)data;
+        if (right_val > left_val)
+        {
+            slope = ((float) right_val - (float) left_val) / (float) (diff);
+            for (i = first_i; i < end_i; i++)
+            {
+                ui8x[i+left-first_pix] = (uint8)
+                    ((float) left_val + (slope * i));
+            }
+        }
+        else
+        {
+            slope = ((float) left_val - (float) right_val) / (float) (diff);
+            for (i = first_i; i < end_i; i++)
+            {
+                ui8x[i+left-first_pix] = (uint8)
+                    ((float) left_val - (slope * i));
+            }
+        }
+    }
+    else if (data_type == DFNT_UINT16)
+    {
+        ui16x = (uint16 *)data;
+        if (right_val > left_val)
+        {
+            slope = ((float) right_val - (float) left_val) / (float) (diff);
+            for (i = first_i; i < end_i; i++)
+            {
+                ui16x[i+left-first_pix] = (uint16)
+                    ((float) left_val + (slope * i));
+            }
+        }
+        else
+        {
+            slope = ((float) left_val - (float) right_val) / (float)(diff);
+            for (i = first_i; i < end_i; i++)
+            {
+                ui16x[i+left-first_pix] = (uint16)
+                    ((float) left_val - (slope * i));
+            }
+        }
+    }
+
+    return;
+}
+
+
+/******************************************************************************
+MODULE:  combine_line
+
+PURPOSE:  Combines the Terra and Aqua values for one line of the block.  The
+Terra pixel is used if it isn't fill, otherwise the Aqua pixel is copied over
+the Terra pixel for each SDS if it isn't fill.
+
+RETURN VALUE:
+Type = None
+
+NOTES:
+  1. Uses the Coarse Resolution Ozone SDS to determine if the pixel will come
+     from Terra or Aqua.  This SDS is a uint8 data array.
+******************************************************************************/
+static void combine_line
+(
+    Block_t *blk,           /* I/O: block of lines */
+    int32 data_type[N_SDS], /* I: data type of each SDS */
+    bool terra_input,       /* I: is Terra CMA/CMG available? */
+    bool aqua_input,        /* I: is Aqua CMA/CMG available? */
+    int line,               /* I: line in the block to be combined */
+    int nsamps              /* I: number of samples in each line */
+)
+{
+    int j;                     /* looping variable for the SDSs */
+    long pix;                  /* current pixel in the block */
+    long end_pix;              /* pixel after the end of the line */
+    uint8 *tmask = (uint8 *) blk->terra[OZONE];  /* Terra ozone */
+    uint8 *amask = (uint8 *) blk->aqua[OZONE];   /* Aqua ozone */
+
+    end_pix = (long) (line + 1) * nsamps;
+    for (pix = (long) line * nsamps; pix < end_pix; pix++)
+    {
+        if (terra_input && tmask[pix] != LAADS_FILL)
+            blk->wherefrom[pix] = TERRA;
+        else if (aqua_input && amask[pix] != LAADS_FILL)
+        {
+            for (j = 0; j < N_SDS; j++)
+                copy_param (blk->terra[j], blk->aqua[j], data_type[j], pix);
+            blk->wherefrom[pix] = AQUA;
+        }
+        else
+            blk->wherefrom[pix] = UNSET;
+    }
+}
+
+
+/******************************************************************************
+MODULE:  get_combined_pixel
+
+PURPOSE:  Gets the combined ozone and water vapor of a pixel past the end of
+the current block, before it has been interpolated.
+
+RETURN VALUE:
+Type = int
+Value          Description
+-----          -----------
+ERROR          Error reading the line containing the pixel
+SUCCESS        Successful completion
+
+NOTES:
+  1. Pixels in the next block come from the Terra and Aqua values already read
+     for that block.  Pixels past the next block are read a line at a time.
+     This only happens when an entire block is fill, so it doesn't need to be
+     fast.
+******************************************************************************/
+static int get_combined_pixel
+(
+    io_param terra_params[], /* I: Terra SDS parameters */
+    io_param aqua_params[],  /* I: Aqua SDS parameters */
+    bool terra_input,       /* I: is Terra CMA/CMG available? */
+    bool aqua_input,        /* I: is Aqua CMA/CMG available? */
+    Block_buf_t *buf,       /* I/O: block buffers */
+    Block_t *next,          /* I: next block, if it has been read */
+    long pix,               /* I: grid pixel location */
+    uint8 *oz,              /* O: combined ozone value */
+    uint16 *wv              /* O: combined water vapor value */
+)
+{
+    int line = pix / buf->nsamps;  /* grid line of the pixel */
+    long loc;                  /* location of the pixel in the arrays */
+    void **terra = NULL;       /* Terra arrays holding the pixel */
+    void **aqua = NULL;        /* Aqua arrays holding the pixel */
+
+    if (next->nlines > 0 && line >= next->first_line &&
+        line < next->first_line + next->nlines)
+    {
+        terra = next->terra;
+        aqua = next->aqua;
+        loc = pix - (long) next->first_line * buf->nsamps;
+    }
+    else
+    {
+        if (buf->line != line)
+        {
+            buf->line = -1;
+            if (read_lines (terra_params, aqua_params, terra_input,
+                aqua_input, line, 1, buf->nsamps, buf->line_terra,
+                buf->line_aqua) != SUCCESS)
+                return (ERROR);
+            buf->line = line;
+        }
+        terra = buf->line_terra;
+        aqua = buf->line_aqua;
+        loc = pix - (long) line * buf->nsamps;
+    }
+
+    *oz = ((uint8 *) terra[OZONE])[loc];
+    *wv = ((uint16 *) terra[WV])[loc];
+    if (*oz == LAADS_FILL && aqua_input &&
+        ((uint8 *) aqua[OZONE])[loc] != LAADS_FILL)
+    {
+        *oz = ((uint8 *) aqua[OZONE])[loc];
+        *wv = ((uint16 *) aqua[WV])[loc];
+    }
+
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  find_right_past_block
+
+PURPOSE:  Finds the first non-fill pixel past the end of the current block,
+for a run of fill pixels which reaches the end of the block.
+
+RETURN VALUE:
+Type = int
+Value          Description
+-----          -----------
+ERROR          Error reading the lines past the block
+SUCCESS        Successful completion
+
+NOTES:
+  1. Pixels covered by the pending runs already have their interpolated
+     values, as they would if the full grid were being interpolated.
+  2. If there are no non-fill pixels left in the grid, found is false and the
+     run isn't interpolated.
+******************************************************************************/
+static int find_right_past_block
+(
+    io_param terra_params[], /* I: Terra SDS parameters */
+    io_param aqua_params[],  /* I: Aqua SDS parameters */
+    bool terra_input,       /* I: is Terra CMA/CMG available? */
+    bool aqua_input,        /* I: is Aqua CMA/CMG available? */
+    Block_buf_t *buf,       /* I/O: block buffers */
+    Block_t *next,          /* I: next block, if it has been read */
+    long pix,               /* I: grid pixel location of the end of the
+                                  block */
+    long end_pix,           /* I: grid pixel location of the end of the
+                                  grid */
+    Interp_run_t *run,      /* I/O: run of fill pixels; right and the right
+                                    values are set if found */
+    bool *found             /* O: was a non-fill pixel found? */
+)
+{
+    int i;                     /* looping variable for the pending runs */
+    uint8 oz;                  /* ozone value of the current pixel */
+    uint16 wv;                 /* water vapor value of the current pixel */
+    Interp_run_t *prun = NULL; /* pending run covering the current pixel */
+
+    *found = false;
+    for (; pix < end_pix; pix++)
+    {
+        /* Use the most recent pending run covering the pixel, otherwise the
+           combined value */
+        for (i = buf->npending - 1; i >= 0; i--)
+        {
+            prun = &buf->pending[i];
+            if (pix > prun->left && pix < prun->right)
+                break;
+        }
+
+        if (i >= 0)
+        {
+            oz = prun->left_oz;
+            interpolate (DFNT_UINT8, &oz, pix, pix + 1, prun->left,
+                prun->right, prun->left_oz, prun->right_oz);
+            wv = prun->left_wv;
+            interpolate (DFNT_UINT16, &wv, pix, pix + 1, prun->left,
+                prun->right, prun->left_wv, prun->right_wv);
+        }
+        else if (get_combined_pixel (terra_params, aqua_params, terra_input,
+            aqua_input, buf, next, pix, &oz, &wv) != SUCCESS)
+            return (ERROR);
+
+        if (oz != 0)
+        {
+            run->right = pix;
+            run->right_oz = oz;
+            run->right_wv = wv;
+            *found = true;
+            break;
+        }
+    }
+
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  interpolate_run
+
+PURPOSE:  Interpolates the ozone and water vapor of the fill pixels of a run
+which fall in the block.
+
+RETURN VALUE:
+Type = None
+
+NOTES:
+******************************************************************************/
+static void interpolate_run
+(
+    Block_t *blk,           /* I/O: block of lines */
+    int nsamps,             /* I: number of samples in each line */
+    Interp_run_t *run       /* I: run of fill pixels */
+)
+{
+    long first_pix = (long) blk->first_line * nsamps;  /* first block pixel */
+    long end_pix = first_pix + (long) blk->nlines * nsamps; /* end of block */
+
+    interpolate (DFNT_UINT8, blk->terra[OZONE], first_pix, end_pix,
+        run->left, run->right, run->left_oz, run->right_oz);
+    interpolate (DFNT_UINT16, blk->terra[WV], first_pix, end_pix,
+        run->left, run->right, run->left_wv, run->right_wv);
+}
+
+
+/******************************************************************************
+MODULE:  apply_pending_runs
+
+PURPOSE:  Interpolates the pixels of the block covered by the runs pending
+from the previous blocks, and drops the runs which end in the block.
+
+RETURN VALUE:
+Type = None
+
+NOTES:
+  1. The runs are applied in the order they were found, as later runs
+     overwrite the values of earlier ones.
+******************************************************************************/
+static void apply_pending_runs
+(
+    Block_buf_t *buf,       /* I/O: block buffers */
+    Block_t *blk            /* I/O: block of lines */
+)
+{
+    int i, n;                  /* looping variables for the pending runs */
+    long end_pix;              /* grid pixel location of the end of block */
+
+    end_pix = (long) (blk->first_line + blk->nlines) * buf->nsamps;
+    for (i = 0, n = 0; i < buf->npending; i++)
+    {
+        interpolate_run (blk, buf->nsamps, &buf->pending[i]);
+        if (buf->pending[i].right > end_pix)
+            buf->pending[n++] = buf->pending[i];
+    }
+    buf->npending = n;
+}
+
+
+/******************************************************************************
+MODULE:  find_chains
+
+PURPOSE:  Splits the lines of the block to be interpolated into chains.  A new
+chain starts at each line whose previous line doesn't end in a fill pixel, as
+no run of fill pixels can cross from the previous line into that line.
+
+RETURN VALUE:
+Type = None
+
+NOTES:
+  1. The last pixel of the previous line isn't modified when the previous
+     line is interpolated, since it isn't fill, so the chains are
+     independent.
+******************************************************************************/
+static void find_chains
+(
+    Block_buf_t *buf,       /* I/O: block buffers */
+    Block_t *blk,           /* I: block of lines */
+    int first_line,         /* I: first line in the block to interpolate */
+    int end_line            /* I: line after the last line to interpolate */
+)
+{
+    int line;                  /* current grid line */
+    uint8 *oz = (uint8 *) blk->terra[OZONE];   /* combined ozone */
+
+    buf->nchains = 0;
+    for (line = first_line; line < end_line; line++)
+    {
+        if (line == first_line || oz[(long) (line - blk->first_line) *
+            buf->nsamps - 1] != 0)
+            buf->chain[buf->nchains++] = line;
+    }
+}
+
+
+/******************************************************************************
+MODULE:  interpolate_chain
+
+PURPOSE:  Interpolates the fill pixels of a chain of lines in the block.  Each
+fill pixel is interpolated between the non-fill pixels on either side of it,
+continuing on the following lines if needed.
+
+RETURN VALUE:
+Type = int
+Value          Description
+-----          -----------
+ERROR          Error reading the lines past the block
+SUCCESS        Successful completion
+
+NOTES:
+  1. Only the last chain of the block can have a run of fill pixels which
+     continues past the end of the block.  Such a run is interpolated up to
+     the end of the block and added to the pending runs.
+  2. The left pixel of a run starting at the first pixel of the block is the
+     last pixel of the previous block.
+******************************************************************************/
+static int interpolate_chain
+(
+    io_param terra_params[], /* I: Terra SDS parameters */
+    io_param aqua_params[],  /* I: Aqua SDS parameters */
+    bool terra_input,       /* I: is Terra CMA/CMG available? */
+    bool aqua_input,        /* I: is Aqua CMA/CMG available? */
+    int nlines,             /* I: number of lines in the grid */
+    Block_buf_t *buf,       /* I/O: block buffers */
+    Block_t *blk,           /* I/O: block of lines */
+    Block_t *next,          /* I: next block, if it has been read */
+    int first_line,         /* I: first line of the chain */
+    int end_line            /* I: line after the last line of the chain */
+)
+{
+    char FUNC_NAME[] = "interpolate_chain";   /* function name */
+    char errmsg[STR_SIZE];     /* error message */
+    int line;                  /* current grid line */
+    int nsamps = buf->nsamps;  /* number of samples in each line */
+    long samp;                 /* current sample in the line */
+    long pix;                  /* block pixel at the start of the line */
+    long left, right;          /* block pixels for the interpolation */
+    long npix;                 /* number of pixels in the block */
+    long first_pix;            /* grid pixel location of the block */
+    bool found;                /* was a right pixel found past the block? */
+    uint8 *oz = (uint8 *) blk->terra[OZONE];   /* combined ozone */
+    uint16 *wv = (uint16 *) blk->terra[WV];    /* combined water vapor */
+    Interp_run_t run;          /* current run of fill pixels */
+    Interp_run_t *pending = NULL;  /* reallocated pending runs */
+
+    npix = (long) blk->nlines * nsamps;
+    first_pix = (long) blk->first_line * nsamps;
+    for (line = first_line; line < end_line; line++)
+    {
+        /* Loop through the pixels in this line */
+        pix = (long) (line - blk->first_line) * nsamps;
+        for (samp = 0; samp < nsamps; samp++)
+        {
+            /* If the pixel is not fill then continue */
+            if (oz[pix+samp] != 0)
+                continue;
+
+            /* Find the left and right pixels to use for interpolation */
+            left = right = pix + samp;
+            while (right < npix && oz[right] == 0) right++;
+            left--;
+
+            run.left = first_pix + left;
+            if (left >= 0)
+            {
+                run.left_oz = oz[left];
+                run.left_wv = wv[left];
+            }
+            else
+            {
+                run.left_oz = buf->last_oz;
+                run.left_wv = buf->last_wv;
+            }
+
+            if (right < npix)
+            {
+                run.right = first_pix + right;
+                run.right_oz = oz[right];
+                run.right_wv = wv[right];
+            }
+            else
+            {
+                /* The run continues past the end of the block */
+                if (find_right_past_block (terra_params, aqua_params,
+                    terra_input, aqua_input, buf, next, first_pix + npix,
+                    (long) nlines * nsamps, &run, &found) != SUCCESS)
+                    return (ERROR);
+
+                /* If the rest of the grid is fill, there is nothing to
+                   interpolate from, and the rest of the chain is fill */
+                if (!found)
+                    return (SUCCESS);
+
+                if (buf->npending == buf->max_pending)
+                {
+                    pending = realloc (buf->pending, (buf->max_pending + 4) *
+                        sizeof (Interp_run_t));
+                    if (pending == NULL)
+                    {
+                        sprintf (errmsg, "Allocating memory for the pending "
+                            "runs");
+                        error_handler (true, FUNC_NAME, errmsg);
+                        return (ERROR);
+                    }
+                    buf->pending = pending;
+                    buf->max_pending += 4;
+                }
+                buf->pending[buf->npending++] = run;
+            }
+
+            /* Interpolate all the fill pixels between the left and right
+               non-fill pixels for the ozone and water vapor data */
+            interpolate_run (blk, nsamps, &run);
+            samp = right - pix;
+        }
+    }
+
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  write_block
+
+PURPOSE:  Writes the combined ozone, water vapor, and wherefrom of the block
+to the output HDF SDSs.
+
+RETURN VALUE:
+Type = int
+Value          Description
+-----          -----------
+ERROR          Error writing the block
+SUCCESS        Successful completion
+
+NOTES:
+******************************************************************************/
+static int write_block
+(
+    io_param terra_params[], /* I: Terra SDS parameters */
+    io_param aqua_params[],  /* I: Aqua SDS parameters */
+    bool terra_input,       /* I: is Terra CMA/CMG available? */
+    int nsamps,             /* I: number of samples in each line */
+    int32 sds_id[],         /* I: output SDS IDs, N_SDS followed by the
+                                  wherefrom SDS */
+    Block_t *blk            /* I: block of lines */
+)
+{
+    char FUNC_NAME[] = "write_block";   /* function name */
+    char errmsg[STR_SIZE];     /* error message */
+    int i;                     /* looping variable for the SDSs */
+    int32 start[2];            /* starting location in each dimension */
+    int32 edges[2];            /* number of values written in each dimension */
+
+    start[0] = blk->first_line;
+    start[1] = 0;
+    edges[0] = blk->nlines;
+    edges[1] = nsamps;
+    for (i = 0; i < N_SDS; i++)
+    {
+        if (SDwritedata (sds_id[i], start, NULL, edges, blk->terra[i]) == -1)
+        {
+            sprintf (errmsg, "Unable to write the %s SDS to the output file.",
+                terra_input ? terra_params[i].sdsname :
+                aqua_params[i].sdsname);
+            error_handler (true, FUNC_NAME, errmsg);
+            return (ERROR);
+        }
+    }
+
+    if (SDwritedata (sds_id[N_SDS], start, NULL, edges, blk->wherefrom) == -1)
+    {
+        sprintf (errmsg, "Unable to write the wherefrom SDS to the output "
+            "file.");
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  combine_blocks
+
+PURPOSE:  Reads, combines, interpolates, and writes the ozone and water vapor
+a block of lines at a time.  The Terra data is used where available, and the
+holes are filled with the Aqua data.  Remaining holes in the lines between
+INTERP_FIRST_LINE and INTERP_END_LINE of a CMG are interpolated.
+
+RETURN VALUE:
+Type = int
+Value          Description
+-----          -----------
+ERROR          Error reading, combining, or writing the blocks
+SUCCESS        Successful completion
+
+NOTES:
+  1. The next block is read by one thread while the other threads combine
+     the current block.  The chains of the block are then interpolated in
+     parallel, and for the tiled output the tiles of the block are compressed
+     in parallel.
+  2. Blocks are BLOCK_NLINES lines, which is a row of tiles for the tiled
+     auxiliary file.
+******************************************************************************/
+int combine_blocks
+(
+    io_param terra_params[], /* I: Terra SDS parameters */
+    io_param aqua_params[],  /* I: Aqua SDS parameters */
+    bool terra_input,       /* I: is Terra CMA/CMG available? */
+    bool aqua_input,        /* I: is Aqua CMA/CMG available? */
+    int32 dims[2],          /* I: number of lines and samples in the grid */
+    int32 sds_id[],         /* I: output SDS IDs, N_SDS followed by the
+                                  wherefrom SDS; not used if tiles is set */
+    Aux_tiles_writer_t *tiles, /* I/O: tiled auxiliary file to be written, or
+                                  NULL to write the HDF SDSs */
+    Block_buf_t *buf        /* I/O: block buffers */
+)
+{
+    char FUNC_NAME[] = "combine_blocks";   /* function name */
+    char errmsg[STR_SIZE];     /* error message */
+    int nlines = dims[0];      /* number of lines in the grid */
+    int nsamps = dims[1];      /* number of samples in the grid */
+    int iblk;                  /* current block */
+    int line;                  /* looping variable for the lines */
+    int ichain;                /* looping variable for the chains */
+    int tsamp;                 /* looping variable for the tile columns */
+    int interp_first, interp_end;  /* lines of the block to interpolate */
+    long npix;                 /* number of pixels in the block */
+    bool failed = false;       /* did reading or interpolating fail? */
+    Block_t *blk = NULL;       /* block being combined */
+    Block_t *next = NULL;      /* next block, read while combining */
+
+    /* Reset the state carried between the blocks */
+    buf->block[0].nlines = 0;
+    buf->block[1].nlines = 0;
+    buf->line = -1;
+    buf->npending = 0;
+    buf->last_oz = 0;
+    buf->last_wv = 0;
+
+    /* Read the first block */
+    blk = &buf->block[0];
+    blk->first_line = 0;
+    blk->nlines = nlines < BLOCK_NLINES ? nlines : BLOCK_NLINES;
+    if (read_lines (terra_params, aqua_params, terra_input, aqua_input,
+        blk->first_line, blk->nlines, nsamps, blk->terra, blk->aqua) !=
+        SUCCESS)
+    {
+        sprintf (errmsg, "Reading the first block of lines");
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    for (iblk = 0; blk->nlines > 0; iblk++)
+    {
+        blk = &buf->block[iblk % 2];
+        next = &buf->block[(iblk + 1) % 2];
+        next->first_line = blk->first_line + blk->nlines;
+        next->nlines = nlines - next->first_line;
+        if (next->nlines > BLOCK_NLINES)
+            next->nlines = BLOCK_NLINES;
+        npix = (long) blk->nlines * nsamps;
+
+        /* Lines of this block to be interpolated, if this is a CMG */
+        interp_first = interp_end = 0;
+        if (nlines == CMG_NLINES)
+        {
+            interp_first = blk->first_line;
+            if (interp_first < INTERP_FIRST_LINE)
+                interp_first = INTERP_FIRST_LINE;
+            interp_end = blk->first_line + blk->nlines;
+            if (interp_end > INTERP_END_LINE)
+                interp_end = INTERP_END_LINE;
+        }
+
+#ifdef _OPENMP
+        #pragma omp parallel private (line, ichain, tsamp)
+#endif
+        {
+            /* Read the next block while the current block is combined */
+#ifdef _OPENMP
+            #pragma omp single nowait
+#endif
+            {
+                if (next->nlines > 0 && read_lines (terra_params,
+                    aqua_params, terra_input, aqua_input, next->first_line,
+                    next->nlines, nsamps, next->terra, next->aqua) != SUCCESS)
+                    failed = true;
+            }
+
+#ifdef _OPENMP
+            #pragma omp for schedule (dynamic)
+#endif
+            for (line = 0; line < blk->nlines; line++)
+                combine_line (blk, buf->data_type, terra_input, aqua_input,
+                    line, nsamps);
+
+            /* Finish the runs from the previous blocks and split the lines
+               to be interpolated into chains */
+#ifdef _OPENMP
+            #pragma omp single
+#endif
+            {
+                apply_pending_runs (buf, blk);
+                find_chains (buf, blk, interp_first, interp_end);
+            }
+
+            /* Each chain ends before the next chain starts */
+#ifdef _OPENMP
+            #pragma omp for schedule (dynamic)
+#endif
+            for (ichain = 0; ichain < buf->nchains; ichain++)
+            {
+                if (!failed && interpolate_chain (terra_params, aqua_params,
+                    terra_input, aqua_input, nlines, buf, blk, next,
+                    buf->chain[ichain], ichain + 1 < buf->nchains ?
+                    buf->chain[ichain+1] : interp_end) != SUCCESS)
+                    failed = true;
+            }
+
+            /* Compress the row of tiles */
+            if (tiles != NULL)
+            {
+#ifdef _OPENMP
+                #pragma omp for schedule (dynamic)
+#endif
+                for (tsamp = 0; tsamp < tiles->hdr.ntile_samps; tsamp++)
+                    compress_aux_tile (tiles, tsamp, blk->terra[WV],
+                        blk->terra[OZONE]);
+            }
+        }
+
+        if (failed)
+        {
+            sprintf (errmsg, "Combining lines %d-%d", blk->first_line,
+                blk->first_line + blk->nlines - 1);
+            error_handler (true, FUNC_NAME, errmsg);
+            return (ERROR);
+        }
+
+        /* Write the block */
+        if (tiles != NULL)
+        {
+            if (write_aux_tile_row (tiles) != SUCCESS)
+                return (ERROR);
+        }
+        else if (write_block (terra_params, aqua_params, terra_input, nsamps,
+            sds_id, blk) != SUCCESS)
+            return (ERROR);
+
+        /* Save the last pixel for the runs starting at the beginning of the
+           next block */
+        buf->last_oz = ((uint8 *) blk->terra[OZONE])[npix-1];
+        buf->last_wv = ((uint16 *) blk->terra[WV])[npix-1];
+        blk = next;
+    }
+
+    return (SUCCESS);
+}
@@ -25,12 +25,9 @@ NOTES:
 #include "combine_l8_aux_data.h"
 
 /* Program will look for these SDSs in the CMG/CMA inputs */
-#define N_SDS 2
 char list_of_sds[N_SDS][50] = {
     "Coarse Resolution Ozone",
     "Coarse Resolution Water Vapor"};
-#define OZONE 0
-#define WV 1
    
 /* Global variables */
 bool global_yearday_is_set = false;
@@ -68,60 +65,200 @@ NOTES:
    used for each SDS.  If the Terra pixel is fill, then the application tries
    to use the Aqua pixel.  If Aqua is also fill, then ultimately that pixel
    value is interpolated.
+4. With --tiled, the combined ozone and water vapor are written as the tiled
+   auxiliary file (see write_aux_tiles.c) instead of the HDF file.  The
+   wherefrom SDS is only written to the HDF file.
+5. With --days, each day in the range is combined from the CMG/CMA files
+   found in the input directory, reusing the block buffers.  Days without a
+   complete set of CMG and CMA files are skipped.
 ******************************************************************************/
 int main (int argc, char **argv)
 {    
-    bool found;                /* was current SDS found in Aqua/Terra file */
-    bool aqua_input = false;   /* is this Aqua CMA/CMG */
-    bool terra_input = false;  /* is this Terra CMA/CMG */
+    bool tiled;                /* write the tiled auxiliary file instead of
+                                  the HDF file */
     bool verbose;              /* verbose flag for printing messages */
     char FUNC_NAME[] = "main"; /* function name */
     char errmsg[STR_SIZE];     /* error message */
-    char dim0name[] = "YDim_MOD09CMG";   /* y dimension name */
-    char dim1name[] = "XDim_MOD09CMG";   /* x dimension name */
     char *terra_cmg_file = NULL;  /* input Terra CMG file */
     char *aqua_cmg_file = NULL;   /* input Aqua CMG file */
     char *terra_cma_file = NULL;  /* input Terra CMA file */
     char *aqua_cma_file = NULL;   /* input Aqua CMA file */
+    char *input_dir = NULL;       /* input directory for the CMG/CMA files */
     char *output_dir = NULL;      /* output directory for the auxiliary file */
+    int first_day;           /* first year/day (yyyyddd) to be combined */
+    int last_day;            /* last year/day (yyyyddd) to be combined */
+    int yearday;             /* current year/day (yyyyddd) */
+    int year, doy;           /* year and DOY of the current day */
+    int retval;              /* return status */
+    Block_buf_t buf;         /* block buffers, reused for each day */
+
+    /* Read the command-line arguments */
+    retval = get_args (argc, argv, &terra_cmg_file, &aqua_cmg_file,
+        &terra_cma_file, &aqua_cma_file, &input_dir, &output_dir, &first_day,
+        &last_day, &tiled, &verbose);
+    if (retval != SUCCESS)
+    {   /* get_args already printed the error message */
+        exit (ERROR);
+    }
+    memset (&buf, 0, sizeof (buf));
+
+    /* Combine the specified input files */
+    if (first_day == 0)
+    {
+        retval = combine_day (argc, argv, terra_cmg_file, aqua_cmg_file,
+            terra_cma_file, aqua_cma_file, output_dir, tiled, verbose, &buf);
+        if (retval != SUCCESS)
+        {
+            sprintf (errmsg, "Error combining the auxiliary data");
+            error_handler (true, FUNC_NAME, errmsg);
+            exit (ERROR);
+        }
+    }
+
+    /* Combine each day in the range, from the input directory */
+    for (yearday = first_day; first_day != 0 && yearday <= last_day; )
+    {
+        retval = find_day_files (input_dir, yearday, &terra_cmg_file,
+            &aqua_cmg_file, &terra_cma_file, &aqua_cma_file);
+        if (retval != SUCCESS)
+        {
+            sprintf (errmsg, "Error finding the input files for %07d",
+                yearday);
+            error_handler (true, FUNC_NAME, errmsg);
+            exit (ERROR);
+        }
+
+        if ((terra_cmg_file && terra_cma_file) ||
+            (aqua_cmg_file && aqua_cma_file))
+        {
+            /* Only use the CMG/CMA pairs which are complete */
+            if (!terra_cmg_file || !terra_cma_file)
+            {
+                free (terra_cmg_file);
+                free (terra_cma_file);
+                terra_cmg_file = terra_cma_file = NULL;
+            }
+            if (!aqua_cmg_file || !aqua_cma_file)
+            {
+                free (aqua_cmg_file);
+                free (aqua_cma_file);
+                aqua_cmg_file = aqua_cma_file = NULL;
+            }
+
+            if (verbose)
+                printf ("Combining the auxiliary data for %07d ...\n",
+                    yearday);
+            retval = combine_day (argc, argv, terra_cmg_file, aqua_cmg_file,
+                terra_cma_file, aqua_cma_file, output_dir, tiled, verbose,
+                &buf);
+            if (retval != SUCCESS)
+            {
+                sprintf (errmsg, "Error combining the auxiliary data for "
+                    "%07d", yearday);
+                error_handler (true, FUNC_NAME, errmsg);
+                exit (ERROR);
+            }
+        }
+        else
+        {
+            sprintf (errmsg, "CMG and CMA files for Terra or Aqua are not "
+                "available for %07d, skipping ...", yearday);
+            error_handler (false, FUNC_NAME, errmsg);
+        }
+
+        free (terra_cmg_file);
+        free (aqua_cmg_file);
+        free (terra_cma_file);
+        free (aqua_cma_file);
+        terra_cmg_file = aqua_cmg_file = NULL;
+        terra_cma_file = aqua_cma_file = NULL;
+
+        /* Move to the next day, wrapping to the next year */
+        year = yearday / 1000;
+        doy = yearday % 1000 + 1;
+        if (doy > 366 || (doy == 366 && !((year % 4 == 0 && year % 100 != 0)
+            || year % 400 == 0)))
+        {
+            year++;
+            doy = 1;
+        }
+        yearday = year * 1000 + doy;
+    }
+
+    /* Close and clean up */
+    free_block_buf (&buf);
+    free (terra_cmg_file);
+    free (aqua_cmg_file);
+    free (terra_cma_file);
+    free (aqua_cma_file);
+    free (input_dir);
+    free (output_dir);
+
+    /* Successful completion */
+    exit (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  combine_day
+
+PURPOSE:  Combines the Aqua and Terra CMG and CMA files for one day and writes
+the fused output HDF file or the tiled auxiliary file.
+
+RETURN VALUE:
+Type = int
+Value          Description
+-----          -----------
+ERROR          Error occurred reading the inputs or writing the fused output
+SUCCESS        Successful completion
+
+NOTES:
+  1. The input files are read, combined, interpolated, and written a block of
+     lines at a time by combine_blocks, so only two blocks of lines are held
+     in memory.
+  2. On error the input and output files aren't closed, since the
+     application exits.
+******************************************************************************/
+int combine_day
+(
+    int argc,               /* I: number of cmd-line args */
+    char *argv[],           /* I: string of cmd-line args */
+    char *terra_cmg_file,   /* I: input Terra CMG file (NULL if none) */
+    char *aqua_cmg_file,    /* I: input Aqua CMG file (NULL if none) */
+    char *terra_cma_file,   /* I: input Terra CMA file (NULL if none) */
+    char *aqua_cma_file,    /* I: input Aqua CMA file (NULL if none) */
+    char *output_dir,       /* I: output directory for the auxiliary file */
+    bool tiled,             /* I: write the tiled auxiliary file? */
+    bool verbose,           /* I: verbose flag */
+    Block_buf_t *buf        /* I/O: block buffers, reused for each day */
+)
+{
+    bool found;                /* was current SDS found in Aqua/Terra file */
+    bool aqua_input = false;   /* is this Aqua CMA/CMG */
+    bool terra_input = false;  /* is this Terra CMA/CMG */
+    char FUNC_NAME[] = "combine_day"; /* function name */
+    char errmsg[STR_SIZE];     /* error message */
+    char dim0name[] = "YDim_MOD09CMG";   /* y dimension name */
+    char dim1name[] = "XDim_MOD09CMG";   /* x dimension name */
     char sdsname[STR_SIZE];       /* Terra/Aqua SDS name */
     char tmpstr[STR_SIZE];        /* temporary string for creating file
                                      attributes */
-    char outfilename[STR_SIZE];   /* name of the output HDF file */
+    char outfilename[STR_SIZE];   /* name of the output HDF or tiled file */
     io_param terra_params[N_SDS]; /* array of Terra SDS parameters (if avail) */
     io_param aqua_params[N_SDS];  /* array of Aqua SDS parameters (if avail) */
-    long pix;                /* current pixel location in the 1D array */
     int i, j;                /* looping variables */
-    int nbits;               /* number of bits per pixel for this data array */
-    int line;                /* current line in the CMG data array */
-    int samp;                /* current sample in the line */
-    int left, right;         /* pixel locations for interpolation */ 
-    int n_pixels;            /* number of pixels in this 1D array */
     int n_bad;               /* number of bad/mismatches SDSs */
     int retval;              /* return status */
     int32 dims[2] = {IFILL, IFILL}; /* dimensions of desired CMG/CMA SDSs */
-    int32 sd_out;            /* SD ID for the output file */
+    int32 sd_out = -1;       /* SD ID for the output file */
     int32 sds_id[N_SDS+1];   /* SDS IDs for the output file */
     int32 dimid;             /* dimension ID */
-    int32 start[2];          /* starting location in each dimension */
     int32 where[N_SDS];      /* location of any missing SDSs */
-    int32 dtype;             /* Terra/Aqua data type */
-    int8 *wherefrom = NULL;  /* array to identify where the pixel value was
-                                pulled from - AQUA or TERRA */
-    uint8 terra_pix = 0;     /* terra pixel */
-    uint8 aqua_pix = 0;      /* aqua pixel */
-    uint8 *tmask = NULL;     /* mask for the Terra pixel values */
-    uint8 *amask = NULL;     /* mask for the Aqua pixel values */
-
-    /* Read the command-line arguments */
-    retval = get_args (argc, argv, &terra_cmg_file, &aqua_cmg_file,
-        &terra_cma_file, &aqua_cma_file, &output_dir, &verbose);
-    if (retval != SUCCESS)
-    {   /* get_args already printed the error message */
-        exit (ERROR);
-    }
+    int32 dtype[N_SDS];      /* Terra/Aqua data type of each SDS */
+    Aux_tiles_writer_t *tiles = NULL;  /* tiled auxiliary file */
 
     /* Initialize the SDS information for the input files */
+    global_yearday_is_set = false;
     for (i = 0; i < N_SDS; i++)
     {
         strcpy (terra_params[i].sdsname, "(missing SDS)");
@@ -145,7 +282,7 @@ int main (int argc, char **argv)
         {
             sprintf (errmsg, "Error parsing file: %s", terra_cmg_file);
             error_handler (true, FUNC_NAME, errmsg);
-            exit (ERROR);
+            return (ERROR);
         }
     }
        
@@ -156,7 +293,7 @@ int main (int argc, char **argv)
         {
             sprintf (errmsg, "Error parsing file: %s", aqua_cmg_file);
             error_handler (true, FUNC_NAME, errmsg);
-            exit (ERROR);
+            return (ERROR);
         }
     }
        
@@ -167,7 +304,7 @@ int main (int argc, char **argv)
         {
             sprintf (errmsg, "Error parsing file: %s", terra_cma_file);
             error_handler (true, FUNC_NAME, errmsg);
-            exit (ERROR);
+            return (ERROR);
         }
     }
        
@@ -178,7 +315,7 @@ int main (int argc, char **argv)
         {
             sprintf (errmsg, "Error parsing file: %s", aqua_cma_file);
             error_handler (true, FUNC_NAME, errmsg);
-            exit (ERROR);
+            return (ERROR);
         }
     }
 
@@ -210,7 +347,7 @@ int main (int argc, char **argv)
             sprintf (errmsg, "Unable to find SDS in either the Aqua or "
                 "Terra file: %s", list_of_sds[i]);
             error_handler (true, FUNC_NAME, errmsg);
-            exit (ERROR);
+            return (ERROR);
         }
     }
 
@@ -242,7 +379,7 @@ int main (int argc, char **argv)
         {
             sprintf (errmsg, "Different sets of SDSs have been staged.");
             error_handler (true, FUNC_NAME, errmsg);
-            exit (ERROR);
+            return (ERROR);
 
 #ifdef DEBUG
             printf ("\nTerra:\n");
@@ -270,111 +407,122 @@ int main (int argc, char **argv)
         dims[1] = aqua_params[0].sds_dims[1];
     }
 
-    /* Allocate memory for the data arrays, separate memory for each of the
-       SDSs we are going to read and output */
-    nbits = 0;
-    n_pixels = dims[1] * dims[0];
+    /* Check the data type of each SDS */
     for (i = 0; i < N_SDS; i++)
     {
         if (terra_input)
         {
-            dtype = terra_params[i].data_type;
+            dtype[i] = terra_params[i].data_type;
             strcpy (sdsname, terra_params[i].sdsname);
         }
         else
         {
-            dtype = aqua_params[i].data_type;
+            dtype[i] = aqua_params[i].data_type;
             strcpy (sdsname, aqua_params[i].sdsname);
         }
 
-        if (dtype == DFNT_INT16)
-            nbits = sizeof (int16);
-        else if (dtype == DFNT_UINT16)
-            nbits = sizeof (uint16);
-        else if (dtype == DFNT_INT8)
-            nbits = sizeof (int8);
-        else if (dtype == DFNT_UINT8)
-            nbits = sizeof (uint8);
-        else
+        if (dtype[i] != DFNT_INT16 && dtype[i] != DFNT_UINT16 &&
+            dtype[i] != DFNT_INT8 && dtype[i] != DFNT_UINT8)
         {
             sprintf (errmsg, "Unsupported data type for SDS %s.  Only int16 "
                 "uint16, int8, and uint8 are supported.", sdsname);
             error_handler (true, FUNC_NAME, errmsg);
-            exit (ERROR);
+            return (ERROR);
         }
 
-        /* This is the location of the final output data, so allocate this
-           data array regardless of whether or not Terra data is available */
-        terra_params[i].data = calloc (n_pixels, nbits);
-        if (terra_params[i].data == NULL)
+        /* The tiled file holds the ozone as uint8 and the water vapor as
+           uint16, as lasrc expects them */
+        if (tiled && ((i == OZONE && dtype[i] != DFNT_UINT8) ||
+            (i == WV && dtype[i] != DFNT_UINT16)))
         {
-            sprintf (errmsg, "Allocating memory (%d bits) for Terra SDS: "
-                "%s", nbits, sdsname);
+            sprintf (errmsg, "Unexpected data type for SDS %s.  The tiled "
+                "output requires uint8 ozone and uint16 water vapor.",
+                sdsname);
             error_handler (true, FUNC_NAME, errmsg);
-            exit (ERROR);
-        }
-
-        /* Only allocate if Aqua data is available */
-        if (aqua_input)
-        {
-            aqua_params[i].data = calloc (n_pixels, nbits);
-            if (aqua_params[i].data == NULL)
-            {
-                sprintf (errmsg, "Allocating memory (%d bits) for Aqua SDS: %s",
-                    nbits, sdsname);
-                error_handler (true, FUNC_NAME, errmsg);
-                exit (ERROR);
-            }
+            return (ERROR);
         }
     }  /* end for i */
 
-    /* Allocate memory for the wherefrom array, with bits of size int8 */
-    wherefrom = calloc (n_pixels, sizeof (int8));
-    if (wherefrom == NULL)
+    /* Allocate the block buffers, or reuse the buffers from the previous
+       day */
+    retval = alloc_block_buf (buf, dims[1], dtype);
+    if (retval != SUCCESS)
     {
-        sprintf (errmsg, "Allocating memory for the wherefrom array");
+        sprintf (errmsg, "Allocating the block buffers");
         error_handler (true, FUNC_NAME, errmsg);
-        exit (ERROR);
+        return (ERROR);
     }
 
-    /* Create the output file */
-    make_outfile_name (global_yearday, output_dir, outfilename);
+    /* Create the output file, either as the tiled auxiliary file or as the
+       HDF file with an SDS for each parameter and the wherefrom SDS */
+    make_outfile_name (global_yearday, output_dir, tiled, outfilename);
     if (verbose)
         printf ("Creating output auxiliary file: %s\n", outfilename);
-    sd_out = SDstart (outfilename, DFACC_CREATE);
-    if (sd_out == -1)
+    if (tiled)
     {
-        sprintf (errmsg, "Unable to create the output file %s", outfilename);
-        error_handler (true, FUNC_NAME, errmsg);
-        exit (ERROR);
+        tiles = open_aux_tiles_writer (outfilename, dims[0], dims[1]);
+        if (tiles == NULL)
+        {
+            sprintf (errmsg, "Unable to create the tiled auxiliary file %s",
+                outfilename);
+            error_handler (true, FUNC_NAME, errmsg);
+            return (ERROR);
+        }
     }
-
-    /* Loop through the SDSs that we intend to read/write, and create an SDS
-       in the output file for that SDS */
-    for (i = 0; i < N_SDS; i++)
+    else
     {
-        /* Get the SDS information */
-        if (terra_input)
+        /* Create the output HDF file */
+        sd_out = SDstart (outfilename, DFACC_CREATE);
+        if (sd_out == -1)
         {
-            dtype = terra_params[i].data_type;
-            strcpy (sdsname, terra_params[i].sdsname);
+            sprintf (errmsg, "Unable to create the output file %s",
+                outfilename);
+            error_handler (true, FUNC_NAME, errmsg);
+            return (ERROR);
         }
-        else
+
+        /* Loop through the SDSs that we intend to read/write, and create an
+           SDS in the output file for that SDS */
+        for (i = 0; i < N_SDS; i++)
         {
-            dtype = aqua_params[i].data_type;
-            strcpy (sdsname, aqua_params[i].sdsname);
+            /* Get the SDS information */
+            if (terra_input)
+                strcpy (sdsname, terra_params[i].sdsname);
+            else
+                strcpy (sdsname, aqua_params[i].sdsname);
+
+            /* Create the SDS using information from the Terra or Aqua
+               file */
+            if (verbose)
+                 printf ("Creating %s SDS with %d data type and %d x %d ...\n",
+                     sdsname, dtype[i], dims[0], dims[1]);
+            sds_id[i] = SDcreate (sd_out, sdsname, dtype[i], 2, dims);
+            if (sds_id[i] == -1)
+            {
+                sprintf (errmsg, "Creating SDS %s in the output file", sdsname);
+                error_handler (true, FUNC_NAME, errmsg);
+                return (ERROR);
+            }
+
+            /* Set the dimension names to the dimension ID */
+            dimid = SDgetdimid (sds_id[i], 0);
+            if (dimid != -1)
+                SDsetdimname (dimid, dim0name);
+
+            dimid = SDgetdimid (sds_id[i], 1);
+            if (dimid != -1)
+                SDsetdimname (dimid, dim1name); 
         }
 
-        /* Create the SDS using information from the Terra or Aqua file */
-        if (verbose)
-             printf ("Creating %s SDS with %d data type and %d x %d ...\n",
-                 sdsname, dtype, dims[0], dims[1]);
-        sds_id[i] = SDcreate (sd_out, sdsname, dtype, 2, dims);
+        /* Create the wherefrom SDS to keep track of where each pixel came
+           from */
+        sds_id[i] = SDcreate (sd_out, "wherefrom", DFNT_INT8, 2, dims);
         if (sds_id[i] == -1)
         {
-            sprintf (errmsg, "Creating SDS %s in the output file", sdsname);
+            sprintf (errmsg, "Unable to create the 'wherefrom' SDS in the "
+                "output file");
             error_handler (true, FUNC_NAME, errmsg);
-            exit (ERROR);
+            return (ERROR);
         }
 
         /* Set the dimension names to the dimension ID */
@@ -385,199 +533,39 @@ int main (int argc, char **argv)
         dimid = SDgetdimid (sds_id[i], 1);
         if (dimid != -1)
             SDsetdimname (dimid, dim1name); 
-    }
-
-    /* Create the wherefrom SDS to keep track of where each pixel came from */
-    sds_id[i] = SDcreate (sd_out, "wherefrom", DFNT_INT8, 2, dims);
-    if (sds_id[i] == -1)
-    {
-        sprintf (errmsg, "Unable to create the 'wherefrom' SDS in the output "
-            "file");
-        error_handler (true, FUNC_NAME, errmsg);
-        exit (ERROR);
-    }
-
-    /* Set the dimension names to the dimension ID */
-    dimid = SDgetdimid (sds_id[i], 0);
-    if (dimid != -1)
-        SDsetdimname (dimid, dim0name);
-
-    dimid = SDgetdimid (sds_id[i], 1);
-    if (dimid != -1)
-        SDsetdimname (dimid, dim1name); 
 
-    /* Set the output file attributes */
-    tmpstr[0] = '\0';
-    for (i = 0; i < argc; i++)
-        sprintf (tmpstr + strlen (tmpstr), " %s", argv[i]);
-    SDsetattr (sd_out, "command", DFNT_CHAR, strlen (tmpstr), tmpstr);
+        /* Set the output file attributes */
+        tmpstr[0] = '\0';
+        for (i = 0; i < argc; i++)
+            sprintf (tmpstr + strlen (tmpstr), " %s", argv[i]);
+        SDsetattr (sd_out, "command", DFNT_CHAR, strlen (tmpstr), tmpstr);
 
-    /* Start of processing the inputs .... */
-    if (verbose)
-        printf ("Reading each SDS ...\n");
-
-    /* Read each SDS */
-    start[0] = 0;
-    start[1] = 0;
-    for (i = 0; i < N_SDS; i++)
-    {
-        /* Get the SDS information */
-        if (terra_input)
-            strcpy (sdsname, terra_params[i].sdsname);
-        else
-            strcpy (sdsname, aqua_params[i].sdsname);
-
-        if (verbose)
-            printf ("    %s\n", sdsname);
-
-        /* Read the Terra data for this SDS, if it's available */
-        if (terra_input)
-        {
-            retval = SDreaddata (terra_params[i].sds_id, start, NULL, dims,
-                terra_params[i].data);
-            if (retval == -1)
-            {
-                sprintf (errmsg, "Unable to read SDS %s from the Terra file",
-                    sdsname);
-                error_handler (true, FUNC_NAME, errmsg);
-                exit (ERROR);
-            }
-        }
-
-        /* Read the Aqua data for this SDS, if it's available */
-        if (aqua_input)
-        {
-            retval = SDreaddata (aqua_params[i].sds_id, start, NULL, dims,
-                aqua_params[i].data);
-            if (retval == -1)
-            {
-                sprintf (errmsg, "Unable to read SDS %s from the Aqua file",
-                    sdsname);
-                error_handler (true, FUNC_NAME, errmsg);
-                exit (ERROR);
-            }
-        }
+        /* Set the key attribute to provide information on the wherefrom
+           pixel values */
+        strcpy (tmpstr, "0=none, 1=Terra, 2=Aqua"); 
+        SDsetattr (sds_id[N_SDS], "key", DFNT_CHAR, strlen (tmpstr), tmpstr);
     }
 
-    /* Use the Coarse Resolution Ozone SDS to determine if the pixel will come
-       from Terra or Aqua.  This SDS is a uint8 data array. */
+    /* Read, combine, interpolate, and write each block of lines.  Holes in
+       the water vapor and ozone are only interpolated for lines 1000 to 2600
+       of a CMG (excluding the poles). */
     if (verbose)
-        printf ("Combining Aqua and Terra products for each SDS ...\n");
-    tmask = (uint8 *) terra_params[OZONE].data;
-    if (aqua_input)
-        amask = (uint8 *) aqua_params[OZONE].data;
-    for (i = 0; i < n_pixels; i++)
-    {
-        /* Initialize the masks */
-        wherefrom[i] = UNSET;
-        terra_pix = tmask[i];
-        if (aqua_input)
-            aqua_pix = amask[i];
-
-        /* If the Terra data is available and the pixel is not fill, then use
-           Terra.  Otherwise if the Aqua pixel isn't fill, then use Aqua.  In
-           the latter case, the Aqua pixels for each SDS are copied over to the
-           Terra array so that at the end the Terra array has all the output
-           info. */
-        if (terra_input && terra_pix != LAADS_FILL)
-        {  /* do nothing but set wherefrom */
-            wherefrom[i] = TERRA;
-        }
-        else if (aqua_input && terra_pix == LAADS_FILL &&
-                 aqua_pix != LAADS_FILL)
-        {  /* copy Aqua pixels over to Terra pixels for each SDS and set
-              wherefrom */
-            for (j = 0; j < N_SDS; j++)
-            {
-                if (terra_input)
-                    dtype = terra_params[j].data_type;
-                else
-                    dtype = aqua_params[j].data_type;
-
-                copy_param (terra_params[j].data, aqua_params[j].data, dtype,i);
-            }
-
-            wherefrom[i] = AQUA;
-        }
-    }
-
-    /* Interpolate water vapor and ozone data.  But, only for lines 1000 to
-       2600, assuming CMGs (exclude the poles). */
-    if (verbose)
-        printf ("Interpolating combined products for WV and OZ ...\n");
-    if (dims[0] == 3600)
-    {  /* then, yeah, we have a CMG */
-        for (line = 1000; line < 2600; line++)
-        {
-            /* Get the current pixel location in the 1D array for this line */
-            pix = (long) line * dims[1];
-
-            /* Loop through the pixels in this line */
-            left = right = -1;
-            for (samp = 0; samp < dims[1]; samp++)
-            {
-                /* If the pixel is not fill then continue.  Recall that the
-                   tmask now contains the final output data array, combined
-                   from Terra and Aqua. */
-                if (tmask[pix+samp] != 0)
-                    continue;
-
-                /* Find the left and right pixels in the line to use for
-                   interpolation.  Basically need the non-fill pixels
-                   surrounding the current pixel. */
-                left = right = samp;
-                while (tmask[pix+right] == 0) right++;
-                samp = right;
-                left--;
-
-                /* Interpolate all the fill pixels between the left and right
-                   non-fill pixels for the ozone and water vapor data */
-                interpolate (DFNT_UINT8, terra_params[OZONE].data, pix, left,
-                    right);
-                interpolate (DFNT_UINT16, terra_params[WV].data, pix, left,
-                    right);
-            }
-        }
-    }  /* if dims[0] */
-
-    /* Write each SDS to the output file */
-    start[0] = 0;
-    start[1] = 0;
-    for (i = 0; i < N_SDS; i++)
-    {
-        if (terra_input)
-            strcpy (sdsname, terra_params[i].sdsname);
-        else
-            strcpy (sdsname, aqua_params[i].sdsname);
-
-        retval = SDwritedata (sds_id[i], start, NULL, dims,
-            terra_params[i].data); 
-        if (retval == -1)
-        {
-            sprintf (errmsg, "Unable to write the %s SDS to the output file.",
-                sdsname);
-            error_handler (true, FUNC_NAME, errmsg);
-            exit (ERROR);
-        }
-    }
-
-    /* Write the wherefrom SDS to the output file, and set the key attribute
-       to provide information on these pixel values */
-    retval = SDwritedata(sds_id[i], start, NULL, dims, wherefrom); 
-    if (retval == -1)
+        printf ("Combining and interpolating Aqua and Terra products for "
+            "each block of lines ...\n");
+    retval = combine_blocks (terra_params, aqua_params, terra_input,
+        aqua_input, dims, sds_id, tiles, buf);
+    if (retval != SUCCESS)
     {
-        sprintf (errmsg, "Unable to write the wherefrom SDS to the output "
-            "file.");
+        sprintf (errmsg, "Unable to write the combined auxiliary file %s",
+            outfilename);
         error_handler (true, FUNC_NAME, errmsg);
-        exit (ERROR);
+        close_aux_tiles_writer (tiles, false);
+        return (ERROR);
     }
-    strcpy (tmpstr, "0=none, 1=Terra, 2=Aqua"); 
-    SDsetattr (sds_id[i], "key", DFNT_CHAR, strlen (tmpstr), tmpstr);
 
     /* Close and clean up */
     for (i = 0; i < N_SDS; i++)
     {
-        free (terra_params[i].data);
         if (terra_input)
         {
             SDendaccess (terra_params[i].sds_id);
@@ -587,112 +575,120 @@ int main (int argc, char **argv)
         if (aqua_input)
         {
             SDendaccess (aqua_params[i].sds_id);
-            free (aqua_params[i].data);
             SDend (aqua_params[i].sd_id);
         }
 
-        SDendaccess (sds_id[i]);
+        if (!tiled)
+            SDendaccess (sds_id[i]);
     }   
-    SDendaccess (sds_id[i]);
-    SDend (sd_out);
-    free (terra_cmg_file);
-    free (aqua_cmg_file);
-    free (terra_cma_file);
-    free (aqua_cma_file);
-    free (output_dir);
-    free (wherefrom);
+    if (tiled)
+    {
+        retval = close_aux_tiles_writer (tiles, true);
+        if (retval != SUCCESS)
+        {
+            sprintf (errmsg, "Unable to write the tiled auxiliary file %s",
+                outfilename);
+            error_handler (true, FUNC_NAME, errmsg);
+            return (ERROR);
+        }
+    }
+    else
+    {
+        SDendaccess (sds_id[i]);
+        SDend (sd_out);
+    }
 
-    /* Successful completion */
-    exit (SUCCESS);
+    return (SUCCESS);
 }
 
 
 /******************************************************************************
-MODULE:  interpolate
+MODULE:  find_day_files
 
-PURPOSE:  Interpolates all fill pixels between the left and right pixels.
+PURPOSE:  Finds the Terra and Aqua CMG and CMA files for the specified day in
+the input directory.
 
 RETURN VALUE:
-Type = None
-
-HISTORY:
-Date         Programmer       Reason
----------    ---------------  -------------------------------------
-8/28/2014    Gail Schmidt     Conversion of the original code delivered by
-                              Eric Vermote, NASA GSFC, for use within ESPA
+Type = int
+Value          Description
+-----          -----------
+ERROR          Error reading the input directory, or more than one file of a
+               type was found for the day
+SUCCESS        Successful completion
 
 NOTES:
-  1. Only supports uint8 and uint16.
+  1. The files are found by name, i.e. M[OY]D09CM[GA].Ayyyyddd.*.hdf, as
+     downloaded from LAADS.  Files which aren't found are returned as NULL.
+  2. Memory is allocated for the files found.  The caller is responsible for
+     freeing it.
 ******************************************************************************/
-void interpolate
+int find_day_files
 (
-    int32 data_type,     /* I: data type of the data array */
-    void *data,          /* I: data array */
-    long lineoffset,     /* I: pixel location for the start of this line */
-    int left,            /* I: location in the line of the left pixel */
-    int right            /* I: location in the line of the right pixel */
+    char *input_dir,        /* I: directory containing the CMG/CMA files */
+    int yearday,            /* I: year/day (yyyyddd) to be combined */
+    char **terra_cmg_file,  /* O: address of Terra CMG file (NULL if none) */
+    char **aqua_cmg_file,   /* O: address of Aqua CMG file (NULL if none) */
+    char **terra_cma_file,  /* O: address of Terra CMA file (NULL if none) */
+    char **aqua_cma_file    /* O: address of Aqua CMA file (NULL if none) */
 )
 {
-    uint8 *ui8x = NULL;     /* uint8 pointer */
-    uint16 *ui16x = NULL;   /* uint16 pointer */
-    int i;                  /* looping variable */
-    int diff;               /* distance between the left and right pixels */
-    float slope;            /* slope for this pixel */
-
-    /* Determine the distance between the left and right pixels */
-    diff = right - left;
-
-    /* Handle the interpolation between the pixels based on the data type */
-    if (data_type == DFNT_UINT8)
+    char FUNC_NAME[] = "find_day_files"; /* function name */
+    char errmsg[STR_SIZE];     /* error message */
+    char *products[4] = {"MOD09CMG", "MYD09CMG", "MOD09CMA", "MYD09CMA"};
+                               /* products to be found */
+    char pattern[STR_SIZE];    /* filename pattern for the current product */
+    char **files[4];           /* addresses of the files for each product */
+    int i;                     /* looping variable for the products */
+    DIR *dir = NULL;           /* input directory */
+    struct dirent *entry = NULL;  /* current directory entry */
+
+    files[0] = terra_cmg_file;
+    files[1] = aqua_cmg_file;
+    files[2] = terra_cma_file;
+    files[3] = aqua_cma_file;
+    for (i = 0; i < 4; i++)
+        *files[i] = NULL;
+
+    dir = opendir (input_dir);
+    if (dir == NULL)
     {
-        ui8x = (uint8 *)data;
-        if (ui8x[lineoffset+right] > ui8x[lineoffset+left])
-        {
-            slope = ((float) ui8x[lineoffset+right] -
-                     (float) ui8x[lineoffset+left]) / (float) (diff);
-            for (i = 0; i < diff; i++)
-            {
-                ui8x[lineoffset+i+left] = (uint8)
-                    ((float) ui8x[lineoffset+left] + (slope * i));
-            }
-        }
-        else
-        {
-            slope = ((float) ui8x[lineoffset+left] - 
-                     (float) ui8x[lineoffset+right]) / (float) (diff);
-            for (i = 0; i < diff; i++)
-            {
-                ui8x[lineoffset+i+left] = (uint8)
-                    ((float) ui8x[lineoffset+left] - (slope * i));
-            }
-        }
+        sprintf (errmsg, "Unable to open the input directory: %s", input_dir);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
     }
-    else if (data_type == DFNT_UINT16)
+
+    while ((entry = readdir (dir)) != NULL)
     {
-        ui16x = (uint16 *)data;
-        if (ui16x[lineoffset+right] > ui16x[lineoffset+left])
+        for (i = 0; i < 4; i++)
         {
-            slope = ((float) ui16x[lineoffset+right] - 
-                     (float) ui16x[lineoffset+left]) / (float) (diff);
-            for (i = 0; i < diff; i++)
+            sprintf (pattern, "%s.A%07d.*.hdf", products[i], yearday);
+            if (fnmatch (pattern, entry->d_name, 0) != 0)
+                continue;
+
+            if (*files[i] != NULL)
             {
-                ui16x[lineoffset+i+left] = (uint16)
-                    ((float) ui16x[lineoffset+left] + (slope * i));
+                sprintf (errmsg, "Multiple %s files found for %07d in %s",
+                    products[i], yearday, input_dir);
+                error_handler (true, FUNC_NAME, errmsg);
+                closedir (dir);
+                return (ERROR);
             }
-        }
-        else
-        {
-            slope = ((float) ui16x[lineoffset+left] -
-                     (float) ui16x[lineoffset+right]) / (float)(diff);
-            for (i = 0; i < diff; i++)
+
+            *files[i] = malloc (strlen (input_dir) + strlen (entry->d_name) +
+                2);
+            if (*files[i] == NULL)
             {
-                ui16x[lineoffset+i+left] = (uint16)
-                    ((float) ui16x[lineoffset+left] - (slope * i));
+                sprintf (errmsg, "Allocating memory for the input filename");
+                error_handler (true, FUNC_NAME, errmsg);
+                closedir (dir);
+                return (ERROR);
             }
+            sprintf (*files[i], "%s/%s", input_dir, entry->d_name);
         }
     }
 
-    return;
+    closedir (dir);
+    return (SUCCESS);
 }
 
 
@@ -712,84 +708,22 @@ Date         Programmer       Reason
                               Eric Vermote, NASA GSFC, for use within ESPA
 
 NOTES:
+  1. The tiled auxiliary file has the same name as the HDF file, other than
+     the extension.
 ******************************************************************************/
 void make_outfile_name
 (
     char *yearday_str,      /* I: string containing the year and DOY */
     char *output_dir,       /* I: output directory for the auxiliary prods */
+    bool tiled,             /* I: is this the tiled auxiliary file? */
     char outfile[STR_SIZE]  /* O: output filename for the auxiliary products */
 )
 {
-    sprintf (outfile, "%s/L8ANC%s.hdf_fused", output_dir, yearday_str);
-    return;
-}
-
-
-/******************************************************************************
-MODULE:  copy_param
-
-PURPOSE:  Creates the output filename for the auxiliary products, using the
-  input year-DOY string and the source directory.
-
-RETURN VALUE:
-Type = None
-
-HISTORY:
-Date         Programmer       Reason
----------    ---------------  -------------------------------------
-8/28/2014    Gail Schmidt     Conversion of the original code delivered by
-                              Eric Vermote, NASA GSFC, for use within ESPA
-
-NOTES:
-******************************************************************************/
-void copy_param
-(
-    void *dest,        /* O: destination data array */
-    void *source,      /* I: source data array */
-    int32 data_type,   /* I: data type */
-    int32 offset       /* I: pixel in source/dest data arrays to be copied */
-)
-{
-    int8 *i8dest = NULL;
-    int8 *i8source = NULL;
-    uint8 *ui8dest = NULL;
-    uint8 *ui8source = NULL;
-    int16 *i16dest = NULL;
-    int16 *i16source = NULL;
-    uint16 *ui16dest = NULL;
-    uint16 *ui16source = NULL;
-
-    /* Copy the source pixel to the destination pixel, based on the data
-       type */
-    switch (data_type)
-    {
-        case DFNT_INT8:
-            i8dest = (int8 *)dest;
-            i8source = (int8 *)source;
-            i8dest[offset] = i8source[offset];
-            break;
-
-        case DFNT_UINT8:
-            ui8dest = (uint8 *)dest;
-            ui8source = (uint8 *)source;
-            ui8dest[offset] = ui8source[offset];
-            break;
-
-        case DFNT_INT16:
-            i16dest = (int16 *)dest;
-            i16source = (int16 *)source;
-            i16dest[offset] = i16source[offset];
-            break;
-
-        case DFNT_UINT16:
-            ui16dest = (uint16 *)dest;
-            ui16source = (uint16 *)source;
-            ui16dest[offset] = ui16source[offset];
-
-        default:
-            break;
-    }
-
+    if (tiled)
+        sprintf (outfile, "%s/L8ANC%s%s", output_dir, yearday_str,
+            AUX_TILES_EXTENSION);
+    else
+        sprintf (outfile, "%s/L8ANC%s.hdf_fused", output_dir, yearday_str);
     return;
 }
 
@@ -1399,7 +1333,12 @@ void usage ()
             "--terra_cma=input_terra_cma_filename "
             "--aqua_cma=input_aqua_cma_filename "
             "--output_dir=output_directory "
-            "[--verbose]\n");
+            "[--tiled] [--verbose]\n");
+    printf ("       combine_l8_aux_data "
+            "--input_dir=input_directory "
+            "--days=yyyyddd[-yyyyddd] "
+            "--output_dir=output_directory "
+            "[--tiled] [--verbose]\n");
 
     printf ("\nwhere the following parameters are required:\n");
     printf ("    -terra_cmg: name of the input Terra CMG file to be "
@@ -1420,7 +1359,18 @@ void usage ()
             "same applies to Aqua.  Therefore if only two files are specified, "
             "then they must both either be Aqua or Terra.\n");
 
+    printf ("\nto combine a range of days, the following parameters replace "
+            "the input files:\n");
+    printf ("    -input_dir: name of the directory containing the "
+            "M[OY]D09CM[GA].Ayyyyddd.*.hdf files to be processed\n");
+    printf ("    -days: year/day, or first and last year/day, of the days to "
+            "be combined.  Days without a CMG and CMA file for either Terra "
+            "or Aqua are skipped.\n");
+
     printf ("\nwhere the following parameters are optional:\n");
+    printf ("    -tiled: write the tiled auxiliary file (L8ANCyyyyddd%s) "
+            "instead of the HDF file, so lasrc only needs to read the tiles "
+            "covering each scene (default is false)\n", AUX_TILES_EXTENSION);
     printf ("    -verbose: should intermediate messages be printed? (default "
             "is false)\n");
 
@@ -8,8 +8,11 @@
 #include <libgen.h>
 #include <math.h>
 #include <stdbool.h>
+#include <dirent.h>
+#include <fnmatch.h>
 #include "mfhdf.h"
 #include "error_handler.h"
+#include "aux_tiles.h"
 
 /* Defines and typedefs */
 enum {UNSET, TERRA, AQUA, BOTH};
@@ -23,6 +26,21 @@ enum {UNSET, TERRA, AQUA, BOTH};
 #define IFILL -1
 #define SRC_DIRECTORY  "./"
 
+/* Program will look for these SDSs in the CMG/CMA inputs */
+#define N_SDS 2
+#define OZONE 0
+#define WV 1
+
+/* Lines of the CMG which are interpolated, excluding the poles */
+#define CMG_NLINES 3600
+#define INTERP_FIRST_LINE 1000
+#define INTERP_END_LINE 2600
+
+/* Number of lines read, combined, interpolated, and written at a time.  This
+   is the tile size, so each block is a row of tiles in the tiled auxiliary
+   file. */
+#define BLOCK_NLINES AUX_TILE_SIZE
+
 typedef struct{
    int32 sd_id;
    int32 sds_id;
@@ -32,6 +50,48 @@ typedef struct{
    char sdsname[100];
 } io_param;
 
+/* Structure for a block of lines.  The Terra arrays hold the combined output
+   once the block has been combined. */
+typedef struct {
+    int first_line;          /* first line of the block in the grid */
+    int nlines;              /* number of lines in the block; 0 if not read */
+    void *terra[N_SDS];      /* Terra values for each SDS */
+    void *aqua[N_SDS];       /* Aqua values for each SDS */
+    int8 *wherefrom;         /* where each combined pixel came from */
+} Block_t;
+
+/* Structure for a run of fill pixels to be interpolated, using grid pixel
+   locations (line * nsamps + samp) */
+typedef struct {
+    long left;               /* location of the non-fill pixel on the left */
+    long right;              /* location of the non-fill pixel on the right */
+    uint8 left_oz;           /* ozone value of the left pixel */
+    uint8 right_oz;          /* ozone value of the right pixel */
+    uint16 left_wv;          /* water vapor value of the left pixel */
+    uint16 right_wv;         /* water vapor value of the right pixel */
+} Interp_run_t;
+
+/* Structure for the block buffers and the state carried from one block to
+   the next.  The buffers are allocated once and reused for each day. */
+typedef struct {
+    int nsamps;              /* number of samples the buffers hold */
+    int32 data_type[N_SDS];  /* data type of each SDS the buffers hold */
+    Block_t block[2];        /* block being combined and the next block */
+    void *line_terra[N_SDS]; /* single Terra line past the next block */
+    void *line_aqua[N_SDS];  /* single Aqua line past the next block */
+    int line;                /* line held in the single line buffers */
+    int *chain;              /* first line of each chain of lines in the
+                                block which are interpolated together */
+    int nchains;             /* number of chains in the block */
+    uint8 last_oz;           /* combined ozone of the last pixel before the
+                                block */
+    uint16 last_wv;          /* combined water vapor of the last pixel before
+                                the block */
+    Interp_run_t *pending;   /* runs continuing past the end of the block */
+    int npending;            /* number of pending runs */
+    int max_pending;         /* number of pending runs allocated */
+} Block_buf_t;
+
 
 /* Prototypes */
 int get_args
@@ -42,10 +102,65 @@ int get_args
     char **aqua_cmg_file,   /* O: address of input Aqua CMG file */
     char **terra_cma_file,  /* O: address of input Terra CMA file */
     char **aqua_cma_file,   /* O: address of input Aqua CMA file */
+    char **input_dir,       /* O: address of input directory for --days */
     char **output_dir,      /* O: address of output directory */
+    int *first_day,         /* O: first year/day (yyyyddd) to combine; 0 if
+                                  the input files were specified */
+    int *last_day,          /* O: last year/day (yyyyddd) to combine */
+    bool *tiled,            /* O: write the tiled auxiliary file? */
     bool *verbose           /* O: verbose flag */
 );
 
+int combine_day
+(
+    int argc,               /* I: number of cmd-line args */
+    char *argv[],           /* I: string of cmd-line args */
+    char *terra_cmg_file,   /* I: input Terra CMG file (NULL if none) */
+    char *aqua_cmg_file,    /* I: input Aqua CMG file (NULL if none) */
+    char *terra_cma_file,   /* I: input Terra CMA file (NULL if none) */
+    char *aqua_cma_file,    /* I: input Aqua CMA file (NULL if none) */
+    char *output_dir,       /* I: output directory for the auxiliary file */
+    bool tiled,             /* I: write the tiled auxiliary file? */
+    bool verbose,           /* I: verbose flag */
+    Block_buf_t *buf        /* I/O: block buffers, reused for each day */
+);
+
+int find_day_files
+(
+    char *input_dir,        /* I: directory containing the CMG/CMA files */
+    int yearday,            /* I: year/day (yyyyddd) to be combined */
+    char **terra_cmg_file,  /* O: address of Terra CMG file (NULL if none) */
+    char **aqua_cmg_file,   /* O: address of Aqua CMG file (NULL if none) */
+    char **terra_cma_file,  /* O: address of Terra CMA file (NULL if none) */
+    char **aqua_cma_file    /* O: address of Aqua CMA file (NULL if none) */
+);
+
+int alloc_block_buf
+(
+    Block_buf_t *buf,       /* I/O: block buffers */
+    int nsamps,             /* I: number of samples in each line */
+    int32 data_type[N_SDS]  /* I: data type of each SDS */
+);
+
+void free_block_buf
+(
+    Block_buf_t *buf        /* I/O: block buffers to be freed */
+);
+
+int combine_blocks
+(
+    io_param terra_params[], /* I: Terra SDS parameters */
+    io_param aqua_params[],  /* I: Aqua SDS parameters */
+    bool terra_input,       /* I: is Terra CMA/CMG available? */
+    bool aqua_input,        /* I: is Aqua CMA/CMG available? */
+    int32 dims[2],          /* I: number of lines and samples in the grid */
+    int32 sds_id[],         /* I: output SDS IDs, N_SDS followed by the
+                                  wherefrom SDS; not used if tiles is set */
+    Aux_tiles_writer_t *tiles, /* I/O: tiled auxiliary file to be written, or
+                                  NULL to write the HDF SDSs */
+    Block_buf_t *buf        /* I/O: block buffers */
+);
+
 void usage();
 
 int parse_sds_info
@@ -84,6 +199,7 @@ void make_outfile_name
 (
     char *yearday_str,      /* I: string containing the year and DOY */
     char *output_dir,       /* I: output directory for the auxiliary prods */
+    bool tiled,             /* I: is this the tiled auxiliary file? */
     char outfile[STR_SIZE]  /* O: output filename for the auxiliary products */
 );
 
@@ -98,10 +214,15 @@ void copy_param
 void interpolate
 (
     int32 data_type,     /* I: data type of the data array */
-    void *data,          /* I: data array */
-    long lineoffset,     /* I: pixel location for the start of this line */
-    int left,            /* I: location in the line of the left pixel */
-    int right            /* I: location in the line of the right pixel */
+    void *data,          /* I/O: data array */
+    long first_pix,      /* I: grid pixel location of the first pixel in the
+                               data array */
+    long end_pix,        /* I: grid pixel location after the last pixel in the
+                               data array */
+    long left,           /* I: grid pixel location of the left pixel */
+    long right,          /* I: grid pixel location of the right pixel */
+    int left_val,        /* I: value of the left pixel */
+    int right_val        /* I: value of the right pixel */
 );
 
 #endif
@@ -29,6 +29,8 @@ NOTES:
   1. Memory is allocated for the input files.  This should be character a
      pointer set to NULL on input.  The caller is responsible for freeing the
      allocated memory upon successful return.
+  2. --days and --input_dir replace the input files, which are then found in
+     the input directory for each day in the range.
 ******************************************************************************/
 int get_args
 (
@@ -38,22 +40,32 @@ int get_args
     char **aqua_cmg_file,   /* O: address of input Aqua CMG file */
     char **terra_cma_file,  /* O: address of input Terra CMA file */
     char **aqua_cma_file,   /* O: address of input Aqua CMA file */
+    char **input_dir,       /* O: address of input directory for --days */
     char **output_dir,      /* O: address of output directory */
+    int *first_day,         /* O: first year/day (yyyyddd) to combine; 0 if
+                                  the input files were specified */
+    int *last_day,          /* O: last year/day (yyyyddd) to combine */
+    bool *tiled,            /* O: write the tiled auxiliary file? */
     bool *verbose           /* O: verbose flag */
 )
 {
     int c;                           /* current argument index */
     int option_index;                /* index for the command-line option */
+    int nread;                       /* number of characters parsed */
     static int verbose_flag=0;       /* verbose flag */
+    static int tiled_flag=0;         /* tiled output flag */
     char errmsg[STR_SIZE];           /* error message */
     char FUNC_NAME[] = "get_args";   /* function name */
     static struct option long_options[] =
     {
         {"verbose", no_argument, &verbose_flag, 1},
+        {"tiled", no_argument, &tiled_flag, 1},
         {"terra_cmg", required_argument, 0, 'a'},
         {"aqua_cmg", required_argument, 0, 'b'},
         {"terra_cma", required_argument, 0, 'c'},
         {"aqua_cma", required_argument, 0, 'd'},
+        {"input_dir", required_argument, 0, 'i'},
+        {"days", required_argument, 0, 'y'},
         {"output_dir", required_argument, 0, 'o'},
         {"help", no_argument, 0, 'h'},
         {0, 0, 0, 0}
@@ -61,6 +73,9 @@ int get_args
 
     /* Initialize the flags to false */
     *verbose = false;
+    *tiled = false;
+    *first_day = 0;
+    *last_day = 0;
 
     /* Loop through all the cmd-line options */
     opterr = 0;   /* turn off getopt_long error msgs as we'll print our own */
@@ -102,6 +117,33 @@ int get_args
                 *aqua_cma_file = strdup (optarg);
                 break;
      
+            case 'i':  /* Input directory */
+                *input_dir = strdup (optarg);
+                break;
+     
+            case 'y':  /* Range of days, yyyyddd[-yyyyddd] */
+                nread = 0;
+                if (sscanf (optarg, "%7d%n", first_day, &nread) != 1 ||
+                    nread != 7)
+                    nread = -1;
+                else if (optarg[nread] == '\0')
+                    *last_day = *first_day;
+                else if (sscanf (&optarg[nread], "-%7d", last_day) != 1 ||
+                    strlen (optarg) != 15)
+                    nread = -1;
+
+                if (nread == -1 || *first_day % 1000 < 1 ||
+                    *first_day % 1000 > 366 || *last_day % 1000 < 1 ||
+                    *last_day % 1000 > 366 || *last_day < *first_day)
+                {
+                    sprintf (errmsg, "Invalid range of days %s.  Expected "
+                        "yyyyddd or yyyyddd-yyyyddd.", optarg);
+                    error_handler (true, FUNC_NAME, errmsg);
+                    usage ();
+                    return (ERROR);
+                }
+                break;
+     
             case 'o':  /* Output directory */
                 *output_dir = strdup (optarg);
                 break;
@@ -116,8 +158,40 @@ int get_args
         }
     }
 
-    /* Make sure the Terra/Aqua CMG/CMA files were specified */
-    if (*terra_cmg_file == NULL && *aqua_cmg_file == NULL)
+    /* With a range of days, the input files are found in the input
+       directory for each day */
+    if (*first_day != 0)
+    {
+        if (*input_dir == NULL)
+        {
+            sprintf (errmsg, "Input directory is a required argument when "
+                "a range of days is specified");
+            error_handler (true, FUNC_NAME, errmsg);
+            usage ();
+            return (ERROR);
+        }
+
+        if (*terra_cmg_file != NULL || *aqua_cmg_file != NULL ||
+            *terra_cma_file != NULL || *aqua_cma_file != NULL)
+        {
+            sprintf (errmsg, "Input CMG/CMA files can't be specified with a "
+                "range of days");
+            error_handler (true, FUNC_NAME, errmsg);
+            usage ();
+            return (ERROR);
+        }
+    }
+    else if (*input_dir != NULL)
+    {
+        sprintf (errmsg, "Input directory is only used with a range of days");
+        error_handler (true, FUNC_NAME, errmsg);
+        usage ();
+        return (ERROR);
+    }
+
+    /* Make sure the Terra/Aqua CMG/CMA files were specified, unless they are
+       found in the input directory for each day */
+    if (*first_day == 0 && *terra_cmg_file == NULL && *aqua_cmg_file == NULL)
     {
         sprintf (errmsg, "Input Terra CMG or Aqua CMG file is a required "
             "argument. At least one must be valid.");
@@ -126,7 +200,7 @@ int get_args
         return (ERROR);
     }
 
-    if (*terra_cma_file == NULL && *aqua_cma_file == NULL)
+    if (*first_day == 0 && *terra_cma_file == NULL && *aqua_cma_file == NULL)
     {
         sprintf (errmsg, "Input Terra CMA or Aqua CMA file is a required "
             "argument. At least one must be valid.");
@@ -169,6 +243,8 @@ int get_args
     /* Check the flags */
     if (verbose_flag)
         *verbose = true;
+    if (tiled_flag)
+        *tiled = true;
 
     return (SUCCESS);
 }
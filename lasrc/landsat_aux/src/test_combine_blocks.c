@@ -0,0 +1,618 @@
+/*****************************************************************************
+FILE: test_combine_blocks.c
+
+PURPOSE: Checks combine_blocks, which combines and interpolates the ozone and
+water vapor a block of lines at a time, against the original full-grid
+combine and interpolation loop.  Built and run by 'make check'.
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+LICENSE TYPE:  NASA Open Source Agreement Version 1.3
+
+NOTES:
+  1. The HDF reads and writes are replaced by synthetic grids held in memory,
+     so the test doesn't need any input files.  SDreaddata, SDwritedata, and
+     DFKNTsize are defined here for the grids.
+  2. The reference is the loop combine_l8_aux_data used before the grids
+     were split into blocks: the full grids are combined, then each line
+     between INTERP_FIRST_LINE and INTERP_END_LINE is scanned for runs of
+     fill pixels, which are interpolated between the non-fill pixels on
+     either side, continuing onto the following lines.  The only change is
+     that a run reaching the end of the grid stops there and isn't
+     interpolated, rather than reading past the end of the arrays.
+  3. The synthetic grids have random runs of fill, including runs longer
+     than a line, whole lines of fill spanning more than one block, runs
+     starting at the first interpolated line whose left pixel is fill, runs
+     crossing INTERP_END_LINE, and the rest of the grid fill.  Each grid is
+     combined with Terra and Aqua, Terra only, and Aqua only, and with one and
+     several threads when built with OpenMP.
+  4. The ozone, water vapor, and wherefrom written to the HDF SDSs must match
+     the reference exactly.  The grids are also written as a tiled auxiliary
+     file, which is read back and must match the reference exactly.
+*****************************************************************************/
+#include <unistd.h>
+#ifdef _OPENMP
+    #include <omp.h>
+#endif
+#include "combine_l8_aux_data.h"
+
+/* SDS IDs for the synthetic grids: Terra, Aqua, and output */
+#define TERRA_SDS_ID 0
+#define AQUA_SDS_ID 10
+#define OUT_SDS_ID 100
+
+/* Number of samples in the synthetic grids, and a number of lines which
+   isn't a CMG so it isn't interpolated */
+static int test_nsamps[] = {37, 200, 413};
+#define TEST_NNSAMPS ((int) (sizeof (test_nsamps) / sizeof (test_nsamps[0])))
+#define TEST_NON_CMG_NLINES 1234
+
+/* Numbers of threads checked when built with OpenMP */
+static int test_nthreads[] = {1, 4};
+#define TEST_NNTHREADS \
+    ((int) (sizeof (test_nthreads) / sizeof (test_nthreads[0])))
+
+/* Synthetic grids: Terra and Aqua ozone and water vapor, and the output
+   written by combine_blocks */
+static int grid_nlines, grid_nsamps;
+static void *grid[2][N_SDS];          /* Terra and Aqua grids for each SDS */
+static void *out[N_SDS + 1];          /* output grids, N_SDS and wherefrom */
+static int32 grid_data_type[N_SDS] = {DFNT_UINT8, DFNT_UINT16};
+
+/* Random numbers from a fixed generator, so the grids are the same on every
+   run */
+static unsigned long seed = 5;
+
+static int next_random (int n)
+{
+    seed = seed * 1103515245UL + 12345UL;
+    return ((int) ((seed >> 16) & 0x7fff) % n);
+}
+
+
+/******************************************************************************
+MODULE:  SDreaddata, SDwritedata, DFKNTsize
+
+PURPOSE:  Replace the HDF routines used by combine_blocks, reading from and
+writing to the synthetic grids.
+
+NOTES:
+  1. Only whole lines are read and written, as by combine_blocks.
+******************************************************************************/
+intn SDreaddata (int32 sds_id, int32 *start, int32 *stride, int32 *edge,
+    void *data)
+{
+    int src = sds_id >= AQUA_SDS_ID;      /* Terra or Aqua */
+    int i = sds_id % AQUA_SDS_ID;         /* SDS */
+    size_t nbytes = DFKNTsize (grid_data_type[i]);
+
+    if (start[1] != 0 || edge[1] != grid_nsamps ||
+        start[0] + edge[0] > grid_nlines)
+        return (-1);
+    memcpy (data, (char *) grid[src][i] + (size_t) start[0] * grid_nsamps *
+        nbytes, (size_t) edge[0] * grid_nsamps * nbytes);
+    return (0);
+}
+
+intn SDwritedata (int32 sds_id, int32 *start, int32 *stride, int32 *edge,
+    void *data)
+{
+    int i = sds_id - OUT_SDS_ID;          /* SDS, or N_SDS for wherefrom */
+    size_t nbytes = i < N_SDS ? DFKNTsize (grid_data_type[i]) :
+        sizeof (int8);
+
+    if (start[1] != 0 || edge[1] != grid_nsamps ||
+        start[0] + edge[0] > grid_nlines)
+        return (-1);
+    memcpy ((char *) out[i] + (size_t) start[0] * grid_nsamps * nbytes, data,
+        (size_t) edge[0] * grid_nsamps * nbytes);
+    return (0);
+}
+
+int32 DFKNTsize (int32 number_type)
+{
+    return (number_type == DFNT_UINT16 || number_type == DFNT_INT16 ? 2 : 1);
+}
+
+
+/******************************************************************************
+MODULE:  make_grid
+
+PURPOSE:  Fills one synthetic ozone and water vapor grid with random values
+and random runs of fill, plus the fill patterns of the interpolation edge
+cases.
+
+RETURN VALUE:
+Type = None
+******************************************************************************/
+static void make_grid
+(
+    uint8 *oz,            /* O: ozone grid */
+    uint16 *wv,           /* O: water vapor grid */
+    int nlines,           /* I: number of lines */
+    int nsamps            /* I: number of samples */
+)
+{
+    long pix;             /* current pixel */
+    long npix = (long) nlines * nsamps;   /* number of pixels */
+    long len = 0;         /* pixels left in the current run */
+    bool fill = false;    /* is the current run fill? */
+    int r;                /* random number picking the next run */
+
+    for (pix = 0; pix < npix; pix++)
+    {
+        if (len == 0)
+        {
+            r = next_random (100);
+            fill = r >= 55;
+            if (r < 55)
+                len = 1 + next_random (50);
+            else if (r < 95)
+                len = 1 + next_random (20);
+            else
+                len = 1 + next_random (3 * nsamps);
+        }
+        len--;
+        oz[pix] = fill ? LAADS_FILL : 1 + next_random (255);
+        wv[pix] = next_random (0x7fff) * 2 + next_random (2);
+    }
+
+    if (nlines != CMG_NLINES)
+        return;
+
+    /* Whole lines of fill spanning more than one block */
+    memset (&oz[(long) 1700 * nsamps], LAADS_FILL, (long) 460 * nsamps);
+
+    /* Run starting at the first interpolated line, whose left pixel is fill,
+       and spanning more than one block.  Most of the interpolated values are
+       still fill, so they are interpolated again on the following lines. */
+    memset (&oz[(long) INTERP_FIRST_LINE * nsamps - 3], LAADS_FILL,
+        (long) 450 * nsamps);
+    oz[(long) (INTERP_FIRST_LINE + 450) * nsamps - 3] = 2;
+
+    /* Run starting at the first pixel of a block */
+    oz[(long) 2400 * nsamps - 1] = 1;
+    memset (&oz[(long) 2400 * nsamps], LAADS_FILL, nsamps + 7);
+
+    /* Run crossing the end of the interpolated lines */
+    memset (&oz[(long) INTERP_END_LINE * nsamps - nsamps / 2], LAADS_FILL,
+        (long) 2 * nsamps);
+}
+
+
+/******************************************************************************
+MODULE:  ref_interpolate
+
+PURPOSE:  Interpolates the fill pixels between the left and right pixels, as
+done before the grids were split into blocks.
+
+RETURN VALUE:
+Type = None
+******************************************************************************/
+static void ref_interpolate
+(
+    int32 data_type,      /* I: data type of the data array */
+    void *data,           /* I/O: data array */
+    long lineoffset,      /* I: pixel location for the start of this line */
+    long left,            /* I: location in the line of the left pixel */
+    long right            /* I: location in the line of the right pixel */
+)
+{
+    uint8 *ui8x = NULL;   /* uint8 pointer */
+    uint16 *ui16x = NULL; /* uint16 pointer */
+    long i;               /* looping variable */
+    long diff;            /* distance between the left and right pixels */
+    float slope;          /* slope for this pixel */
+
+    diff = right - left;
+    if (data_type == DFNT_UINT8)
+    {
+        ui8x = (uint8 *)data;
+        if (ui8x[lineoffset+right] > ui8x[lineoffset+left])
+        {
+            slope = ((float) ui8x[lineoffset+right] -
+                     (float) ui8x[lineoffset+left]) / (float) (diff);
+            for (i = 0; i < diff; i++)
+                ui8x[lineoffset+i+left] = (uint8)
+                    ((float) ui8x[lineoffset+left] + (slope * i));
+        }
+        else
+        {
+            slope = ((float) ui8x[lineoffset+left] -
+                     (float) ui8x[lineoffset+right]) / (float) (diff);
+            for (i = 0; i < diff; i++)
+                ui8x[lineoffset+i+left] = (uint8)
+                    ((float) ui8x[lineoffset+left] - (slope * i));
+        }
+    }
+    else
+    {
+        ui16x = (uint16 *)data;
+        if (ui16x[lineoffset+right] > ui16x[lineoffset+left])
+        {
+            slope = ((float) ui16x[lineoffset+right] -
+                     (float) ui16x[lineoffset+left]) / (float) (diff);
+            for (i = 0; i < diff; i++)
+                ui16x[lineoffset+i+left] = (uint16)
+                    ((float) ui16x[lineoffset+left] + (slope * i));
+        }
+        else
+        {
+            slope = ((float) ui16x[lineoffset+left] -
+                     (float) ui16x[lineoffset+right]) / (float) (diff);
+            for (i = 0; i < diff; i++)
+                ui16x[lineoffset+i+left] = (uint16)
+                    ((float) ui16x[lineoffset+left] - (slope * i));
+        }
+    }
+}
+
+
+/******************************************************************************
+MODULE:  ref_combine
+
+PURPOSE:  Combines and interpolates the full synthetic grids, as done before
+the grids were split into blocks.
+
+RETURN VALUE:
+Type = None
+******************************************************************************/
+static void ref_combine
+(
+    bool terra_input,     /* I: is Terra available? */
+    bool aqua_input,      /* I: is Aqua available? */
+    uint8 *oz,            /* O: combined ozone */
+    uint16 *wv,           /* O: combined water vapor */
+    int8 *wherefrom       /* O: where each pixel came from */
+)
+{
+    long npix = (long) grid_nlines * grid_nsamps;   /* number of pixels */
+    long i;               /* looping variable for the pixels */
+    long pix;             /* pixel at the start of the line */
+    long samp, left, right;   /* locations in the line */
+    int line;             /* looping variable for the lines */
+    uint8 *aoz = grid[1][OZONE];   /* Aqua ozone */
+    uint16 *awv = grid[1][WV];     /* Aqua water vapor */
+
+    if (terra_input)
+    {
+        memcpy (oz, grid[0][OZONE], npix * sizeof (uint8));
+        memcpy (wv, grid[0][WV], npix * sizeof (uint16));
+    }
+    else
+    {
+        memset (oz, 0, npix * sizeof (uint8));
+        memset (wv, 0, npix * sizeof (uint16));
+    }
+
+    for (i = 0; i < npix; i++)
+    {
+        wherefrom[i] = UNSET;
+        if (terra_input && oz[i] != LAADS_FILL)
+            wherefrom[i] = TERRA;
+        else if (aqua_input && oz[i] == LAADS_FILL && aoz[i] != LAADS_FILL)
+        {
+            oz[i] = aoz[i];
+            wv[i] = awv[i];
+            wherefrom[i] = AQUA;
+        }
+    }
+
+    if (grid_nlines != CMG_NLINES)
+        return;
+    for (line = INTERP_FIRST_LINE; line < INTERP_END_LINE; line++)
+    {
+        pix = (long) line * grid_nsamps;
+        for (samp = 0; samp < grid_nsamps; samp++)
+        {
+            if (oz[pix+samp] != 0)
+                continue;
+
+            left = right = samp;
+            while (pix + right < npix && oz[pix+right] == 0) right++;
+            samp = right;
+            left--;
+
+            /* The rest of the grid is fill */
+            if (pix + right >= npix)
+                break;
+
+            ref_interpolate (DFNT_UINT8, oz, pix, left, right);
+            ref_interpolate (DFNT_UINT16, wv, pix, left, right);
+        }
+    }
+}
+
+
+/******************************************************************************
+MODULE:  read_tiles
+
+PURPOSE:  Reads back the tiled auxiliary file and checks its header.
+
+RETURN VALUE:
+Type = int
+Value          Description
+-----          -----------
+ERROR          Error reading the file, or the header is wrong
+SUCCESS        Successful completion
+******************************************************************************/
+static int read_tiles
+(
+    char *filename,       /* I: tiled auxiliary file */
+    uint8 *oz,            /* O: ozone grid */
+    uint16 *wv            /* O: water vapor grid */
+)
+{
+    FILE *fp = NULL;      /* tiled auxiliary file */
+    Aux_tiles_header_t hdr;   /* file header */
+    Aux_tiles_index_t *index = NULL;  /* tile index */
+    unsigned char *ctile = NULL;  /* compressed tile */
+    unsigned char *tile = NULL;   /* uncompressed tile */
+    unsigned char *cell = NULL;   /* current cell in the tile */
+    uLongf usize;         /* uncompressed size of the tile */
+    int ntiles;           /* number of tiles */
+    int tline, tsamp;     /* looping variables for the tiles */
+    int line, samp;       /* looping variables in the tile */
+    int itile;            /* current tile */
+    long pix;             /* current pixel in the grid */
+    int status = ERROR;   /* return status */
+
+    fp = fopen (filename, "rb");
+    if (fp == NULL || fread (&hdr, sizeof (hdr), 1, fp) != 1)
+        goto done;
+    if (memcmp (hdr.magic, AUX_TILES_MAGIC, AUX_TILES_MAGIC_LEN) ||
+        hdr.nlines != grid_nlines || hdr.nsamps != grid_nsamps ||
+        hdr.tile_size != AUX_TILE_SIZE || hdr.cell_size != AUX_CELL_SIZE)
+        goto done;
+
+    ntiles = hdr.ntile_lines * hdr.ntile_samps;
+    index = malloc (ntiles * sizeof (Aux_tiles_index_t));
+    ctile = malloc (compressBound (AUX_TILE_SIZE * AUX_TILE_SIZE *
+        AUX_CELL_SIZE));
+    tile = malloc (AUX_TILE_SIZE * AUX_TILE_SIZE * AUX_CELL_SIZE);
+    if (index == NULL || ctile == NULL || tile == NULL ||
+        fread (index, sizeof (Aux_tiles_index_t), ntiles, fp) != ntiles)
+        goto done;
+
+    for (tline = 0; tline < hdr.ntile_lines; tline++)
+    {
+        for (tsamp = 0; tsamp < hdr.ntile_samps; tsamp++)
+        {
+            itile = tline * hdr.ntile_samps + tsamp;
+            usize = AUX_TILE_SIZE * AUX_TILE_SIZE * AUX_CELL_SIZE;
+            if (fseek (fp, index[itile].offset, SEEK_SET) != 0 ||
+                fread (ctile, 1, index[itile].csize, fp) !=
+                index[itile].csize ||
+                uncompress (tile, &usize, ctile, index[itile].csize) !=
+                Z_OK || usize != index[itile].usize)
+                goto done;
+
+            cell = tile;
+            for (line = tline * AUX_TILE_SIZE;
+                 line < (tline + 1) * AUX_TILE_SIZE && line < grid_nlines;
+                 line++)
+            {
+                for (samp = tsamp * AUX_TILE_SIZE;
+                     samp < (tsamp + 1) * AUX_TILE_SIZE &&
+                     samp < grid_nsamps; samp++)
+                {
+                    pix = (long) line * grid_nsamps + samp;
+                    memcpy (&wv[pix], cell, sizeof (uint16));
+                    oz[pix] = cell[sizeof (uint16)];
+                    cell += AUX_CELL_SIZE;
+                }
+            }
+            if (cell - tile != usize)
+                goto done;
+        }
+    }
+    status = SUCCESS;
+
+done:
+    if (fp != NULL)
+        fclose (fp);
+    free (index);
+    free (ctile);
+    free (tile);
+    return (status);
+}
+
+
+/******************************************************************************
+MODULE:  count_diffs
+
+PURPOSE:  Counts the pixels which differ from the reference, printing the
+first few.
+
+RETURN VALUE:
+Type = long
+Value          Description
+-----          -----------
+n              Number of pixels which differ
+******************************************************************************/
+static long count_diffs
+(
+    char *name,           /* I: name of the case */
+    uint8 *oz,            /* I: ozone to check */
+    uint16 *wv,           /* I: water vapor to check */
+    int8 *wherefrom,      /* I: wherefrom to check, or NULL */
+    uint8 *ref_oz,        /* I: reference ozone */
+    uint16 *ref_wv,       /* I: reference water vapor */
+    int8 *ref_wherefrom   /* I: reference wherefrom */
+)
+{
+    long npix = (long) grid_nlines * grid_nsamps;   /* number of pixels */
+    long pix;             /* looping variable for the pixels */
+    long ndiff = 0;       /* number of pixels which differ */
+
+    for (pix = 0; pix < npix; pix++)
+    {
+        if (oz[pix] != ref_oz[pix] || wv[pix] != ref_wv[pix] ||
+            (wherefrom != NULL && wherefrom[pix] != ref_wherefrom[pix]))
+        {
+            if (ndiff < 3)
+                printf ("test_combine_blocks: %s line %ld sample %ld: oz %d "
+                    "wv %d, reference oz %d wv %d\n", name, pix / grid_nsamps,
+                    pix % grid_nsamps, oz[pix], wv[pix], ref_oz[pix],
+                    ref_wv[pix]);
+            ndiff++;
+        }
+    }
+    return (ndiff);
+}
+
+
+int main (void)
+{
+    char tilefile[MAXLENGTH];  /* tiled auxiliary file written */
+    char tmpname[STR_SIZE];   /* temporary name of the tiled file */
+    char name[STR_SIZE];      /* name of the current case */
+    int ins, inl, it;         /* looping variables for the cases */
+    int inputs;               /* Terra and Aqua, Terra only, Aqua only */
+    int i, src;               /* looping variables for the grids */
+    int ncases = 0;           /* number of cases checked */
+    int nbad = 0;             /* number of cases which differ */
+    long npix;                /* number of pixels in the grid */
+    bool terra_input, aqua_input;  /* are Terra and Aqua available? */
+    int32 dims[2];            /* grid dimensions */
+    int32 sds_id[N_SDS + 1];  /* output SDS IDs */
+    io_param terra_params[N_SDS];  /* Terra SDS parameters */
+    io_param aqua_params[N_SDS];   /* Aqua SDS parameters */
+    uint8 *ref_oz = NULL, *tile_oz = NULL;    /* reference and tiled ozone */
+    uint16 *ref_wv = NULL, *tile_wv = NULL;   /* reference and tiled wv */
+    int8 *ref_wherefrom = NULL;   /* reference wherefrom */
+    Block_buf_t buf;          /* block buffers */
+    Aux_tiles_writer_t *tiles = NULL;  /* tiled auxiliary file */
+
+    memset (&buf, 0, sizeof (buf));
+    memset (terra_params, 0, sizeof (terra_params));
+    memset (aqua_params, 0, sizeof (aqua_params));
+    for (i = 0; i < N_SDS; i++)
+    {
+        terra_params[i].sds_id = TERRA_SDS_ID + i;
+        terra_params[i].data_type = grid_data_type[i];
+        aqua_params[i].sds_id = AQUA_SDS_ID + i;
+        aqua_params[i].data_type = grid_data_type[i];
+        sds_id[i] = OUT_SDS_ID + i;
+    }
+    sds_id[N_SDS] = OUT_SDS_ID + N_SDS;
+    snprintf (tilefile, sizeof (tilefile), "test_combine_blocks.%d%s",
+        (int) getpid (), AUX_TILES_EXTENSION);
+    snprintf (tmpname, sizeof (tmpname), "%s.tmp", tilefile);
+
+    for (ins = 0; ins < TEST_NNSAMPS; ins++)
+    {
+        for (inl = 0; inl < 2; inl++)
+        {
+            grid_nlines = inl == 0 ? CMG_NLINES : TEST_NON_CMG_NLINES;
+            grid_nsamps = test_nsamps[ins];
+            npix = (long) grid_nlines * grid_nsamps;
+            for (src = 0; src < 2; src++)
+            {
+                for (i = 0; i < N_SDS; i++)
+                    grid[src][i] = malloc (npix * DFKNTsize
+                        (grid_data_type[i]));
+                make_grid (grid[src][OZONE], grid[src][WV], grid_nlines,
+                    grid_nsamps);
+            }
+            for (i = 0; i < N_SDS; i++)
+                out[i] = malloc (npix * DFKNTsize (grid_data_type[i]));
+            out[N_SDS] = malloc (npix * sizeof (int8));
+            ref_oz = malloc (npix * sizeof (uint8));
+            ref_wv = malloc (npix * sizeof (uint16));
+            ref_wherefrom = malloc (npix * sizeof (int8));
+            tile_oz = malloc (npix * sizeof (uint8));
+            tile_wv = malloc (npix * sizeof (uint16));
+            if (grid[0][WV] == NULL || grid[1][WV] == NULL ||
+                out[N_SDS] == NULL || ref_wherefrom == NULL ||
+                tile_wv == NULL)
+            {
+                printf ("test_combine_blocks: allocating the grids\n");
+                return (EXIT_FAILURE);
+            }
+            dims[0] = grid_nlines;
+            dims[1] = grid_nsamps;
+            if (alloc_block_buf (&buf, grid_nsamps, grid_data_type) !=
+                SUCCESS)
+                return (EXIT_FAILURE);
+
+            for (inputs = 0; inputs < 3; inputs++)
+            {
+                terra_input = inputs != 2;
+                aqua_input = inputs != 1;
+                ref_combine (terra_input, aqua_input, ref_oz, ref_wv,
+                    ref_wherefrom);
+
+                for (it = 0; it < TEST_NNTHREADS; it++)
+                {
+#ifdef _OPENMP
+                    omp_set_num_threads (test_nthreads[it]);
+#else
+                    if (it > 0)
+                        break;
+#endif
+                    snprintf (name, sizeof (name), "%d x %d, %s, %d "
+                        "threads", grid_nlines, grid_nsamps, inputs == 0 ?
+                        "Terra and Aqua" : inputs == 1 ? "Terra only" :
+                        "Aqua only", test_nthreads[it]);
+
+                    /* HDF SDS output */
+                    ncases++;
+                    if (combine_blocks (terra_params, aqua_params,
+                        terra_input, aqua_input, dims, sds_id, NULL, &buf) !=
+                        SUCCESS || count_diffs (name, out[OZONE], out[WV],
+                        out[N_SDS], ref_oz, ref_wv, ref_wherefrom) > 0)
+                    {
+                        printf ("test_combine_blocks: %s: HDF output "
+                            "differs\n", name);
+                        nbad++;
+                    }
+
+                    /* Tiled output */
+                    ncases++;
+                    tiles = open_aux_tiles_writer (tilefile, grid_nlines,
+                        grid_nsamps);
+                    if (tiles == NULL || combine_blocks (terra_params,
+                        aqua_params, terra_input, aqua_input, dims, sds_id,
+                        tiles, &buf) != SUCCESS ||
+                        close_aux_tiles_writer (tiles, true) != SUCCESS ||
+                        read_tiles (tilefile, tile_oz, tile_wv) != SUCCESS ||
+                        count_diffs (name, tile_oz, tile_wv, NULL, ref_oz,
+                        ref_wv, ref_wherefrom) > 0)
+                    {
+                        printf ("test_combine_blocks: %s: tiled output "
+                            "differs\n", name);
+                        nbad++;
+                    }
+                    unlink (tilefile);
+                    unlink (tmpname);
+                }
+            }
+
+            for (src = 0; src < 2; src++)
+            {
+                for (i = 0; i < N_SDS; i++)
+                    free (grid[src][i]);
+            }
+            for (i = 0; i <= N_SDS; i++)
+                free (out[i]);
+            free (ref_oz);
+            free (ref_wv);
+            free (ref_wherefrom);
+            free (tile_oz);
+            free (tile_wv);
+        }
+    }
+    free_block_buf (&buf);
+
+    printf ("test_combine_blocks: %d cases: %d differ from the full-grid "
+        "combine and interpolation\n", ncases, nbad);
+    if (nbad > 0)
+    {
+        printf ("test_combine_blocks: FAILED\n");
+        return (EXIT_FAILURE);
+    }
+    printf ("test_combine_blocks: passed\n");
+    return (EXIT_SUCCESS);
+}
@@ -0,0 +1,356 @@
+/******************************************************************************
+FILE: write_aux_tiles.c
+
+PURPOSE: Contains functions for writing the combined ozone and water vapor as
+the tiled auxiliary file.  The grid is split into fixed geographic tiles which
+are compressed independently with zlib, and a tile index is stored at the
+front of the file, so lasrc can read only the tiles covering a scene.
+
+PROJECT:  Land Satellites Data System Science Research and Development (LSRD)
+at the USGS EROS
+
+LICENSE TYPE:  NASA Open Source Agreement Version 1.3
+
+NOTES:
+  1. See aux_tiles.h for the layout of the file.
+  2. Large parts of the daily grids are ocean or fill, which compress very
+     well, so the tiled file is much smaller than the HDF file.
+  3. The file is written a row of tiles at a time, as the combined lines are
+     produced, so the full grid never needs to be held in memory.  The tiles
+     of a row are compressed independently and can be compressed in
+     parallel; the row is then written in tile order.
+******************************************************************************/
+#include <unistd.h>
+#include "aux_tiles.h"
+
+/******************************************************************************
+MODULE:  open_aux_tiles_writer
+
+PURPOSE:  Opens a temporary tiled auxiliary file for writing, allocates the
+tile buffers for a row of tiles, and writes the header and a placeholder for
+the tile index.
+
+RETURN VALUE:
+Type = Aux_tiles_writer_t *
+Value          Description
+-----          -----------
+NULL           Error allocating memory or opening the tiled auxiliary file
+non-NULL       Pointer to the tiled auxiliary file being written
+
+NOTES:
+  1. The tiles are written to a temporary file which is renamed by
+     close_aux_tiles_writer when it is complete, so a partial file is never
+     picked up by lasrc or by the check for existing auxiliary files.
+******************************************************************************/
+Aux_tiles_writer_t *open_aux_tiles_writer
+(
+    char *outfile,      /* I: name of the tiled auxiliary file to write */
+    int nlines,         /* I: number of lines in the grid */
+    int nsamps          /* I: number of samples in the grid */
+)
+{
+    char FUNC_NAME[] = "open_aux_tiles_writer";   /* function name */
+    char errmsg[STR_SIZE];     /* error message */
+    int tsamp;                 /* looping variable for the tile columns */
+    int ntiles;                /* number of tiles */
+    uLong usize;               /* uncompressed size of a full tile */
+    Aux_tiles_writer_t *this = NULL;  /* tiled file to be returned */
+    Aux_tiles_header_t *hdr = NULL;   /* file header */
+
+    this = calloc (1, sizeof (Aux_tiles_writer_t));
+    if (this == NULL)
+    {
+        sprintf (errmsg, "Allocating memory for the tiled auxiliary file");
+        error_handler (true, FUNC_NAME, errmsg);
+        return (NULL);
+    }
+    strncpy (this->outfile, outfile, STR_SIZE - 1);
+    snprintf (this->tmpfile, sizeof (this->tmpfile), "%s.tmp", outfile);
+
+    hdr = &this->hdr;
+    memcpy (hdr->magic, AUX_TILES_MAGIC, AUX_TILES_MAGIC_LEN);
+    hdr->nlines = nlines;
+    hdr->nsamps = nsamps;
+    hdr->tile_size = AUX_TILE_SIZE;
+    hdr->ntile_lines = (nlines + AUX_TILE_SIZE - 1) / AUX_TILE_SIZE;
+    hdr->ntile_samps = (nsamps + AUX_TILE_SIZE - 1) / AUX_TILE_SIZE;
+    hdr->cell_size = AUX_CELL_SIZE;
+    hdr->level = AUX_TILE_LEVEL;
+    ntiles = hdr->ntile_lines * hdr->ntile_samps;
+
+    /* Allocate the tile index and the tile buffers for a row of tiles */
+    usize = (uLong) AUX_TILE_SIZE * AUX_TILE_SIZE * AUX_CELL_SIZE;
+    this->index = calloc (ntiles, sizeof (Aux_tiles_index_t));
+    this->tile = calloc (hdr->ntile_samps, sizeof (unsigned char *));
+    this->ctile = calloc (hdr->ntile_samps, sizeof (unsigned char *));
+    this->csize = calloc (hdr->ntile_samps, sizeof (uLongf));
+    if (this->index == NULL || this->tile == NULL || this->ctile == NULL ||
+        this->csize == NULL)
+    {
+        sprintf (errmsg, "Allocating memory for the auxiliary tiles");
+        error_handler (true, FUNC_NAME, errmsg);
+        close_aux_tiles_writer (this, false);
+        return (NULL);
+    }
+    for (tsamp = 0; tsamp < hdr->ntile_samps; tsamp++)
+    {
+        this->tile[tsamp] = malloc (usize);
+        this->ctile[tsamp] = malloc (compressBound (usize));
+        if (this->tile[tsamp] == NULL || this->ctile[tsamp] == NULL)
+        {
+            sprintf (errmsg, "Allocating memory for the auxiliary tiles");
+            error_handler (true, FUNC_NAME, errmsg);
+            close_aux_tiles_writer (this, false);
+            return (NULL);
+        }
+    }
+
+    this->fp = fopen (this->tmpfile, "wb");
+    if (this->fp == NULL)
+    {
+        sprintf (errmsg, "Unable to open %s for writing", this->tmpfile);
+        error_handler (true, FUNC_NAME, errmsg);
+        close_aux_tiles_writer (this, false);
+        return (NULL);
+    }
+
+    /* Write the header and a placeholder for the index, which is rewritten
+       once the tile sizes are known */
+    if (fwrite (hdr, sizeof (Aux_tiles_header_t), 1, this->fp) != 1 ||
+        fwrite (this->index, sizeof (Aux_tiles_index_t), ntiles, this->fp) !=
+        ntiles)
+    {
+        sprintf (errmsg, "Error writing the auxiliary tile header to %s",
+            this->tmpfile);
+        error_handler (true, FUNC_NAME, errmsg);
+        close_aux_tiles_writer (this, false);
+        return (NULL);
+    }
+    this->offset = sizeof (Aux_tiles_header_t) +
+        (int64_t) ntiles * sizeof (Aux_tiles_index_t);
+
+    return (this);
+}
+
+
+/******************************************************************************
+MODULE:  compress_aux_tile
+
+PURPOSE:  Interleaves and compresses one tile of the current row of tiles.
+
+RETURN VALUE:
+Type = None
+
+NOTES:
+  1. The wv and oz buffers hold the lines of the current row of tiles only,
+     starting with the first line of the row.  The tiles at the end of the
+     lines and samples are smaller when the grid isn't a multiple of the tile
+     size.
+  2. Each tile column has its own buffers, so the tiles of a row may be
+     compressed by different threads.  Compression errors are counted and
+     reported by write_aux_tile_row.
+******************************************************************************/
+void compress_aux_tile
+(
+    Aux_tiles_writer_t *this, /* I/O: tiled auxiliary file being written */
+    int tile_samp,      /* I: tile column to compress in the current row */
+    uint16_t *wv,       /* I: water vapor values for the lines of the tile
+                              row, nlines x nsamps */
+    uint8_t *oz         /* I: ozone values for the lines of the tile row,
+                              nlines x nsamps */
+)
+{
+    int nsamps = this->hdr.nsamps;  /* number of samples in the grid */
+    int itile;                 /* current tile in the index */
+    int line, samp;            /* looping variables in the tile row */
+    int nlines;                /* number of lines in the tile row */
+    int first_samp, end_samp;  /* samples covered by the tile */
+    long pix;                  /* current cell in the tile row */
+    unsigned char *tile = this->tile[tile_samp];  /* interleaved tile */
+    unsigned char *cell = tile;    /* current cell in the tile */
+
+    nlines = this->hdr.nlines - this->tile_line * AUX_TILE_SIZE;
+    if (nlines > AUX_TILE_SIZE)
+        nlines = AUX_TILE_SIZE;
+    first_samp = tile_samp * AUX_TILE_SIZE;
+    end_samp = first_samp + AUX_TILE_SIZE;
+    if (end_samp > nsamps)
+        end_samp = nsamps;
+
+    for (line = 0; line < nlines; line++)
+    {
+        pix = (long) line * nsamps + first_samp;
+        for (samp = first_samp; samp < end_samp; samp++, pix++)
+        {
+            memcpy (cell, &wv[pix], sizeof (uint16_t));
+            cell[sizeof (uint16_t)] = oz[pix];
+            cell += AUX_CELL_SIZE;
+        }
+    }
+
+    itile = this->tile_line * this->hdr.ntile_samps + tile_samp;
+    this->index[itile].usize = cell - tile;
+    this->csize[tile_samp] = compressBound (this->index[itile].usize);
+    if (compress2 (this->ctile[tile_samp], &this->csize[tile_samp], tile,
+        this->index[itile].usize, AUX_TILE_LEVEL) != Z_OK)
+    {
+        #pragma omp atomic
+        this->nerrors++;
+        this->csize[tile_samp] = 0;
+    }
+}
+
+
+/******************************************************************************
+MODULE:  write_aux_tile_row
+
+PURPOSE:  Writes the compressed tiles of the current row of tiles, in tile
+order, and moves on to the next row.
+
+RETURN VALUE:
+Type = int
+Value          Description
+-----          -----------
+ERROR          Error compressing or writing the tiles
+SUCCESS        Successful completion
+
+NOTES:
+  1. All the tiles of the row must have been compressed with
+     compress_aux_tile.
+******************************************************************************/
+int write_aux_tile_row
+(
+    Aux_tiles_writer_t *this  /* I/O: tiled auxiliary file being written */
+)
+{
+    char FUNC_NAME[] = "write_aux_tile_row";   /* function name */
+    char errmsg[STR_SIZE];     /* error message */
+    int tsamp;                 /* looping variable for the tile columns */
+    int itile;                 /* current tile in the index */
+
+    if (this->nerrors > 0)
+    {
+        sprintf (errmsg, "Compressing auxiliary tile row %d", this->tile_line);
+        error_handler (true, FUNC_NAME, errmsg);
+        return (ERROR);
+    }
+
+    itile = this->tile_line * this->hdr.ntile_samps;
+    for (tsamp = 0; tsamp < this->hdr.ntile_samps; tsamp++, itile++)
+    {
+        this->index[itile].offset = this->offset;
+        this->index[itile].csize = this->csize[tsamp];
+        if (fwrite (this->ctile[tsamp], 1, this->csize[tsamp], this->fp) !=
+            this->csize[tsamp])
+        {
+            sprintf (errmsg, "Error writing auxiliary tile %d to %s", itile,
+                this->tmpfile);
+            error_handler (true, FUNC_NAME, errmsg);
+            this->nerrors++;
+            return (ERROR);
+        }
+        this->offset += this->csize[tsamp];
+    }
+
+    this->tile_line++;
+    return (SUCCESS);
+}
+
+
+/******************************************************************************
+MODULE:  close_aux_tiles_writer
+
+PURPOSE:  Rewrites the tile index, closes the temporary tiled auxiliary file
+and renames it to the output filename, then frees the writer.  If the file
+isn't to be kept, the temporary file is removed instead.
+
+RETURN VALUE:
+Type = int
+Value          Description
+-----          -----------
+ERROR          Error writing or renaming the tiled auxiliary file
+SUCCESS        Successful completion, or the file wasn't to be kept
+
+NOTES:
+  1. The file is only kept if every row of tiles was written; otherwise an
+     error is returned when the file was to be kept.
+******************************************************************************/
+int close_aux_tiles_writer
+(
+    Aux_tiles_writer_t *this, /* I: tiled auxiliary file to close and free */
+    bool keep           /* I: should the file be kept?  If false, or if any
+                              tiles failed, the partial file is removed */
+)
+{
+    char FUNC_NAME[] = "close_aux_tiles_writer";   /* function name */
+    char errmsg[STR_SIZE];     /* error message */
+    int tsamp;                 /* looping variable for the tile columns */
+    int ntiles;                /* number of tiles */
+    int status = SUCCESS;      /* return status */
+
+    if (this == NULL)
+        return (SUCCESS);
+
+    ntiles = this->hdr.ntile_lines * this->hdr.ntile_samps;
+    if (keep &&
+        (this->nerrors > 0 || this->tile_line != this->hdr.ntile_lines))
+    {
+        sprintf (errmsg, "Only %d of %d auxiliary tile rows were written to "
+            "%s", this->tile_line, this->hdr.ntile_lines, this->tmpfile);
+        error_handler (true, FUNC_NAME, errmsg);
+        keep = false;
+        status = ERROR;
+    }
+
+    if (this->fp != NULL)
+    {
+        /* Rewrite the index with the tile locations */
+        if (keep)
+        {
+            if (fseek (this->fp, sizeof (Aux_tiles_header_t), SEEK_SET) != 0
+                || fwrite (this->index, sizeof (Aux_tiles_index_t), ntiles,
+                this->fp) != ntiles)
+            {
+                sprintf (errmsg, "Error writing the auxiliary tile index to "
+                    "%s", this->tmpfile);
+                error_handler (true, FUNC_NAME, errmsg);
+                keep = false;
+                status = ERROR;
+            }
+        }
+        if (fclose (this->fp) != 0 && keep)
+        {
+            sprintf (errmsg, "Error writing the auxiliary tiles to %s",
+                this->tmpfile);
+            error_handler (true, FUNC_NAME, errmsg);
+            keep = false;
+            status = ERROR;
+        }
+
+        if (!keep)
+            unlink (this->tmpfile);
+        else if (rename (this->tmpfile, this->outfile) == -1)
+        {
+            sprintf (errmsg, "Unable to rename %s to %s", this->tmpfile,
+                this->outfile);
+            error_handler (true, FUNC_NAME, errmsg);
+            unlink (this->tmpfile);
+            status = ERROR;
+        }
+    }
+
+    for (tsamp = 0; tsamp < this->hdr.ntile_samps; tsamp++)
+    {
+        if (this->tile != NULL)
+            free (this->tile[tsamp]);
+        if (this->ctile != NULL)
+            free (this->ctile[tsamp]);
+    }
+    free (this->tile);
+    free (this->ctile);
+    free (this->csize);
+    free (this->index);
+    free (this);
+
+    return (status);
+}
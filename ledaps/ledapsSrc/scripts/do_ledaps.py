@@ -141,6 +141,10 @@ class Ledaps():
     #       should be completed.  True or False.  Default is True, otherwise
     #       the processing will halt after the TOA reflectance products are
     #       complete.
+    #   write_toa - specifies whether the TOA reflectance products should be
+    #       written.  True or False.  Default is True.  If False (and
+    #       process_sr is True), lndcal is skipped and lndsr calibrates the
+    #       Level-1 bands as it reads them.
     #
     # Returns:
     #     ERROR - error running the LEDAPS applications
@@ -152,7 +156,7 @@ class Ledaps():
     #      xmlfile directory is not writable, then this script exits with
     #      an error.
     #######################################################################
-    def runLedaps(self, xmlfile=None, process_sr="True"):
+    def runLedaps(self, xmlfile=None, process_sr="True", write_toa="True"):
         # If no parameters were passed then get the info from the command line
         if xmlfile is None:
 
@@ -175,6 +179,14 @@ class Ledaps():
                                     " complete. (Note: scenes with solar"
                                     " zenith angles above 76 degrees should"
                                     " use process_sr=False)"))
+            parser.add_option("-t", "--write_toa", type="string",
+                              dest="write_toa",
+                              help=("write the TOA reflectance products;"
+                                    " True or False (default is True)"
+                                    " If False, then lndcal is skipped and"
+                                    " lndsr calibrates the Level-1 bands as"
+                                    " they are read, which avoids writing"
+                                    " and reading back the TOA bands"))
             (options, args) = parser.parse_args()
 
             # Validate the command-line options
@@ -185,6 +197,9 @@ class Ledaps():
             process_sr = options.process_sr  # process SR or not
             if process_sr is None:
                 process_sr = "True"  # If not provided, default to True
+            write_toa = options.write_toa  # write the TOA products or not
+            if write_toa is None:
+                write_toa = "True"  # If not provided, default to True
 
         # Obtain logger from logging using the module's name
         logger = logging.getLogger(__name__)
@@ -275,16 +290,23 @@ class Ledaps():
                 logger.error('Error running lndpm.  Processing will terminate.')
                 return ERROR
 
-            cmdstr = 'lndcal --pfile lndcal.{}.txt'.format(xml)
-            (status, output) = commands.getstatusoutput(cmdstr)
-            logger.info(output)
-            exit_code = status >> 8
-            if exit_code != 0:
-                logger.error('Error running lndcal. Processing will terminate.')
-                return ERROR
+            # The TOA products are only needed by lndsr if they are written;
+            # otherwise lndsr calibrates the Level-1 bands itself
+            calibrate = (process_sr == 'True' and write_toa == 'False')
+            if not calibrate:
+                cmdstr = 'lndcal --pfile lndcal.{}.txt'.format(xml)
+                (status, output) = commands.getstatusoutput(cmdstr)
+                logger.info(output)
+                exit_code = status >> 8
+                if exit_code != 0:
+                    logger.error('Error running lndcal. Processing will '
+                                 'terminate.')
+                    return ERROR
 
             if process_sr == 'True':
                 cmdstr = 'lndsr --pfile lndsr.{}.txt'.format(xml)
+                if calibrate:
+                    cmdstr += ' --calibrate'
                 (status, output) = commands.getstatusoutput(cmdstr)
                 logger.info(output)
                 exit_code = status >> 8
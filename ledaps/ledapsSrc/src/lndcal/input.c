@@ -75,6 +75,7 @@ Input_t *OpenInput(Espa_internal_meta_t *metadata)
     RETURN_ERROR("allocating Input data structure", "OpenInput", NULL);
 
   /* Initialize and get input from header file */
+  this->nbytes_read = 0;
   if (!GetXMLInput (this, metadata)) {
     free(this);
     this = NULL;
@@ -152,6 +153,7 @@ bool GetInputLine(Input_t *this, int iband, int iline, unsigned char *line)
     if (fread(buf_void, sizeof(uint8), (size_t)this->size.s, 
               this->fp_bin[iband]) != (size_t)this->size.s)
       RETURN_ERROR("error reading line (binary)", "GetInputLine", false);
+    this->nbytes_read += (long long)this->size.s * sizeof(uint8);
   }
 
   return true;
@@ -179,6 +181,7 @@ bool GetInputLineTh(Input_t *this, int iline, unsigned char *line)
     if (fread(buf_void, sizeof(uint8), (size_t)this->size_th.s, 
               this->fp_bin_th) != (size_t)this->size_th.s)
       RETURN_ERROR("error reading line (binary)", "GetInputLineTh", false);
+    this->nbytes_read += (long long)this->size_th.s * sizeof(uint8);
   }
 
   return true;
@@ -204,6 +207,7 @@ bool GetInputLineSunZen(Input_t *this, int iline, int16 *line)
     if (fread(buf_void, sizeof(int16), (size_t)this->size.s,
               this->fp_bin_sun_zen) != (size_t)this->size.s)
       RETURN_ERROR("error reading line (binary)", "GetInputLineSunZen", false);
+    this->nbytes_read += (long long)this->size.s * sizeof(int16);
   }
 
   return true;
@@ -114,6 +114,7 @@ typedef struct {
   FILE *fp_bin_th;         /* File pointer for thermal binary file */
   FILE *fp_bin_sun_zen;    /* File pointer for the representative per-pixel
                               array solar zenith band */
+  long long nbytes_read;   /* Bytes read from the input files */
 } Input_t;
 
 /* Prototypes */
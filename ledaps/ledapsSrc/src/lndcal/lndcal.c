@@ -296,6 +296,11 @@ int main (int argc, char *argv[]) {
       cal_stats6.temp_min, cal_stats6.temp_max);
 #endif
 
+  /* Report the image I/O of the scene */
+  printf(" bytes read from the Level-1 bands %lld\n", input->nbytes_read);
+  printf(" bytes written to the TOA bands %lld\n", output->nbytes_written +
+    (input->nband_th > 0 ? output_th->nbytes_written : 0));
+
   /* Close input and output files */
   if (!CloseInput(input)) EXIT_ERROR("closing input file", "main");
   if (!CloseOutput(output)) EXIT_ERROR("closing input file", "main");
@@ -142,6 +142,7 @@ Output_t *OpenOutput(Espa_internal_meta_t *in_meta, Input_t *input,
 
   /* Populate the data structure */
   this->open = false;
+  this->nbytes_written = 0;
   this->nband = nband_tot;
   this->size.l = input->size.l;
   this->size.s = input->size.s;
@@ -352,6 +353,7 @@ bool PutOutputLine(Output_t *this, int iband, int iline, void *line)
   if (write_raw_binary (this->fp_bin[iband], 1, this->size.s, nbytes, line)
       != SUCCESS)
     RETURN_ERROR("writing output line", "PutOutputLine", false);
+  this->nbytes_written += (long long)this->size.s * nbytes;
 
   return true;
 }
@@ -62,6 +62,7 @@ typedef struct {
                            metadata for the output bands; global metadata
                            won't be valid */
   FILE *fp_bin[NBAND_CAL_MAX];  /* File pointer for binary files */
+  long long nbytes_written;  /* Bytes written to the output files */
 } Output_t;
 
 /* Prototypes */
@@ -7,16 +7,10 @@
 #include "const.h"
 #include "error.h"
 #include "sixs_runs.h"
+#include "rayleigh.h"
 
 #define AOT_MIN_NB_SAMPLES 100
 
-#ifndef  HPUX
-#define chand chand_
-#define csalbr csalbr_
-#endif
-void chand(float *phi,float *muv,float *mus,float *tau_ray,float *actual_rho_ray);
-void csalbr(float *tau_ray,float *actual_S_r);
-
 int compute_aot(int band,float rho_toa,float rho_surf_est,float ts,float tv, float phi, float uoz, float uwv, float spres,sixs_tables_t *sixs_tables,float *aot);
 int update_gridcell_atmos_coefs(int irow,int icol,atmos_t *atmos_coef,Ar_gridcell_t *ar_gridcell, sixs_tables_t *sixs_tables,int **line_ar,Lut_t *lut,int nband, int bkgd_aerosol);
 
@@ -360,20 +354,31 @@ int compute_aot(int band,float toarhoblue,float toarhored,float ts,float tv, flo
 	float actual_rho_ray,actual_T_ray,actual_S_r;
 	float mus,muv,tau_ray,ratio;
 	float tau_ray_sealevel[7]={0.16511,0.08614,0.04716,0.01835,0.00113,0.00037}; /* index=5 => band 7 */
+	float phi_br[2],muv_br[2],mus_br[2],tau_ray_br[2]; /* blue and red */
+	float rho_ray_br[2],S_r_br[2];
 	
-/* correct the blue band */	
-	band=0;
+/* Rayleigh reflectance and spherical albedo of the blue and red bands */
 	mus=cos(ts*RAD);
 	muv=cos(tv*RAD);
 	ratio=spres/1013.;
-	tau_ray=tau_ray_sealevel[band]*ratio;
-	
-	chand(&phi,&muv,&mus,&tau_ray,&actual_rho_ray);
+	for (i=0;i<2;i++) {
+		phi_br[i]=phi;
+		muv_br[i]=muv;
+		mus_br[i]=mus;
+		tau_ray_br[i]=tau_ray_sealevel[2*i]*ratio;
+	}
+	chand_batch(2,phi_br,muv_br,mus_br,tau_ray_br,rho_ray_br);
+	csalbr_batch(2,tau_ray_br,S_r_br);
+
+/* correct the blue band */	
+	band=0;
+	tau_ray=tau_ray_br[0];
+	actual_rho_ray=rho_ray_br[0];
 
 	actual_T_ray=((2./3.+mus)+(2./3.-mus)*exp(-tau_ray/mus))/(4./3.+tau_ray); /* downward */
 	actual_T_ray *= ((2./3.+muv)+(2./3.-muv)*exp(-tau_ray/muv))/(4./3.+tau_ray); /* total */
 
-	csalbr(&tau_ray,&actual_S_r);
+	actual_S_r=S_r_br[0];
 	
 
 	for (i=0;i<SIXS_NB_AOT;i++) {
@@ -385,17 +390,13 @@ int compute_aot(int band,float toarhoblue,float toarhored,float ts,float tv, flo
 	
 /* correct the red band */	
 	band=2;
-	mus=cos(ts*RAD);
-	muv=cos(tv*RAD);
-	ratio=spres/1013.;
-	tau_ray=tau_ray_sealevel[band]*ratio;
-	
-	chand(&phi,&muv,&mus,&tau_ray,&actual_rho_ray);
+	tau_ray=tau_ray_br[1];
+	actual_rho_ray=rho_ray_br[1];
 
 	actual_T_ray=((2./3.+mus)+(2./3.-mus)*exp(-tau_ray/mus))/(4./3.+tau_ray); /* downward */
 	actual_T_ray *= ((2./3.+muv)+(2./3.-muv)*exp(-tau_ray/muv))/(4./3.+tau_ray); /* total */
 
-	csalbr(&tau_ray,&actual_S_r);
+	actual_S_r=S_r_br[1];
 
 	for (i=0;i<SIXS_NB_AOT;i++) {
 	        surrhored[i]=toarhored/sixs_tables->T_g_og[band];
@@ -509,6 +510,95 @@ int ArInterp(Lut_t *lut, Img_coord_int_t *input_loc, int ***line_ar,int *inter_a
   return 0;
 }
 
+int ArInterpLine(Lut_t *lut, int il, int nsamp, int ***line_ar,
+                 int16 *inter_aot) 
+/* 
+  Same interpolation as ArInterp, for a whole line at a time.  The aerosol
+  rows around the line and their distances are found once for the line, and
+  the aerosol columns once for each run of samples between them, so only
+  the sample distances are left to compute for each pixel.  The result is the
+  same as ArInterp for every pixel.
+
+  Point order:
+
+    0 ---- 1    +--> sample
+    |      |    |
+    |      |    v
+    2 ---- 3   line
+
+ */
+
+{
+  Img_coord_int_t ar_region_half;
+  int l[2];             /* aerosol rows of points 0/1 and 2/3 */
+  int s[2];             /* aerosol columns of points 0/2 and 1/3 */
+  int *ar_row[2];       /* aerosol values of those rows */
+  float dl[2];          /* line distance to those rows */
+  float ds[2];          /* sample distance to those columns */
+  int is, s_end, i, j, k, n;
+  float w;
+  float sum, sum_w;
+
+  /* Note the right shift by 1 is a faster way of divide by 2 */
+  ar_region_half.l = (lut->ar_region_size.l + 1) >> 1;
+  ar_region_half.s = (lut->ar_region_size.s + 1) >> 1;
+
+  l[0] = (il - ar_region_half.l) / lut->ar_region_size.l;
+  l[1] = l[0] + 1;
+  if (l[1] >= lut->ar_size.l) {
+    l[1] = lut->ar_size.l - 1;
+    if (l[0] > 0) l[0]--;
+  }
+
+  for (j = 0; j < 2; j++) {
+    ar_row[j] = (l[j] != -1) ? line_ar[l[j]][0] : NULL;
+    dl[j] = (il - ar_region_half.l) - (l[j] * lut->ar_region_size.l);
+    dl[j] = fabs(dl[j]) / lut->ar_region_size.l;
+  }
+
+  for (is = 0; is < nsamp; is = s_end) {
+    /* Samples up to s_end share the same aerosol columns */
+    s[0] = (is - ar_region_half.s) / lut->ar_region_size.s;
+    s_end = ar_region_half.s + (s[0] + 1) * lut->ar_region_size.s;
+    if (s_end > nsamp) s_end = nsamp;
+
+    s[1] = s[0] + 1;
+    if (s[1] >= lut->ar_size.s) {
+      s[1] = lut->ar_size.s - 1;
+      if (s[0] > 0) s[0]--;
+    }
+
+    for ( ; is < s_end; is++) {
+      for (k = 0; k < 2; k++) {
+        ds[k] = (is - ar_region_half.s) - (s[k] * lut->ar_region_size.s);
+        ds[k] = fabs(ds[k]) / lut->ar_region_size.s;
+      }
+
+      n = 0;
+      sum = sum_w = 0.0;
+      for (i = 0; i < 4; i++) {
+        j = i >> 1;
+        k = i & 1;
+        if (l[j] == -1  ||  s[k] == -1) continue;
+        if (ar_row[j][s[k]] == lut->aerosol_fill) continue;
+
+        w = (1.0 - dl[j]) * (1.0 - ds[k]);
+
+        n++;
+        sum_w += w;
+        sum += (ar_row[j][s[k]] * w);
+      }
+
+      if ((n > 0)&&(sum_w>0))
+        inter_aot[is] = floor((sum / sum_w) + 0.5);
+      else
+        inter_aot[is] = lut->aerosol_fill;
+    }
+  }
+
+  return 0;
+}
+
 int Old_Fill_Ar_Gaps(Lut_t *lut, int ***line_ar, int ib) 
 /* 
   Point order:
@@ -613,110 +703,164 @@ int Old_Fill_Ar_Gaps(Lut_t *lut, int ***line_ar, int ib)
 
 int Fill_Ar_Gaps(Lut_t *lut, int ***line_ar, int ib) {
 /*
-!Description: fill in missing values in the OZONE grid based
+!Description: fill in missing values in the aerosol grid based
 on existing values (spatial interpolation). 
 
+ ! Design Notes:
+   1. Each pass fills every gap with at least 3 valid values within 3 grid
+      points, weighting them by their distance, from the values valid at
+      the start of the pass.  Passes are repeated until no gap is filled;
+      the gaps which are left are set to 60.
+   2. A gap can only be filled by a pass if a value within 3 grid points of
+      it was filled by the pass before, so after the first pass only the
+      gaps around the values just filled are looked at again.  Each grid
+      point is looked at a bounded number of times, so the fill is linear
+      in the grid size however large the gaps are, and the result is the
+      same as looking at every gap in every pass.
+
 !END****************************************************************************
 */
-   int i,j,k,l,count,More_Gaps,nbfills;
-   int last_value=-99;
-   float dist,sum_value,sum_dist;
-   char **missing_flag,*missing_flag_array;
-   int min_nb_values,n,max_distance;
-
-	if ((missing_flag_array=(char *)calloc(lut->ar_size.l*lut->ar_size.s,sizeof(char)))==NULL)
-		return 0;
-	if ((missing_flag=(char **)calloc(lut->ar_size.l,sizeof(char *)))==NULL)
-		return 0;
-	for (i=0;i<lut->ar_size.l;i++)
-		missing_flag[i]=&missing_flag_array[i*lut->ar_size.s];
+  int i,j,k,l,ipt,count,nbfills,nb_cand,nb_next,ifill;
+  int last_value=-99;
+  int nbpts=lut->ar_size.l*lut->ar_size.s;
+  float dist,sum_value,sum_dist;
+  char *missing_flag = NULL;  /* gap at the start of the pass */
+  int *cand = NULL;           /* gaps to look at in the pass */
+  int *next = NULL;           /* gaps to look at in the next pass */
+  int *stamp = NULL;          /* last pass each gap was queued for */
+  int *fill_value = NULL;     /* values filled in the pass, in cand order */
+  int *tmp;
+  int pass,min_nb_values,n,max_distance;
+
+  min_nb_values=3;
+  max_distance=3;
+
 /**
 Start by counting valid values
 if nb gaps = 0 do nothing
 if nb gaps = 1 duplicate value everywhere
 **/
-	count=0;
-	for (i=0;i<lut->ar_size.l;i++) {
-		for (j=0;j<lut->ar_size.s;j++) {
-			if (line_ar[i][ib][j] != lut->aerosol_fill)  {
-      			count++;
-				last_value=line_ar[i][ib][j];
-			}
-		}
-	} 
-	if (count==0)
-      return 0;
-	if (count==1) {
-		for (i=0;i<lut->ar_size.l;i++)
-			for (j=0;j<lut->ar_size.s;j++) {
-				line_ar[i][ib][j]=last_value;
-			}
-		return 0;
-	}
- 	More_Gaps=1;
-	nbfills=1;
-	while ((More_Gaps)&&(nbfills != 0)) {
- 		More_Gaps=0;
-                nbfills=0;
-		for (i=0;i<lut->ar_size.l;i++) {
-			for (j=0;j<lut->ar_size.s;j++) {
-				missing_flag[i][j]=0;
-				if (line_ar[i][ib][j]==lut->aerosol_fill)  {
-					missing_flag[i][j]=1;
-					More_Gaps=1;
-				}
-			}
-		}
-		if (More_Gaps) {
-	
-			for (i=0;i<lut->ar_size.l;i++) {
-				for (j=0;j<lut->ar_size.s;j++) {
+  count=0;
+  for (i=0;i<lut->ar_size.l;i++) {
+    for (j=0;j<lut->ar_size.s;j++) {
+      if (line_ar[i][ib][j] != lut->aerosol_fill)  {
+        count++;
+        last_value=line_ar[i][ib][j];
+      }
+    }
+  } 
+  if (count==0)
+    return 0;
+  if (count==1) {
+    for (i=0;i<lut->ar_size.l;i++)
+      for (j=0;j<lut->ar_size.s;j++) {
+        line_ar[i][ib][j]=last_value;
+      }
+    return 0;
+  }
+  if (count==nbpts)
+    return 0;
+
+  missing_flag=(char *)calloc(nbpts,sizeof(char));
+  cand=(int *)malloc(nbpts*sizeof(int));
+  next=(int *)malloc(nbpts*sizeof(int));
+  stamp=(int *)calloc(nbpts,sizeof(int));
+  fill_value=(int *)malloc(nbpts*sizeof(int));
+  if ((missing_flag==NULL)||(cand==NULL)||(next==NULL)||(stamp==NULL)||
+      (fill_value==NULL)) {
+    free(missing_flag);
+    free(cand);
+    free(next);
+    free(stamp);
+    free(fill_value);
+    return 0;
+  }
 
-/**
-Look for at least 3 neighboring valid values within 4 GPs
-smooth
-**/
-					min_nb_values=3;
-					max_distance=3;	
-					if (missing_flag[i][j]) {
-						sum_dist=0.;
-						sum_value=0.;
-						n=0;
-						for (k=i-max_distance;k<=(i+max_distance);k++) {
-							if ((k>=0)&&(k<lut->ar_size.l)) {
-								for (l=j-max_distance;l<=(j+max_distance);l++) {
-									if ((l>=0)&&(l<lut->ar_size.s)) {
-										if (!missing_flag[k][l]) {
-											dist=sqrt((k-i)*(k-i)+(l-j)*(l-j));
-											sum_dist += dist;
-											sum_value += (dist*line_ar[k][ib][l]);
-											n++;
-										}
-									}
-								}
-							}
-						}
-						if ((n>=min_nb_values)&&(sum_dist!=0.)) {
-/*						printf("Gaps in %d %d  band %d was filled \n",i,j,ib); */
-							line_ar[i][ib][j]=sum_value/sum_dist;
-							nbfills=nbfills+1;
-						}
-						else
-						{
-/*						printf("Gaps in %d %d  band %d was NOT filled \n",i,j,ib);*/
-						}
-					}
-				}
-			}
-		}
- 	}
-	if ((More_Gaps)&&(nbfills == 0)) {
-	for (i=0;i<lut->ar_size.l;i++) {
-		for (j=0;j<lut->ar_size.s;j++) {
-			if (line_ar[i][ib][j] == lut->aerosol_fill)  line_ar[i][ib][j]=60;
-			}
-			}
-			}
-	   
- 	return 0;
+  /* Every gap is looked at in the first pass */
+  nb_cand=0;
+  for (ipt=0;ipt<nbpts;ipt++) {
+    if (line_ar[ipt/lut->ar_size.s][ib][ipt%lut->ar_size.s]==
+        lut->aerosol_fill) {
+      missing_flag[ipt]=1;
+      stamp[ipt]=1;
+      cand[nb_cand++]=ipt;
+    }
+  }
+
+  for (pass=1;nb_cand>0;pass++) {
+    /* Find the values of the gaps which can be filled, from the values
+       valid at the start of the pass */
+    nbfills=0;
+    for (ifill=0;ifill<nb_cand;ifill++) {
+      i=cand[ifill]/lut->ar_size.s;
+      j=cand[ifill]%lut->ar_size.s;
+      sum_dist=0.;
+      sum_value=0.;
+      n=0;
+      for (k=i-max_distance;k<=(i+max_distance);k++) {
+        if ((k>=0)&&(k<lut->ar_size.l)) {
+          for (l=j-max_distance;l<=(j+max_distance);l++) {
+            if ((l>=0)&&(l<lut->ar_size.s)) {
+              if (!missing_flag[k*lut->ar_size.s+l]) {
+                dist=sqrt((k-i)*(k-i)+(l-j)*(l-j));
+                sum_dist += dist;
+                sum_value += (dist*line_ar[k][ib][l]);
+                n++;
+              }
+            }
+          }
+        }
+      }
+      if ((n>=min_nb_values)&&(sum_dist!=0.)) {
+        cand[nbfills]=cand[ifill];
+        fill_value[nbfills]=sum_value/sum_dist;
+        nbfills++;
+      }
+    }
+    if (nbfills==0)
+      break;
+
+    /* Fill them, and queue the gaps left around them for the next pass */
+    for (ifill=0;ifill<nbfills;ifill++) {
+      i=cand[ifill]/lut->ar_size.s;
+      j=cand[ifill]%lut->ar_size.s;
+      line_ar[i][ib][j]=fill_value[ifill];
+      missing_flag[cand[ifill]]=0;
+    }
+    nb_next=0;
+    for (ifill=0;ifill<nbfills;ifill++) {
+      i=cand[ifill]/lut->ar_size.s;
+      j=cand[ifill]%lut->ar_size.s;
+      for (k=i-max_distance;k<=(i+max_distance);k++) {
+        if ((k>=0)&&(k<lut->ar_size.l)) {
+          for (l=j-max_distance;l<=(j+max_distance);l++) {
+            if ((l>=0)&&(l<lut->ar_size.s)) {
+              ipt=k*lut->ar_size.s+l;
+              if (missing_flag[ipt]&&(stamp[ipt]!=pass+1)) {
+                stamp[ipt]=pass+1;
+                next[nb_next++]=ipt;
+              }
+            }
+          }
+        }
+      }
+    }
+    tmp=cand;
+    cand=next;
+    next=tmp;
+    nb_cand=nb_next;
+  }
+
+  /* Set the gaps which couldn't be filled */
+  for (ipt=0;ipt<nbpts;ipt++) {
+    if (missing_flag[ipt])
+      line_ar[ipt/lut->ar_size.s][ib][ipt%lut->ar_size.s]=60;
+  }
+
+  free(missing_flag);
+  free(cand);
+  free(next);
+  free(stamp);
+  free(fill_value);
+  return 0;
 }
@@ -18,6 +18,8 @@ bool Ar(int il_ar,Lut_t *lut, Img_coord_int_t *size_in, int16 ***line_in,
         Ar_gridcell_t *ar_gridcell, sixs_tables_t *sixs_tables);
 
 int ArInterp(Lut_t *lut, Img_coord_int_t *loc, int ***line_ar, int *inter_aot);
+int ArInterpLine(Lut_t *lut, int il, int nsamp, int ***line_ar,
+                 int16 *inter_aot);
 int Fill_Ar_Gaps(Lut_t *lut, int ***line_ar, int ib);
 
 #endif
@@ -0,0 +1,425 @@
+/*
+!C****************************************************************************
+
+!File: bench_io.c
+
+!Description: Measures the image bytes read and written by lndsr on the lndcal
+ TOA products and with --calibrate, on a synthetic TM scene.  Built and run
+ by 'make bench'.
+
+!Team Unique Header:
+
+ ! Design Notes:
+   1. Usage: bench_io [nlines nsamps]
+      The default size is that of a TM scene.  The files are written to a
+      temporary directory in $TMPDIR (or /tmp) and removed at the end.
+   2. Synthetic Level-1 bands (random DNs with fill around the edges and
+      some saturation) and a solar zenith band are written with the XML
+      metadata lndsr reads.  The lndcal TOA reflectance, radiometric
+      saturation QA, and brightness temperature products are then written
+      from them through cal.c, which gives the values of lndcal, so the
+      bytes written are those of the lndcal products.
+   3. The lndsr input module (input.c) is then read with the pattern of the
+      four lndsr passes: the two cloud detection passes read the reflectance
+      bands, the QA, and the thermal band of every line, and the aerosol and
+      surface reflectance passes read the reflectance bands of every line.
+      This is done once on the TOA products and once calibrating the
+      Level-1 bands as they are read, and the bytes counted by input.c and
+      cal.c are reported with the read times.
+   4. lndcal's own reads of the Level-1 bands (16 bytes per pixel: the
+      saturation, thermal, and reflectance passes) are printed by lndcal
+      and aren't included here.
+   5. The files were just written, so the read times are mostly from the
+      page cache; the byte counts are the measurement.
+
+!END****************************************************************************
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include "input.h"
+#include "cal.h"
+#include "error.h"
+
+/* Size of a TM scene */
+#define BENCH_NLINES 7000
+#define BENCH_NSAMPS 8000
+
+/* Number of Level-1 bands (including the thermal band), and number of bands
+   in the XML metadata: the Level-1 bands, the solar zenith band, and the
+   lndcal TOA reflectance, QA, and brightness temperature bands */
+#define NBAND_L1 7
+#define NBAND_META (NBAND_L1 + 1 + NBAND_REFL_MAX + 2)
+
+/* Random numbers from a fixed generator, so each run writes the same
+   scene */
+static unsigned long seed = 1;
+
+static int next_random(int n)
+{
+  seed = seed * 1103515245UL + 12345UL;
+  return (int)((seed >> 16) & 0x7fff) % n;
+}
+
+
+static double bench_time(void)
+/*
+!C******************************************************************************
+
+!Description: 'bench_time' returns the current wall clock time in seconds.
+
+!END****************************************************************************
+*/
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec * 1.0e-6;
+}
+
+
+static void set_band(Espa_band_meta_t *bmeta, char *dir, char *product,
+                     char *name, int nlines, int nsamps)
+/*
+!C******************************************************************************
+
+!Description: 'set_band' sets the metadata of a band read by lndsr; the file
+ is named for the band in the bench directory.
+
+!END****************************************************************************
+*/
+{
+  snprintf(bmeta->product, sizeof(bmeta->product), "%s", product);
+  snprintf(bmeta->name, sizeof(bmeta->name), "%s", name);
+  snprintf(bmeta->file_name, sizeof(bmeta->file_name), "%s/%s.img", dir,
+    name);
+  bmeta->nlines = nlines;
+  bmeta->nsamps = nsamps;
+  bmeta->refl_gain = bmeta->refl_bias = ESPA_FLOAT_META_FILL;
+  bmeta->rad_gain = bmeta->rad_bias = ESPA_FLOAT_META_FILL;
+  bmeta->k1_const = bmeta->k2_const = ESPA_FLOAT_META_FILL;
+}
+
+
+static bool write_level1(Espa_internal_meta_t *meta, int nlines, int nsamps)
+/*
+!C******************************************************************************
+
+!Description: 'write_level1' writes the synthetic Level-1 bands and solar
+ zenith band.
+
+!Output Parameters:
+ (returns)      status:
+                  'true' = okay
+                  'false' = error writing the files
+
+! Design Notes:
+   1. The scene is a rotated rectangle with fill around it, as in the
+      Level-1 products, and about one pixel in a thousand is saturated.
+
+!END****************************************************************************
+*/
+{
+  FILE *fp[NBAND_L1 + 1];
+  uint8 *dn = NULL;
+  int16 *sun_zen = NULL;
+  int ib, il, is;
+  double x, y;
+  bool ok = true;
+
+  dn = calloc(nsamps, sizeof(uint8));
+  sun_zen = calloc(nsamps, sizeof(int16));
+  if (dn == NULL || sun_zen == NULL)
+    RETURN_ERROR("allocating the Level-1 lines", "write_level1", false);
+  for (ib = 0; ib <= NBAND_L1; ib++) {
+    fp[ib] = fopen(meta->band[ib].file_name, "w");
+    if (fp[ib] == NULL)
+      RETURN_ERROR("opening a Level-1 file", "write_level1", false);
+  }
+
+  for (il = 0; il < nlines && ok; il++) {
+    y = (double)il / nlines;
+    for (is = 0; is < nsamps; is++)
+      sun_zen[is] = (int16)(4000 + (is / 100) % 50);
+    if (fwrite(sun_zen, sizeof(int16), nsamps, fp[NBAND_L1]) !=
+        (size_t)nsamps)
+      ok = false;
+    for (ib = 0; ib < NBAND_L1; ib++) {
+      for (is = 0; is < nsamps; is++) {
+        x = (double)is / nsamps;
+        if (x + 4.0 * y < 0.8 || 4.0 * x - y > 3.2 ||
+            x + 4.0 * y > 4.2 || 4.0 * x - y < -0.2)
+          dn[is] = CAL_IN_FILL;
+        else if (next_random(1000) == 0)
+          dn[is] = CAL_SATU_VAL;
+        else
+          dn[is] = (uint8)(1 + next_random(250));
+      }
+      if (fwrite(dn, sizeof(uint8), nsamps, fp[ib]) != (size_t)nsamps)
+        ok = false;
+    }
+  }
+
+  for (ib = 0; ib <= NBAND_L1; ib++)
+    fclose(fp[ib]);
+  free(dn);
+  free(sun_zen);
+  if (!ok)
+    RETURN_ERROR("writing the Level-1 files", "write_level1", false);
+  return true;
+}
+
+
+static bool write_toa(Espa_internal_meta_t *meta, int nlines, int nsamps,
+                      long long *nbytes_written)
+/*
+!C******************************************************************************
+
+!Description: 'write_toa' writes the lndcal TOA reflectance, radiometric
+ saturation QA, and brightness temperature products, calibrating the Level-1
+ bands with cal.c.
+
+!Output Parameters:
+ nbytes_written  bytes written to the TOA products
+ (returns)      status:
+                  'true' = okay
+                  'false' = error writing the files
+
+!END****************************************************************************
+*/
+{
+  Cal_t *cal = NULL;
+  FILE *fp[NBAND_REFL_MAX + 2];
+  int16 *line = NULL;
+  uint8 *qa_line = NULL;
+  int ib, il;
+  int first = NBAND_L1 + 1;   /* first TOA band in the metadata */
+  bool ok = true;
+
+  cal = OpenCal(meta);
+  if (cal == NULL)
+    RETURN_ERROR("opening the calibration", "write_toa", false);
+  line = calloc(nsamps, sizeof(int16));
+  qa_line = calloc(nsamps, sizeof(uint8));
+  if (line == NULL || qa_line == NULL)
+    RETURN_ERROR("allocating the TOA lines", "write_toa", false);
+  for (ib = 0; ib < NBAND_REFL_MAX + 2; ib++) {
+    fp[ib] = fopen(meta->band[first + ib].file_name, "w");
+    if (fp[ib] == NULL)
+      RETURN_ERROR("opening a TOA file", "write_toa", false);
+  }
+
+  *nbytes_written = 0;
+  for (il = 0; il < nlines && ok; il++) {
+    for (ib = 0; ib < NBAND_REFL_MAX; ib++) {
+      if (!GetCalLine(cal, cal->iband[ib], il, line) ||
+          fwrite(line, sizeof(int16), nsamps, fp[ib]) != (size_t)nsamps)
+        ok = false;
+      *nbytes_written += (long long)nsamps * sizeof(int16);
+    }
+    if (!GetCalQALine(cal, il, qa_line) ||
+        fwrite(qa_line, sizeof(uint8), nsamps, fp[NBAND_REFL_MAX]) !=
+        (size_t)nsamps)
+      ok = false;
+    *nbytes_written += (long long)nsamps * sizeof(uint8);
+    if (!GetCalLine(cal, CAL_BAND_TH, il, line) ||
+        fwrite(line, sizeof(int16), nsamps, fp[NBAND_REFL_MAX + 1]) !=
+        (size_t)nsamps)
+      ok = false;
+    *nbytes_written += (long long)nsamps * sizeof(int16);
+  }
+
+  for (ib = 0; ib < NBAND_REFL_MAX + 2; ib++)
+    fclose(fp[ib]);
+  free(line);
+  free(qa_line);
+  CloseCal(cal);
+  FreeCal(cal);
+  if (!ok)
+    RETURN_ERROR("writing the TOA files", "write_toa", false);
+  return true;
+}
+
+
+static bool read_passes(Espa_internal_meta_t *meta, bool calibrate,
+                        long long *nbytes_read, double *elapsed)
+/*
+!C******************************************************************************
+
+!Description: 'read_passes' reads the scene through the lndsr input module
+ with the pattern of the four lndsr passes.
+
+!Input Parameters:
+ calibrate      calibrate the Level-1 bands as they are read (lndsr
+                --calibrate) rather than reading the TOA products
+
+!Output Parameters:
+ nbytes_read    bytes read from the image files
+ elapsed        time of the reads (seconds)
+ (returns)      status:
+                  'true' = okay
+                  'false' = error reading the scene
+
+!END****************************************************************************
+*/
+{
+  Cal_t *cal = NULL;
+  Input_t *input = NULL, *input_b6 = NULL;
+  int16 *line = NULL;
+  uint8 *qa_line = NULL;
+  int ipass, ib, il;
+  double start;
+
+  if (calibrate) {
+    cal = OpenCal(meta);
+    if (cal == NULL)
+      RETURN_ERROR("opening the calibration", "read_passes", false);
+  }
+  input = OpenInput(meta, false, cal);
+  input_b6 = OpenInput(meta, true, cal);
+  if (input == NULL || input_b6 == NULL)
+    RETURN_ERROR("opening the input", "read_passes", false);
+  line = calloc(input->size.s, sizeof(int16));
+  qa_line = calloc(input->size.s, sizeof(uint8));
+  if (line == NULL || qa_line == NULL)
+    RETURN_ERROR("allocating the input lines", "read_passes", false);
+
+  start = bench_time();
+  for (ipass = 0; ipass < 4; ipass++) {
+    for (il = 0; il < input->size.l; il++) {
+      for (ib = 0; ib < input->nband; ib++)
+        if (!GetInputLine(input, ib, il, line))
+          RETURN_ERROR("reading a band", "read_passes", false);
+
+      /* The cloud detection passes also read the QA and thermal band */
+      if (ipass < 2) {
+        if (!GetInputQALine(input, il, qa_line))
+          RETURN_ERROR("reading the QA", "read_passes", false);
+        if (!GetInputLine(input_b6, 0, il, line))
+          RETURN_ERROR("reading the thermal band", "read_passes", false);
+      }
+    }
+  }
+  *elapsed = bench_time() - start;
+
+  if (calibrate)
+    *nbytes_read = cal->nbytes_read;
+  else
+    *nbytes_read = input->nbytes_read + input_b6->nbytes_read;
+
+  free(line);
+  free(qa_line);
+  CloseInput(input);
+  CloseInput(input_b6);
+  FreeInput(input);
+  FreeInput(input_b6);
+  if (calibrate) {
+    CloseCal(cal);
+    FreeCal(cal);
+  }
+  return true;
+}
+
+
+int main(int argc, char *argv[])
+{
+  Espa_internal_meta_t meta;
+  Espa_global_meta_t *gmeta = &meta.global;
+  char dir[256];
+  char *tmpdir = NULL;
+  char *toa_names[] = {"toa_band1", "toa_band2", "toa_band3", "toa_band4",
+    "toa_band5", "toa_band7"};
+  int nlines = BENCH_NLINES, nsamps = BENCH_NSAMPS;
+  int ib;
+  long long npix;
+  long long nbytes_written, nbytes_toa, nbytes_cal;
+  double time_toa, time_cal;
+  double gb = 1.0e9;
+  bool ok;
+
+  if (argc != 1 && argc != 3) {
+    printf("Usage: bench_io [nlines nsamps]\n");
+    return EXIT_FAILURE;
+  }
+  if (argc == 3) {
+    nlines = atoi(argv[1]);
+    nsamps = atoi(argv[2]);
+  }
+  npix = (long long)nlines * nsamps;
+
+  tmpdir = getenv("TMPDIR");
+  snprintf(dir, sizeof(dir), "%s/bench_io_XXXXXX",
+    tmpdir != NULL ? tmpdir : "/tmp");
+  if (mkdtemp(dir) == NULL) {
+    printf("bench_io: creating the bench directory\n");
+    return EXIT_FAILURE;
+  }
+
+  /* Metadata of the synthetic TM scene */
+  memset(&meta, 0, sizeof(meta));
+  strcpy(gmeta->satellite, "LANDSAT_5");
+  strcpy(gmeta->instrument, "TM");
+  strcpy(gmeta->acquisition_date, "1995-07-14");
+  strcpy(gmeta->scene_center_time, "17:02:11.000000Z");
+  gmeta->solar_zenith = 40.0;
+  gmeta->solar_azimuth = 130.0;
+  gmeta->wrs_system = 2;
+  gmeta->wrs_path = 30;
+  gmeta->wrs_row = 30;
+  meta.nbands = NBAND_META;
+  meta.band = calloc(NBAND_META, sizeof(Espa_band_meta_t));
+  if (meta.band == NULL) {
+    printf("bench_io: allocating the band metadata\n");
+    return EXIT_FAILURE;
+  }
+  for (ib = 0; ib < NBAND_L1; ib++) {
+    char name[8];
+
+    sprintf(name, "b%d", ib + 1);
+    set_band(&meta.band[ib], dir, "L1TP", name, nlines, nsamps);
+    meta.band[ib].refl_gain = 0.0012 + 0.0001 * ib;
+    meta.band[ib].refl_bias = -0.005;
+  }
+  meta.band[CAL_BAND_TH - 1].rad_gain = 0.055;
+  meta.band[CAL_BAND_TH - 1].rad_bias = 1.18;
+  meta.band[CAL_BAND_TH - 1].k1_const = 607.76;
+  meta.band[CAL_BAND_TH - 1].k2_const = 1260.56;
+  set_band(&meta.band[NBAND_L1], dir, "angle_bands", "solar_zenith_band4",
+    nlines, nsamps);
+  for (ib = 0; ib < NBAND_REFL_MAX; ib++)
+    set_band(&meta.band[NBAND_L1 + 1 + ib], dir, "toa_refl", toa_names[ib],
+      nlines, nsamps);
+  set_band(&meta.band[NBAND_L1 + 1 + NBAND_REFL_MAX], dir, "toa_refl",
+    "radsat_qa", nlines, nsamps);
+  set_band(&meta.band[NBAND_L1 + 2 + NBAND_REFL_MAX], dir, "toa_bt",
+    "bt_band6", nlines, nsamps);
+
+  ok = write_level1(&meta, nlines, nsamps) &&
+       write_toa(&meta, nlines, nsamps, &nbytes_written) &&
+       read_passes(&meta, false, &nbytes_toa, &time_toa) &&
+       read_passes(&meta, true, &nbytes_cal, &time_cal);
+
+  for (ib = 0; ib < NBAND_META; ib++)
+    unlink(meta.band[ib].file_name);
+  rmdir(dir);
+  free(meta.band);
+  if (!ok) {
+    printf("bench_io: FAILED\n");
+    return EXIT_FAILURE;
+  }
+
+  printf("bench_io: %d x %d TM scene\n", nlines, nsamps);
+  printf("  lndcal TOA products written: %lld bytes (%.1f per pixel, "
+    "%.2f GB)\n", nbytes_written, (double)nbytes_written / npix,
+    nbytes_written / gb);
+  printf("  lndsr reading the TOA products: %lld bytes (%.1f per pixel, "
+    "%.2f GB) in %.2f s\n", nbytes_toa, (double)nbytes_toa / npix,
+    nbytes_toa / gb, time_toa);
+  printf("  lndsr --calibrate reading the Level-1 bands: %lld bytes "
+    "(%.1f per pixel, %.2f GB) in %.2f s\n", nbytes_cal,
+    (double)nbytes_cal / npix, nbytes_cal / gb, time_cal);
+  return EXIT_SUCCESS;
+}
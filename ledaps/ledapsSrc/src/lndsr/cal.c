@@ -0,0 +1,492 @@
+/*
+!C****************************************************************************
+
+!File: cal.c
+
+!Description: Functions calibrating the Level-1 bands to TOA reflectance and
+ brightness temperature as they are read, so lndsr can run directly on the
+ Level-1 product without the lndcal TOA products being written and read back.
+
+!Team Unique Header:
+
+ ! Design Notes:
+   1. The following public functions handle the calibration:
+
+	OpenCal - Setup 'cal' data structure and open the Level-1 files.
+	GetCalLine - Get a line of a TOA reflectance or thermal band.
+	GetCalQALine - Get a line of the radiometric saturation QA band.
+	CloseCal - Close the Level-1 files.
+	FreeCal - Free the 'cal' data structure memory.
+
+   2. The calibration is that of lndcal (cal.c and lndcal.c) using the TOA
+      reflectance gains/biases, K1/K2 constants, and the per-pixel solar
+      zenith band, so the values are the same as those of the lndcal TOA
+      and radiometric saturation QA bands.  The hard-coded coefficients
+      lndcal falls back on for older Level-1 products aren't supported;
+      those products need to go through lndcal.
+   3. Every band of a line is calibrated when any band of the line is
+      requested, since a pixel which is fill in one band is fill in all of
+      them.  The line is held until another line is requested, so reading
+      all of the bands of a line, its QA, and its thermal band reads each
+      Level-1 file once.
+
+!END****************************************************************************
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "cal.h"
+#include "error.h"
+
+/* Functions */
+Cal_t *OpenCal(Espa_internal_meta_t *metadata)
+/*
+!C******************************************************************************
+
+!Description: 'OpenCal' sets up the 'cal' data structure from the Level-1
+ bands in the XML metadata and opens the Level-1 raw binary files for read
+ access.
+
+!Input Parameters:
+ metadata     'Espa_internal_meta_t' data structure with XML info
+
+!Output Parameters:
+ (returns)      'cal' data structure or NULL when an error occurs
+
+!Team Unique Header:
+
+!END****************************************************************************
+*/
+{
+  Cal_t *this = NULL;
+  Espa_band_meta_t *bmeta = NULL;
+  char *file_name[NBAND_REFL_MAX];
+  char *file_name_th = NULL;
+  char *file_name_sun_zen = NULL;
+  char *th_name = NULL;
+  char band_name[STR_SIZE];
+  char *error_string = (char *)NULL;
+  int refl_indx = -1;
+  int ib, i;
+  size_t nsamps;
+
+  if (!strcmp (metadata->global.instrument, "TM"))
+    th_name = "b6";
+  else if (!strncmp (metadata->global.instrument, "ETM", 3))
+    th_name = "b61";
+  else
+    RETURN_ERROR("invalid instrument", "OpenCal", NULL);
+
+  /* Create the Cal data structure */
+  this = (Cal_t *)malloc(sizeof(Cal_t));
+  if (this == NULL)
+    RETURN_ERROR("allocating Cal data structure", "OpenCal", NULL);
+
+  this->nband = NBAND_REFL_MAX;
+  this->iband[0] = 1;
+  this->iband[1] = 2;
+  this->iband[2] = 3;
+  this->iband[3] = 4;
+  this->iband[4] = 5;
+  this->iband[5] = 7;
+  for (ib = 0; ib < this->nband; ib++) {
+    file_name[ib] = NULL;
+    this->fp_bin[ib] = NULL;
+  }
+  this->fp_bin_th = NULL;
+  this->fp_bin_sun_zen = NULL;
+  this->iline = -1;
+  this->nbytes_read = 0;
+
+  /* Find the Level-1 bands and their gains/biases in the XML file */
+  for (i = 0; i < metadata->nbands; i++) {
+    bmeta = &metadata->band[i];
+    if (!strcmp (bmeta->name, "solar_zenith_band4")) {
+      file_name_sun_zen = bmeta->file_name;
+      continue;
+    }
+    if (strncmp (bmeta->product, "L1", 2))
+      continue;
+
+    if (!strcmp (bmeta->name, th_name)) {
+      file_name_th = bmeta->file_name;
+      this->rad_gain_th = bmeta->rad_gain;
+      this->rad_bias_th = bmeta->rad_bias;
+      this->k1 = bmeta->k1_const;
+      this->k2 = bmeta->k2_const;
+      continue;
+    }
+
+    for (ib = 0; ib < this->nband; ib++) {
+      sprintf (band_name, "b%d", this->iband[ib]);
+      if (!strcmp (bmeta->name, band_name)) {
+        file_name[ib] = bmeta->file_name;
+        this->refl_gain[ib] = bmeta->refl_gain;
+        this->refl_bias[ib] = bmeta->refl_bias;
+        if (ib == 0)
+          refl_indx = i;
+      }
+    }
+  }
+
+  for (ib = 0; ib < this->nband; ib++) {
+    if (file_name[ib] == NULL)
+      error_string = "finding the Level-1 reflectance bands in the XML file";
+    else if (fabs (this->refl_gain[ib] - ESPA_FLOAT_META_FILL) <
+               ESPA_EPSILON ||
+             fabs (this->refl_bias[ib] - ESPA_FLOAT_META_FILL) <
+               ESPA_EPSILON)
+      error_string = "the TOA reflectance gains and biases aren't in the "
+        "XML file; run lndcal for this product";
+  }
+  if (file_name_th == NULL)
+    error_string = "finding the Level-1 thermal band in the XML file";
+  else if (fabs (this->k1 - ESPA_FLOAT_META_FILL) < ESPA_EPSILON ||
+           fabs (this->k2 - ESPA_FLOAT_META_FILL) < ESPA_EPSILON)
+    error_string = "the K1/K2 thermal constants aren't in the XML file; run "
+      "lndcal for this product";
+  if (file_name_sun_zen == NULL)
+    error_string = "finding the representative solar zenith band in the XML "
+      "file";
+  if (error_string != NULL) {
+    free(this);
+    RETURN_ERROR(error_string, "OpenCal", NULL);
+  }
+
+  this->size.s = metadata->band[refl_indx].nsamps;
+  this->size.l = metadata->band[refl_indx].nlines;
+  nsamps = (size_t)this->size.s;
+
+  /* Allocate the line buffers */
+  this->dn_buf = calloc(nsamps * (this->nband + 1), sizeof(uint8));
+  this->qa_buf = calloc(nsamps, sizeof(uint8));
+  this->sun_zen_buf = calloc(nsamps, sizeof(int16));
+  this->refl_buf = calloc(nsamps * (this->nband + 1), sizeof(int16));
+  if (this->dn_buf == NULL || this->qa_buf == NULL ||
+      this->sun_zen_buf == NULL || this->refl_buf == NULL) {
+    free(this->dn_buf);
+    free(this->qa_buf);
+    free(this->sun_zen_buf);
+    free(this->refl_buf);
+    free(this);
+    RETURN_ERROR("allocating line buffers", "OpenCal", NULL);
+  }
+  this->dn_th_buf = &this->dn_buf[nsamps * this->nband];
+  this->th_buf = &this->refl_buf[nsamps * this->nband];
+
+  /* Open the Level-1 files for access */
+  for (ib = 0; ib < this->nband; ib++) {
+    this->fp_bin[ib] = fopen(file_name[ib], "r");
+    if (this->fp_bin[ib] == NULL)
+      error_string = "opening Level-1 binary file";
+  }
+  this->fp_bin_th = fopen(file_name_th, "r");
+  if (this->fp_bin_th == NULL)
+    error_string = "opening Level-1 thermal binary file";
+  this->fp_bin_sun_zen = fopen(file_name_sun_zen, "r");
+  if (this->fp_bin_sun_zen == NULL)
+    error_string = "opening solar zenith binary file";
+
+  if (error_string != NULL) {
+    CloseCal(this);
+    FreeCal(this);
+    RETURN_ERROR(error_string, "OpenCal", NULL);
+  }
+
+  printf("Calibrating the Level-1 bands as they are read (TOA reflectance "
+    "gains/biases, K1/K2 constants, and per-pixel solar zenith)\n");
+
+  return this;
+}
+
+
+static bool ReadCalLine(Cal_t *this, FILE *fp, int iline, void *line,
+                        size_t size)
+/*
+!C******************************************************************************
+
+!Description: 'ReadCalLine' reads a line of one of the Level-1 files.
+
+!END****************************************************************************
+*/
+{
+  long loc;
+
+  loc = (long)iline * this->size.s * size;
+  if (fseek(fp, loc, SEEK_SET))
+    RETURN_ERROR("error seeking line (binary)", "ReadCalLine", false);
+  if (fread(line, size, (size_t)this->size.s, fp) != (size_t)this->size.s)
+    RETURN_ERROR("error reading line (binary)", "ReadCalLine", false);
+  this->nbytes_read += (long long)this->size.s * size;
+
+  return true;
+}
+
+
+static bool CalLine(Cal_t *this, int iline)
+/*
+!C******************************************************************************
+
+!Description: 'CalLine' reads a line of the Level-1 files and calibrates
+ every band of the line, unless the line is already held.
+
+!Input Parameters:
+ this           'cal' data structure
+ iline          line to calibrate
+
+!Output Parameters:
+ this           'cal' data structure; the following fields are modified:
+                   iline, dn_buf, sun_zen_buf, refl_buf, qa_buf
+ (returns)      status:
+                  'true' = okay
+		  'false' = error return
+
+!Team Unique Header:
+
+ ! Design Notes:
+   1. The QA is flagged, and the bands calibrated, as in lndcal: a pixel
+      which is fill in the thermal band or any reflectance band is fill in
+      all bands.
+
+!END****************************************************************************
+*/
+{
+  int nsamp = this->size.s;
+  int is, ib, jb, val, num_zero;
+  int16 *out = NULL;
+  float fval, rad, ref, temp;
+  float sun_zen;
+  double cos_sun_zen;
+
+  if (iline == this->iline)
+    return true;
+  this->iline = -1;
+
+  for (ib = 0; ib < this->nband; ib++) {
+    if (!ReadCalLine(this, this->fp_bin[ib], iline, &this->dn_buf[ib*nsamp],
+                     sizeof(uint8)))
+      RETURN_ERROR("reading Level-1 data for a line", "CalLine", false);
+  }
+  if (!ReadCalLine(this, this->fp_bin_th, iline, this->dn_th_buf,
+                   sizeof(uint8)))
+    RETURN_ERROR("reading Level-1 thermal data for a line", "CalLine", false);
+  if (!ReadCalLine(this, this->fp_bin_sun_zen, iline, this->sun_zen_buf,
+                   sizeof(int16)))
+    RETURN_ERROR("reading solar zenith data for a line", "CalLine", false);
+
+  /* Flag fill and saturated pixels */
+  for (is = 0; is < nsamp; is++) {
+    val = this->dn_th_buf[is];
+    if (val == CAL_IN_FILL) {
+      this->qa_buf[is] = CAL_QA_FILL;
+      continue;
+    }
+    this->qa_buf[is] = (val >= CAL_SATU_VAL6) ? CAL_QA_SATU6 : 0;
+
+    num_zero = 0;
+    for (ib = 0; ib < this->nband; ib++) {
+      jb = (ib != 5) ? ib + 1 : ib + 2;
+      val = this->dn_buf[ib*nsamp + is];
+      if (val == CAL_IN_FILL) num_zero++;
+      if (val == CAL_SATU_VAL) this->qa_buf[is] |= (0x01 << jb);
+    }
+    if (num_zero > 0) this->qa_buf[is] = CAL_QA_FILL;
+  }
+
+  /* TOA reflectance; the solar zenith is the same for every band */
+  for (is = 0; is < nsamp; is++) {
+    sun_zen = this->sun_zen_buf[is] * 0.01 * RAD;
+    cos_sun_zen = cos (sun_zen);
+    for (ib = 0; ib < this->nband; ib++) {
+      out = &this->refl_buf[ib*nsamp + is];
+      val = this->dn_buf[ib*nsamp + is];
+      if (val == CAL_IN_FILL || this->qa_buf[is] == CAL_QA_FILL) {
+        *out = CAL_OUT_FILL;
+        continue;
+      }
+      if (val == CAL_SATU_VAL) {
+        *out = CAL_OUT_SATU;
+        continue;
+      }
+
+      fval = (float)val;
+      ref = ((this->refl_gain[ib] * fval) + this->refl_bias[ib]) /
+        cos_sun_zen;
+      *out = (int16)(ref * 10000.0 + 0.5);
+      if (*out < CAL_VALID_MIN_REF)
+        *out = CAL_VALID_MIN_REF;
+      else if (*out > CAL_VALID_MAX_REF)
+        *out = CAL_VALID_MAX_REF;
+    }
+  }
+
+  /* TOA brightness temperature */
+  for (is = 0; is < nsamp; is++) {
+    val = this->dn_th_buf[is];
+    if (val == CAL_IN_FILL || this->qa_buf[is] == CAL_QA_FILL) {
+      this->th_buf[is] = CAL_OUT_FILL;
+      continue;
+    }
+    if (val >= CAL_SATU_VAL6) {
+      this->th_buf[is] = CAL_OUT_SATU;
+      continue;
+    }
+
+    rad = (this->rad_gain_th * (float)val) + this->rad_bias_th;
+    temp = this->k2 / log(1.0 + (this->k1/rad));
+    this->th_buf[is] = (int16)(temp * 10.0 + 0.5);
+    if (this->th_buf[is] < CAL_VALID_MIN_TH)
+      this->th_buf[is] = CAL_VALID_MIN_TH;
+    else if (this->th_buf[is] > CAL_VALID_MAX_TH)
+      this->th_buf[is] = CAL_VALID_MAX_TH;
+  }
+
+  this->iline = iline;
+  return true;
+}
+
+
+bool GetCalLine(Cal_t *this, int iband, int iline, int16 *line)
+/*
+!C******************************************************************************
+
+!Description: 'GetCalLine' gets a line of a TOA reflectance band, or of the
+ TOA brightness temperature.
+
+!Input Parameters:
+ this           'cal' data structure
+ iband          band number (Input_meta_t iband); CAL_BAND_TH for the
+                thermal band
+ iline          line to get
+
+!Output Parameters:
+ line           line of the band
+ (returns)      status:
+                  'true' = okay
+		  'false' = error return
+
+!Team Unique Header:
+
+!END****************************************************************************
+*/
+{
+  int ib;
+
+  if (this == NULL)
+    RETURN_ERROR("invalid cal structure", "GetCalLine", false);
+  if (iline < 0 || iline >= this->size.l)
+    RETURN_ERROR("line number out of range", "GetCalLine", false);
+
+  if (!CalLine(this, iline))
+    return false;
+
+  if (iband == CAL_BAND_TH) {
+    memcpy(line, this->th_buf, this->size.s * sizeof(int16));
+    return true;
+  }
+
+  for (ib = 0; ib < this->nband; ib++) {
+    if (this->iband[ib] == iband) {
+      memcpy(line, &this->refl_buf[ib * this->size.s],
+        this->size.s * sizeof(int16));
+      return true;
+    }
+  }
+
+  RETURN_ERROR("band number out of range", "GetCalLine", false);
+}
+
+
+bool GetCalQALine(Cal_t *this, int iline, uint8 *line)
+/*
+!C******************************************************************************
+
+!Description: 'GetCalQALine' gets a line of the radiometric saturation QA.
+
+!END****************************************************************************
+*/
+{
+  if (this == NULL)
+    RETURN_ERROR("invalid cal structure", "GetCalQALine", false);
+  if (iline < 0 || iline >= this->size.l)
+    RETURN_ERROR("line number out of range", "GetCalQALine", false);
+
+  if (!CalLine(this, iline))
+    return false;
+
+  memcpy(line, this->qa_buf, this->size.s * sizeof(uint8));
+  return true;
+}
+
+
+bool CloseCal(Cal_t *this)
+/*
+!C******************************************************************************
+
+!Description: 'CloseCal' closes the Level-1 files.
+
+!Input Parameters:
+ this           'cal' data structure
+
+!Output Parameters:
+ (returns)      status:
+                  'true' = okay (always returned)
+
+!Team Unique Header:
+
+!END****************************************************************************
+*/
+{
+  int ib;
+
+  if (this == NULL)
+    RETURN_ERROR("invalid cal structure", "CloseCal", false);
+
+  for (ib = 0; ib < this->nband; ib++) {
+    if (this->fp_bin[ib] != NULL) {
+      fclose(this->fp_bin[ib]);
+      this->fp_bin[ib] = NULL;
+    }
+  }
+  if (this->fp_bin_th != NULL) {
+    fclose(this->fp_bin_th);
+    this->fp_bin_th = NULL;
+  }
+  if (this->fp_bin_sun_zen != NULL) {
+    fclose(this->fp_bin_sun_zen);
+    this->fp_bin_sun_zen = NULL;
+  }
+
+  return true;
+}
+
+
+bool FreeCal(Cal_t *this)
+/*
+!C******************************************************************************
+
+!Description: 'FreeCal' frees the 'cal' data structure memory.
+
+!Input Parameters:
+ this           'cal' data structure
+
+!Output Parameters:
+ (returns)      status:
+                  'true' = okay (always returned)
+
+!Team Unique Header:
+
+!END****************************************************************************
+*/
+{
+  if (this != NULL) {
+    free(this->dn_buf);
+    free(this->qa_buf);
+    free(this->sun_zen_buf);
+    free(this->refl_buf);
+    free(this);
+  }
+
+  return true;
+}
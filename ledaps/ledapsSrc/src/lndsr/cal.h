@@ -0,0 +1,61 @@
+#ifndef CAL_H
+#define CAL_H
+
+#include <stdio.h>
+#include "lndsr.h"
+#include "bool.h"
+#include "const.h"
+
+/* Level-1 values and TOA scaling used by lndcal, so the bands calibrated here
+   are the same as the lndcal TOA products */
+#define CAL_IN_FILL (0)
+#define CAL_SATU_VAL (255)
+#define CAL_SATU_VAL6 (254)
+#define CAL_QA_FILL (1)
+#define CAL_QA_SATU6 (0x01 << 6)
+#define CAL_OUT_FILL (-9999)
+#define CAL_OUT_SATU (20000)
+#define CAL_VALID_MIN_REF (-100)
+#define CAL_VALID_MAX_REF (16000)
+#define CAL_VALID_MIN_TH (1500)
+#define CAL_VALID_MAX_TH (3500)
+
+/* Band number of the thermal band, as in Input_meta_t iband */
+#define CAL_BAND_TH (6)
+
+/* Structure for the 'cal' data type, which calibrates the Level-1 bands to
+   TOA reflectance and brightness temperature a line at a time as they are
+   read, in place of the lndcal TOA products */
+
+typedef struct {
+  int nband;               /* Number of reflectance bands */
+  int iband[NBAND_REFL_MAX];  /* Reflectance band numbers */
+  Img_coord_int_t size;    /* Level-1 band size */
+  FILE *fp_bin[NBAND_REFL_MAX];  /* Level-1 reflectance band files */
+  FILE *fp_bin_th;         /* Level-1 thermal band file */
+  FILE *fp_bin_sun_zen;    /* Representative per-pixel solar zenith file */
+  float refl_gain[NBAND_REFL_MAX];  /* TOA reflectance band gain */
+  float refl_bias[NBAND_REFL_MAX];  /* TOA reflectance band bias */
+  float rad_gain_th;       /* Thermal TOA radiance band gain */
+  float rad_bias_th;       /* Thermal TOA radiance band bias */
+  float k1;                /* K1 thermal constant */
+  float k2;                /* K2 thermal constant */
+  int iline;               /* Line held in the buffers; -1 for none */
+  uint8 *dn_buf;           /* Level-1 reflectance bands for the line */
+  uint8 *dn_th_buf;        /* Level-1 thermal band for the line */
+  int16 *sun_zen_buf;      /* Solar zenith (degrees * 100) for the line */
+  int16 *refl_buf;         /* TOA reflectance bands for the line */
+  int16 *th_buf;           /* TOA brightness temperature for the line */
+  uint8 *qa_buf;           /* Radiometric saturation QA for the line */
+  long long nbytes_read;   /* Bytes read from the Level-1 files */
+} Cal_t;
+
+/* Prototypes */
+
+Cal_t *OpenCal(Espa_internal_meta_t *metadata);
+bool GetCalLine(Cal_t *this, int iband, int iline, int16 *line);
+bool GetCalQALine(Cal_t *this, int iline, uint8 *line);
+bool CloseCal(Cal_t *this);
+bool FreeCal(Cal_t *this);
+
+#endif
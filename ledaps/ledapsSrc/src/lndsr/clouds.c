@@ -14,19 +14,20 @@ int free_mem_atmos_coeff(atmos_t *atmos_coef);
 void SrInterpAtmCoef (Lut_t *lut, Img_coord_int_t *input_loc, atmos_t *atmos_coef, atmos_t *interpol_atmos_coef);
 
 
-bool cloud_detection_pass1
+static void cloud_detection_pass1_pixel
 (
     Lut_t *lut,              /* I: lookup table informat */
-    int nsamp,               /* I: number of samples to be processed */
     int il,                  /* I: current line being processed */
+    int is,                  /* I: current sample being processed */
     int16 **line_in,         /* I: array of input lines, one for each band */
     uint8 *qa_line,          /* I: array of QA data for the current line */
     int16 *b6_line,          /* I: array of thermal data for the current line */
     float *atemp_line,       /* I: auxiliary temperature for the line */
+    atmos_t *interpol_atmos_coef, /* I/O: buffer for the interpolated
+                                    atmospheric coefficients */
     cld_diags_t *cld_diags   /* I/O: cloud diagnostics (stats are updated) */
 )
 {
-    int is;                   /* current sample in the line */
     bool is_fill;             /* is the current pixel fill */
     float tmpflt;             /* temporary floating point value */
     float rho1, rho3, rho4, rho5, rho7, t6;  /* reflectance and temp values */
@@ -35,154 +36,199 @@ bool cloud_detection_pass1
     int cld_row, cld_col;     /* cloud line, sample location */
     float vra, ndvi;          /* NDVI value */
     Img_coord_int_t loc;      /* line/sample location for current pix */
-    atmos_t interpol_atmos_coef; /* interpolated atmospheric coefficients,
-                                    based on the current line/sample location
-                                    in the aerosol data grid */
 
-    /* Allocate memory for the interpolated atmospheric coefficients and
-       start the location for the current line and current cloud row */
-    allocate_mem_atmos_coeff (1, &interpol_atmos_coef);
     loc.l = il;
+    loc.s = is;
     cld_row = il / cld_diags->cellheight;
-
-    /* Loop through the samples in this line */
-    for (is = 0; is < nsamp; is++) {
-        loc.s = is;
-        cld_col = is / cld_diags->cellwidth;
-
-        if ((qa_line[is]&0x01)==0x01)
-            is_fill=true;
-        else
-            is_fill=false;
-
-        if (!is_fill) {
-            if (((qa_line[is] & 0x08) == 0x00) ||
-              ((lut->meta.inst == INST_TM) && (line_in[2][is] < 5000)))
-            { /* no saturation in band 3 */
-                /* Interpolate the atmospheric coefficients for the current
-                   pixel */
-                SrInterpAtmCoef(lut, &loc, &atmos_coef, &interpol_atmos_coef);
-
-                /* Compute the reflectance for each band using the interpolated
-                   atmospheric coefficients */
-                rho1=line_in[0][is] * 0.0001;
-                rho1= (rho1/interpol_atmos_coef.tgOG[0][0] -
-                    interpol_atmos_coef.rho_ra[0][0]);
-                tmpflt = (interpol_atmos_coef.tgH2O[0][0] *
-                    interpol_atmos_coef.td_ra[0][0] *
-                    interpol_atmos_coef.tu_ra[0][0]);
-                rho1 /= tmpflt;
-                rho1 /= (1. + interpol_atmos_coef.S_ra[0][0] * rho1);
-
-                rho3 = line_in[2][is] * 0.0001;
-                rho3 = (rho3 / interpol_atmos_coef.tgOG[2][0] -
-                    interpol_atmos_coef.rho_ra[2][0]);
-                tmpflt = (interpol_atmos_coef.tgH2O[2][0] *
-                    interpol_atmos_coef.td_ra[2][0] *
-                    interpol_atmos_coef.tu_ra[2][0]);
-                rho3 /= tmpflt;
-                rho3 /= (1. + interpol_atmos_coef.S_ra[2][0] * rho3);
-
-                rho4 = line_in[3][is] * 0.0001;
-                rho4 = (rho4 / interpol_atmos_coef.tgOG[3][0] -
-                    interpol_atmos_coef.rho_ra[3][0]);
-                tmpflt = (interpol_atmos_coef.tgH2O[3][0] *
-                    interpol_atmos_coef.td_ra[3][0] *
-                    interpol_atmos_coef.tu_ra[3][0]);
-                rho4 /= tmpflt;
-                rho4 /= (1. + interpol_atmos_coef.S_ra[3][0] * rho4);
-
-                rho5 = line_in[4][is] * 0.0001;
-                rho5 = (rho5 / interpol_atmos_coef.tgOG[4][0] -
-                    interpol_atmos_coef.rho_ra[4][0]);
-                tmpflt = (interpol_atmos_coef.tgH2O[4][0] *
-                    interpol_atmos_coef.td_ra[4][0] *
-                    interpol_atmos_coef.tu_ra[4][0]);
-                rho5 /= tmpflt;
-                rho5 /= (1. + interpol_atmos_coef.S_ra[4][0] * rho5);
-
-                rho7 = line_in[5][is] * 0.0001;
-                rho7 = (rho7 / interpol_atmos_coef.tgOG[5][0] -
-                    interpol_atmos_coef.rho_ra[5][0]);
-                tmpflt = (interpol_atmos_coef.tgH2O[5][0] *
-                    interpol_atmos_coef.td_ra[5][0] *
-                    interpol_atmos_coef.tu_ra[5][0]);
-                rho7 /= tmpflt;
-                rho7 /= (1. + interpol_atmos_coef.S_ra[5][0] * rho7);
-
-                /* Get the temperature */
-                t6 = b6_line[is] * 0.1;
-
-                /* Compute cloud coefficients */
-                vra = rho1 - rho3 * 0.5;
-                    
-                C1 = (int)(vra > VRA_THRESHOLD);
-                C2 = (t6 < (atemp_line[is]-7.));  
+    cld_col = is / cld_diags->cellwidth;
+
+    if ((qa_line[is]&0x01)==0x01)
+        is_fill=true;
+    else
+        is_fill=false;
+
+    if (!is_fill) {
+        if (((qa_line[is] & 0x08) == 0x00) ||
+          ((lut->meta.inst == INST_TM) && (line_in[2][is] < 5000)))
+        { /* no saturation in band 3 */
+            /* Interpolate the atmospheric coefficients for the current
+               pixel */
+            SrInterpAtmCoef(lut, &loc, &atmos_coef, interpol_atmos_coef);
+
+            /* Compute the reflectance for each band using the interpolated
+               atmospheric coefficients */
+            rho1=line_in[0][is] * 0.0001;
+            rho1= (rho1/interpol_atmos_coef->tgOG[0][0] -
+                interpol_atmos_coef->rho_ra[0][0]);
+            tmpflt = (interpol_atmos_coef->tgH2O[0][0] *
+                interpol_atmos_coef->td_ra[0][0] *
+                interpol_atmos_coef->tu_ra[0][0]);
+            rho1 /= tmpflt;
+            rho1 /= (1. + interpol_atmos_coef->S_ra[0][0] * rho1);
+
+            rho3 = line_in[2][is] * 0.0001;
+            rho3 = (rho3 / interpol_atmos_coef->tgOG[2][0] -
+                interpol_atmos_coef->rho_ra[2][0]);
+            tmpflt = (interpol_atmos_coef->tgH2O[2][0] *
+                interpol_atmos_coef->td_ra[2][0] *
+                interpol_atmos_coef->tu_ra[2][0]);
+            rho3 /= tmpflt;
+            rho3 /= (1. + interpol_atmos_coef->S_ra[2][0] * rho3);
+
+            rho4 = line_in[3][is] * 0.0001;
+            rho4 = (rho4 / interpol_atmos_coef->tgOG[3][0] -
+                interpol_atmos_coef->rho_ra[3][0]);
+            tmpflt = (interpol_atmos_coef->tgH2O[3][0] *
+                interpol_atmos_coef->td_ra[3][0] *
+                interpol_atmos_coef->tu_ra[3][0]);
+            rho4 /= tmpflt;
+            rho4 /= (1. + interpol_atmos_coef->S_ra[3][0] * rho4);
+
+            rho5 = line_in[4][is] * 0.0001;
+            rho5 = (rho5 / interpol_atmos_coef->tgOG[4][0] -
+                interpol_atmos_coef->rho_ra[4][0]);
+            tmpflt = (interpol_atmos_coef->tgH2O[4][0] *
+                interpol_atmos_coef->td_ra[4][0] *
+                interpol_atmos_coef->tu_ra[4][0]);
+            rho5 /= tmpflt;
+            rho5 /= (1. + interpol_atmos_coef->S_ra[4][0] * rho5);
+
+            rho7 = line_in[5][is] * 0.0001;
+            rho7 = (rho7 / interpol_atmos_coef->tgOG[5][0] -
+                interpol_atmos_coef->rho_ra[5][0]);
+            tmpflt = (interpol_atmos_coef->tgH2O[5][0] *
+                interpol_atmos_coef->td_ra[5][0] *
+                interpol_atmos_coef->tu_ra[5][0]);
+            rho7 /= tmpflt;
+            rho7 /= (1. + interpol_atmos_coef->S_ra[5][0] * rho7);
+
+            /* Get the temperature */
+            t6 = b6_line[is] * 0.1;
+
+            /* Compute cloud coefficients */
+            vra = rho1 - rho3 * 0.5;
+                
+            C1 = (int)(vra > VRA_THRESHOLD);
+            C2 = (t6 < (atemp_line[is]-7.));  
    
-                tmpflt = rho4 / rho3;
-                C3 = ((tmpflt >= 0.9) && (tmpflt <= 1.3));
-
-                C4 = (rho7 > 0.03);
-                C5 = ((rho3 > 0.6)||(rho4 > 0.6));
-                    
-                /**
-                Water test :
-                ndvi < 0 => water
-                ((0<ndvi<0.1) or (b4<5%)) and b5 < 0.01 => turbid water
-                **/
-                if (rho4 + rho3 != 0)
-                    ndvi = (rho4 - rho3) / (rho4 + rho3);
-                else
-                    ndvi = 0.01;
-                water = (ndvi < 0) || ((((ndvi > 0) && (ndvi < 0.1)) ||
-                    (rho4 < 0.05)) && (rho5 < 0.02));
+            tmpflt = rho4 / rho3;
+            C3 = ((tmpflt >= 0.9) && (tmpflt <= 1.3));
 
-                if (!water) { /* if not water */
-                    if ((t6 > (atemp_line[is] - 20.)) && (!C5)) { 
-                        if (!((C1||C3)&&C2&&C4)) { /* clear */
-                            cld_diags->avg_t6_clear[cld_row][cld_col] += t6;
-                            cld_diags->std_t6_clear[cld_row][cld_col] +=
-                                (t6*t6);
-                            cld_diags->avg_b7_clear[cld_row][cld_col] += rho7;
-                            cld_diags->std_b7_clear[cld_row][cld_col] +=
-                                (rho7*rho7);
-                            cld_diags->nb_t6_clear[cld_row][cld_col]++;
-                        }
+            C4 = (rho7 > 0.03);
+            C5 = ((rho3 > 0.6)||(rho4 > 0.6));
+                
+            /**
+            Water test :
+            ndvi < 0 => water
+            ((0<ndvi<0.1) or (b4<5%)) and b5 < 0.01 => turbid water
+            **/
+            if (rho4 + rho3 != 0)
+                ndvi = (rho4 - rho3) / (rho4 + rho3);
+            else
+                ndvi = 0.01;
+            water = (ndvi < 0) || ((((ndvi > 0) && (ndvi < 0.1)) ||
+                (rho4 < 0.05)) && (rho5 < 0.02));
+
+            if (!water) { /* if not water */
+                if ((t6 > (atemp_line[is] - 20.)) && (!C5)) { 
+                    if (!((C1||C3)&&C2&&C4)) { /* clear */
+                        cld_diags->avg_t6_clear[cld_row][cld_col] += t6;
+                        cld_diags->std_t6_clear[cld_row][cld_col] +=
+                            (t6*t6);
+                        cld_diags->avg_b7_clear[cld_row][cld_col] += rho7;
+                        cld_diags->std_b7_clear[cld_row][cld_col] +=
+                            (rho7*rho7);
+                        cld_diags->nb_t6_clear[cld_row][cld_col]++;
                     }
                 }
-            }  /* end if no saturation in band 3 */
-        }  /* end if !is_fill */ 
-    }  /* end for is */
+            }
+        }  /* end if no saturation in band 3 */
+    }  /* end if !is_fill */
+}
+
+
+bool cloud_detection_pass1
+(
+    Lut_t *lut,              /* I: lookup table informat */
+    int nsamp,               /* I: number of samples to be processed */
+    int il_start,            /* I: first line of the block being processed */
+    int nlines,              /* I: number of lines in the block */
+    int16 ***line_in,        /* I: array of input lines for each line of the
+                                   block, one for each band */
+    uint8 **qa_line,         /* I: array of QA data for each line of the
+                                   block */
+    int16 **b6_line,         /* I: array of thermal data for each line of the
+                                   block */
+    float **atemp_line,      /* I: auxiliary temperature for each line of the
+                                   block */
+    cld_diags_t *cld_diags   /* I/O: cloud diagnostics (stats are updated) */
+)
+/* The block is split among the threads by columns of the cloud diagnostic
+   cells.  Each cell is only updated by the thread with its column, which
+   adds in the pixels line by line in the same order as a single thread
+   would, so the stats don't depend on the number of threads and don't need
+   to be locked or merged. */
+{
+    int il, is;               /* current line and sample */
+    int is_start, is_end;     /* first and last+1 sample of the cloud column */
+    int cld_col;              /* cloud diagnostic column */
+    atmos_t interpol_atmos_coef; /* interpolated atmospheric coefficients,
+                                    based on the current line/sample location
+                                    in the aerosol data grid */
+
+#ifdef _OPENMP
+    #pragma omp parallel private (il, is, is_start, is_end, cld_col, interpol_atmos_coef)
+#endif
+    {
+    /* Allocate memory for the interpolated atmospheric coefficients, for
+       each thread */
+    allocate_mem_atmos_coeff (1, &interpol_atmos_coef);
+
+    /* Loop through the cloud columns, then the lines and samples of the
+       block in the column */
+#ifdef _OPENMP
+    #pragma omp for schedule (dynamic)
+#endif
+    for (cld_col = 0; cld_col < cld_diags->nbcols; cld_col++) {
+        is_start = cld_col * cld_diags->cellwidth;
+        is_end = is_start + cld_diags->cellwidth;
+        if (is_end > nsamp)
+            is_end = nsamp;
+
+        for (il = il_start; il < il_start + nlines; il++) {
+            for (is = is_start; is < is_end; is++) {
+                cloud_detection_pass1_pixel (lut, il, is,
+                    line_in[il - il_start], qa_line[il - il_start],
+                    b6_line[il - il_start], atemp_line[il - il_start],
+                    &interpol_atmos_coef, cld_diags);
+            }
+        }
+    }  /* end for cld_col */
 
     free_mem_atmos_coeff(&interpol_atmos_coef);
+    }  /* end of the parallel region */
+
     return true;
 }
 
 
-bool cloud_detection_pass2
+static void cloud_detection_pass2_pixel
 (
     Lut_t *lut,              /* I: lookup table informat */
-    int nsamp,               /* I: number of samples to be processed */
     int il,                  /* I: current line being processed */
+    int is,                  /* I: current sample being processed */
     int16 **line_in,         /* I: array of input lines, one for each band */
     uint8 *qa_line,          /* I: array of QA data for the current line */
-    int16 *b6_line,          /* I: array of thermal data for the current line */
+    int16 *b6_line,          /* I: array of thermal data for the current line;
+                                   NULL if there is no thermal band */
     cld_diags_t *cld_diags,  /* I: cloud diagnostics */
-    char *ddv_line           /* O: dark dense vegetation line */
-            /**
-            use ddv_line to store internal cloud screening info
-            bit 2 = adjacent cloud 1=yes 0=no
-            bit 3 = fill value 1=fill 0=valid
-            bit 4 = land/water mask 1=land 0=water
-            bit 5 = cloud 0=clear 1=cloudy
-            bit 6 = cloud shadow 
-            bit 7 = snow
-            **/
+    atmos_t *interpol_atmos_coef, /* I/O: buffer for the interpolated
+                                    atmospheric coefficients */
+    char *ddv_line           /* O: dark dense vegetation line (see
+                                   cloud_detection_pass2) */
 )
 {
-    int is;                   /* current sample in the line */
     bool is_fill;             /* is the current pixel fill */
-    int il_ar, is_ar;         /* line/sample in the aerosol region */
     bool thermal_band;        /* is thermal data available */
     float rho1, rho2, rho3, rho4, rho5, rho7;  /* reflectance & temp values */
     float t6 = 0.0;           /* temperature values */
@@ -193,9 +239,6 @@ bool cloud_detection_pass2
     float temp_b6_clear,temp_thshld1,temp_thshld2,atemp_ancillary;
     float tmpflt, tmpflt_arr[10];  /* temporary floats */
     Img_coord_int_t loc;      /* line/sample location for current pix */
-    atmos_t interpol_atmos_coef; /* interpolated atmospheric coefficients,
-                                    based on the current line/sample location
-                                    in the aerosol data grid */
 
     /* Initialize the thermal band information and snow threshold */
     thermal_band = true;
@@ -203,157 +246,38 @@ bool cloud_detection_pass2
         thermal_band = false;
     temp_snow_thshld = 380.;  /* now flag snow and possibly salt pan */
 
-    /* Allocate memory for the interpolated atmospheric coefficients and
-       start the location for the current line and current cloud row */
-    allocate_mem_atmos_coeff(1,&interpol_atmos_coef);
     loc.l = il;
+    loc.s = is;
     cld_row = il / cld_diags->cellheight;
+    cld_col = is / cld_diags->cellwidth;
 
-    /* Initialize the aerosol line location value */
-    il_ar = il / lut->ar_region_size.l;
-    if (il_ar >= lut->ar_size.l)
-        il_ar = lut->ar_size.l - 1;
-
-    /* Loop through the samples in this line */
-    for (is = 0; is < nsamp; is++) {
-        loc.s = is;
-        cld_col = is / cld_diags->cellwidth;
-        is_ar = is / lut->ar_region_size.s;
-        if (is_ar >= lut->ar_size.s)
-            is_ar = lut->ar_size.s - 1;
-
-        is_fill = false;
-        if (thermal_band) {
-            if (b6_line[is] == lut->in_fill) {
-                is_fill = true;
-                ddv_line[is] = 0x08;
-            }
-        }
-
-        if ((qa_line[is] & 0x01) == 0x01) {
+    is_fill = false;
+    if (thermal_band) {
+        if (b6_line[is] == lut->in_fill) {
             is_fill = true;
             ddv_line[is] = 0x08;
         }
+    }
 
-        if (! is_fill) {
-            ddv_line[is] &= 0x44; /* reset all bits except cloud shadow and
-                                     adjacent cloud */ 
-
-            if (((qa_line[is] & 0x08) == 0x08) ||
-                ((lut->meta.inst == INST_TM) &&
-                (line_in[2][is] >= 5000))) {  /* saturated band 3 */
-                if (thermal_band) {
-                    t6 = b6_line[is] * 0.1;
-
-                    /* Interpolate the cloud diagnostics for current pixel */
-                    interpol_clddiags_1pixel (cld_diags, il, is, tmpflt_arr);
-                    temp_b6_clear = tmpflt_arr[0];
-                    atemp_ancillary = tmpflt_arr[1];
-                    if (temp_b6_clear < 0.) {
-                        temp_thshld1 = atemp_ancillary - 20.;
-                        temp_thshld2 = atemp_ancillary - 20.;
-                    }
-                    else {
-                        if (cld_diags->std_t6_clear[cld_row][cld_col] > 0.) {
-                            temp_thshld1 = temp_b6_clear -
-                               (cld_diags->std_t6_clear[cld_row][cld_col] + 4.);
-                            temp_thshld2 = temp_b6_clear -
-                               cld_diags->std_t6_clear[cld_row][cld_col];
-                        }
-                        else {
-                            temp_thshld1 = temp_b6_clear - 4.;
-                            temp_thshld2 = temp_b6_clear - 2.;
-                        }
-                    }
+    if ((qa_line[is] & 0x01) == 0x01) {
+        is_fill = true;
+        ddv_line[is] = 0x08;
+    }
 
-                    if ((((qa_line[is] & 0x20) == 0x20) ||
-                         ((lut->meta.inst == INST_TM) &&
-                          (line_in[4][is] >= 5000))) && (t6 < temp_thshld1)) {
-                        /* saturated band 5 and t6 < threshold => cloudy */
-                        ddv_line[is] &= 0xbf; /* reset shadow bit */
-                        ddv_line[is] &= 0xfb; /* reset adjacent cloud bit */
-                        ddv_line[is] |= 0x20; /* set cloud bit */
-                    }
-                    else if ((line_in[4][is] < 2000) &&
-                             (t6 < temp_snow_thshld)) { /* snow */
-                        ddv_line[is] |= 0x80;
-                    }
-                    else { /* assume cloudy */
-                        ddv_line[is] &= 0xbf; /* reset shadow bit */
-                        ddv_line[is] &= 0xfb; /* reset adjacent cloud bit */
-                        ddv_line[is] |= 0x20; /* set cloud bit */
-                    }
-                }
-            }
-            else {
-                /* Interpolate the atmospheric conditions for current pixel */
-                SrInterpAtmCoef (lut, &loc, &atmos_coef, &interpol_atmos_coef);
-
-                /* Compute the reflectance for each band using the interpolated
-                   atmospheric coefficients */
-                rho1 = line_in[0][is] * 0.0001;
-                rho1 = (rho1/interpol_atmos_coef.tgOG[0][0] -
-                    interpol_atmos_coef.rho_ra[0][0]);
-                tmpflt = (interpol_atmos_coef.tgH2O[0][0] *
-                    interpol_atmos_coef.td_ra[0][0] *
-                    interpol_atmos_coef.tu_ra[0][0]);
-                rho1 /= tmpflt;
-                rho1 /= (1. + interpol_atmos_coef.S_ra[0][0] * rho1);
-
-                rho2 = line_in[1][is] * 0.0001;
-                rho2 = (rho2/interpol_atmos_coef.tgOG[1][0] -
-                    interpol_atmos_coef.rho_ra[1][0]);
-                tmpflt = (interpol_atmos_coef.tgH2O[1][0] *
-                    interpol_atmos_coef.td_ra[1][0] *
-                    interpol_atmos_coef.tu_ra[1][0]);
-                rho2 /= tmpflt;
-                rho2 /= (1. + interpol_atmos_coef.S_ra[1][0] * rho2);
-
-                rho3 = line_in[2][is] * 0.0001;
-                rho3 = (rho3 / interpol_atmos_coef.tgOG[2][0] -
-                    interpol_atmos_coef.rho_ra[2][0]);
-                tmpflt = (interpol_atmos_coef.tgH2O[2][0] *
-                    interpol_atmos_coef.td_ra[2][0] *
-                    interpol_atmos_coef.tu_ra[2][0]);
-                rho3 /= tmpflt;
-                rho3 /= (1. + interpol_atmos_coef.S_ra[2][0] * rho3);
-
-                rho4 = line_in[3][is] * 0.0001;
-                rho4 = (rho4 / interpol_atmos_coef.tgOG[3][0] -
-                    interpol_atmos_coef.rho_ra[3][0]);
-                tmpflt = (interpol_atmos_coef.tgH2O[3][0] *
-                    interpol_atmos_coef.td_ra[3][0] *
-                    interpol_atmos_coef.tu_ra[3][0]);
-                rho4 /= tmpflt;
-                rho4 /= (1. + interpol_atmos_coef.S_ra[3][0] * rho4);
-
-                rho5 = line_in[4][is] * 0.0001;
-                rho5 = (rho5 / interpol_atmos_coef.tgOG[4][0] -
-                    interpol_atmos_coef.rho_ra[4][0]);
-                tmpflt = (interpol_atmos_coef.tgH2O[4][0] *
-                    interpol_atmos_coef.td_ra[4][0] *
-                    interpol_atmos_coef.tu_ra[4][0]);
-                rho5 /= tmpflt;
-                rho5 /= (1. + interpol_atmos_coef.S_ra[4][0] * rho5);
-
-                rho7 = line_in[5][is] * 0.0001;
-                rho7 = (rho7 / interpol_atmos_coef.tgOG[5][0] -
-                    interpol_atmos_coef.rho_ra[5][0]);
-                tmpflt = (interpol_atmos_coef.tgH2O[5][0] *
-                    interpol_atmos_coef.td_ra[5][0] *
-                    interpol_atmos_coef.tu_ra[5][0]);
-                rho7 /= tmpflt;
-                rho7 /= (1. + interpol_atmos_coef.S_ra[5][0] * rho7);
-
-                /* Get the temperature */
-                if (thermal_band)
-                    t6 = b6_line[is] * 0.1;
-
-                /* Interpolate the cloud diagnostics for the current pixel */
+    if (! is_fill) {
+        ddv_line[is] &= 0x44; /* reset all bits except cloud shadow and
+                                 adjacent cloud */ 
+
+        if (((qa_line[is] & 0x08) == 0x08) ||
+            ((lut->meta.inst == INST_TM) &&
+            (line_in[2][is] >= 5000))) {  /* saturated band 3 */
+            if (thermal_band) {
+                t6 = b6_line[is] * 0.1;
+
+                /* Interpolate the cloud diagnostics for current pixel */
                 interpol_clddiags_1pixel (cld_diags, il, is, tmpflt_arr);
                 temp_b6_clear = tmpflt_arr[0];
                 atemp_ancillary = tmpflt_arr[1];
-
                 if (temp_b6_clear < 0.) {
                     temp_thshld1 = atemp_ancillary - 20.;
                     temp_thshld2 = atemp_ancillary - 20.;
@@ -361,9 +285,9 @@ bool cloud_detection_pass2
                 else {
                     if (cld_diags->std_t6_clear[cld_row][cld_col] > 0.) {
                         temp_thshld1 = temp_b6_clear -
-                            (cld_diags->std_t6_clear[cld_row][cld_col] + 4.);
+                           (cld_diags->std_t6_clear[cld_row][cld_col] + 4.);
                         temp_thshld2 = temp_b6_clear -
-                            cld_diags->std_t6_clear[cld_row][cld_col];
+                           cld_diags->std_t6_clear[cld_row][cld_col];
                     }
                     else {
                         temp_thshld1 = temp_b6_clear - 4.;
@@ -371,64 +295,228 @@ bool cloud_detection_pass2
                     }
                 }
 
-                if (thermal_band) {
-                    /* Compute cloud coefficients */
-                    vra = rho1 - rho3 * 0.5;
+                if ((((qa_line[is] & 0x20) == 0x20) ||
+                     ((lut->meta.inst == INST_TM) &&
+                      (line_in[4][is] >= 5000))) && (t6 < temp_thshld1)) {
+                    /* saturated band 5 and t6 < threshold => cloudy */
+                    ddv_line[is] &= 0xbf; /* reset shadow bit */
+                    ddv_line[is] &= 0xfb; /* reset adjacent cloud bit */
+                    ddv_line[is] |= 0x20; /* set cloud bit */
+                }
+                else if ((line_in[4][is] < 2000) &&
+                         (t6 < temp_snow_thshld)) { /* snow */
+                    ddv_line[is] |= 0x80;
+                }
+                else { /* assume cloudy */
+                    ddv_line[is] &= 0xbf; /* reset shadow bit */
+                    ddv_line[is] &= 0xfb; /* reset adjacent cloud bit */
+                    ddv_line[is] |= 0x20; /* set cloud bit */
+                }
+            }
+        }
+        else {
+            /* Interpolate the atmospheric conditions for current pixel */
+            SrInterpAtmCoef (lut, &loc, &atmos_coef, interpol_atmos_coef);
+
+            /* Compute the reflectance for each band using the interpolated
+               atmospheric coefficients */
+            rho1 = line_in[0][is] * 0.0001;
+            rho1 = (rho1/interpol_atmos_coef->tgOG[0][0] -
+                interpol_atmos_coef->rho_ra[0][0]);
+            tmpflt = (interpol_atmos_coef->tgH2O[0][0] *
+                interpol_atmos_coef->td_ra[0][0] *
+                interpol_atmos_coef->tu_ra[0][0]);
+            rho1 /= tmpflt;
+            rho1 /= (1. + interpol_atmos_coef->S_ra[0][0] * rho1);
+
+            rho2 = line_in[1][is] * 0.0001;
+            rho2 = (rho2/interpol_atmos_coef->tgOG[1][0] -
+                interpol_atmos_coef->rho_ra[1][0]);
+            tmpflt = (interpol_atmos_coef->tgH2O[1][0] *
+                interpol_atmos_coef->td_ra[1][0] *
+                interpol_atmos_coef->tu_ra[1][0]);
+            rho2 /= tmpflt;
+            rho2 /= (1. + interpol_atmos_coef->S_ra[1][0] * rho2);
+
+            rho3 = line_in[2][is] * 0.0001;
+            rho3 = (rho3 / interpol_atmos_coef->tgOG[2][0] -
+                interpol_atmos_coef->rho_ra[2][0]);
+            tmpflt = (interpol_atmos_coef->tgH2O[2][0] *
+                interpol_atmos_coef->td_ra[2][0] *
+                interpol_atmos_coef->tu_ra[2][0]);
+            rho3 /= tmpflt;
+            rho3 /= (1. + interpol_atmos_coef->S_ra[2][0] * rho3);
+
+            rho4 = line_in[3][is] * 0.0001;
+            rho4 = (rho4 / interpol_atmos_coef->tgOG[3][0] -
+                interpol_atmos_coef->rho_ra[3][0]);
+            tmpflt = (interpol_atmos_coef->tgH2O[3][0] *
+                interpol_atmos_coef->td_ra[3][0] *
+                interpol_atmos_coef->tu_ra[3][0]);
+            rho4 /= tmpflt;
+            rho4 /= (1. + interpol_atmos_coef->S_ra[3][0] * rho4);
+
+            rho5 = line_in[4][is] * 0.0001;
+            rho5 = (rho5 / interpol_atmos_coef->tgOG[4][0] -
+                interpol_atmos_coef->rho_ra[4][0]);
+            tmpflt = (interpol_atmos_coef->tgH2O[4][0] *
+                interpol_atmos_coef->td_ra[4][0] *
+                interpol_atmos_coef->tu_ra[4][0]);
+            rho5 /= tmpflt;
+            rho5 /= (1. + interpol_atmos_coef->S_ra[4][0] * rho5);
+
+            rho7 = line_in[5][is] * 0.0001;
+            rho7 = (rho7 / interpol_atmos_coef->tgOG[5][0] -
+                interpol_atmos_coef->rho_ra[5][0]);
+            tmpflt = (interpol_atmos_coef->tgH2O[5][0] *
+                interpol_atmos_coef->td_ra[5][0] *
+                interpol_atmos_coef->tu_ra[5][0]);
+            rho7 /= tmpflt;
+            rho7 /= (1. + interpol_atmos_coef->S_ra[5][0] * rho7);
+
+            /* Get the temperature */
+            if (thermal_band)
+                t6 = b6_line[is] * 0.1;
 
-                    C1 = (int)(vra > VRA_THRESHOLD);
-                    C2 = (t6 < temp_thshld1);
-   
-                    tmpflt = rho4 / rho3;
+            /* Interpolate the cloud diagnostics for the current pixel */
+            interpol_clddiags_1pixel (cld_diags, il, is, tmpflt_arr);
+            temp_b6_clear = tmpflt_arr[0];
+            atemp_ancillary = tmpflt_arr[1];
 
-                    C4 = (rho7 > 0.03);
-                    C5 = (t6 < temp_thshld2) && C1;
+            if (temp_b6_clear < 0.) {
+                temp_thshld1 = atemp_ancillary - 20.;
+                temp_thshld2 = atemp_ancillary - 20.;
+            }
+            else {
+                if (cld_diags->std_t6_clear[cld_row][cld_col] > 0.) {
+                    temp_thshld1 = temp_b6_clear -
+                        (cld_diags->std_t6_clear[cld_row][cld_col] + 4.);
+                    temp_thshld2 = temp_b6_clear -
+                        cld_diags->std_t6_clear[cld_row][cld_col];
                 }
-
-                /**
-                Water test :
-                ndvi < 0 => water
-                ((0<ndvi<0.1) or (b4<5%)) and b5 < 0.01 => turbid water
-                **/
-                if ((rho4 + rho3) != 0)
-                    ndvi = (rho4 - rho3) / (rho4 + rho3);
-                else
-                    ndvi = 0.01;
-                water = (ndvi < 0) || ((((ndvi > 0) && (ndvi < 0.1)) ||
-                    (rho4 < 0.05)) && (rho5 < 0.02));
-
-                if (thermal_band) {
-                    if (!water) { /* if not water */
-                        ddv_line[is] |= 0x10;
-                        if ((C2 || C5) && C4) { /* cloudy */
-                            ddv_line[is] &= 0xbf; /* reset shadow bit */
-                            ddv_line[is] &= 0xfb; /* reset adjacent cloud bit */
-                            ddv_line[is] |= 0x20; /* set cloud bit */
-                        }
-                        else { /* clear */
-                            ddv_line[is] &= 0xdf;
-                            ndsi = (rho2 - rho5) / (rho2 + rho5);
-                            if ((ndsi > 0.3) && (t6 < temp_snow_thshld) &&
-                                (rho4 > 0.2))
-                                ddv_line[is] |= 0x80;
-                        }
-                    }
-                    else 
-                        ddv_line[is] &= 0xef; 
+                else {
+                    temp_thshld1 = temp_b6_clear - 4.;
+                    temp_thshld2 = temp_b6_clear - 2.;
                 }
-                else { /* no thermal band - cannot run cloud mask */
-                    ddv_line[is] &= 0xdf; /* assume clear */
-                    if (!water) { /* if not water */
-                        ddv_line[is] |= 0x10;
+            }
+
+            if (thermal_band) {
+                /* Compute cloud coefficients */
+                vra = rho1 - rho3 * 0.5;
+
+                C1 = (int)(vra > VRA_THRESHOLD);
+                C2 = (t6 < temp_thshld1);
+   
+                tmpflt = rho4 / rho3;
+
+                C4 = (rho7 > 0.03);
+                C5 = (t6 < temp_thshld2) && C1;
+            }
+
+            /**
+            Water test :
+            ndvi < 0 => water
+            ((0<ndvi<0.1) or (b4<5%)) and b5 < 0.01 => turbid water
+            **/
+            if ((rho4 + rho3) != 0)
+                ndvi = (rho4 - rho3) / (rho4 + rho3);
+            else
+                ndvi = 0.01;
+            water = (ndvi < 0) || ((((ndvi > 0) && (ndvi < 0.1)) ||
+                (rho4 < 0.05)) && (rho5 < 0.02));
+
+            if (thermal_band) {
+                if (!water) { /* if not water */
+                    ddv_line[is] |= 0x10;
+                    if ((C2 || C5) && C4) { /* cloudy */
+                        ddv_line[is] &= 0xbf; /* reset shadow bit */
+                        ddv_line[is] &= 0xfb; /* reset adjacent cloud bit */
+                        ddv_line[is] |= 0x20; /* set cloud bit */
                     }
-                    else {
-                        ddv_line[is] &= 0xef; 
+                    else { /* clear */
+                        ddv_line[is] &= 0xdf;
+                        ndsi = (rho2 - rho5) / (rho2 + rho5);
+                        if ((ndsi > 0.3) && (t6 < temp_snow_thshld) &&
+                            (rho4 > 0.2))
+                            ddv_line[is] |= 0x80;
                     }
                 }
-            }  /* end else saturated band 3 */
-        }  /* if ! is_fill */ 
-    }  /* end for is */
+                else 
+                    ddv_line[is] &= 0xef; 
+            }
+            else { /* no thermal band - cannot run cloud mask */
+                ddv_line[is] &= 0xdf; /* assume clear */
+                if (!water) { /* if not water */
+                    ddv_line[is] |= 0x10;
+                }
+                else {
+                    ddv_line[is] &= 0xef; 
+                }
+            }
+        }  /* end else saturated band 3 */
+    }  /* if ! is_fill */ 
+}
+
+
+bool cloud_detection_pass2
+(
+    Lut_t *lut,              /* I: lookup table informat */
+    int nsamp,               /* I: number of samples to be processed */
+    int il_start,            /* I: first line of the block being processed */
+    int nlines,              /* I: number of lines in the block */
+    int16 ***line_in,        /* I: array of input lines for each line of the
+                                   block, one for each band */
+    uint8 **qa_line,         /* I: array of QA data for each line of the
+                                   block */
+    int16 **b6_line,         /* I: array of thermal data for each line of the
+                                   block; NULL if there is no thermal band */
+    cld_diags_t *cld_diags,  /* I: cloud diagnostics */
+    char **ddv_line          /* O: dark dense vegetation line for each line
+                                   of the block */
+            /**
+            use ddv_line to store internal cloud screening info
+            bit 2 = adjacent cloud 1=yes 0=no
+            bit 3 = fill value 1=fill 0=valid
+            bit 4 = land/water mask 1=land 0=water
+            bit 5 = cloud 0=clear 1=cloudy
+            bit 6 = cloud shadow 
+            bit 7 = snow
+            **/
+)
+/* The pixels only depend on the cloud diagnostics, so the samples of each
+   line of the block are split among the threads.  The interpolated
+   atmospheric coefficients are allocated once per thread for the whole
+   block, rather than for each line. */
+{
+    int il, is;               /* current line and sample */
+    atmos_t interpol_atmos_coef; /* interpolated atmospheric coefficients,
+                                    based on the current line/sample location
+                                    in the aerosol data grid */
+
+#ifdef _OPENMP
+    #pragma omp parallel private (il, is, interpol_atmos_coef)
+#endif
+    {
+    /* Allocate memory for the interpolated atmospheric coefficients, for
+       each thread */
+    allocate_mem_atmos_coeff(1,&interpol_atmos_coef);
+
+    /* Loop through the lines of the block, then the samples of the line */
+    for (il = il_start; il < il_start + nlines; il++) {
+#ifdef _OPENMP
+        #pragma omp for
+#endif
+        for (is = 0; is < nsamp; is++) {
+            cloud_detection_pass2_pixel (lut, il, is, line_in[il - il_start],
+                qa_line[il - il_start],
+                (b6_line == NULL) ? NULL : b6_line[il - il_start], cld_diags,
+                &interpol_atmos_coef, ddv_line[il - il_start]);
+        }
+    }  /* end for il */
 
     free_mem_atmos_coeff(&interpol_atmos_coef);
+    }  /* end of the parallel region */
+
     return true;
 }
 
@@ -26,8 +26,8 @@ void free_cld_diags(struct cld_diags_t *cld_diags);
 void fill_cld_diags(cld_diags_t *cld_diags);
 void interpol_clddiags_1pixel(cld_diags_t *cld_diags, int img_line, int img_sample,float *inter_value);
 
-bool cloud_detection_pass1(Lut_t *lut, int nsamp, int il, int16 **line_in, uint8 *qa_line, int16 *b6_line,float *atemp_line, cld_diags_t *cld_diags);
-bool cloud_detection_pass2(Lut_t *lut, int nsamp, int il, int16 **line_in, uint8 *qa_line, int16 *b6_line, cld_diags_t *cld_diags,char *ddv_line);
+bool cloud_detection_pass1(Lut_t *lut, int nsamp, int il_start, int nlines, int16 ***line_in, uint8 **qa_line, int16 **b6_line, float **atemp_line, cld_diags_t *cld_diags);
+bool cloud_detection_pass2(Lut_t *lut, int nsamp, int il_start, int nlines, int16 ***line_in, uint8 **qa_line, int16 **b6_line, cld_diags_t *cld_diags, char **ddv_line);
 void cast_cloud_shadow(Lut_t *lut, int nsamp, int il_start, int16 ***line_in, int16 **b6_line, cld_diags_t *cld_diags, char ***cloud_buf, Ar_gridcell_t *ar_gridcell, float pixel_size, float adjust_north);
 bool dilate_cloud_mask(Lut_t *lut, int nsamp, char ***cloud_buf, int dilate_dist);
 bool dilate_shadow_mask(Lut_t *lut, int nsamp, char ***cloud_buf, int dilate_dist);
@@ -34,6 +34,11 @@
 
    2. 'OpenInput' must be called before any of the other routines.  
    3. 'FreeInput' should be used to free the 'input' data structure.
+   4. After 'SetInputQuicklook' the lines read are those of the reduced
+      quick-look grid, so the callers work on the reduced grid unchanged.
+   5. When opened with a 'cal' structure, the lines are calibrated from the
+      Level-1 bands as they are read instead of being read from the lndcal
+      TOA files, again without any change to the callers.
 
 !END****************************************************************************
 */
@@ -49,7 +54,7 @@
 #define INPUT_FILL (-9999)
 
 /* Functions */
-Input_t *OpenInput(Espa_internal_meta_t *metadata, bool thermal)
+Input_t *OpenInput(Espa_internal_meta_t *metadata, bool thermal, Cal_t *cal)
 /* 
 !C******************************************************************************
 
@@ -59,12 +64,19 @@ Input_t *OpenInput(Espa_internal_meta_t *metadata, bool thermal)
 !Input Parameters:
  metadata     'Espa_internal_meta_t' data structure with XML info
  thermal      boolean to indicate if thermal data is being processed
+ cal          'cal' data structure to calibrate the Level-1 bands as they
+              are read, or NULL to read the lndcal TOA files
 
 !Output Parameters:
  (returns)      'input' data structure or NULL when an error occurs
 
 !Team Unique Header:
 
+ ! Design Notes:
+   1. With 'cal' no files are opened here; the lines and QA are read through
+      'cal' (see cal.c), which may be shared by the reflectance and thermal
+      inputs.
+
 !END****************************************************************************
 */
 {
@@ -78,12 +90,27 @@ Input_t *OpenInput(Espa_internal_meta_t *metadata, bool thermal)
     RETURN_ERROR("allocating Input data structure", "OpenInput", NULL);
 
   /* Initialize and get input from header file */
+  this->cal = cal;
+  this->nbytes_read = 0;
   if (!GetXMLInput (this, metadata, thermal)) {
     free(this);
     this = NULL;
     RETURN_ERROR("getting input from header file", "OpenInput", NULL);
   }
 
+  /* Start at full resolution */
+  this->quicklook = 1;
+  this->full_size = this->size;
+  this->ql_buf = NULL;
+
+  /* The bands are calibrated as they are read, so there's nothing to open */
+  if (cal != NULL) {
+    for (ib = 0; ib < this->nband; ib++)
+      this->open[ib] = true;
+    this->open_qa = !thermal;
+    return this;
+  }
+
   /* Open TOA reflectance files for access */
   for (ib = 0; ib < this->nband; ib++) {
     this->fp_bin[ib] = fopen(this->file_name[ib], "r");
@@ -160,14 +187,16 @@ bool CloseInput(Input_t *this)
   for (ib = 0; ib < this->nband; ib++) {
     if (this->open[ib]) {
       none_open = false;
-      fclose(this->fp_bin[ib]);
+      if (this->cal == NULL)
+        fclose(this->fp_bin[ib]);
       this->open[ib] = false;
     }
   }
 
   /*** now close the QA file, if it's open ***/
   if (this->open_qa) {
-    fclose(this->fp_bin_qa);
+    if (this->cal == NULL)
+      fclose(this->fp_bin_qa);
     this->open_qa = false;
   }
 
@@ -205,6 +234,8 @@ bool FreeInput(Input_t *this)
     }
     free(this->file_name_qa);
     this->file_name_qa = NULL;
+    free(this->ql_buf);
+    this->ql_buf = NULL;
 
     free(this);
     this = NULL;
@@ -214,6 +245,129 @@ bool FreeInput(Input_t *this)
 }
 
 
+bool SetInputQuicklook(Input_t *this, int factor)
+/* 
+!C******************************************************************************
+
+!Description: 'SetInputQuicklook' reduces the input to a grid with 1/factor of
+ the lines and samples, for a quick look at the scene.
+ 
+!Input Parameters:
+ this           'input' data structure
+ factor         reduction factor for the lines and samples
+
+!Output Parameters:
+ this           'input' data structure; the following fields are modified:
+                   quicklook, size, ql_buf
+ (returns)      status:
+                  'true' = okay
+		  'false' = error return
+
+!Team Unique Header:
+
+ ! Design Notes:
+   1. Each pixel of the reduced grid covers a block of factor x factor full
+      resolution pixels; the blocks on the last line and sample may be
+      partial.  The image bands are box filtered over the valid pixels of
+      each block as they are read, and the QA band takes the center pixel of
+      each block.
+   2. Only the lines of one block are held at a time, never a full
+      resolution band.
+
+!END****************************************************************************
+*/
+{
+  if (this == NULL) 
+    RETURN_ERROR("invalid input structure", "SetInputQuicklook", false);
+  if (factor < 1)
+    RETURN_ERROR("invalid reduction factor", "SetInputQuicklook", false);
+  if (this->quicklook != 1)
+    RETURN_ERROR("input already reduced", "SetInputQuicklook", false);
+  if (factor == 1)
+    return true;
+
+  this->ql_buf = (int16 *)malloc((size_t)factor * this->full_size.s *
+    sizeof(int16));
+  if (this->ql_buf == NULL)
+    RETURN_ERROR("allocating quick-look line buffer", "SetInputQuicklook",
+      false);
+
+  this->quicklook = factor;
+  this->size.l = (this->full_size.l + factor - 1) / factor;
+  this->size.s = (this->full_size.s + factor - 1) / factor;
+
+  return true;
+}
+
+
+static bool GetReducedLine(Input_t *this, int iband, int iline, int16 *line)
+/* 
+!C******************************************************************************
+
+!Description: 'GetReducedLine' reads a line of the quick-look grid, averaging
+ the valid (non-fill, unsaturated) pixels of each block.  A block with no
+ valid pixels is saturated if any of its pixels are, and fill otherwise.
+
+!END****************************************************************************
+*/
+{
+  int factor = this->quicklook;
+  int first_line, nlines;
+  int is, il, js, end_s;
+  int count, nsatu;
+  long sum;
+  int16 pix;
+
+  first_line = iline * factor;
+  nlines = this->full_size.l - first_line;
+  if (nlines > factor) nlines = factor;
+
+  if (this->cal != NULL) {
+    for (il = 0; il < nlines; il++) {
+      if (!GetCalLine(this->cal, this->meta.iband[iband], first_line + il,
+                      &this->ql_buf[(long)il * this->full_size.s]))
+        RETURN_ERROR("error calibrating line", "GetReducedLine", false);
+    }
+  } else {
+    if (fseek(this->fp_bin[iband], 
+              (long)first_line * this->full_size.s * sizeof(int16), SEEK_SET))
+      RETURN_ERROR("error seeking line (binary)", "GetReducedLine", false);
+    if (fread(this->ql_buf, sizeof(int16), 
+              (size_t)nlines * this->full_size.s, this->fp_bin[iband]) != 
+        (size_t)nlines * this->full_size.s)
+      RETURN_ERROR("error reading line (binary)", "GetReducedLine", false);
+    this->nbytes_read += (long long)nlines * this->full_size.s * sizeof(int16);
+  }
+
+  for (is = 0; is < this->size.s; is++) {
+    end_s = (is + 1) * factor;
+    if (end_s > this->full_size.s) end_s = this->full_size.s;
+    sum = 0;
+    count = nsatu = 0;
+    for (il = 0; il < nlines; il++) {
+      for (js = is * factor; js < end_s; js++) {
+        pix = this->ql_buf[(long)il * this->full_size.s + js];
+        if (pix == INPUT_SATU)
+          nsatu++;
+        else if (pix != this->meta.fill) {
+          sum += pix;
+          count++;
+        }
+      }
+    }
+
+    if (count > 0)
+      line[is] = (int16)floor((double)sum / count + 0.5);
+    else if (nsatu > 0)
+      line[is] = INPUT_SATU;
+    else
+      line[is] = this->meta.fill;
+  }
+
+  return true;
+}
+
+
 bool GetInputLine(Input_t *this, int iband, int iline, int16 *line)
 {
   long loc;
@@ -229,6 +383,14 @@ bool GetInputLine(Input_t *this, int iband, int iline, int16 *line)
   if (!this->open[iband])
     RETURN_ERROR("band not open", "GetInputLine", false);
 
+  /* Reduce the line for a quick look */
+  if (this->quicklook > 1)
+    return GetReducedLine(this, iband, iline, line);
+
+  /* Calibrate the Level-1 line */
+  if (this->cal != NULL)
+    return GetCalLine(this->cal, this->meta.iband[iband], iline, line);
+
   /* Read the data */
   buf_void = (void *)line;
   loc = (long) (iline * this->size.s * sizeof(int16));
@@ -237,6 +399,7 @@ bool GetInputLine(Input_t *this, int iband, int iline, int16 *line)
   if (fread(buf_void, sizeof(int16), (size_t)this->size.s, 
             this->fp_bin[iband]) != (size_t)this->size.s)
     RETURN_ERROR("error reading line (binary)", "GetInputLine", false);
+  this->nbytes_read += (long long)this->size.s * sizeof(int16);
 
   return true;
 }
@@ -254,6 +417,38 @@ bool GetInputQALine(Input_t *this, int iline, uint8 *line)
   if (!this->open_qa)
     RETURN_ERROR("QA band not open", "GetInputQALine", false);
 
+  /* For a quick look take the center pixel of each block */
+  if (this->quicklook > 1) {
+    uint8 *full_line = (uint8 *)this->ql_buf;
+    int factor = this->quicklook;
+    int center, is;
+
+    center = iline * factor + factor / 2;
+    if (center >= this->full_size.l) center = this->full_size.l - 1;
+    if (this->cal != NULL) {
+      if (!GetCalQALine(this->cal, center, full_line))
+        RETURN_ERROR("error calibrating line", "GetInputQALine", false);
+    } else {
+      loc = (long)center * this->full_size.s * sizeof(uint8);
+      if (fseek(this->fp_bin_qa, loc, SEEK_SET))
+        RETURN_ERROR("error seeking line (binary)", "GetInputQALine", false);
+      if (fread(full_line, sizeof(uint8), (size_t)this->full_size.s, 
+                this->fp_bin_qa) != (size_t)this->full_size.s)
+        RETURN_ERROR("error reading line (binary)", "GetInputQALine", false);
+      this->nbytes_read += (long long)this->full_size.s * sizeof(uint8);
+    }
+
+    for (is = 0; is < this->size.s; is++) {
+      center = is * factor + factor / 2;
+      if (center >= this->full_size.s) center = this->full_size.s - 1;
+      line[is] = full_line[center];
+    }
+    return true;
+  }
+
+  if (this->cal != NULL)
+    return GetCalQALine(this->cal, iline, line);
+
   buf_void = (void *)line;
   loc = (long) (iline * this->size.s * sizeof(uint8));
   if (fseek(this->fp_bin_qa, loc, SEEK_SET))
@@ -261,6 +456,7 @@ bool GetInputQALine(Input_t *this, int iline, uint8 *line)
   if (fread(buf_void, sizeof(uint8), (size_t)this->size.s, 
             this->fp_bin_qa) != (size_t)this->size.s)
     RETURN_ERROR("error reading line (binary)", "GetInputQALine", false);
+  this->nbytes_read += (long long)this->size.s * sizeof(uint8);
 
   return true;
 }
@@ -446,8 +642,22 @@ bool GetXMLInput(Input_t *this, Espa_internal_meta_t *metadata, bool thermal)
     }
 
     /* Find TOA band 1 in the input XML file to obtain band-related
-       information */
-    if (!thermal)
+       information.  If the bands are calibrated as they are read, there are
+       no TOA bands, so use the Level-1 band instead. */
+    if (this->cal != NULL)
+    {  /* Level-1 bands, calibrated by cal.c */
+        for (i = 0; i < metadata->nbands; i++)
+        {
+            if (!strncmp (metadata->band[i].product, "L1", 2) &&
+                ((!thermal && !strcmp (metadata->band[i].name, "b1")) ||
+                 (thermal && this->meta.inst == INST_TM &&
+                  !strcmp (metadata->band[i].name, "b6")) ||
+                 (thermal && this->meta.inst == INST_ETM &&
+                  !strcmp (metadata->band[i].name, "b61"))))
+                indx = i;
+        }  /* for i */
+    }
+    else if (!thermal)
     {  /* reflectance bands */
         for (i = 0; i < metadata->nbands; i++)
         {
@@ -45,9 +45,11 @@
 #include "lndsr.h"
 #include "const.h"
 #include "date.h"
+#include "cal.h"
 
 #define ANGLE_FILL -999.0
 #define WRS_FILL -1
+#define INPUT_SATU (20000)
 
 typedef struct {
   Sat_t sat;               /* Satellite */
@@ -79,16 +81,25 @@ typedef struct {
   bool open_qa;            /* Flag to indicate whether the specific input
                               file is open for access; 'true' = open, 
                               'false' = not open */
+  int quicklook;           /* Reduction factor for a quick look; 1 is full
+                              resolution (see SetInputQuicklook) */
+  Img_coord_int_t full_size;  /* Full resolution file size */
+  int16 *ql_buf;           /* Full resolution lines of the current block,
+                              for a quick look */
+  Cal_t *cal;              /* Calibration of the Level-1 bands the lines are
+                              read through; NULL to read the TOA files */
+  long long nbytes_read;   /* Bytes read from the TOA files */
 } Input_t;
 
 /* Prototypes */
 
-Input_t *OpenInput(Espa_internal_meta_t *metadata, bool thermal);
+Input_t *OpenInput(Espa_internal_meta_t *metadata, bool thermal, Cal_t *cal);
 bool GetInputLine(Input_t *this, int iband, int iline, int16 *line);
 bool CloseInput(Input_t *this);
 bool FreeInput(Input_t *this);
 bool InputMetaCopy(Input_meta_t *this, int nband, Input_meta_t *copy);
 bool GetXMLInput(Input_t *this, Espa_internal_meta_t *metadata, bool thermal);
 bool GetInputQALine(Input_t *this, int iline, uint8 *line);
+bool SetInputQuicklook(Input_t *this, int factor);
 
 #endif
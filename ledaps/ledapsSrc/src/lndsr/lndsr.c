@@ -21,6 +21,7 @@
 
 #include "read_grib_tools.h"
 #include "sixs_runs.h"
+#include "rayleigh.h"
 
 #define AERO_NB_BANDS 3
 #define SP_INDEX    0
@@ -62,12 +63,6 @@ int32 sds_index;
 int32 dim_sizes[2],start[2],stride[2],edges[2];
 int32 data_type,n_attrs,rank;
 /* Prototypes */
-#ifndef  HPUX
-#define chand chand_
-#define csalbr csalbr_
-#endif
-void chand(float *phi,float *muv,float *mus,float *tau_ray,float *actual_rho_ray);
-void csalbr(float *tau_ray,float *actual_S_r);
 int update_atmos_coefs(atmos_t *atmos_coef,Ar_gridcell_t *ar_gridcell, sixs_tables_t *sixs_tables,int ***line_ar,Lut_t *lut,int nband, int bkgd_aerosol);
 int update_gridcell_atmos_coefs(int irow,int icol,atmos_t *atmos_coef,Ar_gridcell_t *ar_gridcell, sixs_tables_t *sixs_tables,int **line_ar,Lut_t *lut,int nband, int bkgd_aerosol);
 float calcuoz(short jday,float flat);
@@ -79,19 +74,24 @@ int read_6S_results_from_file(char *filename,sixs_tables_t *sixs_tables);
 int write_6S_results_to_file(char *filename,sixs_tables_t *sixs_tables);
 #endif
 void sun_angles (short jday,float gmt,float flat,float flon,float *ts,float *fs);
+int set_quicklook_meta(Espa_internal_meta_t *xml_metadata, Input_t *input,
+    Espa_internal_meta_t *ql_metadata);
 /* Functions */
 
 int main (int argc, char *argv[]) {
     Param_t *param = NULL;
     Input_t *input = NULL, *input_b6 = NULL;
+    Cal_t *cal = NULL;
     InputPrwv_t *prwv_input = NULL;
     InputOzon_t *ozon_input = NULL;
     Lut_t *lut = NULL;
     Output_t *output = NULL;
-    int i,j,il, is,ib,i_aot,j_aot,ifree;
+    int i,j,il, is,ib,ifree;
     int il_start, il_end, il_ar, il_region, is_ar;
     int16 *line_out[NBAND_SR_MAX];
     int16 *line_out_buf = NULL;
+    int16 *aot_out = NULL;    /* atmospheric opacity output line */
+    int16 *qa_out = NULL;     /* QA (cloud) output line */
     int16 ***line_in = NULL;
     int16 **line_in_band_buf = NULL;
     int16 *line_in_buf = NULL;
@@ -100,7 +100,8 @@ int main (int argc, char *argv[]) {
     int *line_ar_buf = NULL;
     int16** b6_line = NULL;
     int16* b6_line_buf = NULL;
-    float *atemp_line = NULL;
+    float **atemp_line = NULL;
+    float *atemp_line_buf = NULL;
     uint8** qa_line = NULL;
     uint8* qa_line_buf = NULL;
     char **ddv_line = NULL;
@@ -110,7 +111,6 @@ int main (int argc, char *argv[]) {
     char *rot_cld_buf = NULL;
     char envi_file[STR_SIZE]; /* name of the output ENVI header file */
     char *cptr = NULL;        /* pointer to the file extension */
-    bool refl_is_fill;
 
     Sr_stats_t sr_stats;
     Ar_stats_t ar_stats;
@@ -123,14 +123,12 @@ int main (int argc, char *argv[]) {
                                   flipped */
   
     int nbpts;
-    int inter_aot;            /* atmospheric opacity */
     float scene_gmt;
 
     Geoloc_t *space = NULL;
     Space_def_t space_def;
     char *dem_name = NULL;
     Img_coord_float_t img;
-    Img_coord_int_t loc;
     Geo_coord_t geo;
 
     t_ncep_ancillary anc_O3,anc_WV,anc_SP,anc_ATEMP;
@@ -162,12 +160,16 @@ int main (int argc, char *argv[]) {
     short jday;
 
     Espa_internal_meta_t xml_metadata;  /* XML metadata structure */
+    Espa_internal_meta_t ql_metadata;   /* XML metadata for the quick-look
+                                           products */
+    Espa_internal_meta_t *out_metadata = &xml_metadata;  /* XML metadata for
+                                           the output products */
+    char ql_xml[STR_SIZE];              /* XML file for the quick look */
+    char *out_xml = NULL;               /* XML file listing the output
+                                           products */
     Espa_global_meta_t *gmeta = NULL;   /* pointer to global meta */
     Envi_header_t envi_hdr;             /* output ENVI header information */
   
-    /* Vermote additional variable declaration for the cloud mask May 29 2007 */
-    float t6s_seuil;
-  
     debug_flag= DEBUG_FLAG;
     no_ozone_file=0;
   
@@ -195,12 +197,21 @@ int main (int argc, char *argv[]) {
     }
     gmeta = &xml_metadata.global; /* pointer to global meta */
 
+    /* Calibrate the Level-1 bands as they are read, in place of the lndcal
+       TOA bands; the reflectance and thermal inputs share the calibration,
+       so each Level-1 line is read once per pass */
+    if (param->calibrate) {
+        cal = OpenCal(&xml_metadata);
+        if (cal == NULL)
+            EXIT_ERROR("setting up the Level-1 calibration", "main");
+    }
+
     /* Open input files; grab QA band for reflectance band */
-    input = OpenInput(&xml_metadata, false /* not thermal */);
+    input = OpenInput(&xml_metadata, false /* not thermal */, cal);
     if (input == NULL)
         EXIT_ERROR("bad input file", "main");
 
-    input_b6 = OpenInput(&xml_metadata, true /* thermal */);
+    input_b6 = OpenInput(&xml_metadata, true /* thermal */, cal);
     if (input_b6 == NULL) {
         param->thermal_band = false;
         printf ("WARNING: no TOA brightness temp band available. "
@@ -209,6 +220,25 @@ int main (int argc, char *argv[]) {
     else
         param->thermal_band = true;
 
+    /* Reduce the inputs as they are read for a quick look; every stage
+       below then works on the reduced grid */
+    out_xml = param->input_xml_file_name;
+    if (param->quicklook > 1) {
+        if (!SetInputQuicklook(input, param->quicklook))
+            EXIT_ERROR("reducing input for the quick look", "main");
+        if (param->thermal_band &&
+            !SetInputQuicklook(input_b6, param->quicklook))
+            EXIT_ERROR("reducing thermal input for the quick look", "main");
+        if (set_quicklook_meta(&xml_metadata, input, &ql_metadata))
+            EXIT_ERROR("setting up the quick-look metadata", "main");
+        out_metadata = &ql_metadata;
+        snprintf(ql_xml, sizeof(ql_xml), "%s.xml",
+            ql_metadata.global.product_id);
+        out_xml = ql_xml;
+        printf ("Processing a %d x %d quick look, written to %s\n",
+            input->size.l, input->size.s, out_xml);
+    }
+
     if (param->num_prwv_files > 0  && param->num_ncep_files > 0) {
         EXIT_ERROR("both PRWV and PRWV_FIL files specified", "main");
     }
@@ -265,12 +295,20 @@ int main (int argc, char *argv[]) {
     }
 
     /* Get Lookup table, based on reflectance information */
-    lut = GetLut(input->nband, &input->meta, &input->size);
+    lut = GetLut(input->nband, &input->meta, &input->size, param->quicklook);
     if (lut == NULL) EXIT_ERROR("bad lut file", "main");
 
     /* Get geolocation space definition */
     if (!get_geoloc_info(&xml_metadata, &space_def))
         EXIT_ERROR("getting space metadata from XML file", "main");
+    if (param->quicklook > 1) {
+        /* The quick-look pixels cover blocks of pixels starting at the same
+           corner */
+        space_def.pixel_size[0] *= param->quicklook;
+        space_def.pixel_size[1] *= param->quicklook;
+        space_def.img_size.l = input->size.l;
+        space_def.img_size.s = input->size.s;
+    }
     space = setup_mapping(&space_def);
     if (space == NULL)
         EXIT_ERROR("getting setting up geolocation mapping", "main");
@@ -295,7 +333,7 @@ int main (int argc, char *argv[]) {
 
     /* Open the output files and set up the necessary information for appending
        to the XML file */
-    output = OpenOutput(&xml_metadata, input, param, lut);
+    output = OpenOutput(out_metadata, input, param, lut);
     if (output == NULL) EXIT_ERROR("opening output file", "main");
 
     /* Open diagnostics files if needed */
@@ -365,9 +403,17 @@ int main (int argc, char *argv[]) {
         }
     }
 
-    /* Allocate memory for one air temperature line */
-    atemp_line = calloc(input->size.s,sizeof(float));
+    /* Allocate memory for air temperature lines */
+    atemp_line = calloc(lut->ar_region_size.l,sizeof(float *));
     if (atemp_line == NULL) EXIT_ERROR("allocating atemp line", "main");
+    atemp_line_buf = calloc(input->size.s * lut->ar_region_size.l,
+        sizeof(float));
+    if (atemp_line_buf == NULL)
+        EXIT_ERROR("allocating atemp line buffer", "main");
+    for (il = 0; il < lut->ar_region_size.l; il++) {
+        atemp_line[il]=atemp_line_buf;
+        atemp_line_buf += input->size.s;
+    }
 
     /* Allocate memory for ddv line */
     ddv_line = calloc(lut->ar_region_size.l,sizeof(char *));
@@ -823,65 +869,80 @@ int main (int argc, char *argv[]) {
 
     /* Read input first time and compute clear pixels stats for internal cloud
        screening */
-    /* allocate memory for cld_diags structure and clear sum and nb of obs */
-    if (allocate_cld_diags(&cld_diags,CLDDIAGS_CELLHEIGHT_5KM,
-        CLDDIAGS_CELLWIDTH_5KM, input->size.l, input->size.s)) {
+    /* allocate memory for cld_diags structure and clear sum and nb of obs;
+       the cells stay about 5km across for a quick look */
+    if (allocate_cld_diags(&cld_diags,
+        CLDDIAGS_CELLHEIGHT_5KM / param->quicklook,
+        CLDDIAGS_CELLWIDTH_5KM / param->quicklook,
+        input->size.l, input->size.s)) {
         EXIT_ERROR("couldn't allocate memory from cld_diags","main");
     }
 
-    /* Screen the clouds */
-    for (il = 0; il < input->size.l; il++) {
-        if (!(il%100)) 
-        {
-            printf("First pass cloud screening for line %d\r",il);
-            fflush(stdout);
-        }
+    /* Screen the clouds a block of lines at a time, so the pixels of the
+       block can be split among the threads.  Only the cloud diagnostics are
+       computed here, which need the thermal band. */
+    if (param->thermal_band) {
+        for (il_start = 0; il_start < input->size.l;
+             il_start += lut->ar_region_size.l) {
+            il_end = il_start + lut->ar_region_size.l - 1;
+            if (il_end >= input->size.l)
+                il_end = input->size.l - 1;
+
+            for (il = il_start; il < (il_end + 1); il++) {
+                il_region = il - il_start;
+                if (!(il%100)) 
+                {
+                    printf("First pass cloud screening for line %d\r",il);
+                    fflush(stdout);
+                }
 
-        /* Read each input band */
-        for (ib = 0; ib < input->nband; ib++) {
-            if (!GetInputLine(input, ib, il, line_in[0][ib]))
-                EXIT_ERROR("reading input data for a line (b)", "main");
-        }
-        if (!GetInputQALine(input, il, qa_line[0]))
-            EXIT_ERROR("reading input data for qa_line (1)", "main");
-        if (param->thermal_band) {
-            if (!GetInputLine(input_b6, 0, il, b6_line[0]))
-                EXIT_ERROR("reading input data for b6_line (1)", "main");
-        }
+                /* Read each input band */
+                for (ib = 0; ib < input->nband; ib++) {
+                    if (!GetInputLine(input, ib, il, line_in[il_region][ib]))
+                        EXIT_ERROR("reading input data for a line (b)",
+                            "main");
+                }
+                if (!GetInputQALine(input, il, qa_line[il_region]))
+                    EXIT_ERROR("reading input data for qa_line (1)", "main");
+                if (!GetInputLine(input_b6, 0, il, b6_line[il_region]))
+                    EXIT_ERROR("reading input data for b6_line (1)", "main");
 
-        tmpint = (int)(scene_gmt / anc_ATEMP.timeres);
-        if (tmpint >= anc_ATEMP.nblayers - 1)
-            tmpint = anc_ATEMP.nblayers - 2;
-        coef = (double)(scene_gmt - anc_ATEMP.time[tmpint]) / anc_ATEMP.timeres;
+                tmpint = (int)(scene_gmt / anc_ATEMP.timeres);
+                if (tmpint >= anc_ATEMP.nblayers - 1)
+                    tmpint = anc_ATEMP.nblayers - 2;
+                coef = (double)(scene_gmt - anc_ATEMP.time[tmpint]) /
+                    anc_ATEMP.timeres;
 
-        img.is_fill = false;
-        img.l = il;
+                img.is_fill = false;
+                img.l = il;
 #ifdef _OPENMP
-        #pragma omp parallel for private (is, geo, flat, flon, tmpflt_arr) firstprivate (img, atemp_line)
+                #pragma omp parallel for private (is, geo, flat, flon, tmpflt_arr) firstprivate (img)
 #endif
-        for (is = 0; is < input->size.s; is++) {
-            /* Get the geolocation info for this pixel */
-            img.s = is;
-            if (!from_space (space, &img, &geo))
-                EXIT_ERROR("mapping from space (2)", "main");
-            flat = geo.lat * DEG;
-            flon = geo.lon * DEG;
-
-            /* Interpolate the anciliary data for this lat/long, then pull the
-               information for the scene center time and adjust */
-            interpol_spatial_anc (&anc_ATEMP, flat, flon, tmpflt_arr);
-            atemp_line[is] = (1. - coef) * tmpflt_arr[tmpint] +
-                coef * tmpflt_arr[tmpint+1];
-        }
+                for (is = 0; is < input->size.s; is++) {
+                    /* Get the geolocation info for this pixel */
+                    img.s = is;
+                    if (!from_space (space, &img, &geo))
+                        EXIT_ERROR("mapping from space (2)", "main");
+                    flat = geo.lat * DEG;
+                    flon = geo.lon * DEG;
+
+                    /* Interpolate the anciliary data for this lat/long, then
+                       pull the information for the scene center time and
+                       adjust */
+                    interpol_spatial_anc (&anc_ATEMP, flat, flon, tmpflt_arr);
+                    atemp_line[il_region][is] =
+                        (1. - coef) * tmpflt_arr[tmpint] +
+                        coef * tmpflt_arr[tmpint+1];
+                }
+            }
 
-        /* Run Cld Screening Pass1 and compute stats. This cloud detection
-           function contains statistics gathering that needs to be in a
-           critical section for multi-threading. */
-        if (param->thermal_band)
-            if (!cloud_detection_pass1 (lut, input->size.s, il, line_in[0],
-                qa_line[0], b6_line[0], atemp_line, &cld_diags))
+            /* Run Cld Screening Pass1 and compute stats for the block */
+            if (!cloud_detection_pass1 (lut, input->size.s, il_start,
+                il_end - il_start + 1, line_in, qa_line, b6_line, atemp_line,
+                &cld_diags))
                 EXIT_ERROR("running cloud detection pass 1", "main");
-    } /* end for il */
+        } /* end for il_start */
+    }
     printf ("\n");
 
     if (param->thermal_band) {
@@ -1002,21 +1063,15 @@ int main (int argc, char *argv[]) {
             if (param->thermal_band) {
                 if (!GetInputLine(input_b6, 0, il, b6_line[il_region]))
                     EXIT_ERROR("reading input data for b6_line (2)", "main");
-
-                /* Run Cld Screening Pass2 */
-                if (!cloud_detection_pass2(lut, input->size.s, il,
-                    line_in[il_region], qa_line[il_region], b6_line[il_region],
-                    &cld_diags, ptr_rot_cld[1][il_region]))
-                    EXIT_ERROR("running cloud detection pass 2", "main");
-            }
-            else {
-                if (!cloud_detection_pass2(lut, input->size.s, il,
-                    line_in[il_region], qa_line[il_region], NULL, &cld_diags,
-                    ptr_rot_cld[1][il_region]))
-                    EXIT_ERROR("running cloud detection pass 2", "main");
             }
         }  /* end for il */
 
+        /* Run Cld Screening Pass2 for the block */
+        if (!cloud_detection_pass2(lut, input->size.s, il_start,
+            il_end - il_start + 1, line_in, qa_line,
+            param->thermal_band ? b6_line : NULL, &cld_diags, ptr_rot_cld[1]))
+            EXIT_ERROR("running cloud detection pass 2", "main");
+
         if (param->thermal_band) {
             /* Cloud Mask Dilation : 5 pixels */
             if (!dilate_cloud_mask(lut, input->size.s, ptr_rot_cld, 5))
@@ -1158,9 +1213,6 @@ int main (int argc, char *argv[]) {
                 EXIT_ERROR("reading input data for a line (b)", "main");
         }
     
-        if (!GetInputLine(input_b6, 0, il, b6_line[0]))
-            EXIT_ERROR("reading input data for b6_line (1)", "main");
-
         /* Compute the surface reflectance */
         if (!Sr(lut, input->size.s, il, line_in[0], line_out, &sr_stats))
             EXIT_ERROR("computing surface reflectance for a line", "main");
@@ -1171,68 +1223,52 @@ int main (int argc, char *argv[]) {
         if (fread(ddv_line[0],input->size.s,1,fdtmp)!=1)
             EXIT_ERROR("reading line from dark target temporary file", "main");
 
-        loc.l=il;
-        i_aot=il/lut->ar_region_size.l;
-        t6s_seuil=280.+(1000.*0.01);
-
+        /* AOT / opacity, interpolated for the whole line */
+        aot_out = line_out[lut->nband+ATMOS_OPACITY];
+        ArInterpLine(lut, il, input->size.s, line_ar, aot_out);
+
+        /* QA is written out in the cloud band as a bit-packed product
+           (16-bit). We will use QA values as-is and no further
+           post-processing QA step will be implemented. We want the QA
+           to reflect the cloud, etc. status that was used in the
+           aerosol and surface reflectance computations. We are not
+           interested in post-processing of the QA information, as
+           there are better QA products available. The bits are set
+           without branches so the loop can be vectorized. */
+        qa_out = line_out[lut->nband+CLOUD];
+#ifdef _OPENMP
+        #pragma omp simd
+#endif
         for (is=0;is<input->size.s;is++) {
-            loc.s=is;
-            j_aot=is/lut->ar_region_size.s;
-
-            /* Initialize QA band to off */
-            line_out[lut->nband+CLOUD][is] = QA_OFF;
-
-            /* Determine if this is a fill pixel -- mark as fill if any
-               reflective band for this pixel is fill */
-            refl_is_fill = false;
-            for (ib = 0; ib < input->nband; ib++) {
-                if (line_in[0][ib][is] == lut->in_fill)
-                    if (!refl_is_fill)
-                        refl_is_fill = true;
-            }
+            uint8 ddv = ddv_line[0][is];
+
+            qa_out[is] = QA_OFF |
+                ((ddv & 0x01) ? (1 << DDV_BIT) : 0) |
+                ((ddv & 0x04) ? (1 << ADJ_CLOUD_BIT) : 0) |
+                ((ddv & 0x10) ? 0 : (1 << LAND_WATER_BIT)) | /* water */
+                ((ddv & 0x20) ? (1 << CLOUD_BIT) : 0) |
+                ((ddv & 0x40) ? (1 << CLOUD_SHADOW_BIT) : 0) |
+                ((ddv & 0x80) ? (1 << SNOW_BIT) : 0);
+        }
 
-            /* Process QA for each pixel */
-            if (!refl_is_fill) {
-                /* AOT / opacity */
-                ArInterp(lut, &loc, line_ar, &inter_aot); 
-                line_out[lut->nband+ATMOS_OPACITY][is] = inter_aot;
-
-                /* QA is written out in the cloud band as a bit-packed product
-                   (16-bit). We will use QA values as-is and no further
-                   post-processing QA step will be implemented. We want the QA
-                   to reflect the cloud, etc. status that was used in the
-                   aerosol and surface reflectance computations. We are not
-                   interested in post-processing of the QA information, as
-                   there are better QA products available. */
-                if (ddv_line[0][is]&0x01)
-                    line_out[lut->nband+CLOUD][is] |= (1 << DDV_BIT);
-
-                if (ddv_line[0][is]&0x04)
-                    line_out[lut->nband+CLOUD][is] |= (1 << ADJ_CLOUD_BIT);
-
-                if (!(ddv_line[0][is]&0x10))  /* if water, turn on */
-                    line_out[lut->nband+CLOUD][is] |= (1 << LAND_WATER_BIT);
-
-                if (ddv_line[0][is]&0x20)
-                    line_out[lut->nband+CLOUD][is] |= (1 << CLOUD_BIT);
-
-                if (ddv_line[0][is]&0x40)
-                    line_out[lut->nband+CLOUD][is] |=
-                        (1 << CLOUD_SHADOW_BIT);
-
-                if (ddv_line[0][is]&0x80)
-                    line_out[lut->nband+CLOUD][is] |= (1 << SNOW_BIT);
-            }
-            else {
-                line_out[lut->nband][is]=lut->aerosol_fill;
+        /* Mark as fill if any reflective band for this pixel is fill */
+        for (ib = 0; ib < input->nband; ib++) {
+            for (is=0;is<input->size.s;is++) {
+                if (line_in[0][ib][is] == lut->in_fill) {
+                    aot_out[is] = lut->aerosol_fill;
+                    qa_out[is] = QA_OFF;
+                }
             }
-        } /* for is */
+        }
 
         /* Write each output band */
         for (ib = 0; ib < output->nband_out; ib++) {
             if (!PutOutputLine(output, ib, il, line_out[ib]))
                 EXIT_ERROR("writing output data for a line", "main");
         }
+        if (param->quicklook > 1 &&
+            !PutThumbnailLine(output, il, line_out))
+            EXIT_ERROR("writing thumbnail data for a line", "main");
     }  /* for il */
     printf("\n");
     fclose(fdtmp);
@@ -1251,15 +1287,26 @@ int main (int argc, char *argv[]) {
                 sr_stats.sr_min[ib], sr_stats.sr_max[ib]);
     }
 
+    /* Report the image I/O of the scene */
+    if (cal != NULL)
+        printf(" bytes read from the Level-1 bands %lld\n",
+            cal->nbytes_read);
+    else
+        printf(" bytes read from the TOA bands %lld\n", input->nbytes_read +
+            (param->thermal_band ? input_b6->nbytes_read : 0));
+    printf(" bytes written to the SR bands %lld\n", output->nbytes_written);
+
     /* Close input files */
     if (!CloseInput(input)) EXIT_ERROR("closing input file", "main");
     if (!CloseOutput(output)) EXIT_ERROR("closing input file", "main");
+    if (cal != NULL && !CloseCal(cal))
+        EXIT_ERROR("closing Level-1 files", "main");
 
     /* Write the ENVI header for reflectance files */
     for (ib = 0; ib < output->nband_out; ib++) {
         /* Create the ENVI header file this band */
         if (create_envi_struct (&output->metadata.band[ib],
-            &xml_metadata.global, &envi_hdr) != SUCCESS)
+            &out_metadata->global, &envi_hdr) != SUCCESS)
             EXIT_ERROR("Creating the ENVI header structure for this file.",
                 "main");
 
@@ -1271,9 +1318,17 @@ int main (int argc, char *argv[]) {
             EXIT_ERROR("Writing the ENVI header file.", "main");
     }
 
+    /* The quick-look products are listed in their own XML file, which
+       starts with the global metadata of the quick look and no bands */
+    if (param->quicklook > 1) {
+        ql_metadata.nbands = 0;
+        if (write_metadata (&ql_metadata, out_xml) != SUCCESS)
+            EXIT_ERROR("writing the quick-look XML file", "main");
+    }
+
     /* Append the reflective and thermal bands to the XML file */
     if (append_metadata (output->nband_out, output->metadata.band,
-        param->input_xml_file_name) != SUCCESS)
+        out_xml) != SUCCESS)
         EXIT_ERROR("appending surfance reflectance and QA bands", "main");
 
     /* Free the metadata structure */
@@ -1288,6 +1343,9 @@ int main (int argc, char *argv[]) {
     if (!FreeInput(input_b6)) 
         EXIT_ERROR("freeing input_b6 file stucture", "main");
 
+    if (!FreeCal(cal)) 
+        EXIT_ERROR("freeing cal stucture", "main");
+
     if (!FreeLut(lut)) 
         EXIT_ERROR("freeing lut file stucture", "main");
 
@@ -1304,6 +1362,8 @@ int main (int argc, char *argv[]) {
     free(line_in);
     free(qa_line[0]);
     free(qa_line);
+    free(atemp_line[0]);
+    free(atemp_line);
     if (param->thermal_band) {
         free(b6_line[0]);
         free(b6_line);
@@ -1342,6 +1402,8 @@ int allocate_mem_atmos_coeff(int nbpts,atmos_t *atmos_coef)
     int ib;
     if ((atmos_coef->computed=(int *)malloc(nbpts*sizeof(int)))==NULL)
         return -1;
+    if ((atmos_coef->rayleigh_nband=(int *)calloc(nbpts,sizeof(int)))==NULL)
+        return -1;
     for (ib=0;ib<7;ib++) {
         if ((atmos_coef->tgOG[ib]=(float *)malloc(nbpts*sizeof(float)))==NULL)
             return -1;
@@ -1377,6 +1439,7 @@ int free_mem_atmos_coeff(atmos_t *atmos_coef)
 {
     int ib;
     free(atmos_coef->computed);
+    free(atmos_coef->rayleigh_nband);
     for(ib=0;ib<7;ib++) {
         free(atmos_coef->tgOG[ib]);
         free(atmos_coef->tgH2O[ib]);
@@ -1524,6 +1587,10 @@ int update_atmos_coefs
 {
     int irow,icol;
 
+    /* Each grid cell is independent of the others */
+#ifdef _OPENMP
+    #pragma omp parallel for private (icol) schedule (dynamic)
+#endif
     for (irow=0;irow<ar_gridcell->nbrows;irow++)
         for (icol=0;icol<ar_gridcell->nbcols;icol++)
             update_gridcell_atmos_coefs(irow,icol,atmos_coef,ar_gridcell,
@@ -1552,6 +1619,8 @@ int update_gridcell_atmos_coefs
     float lamda[7]={486.,570.,660.,835.,1669.,0.,2207.};
     float tau_ray_sealevel[7]={0.16511,0.08614,0.04716,0.01835,0.00113,0.00037};
         /* index=5 => band 7 */
+    float phi_band[7],muv_band[7],mus_band[7],tau_ray_band[7];
+    float rho_ray_band[7],S_r_band[7];
 
     ipt=irow*ar_gridcell->nbcols+icol;    
     mus=cos(ar_gridcell->sun_zen[ipt]*RAD);
@@ -1584,6 +1653,20 @@ int update_gridcell_atmos_coefs
     coef=(aot550-sixs_tables->aot[k])/(sixs_tables->aot[k+1]-
         sixs_tables->aot[k]);
 
+    /* Rayleigh reflectance and spherical albedo of all the bands at once,
+       unless they were computed by an earlier call for this grid point */
+    if (atmos_coef->rayleigh_nband[ipt] < nband) {
+        for (ib=0;ib < nband; ib++) {
+            phi_band[ib]=phi;
+            muv_band[ib]=muv;
+            mus_band[ib]=mus;
+            tau_ray_band[ib]=tau_ray_sealevel[ib]*ratio_spres;
+        }
+        chand_batch(nband,phi_band,muv_band,mus_band,tau_ray_band,
+            rho_ray_band);
+        csalbr_batch(nband,tau_ray_band,S_r_band);
+    }
+
     for (ib=0;ib < nband; ib++) {
         atmos_coef->tgOG[ib][ipt]=sixs_tables->T_g_og[ib];                
         atmos_coef->tgH2O[ib][ipt]=sixs_tables->T_g_wv[ib];                
@@ -1602,16 +1685,24 @@ int update_gridcell_atmos_coefs
             coef*sixs_tables->S_ra[ib][k+1];
 
         /**
-        compute DEM-based pressure correction for each grid point
+        compute DEM-based pressure correction for each grid point, unless
+        it was computed by an earlier call for this grid point
         **/
-        tau_ray=tau_ray_sealevel[ib]*ratio_spres;
-        chand(&phi,&muv,&mus,&tau_ray,&actual_rho_ray);
-        actual_T_ray_down=((2./3.+mus)+(2./3.-mus)*exp(-tau_ray/mus))/
-            (4./3.+tau_ray); /* downward */
-        actual_T_ray_up = ((2./3.+muv)+(2./3.-muv)*exp(-tau_ray/muv))/
-            (4./3.+tau_ray); /* upward */
-
-        csalbr(&tau_ray,&actual_S_r);
+        if (ib < atmos_coef->rayleigh_nband[ipt]) {
+            actual_rho_ray=atmos_coef->rho_r[ib][ipt];
+            actual_T_ray_down=atmos_coef->td_r[ib][ipt];
+            actual_T_ray_up=atmos_coef->tu_r[ib][ipt];
+            actual_S_r=atmos_coef->S_r[ib][ipt];
+        }
+        else {
+            tau_ray=tau_ray_band[ib];
+            actual_rho_ray=rho_ray_band[ib];
+            actual_T_ray_down=((2./3.+mus)+(2./3.-mus)*exp(-tau_ray/mus))/
+                (4./3.+tau_ray); /* downward */
+            actual_T_ray_up = ((2./3.+muv)+(2./3.-muv)*exp(-tau_ray/muv))/
+                (4./3.+tau_ray); /* upward */
+            actual_S_r=S_r_band[ib];
+        }
                         
         rho_ray_P0=sixs_tables->rho_r[ib];
         T_ray_down_P0=sixs_tables->T_r_down[ib];
@@ -1627,6 +1718,8 @@ int update_gridcell_atmos_coefs
         atmos_coef->S_r[ib][ipt] = actual_S_r;
         atmos_coef->rho_r[ib][ipt] = actual_rho_ray;
     }  /* for ib */
+    if (nband > atmos_coef->rayleigh_nband[ipt])
+        atmos_coef->rayleigh_nband[ipt]=nband;
 
     return 0;
 }
@@ -1698,3 +1791,57 @@ void sun_angles
 
     return;
 }
+
+
+/******************************************************************************
+!Description: 'set_quicklook_meta' sets up the XML metadata for the products of
+ a quick look, reduced by factor in the lines and samples.  The products are
+ named for the factor, and the projection corners are moved to the corner
+ pixels of the reduced grid.
+
+!Design Notes:
+  1. ql_metadata is a copy of xml_metadata and shares its band metadata, so it
+     must not be freed with free_metadata.
+  2. The scene must be north up.
+******************************************************************************/
+int set_quicklook_meta
+(
+    Espa_internal_meta_t *xml_metadata,  /* I: XML metadata for the scene */
+    Input_t *input,                /* I: input reduced for the quick look */
+    Espa_internal_meta_t *ql_metadata    /* O: XML metadata for the
+                                          quick-look products */
+)
+{
+    Espa_global_meta_t *gmeta = NULL;
+    char product_id[STR_SIZE];
+    double pixsize[2];             /* full resolution pixel size */
+    int factor = input->quicklook;
+
+    if (fabs(xml_metadata->global.orientation_angle) > 0.0) {
+        fprintf(stderr, "A quick look can only be made of a north up scene\n");
+        return -1;
+    }
+
+    *ql_metadata = *xml_metadata;
+    gmeta = &ql_metadata->global;
+    snprintf(product_id, sizeof(product_id), "%s_ql%d",
+        xml_metadata->global.product_id, factor);
+    strcpy(gmeta->product_id, product_id);
+
+    pixsize[0] = gmeta->proj_info.lr_corner[0] - gmeta->proj_info.ul_corner[0];
+    pixsize[1] = gmeta->proj_info.ul_corner[1] - gmeta->proj_info.lr_corner[1];
+    if (input->full_size.s > 1)
+        pixsize[0] /= input->full_size.s - 1;
+    if (input->full_size.l > 1)
+        pixsize[1] /= input->full_size.l - 1;
+    if (!strcmp(gmeta->proj_info.grid_origin, "CENTER")) {
+        gmeta->proj_info.ul_corner[0] += 0.5 * pixsize[0] * (factor - 1);
+        gmeta->proj_info.ul_corner[1] -= 0.5 * pixsize[1] * (factor - 1);
+    }
+    gmeta->proj_info.lr_corner[0] = gmeta->proj_info.ul_corner[0] +
+        (input->size.s - 1) * pixsize[0] * factor;
+    gmeta->proj_info.lr_corner[1] = gmeta->proj_info.ul_corner[1] -
+        (input->size.l - 1) * pixsize[1] * factor;
+
+    return 0;
+}
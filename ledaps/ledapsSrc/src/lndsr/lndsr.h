@@ -114,6 +114,9 @@ typedef struct {
 int *computed;
 float *tgOG[7],*tgH2O[7],*td_ra[7],*tu_ra[7],*rho_mol[7],*rho_ra[7],*td_da[7],*tu_da[7],*S_ra[7];
 float *td_r[7],*tu_r[7],*S_r[7],*rho_r[7];
+int *rayleigh_nband;  /* bands whose Rayleigh terms (td_r, tu_r, S_r, rho_r)
+                         are already computed for each grid point; they only
+                         depend on the geometry and pressure, not the aot */
 } atmos_t;
 
 int allocate_mem_atmos_coeff(int nbpts,atmos_t *atmos_coef);
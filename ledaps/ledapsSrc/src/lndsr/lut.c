@@ -7,13 +7,14 @@
 #include "error.h"
 
 #define OUTPUT_FILL (-9999)
-#define INPUT_SATU (20000)
 #define OUTPUT_SATU (20000)
 #define MIN_VALID_SR (-2000)
 #define MAX_VALID_SR (16000)
 #define AEROSOL_FILL (-9999)
 #define AEROSOL_REGION_NLINE (40)
 #define AEROSOL_REGION_NSAMP (AEROSOL_REGION_NLINE)
+#define AEROSOL_REGION_MIN (5)   /* smallest region for a quick look; holds
+                                    the cloud mask dilation */
 #define LONG_NAME_PREFIX ("band %d reflectance")
 #define UNITS            ("reflectance")
 #define SCALE_FACTOR     (0.0001)
@@ -22,7 +23,8 @@
 #define SCALE_FACTOR_ERR (0.0)
 #define ADD_OFFSET_ERR   (0.0)
 
-Lut_t *GetLut(int nband, Input_meta_t *meta, Img_coord_int_t *input_size) {
+Lut_t *GetLut(int nband, Input_meta_t *meta, Img_coord_int_t *input_size,
+  int quicklook) {
   Lut_t *this;
 
   /* Create the lookup table data structure */
@@ -40,6 +42,17 @@ Lut_t *GetLut(int nband, Input_meta_t *meta, Img_coord_int_t *input_size) {
   this->aerosol_fill = AEROSOL_FILL;
   this->ar_region_size.l = AEROSOL_REGION_NLINE;
   this->ar_region_size.s = AEROSOL_REGION_NSAMP;
+
+  /* Keep the aerosol regions about the same size on the ground for a quick
+     look, where each input pixel covers quicklook x quicklook pixels */
+  if (quicklook > 1) {
+    this->ar_region_size.l /= quicklook;
+    this->ar_region_size.s /= quicklook;
+    if (this->ar_region_size.l < AEROSOL_REGION_MIN)
+      this->ar_region_size.l = AEROSOL_REGION_MIN;
+    if (this->ar_region_size.s < AEROSOL_REGION_MIN)
+      this->ar_region_size.s = AEROSOL_REGION_MIN;
+  }
   this->ar_size.l = ((input_size->l - 1) / this->ar_region_size.l) + 1;
   this->ar_size.s = ((input_size->s - 1) / this->ar_region_size.s) + 1;
   this->min_valid_sr = MIN_VALID_SR;
@@ -79,7 +79,8 @@ typedef struct {
 
 /* Prototypes */
 
-Lut_t *GetLut(int nband, Input_meta_t *input_meta, Img_coord_int_t *input_size);
+Lut_t *GetLut(int nband, Input_meta_t *input_meta, Img_coord_int_t *input_size,
+  int quicklook);
 bool FreeLut(Lut_t *this);
 
 #endif
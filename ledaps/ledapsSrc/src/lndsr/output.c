@@ -29,6 +29,7 @@
 */
 
 #include <stdlib.h>
+#include <string.h>
 #include "output.h"
 #include "input.h"
 #include "error.h"
@@ -90,11 +91,17 @@ Output_t *OpenOutput(Espa_internal_meta_t *in_meta, Input_t *input,
   if (this == NULL) 
     RETURN_ERROR("allocating Output data structure", "OpenOutput", NULL);
 
-  /* Find the representative band for metadata information */
+  /* Find the representative band for metadata information.  If the input
+     is calibrated as it's read there are no TOA bands, so use the Level-1
+     band. */
   for (ib = 0; ib < in_meta->nbands; ib++)
   {
-    if (!strcmp (in_meta->band[ib].name, "toa_band1") &&
-        !strcmp (in_meta->band[ib].product, "toa_refl"))
+    if ((input->cal == NULL &&
+         !strcmp (in_meta->band[ib].name, "toa_band1") &&
+         !strcmp (in_meta->band[ib].product, "toa_refl")) ||
+        (input->cal != NULL &&
+         !strcmp (in_meta->band[ib].name, "b1") &&
+         !strncmp (in_meta->band[ib].product, "L1", 2)))
     {
       /* this is the index we'll use for band info from the XML strcuture */
       rep_indx = ib;
@@ -102,7 +109,8 @@ Output_t *OpenOutput(Espa_internal_meta_t *in_meta, Input_t *input,
     }
   }
   if (rep_indx == -1)
-    RETURN_ERROR("finding toa_band1 band in the XML file", "OpenOutput", NULL);
+    RETURN_ERROR("finding the representative band in the XML file",
+      "OpenOutput", NULL);
 
   /* Initialize the internal metadata for the output product. The global
      metadata won't be updated, however the band metadata will be updated
@@ -130,6 +138,7 @@ Output_t *OpenOutput(Espa_internal_meta_t *in_meta, Input_t *input,
 
   /* Populate the data structure */
   this->open = false;
+  this->nbytes_written = 0;
   this->nband_out = nband_out;
   this->size.l = input->size.l;
   this->size.s = input->size.s;
@@ -141,8 +150,10 @@ Output_t *OpenOutput(Espa_internal_meta_t *in_meta, Input_t *input,
     strcat (bmeta[ib].short_name, "SR");
     bmeta[ib].nlines = this->size.l;
     bmeta[ib].nsamps = this->size.s;
-    bmeta[ib].pixel_size[0] = in_meta->band[rep_indx].pixel_size[0];
-    bmeta[ib].pixel_size[1] = in_meta->band[rep_indx].pixel_size[1];
+    bmeta[ib].pixel_size[0] = in_meta->band[rep_indx].pixel_size[0] *
+      input->quicklook;
+    bmeta[ib].pixel_size[1] = in_meta->band[rep_indx].pixel_size[1] *
+      input->quicklook;
     strcpy (bmeta[ib].pixel_units, "meters");
     sprintf (bmeta[ib].app_version, "LEDAPS_%s", param->LEDAPSVersion);
     strcpy (bmeta[ib].production_date, production_date);
@@ -206,6 +217,19 @@ Output_t *OpenOutput(Espa_internal_meta_t *in_meta, Input_t *input,
     if (this->fp_bin[ib] == NULL)
       RETURN_ERROR("unable to open output band file", "OpenOutput", NULL);
   }  /* for ib */
+
+  /* Open the thumbnail for a quick look */
+  this->fp_thumb = NULL;
+  this->thumb_line = NULL;
+  if (input->quicklook > 1) {
+    sprintf (this->thumb_file_name, "%s_thumb.rgb", scene_name);
+    this->fp_thumb = fopen (this->thumb_file_name, "wb");
+    if (this->fp_thumb == NULL)
+      RETURN_ERROR("unable to open thumbnail file", "OpenOutput", NULL);
+    this->thumb_line = (uint8 *)malloc ((size_t)this->size.s * THUMB_NBANDS);
+    if (this->thumb_line == NULL)
+      RETURN_ERROR("allocating thumbnail line buffer", "OpenOutput", NULL);
+  }
   this->open = true;
 
   /* Successful completion */
@@ -233,6 +257,9 @@ bool CloseOutput(Output_t *this)
 */
 {
   int ib;
+  char hdr_file_name[STR_SIZE];  /* thumbnail ENVI header file name */
+  char *cptr = NULL;
+  FILE *fp_hdr = NULL;
 
   if (!this->open)
     RETURN_ERROR("image files not open", "CloseOutput", false);
@@ -240,6 +267,34 @@ bool CloseOutput(Output_t *this)
   for (ib = 0; ib < this->nband_out; ib++)
     close_raw_binary (this->fp_bin[ib]);
 
+  /* Close the thumbnail and write a plain ENVI header so it can be viewed */
+  if (this->fp_thumb != NULL) {
+    if (fclose (this->fp_thumb) != 0)
+      RETURN_ERROR("closing thumbnail file", "CloseOutput", false);
+    this->fp_thumb = NULL;
+
+    strcpy (hdr_file_name, this->thumb_file_name);
+    cptr = strrchr (hdr_file_name, '.');
+    strcpy (cptr, ".hdr");
+    fp_hdr = fopen (hdr_file_name, "w");
+    if (fp_hdr == NULL)
+      RETURN_ERROR("opening thumbnail header file", "CloseOutput", false);
+    fprintf (fp_hdr, "ENVI\n");
+    fprintf (fp_hdr, "description = {LEDAPS quick-look thumbnail, bands 3, "
+      "2, 1}\n");
+    fprintf (fp_hdr, "samples = %d\n", this->size.s);
+    fprintf (fp_hdr, "lines = %d\n", this->size.l);
+    fprintf (fp_hdr, "bands = %d\n", THUMB_NBANDS);
+    fprintf (fp_hdr, "header offset = 0\n");
+    fprintf (fp_hdr, "file type = ENVI Standard\n");
+    fprintf (fp_hdr, "data type = 1\n");
+    fprintf (fp_hdr, "interleave = bip\n");
+    fprintf (fp_hdr, "byte order = 0\n");
+    fprintf (fp_hdr, "band names = {band 3, band 2, band 1}\n");
+    if (fclose (fp_hdr) != 0)
+      RETURN_ERROR("closing thumbnail header file", "CloseOutput", false);
+  }
+
   this->open = false;
   return true;
 }
@@ -266,6 +321,7 @@ bool FreeOutput(Output_t *this)
   if (this->open) 
     RETURN_ERROR("file still open", "FreeOutput", false);
 
+  free(this->thumb_line);
   free(this);
   this = NULL;
 
@@ -335,7 +391,66 @@ bool PutOutputLine(Output_t *this, int iband, int iline, int16 *line)
   if (write_raw_binary (this->fp_bin[iband], 1, this->size.s, nbytes, void_buf)
       != SUCCESS)
     RETURN_ERROR("writing output line", "PutOutputLine", false);
+  this->nbytes_written += (long long)this->size.s * nbytes;
 
   return true;
 }
 
+
+bool PutThumbnailLine(Output_t *this, int iline, int16 **line)
+/* 
+!C******************************************************************************
+
+!Description: 'PutThumbnailLine' writes a line of the quick-look thumbnail
+ from the surface reflectance of bands 3, 2, and 1.
+ 
+!Input Parameters:
+ this           'output' data structure
+ iline          output line number (used for validation only)
+ line           output lines of data for all the bands; bands 1, 2, and 3
+                are the first three
+
+!Output Parameters:
+ (returns)      status:
+                  'true' = okay
+                  'false' = error return
+
+!Team Unique Header:
+
+ ! Design Notes:
+   1. Fill and negative pixels are black.
+
+!END****************************************************************************
+*/
+{
+  int is, ib;
+  int val;
+  int16 *rgb_line[THUMB_NBANDS];
+
+  if (this == NULL || this->fp_thumb == NULL) 
+    RETURN_ERROR("thumbnail not open", "PutThumbnailLine", false);
+  if (iline < 0 || iline >= this->size.l)
+    RETURN_ERROR("invalid line number", "PutThumbnailLine", false);
+
+  rgb_line[0] = line[2];
+  rgb_line[1] = line[1];
+  rgb_line[2] = line[0];
+  for (is = 0; is < this->size.s; is++) {
+    for (ib = 0; ib < THUMB_NBANDS; ib++) {
+      val = rgb_line[ib][is];
+      if (val <= 0)
+        val = 0;
+      else if (val >= THUMB_MAX_REFL)
+        val = 255;
+      else
+        val = val * 255 / THUMB_MAX_REFL;
+      this->thumb_line[is * THUMB_NBANDS + ib] = (uint8)val;
+    }
+  }
+
+  if (fwrite(this->thumb_line, THUMB_NBANDS, (size_t)this->size.s,
+             this->fp_thumb) != (size_t)this->size.s)
+    RETURN_ERROR("writing thumbnail line", "PutThumbnailLine", false);
+
+  return true;
+}
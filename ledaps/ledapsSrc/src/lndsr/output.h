@@ -49,6 +49,12 @@
 #include "espa_metadata.h"
 #include "raw_binary_io.h"
 
+/* Thumbnail written for a quick look: an 8-bit RGB image of bands 3, 2, and
+   1, interleaved by pixel, with surface reflectance from 0 to
+   THUMB_MAX_REFL (scaled) stretched over 0 to 255 */
+#define THUMB_NBANDS (3)
+#define THUMB_MAX_REFL (3000)
+
 /* Structure for the 'output' data type */
 
 typedef struct {
@@ -60,6 +66,11 @@ typedef struct {
                            metadata for the output bands; global metadata
                            won't be valid */
   FILE *fp_bin[NBAND_SR_MAX];  /* File pointer for binary files */
+  FILE *fp_thumb;       /* File pointer for the quick-look thumbnail; NULL
+                           if not a quick look */
+  char thumb_file_name[STR_SIZE];  /* Name of the thumbnail file */
+  uint8 *thumb_line;    /* Buffer for a line of the thumbnail */
+  long long nbytes_written;  /* Bytes written to the output bands */
 } Output_t;
 
 /* Prototypes */
@@ -67,6 +78,7 @@ typedef struct {
 Output_t *OpenOutput(Espa_internal_meta_t *in_meta, Input_t *input,
   Param_t *param, Lut_t *lut);
 bool PutOutputLine(Output_t *this, int iband, int iline, int16 *line);
+bool PutThumbnailLine(Output_t *this, int iline, int16 **line);
 bool CloseOutput(Output_t *this);
 bool FreeOutput(Output_t *this);
 
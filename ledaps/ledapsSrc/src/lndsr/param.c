@@ -108,16 +108,22 @@ Param_t *GetParam(int argc, char *argv[])
   Param_key_t param_key;
   char *param_file_name = NULL;
   bool got_start, got_end;
+  int quicklook = 1;               /* reduction factor for a quick look */
+  char extra;                      /* extra character after the factor */
 
   int c;                           /* current argument index */
   int option_index;                /* index for the command-line option */
   static int version_flag=0;       /* flag to print version number instead
                                       of processing */ 
+  static int calibrate_flag=0;     /* flag to calibrate the Level-1 bands
+                                      instead of reading the TOA bands */
   static struct option long_options[] =
   {
       {"pfile", required_argument, 0, 'p'},
+      {"quicklook", required_argument, 0, 'q'},
       {"help", no_argument, 0, 'h'},
       {"version", no_argument, &version_flag, 1},
+      {"calibrate", no_argument, &calibrate_flag, 1},
       {0, 0, 0, 0}
   };
 
@@ -149,6 +155,15 @@ Param_t *GetParam(int argc, char *argv[])
         param_file_name = strdup (optarg);
         break;
 
+      case 'q':  /* quick-look reduction factor */
+        if (sscanf (optarg, "%d%c", &quicklook, &extra) != 1 ||
+            quicklook < 1 || quicklook > MAX_QUICKLOOK) {
+          sprintf (temp, "Invalid quick-look factor %s; must be from 1 to %d",
+            optarg, MAX_QUICKLOOK);
+          RETURN_ERROR(temp, "GetParam", NULL);
+        }
+        break;
+
       case '?':
       default:
         sprintf (temp, "Unknown option %s", argv[optind-1]);
@@ -191,6 +206,8 @@ Param_t *GetParam(int argc, char *argv[])
   this->dem_file = NULL;
   this->dem_flag = false;
   this->thermal_band=false;              /* is the thermal band available */
+  this->quicklook = quicklook;           /* quick-look reduction factor */
+  this->calibrate = calibrate_flag;      /* calibrate the Level-1 bands */
 
   /* Populate the data structure */
   this->param_file_name = DupString(param_file_name);
@@ -65,6 +65,9 @@
 #include "bool.h"
 #include "lndpm.h"  /* For version number */
 
+/* Maximum reduction factor for a quick look */
+#define MAX_QUICKLOOK (32)
+
 /* Parameter data structure type definition */
 
 typedef struct {
@@ -80,6 +83,10 @@ typedef struct {
   int  num_ozon_files;        /* number of Ozone hdf files */
   char *dem_file;             /* DEM file name */
   bool dem_flag;              /* false if not present use default */
+  int quicklook;              /* Reduction factor for a quick look of the
+                                 scene; 1 is full resolution */
+  bool calibrate;             /* Calibrate the Level-1 bands as they are read
+                                 instead of reading the lndcal TOA bands */
 } Param_t;
 
 /* Prototypes */
@@ -0,0 +1,275 @@
+/*
+!C****************************************************************************
+
+!File: test_ar_gaps.c
+
+!Description: Randomized check of Fill_Ar_Gaps (ar.c) against the original
+ version of the routine, which rescanned the whole aerosol grid on each
+ pass.  Built and run by 'make check'.
+
+!Team Unique Header:
+
+ ! Design Notes:
+   1. The grids are generated with a fixed seed, so each run checks the same
+      grids.  They range from 1 x 1 to MAX_GRID x MAX_GRID points, with the
+      gaps scattered at random, in a disc, in blocks, or covering nearly all
+      of the grid, so the single valid value, the unfilled gaps, and the
+      many pass cases are all covered.
+   2. The check fails if any point of any grid differs from the original.
+   3. ar.c is linked as is, so the lndsr routines it calls are stubbed
+      here; none of them are reached by Fill_Ar_Gaps.
+
+!END****************************************************************************
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "ar.h"
+
+/* Number of grids checked and the maximum grid size */
+#define NGRIDS 3000
+#define MAX_GRID 60
+
+/* Number of bands in each aerosol grid line; the gaps are filled in one,
+   and the others are checked to be left alone */
+#define NBANDS 3
+
+/* Aerosol fill value of the grids */
+#define AR_FILL (-1)
+
+/* Stubs for the lndsr routines called by ar.c */
+int allocate_mem_atmos_coeff(int nbpts, atmos_t *atmos_coef)
+{
+  return -1;
+}
+
+int free_mem_atmos_coeff(atmos_t *atmos_coef)
+{
+  return -1;
+}
+
+int update_gridcell_atmos_coefs(int irow, int icol, atmos_t *atmos_coef,
+  Ar_gridcell_t *ar_gridcell, sixs_tables_t *sixs_tables, int **line_ar,
+  Lut_t *lut, int nband, int bkgd_aerosol)
+{
+  return -1;
+}
+
+/* Random numbers from a fixed generator, so the grids don't depend on the
+   C library */
+static unsigned long seed = 7;
+
+static int next_random(int n)
+{
+  seed = seed * 1103515245UL + 12345UL;
+  return (int)((seed >> 16) & 0x7fff) % n;
+}
+
+static int ref_fill_ar_gaps(Lut_t *lut, int ***line_ar, int ib)
+/*
+!C******************************************************************************
+
+!Description: 'ref_fill_ar_gaps' is the original Fill_Ar_Gaps.  Each pass
+ rescans the whole grid for the gaps, and fills each gap with at least 3
+ valid values within 3 grid points (as of the start of the pass) with their
+ distance weighted average.  The gaps left when a pass fills nothing are set
+ to 60.
+
+!END****************************************************************************
+*/
+{
+  int i, j, k, l, count, more_gaps, nbfills;
+  int last_value = -99;
+  float dist, sum_value, sum_dist;
+  char *missing_flag;
+  int n;
+  const int min_nb_values = 3;
+  const int max_distance = 3;
+
+  missing_flag = calloc(lut->ar_size.l * lut->ar_size.s, sizeof(char));
+  if (missing_flag == NULL)
+    return 0;
+
+  count = 0;
+  for (i = 0; i < lut->ar_size.l; i++)
+    for (j = 0; j < lut->ar_size.s; j++)
+      if (line_ar[i][ib][j] != lut->aerosol_fill) {
+        count++;
+        last_value = line_ar[i][ib][j];
+      }
+  if (count == 0) {
+    free(missing_flag);
+    return 0;
+  }
+  if (count == 1) {
+    for (i = 0; i < lut->ar_size.l; i++)
+      for (j = 0; j < lut->ar_size.s; j++)
+        line_ar[i][ib][j] = last_value;
+    free(missing_flag);
+    return 0;
+  }
+
+  more_gaps = 1;
+  nbfills = 1;
+  while (more_gaps && nbfills != 0) {
+    more_gaps = 0;
+    nbfills = 0;
+    for (i = 0; i < lut->ar_size.l; i++)
+      for (j = 0; j < lut->ar_size.s; j++) {
+        missing_flag[i * lut->ar_size.s + j] = 0;
+        if (line_ar[i][ib][j] == lut->aerosol_fill) {
+          missing_flag[i * lut->ar_size.s + j] = 1;
+          more_gaps = 1;
+        }
+      }
+    if (!more_gaps)
+      break;
+
+    for (i = 0; i < lut->ar_size.l; i++)
+      for (j = 0; j < lut->ar_size.s; j++) {
+        if (!missing_flag[i * lut->ar_size.s + j])
+          continue;
+        sum_dist = 0.;
+        sum_value = 0.;
+        n = 0;
+        for (k = i - max_distance; k <= i + max_distance; k++) {
+          if (k < 0 || k >= lut->ar_size.l)
+            continue;
+          for (l = j - max_distance; l <= j + max_distance; l++) {
+            if (l < 0 || l >= lut->ar_size.s)
+              continue;
+            if (!missing_flag[k * lut->ar_size.s + l]) {
+              dist = sqrt((k - i) * (k - i) + (l - j) * (l - j));
+              sum_dist += dist;
+              sum_value += (dist * line_ar[k][ib][l]);
+              n++;
+            }
+          }
+        }
+        if (n >= min_nb_values && sum_dist != 0.) {
+          line_ar[i][ib][j] = sum_value / sum_dist;
+          nbfills++;
+        }
+      }
+  }
+
+  if (more_gaps && nbfills == 0)
+    for (i = 0; i < lut->ar_size.l; i++)
+      for (j = 0; j < lut->ar_size.s; j++)
+        if (line_ar[i][ib][j] == lut->aerosol_fill)
+          line_ar[i][ib][j] = 60;
+
+  free(missing_flag);
+  return 0;
+}
+
+static int ***alloc_grid(int nl, int ns)
+{
+  int ***grid;
+  int i, ib;
+
+  grid = malloc(nl * sizeof(int **));
+  if (grid == NULL)
+    return NULL;
+  for (i = 0; i < nl; i++) {
+    grid[i] = malloc(NBANDS * sizeof(int *));
+    if (grid[i] == NULL)
+      return NULL;
+    for (ib = 0; ib < NBANDS; ib++) {
+      grid[i][ib] = malloc(ns * sizeof(int));
+      if (grid[i][ib] == NULL)
+        return NULL;
+    }
+  }
+  return grid;
+}
+
+static void free_grid(int ***grid, int nl)
+{
+  int i, ib;
+
+  for (i = 0; i < nl; i++) {
+    for (ib = 0; ib < NBANDS; ib++)
+      free(grid[i][ib]);
+    free(grid[i]);
+  }
+  free(grid);
+}
+
+int main(void)
+{
+  Lut_t lut;
+  int ***ref, ***grid;
+  int igrid, nl, ns, ib, band, mode, i, j;
+  int center_l, center_s, radius, gap;
+  float frac;
+  long ndiff, nbad = 0;
+
+  lut.aerosol_fill = AR_FILL;
+  for (igrid = 0; igrid < NGRIDS; igrid++) {
+    nl = 1 + next_random(MAX_GRID);
+    ns = 1 + next_random(MAX_GRID);
+    band = igrid % NBANDS;
+    mode = next_random(4);
+    frac = next_random(1000) / 1000.0;
+    center_l = next_random(nl + 1);
+    center_s = next_random(ns + 1);
+    radius = next_random(30);
+    lut.ar_size.l = nl;
+    lut.ar_size.s = ns;
+
+    ref = alloc_grid(nl, ns);
+    grid = alloc_grid(nl, ns);
+    if (ref == NULL || grid == NULL) {
+      fprintf(stderr, "test_ar_gaps: allocating the grids\n");
+      return EXIT_FAILURE;
+    }
+
+    for (i = 0; i < nl; i++)
+      for (j = 0; j < ns; j++) {
+        if (mode == 0)        /* scattered */
+          gap = next_random(1000) < frac * 1000;
+        else if (mode == 1)   /* disc */
+          gap = (i - center_l) * (i - center_l) +
+                (j - center_s) * (j - center_s) < radius * radius ||
+                next_random(1000) < frac * 100;
+        else if (mode == 2)   /* nearly empty */
+          gap = next_random(1000) < 980;
+        else                  /* blocks */
+          gap = (i / 5 + j / 7) % 3 == 0 || next_random(1000) < frac * 300;
+        for (ib = 0; ib < NBANDS; ib++)
+          ref[i][ib][j] = grid[i][ib][j] = next_random(3000);
+        if (gap)
+          ref[i][band][j] = grid[i][band][j] = AR_FILL;
+      }
+
+    ref_fill_ar_gaps(&lut, ref, band);
+    Fill_Ar_Gaps(&lut, grid, band);
+
+    ndiff = 0;
+    for (i = 0; i < nl; i++)
+      for (j = 0; j < ns; j++)
+        for (ib = 0; ib < NBANDS; ib++)
+          if (ref[i][ib][j] != grid[i][ib][j])
+            ndiff++;
+    if (ndiff > 0) {
+      if (nbad < 5)
+        printf("test_ar_gaps: grid %d (%d x %d, mode %d): %ld points "
+               "differ\n", igrid, nl, ns, mode, ndiff);
+      nbad++;
+    }
+
+    free_grid(ref, nl);
+    free_grid(grid, nl);
+  }
+
+  printf("test_ar_gaps: %ld of %d grids differ from the original\n", nbad,
+         NGRIDS);
+  if (nbad > 0) {
+    printf("test_ar_gaps: FAILED\n");
+    return EXIT_FAILURE;
+  }
+  printf("test_ar_gaps: passed\n");
+  return EXIT_SUCCESS;
+}
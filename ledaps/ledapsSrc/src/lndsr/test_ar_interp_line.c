@@ -0,0 +1,205 @@
+/*
+!C****************************************************************************
+
+!File: test_ar_interp_line.c
+
+!Description: Randomized check of ArInterpLine (ar.c) against ArInterp, the
+ per-pixel interpolation it replaced in the lndsr main loop.  Built and run
+ by 'make check'.
+
+!Team Unique Header:
+
+ ! Design Notes:
+   1. The cases are generated with a fixed seed, so each run checks the same
+      cases.  The aerosol region sizes range from 1 to MAX_REGION lines and
+      samples (not always square), and include the full resolution and
+      quick-look sizes set by lut.c.  The image sizes are picked so the last
+      aerosol row/column is sometimes full and sometimes partial, and the
+      aerosol grid is sometimes a single row or column, so the clamping of
+      the last row/column is covered along with the interior.
+   2. The aerosol values are fill at a random fraction of the grid points,
+      from none to all of them, so the fill handling and the all-fill
+      neighbourhoods are covered.
+   3. Every pixel of every line of the image is compared, and the check
+      fails if any pixel differs from ArInterp.
+   4. ar.c is linked as is, so the lndsr routines it calls are stubbed
+      here; none of them are reached by the interpolation.
+
+!END****************************************************************************
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "ar.h"
+
+/* Number of cases checked, and the largest aerosol region and aerosol grid
+   sizes */
+#define NCASES 2000
+#define MAX_REGION 45
+#define MAX_AR_SIZE 12
+
+/* Aerosol fill value, as set by lut.c */
+#define AR_FILL (-9999)
+
+/* Region sizes always included in the cases: the full resolution size and
+   the smallest quick-look size set by lut.c */
+static int fixed_regions[] = {40, 5};
+#define NFIXED_REGIONS ((int)(sizeof(fixed_regions) / sizeof(fixed_regions[0])))
+
+/* Stubs for the lndsr routines called by ar.c */
+int allocate_mem_atmos_coeff(int nbpts, atmos_t *atmos_coef)
+{
+  return -1;
+}
+
+int free_mem_atmos_coeff(atmos_t *atmos_coef)
+{
+  return -1;
+}
+
+int update_gridcell_atmos_coefs(int irow, int icol, atmos_t *atmos_coef,
+  Ar_gridcell_t *ar_gridcell, sixs_tables_t *sixs_tables, int **line_ar,
+  Lut_t *lut, int nband, int bkgd_aerosol)
+{
+  return -1;
+}
+
+/* Random numbers from a fixed generator, so the cases don't depend on the
+   C library */
+static unsigned long seed = 11;
+
+static int next_random(int n)
+{
+  seed = seed * 1103515245UL + 12345UL;
+  return (int)((seed >> 16) & 0x7fff) % n;
+}
+
+static int pick_image_size(int region)
+/*
+!C******************************************************************************
+
+!Description: 'pick_image_size' picks the number of lines (or samples) of
+ an image for an aerosol region size: a whole number of regions, one pixel
+ into the next region, or anything in between.
+
+!END****************************************************************************
+*/
+{
+  int nregions = 1 + next_random(MAX_AR_SIZE);
+
+  switch (next_random(3)) {
+    case 0:
+      return nregions * region;
+    case 1:
+      return (nregions - 1) * region + 1;
+    default:
+      return (nregions - 1) * region + 1 + next_random(region);
+  }
+}
+
+static int ***alloc_grid(int nl, int ns)
+{
+  int ***grid;
+  int i;
+
+  grid = malloc(nl * sizeof(int **));
+  if (grid == NULL)
+    return NULL;
+  for (i = 0; i < nl; i++) {
+    grid[i] = malloc(sizeof(int *));
+    if (grid[i] == NULL)
+      return NULL;
+    grid[i][0] = malloc(ns * sizeof(int));
+    if (grid[i][0] == NULL)
+      return NULL;
+  }
+  return grid;
+}
+
+static void free_grid(int ***grid, int nl)
+{
+  int i;
+
+  for (i = 0; i < nl; i++) {
+    free(grid[i][0]);
+    free(grid[i]);
+  }
+  free(grid);
+}
+
+int main(void)
+{
+  Lut_t lut;
+  Img_coord_int_t loc;
+  int ***grid;
+  int16 *line_aot;
+  int icase, nlines, nsamps, il, is, i, j, ref_aot, fill_frac;
+  long npix = 0, nfill = 0, ndiff, nbad = 0;
+
+  lut.aerosol_fill = AR_FILL;
+  for (icase = 0; icase < NCASES; icase++) {
+    if (icase < NFIXED_REGIONS * 10) {
+      lut.ar_region_size.l = fixed_regions[icase % NFIXED_REGIONS];
+      lut.ar_region_size.s = lut.ar_region_size.l;
+    } else {
+      lut.ar_region_size.l = 1 + next_random(MAX_REGION);
+      lut.ar_region_size.s = next_random(2) ? lut.ar_region_size.l :
+                             1 + next_random(MAX_REGION);
+    }
+    nlines = pick_image_size(lut.ar_region_size.l);
+    nsamps = pick_image_size(lut.ar_region_size.s);
+
+    /* Same as lut.c */
+    lut.ar_size.l = ((nlines - 1) / lut.ar_region_size.l) + 1;
+    lut.ar_size.s = ((nsamps - 1) / lut.ar_region_size.s) + 1;
+
+    grid = alloc_grid(lut.ar_size.l, lut.ar_size.s);
+    line_aot = malloc(nsamps * sizeof(int16));
+    if (grid == NULL || line_aot == NULL) {
+      fprintf(stderr, "test_ar_interp_line: allocating the grids\n");
+      return EXIT_FAILURE;
+    }
+
+    fill_frac = (icase % 10 == 9) ? 1000 : next_random(4) * 250;
+    for (i = 0; i < lut.ar_size.l; i++)
+      for (j = 0; j < lut.ar_size.s; j++)
+        grid[i][0][j] = (next_random(1000) < fill_frac) ? AR_FILL :
+                        next_random(3000);
+
+    ndiff = 0;
+    for (il = 0; il < nlines; il++) {
+      ArInterpLine(&lut, il, nsamps, grid, line_aot);
+      loc.l = il;
+      for (is = 0; is < nsamps; is++) {
+        loc.s = is;
+        ArInterp(&lut, &loc, grid, &ref_aot);
+        if (line_aot[is] != (int16)ref_aot) {
+          if (nbad + ndiff < 5)
+            printf("test_ar_interp_line: case %d (region %d x %d, image "
+                   "%d x %d) line %d sample %d: %d, ArInterp %d\n", icase,
+                   lut.ar_region_size.l, lut.ar_region_size.s, nlines,
+                   nsamps, il, is, line_aot[is], ref_aot);
+          ndiff++;
+        }
+        if (ref_aot == AR_FILL)
+          nfill++;
+        npix++;
+      }
+    }
+    if (ndiff > 0)
+      nbad++;
+
+    free_grid(grid, lut.ar_size.l);
+    free(line_aot);
+  }
+
+  printf("test_ar_interp_line: %d cases, %ld pixels (%ld fill): %ld cases "
+         "differ from ArInterp\n", NCASES, npix, nfill, nbad);
+  if (nbad > 0) {
+    printf("test_ar_interp_line: FAILED\n");
+    return EXIT_FAILURE;
+  }
+  printf("test_ar_interp_line: passed\n");
+  return EXIT_SUCCESS;
+}
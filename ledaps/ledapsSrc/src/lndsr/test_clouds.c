@@ -0,0 +1,417 @@
+/*
+!C****************************************************************************
+
+!File: test_clouds.c
+
+!Description: Randomized check that the cloud detection passes (clouds.c)
+ give the same results whatever the number of threads.  Built and run by
+ 'make check'.
+
+!Team Unique Header:
+
+ ! Design Notes:
+   1. The scenes are generated with a fixed seed, so each run checks the
+      same scenes.  They have random band values, thermal values, and QA
+      (fill and saturated bands 3 and 5), for TM and ETM+, with the aerosol
+      region and cloud diagnostic cell sizes used by lndsr and smaller ones,
+      and scene sizes which leave partial regions and cells at the end.  The
+      cells are at least 3 lines/samples, since fill_cld_diags handles at
+      most 300 x 300 cells.
+   2. cloud_detection_pass1 is run over the scene a block of aerosol region
+      lines at a time, as in lndsr, with one thread and with TEST_NTHREADS
+      threads.  It is also run one line at a time on one thread, which adds
+      the pixels of each cell in the order of the original line by line
+      pass.  The sums and counts of the cloud diagnostics must match bit for
+      bit.
+   3. The cloud diagnostics are then finished as in lndsr, and
+      cloud_detection_pass2 is run the same three ways, with and without the
+      thermal band.  The cloud screening lines must match exactly.
+   4. The atmospheric coefficients are computed at every aerosol grid point,
+      as they are by lndsr before the cloud detection.
+   5. Without OpenMP the threaded runs are single threaded, so only the
+      blocks are checked against the line by line runs.
+   6. clouds.c and sr.c are linked as is, so the lndsr routines they call
+      are defined here.
+
+!END****************************************************************************
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "clouds.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/* Number of scenes checked, the largest scene size, and the number of
+   threads of the threaded runs */
+#define NSCENES 40
+#define MAX_SIZE 700
+#define TEST_NTHREADS 4
+
+/* Input fill value of the thermal band */
+#define IN_FILL (-9999)
+
+/* Number of reflectance bands read by the cloud detection */
+#define NBAND 6
+
+/* Atmospheric coefficients of the aerosol grid, as computed by lndsr */
+atmos_t atmos_coef;
+
+/* The lndsr routines called by clouds.c and sr.c */
+int allocate_mem_atmos_coeff(int nbpts, atmos_t *atmos_coef)
+{
+  float **coef[] = {atmos_coef->tgOG, atmos_coef->tgH2O, atmos_coef->td_ra,
+    atmos_coef->tu_ra, atmos_coef->rho_mol, atmos_coef->rho_ra,
+    atmos_coef->td_da, atmos_coef->tu_da, atmos_coef->S_ra,
+    atmos_coef->td_r, atmos_coef->tu_r, atmos_coef->S_r, atmos_coef->rho_r};
+  int i, ib;
+
+  if ((atmos_coef->computed = calloc(nbpts, sizeof(int))) == NULL)
+    return -1;
+  if ((atmos_coef->rayleigh_nband = calloc(nbpts, sizeof(int))) == NULL)
+    return -1;
+  for (i = 0; i < (int)(sizeof(coef) / sizeof(coef[0])); i++)
+    for (ib = 0; ib < 7; ib++)
+      if ((coef[i][ib] = calloc(nbpts, sizeof(float))) == NULL)
+        return -1;
+  return 0;
+}
+
+int free_mem_atmos_coeff(atmos_t *atmos_coef)
+{
+  float **coef[] = {atmos_coef->tgOG, atmos_coef->tgH2O, atmos_coef->td_ra,
+    atmos_coef->tu_ra, atmos_coef->rho_mol, atmos_coef->rho_ra,
+    atmos_coef->td_da, atmos_coef->tu_da, atmos_coef->S_ra,
+    atmos_coef->td_r, atmos_coef->tu_r, atmos_coef->S_r, atmos_coef->rho_r};
+  int i, ib;
+
+  free(atmos_coef->computed);
+  free(atmos_coef->rayleigh_nband);
+  for (i = 0; i < (int)(sizeof(coef) / sizeof(coef[0])); i++)
+    for (ib = 0; ib < 7; ib++)
+      free(coef[i][ib]);
+  return 0;
+}
+
+/* Random numbers from a fixed generator, so the scenes don't depend on the
+   C library */
+static unsigned long seed = 11;
+
+static int next_random(int n)
+{
+  seed = seed * 1103515245UL + 12345UL;
+  return (int)((seed >> 16) & 0x7fff) % n;
+}
+
+static float random_range(float lo, float hi)
+{
+  return lo + (hi - lo) * next_random(10000) / 10000.0;
+}
+
+static void set_threads(int nthreads)
+{
+#ifdef _OPENMP
+  omp_set_num_threads(nthreads);
+#endif
+}
+
+static bool alloc_cld_diags(cld_diags_t *cld_diags, int cell, int nlines,
+  int nsamps)
+{
+  return allocate_cld_diags(cld_diags, cell, cell, nlines, nsamps) == 0;
+}
+
+static void finish_cld_diags(cld_diags_t *cld_diags)
+/*
+!C******************************************************************************
+
+!Description: 'finish_cld_diags' turns the sums of the clear pixels into the
+ means and standard deviations, and fills the cells without clear pixels,
+ as lndsr does between the two cloud detection passes.
+
+!END****************************************************************************
+*/
+{
+  int i, j, n;
+  float sum, sumsq;
+
+  for (i = 0; i < cld_diags->nbrows; i++) {
+    for (j = 0; j < cld_diags->nbcols; j++) {
+      cld_diags->airtemp_2m[i][j] = random_range(275.0, 305.0);
+      n = cld_diags->nb_t6_clear[i][j];
+      if (n > 0) {
+        sum = cld_diags->avg_t6_clear[i][j];
+        sumsq = cld_diags->std_t6_clear[i][j];
+        cld_diags->avg_t6_clear[i][j] = sum / n;
+        cld_diags->std_t6_clear[i][j] = (n > 1) ?
+          sqrt(fabs((sumsq - (sum * sum) / n) / (n - 1))) : 0.;
+        sum = cld_diags->avg_b7_clear[i][j];
+        sumsq = cld_diags->std_b7_clear[i][j];
+        cld_diags->avg_b7_clear[i][j] = sum / n;
+        cld_diags->std_b7_clear[i][j] = (n > 1) ?
+          sqrt(fabs((sumsq - (sum * sum) / n) / (n - 1))) : 0.;
+      } else {
+        cld_diags->avg_t6_clear[i][j] = -9999.;
+        cld_diags->avg_b7_clear[i][j] = -9999.;
+        cld_diags->std_t6_clear[i][j] = -9999.;
+        cld_diags->std_b7_clear[i][j] = -9999.;
+      }
+    }
+  }
+  fill_cld_diags(cld_diags);
+}
+
+static long compare_cld_diags(cld_diags_t *a, cld_diags_t *b, int iscene,
+  char *run, long nprev)
+/*
+!C******************************************************************************
+
+!Description: 'compare_cld_diags' compares the sums and counts of two cloud
+ diagnostics bit for bit, and returns the number of cells which differ.  The
+ first few differences over all the calls are printed.
+
+!END****************************************************************************
+*/
+{
+  int i, j;
+  long ndiff = 0;
+
+  for (i = 0; i < a->nbrows; i++) {
+    for (j = 0; j < a->nbcols; j++) {
+      if (a->nb_t6_clear[i][j] != b->nb_t6_clear[i][j] ||
+          memcmp(&a->avg_t6_clear[i][j], &b->avg_t6_clear[i][j],
+            sizeof(float)) ||
+          memcmp(&a->std_t6_clear[i][j], &b->std_t6_clear[i][j],
+            sizeof(float)) ||
+          memcmp(&a->avg_b7_clear[i][j], &b->avg_b7_clear[i][j],
+            sizeof(float)) ||
+          memcmp(&a->std_b7_clear[i][j], &b->std_b7_clear[i][j],
+            sizeof(float))) {
+        if (nprev + ndiff < 3)
+          printf("test_clouds: scene %d pass 1 (%s) cell %d,%d: %d %.9g "
+                 "%.9g %.9g %.9g, line by line %d %.9g %.9g %.9g %.9g\n",
+                 iscene, run, i, j, a->nb_t6_clear[i][j],
+                 a->avg_t6_clear[i][j], a->std_t6_clear[i][j],
+                 a->avg_b7_clear[i][j], a->std_b7_clear[i][j],
+                 b->nb_t6_clear[i][j], b->avg_t6_clear[i][j],
+                 b->std_t6_clear[i][j], b->avg_b7_clear[i][j],
+                 b->std_b7_clear[i][j]);
+        ndiff++;
+      }
+    }
+  }
+  return ndiff;
+}
+
+int main(void)
+{
+  Lut_t lut;
+  cld_diags_t ref_diags, diags[2];
+  int16 ***line_in, **b6_line;
+  uint8 **qa_line;
+  float **atemp_line;
+  char **ref_ddv, **ddv[2];
+  int iscene, nlines, nsamps, cell, region, il, is, ib, ipt, run;
+  int il_start, nl, thermal;
+  int nthreads[2] = {1, TEST_NTHREADS};
+  char *run_name[2] = {"1 thread", "threads"};
+  long ncells = 0, npix = 0, nbad = 0, ndiff;
+
+  memset(&lut, 0, sizeof(lut));
+  lut.in_fill = IN_FILL;
+  for (iscene = 0; iscene < NSCENES; iscene++) {
+    /* Region and cell sizes of lndsr, at full resolution and reduced for a
+       quick look, and smaller ones */
+    switch (iscene % 4) {
+      case 0:
+        region = 40;
+        cell = CLDDIAGS_CELLHEIGHT_5KM;
+        break;
+      case 1:
+        region = 40;
+        cell = CLDDIAGS_CELLHEIGHT_5KM / 4;
+        break;
+      default:
+        region = 1 + next_random(45);
+        cell = 3 + next_random(100);
+        break;
+    }
+    nlines = 1 + next_random(MAX_SIZE);
+    nsamps = 1 + next_random(MAX_SIZE);
+    lut.meta.inst = (iscene % 2) ? INST_ETM : INST_TM;
+    lut.ar_region_size.l = region;
+    lut.ar_region_size.s = region;
+    lut.ar_size.l = (nlines - 1) / region + 1;
+    lut.ar_size.s = (nsamps - 1) / region + 1;
+
+    /* Atmospheric coefficients at every aerosol grid point */
+    if (allocate_mem_atmos_coeff(lut.ar_size.l * lut.ar_size.s, &atmos_coef)) {
+      printf("test_clouds: allocating the atmospheric coefficients\n");
+      return EXIT_FAILURE;
+    }
+    for (ipt = 0; ipt < lut.ar_size.l * lut.ar_size.s; ipt++) {
+      atmos_coef.computed[ipt] = 1;
+      for (ib = 0; ib < NBAND; ib++) {
+        atmos_coef.tgOG[ib][ipt] = random_range(0.9, 1.0);
+        atmos_coef.tgH2O[ib][ipt] = random_range(0.85, 1.0);
+        atmos_coef.td_ra[ib][ipt] = random_range(0.7, 0.95);
+        atmos_coef.tu_ra[ib][ipt] = random_range(0.7, 0.95);
+        atmos_coef.rho_ra[ib][ipt] = random_range(0.0, 0.1);
+        atmos_coef.S_ra[ib][ipt] = random_range(0.05, 0.2);
+      }
+    }
+
+    /* Scene lines, with a region's worth of lines a block */
+    line_in = malloc(nlines * sizeof(int16 **));
+    qa_line = malloc(nlines * sizeof(uint8 *));
+    b6_line = malloc(nlines * sizeof(int16 *));
+    atemp_line = malloc(nlines * sizeof(float *));
+    ref_ddv = malloc(nlines * sizeof(char *));
+    ddv[0] = malloc(nlines * sizeof(char *));
+    ddv[1] = malloc(nlines * sizeof(char *));
+    if (line_in == NULL || qa_line == NULL || b6_line == NULL ||
+        atemp_line == NULL || ref_ddv == NULL || ddv[0] == NULL ||
+        ddv[1] == NULL) {
+      printf("test_clouds: allocating the scene\n");
+      return EXIT_FAILURE;
+    }
+    for (il = 0; il < nlines; il++) {
+      line_in[il] = malloc(NBAND * sizeof(int16 *));
+      qa_line[il] = malloc(nsamps * sizeof(uint8));
+      b6_line[il] = malloc(nsamps * sizeof(int16));
+      atemp_line[il] = malloc(nsamps * sizeof(float));
+      ref_ddv[il] = malloc(nsamps);
+      ddv[0][il] = malloc(nsamps);
+      ddv[1][il] = malloc(nsamps);
+      if (line_in[il] == NULL || qa_line[il] == NULL || b6_line[il] == NULL ||
+          atemp_line[il] == NULL || ref_ddv[il] == NULL ||
+          ddv[0][il] == NULL || ddv[1][il] == NULL) {
+        printf("test_clouds: allocating the scene\n");
+        return EXIT_FAILURE;
+      }
+      for (ib = 0; ib < NBAND; ib++) {
+        line_in[il][ib] = malloc(nsamps * sizeof(int16));
+        if (line_in[il][ib] == NULL) {
+          printf("test_clouds: allocating the scene\n");
+          return EXIT_FAILURE;
+        }
+        for (is = 0; is < nsamps; is++)
+          line_in[il][ib][is] = next_random(8) ? next_random(4000) :
+                                next_random(10000);
+      }
+      for (is = 0; is < nsamps; is++) {
+        qa_line[il][is] = 0;
+        if (next_random(20) == 0)
+          qa_line[il][is] |= 0x01;
+        if (next_random(10) == 0)
+          qa_line[il][is] |= 0x08;
+        if (next_random(10) == 0)
+          qa_line[il][is] |= 0x20;
+        b6_line[il][is] = next_random(50) ? 2500 + next_random(700) : IN_FILL;
+        atemp_line[il][is] = random_range(275.0, 305.0);
+      }
+    }
+
+    /* Pass 1 line by line on one thread, and a block at a time on one and
+       several threads */
+    if (!alloc_cld_diags(&ref_diags, cell, nlines, nsamps) ||
+        !alloc_cld_diags(&diags[0], cell, nlines, nsamps) ||
+        !alloc_cld_diags(&diags[1], cell, nlines, nsamps)) {
+      printf("test_clouds: allocating the cloud diagnostics\n");
+      return EXIT_FAILURE;
+    }
+    set_threads(1);
+    for (il = 0; il < nlines; il++)
+      cloud_detection_pass1(&lut, nsamps, il, 1, &line_in[il], &qa_line[il],
+        &b6_line[il], &atemp_line[il], &ref_diags);
+    for (run = 0; run < 2; run++) {
+      set_threads(nthreads[run]);
+      for (il_start = 0; il_start < nlines; il_start += region) {
+        nl = (il_start + region <= nlines) ? region : nlines - il_start;
+        cloud_detection_pass1(&lut, nsamps, il_start, nl, &line_in[il_start],
+          &qa_line[il_start], &b6_line[il_start], &atemp_line[il_start],
+          &diags[run]);
+      }
+      nbad += compare_cld_diags(&diags[run], &ref_diags, iscene,
+        run_name[run], nbad);
+      ncells += ref_diags.nbrows * ref_diags.nbcols;
+    }
+
+    /* Pass 2 the same ways, using the finished diagnostics of the line by
+       line run, with and without the thermal band */
+    finish_cld_diags(&ref_diags);
+    for (thermal = 0; thermal < 2; thermal++) {
+      for (il = 0; il < nlines; il++) {
+        memset(ref_ddv[il], 0, nsamps);
+        memset(ddv[0][il], 0, nsamps);
+        memset(ddv[1][il], 0, nsamps);
+      }
+      set_threads(1);
+      for (il = 0; il < nlines; il++)
+        cloud_detection_pass2(&lut, nsamps, il, 1, &line_in[il], &qa_line[il],
+          thermal ? &b6_line[il] : NULL, &ref_diags, &ref_ddv[il]);
+      for (run = 0; run < 2; run++) {
+        set_threads(nthreads[run]);
+        for (il_start = 0; il_start < nlines; il_start += region) {
+          nl = (il_start + region <= nlines) ? region : nlines - il_start;
+          cloud_detection_pass2(&lut, nsamps, il_start, nl,
+            &line_in[il_start], &qa_line[il_start],
+            thermal ? &b6_line[il_start] : NULL, &ref_diags,
+            &ddv[run][il_start]);
+        }
+        for (il = 0; il < nlines; il++) {
+          ndiff = 0;
+          for (is = 0; is < nsamps; is++) {
+            if (ddv[run][il][is] != ref_ddv[il][is]) {
+              if (nbad + ndiff < 3)
+                printf("test_clouds: scene %d pass 2 (%s, %s) pixel %d,%d: "
+                       "0x%02x, line by line 0x%02x\n", iscene,
+                       run_name[run], thermal ? "thermal" : "no thermal", il,
+                       is, (unsigned char)ddv[run][il][is],
+                       (unsigned char)ref_ddv[il][is]);
+              ndiff++;
+            }
+          }
+          nbad += ndiff;
+        }
+        npix += (long)nlines * nsamps;
+      }
+    }
+
+    free_cld_diags(&ref_diags);
+    free_cld_diags(&diags[0]);
+    free_cld_diags(&diags[1]);
+    for (il = 0; il < nlines; il++) {
+      for (ib = 0; ib < NBAND; ib++)
+        free(line_in[il][ib]);
+      free(line_in[il]);
+      free(qa_line[il]);
+      free(b6_line[il]);
+      free(atemp_line[il]);
+      free(ref_ddv[il]);
+      free(ddv[0][il]);
+      free(ddv[1][il]);
+    }
+    free(line_in);
+    free(qa_line);
+    free(b6_line);
+    free(atemp_line);
+    free(ref_ddv);
+    free(ddv[0]);
+    free(ddv[1]);
+    free_mem_atmos_coeff(&atmos_coef);
+  }
+
+  printf("test_clouds: %d scenes, %ld pass 1 cells and %ld pass 2 pixels "
+         "compared, %ld differ from the line by line runs (%d threads)\n",
+         NSCENES, ncells, npix, nbad, TEST_NTHREADS);
+  if (nbad > 0) {
+    printf("test_clouds: FAILED\n");
+    return EXIT_FAILURE;
+  }
+  printf("test_clouds: passed\n");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,102 @@
+/*
+!C****************************************************************************
+
+!File: test_rayleigh.c
+
+!Description: Check of the Rayleigh routines of rayleigh.c against the 6S
+ Fortran routines they were ported from (6sV-1.0B CHAND.f and CSALBR.f).
+ Built and run by 'make check'.
+
+!Team Unique Header:
+
+ ! Design Notes:
+   1. The points cover the relative azimuth (0 to 360 degrees), view zenith
+      (0 to 15 degrees), sun zenith (0 to 75 degrees), and molecular optical
+      depth (2e-4 to 1.5) ranges used by lndsr and LaSRC.
+   2. The check fails if the reflectance or spherical albedo of any point
+      differs from the Fortran by more than MAX_REL_DIFF.
+
+!END****************************************************************************
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "rayleigh.h"
+
+/* Maximum relative difference allowed from the Fortran */
+#define MAX_REL_DIFF 1e-6
+
+/* Number of steps of each angle and of the optical depth */
+#define NPHI 37
+#define NVZEN 16
+#define NSZEN 16
+#define NTAU 20
+#define NPOINTS (NPHI * NVZEN * NSZEN * NTAU)
+
+/* 6S Fortran routines (gfortran calling convention) */
+void chand_(float *xphi, float *xmuv, float *xmus, float *xtau, float *xrray);
+void csalbr_(float *xtau, float *xalb);
+
+int main(void)
+{
+  const float fac = 3.1415927f / 180.0f;
+  float *phi, *muv, *mus, *tau_ray, *rho_ray, *s_r;
+  float f_rho_ray, f_s_r;
+  double diff, max_rho_diff = 0.0, max_s_diff = 0.0;
+  int iphi, ivzen, iszen, itau;
+  int i, n = 0;
+
+  phi = malloc(NPOINTS * sizeof(float));
+  muv = malloc(NPOINTS * sizeof(float));
+  mus = malloc(NPOINTS * sizeof(float));
+  tau_ray = malloc(NPOINTS * sizeof(float));
+  rho_ray = malloc(NPOINTS * sizeof(float));
+  s_r = malloc(NPOINTS * sizeof(float));
+  if (phi == NULL || muv == NULL || mus == NULL || tau_ray == NULL ||
+      rho_ray == NULL || s_r == NULL) {
+    fprintf(stderr, "test_rayleigh: allocating the points\n");
+    return EXIT_FAILURE;
+  }
+
+  for (iphi = 0; iphi < NPHI; iphi++)
+    for (ivzen = 0; ivzen < NVZEN; ivzen++)
+      for (iszen = 0; iszen < NSZEN; iszen++)
+        for (itau = 0; itau < NTAU; itau++) {
+          phi[n] = iphi * 10.0f;
+          muv[n] = cosf(ivzen * fac);
+          mus[n] = cosf(iszen * 5.0f * fac);
+          tau_ray[n] = 0.0002f * powf(1.6f, itau);
+          n++;
+        }
+
+  chand_batch(n, phi, muv, mus, tau_ray, rho_ray);
+  csalbr_batch(n, tau_ray, s_r);
+
+  for (i = 0; i < n; i++) {
+    chand_(&phi[i], &muv[i], &mus[i], &tau_ray[i], &f_rho_ray);
+    csalbr_(&tau_ray[i], &f_s_r);
+
+    diff = fabs((double)rho_ray[i] - f_rho_ray) / fabs(f_rho_ray);
+    if (diff > max_rho_diff) max_rho_diff = diff;
+    diff = fabs((double)s_r[i] - f_s_r) / fabs(f_s_r);
+    if (diff > max_s_diff) max_s_diff = diff;
+  }
+
+  printf("test_rayleigh: %d points, max relative difference from 6S: "
+         "chand %g, csalbr %g\n", n, max_rho_diff, max_s_diff);
+
+  free(phi);
+  free(muv);
+  free(mus);
+  free(tau_ray);
+  free(rho_ray);
+  free(s_r);
+
+  if (max_rho_diff > MAX_REL_DIFF || max_s_diff > MAX_REL_DIFF) {
+    printf("test_rayleigh: FAILED (tolerance %g)\n", MAX_REL_DIFF);
+    return EXIT_FAILURE;
+  }
+  printf("test_rayleigh: passed\n");
+  return EXIT_SUCCESS;
+}